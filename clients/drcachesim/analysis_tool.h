@@ -80,7 +80,10 @@ enum shard_type_t {
  * trace entry for that shard.  The concurrency model used guarantees that all
  * entries from any one shard are processed by the same single worker thread, so no
  * synchronization is needed inside the parallel_ functions.  A single worker thread
- * invokes print_results() as well.
+ * invokes print_results() as well.  The exception is a shard split into pieces on
+ * request when every tool returns true from parallel_chunk_supported(): each piece
+ * is processed by a single worker thread and the pieces' results are then merged
+ * through parallel_chunk_merge().
  *
  * For serial operation, process_memref(), operates on a trace entry in a single,
  * sorted, interleaved stream of trace entries.  In the default mode of operation,
@@ -482,6 +485,60 @@ public:
     {
         return nullptr;
     }
+    /**
+     * Returns whether this tool supports analyzing separate pieces of a single trace
+     * shard concurrently and merging the results.  The analyzer uses this to split
+     * a single chunked thread trace into groups of chunks (see the -split_chunks
+     * option), which is only worthwhile for tools whose per-shard results can be
+     * combined, such as counts.  A tool returning true must also support
+     * parallel_shard_supported() and must implement parallel_chunk_init_stream()
+     * and parallel_chunk_merge().  This may be called prior to initialize().
+     */
+    virtual bool
+    parallel_chunk_supported()
+    {
+        return false;
+    }
+    /**
+     * Invoked in place of parallel_shard_init_stream() for each piece of a split
+     * shard other than the first.  The first piece is initialized with
+     * parallel_shard_init_stream() as usual and the later pieces are merged into it.
+     * \p shard_index is the ordinal of the split shard and \p chunk_index is the
+     * 1-based ordinal of this piece within it.  \p worker_data and \p chunk_stream
+     * are as for parallel_shard_init_stream(), though the stream's ordinals start
+     * partway through the shard and its top-level header values (such as
+     * get_filetype()) must be queried as the header markers are only seen by the
+     * first piece.  The return value is passed to parallel_shard_memref() for each
+     * entry of this piece and then to parallel_chunk_merge(); it should not be added
+     * to any table consulted by print_results().
+     *
+     * A piece's first entry is its first instruction: the timestamp and cpu markers
+     * the reader re-inserts after seeking are not passed to the tool.  Only the last
+     * piece delivers the thread exit.  The pieces thus together contain exactly the
+     * entries of the unsplit shard.
+     */
+    virtual void *
+    parallel_chunk_init_stream(int shard_index, int chunk_index, void *worker_data,
+                               memtrace_stream_t *chunk_stream)
+    {
+        return nullptr;
+    }
+    /**
+     * Merges \p chunk_data, the value returned by parallel_chunk_init_stream() for one
+     * piece of a split shard, into \p shard_data, the value returned by
+     * parallel_shard_init_stream() for the first piece of that shard, and frees
+     * \p chunk_data.  This is invoked once per piece, in increasing piece order, after
+     * that piece and all earlier pieces have been fully processed.  Invocations are
+     * serialized by the framework so no synchronization is needed.
+     * parallel_shard_exit() is invoked on \p shard_data after the final merge.
+     * Returns whether the merge was successful; on failure, parallel_shard_error()
+     * on \p shard_data returns a descriptive message.
+     */
+    virtual bool
+    parallel_chunk_merge(void *shard_data, void *chunk_data)
+    {
+        return false;
+    }
 
 protected:
     bool success_;
@@ -57,6 +57,7 @@
 #include "scheduler.h"
 #include "analysis_tool.h"
 #ifdef HAS_ZLIB
+#    include "columnar_file_reader.h"
 #    include "compressed_file_reader.h"
 #else
 #    include "file_reader.h"
@@ -64,12 +65,16 @@
 #include "reader.h"
 #include "record_file_reader.h"
 #include "trace_entry.h"
+#include "directory_iterator.h"
 #ifdef HAS_ZIP
 #    include "reader/zipfile_file_reader.h"
 #endif
 #ifdef HAS_SNAPPY
 #    include "reader/snappy_file_reader.h"
 #endif
+#ifdef HAS_LZ4
+#    include "reader/lz4_file_reader.h"
+#endif
 #include "common/utils.h"
 
 namespace dynamorio {
@@ -122,6 +127,68 @@ analyzer_t::record_is_timestamp(const memref_t &record)
         record.marker.marker_type == TRACE_MARKER_TYPE_TIMESTAMP;
 }
 
+template <>
+bool
+analyzer_t::record_is_instr(const memref_t &record)
+{
+    return type_is_instr(record.instr.type);
+}
+
+template <>
+bool
+analyzer_t::create_split_reader(const std::string &path, uint64_t stop_instruction,
+                                std::unique_ptr<reader_t> &reader,
+                                std::unique_ptr<reader_t> &reader_end)
+{
+    // Only these formats can seek to a chunk: zipfiles always, and gzip, lz4 and
+    // columnar through a chunk index, without which get_chunk_count() is 0.
+#ifdef HAS_ZIP
+    if (ends_with(path, ".zip")) {
+        reader = std::unique_ptr<reader_t>(new zipfile_file_reader_t(path, verbosity_));
+        reader_end = std::unique_ptr<reader_t>(new zipfile_file_reader_t());
+    }
+#endif
+#ifdef HAS_ZLIB
+    if (ends_with(path, ".gz")) {
+        reader =
+            std::unique_ptr<reader_t>(new compressed_file_reader_t(path, verbosity_));
+        reader_end = std::unique_ptr<reader_t>(new compressed_file_reader_t());
+    }
+    if (ends_with(path, ".col")) {
+        reader = std::unique_ptr<reader_t>(new columnar_file_reader_t(path, verbosity_));
+        reader_end = std::unique_ptr<reader_t>(new columnar_file_reader_t());
+    }
+#endif
+#ifdef HAS_LZ4
+    if (ends_with(path, ".lz4")) {
+        reader = std::unique_ptr<reader_t>(new lz4_file_reader_t(path, verbosity_));
+        reader_end = std::unique_ptr<reader_t>(new lz4_file_reader_t());
+    }
+#endif
+    if (!reader)
+        return false;
+    reader->set_stop_instruction(stop_instruction);
+    return true;
+}
+
+template <>
+bool
+analyzer_t::get_split_layout(const std::string &path, uint64_t &chunk_count,
+                             uint64_t &chunk_instr_count)
+{
+    std::unique_ptr<reader_t> reader;
+    std::unique_ptr<reader_t> reader_end;
+    if (!create_split_reader(path, 0, reader, reader_end) || !reader->init())
+        return false;
+    // The chunk size is a top-level header, which precedes the first instruction.
+    while (reader->get_chunk_instr_count() == 0 && *reader != *reader_end &&
+           !type_is_instr((**reader).instr.type))
+        ++(*reader);
+    chunk_count = reader->get_chunk_count();
+    chunk_instr_count = reader->get_chunk_instr_count();
+    return true;
+}
+
 template <>
 memref_t
 analyzer_t::create_wait_marker()
@@ -182,6 +249,32 @@ record_analyzer_t::record_is_timestamp(const trace_entry_t &record)
     return record.type == TRACE_TYPE_MARKER && record.size == TRACE_MARKER_TYPE_TIMESTAMP;
 }
 
+template <>
+bool
+record_analyzer_t::record_is_instr(const trace_entry_t &record)
+{
+    return type_is_instr(static_cast<trace_type_t>(record.type));
+}
+
+template <>
+bool
+record_analyzer_t::create_split_reader(const std::string &path,
+                                       uint64_t stop_instruction,
+                                       std::unique_ptr<record_reader_t> &reader,
+                                       std::unique_ptr<record_reader_t> &reader_end)
+{
+    // XXX: Add chunk-aware record readers if splitting raw records is ever useful.
+    return false;
+}
+
+template <>
+bool
+record_analyzer_t::get_split_layout(const std::string &path, uint64_t &chunk_count,
+                                    uint64_t &chunk_instr_count)
+{
+    return false;
+}
+
 template <>
 trace_entry_t
 record_analyzer_t::create_wait_marker()
@@ -238,11 +331,22 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler(
         // capability in the scheduler we should switch to that.
         regions.emplace_back(skip_instrs_ + 1, 0);
     }
-    typename sched_type_t::input_workload_t workload(trace_path, regions);
-    if (only_thread != INVALID_THREAD_ID) {
-        workload.only_threads.insert(only_thread);
+    std::vector<typename sched_type_t::input_workload_t> sched_inputs;
+    if (only_thread == INVALID_THREAD_ID && !split_trace(trace_path, sched_inputs))
+        return false;
+    if (sched_inputs.empty()) {
+        sched_inputs.emplace_back(trace_path, regions);
+        if (only_thread != INVALID_THREAD_ID) {
+            sched_inputs[0].only_threads.insert(only_thread);
+        }
+    } else {
+        // The scheduler only applies this to readers it opens itself.
+        for (auto &workload : sched_inputs) {
+            for (auto &input : workload.readers)
+                input.reader->set_read_ahead(options.read_ahead_blocks);
+        }
     }
-    return init_scheduler_common(workload, std::move(options));
+    return init_scheduler_common(sched_inputs, std::move(options));
 }
 
 template <typename RecordType, typename ReaderType>
@@ -263,14 +367,15 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler(
     std::vector<typename sched_type_t::range_t> regions;
     if (skip_instrs_ > 0)
         regions.emplace_back(skip_instrs_ + 1, 0);
-    typename sched_type_t::input_workload_t workload(std::move(readers), regions);
-    return init_scheduler_common(workload, std::move(options));
+    std::vector<typename sched_type_t::input_workload_t> sched_inputs;
+    sched_inputs.emplace_back(std::move(readers), regions);
+    return init_scheduler_common(sched_inputs, std::move(options));
 }
 
 template <typename RecordType, typename ReaderType>
 bool
 analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler_common(
-    typename sched_type_t::input_workload_t &workload,
+    std::vector<typename sched_type_t::input_workload_t> &sched_inputs,
     typename sched_type_t::scheduler_options_t options)
 {
     for (int i = 0; i < num_tools_; ++i) {
@@ -279,8 +384,6 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler_common(
             break;
         }
     }
-    std::vector<typename sched_type_t::input_workload_t> sched_inputs(1);
-    sched_inputs[0] = std::move(workload);
 
     typename sched_type_t::scheduler_options_t sched_ops;
     int output_count = worker_count_;
@@ -302,14 +405,28 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler_common(
         }
     } else if (parallel_) {
         sched_ops = sched_type_t::make_scheduler_parallel_options(verbosity_);
+        sched_ops.read_ahead_blocks = options.read_ahead_blocks;
         if (worker_count_ <= 0)
             worker_count_ = std::thread::hardware_concurrency();
         output_count = worker_count_;
     } else {
         sched_ops = sched_type_t::make_scheduler_serial_options(verbosity_);
+        sched_ops.read_ahead_blocks = options.read_ahead_blocks;
         worker_count_ = 1;
         output_count = 1;
     }
+    if (shard_type_ != SHARD_BY_CORE) {
+        // Keep any speculation strategy the subclass requested.
+        static constexpr int SPECULATE_FLAGS = sched_type_t::SCHEDULER_SPECULATE_NOPS |
+            sched_type_t::SCHEDULER_SPECULATE_LAST_FROM_TRACE |
+            sched_type_t::SCHEDULER_SPECULATE_AVERAGE_FROM_TRACE |
+            sched_type_t::SCHEDULER_SPECULATE_FROM_BINARY;
+        sched_ops.flags = static_cast<typename sched_type_t::scheduler_flags_t>(
+            static_cast<int>(sched_ops.flags) |
+            (static_cast<int>(options.flags) & SPECULATE_FLAGS));
+        sched_ops.speculation_history_entries = options.speculation_history_entries;
+        sched_ops.speculation_binary_source = options.speculation_binary_source;
+    }
     if (scheduler_.init(sched_inputs, output_count, std::move(sched_ops)) !=
         sched_type_t::STATUS_SUCCESS) {
         ERRMSG("Failed to initialize scheduler: %s\n",
@@ -324,6 +441,104 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler_common(
     return true;
 }
 
+template <typename RecordType, typename ReaderType>
+bool
+analyzer_tmpl_t<RecordType, ReaderType>::split_trace(
+    const std::string &trace_path,
+    std::vector<typename sched_type_t::input_workload_t> &sched_inputs)
+{
+    if (split_chunks_ <= 1)
+        return true;
+    // The pieces are merged as whole-shard results, so we do not support modes that
+    // look at the shard as a whole along the way.
+    if (!parallel_ || shard_type_ != SHARD_BY_THREAD || skip_instrs_ > 0 ||
+        interval_microseconds_ > 0) {
+        VPRINT(this, 1, "Not splitting the trace in this analyzer mode\n");
+        return true;
+    }
+    for (int i = 0; i < num_tools_; ++i) {
+        if (!tools_[i]->parallel_shard_supported() ||
+            !tools_[i]->parallel_chunk_supported()) {
+            VPRINT(this, 1, "Not splitting the trace: tool #%d does not support it\n",
+                   i);
+            return true;
+        }
+    }
+    std::string path = trace_path;
+    if (directory_iterator_t::is_directory(trace_path)) {
+        directory_iterator_t end;
+        directory_iterator_t iter(trace_path);
+        if (!iter) {
+            error_string_ =
+                "Failed to list directory " + trace_path + ": " + iter.error_string();
+            return false;
+        }
+        int count = 0;
+        for (; iter != end; ++iter) {
+            const std::string fname = *iter;
+            if (fname == "." || fname == ".." ||
+                starts_with(fname, DRMEMTRACE_SERIAL_SCHEDULE_FILENAME) ||
+                fname == DRMEMTRACE_CPU_SCHEDULE_FILENAME ||
+                fname == DRMEMTRACE_MODULE_LIST_FILENAME ||
+                fname == DRMEMTRACE_FUNCTION_LIST_FILENAME ||
+                fname == DRMEMTRACE_ENCODING_FILENAME ||
+                ends_with(fname, DRMEMTRACE_INDEX_FILE_SUFFIX))
+                continue;
+            path = trace_path + DIRSEP + fname;
+            ++count;
+        }
+        if (count != 1) {
+            VPRINT(this, 1, "Not splitting a trace with %d thread files\n", count);
+            return true;
+        }
+    }
+    uint64_t chunk_count = 0;
+    uint64_t chunk_instr_count = 0;
+    if (!get_split_layout(path, chunk_count, chunk_instr_count) || chunk_count <= 1 ||
+        chunk_instr_count == 0) {
+        VPRINT(this, 1, "Not splitting %s: not a multi-chunk trace\n", path.c_str());
+        return true;
+    }
+    return add_split_workloads(path, chunk_count, chunk_instr_count, sched_inputs);
+}
+
+template <typename RecordType, typename ReaderType>
+bool
+analyzer_tmpl_t<RecordType, ReaderType>::add_split_workloads(
+    const std::string &path, uint64_t chunk_count, uint64_t chunk_instr_count,
+    std::vector<typename sched_type_t::input_workload_t> &sched_inputs)
+{
+    int count = static_cast<int>(
+        std::min(static_cast<uint64_t>(split_chunks_), chunk_count));
+    for (int i = 0; i < count; ++i) {
+        uint64_t first_chunk = chunk_count * i / count;
+        uint64_t end_chunk = chunk_count * (i + 1) / count;
+        // The last group runs to the end of the trace.
+        uint64_t stop_instruction = i == count - 1 ? 0 : end_chunk * chunk_instr_count;
+        std::unique_ptr<ReaderType> reader;
+        std::unique_ptr<ReaderType> reader_end;
+        if (!create_split_reader(path, stop_instruction, reader, reader_end)) {
+            error_string_ = "Failed to create a split reader for " + path;
+            return false;
+        }
+        std::vector<typename sched_type_t::input_reader_t> readers;
+        // Use a sentinel for the tid so the scheduler will use the memref record tid.
+        readers.emplace_back(std::move(reader), std::move(reader_end),
+                             /*tid=*/INVALID_THREAD_ID);
+        std::vector<typename sched_type_t::range_t> regions;
+        // The first group does not seek so that it observes the top-level headers.
+        if (i > 0)
+            regions.emplace_back(first_chunk * chunk_instr_count + 1, 0);
+        sched_inputs.emplace_back(std::move(readers), regions);
+    }
+    VPRINT(this, 1, "Split %s into %d groups of chunks\n", path.c_str(), count);
+    split_count_ = count;
+    split_done_.assign(count, false);
+    split_tool_data_.assign(count, std::vector<void *>(num_tools_, nullptr));
+    split_next_merge_ = 1;
+    return true;
+}
+
 template <typename RecordType, typename ReaderType>
 analyzer_tmpl_t<RecordType, ReaderType>::analyzer_tmpl_t(
     const std::string &trace_path, analysis_tool_tmpl_t<RecordType> **tools,
@@ -531,6 +746,8 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_shard_exit(
     VPRINT(this, 1, "Worker %d finished trace shard %s\n", worker->index,
            worker->stream->get_stream_name().c_str());
     worker->shard_data[shard_index].exited = true;
+    if (split_count_ > 0)
+        return process_split_exit(worker, shard_index);
     if (interval_microseconds_ != 0 &&
         !process_interval(worker->shard_data[shard_index].cur_interval_index,
                           worker->shard_data[shard_index].cur_interval_init_instr_count,
@@ -551,6 +768,48 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_shard_exit(
     return true;
 }
 
+template <typename RecordType, typename ReaderType>
+bool
+analyzer_tmpl_t<RecordType, ReaderType>::process_split_exit(
+    analyzer_worker_data_t *worker, int shard_index)
+{
+    std::lock_guard<std::mutex> guard(split_mutex_);
+    split_done_[shard_index] = true;
+    for (int i = 0; i < num_tools_; ++i) {
+        split_tool_data_[shard_index][i] =
+            worker->shard_data[shard_index].tool_data[i].shard_data;
+    }
+    // Merge in piece order, each piece waiting for the first and all in between.
+    if (!split_done_[0])
+        return true;
+    while (split_next_merge_ < split_count_ && split_done_[split_next_merge_]) {
+        std::vector<void *> &piece_data = split_tool_data_[split_next_merge_];
+        for (int i = 0; i < num_tools_; ++i) {
+            if (!tools_[i]->parallel_chunk_merge(split_tool_data_[0][i], piece_data[i])) {
+                worker->error = tools_[i]->parallel_shard_error(split_tool_data_[0][i]);
+                VPRINT(this, 1, "Worker %d hit merge error %s on trace piece %d\n",
+                       worker->index, worker->error.c_str(), split_next_merge_);
+                return false;
+            }
+            piece_data[i] = nullptr;
+        }
+        VPRINT(this, 2, "Worker %d merged trace piece %d\n", worker->index,
+               split_next_merge_);
+        ++split_next_merge_;
+    }
+    if (split_next_merge_ < split_count_)
+        return true;
+    for (int i = 0; i < num_tools_; ++i) {
+        if (!tools_[i]->parallel_shard_exit(split_tool_data_[0][i])) {
+            worker->error = tools_[i]->parallel_shard_error(split_tool_data_[0][i]);
+            VPRINT(this, 1, "Worker %d hit shard exit error %s on split trace\n",
+                   worker->index, worker->error.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
 template <typename RecordType, typename ReaderType>
 void
 analyzer_tmpl_t<RecordType, ReaderType>::process_tasks(analyzer_worker_data_t *worker)
@@ -601,12 +860,27 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_tasks(analyzer_worker_data_t *w
             if (interval_microseconds_ != 0)
                 worker->shard_data[shard_index].cur_interval_index = 1;
             for (int i = 0; i < num_tools_; ++i) {
-                worker->shard_data[shard_index].tool_data[i].shard_data =
-                    tools_[i]->parallel_shard_init_stream(
-                        shard_index, user_worker_data[i], worker->stream);
+                // The later pieces of a split trace are merged into the first.
+                if (split_count_ > 0 && shard_index > 0) {
+                    worker->shard_data[shard_index].tool_data[i].shard_data =
+                        tools_[i]->parallel_chunk_init_stream(
+                            0, shard_index, user_worker_data[i], worker->stream);
+                } else {
+                    worker->shard_data[shard_index].tool_data[i].shard_data =
+                        tools_[i]->parallel_shard_init_stream(
+                            shard_index, user_worker_data[i], worker->stream);
+                }
             }
             worker->shard_data[shard_index].shard_index = shard_index;
         }
+        if (split_count_ > 0 && shard_index > 0 &&
+            !worker->shard_data[shard_index].seen_instr) {
+            // Drop the timestamp and cpu markers the reader re-inserts after seeking
+            // to the piece: the prior piece already delivered the originals.
+            if (!record_is_instr(record))
+                continue;
+            worker->shard_data[shard_index].seen_instr = true;
+        }
         memref_tid_t tid;
         if (worker->shard_data[shard_index].shard_id == 0) {
             if (shard_type_ == SHARD_BY_CORE)
@@ -47,6 +47,7 @@
 
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <string>
 #include <unordered_map>
@@ -174,6 +175,8 @@ protected:
         int shard_index = 0;
         std::vector<analyzer_tool_shard_data_t> tool_data;
         bool exited = false;
+        // For a piece of a split shard: whether its first instruction has been seen.
+        bool seen_instr = false;
 
     private:
         // Delete copy constructor and assignment operator to avoid overhead of
@@ -226,8 +229,41 @@ protected:
                    typename sched_type_t::scheduler_options_t options);
 
     bool
-    init_scheduler_common(typename sched_type_t::input_workload_t &workload,
-                          typename sched_type_t::scheduler_options_t options);
+    init_scheduler_common(
+        std::vector<typename sched_type_t::input_workload_t> &sched_inputs,
+        typename sched_type_t::scheduler_options_t options);
+
+    // If split_chunks_ asks for it and the tools support it, splits the single
+    // chunked trace file at trace_path (or the single trace file inside the
+    // trace_path directory) into groups of consecutive chunks, adding one scheduler
+    // workload per group to sched_inputs.  Leaves sched_inputs empty if the trace is
+    // not split.  Returns false on error.
+    bool
+    split_trace(const std::string &trace_path,
+                std::vector<typename sched_type_t::input_workload_t> &sched_inputs);
+
+    // Adds min(split_chunks_, chunk_count) workloads to sched_inputs which together
+    // cover the trace at path and sets split_count_ to their number.  Each workload
+    // holds one group of consecutive chunks: a region of interest seeks to the start
+    // of the group and the reader stops at its end.  Returns false on error.
+    bool
+    add_split_workloads(
+        const std::string &path, uint64_t chunk_count, uint64_t chunk_instr_count,
+        std::vector<typename sched_type_t::input_workload_t> &sched_inputs);
+
+    // Queries the number of chunks and the instructions per chunk of the trace file at
+    // path, returning false if it is not in a format that supports splitting.
+    bool
+    get_split_layout(const std::string &path, uint64_t &chunk_count,
+                     uint64_t &chunk_instr_count);
+
+    // Creates a reader and its end-of-file sentinel for one group of a split trace at
+    // path, ending after instruction ordinal stop_instruction (0 means no limit).
+    // Returns false if this analyzer type does not support splitting.
+    virtual bool
+    create_split_reader(const std::string &path, uint64_t stop_instruction,
+                        std::unique_ptr<ReaderType> &reader,
+                        std::unique_ptr<ReaderType> &reader_end);
 
     // Used for std::thread so we need an rvalue (so no &worker).
     void
@@ -241,6 +277,12 @@ protected:
     bool
     process_shard_exit(analyzer_worker_data_t *worker, int shard_index);
 
+    // Helper for process_shard_exit() for a piece of a split shard: merges every
+    // finished piece whose predecessors are all merged, and calls
+    // parallel_shard_exit() once the last one is merged.
+    bool
+    process_split_exit(analyzer_worker_data_t *worker, int shard_index);
+
     bool
     record_has_tid(RecordType record, memref_tid_t &tid);
 
@@ -250,6 +292,9 @@ protected:
     bool
     record_is_timestamp(const RecordType &record);
 
+    bool
+    record_is_instr(const RecordType &record);
+
     RecordType
     create_wait_marker();
 
@@ -347,6 +392,21 @@ protected:
     int verbosity_ = 0;
     shard_type_t shard_type_ = SHARD_BY_THREAD;
     bool sched_by_time_ = false;
+    // The requested number of groups of chunks to split a single chunked thread
+    // trace into for concurrent analysis.
+    int split_chunks_ = 0;
+    // When a trace is split, the number of groups it was split into, each a
+    // separate scheduler input whose ordinal is its index in the group sequence;
+    // else 0.
+    int split_count_ = 0;
+    // Merge state for a split trace, shared by all workers and guarded by
+    // split_mutex_.  split_tool_data_[piece][tool] holds the tool data of each
+    // finished piece not yet merged, with the first piece's data being the shard
+    // data the others are merged into.
+    std::mutex split_mutex_;
+    std::vector<bool> split_done_;
+    std::vector<std::vector<void *>> split_tool_data_;
+    int split_next_merge_ = 1;
 
 private:
     bool
@@ -35,6 +35,7 @@
 #include "common/options.h"
 #include "common/utils.h"
 #include "common/directory_iterator.h"
+#include "tracer/module_instr_source.h"
 #include "tracer/raw2trace_directory.h"
 #include "tracer/raw2trace.h"
 #include "reader/file_reader.h"
@@ -112,6 +113,7 @@ analyzer_multi_t::analyzer_multi_t()
     worker_count_ = op_jobs.get_value();
     skip_instrs_ = op_skip_instrs.get_value();
     interval_microseconds_ = op_interval_microseconds.get_value();
+    split_chunks_ = op_split_chunks.get_value();
     // Initial measurements show it's sometimes faster to keep the parallel model
     // of using single-file readers but use them sequentially, as opposed to
     // the every-file interleaving reader, but the user can specify -jobs 1, so
@@ -162,7 +164,8 @@ analyzer_multi_t::analyzer_multi_t()
             raw2trace_directory_t dir(op_verbose.get_value());
             std::string dir_err =
                 dir.initialize(op_indir.get_value(), "", op_trace_compress.get_value(),
-                               op_syscall_template_file.get_value());
+                               op_syscall_template_file.get_value(),
+                               op_chunk_index.get_value());
             if (!dir_err.empty()) {
                 success_ = false;
                 error_string_ = "Directory setup failed: " + dir_err;
@@ -197,6 +200,11 @@ analyzer_multi_t::analyzer_multi_t()
         }
         sched_ops = init_dynamic_schedule();
     }
+    sched_ops.read_ahead_blocks = op_read_ahead_blocks.get_value();
+    if (!op_speculate.get_value().empty() && !init_speculation(sched_ops)) {
+        success_ = false;
+        return;
+    }
 
     if (!op_indir.get_value().empty()) {
         std::string tracedir =
@@ -208,7 +216,8 @@ analyzer_multi_t::analyzer_multi_t()
         // XXX i#3323: Add parallel analysis support for online tools.
         parallel_ = false;
         auto reader = std::unique_ptr<reader_t>(
-            new ipc_reader_t(op_ipc_name.get_value().c_str(), op_verbose.get_value()));
+            new ipc_reader_t(op_ipc_name.get_value().c_str(), op_verbose.get_value(),
+                             op_ipc_ring_size.get_value()));
         auto end = std::unique_ptr<reader_t>(new ipc_reader_t());
         if (!init_scheduler(std::move(reader), std::move(end), op_verbose.get_value(),
                             std::move(sched_ops))) {
@@ -257,6 +266,8 @@ analyzer_multi_t::init_dynamic_schedule()
     sched_ops.blocking_switch_threshold = op_sched_blocking_switch_us.get_value();
     sched_ops.block_time_scale = op_sched_block_scale.get_value();
     sched_ops.block_time_max = op_sched_block_max_us.get_value();
+    sched_ops.sharded_runqueues = op_sched_sharded_runqueues.get_value();
+    sched_ops.rebalance_period = op_sched_rebalance_period_us.get_value();
 #ifdef HAS_ZIP
     if (!op_record_file.get_value().empty()) {
         record_schedule_zip_.reset(new zipfile_ostream_t(op_record_file.get_value()));
@@ -344,9 +355,20 @@ analyzer_multi_t::create_analysis_tool_from_options(const std::string &simulator
     if (simulator_type == CPU_CACHE) {
         const std::string &config_file = op_config_file.get_value();
         if (!config_file.empty()) {
+            if (!op_speculate.get_value().empty()) {
+                ERRMSG("Usage error: -speculate is not supported with -config_file\n");
+                return nullptr;
+            }
+            if (op_LL_set_sample_rate.get_value() > 1) {
+                ERRMSG("Usage error: set LL_set_sample_rate in the -config_file "
+                       "instead\n");
+                return nullptr;
+            }
             return cache_simulator_create(config_file);
         } else {
             cache_simulator_knobs_t *knobs = get_cache_simulator_knobs();
+            if (!op_speculate.get_value().empty())
+                knobs->speculate_instrs = op_speculate_instrs.get_value();
             return cache_simulator_create(*knobs);
         }
     } else if (simulator_type == MISS_ANALYZER) {
@@ -354,6 +376,24 @@ analyzer_multi_t::create_analysis_tool_from_options(const std::string &simulator
         return cache_miss_analyzer_create(*knobs, op_miss_count_threshold.get_value(),
                                           op_miss_frac_threshold.get_value(),
                                           op_confidence_threshold.get_value());
+    } else if (simulator_type == CACHE_SWEEP) {
+        cache_simulator_knobs_t *knobs = get_cache_simulator_knobs();
+        return cache_sweep_create(*knobs, op_cache_sweep_configs.get_value(),
+                                  op_cache_sweep_threads.get_value());
+    } else if (simulator_type == MISS_RATIO_CURVE) {
+        cache_simulator_knobs_t *knobs = get_cache_simulator_knobs();
+        miss_ratio_curve_knobs_t curve_knobs;
+        curve_knobs.L1_min_size = op_miss_curve_L1_min_size.get_value();
+        curve_knobs.L1_max_size = op_miss_curve_L1_max_size.get_value();
+        curve_knobs.LL_min_size = op_miss_curve_LL_min_size.get_value();
+        curve_knobs.LL_max_size = op_miss_curve_LL_max_size.get_value();
+        curve_knobs.min_assoc = op_miss_curve_min_assoc.get_value();
+        curve_knobs.max_assoc = op_miss_curve_max_assoc.get_value();
+        return miss_ratio_curve_create(*knobs, curve_knobs);
+    } else if (simulator_type == OPT_MISS_BOUND) {
+        cache_simulator_knobs_t *knobs = get_cache_simulator_knobs();
+        return opt_miss_bound_create(*knobs, op_opt_miss_bound_dir.get_value(),
+                                     op_report_top.get_value());
     } else if (simulator_type == TLB) {
         tlb_simulator_knobs_t knobs;
         knobs.num_cores = op_num_cores.get_value();
@@ -372,6 +412,8 @@ analyzer_multi_t::create_analysis_tool_from_options(const std::string &simulator
         knobs.verbose = op_verbose.get_value();
         knobs.cpu_scheduling = op_cpu_scheduling.get_value();
         knobs.use_physical = op_use_physical.get_value();
+        if (!op_speculate.get_value().empty())
+            knobs.speculate_instrs = op_speculate_instrs.get_value();
         return tlb_simulator_create(knobs);
     } else if (simulator_type == HISTOGRAM) {
         return histogram_tool_create(op_line_size.get_value(), op_report_top.get_value(),
@@ -390,10 +432,22 @@ analyzer_multi_t::create_analysis_tool_from_options(const std::string &simulator
             ERRMSG("Usage error: reuse_histogram_bin_multiplier must be >= 1.0\n");
             return nullptr;
         }
+        knobs.sample_rate = op_reuse_sample_rate.get_value();
+        if (knobs.sample_rate <= 0.0) {
+            ERRMSG("Usage error: reuse_sample_rate must be > 0.0\n");
+            return nullptr;
+        }
+        knobs.sample_max_lines = op_reuse_sample_max_lines.get_value();
         knobs.verbose = op_verbose.get_value();
         return reuse_distance_tool_create(knobs);
     } else if (simulator_type == REUSE_TIME) {
-        return reuse_time_tool_create(op_line_size.get_value(), op_verbose.get_value());
+        if (op_reuse_sample_rate.get_value() <= 0.0) {
+            ERRMSG("Usage error: reuse_sample_rate must be > 0.0\n");
+            return nullptr;
+        }
+        return reuse_time_tool_create(op_line_size.get_value(), op_verbose.get_value(),
+                                      op_reuse_sample_rate.get_value(),
+                                      op_reuse_sample_max_lines.get_value());
     } else if (simulator_type == BASIC_COUNTS) {
         return basic_counts_tool_create(op_verbose.get_value());
     } else if (simulator_type == OPCODE_MIX) {
@@ -436,7 +490,8 @@ analyzer_multi_t::create_analysis_tool_from_options(const std::string &simulator
         auto tool = create_external_tool(simulator_type);
         if (tool == nullptr) {
             ERRMSG("Usage error: unsupported analyzer type \"%s\". "
-                   "Please choose " CPU_CACHE ", " MISS_ANALYZER ", " TLB ", " HISTOGRAM
+                   "Please choose " CPU_CACHE ", " MISS_ANALYZER ", " CACHE_SWEEP
+                   ", " MISS_RATIO_CURVE ", " OPT_MISS_BOUND ", " TLB ", " HISTOGRAM
                    ", " REUSE_DIST ", " BASIC_COUNTS ", " OPCODE_MIX ", " SYSCALL_MIX
                    ", " VIEW ", " MISSING_INSTRUCTIONS ", " FUNC_VIEW ", or some external analyzer.\n",
                    simulator_type.c_str());
@@ -544,6 +599,42 @@ analyzer_multi_t::get_module_file_path()
     return get_aux_file_path(op_module_file.get_value(), DRMEMTRACE_MODULE_LIST_FILENAME);
 }
 
+bool
+analyzer_multi_t::init_speculation(scheduler_t::scheduler_options_t &sched_ops)
+{
+    const std::string &kind = op_speculate.get_value();
+    int flag;
+    if (kind == "nops")
+        flag = scheduler_t::SCHEDULER_SPECULATE_NOPS;
+    else if (kind == "last")
+        flag = scheduler_t::SCHEDULER_SPECULATE_LAST_FROM_TRACE;
+    else if (kind == "average")
+        flag = scheduler_t::SCHEDULER_SPECULATE_AVERAGE_FROM_TRACE;
+    else if (kind == "binary") {
+        std::string module_file_path = get_module_file_path();
+        if (module_file_path.empty()) {
+            error_string_ = "-speculate binary requires offline traces with a "
+                            "module file";
+            return false;
+        }
+        speculation_source_.reset(new module_instr_source_t(
+            module_file_path, op_alt_module_dir.get_value(), op_verbose.get_value()));
+        std::string error = speculation_source_->initialize();
+        if (!error.empty()) {
+            error_string_ = "Failed to load binaries for -speculate: " + error;
+            return false;
+        }
+        sched_ops.speculation_binary_source = speculation_source_.get();
+        flag = scheduler_t::SCHEDULER_SPECULATE_FROM_BINARY;
+    } else {
+        error_string_ = "Unknown -speculate value " + kind;
+        return false;
+    }
+    sched_ops.flags = static_cast<scheduler_t::scheduler_flags_t>(
+        static_cast<int>(sched_ops.flags) | flag);
+    return true;
+}
+
 /* Get the cache simulator knobs used by the cache simulator
  * and the cache miss analyzer.
  */
@@ -560,13 +651,20 @@ analyzer_multi_t::get_cache_simulator_knobs()
     knobs->LL_size = op_LL_size.get_value();
     knobs->LL_assoc = op_LL_assoc.get_value();
     knobs->LL_miss_file = op_LL_miss_file.get_value();
+    knobs->LL_set_sample_rate = op_LL_set_sample_rate.get_value();
     knobs->model_coherence = op_coherence.get_value();
     knobs->replace_policy = op_replace_policy.get_value();
     knobs->data_prefetcher = op_data_prefetcher.get_value();
+    knobs->prefetch_degree = op_prefetch_degree.get_value();
+    knobs->prefetch_queue_size = op_prefetch_queue_size.get_value();
+    knobs->prefetch_table_size = op_prefetch_table_size.get_value();
     knobs->skip_refs = op_skip_refs.get_value();
     knobs->warmup_refs = op_warmup_refs.get_value();
     knobs->warmup_fraction = op_warmup_fraction.get_value();
     knobs->sim_refs = op_sim_refs.get_value();
+    knobs->sample_period_refs = op_sample_period_refs.get_value();
+    knobs->sample_warmup_refs = op_sample_warmup_refs.get_value();
+    knobs->sample_unit_refs = op_sample_unit_refs.get_value();
     knobs->verbose = op_verbose.get_value();
     knobs->cpu_scheduling = op_cpu_scheduling.get_value();
     knobs->use_physical = op_use_physical.get_value();
@@ -574,6 +672,7 @@ analyzer_multi_t::get_cache_simulator_knobs()
     knobs->max_trace_length = op_max_trace_length.get_value();
     knobs->cachesim_row_buffer_size = op_cachesim_row_buffer_size.get_value();
     knobs->trace_form = op_trace_form.get_value();
+    knobs->cachesim_row_format = op_cachesim_row_format.get_value();
     return knobs;
 }
 
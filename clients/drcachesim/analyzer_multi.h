@@ -45,6 +45,8 @@
 namespace dynamorio {
 namespace drmemtrace {
 
+class module_instr_source_t;
+
 class analyzer_multi_t : public analyzer_t {
 public:
     // Usage: errors encountered during the constructor will set a flag that should
@@ -77,6 +79,10 @@ protected:
     std::string
     get_module_file_path();
 
+    // Sets up the scheduler's speculation strategy for -speculate.
+    bool
+    init_speculation(scheduler_t::scheduler_options_t &sched_ops);
+
     /* Get the cache simulator knobs used by the cache simulator
      * and the cache miss analyzer.
      */
@@ -92,6 +98,8 @@ protected:
     std::unique_ptr<archive_istream_t> cpu_schedule_zip_;
     std::unique_ptr<archive_ostream_t> record_schedule_zip_;
     std::unique_ptr<archive_istream_t> replay_schedule_zip_;
+    // The scheduler's instruction source for -speculate binary.
+    std::unique_ptr<module_instr_source_t> speculation_source_;
 
     static const int max_num_tools_ = 8;
 };
@@ -38,7 +38,13 @@
 #ifndef _ARCHIVE_OSTREAM_H_
 #define _ARCHIVE_OSTREAM_H_ 1
 
+#include <stdint.h>
+
 #include <fstream>
+#include <iostream>
+#include <string>
+
+#include "trace_index.h"
 
 namespace dynamorio {
 namespace drmemtrace {
@@ -54,6 +60,45 @@ public:
     // error description on failure.
     virtual std::string
     open_new_component(const std::string &name) = 0;
+    // Adds the component most recently opened by open_new_component() to the
+    // trace_index_t which close() writes next to the archive, recording that
+    // "instr_count" instructions precede it and that "timestamp" is in effect at its
+    // start.  Archives that were not asked to write an index ignore the call.
+    // Returns an empty string on success or a non-empty error description on
+    // failure.
+    std::string
+    index_component(uint64_t instr_count, uint64_t timestamp)
+    {
+        if (indexed_path_.empty())
+            return "";
+        return index_.add_entry({ instr_count, timestamp, component_offset_ });
+    }
+    // Finishes the archive, after which nothing more may be written, and then
+    // writes the index of the components passed to index_component().  The archive
+    // is also finished on destruction, but without writing the index.  Returns an
+    // empty string on success or a non-empty error description on failure.
+    std::string
+    close()
+    {
+        std::string error = close_archive();
+        if (!error.empty() || indexed_path_.empty() || index_.get_entries().empty())
+            return error;
+        return index_.write(indexed_path_);
+    }
+
+protected:
+    // Flushes and closes the underlying file.  Returns an empty string on success or
+    // a non-empty error description on failure.
+    virtual std::string
+    close_archive() = 0;
+
+    // Set by subclasses that write an index to the path of the archive.
+    std::string indexed_path_;
+    // Where the current component starts: see trace_index_entry_t::offset.
+    uint64_t component_offset_ = 0;
+
+private:
+    trace_index_t index_;
 };
 
 } // namespace drmemtrace
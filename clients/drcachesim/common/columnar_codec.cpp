@@ -0,0 +1,327 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "columnar_codec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+namespace {
+
+// The address predictions, kept identically by the encoder and the decoder.
+// The state is reset for each block so blocks can be decoded independently.
+class predictor_t {
+public:
+    predictor_t()
+        : slots_(NUM_SLOTS)
+    {
+    }
+    uint64_t
+    predict_pc() const
+    {
+        return next_pc_;
+    }
+    void
+    update_pc(uint64_t pc, unsigned short length)
+    {
+        cur_pc_ = pc;
+        next_pc_ = pc + length;
+        operand_ = 0;
+    }
+    // Looks up the stride state for the next data operand of the current
+    // instruction.
+    uint64_t
+    predict_data()
+    {
+        uint64_t key = (cur_pc_ << OPERAND_BITS) | operand_;
+        slot_ = &slots_[(key * 0x9e3779b97f4a7c15ULL) >> (64 - SLOT_BITS)];
+        if (slot_->valid && slot_->key == key)
+            return slot_->last_addr + slot_->stride;
+        slot_->valid = false;
+        slot_->key = key;
+        // With no history, the closest guess is the prior data address.
+        return last_data_;
+    }
+    void
+    update_data(uint64_t addr)
+    {
+        slot_->stride = slot_->valid ? addr - slot_->last_addr : 0;
+        slot_->last_addr = addr;
+        slot_->valid = true;
+        last_data_ = addr;
+        if (operand_ < (1 << OPERAND_BITS) - 1)
+            ++operand_;
+    }
+
+private:
+    static constexpr int SLOT_BITS = 14;
+    static constexpr int NUM_SLOTS = 1 << SLOT_BITS;
+    static constexpr int OPERAND_BITS = 3;
+    struct slot_t {
+        uint64_t key = 0;
+        uint64_t last_addr = 0;
+        uint64_t stride = 0;
+        bool valid = false;
+    };
+    std::vector<slot_t> slots_;
+    slot_t *slot_ = nullptr;
+    uint64_t cur_pc_ = 0;
+    uint64_t next_pc_ = 0;
+    uint64_t last_data_ = 0;
+    uint64_t operand_ = 0;
+};
+
+enum entry_class_t {
+    CLASS_PC,
+    CLASS_DATA,
+    CLASS_OTHER,
+};
+
+entry_class_t
+classify(unsigned short type)
+{
+    trace_type_t ttype = static_cast<trace_type_t>(type);
+    if (type_is_instr(ttype) || ttype == TRACE_TYPE_INSTR_NO_FETCH ||
+        ttype == TRACE_TYPE_INSTR_MAYBE_FETCH)
+        return CLASS_PC;
+    if (type_is_data(ttype))
+        return CLASS_DATA;
+    return CLASS_OTHER;
+}
+
+uint64_t
+zigzag(uint64_t delta)
+{
+    return (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+}
+
+uint64_t
+unzigzag(uint64_t val)
+{
+    return (val >> 1) ^ (~(val & 1) + 1);
+}
+
+void
+put_varint(std::vector<unsigned char> &column, uint64_t val)
+{
+    while (val >= 0x80) {
+        column.push_back(static_cast<unsigned char>(val | 0x80));
+        val >>= 7;
+    }
+    column.push_back(static_cast<unsigned char>(val));
+}
+
+// A bounds-checked reader of one decompressed column.
+class column_reader_t {
+public:
+    column_reader_t(const unsigned char *start, size_t size)
+        : cur_(start)
+        , end_(start + size)
+    {
+    }
+    bool
+    get_varint(uint64_t &val)
+    {
+        val = 0;
+        for (int shift = 0; shift < 64 && cur_ < end_; shift += 7) {
+            unsigned char byte = *cur_++;
+            val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+    bool
+    at_end() const
+    {
+        return cur_ == end_;
+    }
+
+private:
+    const unsigned char *cur_;
+    const unsigned char *end_;
+};
+
+} // namespace
+
+std::string
+columnar_encode_block(const trace_entry_t *entries, size_t count, std::vector<char> &out)
+{
+    if (count == 0)
+        return "";
+    if (count > COLUMNAR_BLOCK_ENTRIES)
+        return "Too many entries for one columnar block";
+    std::vector<unsigned char> columns[COLUMNAR_NUM_COLUMNS];
+    predictor_t predictor;
+    size_t run_start = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const trace_entry_t &entry = entries[i];
+        if (i > 0 && entry.type != entries[run_start].type) {
+            put_varint(columns[COLUMNAR_TYPE_RUNS], entries[run_start].type);
+            put_varint(columns[COLUMNAR_TYPE_RUNS], i - run_start);
+            run_start = i;
+        }
+        put_varint(columns[COLUMNAR_SIZES], entry.size);
+        uint64_t addr = entry.addr;
+        switch (classify(entry.type)) {
+        case CLASS_PC:
+            put_varint(columns[COLUMNAR_PC_DELTAS],
+                       zigzag(addr - predictor.predict_pc()));
+            predictor.update_pc(addr, entry.size);
+            break;
+        case CLASS_DATA:
+            put_varint(columns[COLUMNAR_DATA_DELTAS],
+                       zigzag(addr - predictor.predict_data()));
+            predictor.update_data(addr);
+            break;
+        case CLASS_OTHER: put_varint(columns[COLUMNAR_OTHER], addr); break;
+        }
+    }
+    put_varint(columns[COLUMNAR_TYPE_RUNS], entries[run_start].type);
+    put_varint(columns[COLUMNAR_TYPE_RUNS], count - run_start);
+
+    columnar_block_header_t header = {};
+    header.magic = COLUMNAR_BLOCK_MAGIC;
+    header.num_entries = static_cast<uint32_t>(count);
+    size_t header_offs = out.size();
+    out.resize(out.size() + sizeof(header));
+    for (int col = 0; col < COLUMNAR_NUM_COLUMNS; ++col) {
+        const std::vector<unsigned char> &column = columns[col];
+        header.raw_size[col] = static_cast<uint32_t>(column.size());
+        if (column.empty())
+            continue;
+        uLongf comp_size = compressBound(static_cast<uLong>(column.size()));
+        size_t offs = out.size();
+        out.resize(offs + comp_size);
+        if (compress2(reinterpret_cast<Bytef *>(&out[offs]), &comp_size, column.data(),
+                      static_cast<uLong>(column.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+            return "Failed to compress columnar block";
+        out.resize(offs + comp_size);
+        header.compressed_size[col] = static_cast<uint32_t>(comp_size);
+    }
+    memcpy(&out[header_offs], &header, sizeof(header));
+    return "";
+}
+
+size_t
+columnar_block_payload_size(const columnar_block_header_t &header)
+{
+    if (header.magic != COLUMNAR_BLOCK_MAGIC || header.num_entries == 0 ||
+        header.num_entries > COLUMNAR_BLOCK_ENTRIES)
+        return 0;
+    size_t size = 0;
+    for (int col = 0; col < COLUMNAR_NUM_COLUMNS; ++col)
+        size += header.compressed_size[col];
+    return size;
+}
+
+std::string
+columnar_decode_block(const columnar_block_header_t &header, const char *payload,
+                      std::vector<trace_entry_t> &entries)
+{
+    if (columnar_block_payload_size(header) == 0)
+        return "Invalid columnar block header";
+    std::vector<unsigned char> columns[COLUMNAR_NUM_COLUMNS];
+    for (int col = 0; col < COLUMNAR_NUM_COLUMNS; ++col) {
+        columns[col].resize(header.raw_size[col]);
+        if (header.raw_size[col] == 0) {
+            payload += header.compressed_size[col];
+            continue;
+        }
+        uLongf raw_size = header.raw_size[col];
+        if (uncompress(columns[col].data(), &raw_size,
+                       reinterpret_cast<const Bytef *>(payload),
+                       header.compressed_size[col]) != Z_OK ||
+            raw_size != header.raw_size[col])
+            return "Failed to decompress columnar block";
+        payload += header.compressed_size[col];
+    }
+    std::vector<column_reader_t> readers;
+    for (int col = 0; col < COLUMNAR_NUM_COLUMNS; ++col)
+        readers.emplace_back(columns[col].data(), columns[col].size());
+    entries.resize(header.num_entries);
+    predictor_t predictor;
+    size_t i = 0;
+    while (i < entries.size()) {
+        uint64_t type, run;
+        if (!readers[COLUMNAR_TYPE_RUNS].get_varint(type) ||
+            !readers[COLUMNAR_TYPE_RUNS].get_varint(run) || run == 0 ||
+            run > entries.size() - i)
+            return "Corrupt columnar type run";
+        entry_class_t cls = classify(static_cast<unsigned short>(type));
+        for (size_t end = i + run; i < end; ++i) {
+            trace_entry_t &entry = entries[i];
+            uint64_t size, val;
+            entry.type = static_cast<unsigned short>(type);
+            if (!readers[COLUMNAR_SIZES].get_varint(size))
+                return "Corrupt columnar size";
+            entry.size = static_cast<unsigned short>(size);
+            switch (cls) {
+            case CLASS_PC:
+                if (!readers[COLUMNAR_PC_DELTAS].get_varint(val))
+                    return "Corrupt columnar pc";
+                val = predictor.predict_pc() + unzigzag(val);
+                predictor.update_pc(val, entry.size);
+                break;
+            case CLASS_DATA:
+                if (!readers[COLUMNAR_DATA_DELTAS].get_varint(val))
+                    return "Corrupt columnar data address";
+                val = predictor.predict_data() + unzigzag(val);
+                predictor.update_data(val);
+                break;
+            case CLASS_OTHER:
+                if (!readers[COLUMNAR_OTHER].get_varint(val))
+                    return "Corrupt columnar address";
+                break;
+            }
+            entry.addr = static_cast<addr_t>(val);
+        }
+    }
+    for (int col = 0; col < COLUMNAR_NUM_COLUMNS; ++col) {
+        if (!readers[col].at_end())
+            return "Trailing data in columnar block";
+    }
+    return "";
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
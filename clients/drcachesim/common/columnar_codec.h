@@ -0,0 +1,113 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* columnar_codec: encodes blocks of trace_entry_t records as separate
+ * per-field streams for the columnar offline trace file format.
+ */
+
+#ifndef _COLUMNAR_CODEC_H_
+#define _COLUMNAR_CODEC_H_ 1
+
+#ifndef HAS_ZLIB
+#    error HAS_ZLIB is required
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// A columnar trace file is a sequence of self-contained blocks, each a
+// columnar_block_header_t followed by its compressed columns in
+// columnar_column_t order.  A reader can start decoding at any block.
+//
+// Within a block the records are split into:
+// + Runs of identical types.
+// + The size fields.
+// + Instruction addresses, as the difference from the end of the prior
+//   instruction, so straight-line code encodes as zeros.
+// + Data addresses, as the difference from the address predicted by the
+//   stride last seen at the same instruction and operand.
+// + All other address fields (markers, headers, encodings).
+// Integers are stored as variable-length (LEB128) values, signed ones
+// zigzag-encoded, and each column is then separately deflated.
+enum columnar_column_t {
+    COLUMNAR_TYPE_RUNS,
+    COLUMNAR_SIZES,
+    COLUMNAR_PC_DELTAS,
+    COLUMNAR_DATA_DELTAS,
+    COLUMNAR_OTHER,
+    COLUMNAR_NUM_COLUMNS,
+};
+
+// All fields are in host byte order, like trace_entry_t itself.
+struct columnar_block_header_t {
+    uint32_t magic;
+    uint32_t num_entries;
+    // The size of each column before and after compression.
+    uint32_t raw_size[COLUMNAR_NUM_COLUMNS];
+    uint32_t compressed_size[COLUMNAR_NUM_COLUMNS];
+};
+
+#define COLUMNAR_BLOCK_MAGIC 0x42434d44 /* "DMCB" */
+
+// The writers' block size in records.  Each block resets the stride state, so
+// larger blocks compress better while smaller ones let readers seek more finely.
+#define COLUMNAR_BLOCK_ENTRIES (256 * 1024)
+
+// Appends the encoding of "count" records, which must not exceed
+// COLUMNAR_BLOCK_ENTRIES, to "out".  Returns an empty string on success or an
+// error description on failure.
+std::string
+columnar_encode_block(const trace_entry_t *entries, size_t count, std::vector<char> &out);
+
+// Returns the number of compressed bytes following "header", or 0 if "header"
+// is not a valid block header.
+size_t
+columnar_block_payload_size(const columnar_block_header_t &header);
+
+// Decodes the "payload" following "header" into "entries".  Returns an empty
+// string on success or an error description on failure.
+std::string
+columnar_decode_block(const columnar_block_header_t &header, const char *payload,
+                      std::vector<trace_entry_t> &entries);
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _COLUMNAR_CODEC_H_ */
@@ -0,0 +1,156 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* columnar_istream_t: decodes the columnar trace format described in
+ * columnar_codec.h back into trace_entry_t records, matching the parts of
+ * the std::istream interface we use for file_reader_t.  Supports only
+ * limited seeking within the current block, plus seeking to the start of a
+ * block by its file offset.
+ */
+
+#ifndef _COLUMNAR_ISTREAM_H_
+#define _COLUMNAR_ISTREAM_H_ 1
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "columnar_codec.h"
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+/* The get area is the current decoded block. */
+class columnar_istreambuf_t : public std::basic_streambuf<char, std::char_traits<char>> {
+public:
+    explicit columnar_istreambuf_t(const std::string &path)
+    {
+        file_ = fopen(path.c_str(), "rb");
+    }
+    ~columnar_istreambuf_t() override
+    {
+        if (file_ != nullptr)
+            fclose(file_);
+    }
+    bool
+    is_open() const
+    {
+        return file_ != nullptr;
+    }
+    int
+    underflow() override
+    {
+        if (file_ == nullptr)
+            return traits_type::eof();
+        if (gptr() == egptr()) {
+            columnar_block_header_t header;
+            if (fread(&header, sizeof(header), 1, file_) != 1)
+                return traits_type::eof();
+            size_t size = columnar_block_payload_size(header);
+            if (size == 0)
+                return traits_type::eof();
+            payload_.resize(size);
+            if (fread(payload_.data(), 1, size, file_) != size ||
+                !columnar_decode_block(header, payload_.data(), entries_).empty())
+                return traits_type::eof();
+            char *start = reinterpret_cast<char *>(entries_.data());
+            setg(start, start, start + entries_.size() * sizeof(trace_entry_t));
+        }
+        return traits_type::to_int_type(*gptr());
+    }
+    std::iostream::pos_type
+    seekoff(std::iostream::off_type off, std::ios_base::seekdir dir,
+            std::ios_base::openmode which = std::ios_base::in) override
+    {
+        if (dir == std::ios_base::cur &&
+            ((off >= 0 && gptr() + off < egptr()) ||
+             (off < 0 && gptr() + off >= eback())))
+            gbump(static_cast<int>(off));
+        else {
+            // Unsupported!
+            return -1;
+        }
+        return gptr() - eback();
+    }
+    // Discards the current block and resumes decoding at the block starting at
+    // file offset "offset".  Returns false on failure.
+    bool
+    seek_to_block(uint64_t offset)
+    {
+        if (file_ == nullptr)
+            return false;
+        setg(nullptr, nullptr, nullptr);
+#ifdef WINDOWS
+        return _fseeki64(file_, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file_, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+private:
+    FILE *file_ = nullptr;
+    std::vector<char> payload_;
+    std::vector<trace_entry_t> entries_;
+};
+
+class columnar_istream_t : public std::istream {
+public:
+    explicit columnar_istream_t(const std::string &path)
+        : std::istream(new columnar_istreambuf_t(path))
+    {
+        if (!reinterpret_cast<columnar_istreambuf_t *>(rdbuf())->is_open())
+            setstate(std::ios::badbit);
+    }
+    ~columnar_istream_t() override
+    {
+        delete rdbuf();
+    }
+    bool
+    seek_to_block(uint64_t offset)
+    {
+        columnar_istreambuf_t *colbuf =
+            reinterpret_cast<columnar_istreambuf_t *>(rdbuf());
+        if (!colbuf->seek_to_block(offset))
+            return false;
+        clear();
+        return true;
+    }
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _COLUMNAR_ISTREAM_H_ */
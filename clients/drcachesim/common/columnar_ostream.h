@@ -0,0 +1,179 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* columnar_ostream_t: writes trace_entry_t records in the columnar format
+ * described in columnar_codec.h, matching the parts of the std::ostream
+ * interface we use for raw2trace.  Archive components are not separately
+ * named: each starts a new block, which a reader can start decoding at.
+ */
+
+#ifndef _COLUMNAR_OSTREAM_H_
+#define _COLUMNAR_OSTREAM_H_ 1
+
+#include <stdio.h>
+#include <string.h>
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "archive_ostream.h"
+#include "columnar_codec.h"
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+/* The put area holds one block's worth of records.  A block is only ended
+ * early at a component boundary: a plain flush does not end one, as small
+ * blocks compress poorly.
+ */
+class columnar_ostreambuf_t : public std::basic_streambuf<char, std::char_traits<char>> {
+public:
+    explicit columnar_ostreambuf_t(const std::string &path)
+        : buf_(COLUMNAR_BLOCK_ENTRIES * sizeof(trace_entry_t))
+    {
+        file_ = fopen(path.c_str(), "wb");
+        if (file_ != nullptr)
+            setp(buf_.data(), buf_.data() + buf_.size());
+    }
+    ~columnar_ostreambuf_t() override
+    {
+        close();
+    }
+    // Writes the final block and closes the file.  Returns an empty string on
+    // success or a non-empty error description on failure.
+    std::string
+    close()
+    {
+        if (file_ == nullptr)
+            return "";
+        bool ok = write_block();
+        ok = fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok ? "" : "Failed to close columnar file";
+    }
+    bool
+    is_open() const
+    {
+        return file_ != nullptr;
+    }
+    int
+    overflow(int extra_char) override
+    {
+        if (file_ == nullptr || !write_block())
+            return traits_type::eof();
+        if (extra_char != traits_type::eof()) {
+            *pptr() = traits_type::to_char_type(extra_char);
+            pbump(1);
+        }
+        return traits_type::not_eof(extra_char);
+    }
+    // Ends the current block and sets "offset" to the file offset of the next.
+    std::string
+    open_new_component(uint64_t &offset)
+    {
+        if (file_ == nullptr)
+            return "Failed to open columnar file";
+        if (!write_block())
+            return "Failed to write prior component";
+        offset = bytes_written_;
+        return "";
+    }
+
+private:
+    // Encodes the complete records in the buffer as one block, keeping any
+    // trailing partial record for the next block.
+    bool
+    write_block()
+    {
+        size_t used = pptr() - pbase();
+        size_t whole = used - used % sizeof(trace_entry_t);
+        if (whole > 0) {
+            encoded_.clear();
+            if (!columnar_encode_block(reinterpret_cast<trace_entry_t *>(pbase()),
+                                       whole / sizeof(trace_entry_t), encoded_)
+                     .empty())
+                return false;
+            if (fwrite(encoded_.data(), 1, encoded_.size(), file_) != encoded_.size())
+                return false;
+            bytes_written_ += encoded_.size();
+        }
+        memmove(buf_.data(), buf_.data() + whole, used - whole);
+        setp(buf_.data(), buf_.data() + buf_.size());
+        pbump(static_cast<int>(used - whole));
+        return true;
+    }
+
+    FILE *file_ = nullptr;
+    std::vector<char> buf_;
+    std::vector<char> encoded_;
+    uint64_t bytes_written_ = 0;
+};
+
+class columnar_ostream_t : public archive_ostream_t {
+public:
+    // If "write_index" is set, close() writes the components passed to
+    // index_component() next to the file.
+    explicit columnar_ostream_t(const std::string &path, bool write_index = false)
+        : archive_ostream_t(new columnar_ostreambuf_t(path))
+    {
+        if (!reinterpret_cast<columnar_ostreambuf_t *>(rdbuf())->is_open())
+            setstate(std::ios::badbit);
+        if (write_index)
+            indexed_path_ = path;
+    }
+    ~columnar_ostream_t() override
+    {
+        delete rdbuf();
+    }
+    // The name is ignored: components are only reachable through the index.
+    std::string
+    open_new_component(const std::string &name) override
+    {
+        columnar_ostreambuf_t *colbuf =
+            reinterpret_cast<columnar_ostreambuf_t *>(rdbuf());
+        return colbuf->open_new_component(component_offset_);
+    }
+
+protected:
+    std::string
+    close_archive() override
+    {
+        return reinterpret_cast<columnar_ostreambuf_t *>(rdbuf())->close();
+    }
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _COLUMNAR_OSTREAM_H_ */
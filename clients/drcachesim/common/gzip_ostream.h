@@ -32,7 +32,8 @@
 
 /* gzip_ostream_t: a wrapper around zlib gzFile to match the parts of the
  * std::ostream interface we use for raw2trace and file_reader_t.
- * Seeking is not supported.
+ * Seeking is not supported.  Archive components are not separately named:
+ * each starts at a full-flush point, which a reader can start inflating at.
  */
 
 #ifndef _GZIP_OSTREAM_H_
@@ -44,6 +45,8 @@
 #include <fstream>
 #include <zlib.h>
 
+#include "archive_ostream.h"
+
 namespace dynamorio {
 namespace drmemtrace {
 
@@ -65,10 +68,19 @@ public:
     }
     ~gzip_streambuf_t() override
     {
-        sync();
+        close();
         delete[] buf_;
-        if (file_ != nullptr)
-            gzclose(file_);
+    }
+    // Returns an empty string on success or a non-empty error description on failure.
+    std::string
+    close()
+    {
+        if (file_ == nullptr)
+            return "";
+        bool ok = sync() != traits_type::eof();
+        ok = gzclose(file_) == Z_OK && ok;
+        file_ = nullptr;
+        return ok ? "" : "Failed to close gzip file";
     }
     int
     overflow(int extra_char) override
@@ -95,25 +107,62 @@ public:
     {
         return overflow(traits_type::eof());
     }
+    // Ends the prior component with a full flush so that the new one does not
+    // refer back to it and sets "offset" to the new component's file offset.
+    std::string
+    open_new_component(uint64_t &offset)
+    {
+        if (file_ == nullptr)
+            return "Failed to open gzip file";
+        if (sync() == traits_type::eof())
+            return "Failed to write prior component";
+        if (!first_component_ && gzflush(file_, Z_FULL_FLUSH) != Z_OK)
+            return "Failed to flush prior component";
+        first_component_ = false;
+        z_off_t res = gzoffset(file_);
+        if (res < 0)
+            return "Failed to query the gzip file offset";
+        offset = static_cast<uint64_t>(res);
+        return "";
+    }
 
 private:
     static const int buffer_size_ = 4096;
     gzFile file_ = nullptr;
+    bool first_component_ = true;
     char *buf_ = nullptr;
 };
 
-class gzip_ostream_t : public std::ostream {
+class gzip_ostream_t : public archive_ostream_t {
 public:
-    explicit gzip_ostream_t(const std::string &path)
-        : std::ostream(new gzip_streambuf_t(path))
+    // If "write_index" is set, close() writes the components passed to
+    // index_component() next to the file.
+    explicit gzip_ostream_t(const std::string &path, bool write_index = false)
+        : archive_ostream_t(new gzip_streambuf_t(path))
     {
         if (!rdbuf())
             setstate(std::ios::badbit);
+        if (write_index)
+            indexed_path_ = path;
     }
     ~gzip_ostream_t() override
     {
         delete rdbuf();
     }
+    // The name is ignored: components are only reachable through the index.
+    std::string
+    open_new_component(const std::string &name) override
+    {
+        gzip_streambuf_t *gzbuf = reinterpret_cast<gzip_streambuf_t *>(rdbuf());
+        return gzbuf->open_new_component(component_offset_);
+    }
+
+protected:
+    std::string
+    close_archive() override
+    {
+        return reinterpret_cast<gzip_streambuf_t *>(rdbuf())->close();
+    }
 };
 
 } // namespace drmemtrace
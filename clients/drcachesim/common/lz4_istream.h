@@ -32,7 +32,8 @@
 
 /* lz4_istream_t: a wrapper around lz4 to match the parts of the
  * std::istream interface we use for raw2trace and file_reader_t.
- * Supports only limited seeking within the current internal buffer.
+ * Supports only limited seeking within the current internal buffer, plus
+ * seeking to the start of a frame by its file offset.
  */
 
 #ifndef _LZ4_ISTREAM_H_
@@ -41,6 +42,9 @@
 #ifndef HAS_LZ4
 #    error HAS_LZ4 is required
 #endif
+#include <stdint.h>
+#include <stdio.h>
+
 #include <fstream>
 #include <lz4frame.h>
 #include <iostream>
@@ -121,6 +125,26 @@ public:
         }
         return gptr() - eback();
     }
+    // Discards buffered data and resumes decompressing at the frame starting at
+    // file offset "offset".  Returns false on failure.
+    bool
+    seek_to_frame(uint64_t offset)
+    {
+        if (file_ == nullptr)
+            return false;
+        // Start over in case the prior frame was not finished.
+        LZ4F_freeDecompressionContext(lzcxt_);
+        lzcxt_ = nullptr;
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&lzcxt_, LZ4F_VERSION)))
+            return false;
+        src_left_ = 0;
+        setg(buf_uncompressed_, buf_uncompressed_, buf_uncompressed_);
+#ifdef WINDOWS
+        return _fseeki64(file_, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file_, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
 
 private:
     static const int buffer_size_ = 1024 * 1024;
@@ -144,6 +168,15 @@ public:
     {
         delete rdbuf();
     }
+    bool
+    seek_to_frame(uint64_t offset)
+    {
+        lz4_istreambuf_t *lzbuf = reinterpret_cast<lz4_istreambuf_t *>(rdbuf());
+        if (!lzbuf->seek_to_frame(offset))
+            return false;
+        clear();
+        return true;
+    }
 };
 
 } // namespace drmemtrace
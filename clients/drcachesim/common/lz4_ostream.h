@@ -32,6 +32,8 @@
 
 /* lz4_ostream_t: a wrapper around lz4 to match the parts of the
  * std::ostream interface we use for raw2trace and file_reader_t.
+ * Archive components are not separately named: each is its own lz4 frame,
+ * which a reader can start decompressing at.
  */
 
 #ifndef _LZ4_OSTREAM_H_
@@ -46,6 +48,8 @@
 #include <vector>
 #include <lz4frame.h>
 
+#include "archive_ostream.h"
+
 namespace dynamorio {
 namespace drmemtrace {
 
@@ -69,15 +73,44 @@ public:
 
     ~lz4_ostreambuf_t()
     {
-        sync();
-        write_footer();
-        if (file_ != nullptr) {
-            delete file_;
-            file_ = nullptr;
-        }
+        close();
         LZ4F_freeCompressionContext(lzctx_);
     }
 
+    // Ends the final frame and closes the file.  Returns an empty string on success
+    // or a non-empty error description on failure.
+    std::string
+    close()
+    {
+        if (file_ == nullptr)
+            return "";
+        bool ok = sync() != traits_type::eof() && write_footer() && file_->flush();
+        delete file_;
+        file_ = nullptr;
+        return ok ? "" : "Failed to close lz4 file";
+    }
+
+    // Ends the prior component's frame and starts a new frame, setting "offset" to
+    // its file offset.
+    std::string
+    open_new_component(uint64_t &offset)
+    {
+        if (file_ == nullptr)
+            return "Failed to open lz4 file";
+        if (first_component_) {
+            // The constructor already started the first frame.
+            first_component_ = false;
+            offset = 0;
+            return "";
+        }
+        if (sync() == traits_type::eof() || !write_footer())
+            return "Failed to end prior component";
+        offset = bytes_written_;
+        if (!write_header())
+            return "Failed to start new component";
+        return "";
+    }
+
 private:
     int
     overflow(int extra_char) override
@@ -99,6 +132,7 @@ private:
         }
 
         file_->write(&dest_buf_.front(), ret);
+        bytes_written_ += ret;
         return traits_type::not_eof(extra_char);
     }
 
@@ -108,26 +142,30 @@ private:
         return overflow(traits_type::eof());
     }
 
-    void
+    bool
     write_header()
     {
         auto res =
             LZ4F_compressBegin(lzctx_, &dest_buf_.front(), dest_buf_.capacity(), nullptr);
         if (LZ4F_isError(res)) {
-            return;
+            return false;
         }
         file_->write(&dest_buf_.front(), res);
+        bytes_written_ += res;
+        return static_cast<bool>(*file_);
     }
 
-    void
+    bool
     write_footer()
     {
         auto res =
             LZ4F_compressEnd(lzctx_, &dest_buf_.front(), dest_buf_.capacity(), nullptr);
         if (LZ4F_isError(res)) {
-            return;
+            return false;
         }
         file_->write(&dest_buf_.front(), res);
+        bytes_written_ += res;
+        return static_cast<bool>(*file_);
     }
 
 private:
@@ -136,21 +174,42 @@ private:
     std::array<char, buffer_size_> src_buf_;
     std::vector<char> dest_buf_;
     LZ4F_compressionContext_t lzctx_ = nullptr;
+    uint64_t bytes_written_ = 0;
+    bool first_component_ = true;
 };
 
-class lz4_ostream_t : public std::ostream {
+class lz4_ostream_t : public archive_ostream_t {
 public:
-    explicit lz4_ostream_t(const std::string &path)
-        : std::ostream(new lz4_ostreambuf_t(path))
+    // If "write_index" is set, close() writes the components passed to
+    // index_component() next to the file.
+    explicit lz4_ostream_t(const std::string &path, bool write_index = false)
+        : archive_ostream_t(new lz4_ostreambuf_t(path))
     {
         if (!rdbuf())
             setstate(std::ios::badbit);
+        if (write_index)
+            indexed_path_ = path;
     }
 
     ~lz4_ostream_t() override
     {
         delete rdbuf();
     }
+
+    // The name is ignored: components are only reachable through the index.
+    std::string
+    open_new_component(const std::string &name) override
+    {
+        lz4_ostreambuf_t *lzbuf = reinterpret_cast<lz4_ostreambuf_t *>(rdbuf());
+        return lzbuf->open_new_component(component_offset_);
+    }
+
+protected:
+    std::string
+    close_archive() override
+    {
+        return reinterpret_cast<lz4_ostreambuf_t *>(rdbuf())->close();
+    }
 };
 
 } // namespace drmemtrace
@@ -49,6 +49,8 @@
 #include <string>
 #include <unordered_map>
 
+#include "trace_entry.h"
+
 /**
  * @file drmemtrace/memtrace_stream.h
  * @brief DrMemtrace interface for obtaining information from analysis
@@ -240,6 +242,56 @@ public:
     {
         return false;
     }
+
+    /**
+     * Statistics on scheduler decisions, for use with get_schedule_statistic().
+     */
+    enum schedule_statistic_t {
+        /**
+         * Count of times an input started running on this output after last running
+         * on a different output.
+         */
+        SCHED_STAT_MIGRATIONS,
+        /** Count of inputs this output took from another output's ready queue. */
+        SCHED_STAT_RUNQUEUE_STEALS,
+        /** Count of times this output rebalanced all of the ready queues. */
+        SCHED_STAT_RUNQUEUE_REBALANCES,
+        /** Count of statistic types. */
+        SCHED_STAT_TYPE_COUNT,
+    };
+
+    /**
+     * Returns the value of the specified statistic for this output stream.
+     * If not implemented for the current mode, -1 is returned.
+     */
+    virtual int64_t
+    get_schedule_statistic(schedule_statistic_t stat) const
+    {
+        return -1;
+    }
+
+    /**
+     * Starts supplying records down a speculative path beginning at
+     * "start_address", such as the fall-through of a mispredicted branch.  The
+     * following records come from the scheduler's speculator rather than the
+     * trace, until end_speculation() resumes the trace with the record after the
+     * current one.  Returns false if this stream does not support speculation.
+     */
+    virtual bool
+    begin_speculation(addr_t start_address)
+    {
+        return false;
+    }
+
+    /**
+     * Ends the speculative path started by begin_speculation().  Returns false if
+     * this stream is not speculating.
+     */
+    virtual bool
+    end_speculation()
+    {
+        return false;
+    }
 };
 
 /**
@@ -68,6 +68,18 @@ droption_t<std::string> op_ipc_name(
     "for each instance of the simulator being run at any one time.  On Windows, the name "
     "is limited to 247 characters.");
 
+droption_t<bytesize_t> op_ipc_ring_size(
+    DROPTION_SCOPE_ALL, "ipc_ring_size", 0, "Size of shared-memory trace ring",
+    "For online tracing and simulation, if non-zero, the trace is sent from the target "
+    "application processes to the simulator through a shared-memory ring buffer of "
+    "this size rather than through the -ipc_name named pipe.  The application threads "
+    "copy their entries directly into the ring and the simulator consumes them in "
+    "place, avoiding a system call per buffer in the common case.  The ring is "
+    "created under /dev/shm using -ipc_name, or at -ipc_name with a .shm suffix if "
+    "that is an absolute path.  A target process that dies without detaching, such "
+    "as from SIGKILL, is noticed by the simulator within about a second, unless more "
+    "than 64 processes are attached at once.  This is only supported on Linux.");
+
 droption_t<std::string> op_outdir(
     DROPTION_SCOPE_ALL, "outdir", ".", "Target directory for offline trace files",
     "For the offline analysis mode (when -offline is requested), specifies the path "
@@ -110,6 +122,84 @@ droption_t<std::string>
                   "cache misses being written, to save data.",
                   "");
 
+droption_t<std::string> op_cachesim_row_format(
+    DROPTION_SCOPE_ALL, "cachesim_row_format", "columnar",
+    "Output format for the missing_instructions rows: columnar or sqlite.",
+    "Selects how the missing_instructions tool writes its per-memref rows. "
+    "\"columnar\" writes a block-compressed binary file with one fixed-width chunk "
+    "per column and a dictionary-encoded disassembly column; it can be converted "
+    "offline to a SQLite database or a CSV file with the cachesim_row_convert tool. "
+    "\"sqlite\" inserts every row directly into a SQLite database, which is "
+    "considerably slower for long traces.");
+
+droption_t<std::string> op_cache_sweep_configs(
+    DROPTION_SCOPE_FRONTEND, "cache_sweep_configs", "",
+    "For the cache_sweep simulator: the cache configurations to simulate.",
+    "A list of cache configurations separated by ';', each a ','-separated list of "
+    "knob=value overrides of the regular cache knobs, e.g., "
+    "\"L1D_size=32K,LL_size=1M;L1D_size=64K,LL_size=2M\".  Supported knobs: "
+    "L1I_size, L1D_size, LL_size, L1I_assoc, L1D_assoc, LL_assoc, "
+    "LL_set_sample_rate, line_size, "
+    "num_cores, replace_policy, data_prefetcher, prefetch_degree, "
+    "prefetch_queue_size and prefetch_table_size.  The trace is decoded once and "
+    "each configuration is simulated by its own cache hierarchy, with one row per "
+    "configuration appended to sweep_experiments.csv under -cache_trace_log_path.");
+
+droption_t<unsigned int> op_cache_sweep_threads(
+    DROPTION_SCOPE_FRONTEND, "cache_sweep_threads", 0,
+    "For the cache_sweep simulator: the number of simulation threads.",
+    "The number of worker threads used to simulate the -cache_sweep_configs "
+    "configurations.  0 uses one thread per hardware thread.  The count is capped "
+    "at the number of configurations.");
+
+droption_t<bytesize_t> op_miss_curve_L1_min_size(
+    DROPTION_SCOPE_FRONTEND, "miss_curve_L1_min_size", bytesize_t(1024),
+    "For the miss_ratio_curve simulator: the smallest L1 size.",
+    "The smallest total L1 cache size whose miss rate is reported by the "
+    "miss_ratio_curve simulator.  Every power-of-two size between this and "
+    "-miss_curve_L1_max_size is covered.");
+
+droption_t<bytesize_t> op_miss_curve_L1_max_size(
+    DROPTION_SCOPE_FRONTEND, "miss_curve_L1_max_size", bytesize_t(1024 * 1024),
+    "For the miss_ratio_curve simulator: the largest L1 size.",
+    "The largest total L1 cache size whose miss rate is reported by the "
+    "miss_ratio_curve simulator.");
+
+droption_t<bytesize_t> op_miss_curve_LL_min_size(
+    DROPTION_SCOPE_FRONTEND, "miss_curve_LL_min_size", bytesize_t(64 * 1024),
+    "For the miss_ratio_curve simulator: the smallest LL size.",
+    "The smallest total last-level cache size whose miss rate is reported by the "
+    "miss_ratio_curve simulator.  Every power-of-two size between this and "
+    "-miss_curve_LL_max_size is covered.  The LL sees the misses of the L1 caches "
+    "configured with -L1I_size, -L1I_assoc, -L1D_size and -L1D_assoc.");
+
+droption_t<bytesize_t> op_miss_curve_LL_max_size(
+    DROPTION_SCOPE_FRONTEND, "miss_curve_LL_max_size", bytesize_t(64 * 1024 * 1024),
+    "For the miss_ratio_curve simulator: the largest LL size.",
+    "The largest total last-level cache size whose miss rate is reported by the "
+    "miss_ratio_curve simulator.");
+
+droption_t<unsigned int> op_miss_curve_min_assoc(
+    DROPTION_SCOPE_FRONTEND, "miss_curve_min_assoc", 1,
+    "For the miss_ratio_curve simulator: the smallest associativity.",
+    "The smallest associativity whose miss rates are reported by the "
+    "miss_ratio_curve simulator.  Every power-of-two associativity between this and "
+    "-miss_curve_max_assoc is covered.");
+
+droption_t<unsigned int> op_miss_curve_max_assoc(
+    DROPTION_SCOPE_FRONTEND, "miss_curve_max_assoc", 16,
+    "For the miss_ratio_curve simulator: the largest associativity.",
+    "The largest associativity whose miss rates are reported by the "
+    "miss_ratio_curve simulator.  The per-access cost grows with this value.");
+
+droption_t<std::string> op_opt_miss_bound_dir(
+    DROPTION_SCOPE_FRONTEND, "opt_miss_bound_dir", "",
+    "For the opt_miss_bound simulator: directory for its index files.",
+    "The opt_miss_bound simulator records the LL access stream, 16 bytes per "
+    "access, and a next-use index of 8 bytes per access to files that are removed "
+    "once the results are computed.  They are created in this directory, or as "
+    "anonymous temporary files if it is empty.");
+
 droption_t<std::string> op_infile(
     DROPTION_SCOPE_ALL, "infile", "", "Offline legacy file for input to the simulator",
     "Directs the simulator to use a single all-threads-interleaved-into-one trace "
@@ -155,11 +245,25 @@ droption_t<bytesize_t> op_chunk_instr_count(
 #endif
     "Chunk instruction count",
     "Specifies the size in instructions of the chunks into which a trace output file "
-    "is split inside a zipfile.  This is the granularity of a fast seek. "
-    "This only applies when generating .zip-format traces; when built without "
-    "support for writing .zip files, this option is ignored. "
+    "is split inside a zipfile, or between full-flush points or frames of a gzip or "
+    "lz4 file when -chunk_index is set.  This is the granularity of a fast seek. "
+    "This only applies when generating compressed traces; when built without "
+    "support for writing the chosen format, this option is ignored. "
     "For 32-bit this cannot exceed 4G.");
 
+droption_t<bool> op_chunk_index(
+    DROPTION_SCOPE_FRONTEND, "chunk_index", false,
+    "Write a chunk index next to each compressed trace file",
+    "When post-processing generates compressed trace files, also write a "
+    "table of each file's chunks (see -chunk_instr_count) to a file with the trace "
+    "file's path plus \".idx\", which -skip_instrs and -split_chunks use to seek "
+    "directly to a chunk.  As seeking needs self-contained chunks, this also changes "
+    "the .gz and .lz4 file layout: each chunk after the first starts at a full-flush "
+    "point (gzip) or a new frame (lz4) and repeats the chunk header and instruction "
+    "encodings, with a chunk footer ending the prior chunk as inside a zipfile.  "
+    "The files remain readable without the index, which is ignored if it was written "
+    "for a trace file of a different size.");
+
 droption_t<bool> op_instr_encodings(
     DROPTION_SCOPE_CLIENT, "instr_encodings", false,
     "Whether to include encodings for online tools",
@@ -220,6 +324,18 @@ droption_t<unsigned int>
                 "Specifies the associativity of the unified last-level (L2) cache. "
                 "LL_size/LL_assoc must be a power of 2 and a multiple of line_size.");
 
+droption_t<unsigned int> op_LL_set_sample_rate(
+    DROPTION_SCOPE_FRONTEND, "LL_set_sample_rate", 1,
+    "Simulate about one in this many last-level cache sets",
+    "When larger than 1, the last-level cache only simulates about one in this many "
+    "of its sets, selected by a hash of the set index, and drops accesses to the "
+    "others.  The reported last-level counts are scaled up to the whole cache and the "
+    "miss rate is printed with the half-width of its 95% confidence interval.  This "
+    "makes large last-level caches considerably cheaper to simulate.  Compulsory "
+    "misses are estimated the same way.  The L1 caches are always fully simulated.  "
+    "With -config_file, set the LL_set_sample_rate parameter in the file instead: it "
+    "then applies to each cache whose parent is memory.");
+
 droption_t<std::string> op_LL_miss_file(
     DROPTION_SCOPE_FRONTEND, "LL_miss_file", "",
     "Path for dumping LLC misses or prefetching hints",
@@ -410,11 +526,26 @@ droption_t<std::string> op_raw_compress(
     "for an SSD, zlib and gzip typically add overhead and would only be used if space is "
     "at a premium; snappy_nocrc and lz4 are nearly always performance wins.");
 
+droption_t<unsigned int> op_raw_compress_threads(
+    DROPTION_SCOPE_CLIENT, "raw_compress_threads", 0,
+    "Client threads compressing raw offline files",
+    "If non-zero, the -raw_compress compression and the writing of raw offline files "
+    "are moved off of the application threads onto this many client threads.  A full "
+    "trace buffer is copied into one of two staging buffers per application thread "
+    "and the thread continues executing while the other staging buffer is compressed; "
+    "it only waits when both are still being compressed.  Each application thread's "
+    "data is always handled by the same client thread, preserving its order.  This is "
+    "ignored for -raw_compress none and when drmemtrace_buffer_handoff() is used.");
+
 droption_t<std::string> op_trace_compress(
     DROPTION_SCOPE_FRONTEND, "compress", DEFAULT_TRACE_COMPRESSION_TYPE,
-    "Trace compression: \"zip\",\"gzip\",\"zlib\",\"lz4\",\"none\"",
+    "Trace compression: \"zip\",\"gzip\",\"zlib\",\"lz4\",\"columnar\",\"none\"",
     "Specifies the compression type to use for trace files: \"zip\", "
-    "\"gzip\", \"zlib\", \"lz4\", or \"none\". "
+    "\"gzip\", \"zlib\", \"lz4\", \"columnar\", or \"none\". "
+    "The columnar format splits each block of records into separate streams of "
+    "types, sizes, instruction address deltas, and per-instruction data address "
+    "strides before compressing each one, which is usually much smaller than the "
+    "other choices for regular memory access patterns. "
     "In most cases where fast skipping by instruction count is not needed "
     "lz4 compression generally improves performance and is recommended. "
     "When it comes to storage types, the impact on overhead varies: "
@@ -430,18 +561,49 @@ droption_t<bool> op_online_instr_types(
 
 droption_t<std::string> op_replace_policy(
     DROPTION_SCOPE_FRONTEND, "replace_policy", REPLACE_POLICY_LRU,
-    "Cache replacement policy (LRU, LFU, FIFO)",
+    "Cache replacement policy (LRU, LFU, FIFO, SRRIP, BRRIP, DRRIP, SHIP, HAWKEYE)",
     "Specifies the replacement policy for "
     "caches. Supported policies: LRU (Least Recently Used), LFU (Least Frequently Used), "
-    "FIFO (First-In-First-Out).");
+    "FIFO (First-In-First-Out), SRRIP (Static Re-Reference Interval Prediction), "
+    "BRRIP (Bimodal RRIP), DRRIP (Dynamic RRIP, set dueling between SRRIP and "
+    "BRRIP), SHIP (Signature-based Hit Predictor on top of SRRIP, keyed by PC) and "
+    "HAWKEYE (RRIP guided by a PC predictor trained on Belady's optimal decisions "
+    "for a sample of the sets).");
 
 droption_t<std::string> op_data_prefetcher(
     DROPTION_SCOPE_FRONTEND, "data_prefetcher", PREFETCH_POLICY_NEXTLINE,
-    "Hardware data prefetcher policy (nextline, none)",
+    "Hardware data prefetcher policy (nextline, stride, stream, ghb, none)",
     "Specifies the hardware data "
     "prefetcher policy.  The currently supported policies are 'nextline' (fetch the "
-    "subsequent cache line) and 'none' (disables hardware prefetching).  The prefetcher "
-    "is located between the L1D and LL caches.");
+    "subsequent cache line), 'stride' (a per-PC stride table), 'stream' (a detector "
+    "of multiple ascending or descending streams of lines), 'ghb' (a global history "
+    "buffer correlating consecutive miss deltas) and 'none' (disables hardware "
+    "prefetching).  The prefetcher is located between the L1D and LL caches.  "
+    "The stride, stream and ghb prefetchers queue the lines they predict and issue "
+    "one per demand access; see -prefetch_degree, -prefetch_queue_size and "
+    "-prefetch_table_size.  For these the accuracy, coverage and timeliness of "
+    "the prefetches are printed with the L1D statistics.");
+
+droption_t<unsigned int> op_prefetch_degree(
+    DROPTION_SCOPE_FRONTEND, "prefetch_degree", 4,
+    "Lines predicted per prefetcher trigger",
+    "For the stride, stream and ghb values of -data_prefetcher, the number of lines "
+    "ahead of the current access that each trigger predicts.");
+
+droption_t<unsigned int> op_prefetch_queue_size(
+    DROPTION_SCOPE_FRONTEND, "prefetch_queue_size", 16,
+    "Entries in the prefetch queue",
+    "For the stride, stream and ghb values of -data_prefetcher, the number of "
+    "predicted lines waiting to be issued.  One queued prefetch is issued per demand "
+    "access and the oldest is dropped when the queue is full.  A demand miss on a "
+    "queued line counts as a late prefetch.");
+
+droption_t<unsigned int> op_prefetch_table_size(
+    DROPTION_SCOPE_FRONTEND, "prefetch_table_size", 64,
+    "Entries in the prefetcher's tables",
+    "For -data_prefetcher stride this is the number of PCs tracked, for stream the "
+    "number of streams, and for ghb the number of entries in the global history "
+    "buffer and in its index table.");
 
 droption_t<bytesize_t> op_page_size(DROPTION_SCOPE_FRONTEND, "page_size",
                                     bytesize_t(4 * 1024), "Virtual/physical page size",
@@ -481,8 +643,9 @@ droption_t<std::string>
 droption_t<std::string>
     op_simulator_type(DROPTION_SCOPE_FRONTEND, "simulator_type", CPU_CACHE,
                       "Specifies the types of simulators, separated by a colon (\":\").",
-                      "Predefined types: " CPU_CACHE ", " MISS_ANALYZER ", " TLB
-                      ", " REUSE_DIST ", " REUSE_TIME ", " HISTOGRAM
+                      "Predefined types: " CPU_CACHE ", " MISS_ANALYZER ", " CACHE_SWEEP
+                      ", " MISS_RATIO_CURVE ", " OPT_MISS_BOUND
+                      ", " TLB ", " REUSE_DIST ", " REUSE_TIME ", " HISTOGRAM
                       ", " MISSING_INSTRUCTIONS ", " BASIC_COUNTS ", " INVARIANT_CHECKER
                       ", or " SCHEDULE_STATS
                       ". The external types: name of a tool identified by a "
@@ -557,8 +720,9 @@ droption_t<bytesize_t> op_skip_instrs(
     "analysis.  For serial iteration, this number is "
     "computed just once across the interleaving sequence of all threads; for parallel "
     "iteration, each thread skips this many insructions.  When built with zipfile "
-    "support, this skipping is optimized and large instruction counts can be quickly "
-    "skipped; this is not the case for -skip_refs.");
+    "support, or for gzip or lz4 traces with a chunk index, this skipping is optimized "
+    "and large instruction counts can be quickly skipped; this is not the case for "
+    "-skip_refs.");
 
 droption_t<bytesize_t>
     op_skip_refs(DROPTION_SCOPE_FRONTEND, "skip_refs", 0,
@@ -607,6 +771,54 @@ droption_t<bytesize_t>
                 "The simulated references come after the skipped and warmup references, "
                 "and the references following the simulated ones are dropped.");
 
+droption_t<bytesize_t> op_sample_period_refs(
+    DROPTION_SCOPE_FRONTEND, "sample_period_refs", 0,
+    "Length in memory references of each periodic sampling period",
+    "Enables periodic (SMARTS-style) sampling for the cache simulator when non-zero.  "
+    "The trace after the skipped references is divided into periods of this many "
+    "references.  Each period ends with -sample_warmup_refs references of detailed "
+    "warmup followed by a measurement unit of -sample_unit_refs references; the "
+    "rest of the period only updates cache tags and replacement state (functional "
+    "warming), which is cheaper than full simulation.  Detailed warmup additionally "
+    "runs the hardware prefetchers.  Statistics are only gathered in measurement "
+    "units, and each cache also reports its miss rate over the units with the "
+    "half-width of a 95% confidence interval derived from the variance across "
+    "units.  This flag is incompatible with -warmup_refs and -warmup_fraction.");
+
+droption_t<bytesize_t> op_sample_warmup_refs(
+    DROPTION_SCOPE_FRONTEND, "sample_warmup_refs", 2000,
+    "Detailed warmup references before each periodic sampling unit",
+    "Specifies the number of memory references simulated in detail, but without "
+    "gathering statistics, before each measurement unit when -sample_period_refs "
+    "is set.");
+
+droption_t<bytesize_t> op_sample_unit_refs(
+    DROPTION_SCOPE_FRONTEND, "sample_unit_refs", 10000,
+    "Memory references in each periodic sampling measurement unit",
+    "Specifies the number of memory references measured in each period when "
+    "-sample_period_refs is set.");
+
+droption_t<std::string> op_speculate(
+    DROPTION_SCOPE_FRONTEND, "speculate", "",
+    "Simulate wrong-path fetches of the given kind",
+    "When non-empty, the cache and TLB simulators model a static not-taken branch "
+    "predictor: after each taken conditional branch they fetch -speculate_instrs "
+    "instructions down the mispredicted fall-through path before resuming the trace.  "
+    "The value selects where those wrong-path instructions come from: 'nops' supplies "
+    "no-ops; 'last' replays the instruction and data addresses last seen in the trace "
+    "at each PC; 'average' is like 'last' but uses a recency-weighted average of the "
+    "last few data addresses; 'binary' decodes the instructions from the traced "
+    "binaries listed in -module_file (or found next to the trace).  PCs that cannot "
+    "be supplied fall back to no-ops.  Wrong-path references are simulated and "
+    "counted like any others, including toward -skip_refs, -warmup_refs and "
+    "-sim_refs.  This is not supported with -config_file.");
+
+droption_t<unsigned int> op_speculate_instrs(
+    DROPTION_SCOPE_FRONTEND, "speculate_instrs", 16,
+    "Instructions fetched down each mispredicted path",
+    "Specifies the number of wrong-path instructions simulated after each "
+    "mispredicted branch when -speculate is set.");
+
 droption_t<std::string>
     op_view_syntax(DROPTION_SCOPE_FRONTEND, "view_syntax", "att/arm/dr/riscv",
                    "Syntax to use for disassembly.",
@@ -646,9 +858,10 @@ droption_t<bool> op_reuse_distance_histogram(
     "are reported.  This option prints out the full histogram of reuse distances.");
 droption_t<unsigned int> op_reuse_skip_dist(
     DROPTION_SCOPE_FRONTEND, "reuse_skip_dist", 500,
-    "For performance tuning: distance between skip nodes.",
-    "Specifies the distance between nodes in the skip list.  For optimal performance, "
-    "set this to a value close to the estimated average reuse distance of the dataset.");
+    "Obsolete: ignored.",
+    "This used to tune the skip list that the reuse distance tool computed distances "
+    "with.  Distances are now computed with a tree over access times, in "
+    "logarithmic time with no tuning, and this option is ignored.");
 droption_t<unsigned int> op_reuse_distance_limit(
     DROPTION_SCOPE_FRONTEND, "reuse_distance_limit", 0,
     "If nonzero, restricts distance tracking to the specified maximum distance.",
@@ -657,10 +870,10 @@ droption_t<unsigned int> op_reuse_distance_limit(
     "and reduce memory consumption for very long traces.");
 droption_t<bool> op_reuse_verify_skip(
     DROPTION_SCOPE_FRONTEND, "reuse_verify_skip", false,
-    "Use full list walks to verify the skip list results.",
-    "Verifies every skip list-calculated reuse distance with a full list walk. "
-    "This incurs significant additional overhead.  This option is only available "
-    "in debug builds.");
+    "Use brute-force counts to verify the reuse distance results.",
+    "Verifies every tree-calculated reuse distance by counting the more recently "
+    "accessed lines one at a time.  This incurs significant additional overhead.  "
+    "This option is only available in debug builds.");
 droption_t<double> op_reuse_histogram_bin_multiplier(
     DROPTION_SCOPE_FRONTEND, "reuse_histogram_bin_multiplier", 1.00,
     "When reporting histograms, grow bins geometrically by this multiplier.",
@@ -672,6 +885,27 @@ droption_t<double> op_reuse_histogram_bin_multiplier(
     "bins.  Note that this option only affects the printing of histograms via "
     "the -reuse_distance_histogram option; the raw histogram data is always "
     "collected at full precision.");
+droption_t<double> op_reuse_sample_rate(
+    DROPTION_SCOPE_FRONTEND, "reuse_sample_rate", 1.0, 0.0, 1.0,
+    "Fraction of cache lines sampled by the reuse_distance and reuse_time tools.",
+    "If below 1, the reuse_distance and reuse_time tools only track cache lines "
+    "selected by a hash of their address, at about this rate, in the manner of SHARDS "
+    "spatial sampling.  All references to a sampled line are measured, and "
+    "distances and counts are scaled by the inverse of the rate, which is rounded "
+    "to 1/n for an integer n, so reuse distances are resolved to multiples of n "
+    "(beyond a distance of 0 or 1).  The results are estimates.  The tools print the "
+    "final rate and check only one of them: the total access count estimated from "
+    "the samples against the exact total.  That error is large when a few lines "
+    "receive most references.  No error bounds are given for the histogram bins, "
+    "the mean, or the other statistics.");
+droption_t<unsigned int> op_reuse_sample_max_lines(
+    DROPTION_SCOPE_FRONTEND, "reuse_sample_max_lines", 0,
+    "If nonzero, bounds the cache lines tracked per shard by the reuse tools.",
+    "If nonzero, the reuse_distance and reuse_time tools sample cache lines as for "
+    "-reuse_sample_rate, halving the sampling rate whenever a shard tracks more "
+    "than this many lines.  This bounds memory use independently of the working "
+    "set size; the reuse_distance tool uses on the order of 100 bytes per "
+    "tracked line.  -reuse_sample_rate sets the starting rate.");
 
 #define OP_RECORD_FUNC_ITEM_SEP "&"
 // XXX i#3048: replace function return address with function callstack
@@ -895,6 +1129,21 @@ droption_t<uint64_t> op_sched_block_max_us(DROPTION_SCOPE_ALL, "sched_block_max_
                                            "Maximum blocked input time, in microseconds",
                                            "The maximum blocked time, after scaling with "
                                            "-sched_block_scale.");
+
+droption_t<bool> op_sched_sharded_runqueues(
+    DROPTION_SCOPE_ALL, "sched_sharded_runqueues", false,
+    "Use a ready queue per core with work stealing",
+    "Applies to -core_sharded and -core_serial.  Gives each core its own ready queue "
+    "and lock.  A core with nothing runnable steals from the other queues.  This "
+    "scales to more cores than the default single global queue, at the cost of only "
+    "approximating the global priority and timestamp order.");
+
+droption_t<uint64_t> op_sched_rebalance_period_us(
+    DROPTION_SCOPE_ALL, "sched_rebalance_period_us", 0,
+    "Period for rebalancing per-core ready queues",
+    "Applies to -sched_sharded_runqueues.  If non-zero, the per-core ready queues are "
+    "rebalanced to equal lengths each time this many microseconds have "
+    "passed.");
 #ifdef HAS_ZIP
 droption_t<std::string> op_record_file(DROPTION_SCOPE_FRONTEND, "record_file", "",
                                        "Path for storing record of schedule",
@@ -911,6 +1160,30 @@ droption_t<std::string>
                          "Applies to -core_sharded and -core_serial. "
                          "Path with stored as-traced schedule for replay.");
 #endif
+droption_t<int> op_read_ahead_blocks(
+    DROPTION_SCOPE_FRONTEND, "read_ahead_blocks", 0,
+    "Compressed buffers to decompress ahead on a helper thread per input",
+    "If positive, the reader of each compressed offline trace file (gzip, zip, lz4 or "
+    "snappy) decompresses up to this many buffers of 4096 records ahead on its own "
+    "helper thread, overlapping decompression with the analysis.  This mostly helps "
+    "when there are fewer inputs than cores, such as a single-threaded trace.  The "
+    "helper starts once an input's second buffer is needed; skipping after that point "
+    "walks a zipfile input's records rather than jumping over its chunks unless the "
+    "input has a chunk index.");
+
+droption_t<int> op_split_chunks(
+    DROPTION_SCOPE_FRONTEND, "split_chunks", 0,
+    "Split a single-thread chunked trace into this many groups of chunks",
+    "If greater than 1 and the offline trace consists of a single thread's .zip file, "
+    "or .gz or .lz4 file with a chunk index, holding several chunks (see "
+    "-chunk_instr_count), the trace is split into up to "
+    "this many groups of consecutive chunks which are decompressed and analyzed "
+    "concurrently by the -jobs worker threads, with each tool merging the groups' "
+    "results at the end.  This requires every selected tool to support merging "
+    "pieces of a shard (basic_counts, opcode_mix, and histogram do) and is ignored "
+    "otherwise, as well as for -core_sharded, -core_serial, -skip_instrs, "
+    "-only_thread, and -interval_microseconds.");
+
 droption_t<std::string> op_sched_switch_file(
     DROPTION_SCOPE_FRONTEND, "sched_switch_file", "",
     "Path to file holding context switch sequences",
@@ -37,6 +37,9 @@
 
 // Tool names (for -simulator_type option).
 #define MISS_ANALYZER "miss_analyzer"
+#define CACHE_SWEEP "cache_sweep"
+#define MISS_RATIO_CURVE "miss_ratio_curve"
+#define OPT_MISS_BOUND "opt_miss_bound"
 #define TLB "TLB"
 #define HISTOGRAM "histogram"
 #define REUSE_DIST "reuse_distance"
@@ -55,7 +58,15 @@
 #define REPLACE_POLICY_LRU "LRU"
 #define REPLACE_POLICY_LFU "LFU"
 #define REPLACE_POLICY_FIFO "FIFO"
+#define REPLACE_POLICY_SRRIP "SRRIP"
+#define REPLACE_POLICY_BRRIP "BRRIP"
+#define REPLACE_POLICY_DRRIP "DRRIP"
+#define REPLACE_POLICY_SHIP "SHIP"
+#define REPLACE_POLICY_HAWKEYE "HAWKEYE"
 #define PREFETCH_POLICY_NEXTLINE "nextline"
+#define PREFETCH_POLICY_STRIDE "stride"
+#define PREFETCH_POLICY_STREAM "stream"
+#define PREFETCH_POLICY_GHB "ghb"
 #define PREFETCH_POLICY_NONE "none"
 #define CPU_CACHE "cache"
 #define CACHE_TYPE_INSTRUCTION "instruction"
@@ -87,6 +98,8 @@ namespace drmemtrace {
 
 extern dynamorio::droption::droption_t<bool> op_offline;
 extern dynamorio::droption::droption_t<std::string> op_ipc_name;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_ipc_ring_size;
 extern dynamorio::droption::droption_t<std::string> op_outdir;
 extern dynamorio::droption::droption_t<std::string> op_subdir_prefix;
 extern dynamorio::droption::droption_t<std::string> op_infile;
@@ -95,6 +108,7 @@ extern dynamorio::droption::droption_t<std::string> op_module_file;
 extern dynamorio::droption::droption_t<std::string> op_alt_module_dir;
 extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
     op_chunk_instr_count;
+extern dynamorio::droption::droption_t<bool> op_chunk_index;
 extern dynamorio::droption::droption_t<bool> op_instr_encodings;
 extern dynamorio::droption::droption_t<std::string> op_funclist_file;
 extern dynamorio::droption::droption_t<unsigned int> op_num_cores;
@@ -106,6 +120,7 @@ extern dynamorio::droption::droption_t<unsigned int> op_L1D_assoc;
 extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t> op_LL_size;
 extern dynamorio::droption::droption_t<unsigned int> op_LL_assoc;
 extern dynamorio::droption::droption_t<std::string> op_LL_miss_file;
+extern dynamorio::droption::droption_t<unsigned int> op_LL_set_sample_rate;
 extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t> op_L0I_size;
 extern dynamorio::droption::droption_t<bool> op_L0_filter_deprecated;
 extern dynamorio::droption::droption_t<bool> op_L0I_filter;
@@ -132,10 +147,14 @@ extern dynamorio::droption::droption_t<bool> op_split_windows;
 extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
     op_exit_after_tracing;
 extern dynamorio::droption::droption_t<std::string> op_raw_compress;
+extern dynamorio::droption::droption_t<unsigned int> op_raw_compress_threads;
 extern dynamorio::droption::droption_t<std::string> op_trace_compress;
 extern dynamorio::droption::droption_t<bool> op_online_instr_types;
 extern dynamorio::droption::droption_t<std::string> op_replace_policy;
 extern dynamorio::droption::droption_t<std::string> op_data_prefetcher;
+extern dynamorio::droption::droption_t<unsigned int> op_prefetch_degree;
+extern dynamorio::droption::droption_t<unsigned int> op_prefetch_queue_size;
+extern dynamorio::droption::droption_t<unsigned int> op_prefetch_table_size;
 extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t> op_page_size;
 extern dynamorio::droption::droption_t<unsigned int> op_TLB_L1I_entries;
 extern dynamorio::droption::droption_t<unsigned int> op_TLB_L1D_entries;
@@ -150,6 +169,20 @@ extern dynamorio::droption::droption_t<std::string> op_cache_trace_log_path;
 extern dynamorio::droption::droption_t<unsigned int> op_max_trace_length;
 extern dynamorio::droption::droption_t<unsigned int> op_cachesim_row_buffer_size;
 extern dynamorio::droption::droption_t<std::string> op_trace_form;
+extern dynamorio::droption::droption_t<std::string> op_cachesim_row_format;
+extern dynamorio::droption::droption_t<std::string> op_cache_sweep_configs;
+extern dynamorio::droption::droption_t<unsigned int> op_cache_sweep_threads;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_miss_curve_L1_min_size;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_miss_curve_L1_max_size;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_miss_curve_LL_min_size;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_miss_curve_LL_max_size;
+extern dynamorio::droption::droption_t<unsigned int> op_miss_curve_min_assoc;
+extern dynamorio::droption::droption_t<unsigned int> op_miss_curve_max_assoc;
+extern dynamorio::droption::droption_t<std::string> op_opt_miss_bound_dir;
 extern dynamorio::droption::droption_t<bool> op_show_func_trace;
 extern dynamorio::droption::droption_t<int> op_jobs;
 extern dynamorio::droption::droption_t<bool> op_test_mode;
@@ -169,6 +202,14 @@ extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t> op_skip_
 extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t> op_warmup_refs;
 extern dynamorio::droption::droption_t<double> op_warmup_fraction;
 extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t> op_sim_refs;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_sample_period_refs;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_sample_warmup_refs;
+extern dynamorio::droption::droption_t<dynamorio::droption::bytesize_t>
+    op_sample_unit_refs;
+extern dynamorio::droption::droption_t<std::string> op_speculate;
+extern dynamorio::droption::droption_t<unsigned int> op_speculate_instrs;
 extern dynamorio::droption::droption_t<std::string> op_config_file;
 extern dynamorio::droption::droption_t<unsigned int> op_report_top;
 extern dynamorio::droption::droption_t<unsigned int> op_reuse_distance_threshold;
@@ -177,6 +218,8 @@ extern dynamorio::droption::droption_t<unsigned int> op_reuse_skip_dist;
 extern dynamorio::droption::droption_t<unsigned int> op_reuse_distance_limit;
 extern dynamorio::droption::droption_t<bool> op_reuse_verify_skip;
 extern dynamorio::droption::droption_t<double> op_reuse_histogram_bin_multiplier;
+extern dynamorio::droption::droption_t<double> op_reuse_sample_rate;
+extern dynamorio::droption::droption_t<unsigned int> op_reuse_sample_max_lines;
 extern dynamorio::droption::droption_t<std::string> op_view_syntax;
 extern dynamorio::droption::droption_t<std::string> op_record_function;
 extern dynamorio::droption::droption_t<bool> op_record_heap;
@@ -200,12 +243,16 @@ extern dynamorio::droption::droption_t<uint64_t> op_sched_syscall_switch_us;
 extern dynamorio::droption::droption_t<uint64_t> op_sched_blocking_switch_us;
 extern dynamorio::droption::droption_t<double> op_sched_block_scale;
 extern dynamorio::droption::droption_t<uint64_t> op_sched_block_max_us;
+extern dynamorio::droption::droption_t<bool> op_sched_sharded_runqueues;
+extern dynamorio::droption::droption_t<uint64_t> op_sched_rebalance_period_us;
 #ifdef HAS_ZIP
 extern dynamorio::droption::droption_t<std::string> op_record_file;
 extern dynamorio::droption::droption_t<std::string> op_replay_file;
 extern dynamorio::droption::droption_t<std::string> op_cpu_schedule_file;
 #endif
 extern dynamorio::droption::droption_t<std::string> op_sched_switch_file;
+extern dynamorio::droption::droption_t<int> op_read_ahead_blocks;
+extern dynamorio::droption::droption_t<int> op_split_chunks;
 extern dynamorio::droption::droption_t<uint64_t> op_schedule_stats_print_every;
 extern dynamorio::droption::droption_t<std::string> op_syscall_template_file;
 
@@ -0,0 +1,462 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#include "shm_ring.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+#define RING_PERMS 0666
+
+// The layout shared by all processes.  The fields are laid out on separate cache
+// lines according to who writes them.  The futex words are 32-bit sequence
+// numbers bumped on every change the other side may be waiting for, with waiter
+// counts to let the common case skip the wake system call.
+struct shm_ring_t::header_t {
+    static constexpr uint64_t MAGIC = 0x676e6972746d7264ULL; // "drmtring"
+    uint64_t magic;
+    uint64_t capacity;
+    uint64_t granule;
+    // Written by writers.
+    alignas(64) std::atomic<uint64_t> reserve_pos;
+    alignas(64) std::atomic<uint64_t> commit_pos;
+    std::atomic<uint32_t> commit_seq;
+    std::atomic<uint32_t> commit_waiters;
+    std::atomic<uint32_t> num_writers;
+    std::atomic<uint32_t> writers_seen;
+    // The pid of each attached writer process, or 0 for a free slot, so the
+    // reader can tell when a writer dies without calling remove_writer().
+    alignas(64) std::atomic<int32_t> writer_pids[MAX_WRITER_PIDS];
+    // Written by the reader.
+    alignas(64) std::atomic<uint64_t> read_pos;
+    std::atomic<uint32_t> read_seq;
+    std::atomic<uint32_t> read_waiters;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex words must be plain 32-bit integers");
+
+// How many times we poll before sleeping.  A writer waiting on an earlier
+// writer's copy usually needs only a short wait.
+static const int SPIN_COUNT = 128;
+
+// How often the reader checks for dead writers while it waits for data.
+static const struct timespec WRITER_CHECK_INTERVAL = { 1, 0 };
+
+// Returns false if "timeout" expired.
+static bool
+futex_wait(std::atomic<uint32_t> *word, uint32_t val,
+           const struct timespec *timeout = nullptr)
+{
+    // We omit FUTEX_PRIVATE_FLAG as the waker may be in another process.
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, val,
+                   timeout, nullptr, 0) == 0 ||
+        errno != ETIMEDOUT;
+}
+
+static void
+futex_wake_all(std::atomic<uint32_t> *word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr,
+            nullptr, 0);
+}
+
+// Waits until cond() holds.  The party making cond() true must call
+// notify() on the same seq and waiters afterward.  Returns cond() once any
+// single sleep exceeds "timeout".
+template <typename T>
+static bool
+wait_until(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiters, T cond,
+           const struct timespec *timeout = nullptr)
+{
+    for (int i = 0; i < SPIN_COUNT; ++i) {
+        if (cond())
+            return true;
+    }
+    while (!cond()) {
+        // Announcing ourselves before reading seq, with the notifier bumping seq
+        // before reading waiters, ensures one of us sees the other.
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t cur_seq = seq.load(std::memory_order_seq_cst);
+        bool timed_out = false;
+        if (!cond())
+            timed_out = !futex_wait(&seq, cur_seq, timeout);
+        waiters.fetch_sub(1, std::memory_order_seq_cst);
+        if (timed_out)
+            return cond();
+    }
+    return true;
+}
+
+static void
+notify(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiters)
+{
+    seq.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) > 0)
+        futex_wake_all(&seq);
+}
+
+// Returns whether process "pid" has exited, counting a zombie as exited: the
+// launcher cannot reap the application it runs until we finish reading.
+static bool
+process_exited(pid_t pid)
+{
+    if (kill(pid, 0) != 0)
+        return errno == ESRCH;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+        return errno == ENOENT;
+    char buf[512];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[len] = '\0';
+    // The state follows the command name, which is in parentheses and may itself
+    // contain them.
+    const char *name_end = strrchr(buf, ')');
+    return name_end != nullptr && name_end[1] == ' ' &&
+        (name_end[2] == 'Z' || name_end[2] == 'X');
+}
+
+static const char *
+ring_dir()
+{
+    return "/dev/shm";
+}
+
+shm_ring_t::shm_ring_t()
+{
+    // empty
+}
+
+shm_ring_t::shm_ring_t(const char *name)
+{
+    set_name(name); // guaranteed to succeed
+}
+
+shm_ring_t::~shm_ring_t()
+{
+    if (owner_)
+        destroy();
+}
+
+bool
+shm_ring_t::set_name(const char *name)
+{
+    if (header_ != nullptr)
+        return false;
+    name_ = name;
+    // An absolute name is shared with the named pipe, so we add a suffix.
+    if (name[0] == '/')
+        path_ = name_ + ".shm";
+    else
+        path_ = std::string(ring_dir()) + "/" + name_;
+    return true;
+}
+
+std::string
+shm_ring_t::get_name() const
+{
+    return name_;
+}
+
+const std::string &
+shm_ring_t::get_path() const
+{
+    return path_;
+}
+
+bool
+shm_ring_t::create(size_t capacity, size_t granule)
+{
+    if (header_ != nullptr || granule == 0)
+        return false;
+    capacity -= capacity % granule;
+    // Each write must fit in a quarter of the ring: see get_atomic_write_size().
+    if (capacity / 4 < granule)
+        return false;
+    umask(0);
+    int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_EXCL, RING_PERMS);
+    if (fd < 0)
+        return false;
+    size_t size = sizeof(header_t) + capacity;
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        unlink(path_.c_str());
+        return false;
+    }
+    // The new file is zero-filled, which is the initial state of all of the
+    // atomics.
+    header_ = reinterpret_cast<header_t *>(map);
+    header_->capacity = capacity;
+    header_->granule = granule;
+    header_->magic = header_t::MAGIC;
+    data_ = reinterpret_cast<char *>(map) + sizeof(header_t);
+    capacity_ = capacity;
+    map_size_ = size;
+    owner_ = true;
+    read_pos_ = 0;
+    return true;
+}
+
+bool
+shm_ring_t::destroy()
+{
+    if (!owner_)
+        return false;
+    munmap(header_, map_size_);
+    header_ = nullptr;
+    data_ = nullptr;
+    owner_ = false;
+    return unlink(path_.c_str()) == 0;
+}
+
+bool
+shm_ring_t::attach(void *base, size_t size)
+{
+    if (header_ != nullptr || base == nullptr || size < sizeof(header_t))
+        return false;
+    header_t *header = reinterpret_cast<header_t *>(base);
+    if (header->magic != header_t::MAGIC ||
+        size < sizeof(header_t) + header->capacity)
+        return false;
+    header_ = header;
+    data_ = reinterpret_cast<char *>(base) + sizeof(header_t);
+    capacity_ = static_cast<size_t>(header->capacity);
+    map_size_ = size;
+    return true;
+}
+
+void *
+shm_ring_t::get_mapping_base() const
+{
+    return header_;
+}
+
+size_t
+shm_ring_t::get_mapping_size() const
+{
+    return map_size_;
+}
+
+bool
+shm_ring_t::add_writer()
+{
+    if (header_ == nullptr)
+        return false;
+    // We count ourselves before publishing our pid, which the reader may then
+    // use to uncount us.
+    header_->num_writers.fetch_add(1, std::memory_order_acq_rel);
+    // A fork child inherits its parent's slot index, so we always claim a new
+    // slot.  Once they run out, further processes are not watched.
+    writer_slot_ = -1;
+    int32_t pid = static_cast<int32_t>(getpid());
+    for (int i = 0; i < MAX_WRITER_PIDS; ++i) {
+        int32_t expect = 0;
+        if (header_->writer_pids[i].compare_exchange_strong(
+                expect, pid, std::memory_order_acq_rel)) {
+            writer_slot_ = i;
+            break;
+        }
+    }
+    header_->writers_seen.store(1, std::memory_order_release);
+    is_writer_ = true;
+    notify(header_->commit_seq, header_->commit_waiters);
+    return true;
+}
+
+bool
+shm_ring_t::remove_writer()
+{
+    if (header_ == nullptr || !is_writer_)
+        return false;
+    is_writer_ = false;
+    if (writer_slot_ >= 0) {
+        // Whoever clears the slot drops the count, so the reader cannot also
+        // count us as dead.
+        int32_t expect = static_cast<int32_t>(getpid());
+        bool cleared = header_->writer_pids[writer_slot_].compare_exchange_strong(
+            expect, 0, std::memory_order_acq_rel);
+        writer_slot_ = -1;
+        if (!cleared)
+            return true;
+    }
+    // The release ordering publishes all of our prior commits to a reader that
+    // observes the count dropping to zero.
+    header_->num_writers.fetch_sub(1, std::memory_order_acq_rel);
+    notify(header_->commit_seq, header_->commit_waiters);
+    return true;
+}
+
+void
+shm_ring_t::remove_dead_writers()
+{
+    for (int i = 0; i < MAX_WRITER_PIDS; ++i) {
+        int32_t pid = header_->writer_pids[i].load(std::memory_order_acquire);
+        // XXX: A recycled pid still looks alive here.
+        if (pid == 0 || !process_exited(static_cast<pid_t>(pid)))
+            continue;
+        if (header_->writer_pids[i].compare_exchange_strong(
+                pid, 0, std::memory_order_acq_rel))
+            header_->num_writers.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+bool
+shm_ring_t::detach()
+{
+    if (header_ == nullptr || owner_)
+        return false;
+    remove_writer();
+    header_ = nullptr;
+    data_ = nullptr;
+    map_size_ = 0;
+    return true;
+}
+
+ssize_t
+shm_ring_t::get_atomic_write_size() const
+{
+    if (header_ == nullptr)
+        return 0;
+    size_t size = capacity_ / 4;
+    return static_cast<ssize_t>(size - size % header_->granule);
+}
+
+ssize_t
+shm_ring_t::write(const void *buf, size_t sz)
+{
+    if (header_ == nullptr || sz % header_->granule != 0 ||
+        sz > static_cast<size_t>(get_atomic_write_size()))
+        return -1;
+    if (sz == 0)
+        return 0;
+    uint64_t start = header_->reserve_pos.fetch_add(sz, std::memory_order_relaxed);
+    uint64_t end = start + sz;
+    // Wait for the reader to free up all of our reserved space.
+    wait_until(header_->read_seq, header_->read_waiters, [&]() {
+        return end - header_->read_pos.load(std::memory_order_acquire) <= capacity_;
+    });
+    size_t offs = static_cast<size_t>(start % capacity_);
+    size_t first = std::min(sz, capacity_ - offs);
+    memcpy(data_ + offs, buf, first);
+    if (first < sz)
+        memcpy(data_, reinterpret_cast<const char *>(buf) + first, sz - first);
+    // Publish in reservation order, so the reader sees a contiguous prefix.
+    // XXX: A writer that dies between reserving and committing blocks every
+    // later writer forever, and with them the reader, as they are still alive.
+    // We could add a timeout and have the reader give up.
+    wait_until(header_->commit_seq, header_->commit_waiters, [&]() {
+        return header_->commit_pos.load(std::memory_order_acquire) == start;
+    });
+    header_->commit_pos.store(end, std::memory_order_release);
+    notify(header_->commit_seq, header_->commit_waiters);
+    return static_cast<ssize_t>(sz);
+}
+
+bool
+shm_ring_t::wait_for_writer()
+{
+    if (header_ == nullptr)
+        return false;
+    wait_until(header_->commit_seq, header_->commit_waiters, [&]() {
+        return header_->writers_seen.load(std::memory_order_acquire) != 0;
+    });
+    return true;
+}
+
+size_t
+shm_ring_t::acquire_read(void **data, size_t max_sz)
+{
+    if (header_ == nullptr)
+        return 0;
+    // XXX: If the last writer process exits before a child it forked has called
+    // add_writer(), we will see the count drop to zero and end the stream
+    // early.
+    // A writer process killed before it could call remove_writer() would otherwise
+    // keep us waiting forever, so we wake up now and then to look for one.
+    while (!wait_until(
+        header_->commit_seq, header_->commit_waiters,
+        [&]() {
+            return header_->commit_pos.load(std::memory_order_acquire) != read_pos_ ||
+                header_->num_writers.load(std::memory_order_acquire) == 0;
+        },
+        &WRITER_CHECK_INTERVAL))
+        remove_dead_writers();
+    // Re-read now that any final writer's commits are visible.
+    uint64_t commit = header_->commit_pos.load(std::memory_order_acquire);
+    if (commit == read_pos_)
+        return 0;
+    size_t offs = static_cast<size_t>(read_pos_ % capacity_);
+    size_t sz =
+        static_cast<size_t>(std::min<uint64_t>(commit - read_pos_, capacity_ - offs));
+    max_sz -= max_sz % header_->granule;
+    sz = std::min(sz, max_sz);
+    *data = data_ + offs;
+    return sz;
+}
+
+void
+shm_ring_t::release_read(size_t sz)
+{
+    if (header_ == nullptr || sz == 0)
+        return;
+    read_pos_ += sz;
+    header_->read_pos.store(read_pos_, std::memory_order_release);
+    notify(header_->read_seq, header_->read_waiters);
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,147 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* shm_ring: a shared-memory ring buffer carrying online trace data from
+ * any number of writer threads in any number of processes to a single reader.
+ */
+
+#ifndef _SHM_RING_H_
+#define _SHM_RING_H_ 1
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "named_pipe.h" // for ssize_t and DR_PARAM_*
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Usage is as follows:
+// + The reader calls create() up front (and at the end destroy()), and
+//   wait_for_writer() before reading.
+// + Each writer process maps the file at get_path() read-write and shared,
+//   passes the mapping to attach(), and calls add_writer() (and remove_writer()
+//   when done).  A child process which inherits the mapping across a fork calls
+//   add_writer() itself.
+// Writers reserve space and copy their data in without any system call unless
+// the ring is full or the reader is asleep waiting for data.  Each write is
+// published atomically and in reservation order.  The reader consumes the data
+// in place and must release it once done.
+class shm_ring_t {
+public:
+    shm_ring_t();
+    explicit shm_ring_t(const char *name);
+    ~shm_ring_t();
+    bool
+    set_name(const char *name);
+    std::string
+    get_name() const;
+    const std::string &
+    get_path() const;
+
+    // Creates and maps a ring with room for "capacity" bytes of data, rounded
+    // down to a multiple of "granule".  All writes must be multiples of
+    // "granule" in size, which guarantees that the reader never sees an
+    // element split across the end of the ring.
+    bool
+    create(size_t capacity, size_t granule);
+    bool
+    destroy();
+
+    // For writers: uses a mapping of the file at get_path() covering its
+    // whole size.
+    bool
+    attach(void *base, size_t size);
+    void *
+    get_mapping_base() const;
+    size_t
+    get_mapping_size() const;
+    bool
+    add_writer();
+    // Safe to call multiple times and on a ring that was never attached.
+    bool
+    remove_writer();
+    // Forgets an attach()-ed mapping, which the caller then unmaps.
+    bool
+    detach();
+
+    // Blocks while the ring is full.  Returns < 0 on an error, which includes
+    // "sz" exceeding get_atomic_write_size().  On success returns "sz".
+    ssize_t
+    write(const void *buf DR_PARAM_IN, size_t sz);
+
+    // The largest write which may be issued.  We keep this well below the
+    // capacity so that several writers can be copying in data at once.
+    ssize_t
+    get_atomic_write_size() const;
+
+    // For the reader: blocks until the first writer has attached.
+    bool
+    wait_for_writer();
+    // Blocks until there is unread data and returns in "data" a pointer to up
+    // to "max_sz" contiguous bytes of it, which remain valid and writable until
+    // passed to release_read().  Returns 0 once every writer has detached or
+    // died and all data has been read.
+    size_t
+    acquire_read(void **data DR_PARAM_OUT, size_t max_sz);
+    void
+    release_read(size_t sz);
+
+    // The number of writer processes whose death the reader can detect.
+    static constexpr int MAX_WRITER_PIDS = 64;
+
+private:
+    struct header_t;
+
+    void
+    remove_dead_writers();
+
+    std::string name_;
+    std::string path_;
+    header_t *header_ = nullptr;
+    char *data_ = nullptr;
+    size_t capacity_ = 0;
+    size_t map_size_ = 0;
+    // Whether we created (and thus must unmap and unlink) the mapping.
+    bool owner_ = false;
+    bool is_writer_ = false;
+    // Our slot in header_t::writer_pids, or -1.
+    int writer_slot_ = -1;
+    // The reader's private copy of its position.
+    uint64_t read_pos_ = 0;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _SHM_RING_H_ */
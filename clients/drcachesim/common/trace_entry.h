@@ -1350,6 +1350,13 @@ typedef struct _pt_data_buf_t pt_data_buf_t;
  */
 #define DRMEMTRACE_CPU_SCHEDULE_FILENAME "cpu_schedule.bin.zip"
 
+/**
+ * The suffix appended to the path of an offline trace file to name its chunk
+ * index, which lets readers seek to a chunk without decompressing the chunks
+ * before it.
+ */
+#define DRMEMTRACE_INDEX_FILE_SUFFIX ".idx"
+
 /**
  * The name of the folder in -offline mode where the kernel's per thread trace
  * data is stored.
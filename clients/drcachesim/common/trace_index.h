@@ -0,0 +1,188 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* trace_index: the chunk index stored alongside an offline trace file. */
+
+#ifndef _TRACE_INDEX_H_
+#define _TRACE_INDEX_H_ 1
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Describes where one chunk of a trace file starts.
+struct trace_index_entry_t {
+    // The count of instructions in the file prior to the chunk.
+    uint64_t instr_count;
+    // The timestamp in effect at the start of the chunk, which the chunk repeats.
+    uint64_t timestamp;
+    // Where the chunk starts, in a unit that depends on the file format: the
+    // component ordinal for a zipfile; the byte offset of a full-flush point,
+    // after which deflate data does not refer back, for gzip; and the byte offset
+    // of a frame for lz4.
+    uint64_t offset;
+};
+
+// The index of the self-contained chunks of a trace file (see
+// raw2trace_t::open_new_chunk()), which lets a reader start decoding at any
+// chunk.  It is stored in a file whose path is the trace file's path with
+// DRMEMTRACE_INDEX_FILE_SUFFIX appended.
+class trace_index_t {
+public:
+    static std::string
+    get_path(const std::string &trace_path)
+    {
+        return trace_path + DRMEMTRACE_INDEX_FILE_SUFFIX;
+    }
+
+    // Appends the next chunk.  Returns an empty string on success or a non-empty
+    // error description on failure.
+    std::string
+    add_entry(const trace_index_entry_t &entry)
+    {
+        if (!entries_.empty() && (entry.instr_count < entries_.back().instr_count ||
+                                  entry.offset < entries_.back().offset))
+            return "Index entries must be added in trace order";
+        entries_.push_back(entry);
+        return "";
+    }
+
+    const std::vector<trace_index_entry_t> &
+    get_entries() const
+    {
+        return entries_;
+    }
+
+    // Returns the last chunk that starts with at most "instr_count" instructions
+    // before it, or nullptr if there is none.
+    const trace_index_entry_t *
+    find_instruction(uint64_t instr_count) const
+    {
+        auto it = std::upper_bound(entries_.begin(), entries_.end(), instr_count,
+                                   [](uint64_t count, const trace_index_entry_t &entry) {
+                                       return count < entry.instr_count;
+                                   });
+        return it == entries_.begin() ? nullptr : &*(it - 1);
+    }
+
+    // Returns the last chunk that starts at or before "timestamp", or nullptr if
+    // there is none.
+    const trace_index_entry_t *
+    find_timestamp(uint64_t timestamp) const
+    {
+        auto it = std::upper_bound(entries_.begin(), entries_.end(), timestamp,
+                                   [](uint64_t stamp, const trace_index_entry_t &entry) {
+                                       return stamp < entry.timestamp;
+                                   });
+        return it == entries_.begin() ? nullptr : &*(it - 1);
+    }
+
+    // Writes the index of the trace file at "trace_path", which must be complete,
+    // next to it.  The index records the trace file's size so that read() can
+    // detect an index left behind by a prior trace.  Returns an empty string on
+    // success or a non-empty error description on failure.
+    std::string
+    write(const std::string &trace_path) const
+    {
+        uint64_t trace_size = 0;
+        if (!get_file_size(trace_path, trace_size))
+            return "Failed to find the size of " + trace_path;
+        const std::string path = get_path(trace_path);
+        std::ofstream file(path, std::ofstream::binary);
+        if (!file)
+            return "Failed to open index file " + path;
+        uint64_t header[] = { MAGIC, VERSION, trace_size, entries_.size() };
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(entries_.data()),
+                   entries_.size() * sizeof(entries_[0]));
+        if (!file)
+            return "Failed to write index file " + path;
+        return "";
+    }
+
+    // Replaces the contents with those of the index of the trace file at
+    // "trace_path".  Returns an empty string on success or a non-empty error
+    // description on failure, including when the index was written for a trace
+    // file of a different size.
+    std::string
+    read(const std::string &trace_path)
+    {
+        entries_.clear();
+        const std::string path = get_path(trace_path);
+        std::ifstream file(path, std::ifstream::binary);
+        if (!file)
+            return "Failed to open index file " + path;
+        uint64_t header[4];
+        if (!file.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+            header[0] != MAGIC || header[1] != VERSION)
+            return "Invalid index file " + path;
+        uint64_t trace_size = 0;
+        if (!get_file_size(trace_path, trace_size) || trace_size != header[2])
+            return "Stale index file " + path;
+        entries_.resize(header[3]);
+        if (!file.read(reinterpret_cast<char *>(entries_.data()),
+                       entries_.size() * sizeof(entries_[0]))) {
+            entries_.clear();
+            return "Truncated index file " + path;
+        }
+        return "";
+    }
+
+private:
+    static bool
+    get_file_size(const std::string &path, uint64_t &size)
+    {
+        std::ifstream file(path, std::ifstream::binary | std::ifstream::ate);
+        if (!file)
+            return false;
+        size = static_cast<uint64_t>(file.tellg());
+        return true;
+    }
+
+    // "DRIDXv01" when read as little-endian bytes.
+    static constexpr uint64_t MAGIC = 0x3130765844495244ULL;
+    static constexpr uint64_t VERSION = 1;
+    std::vector<trace_index_entry_t> entries_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _TRACE_INDEX_H_ */
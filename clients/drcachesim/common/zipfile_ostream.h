@@ -65,20 +65,31 @@ public:
     }
     ~zipfile_streambuf_t() override
     {
-        sync();
+        std::string error = close();
         delete[] buf_;
-        if (zip_ == nullptr)
-            return;
-        // We do not bother with the zipfile comment: it doesn't seem to show
-        // up when I do set it anyway ("unzip -z" prints the .zip path instead).
-        if ((!first_component_ && zipCloseFileInZip(zip_) != ZIP_OK) ||
-            zipClose(zip_, nullptr) != ZIP_OK) {
+        if (!error.empty()) {
 #ifdef DEBUG
             // Let's at least have something visible in debug build.
             std::cerr << "zipfile_ostream failed to close zipfile\n";
 #endif
         }
     }
+    // Returns an empty string on success or a non-empty error description on failure.
+    std::string
+    close()
+    {
+        if (zip_ == nullptr)
+            return "";
+        bool ok = sync() != traits_type::eof();
+        // We do not bother with the zipfile comment: it doesn't seem to show
+        // up when I do set it anyway ("unzip -z" prints the .zip path instead).
+        if (!first_component_ && zipCloseFileInZip(zip_) != ZIP_OK)
+            ok = false;
+        if (zipClose(zip_, nullptr) != ZIP_OK)
+            ok = false;
+        zip_ = nullptr;
+        return ok ? "" : "Failed to close zipfile";
+    }
     int
     overflow(int extra_char) override
     {
@@ -106,6 +117,8 @@ public:
     std::string
     open_new_component(const std::string &name)
     {
+        if (zip_ == nullptr)
+            return "Zipfile is not open";
         if (!first_component_) {
             sync();
             if (zipCloseFileInZip(zip_) != ZIP_OK)
@@ -129,14 +142,17 @@ private:
 };
 
 // open_new_component() should be called to create an initial component before
-// doing any writing.
+// doing any writing.  If "write_index" is set, close() writes the components passed
+// to index_component() next to the file.
 class zipfile_ostream_t : public archive_ostream_t {
 public:
-    explicit zipfile_ostream_t(const std::string &path)
+    explicit zipfile_ostream_t(const std::string &path, bool write_index = false)
         : archive_ostream_t(new zipfile_streambuf_t(path))
     {
         if (!rdbuf())
             setstate(std::ios::badbit);
+        if (write_index)
+            indexed_path_ = path;
     }
     ~zipfile_ostream_t() override
     {
@@ -146,8 +162,23 @@ public:
     open_new_component(const std::string &name) override
     {
         zipfile_streambuf_t *zbuf = reinterpret_cast<zipfile_streambuf_t *>(rdbuf());
-        return zbuf->open_new_component(name);
+        std::string error = zbuf->open_new_component(name);
+        if (error.empty()) {
+            // Components are seeked to by their ordinal.
+            component_offset_ = num_components_++;
+        }
+        return error;
     }
+
+protected:
+    std::string
+    close_archive() override
+    {
+        return reinterpret_cast<zipfile_streambuf_t *>(rdbuf())->close();
+    }
+
+private:
+    uint64_t num_components_ = 0;
 };
 
 } // namespace drmemtrace
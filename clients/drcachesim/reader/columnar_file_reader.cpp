@@ -0,0 +1,142 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "columnar_file_reader.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+int
+fill_buffer_common(columnar_reader_t *reader, trace_entry_t *buf, int max_entries)
+{
+    int len =
+        reader->file
+            ->read(reinterpret_cast<char *>(buf), max_entries * sizeof(trace_entry_t))
+            .gcount();
+    if (len < static_cast<int>(sizeof(trace_entry_t)) ||
+        len % static_cast<int>(sizeof(trace_entry_t)) != 0)
+        return len >= 0 ? 0 : -1;
+    return len / sizeof(trace_entry_t);
+}
+
+trace_entry_t *
+read_next_entry_common(columnar_reader_t *reader, int read_ahead_blocks, bool *eof)
+{
+    if (reader->cur_buf >= reader->max_buf) {
+        int count = read_ahead_refill(reader, read_ahead_blocks,
+                                      [reader](trace_entry_t *buf, int max_entries) {
+                                          return fill_buffer_common(reader, buf,
+                                                                    max_entries);
+                                      });
+        if (count <= 0) {
+            *eof = (count == 0);
+            return nullptr;
+        }
+    }
+    trace_entry_t *res = reader->cur_buf;
+    ++reader->cur_buf;
+    return res;
+}
+
+/**************************************************
+ * columnar_reader_t specializations for file_reader_t.
+ */
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<columnar_reader_t>::file_reader_t()
+{
+    input_file_.file = nullptr;
+}
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<columnar_reader_t>::~file_reader_t<columnar_reader_t>()
+{
+    // Stop any helper thread before deleting the stream it reads.
+    input_file_.read_ahead.reset();
+    if (input_file_.file != nullptr) {
+        delete input_file_.file;
+        input_file_.file = nullptr;
+    }
+}
+
+template <>
+bool
+file_reader_t<columnar_reader_t>::open_single_file(const std::string &path)
+{
+    auto file = new columnar_istream_t(path);
+    if (!*file) {
+        delete file;
+        return false;
+    }
+    VPRINT(this, 1, "Opened input file %s\n", path.c_str());
+    input_file_.file = file;
+    return true;
+}
+
+template <>
+bool
+file_reader_t<columnar_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk)
+{
+    // The helper thread owns the stream position: stop it.  The next refill
+    // starts a new one at our new position.
+    input_file_.read_ahead.reset();
+    input_file_.cur_buf = input_file_.max_buf;
+    // open_single_file() only creates columnar_istream_t.
+    columnar_istream_t *stream = static_cast<columnar_istream_t *>(input_file_.file);
+    if (!stream->seek_to_block(chunk.offset))
+        return false;
+    VPRINT(this, 2, "Seeked to offset %" PRIu64 "\n", chunk.offset);
+    return true;
+}
+
+template <>
+trace_entry_t *
+file_reader_t<columnar_reader_t>::read_next_entry()
+{
+    trace_entry_t *entry = read_queued_entry();
+    if (entry != nullptr)
+        return entry;
+    entry = read_next_entry_common(&input_file_, read_ahead_blocks_, &at_eof_);
+    if (entry == nullptr)
+        return entry;
+    VPRINT(this, 4, "Read from file: type=%s (%d), size=%d, addr=%zu\n",
+           trace_type_names[entry->type], entry->type, entry->size, entry->addr);
+    entry_copy_ = *entry;
+    return &entry_copy_;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,73 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* columnar_file_reader: reads columnar files containing memory traces. */
+
+#ifndef _COLUMNAR_FILE_READER_H_
+#define _COLUMNAR_FILE_READER_H_ 1
+
+#include <memory>
+
+#include "common/columnar_istream.h"
+#include "file_reader.h"
+#include "read_ahead.h"
+#include "record_file_reader.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+struct columnar_reader_t {
+    columnar_reader_t()
+        : file(nullptr) {};
+    explicit columnar_reader_t(std::istream *file)
+        : file(file)
+    {
+    }
+    std::istream *file;
+    trace_entry_t buf[4096];
+    trace_entry_t *cur_buf = buf;
+    trace_entry_t *max_buf = buf;
+    // Non-null once decoding has moved to a helper thread.
+    std::unique_ptr<read_ahead_t> read_ahead;
+    int num_refills = 0;
+};
+
+typedef file_reader_t<columnar_reader_t> columnar_file_reader_t;
+
+template <>
+bool
+file_reader_t<columnar_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk);
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _COLUMNAR_FILE_READER_H_ */
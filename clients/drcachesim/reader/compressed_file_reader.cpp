@@ -38,12 +38,67 @@
 #include <string>
 
 #include "file_reader.h"
+#include "read_ahead.h"
 #include "record_file_reader.h"
 #include "trace_entry.h"
 
 namespace dynamorio {
 namespace drmemtrace {
 
+/**************************************************************************
+ * gzip_flush_point_reader_t.
+ */
+
+gzip_flush_point_reader_t::~gzip_flush_point_reader_t()
+{
+    if (initialized_)
+        inflateEnd(&stream_);
+}
+
+bool
+gzip_flush_point_reader_t::seek(const std::string &path, uint64_t offset)
+{
+    if (!initialized_) {
+        // Negative window bits select raw deflate data: there is no gzip header
+        // at a flush point.
+        if (inflateInit2(&stream_, -MAX_WBITS) != Z_OK)
+            return false;
+        initialized_ = true;
+    } else if (inflateReset(&stream_) != Z_OK)
+        return false;
+    stream_.avail_in = 0;
+    at_end_ = false;
+    if (!file_.is_open())
+        file_.open(path, std::ifstream::binary);
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(offset));
+    return static_cast<bool>(file_);
+}
+
+int
+gzip_flush_point_reader_t::read(void *buf, int size)
+{
+    stream_.next_out = static_cast<Bytef *>(buf);
+    stream_.avail_out = size;
+    while (stream_.avail_out > 0 && !at_end_) {
+        if (stream_.avail_in == 0) {
+            file_.read(in_buf_, sizeof(in_buf_));
+            // The file should not end before the final deflate block.
+            if (file_.gcount() <= 0)
+                return -1;
+            stream_.next_in = reinterpret_cast<Bytef *>(in_buf_);
+            stream_.avail_in = static_cast<uInt>(file_.gcount());
+        }
+        int res = inflate(&stream_, Z_NO_FLUSH);
+        if (res == Z_STREAM_END) {
+            // Only the gzip trailer follows.
+            at_end_ = true;
+        } else if (res != Z_OK)
+            return -1;
+    }
+    return size - static_cast<int>(stream_.avail_out);
+}
+
 /**************************************************************************
  * Common logic used in the gzip_reader_t specializations for file_reader_t
  * and record_file_reader_t.
@@ -56,20 +111,35 @@ open_single_file_common(const std::string &path, gzFile &out)
     return out != nullptr;
 }
 
+int
+fill_buffer_common(gzip_reader_t *gzip, trace_entry_t *buf, int max_entries)
+{
+    int len;
+    if (gzip->seek_reader)
+        len = gzip->seek_reader->read(buf, max_entries * sizeof(trace_entry_t));
+    else
+        len = gzread(gzip->file, buf, max_entries * sizeof(trace_entry_t));
+    // Returns less than asked-for if at end of file, or –1 for error.
+    // We should always get a multiple of the record size.
+    if (len < static_cast<int>(sizeof(trace_entry_t)) ||
+        len % static_cast<int>(sizeof(trace_entry_t)) != 0)
+        return len >= 0 ? 0 : -1;
+    return len / sizeof(trace_entry_t);
+}
+
 trace_entry_t *
-read_next_entry_common(gzip_reader_t *gzip, bool *eof)
+read_next_entry_common(gzip_reader_t *gzip, int read_ahead_blocks, bool *eof)
 {
     if (gzip->cur_buf >= gzip->max_buf) {
-        int len = gzread(gzip->file, gzip->buf, sizeof(gzip->buf));
-        // Returns less than asked-for if at end of file, or –1 for error.
-        // We should always get a multiple of the record size.
-        if (len < static_cast<int>(sizeof(trace_entry_t)) ||
-            len % static_cast<int>(sizeof(trace_entry_t)) != 0) {
-            *eof = (len >= 0);
+        int count = read_ahead_refill(gzip, read_ahead_blocks,
+                                      [gzip](trace_entry_t *buf, int max_entries) {
+                                          return fill_buffer_common(gzip, buf,
+                                                                    max_entries);
+                                      });
+        if (count <= 0) {
+            *eof = (count == 0);
             return nullptr;
         }
-        gzip->cur_buf = gzip->buf;
-        gzip->max_buf = gzip->buf + (len / sizeof(*gzip->max_buf));
     }
     trace_entry_t *res = gzip->cur_buf;
     ++gzip->cur_buf;
@@ -93,6 +163,8 @@ template <>
 /* clang-format on */
 file_reader_t<gzip_reader_t>::~file_reader_t<gzip_reader_t>()
 {
+    // Stop any helper thread before closing the file it reads.
+    input_file_.read_ahead.reset();
     if (input_file_.file != nullptr) {
         gzclose(input_file_.file);
         input_file_.file = nullptr;
@@ -107,7 +179,26 @@ file_reader_t<gzip_reader_t>::open_single_file(const std::string &path)
     if (!open_single_file_common(path, file))
         return false;
     VPRINT(this, 1, "Opened input file %s\n", path.c_str());
-    input_file_ = gzip_reader_t(file);
+    input_file_.file = file;
+    input_file_.path = path;
+    return true;
+}
+
+template <>
+bool
+file_reader_t<gzip_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk)
+{
+    gzip_reader_t *gzip = &input_file_;
+    // The helper thread owns the file position: stop it.  The next refill starts
+    // a new one at our new position.
+    gzip->read_ahead.reset();
+    gzip->cur_buf = gzip->max_buf;
+    if (!gzip->seek_reader)
+        gzip->seek_reader.reset(new gzip_flush_point_reader_t);
+    if (!gzip->seek_reader->seek(gzip->path, chunk.offset))
+        return false;
+    VPRINT(this, 2, "Seeked to offset %" PRIu64 " in %s\n", chunk.offset,
+           gzip->path.c_str());
     return true;
 }
 
@@ -118,7 +209,7 @@ file_reader_t<gzip_reader_t>::read_next_entry()
     trace_entry_t *entry = read_queued_entry();
     if (entry != nullptr)
         return entry;
-    entry = read_next_entry_common(&input_file_, &at_eof_);
+    entry = read_next_entry_common(&input_file_, read_ahead_blocks_, &at_eof_);
     if (entry == nullptr)
         return entry;
     VPRINT(this, 4, "Read from file: type=%s (%d), size=%d, addr=%zu\n",
@@ -137,6 +228,8 @@ template <>
 record_file_reader_t<gzip_reader_t>::~record_file_reader_t<gzip_reader_t>()
 {
     if (input_file_ != nullptr) {
+        // Stop any helper thread before closing the file it reads.
+        input_file_->read_ahead.reset();
         gzclose(input_file_->file);
     }
 }
@@ -157,7 +250,8 @@ template <>
 bool
 record_file_reader_t<gzip_reader_t>::read_next_entry()
 {
-    trace_entry_t *entry = read_next_entry_common(input_file_.get(), &eof_);
+    trace_entry_t *entry =
+        read_next_entry_common(input_file_.get(), read_ahead_blocks_, &eof_);
     if (entry == nullptr)
         return false;
     cur_entry_ = *entry;
@@ -37,13 +37,40 @@
 
 #include <zlib.h>
 
+#include <fstream>
+#include <memory>
+#include <string>
+
 #include "file_reader.h"
+#include "read_ahead.h"
 #include "record_file_reader.h"
 #include "trace_entry.h"
 
 namespace dynamorio {
 namespace drmemtrace {
 
+// Inflates a gzip file starting at a full-flush point, which gzFile cannot do:
+// it only decompresses from the start of the file.
+class gzip_flush_point_reader_t {
+public:
+    ~gzip_flush_point_reader_t();
+    // Discards any data read so far and moves to the flush point at file offset
+    // "offset".  Returns false on failure.
+    bool
+    seek(const std::string &path, uint64_t offset);
+    // Returns the count of bytes inflated into "buf", which is "size" unless the
+    // end of the data was reached; or -1 on an error.
+    int
+    read(void *buf, int size);
+
+private:
+    std::ifstream file_;
+    z_stream stream_ = {};
+    bool initialized_ = false;
+    bool at_end_ = false;
+    char in_buf_[64 * 1024];
+};
+
 struct gzip_reader_t {
     gzip_reader_t()
         : file(nullptr) {};
@@ -60,9 +87,21 @@ struct gzip_reader_t {
     trace_entry_t buf[4096];
     trace_entry_t *cur_buf = buf;
     trace_entry_t *max_buf = buf;
+    // Non-null once decompression has moved to a helper thread.
+    std::unique_ptr<read_ahead_t> read_ahead;
+    int num_refills = 0;
+    // Non-null once we have seeked to an indexed chunk, after which all data comes
+    // from here rather than from "file".
+    std::unique_ptr<gzip_flush_point_reader_t> seek_reader;
+    std::string path;
 };
 
 typedef file_reader_t<gzip_reader_t> compressed_file_reader_t;
+
+template <>
+bool
+file_reader_t<gzip_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk);
+
 typedef dynamorio::drmemtrace::record_file_reader_t<gzip_reader_t>
     compressed_record_file_reader_t;
 
@@ -128,6 +128,17 @@ config_reader_t::configure(std::istream *config_file, cache_simulator_knobs_t &k
                 ERRMSG("Error reading sim_refs from the configuration file\n");
                 return false;
             }
+        } else if (param == "LL_set_sample_rate") {
+            // Simulate about one in this many sets of each last-level cache.
+            if (!(*fin_ >> knobs.LL_set_sample_rate)) {
+                ERRMSG("Error reading LL_set_sample_rate from "
+                       "the configuration file\n");
+                return false;
+            }
+            if (knobs.LL_set_sample_rate == 0) {
+                ERRMSG("LL_set_sample_rate must be >0\n");
+                return false;
+            }
         } else if (param == "cpu_scheduling") {
             // Whether to simulate CPU scheduling or not.
             std::string bool_val;
@@ -147,6 +158,31 @@ config_reader_t::configure(std::istream *config_file, cache_simulator_knobs_t &k
                 ERRMSG("Error reading verbose from the configuration file\n");
                 return false;
             }
+        } else if (param == "prefetch_degree") {
+            // Lines predicted per trigger by the queueing prefetchers.
+            if (!(*fin_ >> knobs.prefetch_degree)) {
+                ERRMSG("Error reading prefetch_degree from "
+                       "the configuration file\n");
+                return false;
+            }
+        } else if (param == "prefetch_queue_size") {
+            // Entries in the prefetch queue of the queueing prefetchers.
+            if (!(*fin_ >> knobs.prefetch_queue_size)) {
+                ERRMSG("Error reading prefetch_queue_size from "
+                       "the configuration file\n");
+                return false;
+            }
+        } else if (param == "prefetch_table_size") {
+            // Entries in the tables of the queueing prefetchers.
+            if (!(*fin_ >> knobs.prefetch_table_size)) {
+                ERRMSG("Error reading prefetch_table_size from "
+                       "the configuration file\n");
+                return false;
+            }
+            if (knobs.prefetch_table_size == 0) {
+                ERRMSG("Prefetch table size must be >0\n");
+                return false;
+            }
         } else if (param == "coherence" || param == "coherent") {
             // Whether to simulate coherence
             std::string bool_val;
@@ -313,7 +349,9 @@ config_reader_t::configure_cache(cache_params_t &cache)
             }
         } else if (param == "replace_policy") {
             // Cache replacement policy: REPLACE_POLICY_LRU (default),
-            // REPLACE_POLICY_LFU or REPLACE_POLICY_FIFO.
+            // REPLACE_POLICY_LFU, REPLACE_POLICY_FIFO, REPLACE_POLICY_SRRIP,
+            // REPLACE_POLICY_BRRIP, REPLACE_POLICY_DRRIP, REPLACE_POLICY_SHIP
+            // or REPLACE_POLICY_HAWKEYE.
             if (!(*fin_ >> cache.replace_policy)) {
                 ERRMSG("Error reading cache replace_policy from "
                        "the configuration file\n");
@@ -322,19 +360,27 @@ config_reader_t::configure_cache(cache_params_t &cache)
             if (cache.replace_policy != REPLACE_POLICY_NON_SPECIFIED &&
                 cache.replace_policy != REPLACE_POLICY_LRU &&
                 cache.replace_policy != REPLACE_POLICY_LFU &&
-                cache.replace_policy != REPLACE_POLICY_FIFO) {
+                cache.replace_policy != REPLACE_POLICY_FIFO &&
+                cache.replace_policy != REPLACE_POLICY_SRRIP &&
+                cache.replace_policy != REPLACE_POLICY_BRRIP &&
+                cache.replace_policy != REPLACE_POLICY_DRRIP &&
+                cache.replace_policy != REPLACE_POLICY_SHIP &&
+                cache.replace_policy != REPLACE_POLICY_HAWKEYE) {
                 ERRMSG("Unknown replacement policy: %s\n", cache.replace_policy.c_str());
                 return false;
             }
         } else if (param == "prefetcher") {
-            // Type of prefetcher: PREFETCH_POLICY_NEXTLINE
-            // or PREFETCH_POLICY_NONE.
+            // Type of prefetcher: PREFETCH_POLICY_NEXTLINE, PREFETCH_POLICY_STRIDE,
+            // PREFETCH_POLICY_STREAM, PREFETCH_POLICY_GHB or PREFETCH_POLICY_NONE.
             if (!(*fin_ >> cache.prefetcher)) {
                 ERRMSG("Error reading cache prefetcher from "
                        "the configuration file\n");
                 return false;
             }
             if (cache.prefetcher != PREFETCH_POLICY_NEXTLINE &&
+                cache.prefetcher != PREFETCH_POLICY_STRIDE &&
+                cache.prefetcher != PREFETCH_POLICY_STREAM &&
+                cache.prefetcher != PREFETCH_POLICY_GHB &&
                 cache.prefetcher != PREFETCH_POLICY_NONE) {
                 ERRMSG("Unknown prefetcher type: %s\n", cache.prefetcher.c_str());
                 return false;
@@ -51,6 +51,7 @@
 #include "memref.h"
 #include "reader.h"
 #include "trace_entry.h"
+#include "trace_index.h"
 #include "utils.h"
 
 namespace dynamorio {
@@ -102,6 +103,13 @@ public:
         return input_path_.substr(ind + 1);
     }
 
+    // Provided so that instantiations can specialize.
+    uint64_t
+    get_chunk_count() override
+    {
+        return index_.get_entries().size();
+    }
+
 protected:
     trace_entry_t *
     read_next_entry() override;
@@ -116,6 +124,14 @@ protected:
             ERRMSG("Failed to open %s\n", input_path_.c_str());
             return false;
         }
+        // A chunk index is optional: without one, or with a stale one, we skip by
+        // decoding.
+        std::string index_error = index_.read(input_path_);
+        if (index_error.empty()) {
+            VPRINT(this, 1, "Read index of %zu chunks for %s\n",
+                   index_.get_entries().size(), input_path_.c_str());
+        } else
+            VPRINT(this, 2, "Not using an index: %s\n", index_error.c_str());
 
         // First read the tid and pid entries which precede any timestamps.
         // We hand out the tid to the output on every thread switch, and the pid
@@ -172,11 +188,53 @@ protected:
     reader_t &
     skip_instructions(uint64_t instruction_count) override
     {
-        return reader_t::skip_instructions(instruction_count);
+        if (index_.get_entries().empty())
+            return reader_t::skip_instructions(instruction_count);
+        return skip_instructions_with_index(instruction_count);
+    }
+
+    // Seeks to the indexed chunk holding the target instruction if that chunk
+    // lies ahead, and then walks the rest of the way.
+    reader_t &
+    skip_instructions_with_index(uint64_t instruction_count)
+    {
+        if (instruction_count == 0)
+            return *this;
+        if (!pre_skip_instructions())
+            return *this;
+        uint64_t stop_count = cur_instr_count_ + instruction_count;
+        const trace_index_entry_t *chunk = index_.find_instruction(stop_count);
+        if (chunk != nullptr && chunk->instr_count > cur_instr_count_) {
+            VPRINT(this, 2,
+                   "Seeking to chunk at %" PRIu64 " instrs, offset %" PRIu64 "\n",
+                   chunk->instr_count, chunk->offset);
+            if (!seek_to_chunk(*chunk)) {
+                VPRINT(this, 1, "Failed to seek to chunk at offset %" PRIu64 "\n",
+                       chunk->offset);
+                at_eof_ = true;
+                return *this;
+            }
+            // Anything queued came from before the new position.
+            queue_ = std::queue<trace_entry_t>();
+            cur_instr_count_ = chunk->instr_count;
+        }
+        // The chunk starts with a duplicated timestamp and cpu, which the walk
+        // inserts ahead of the target instruction.
+        return skip_instructions_with_timestamp(stop_count);
+    }
+
+    // Positions the input at the start of "chunk", discarding any buffered data.
+    // Provided so that instantiations can specialize: by default we cannot seek.
+    virtual bool
+    seek_to_chunk(const trace_index_entry_t &chunk)
+    {
+        return false;
     }
 
     // Protected for access by mock_file_reader_t.
     T input_file_;
+    // Empty if the input has no chunk index.
+    trace_index_t index_;
 
 private:
     std::string input_path_;
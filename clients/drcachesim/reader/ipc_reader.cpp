@@ -49,13 +49,24 @@ ipc_reader_t::ipc_reader_t()
     /* Empty. */
 }
 
-ipc_reader_t::ipc_reader_t(const char *ipc_name, int verbosity)
+ipc_reader_t::ipc_reader_t(const char *ipc_name, int verbosity, size_t ring_size)
     : reader_t(verbosity, "IPC")
     , pipe_(ipc_name)
+#ifdef HAS_SHM_RING
+    , ring_(ipc_name)
+#endif
+    , use_ring_(ring_size > 0)
 {
-    // We create the pipe here so the user can set up a pipe writer
+    // We create the pipe or ring here so the user can set up a writer
     // *before* calling the blocking analyzer_t::run().
-    creation_success_ = pipe_.create();
+    if (use_ring_) {
+#ifdef HAS_SHM_RING
+        creation_success_ = ring_.create(ring_size, sizeof(trace_entry_t));
+#else
+        creation_success_ = false;
+#endif
+    } else
+        creation_success_ = pipe_.create();
 }
 
 // Work around clang-format bug: no newline after return type for single-char operator.
@@ -70,6 +81,10 @@ ipc_reader_t::operator!()
 std::string
 ipc_reader_t::get_stream_name() const
 {
+#ifdef HAS_SHM_RING
+    if (use_ring_)
+        return ring_.get_path();
+#endif
     return pipe_.get_name();
 }
 
@@ -77,9 +92,18 @@ bool
 ipc_reader_t::init()
 {
     at_eof_ = false;
-    if (!creation_success_ || !pipe_.open_for_read())
+    if (!creation_success_)
         return false;
-    pipe_.maximize_buffer();
+    if (use_ring_) {
+#ifdef HAS_SHM_RING
+        if (!ring_.wait_for_writer())
+            return false;
+#endif
+    } else {
+        if (!pipe_.open_for_read())
+            return false;
+        pipe_.maximize_buffer();
+    }
     cur_buf_ = buf_;
     end_buf_ = buf_;
     ++*this;
@@ -88,8 +112,33 @@ ipc_reader_t::init()
 
 ipc_reader_t::~ipc_reader_t()
 {
-    pipe_.close();
-    pipe_.destroy();
+    if (use_ring_) {
+#ifdef HAS_SHM_RING
+        ring_.destroy();
+#endif
+    } else {
+        pipe_.close();
+        pipe_.destroy();
+    }
+}
+
+ssize_t
+ipc_reader_t::read_next_batch()
+{
+#ifdef HAS_SHM_RING
+    if (use_ring_) {
+        // We read the ring in place, releasing each batch once we move past it.
+        ring_.release_read(ring_held_);
+        void *data;
+        ring_held_ = ring_.acquire_read(&data, sizeof(buf_)); // blocking read
+        if (ring_held_ == 0)
+            return -1;
+        cur_buf_ = reinterpret_cast<trace_entry_t *>(data);
+        return static_cast<ssize_t>(ring_held_);
+    }
+#endif
+    cur_buf_ = buf_;
+    return pipe_.read(buf_, sizeof(buf_)); // blocking read
 }
 
 trace_entry_t *
@@ -100,7 +149,7 @@ ipc_reader_t::read_next_entry()
         return from_queue;
     ++cur_buf_;
     if (cur_buf_ >= end_buf_) {
-        ssize_t sz = pipe_.read(buf_, sizeof(buf_)); // blocking read
+        ssize_t sz = read_next_batch();
         if (sz < 0 || sz % sizeof(*end_buf_) != 0) {
             // If called again at eof, do not return the footer: return an error.
             if (at_eof_)
@@ -115,8 +164,7 @@ ipc_reader_t::read_next_entry()
             at_eof_ = true;
             return cur_buf_;
         }
-        cur_buf_ = buf_;
-        end_buf_ = buf_ + (sz / sizeof(*end_buf_));
+        end_buf_ = cur_buf_ + (sz / sizeof(*end_buf_));
     }
     if (cur_buf_->type == TRACE_TYPE_FOOTER)
         at_eof_ = true;
@@ -41,6 +41,9 @@
 #include "reader.h"
 #include "../common/memref.h"
 #include "../common/named_pipe.h"
+#ifdef HAS_SHM_RING
+#    include "../common/shm_ring.h"
+#endif
 #include "../common/trace_entry.h"
 
 namespace dynamorio {
@@ -49,7 +52,9 @@ namespace drmemtrace {
 class ipc_reader_t : public reader_t {
 public:
     ipc_reader_t();
-    ipc_reader_t(const char *ipc_name, int verbosity);
+    // If ring_size is non-zero, the data arrives through a shm_ring_t of that
+    // size rather than through a named pipe.
+    ipc_reader_t(const char *ipc_name, int verbosity, size_t ring_size = 0);
     virtual ~ipc_reader_t();
     bool
     operator!() override;
@@ -64,7 +69,18 @@ protected:
     read_next_entry() override;
 
 private:
+    // Points cur_buf_ at the next chunk of data and returns its size in bytes,
+    // or < 0 on EOF or an error.  This blocks.
+    ssize_t
+    read_next_batch();
+
     named_pipe_t pipe_;
+#ifdef HAS_SHM_RING
+    shm_ring_t ring_;
+    // The bytes handed to us in place by the ring that we have not yet released.
+    size_t ring_held_ = 0;
+#endif
+    bool use_ring_ = false;
     bool creation_success_;
 
     // For efficiency we want to read large chunks at a time.
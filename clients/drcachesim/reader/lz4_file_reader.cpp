@@ -35,20 +35,32 @@
 namespace dynamorio {
 namespace drmemtrace {
 
+int
+fill_buffer_common(lz4_reader_t *reader, trace_entry_t *buf, int max_entries)
+{
+    int len =
+        reader->file
+            ->read(reinterpret_cast<char *>(buf), max_entries * sizeof(trace_entry_t))
+            .gcount();
+    if (len < static_cast<int>(sizeof(trace_entry_t)) ||
+        len % static_cast<int>(sizeof(trace_entry_t)) != 0)
+        return len >= 0 ? 0 : -1;
+    return len / sizeof(trace_entry_t);
+}
+
 trace_entry_t *
-read_next_entry_common(lz4_reader_t *reader, bool *eof)
+read_next_entry_common(lz4_reader_t *reader, int read_ahead_blocks, bool *eof)
 {
     if (reader->cur_buf >= reader->max_buf) {
-        int len = reader->file
-                      ->read(reinterpret_cast<char *>(&reader->buf), sizeof(reader->buf))
-                      .gcount();
-        if (len < static_cast<int>(sizeof(trace_entry_t)) ||
-            len % static_cast<int>(sizeof(trace_entry_t)) != 0) {
-            *eof = (len >= 0);
+        int count = read_ahead_refill(reader, read_ahead_blocks,
+                                      [reader](trace_entry_t *buf, int max_entries) {
+                                          return fill_buffer_common(reader, buf,
+                                                                    max_entries);
+                                      });
+        if (count <= 0) {
+            *eof = (count == 0);
             return nullptr;
         }
-        reader->cur_buf = reader->buf;
-        reader->max_buf = reader->buf + (len / sizeof(trace_entry_t));
     }
     trace_entry_t *res = reader->cur_buf;
     ++reader->cur_buf;
@@ -72,6 +84,8 @@ template <>
 /* clang-format on */
 file_reader_t<lz4_reader_t>::~file_reader_t<lz4_reader_t>()
 {
+    // Stop any helper thread before deleting the stream it reads.
+    input_file_.read_ahead.reset();
     if (input_file_.file != nullptr) {
         delete input_file_.file;
         input_file_.file = nullptr;
@@ -84,7 +98,23 @@ file_reader_t<lz4_reader_t>::open_single_file(const std::string &path)
 {
     auto file = new lz4_istream_t(path);
     VPRINT(this, 1, "Opened input file %s\n", path.c_str());
-    input_file_ = lz4_reader_t(file);
+    input_file_.file = file;
+    return true;
+}
+
+template <>
+bool
+file_reader_t<lz4_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk)
+{
+    // The helper thread owns the stream position: stop it.  The next refill
+    // starts a new one at our new position.
+    input_file_.read_ahead.reset();
+    input_file_.cur_buf = input_file_.max_buf;
+    // open_single_file() only creates lz4_istream_t.
+    lz4_istream_t *stream = static_cast<lz4_istream_t *>(input_file_.file);
+    if (!stream->seek_to_frame(chunk.offset))
+        return false;
+    VPRINT(this, 2, "Seeked to offset %" PRIu64 "\n", chunk.offset);
     return true;
 }
 
@@ -95,7 +125,7 @@ file_reader_t<lz4_reader_t>::read_next_entry()
     trace_entry_t *entry = read_queued_entry();
     if (entry != nullptr)
         return entry;
-    entry = read_next_entry_common(&input_file_, &at_eof_);
+    entry = read_next_entry_common(&input_file_, read_ahead_blocks_, &at_eof_);
     if (entry == nullptr)
         return entry;
     VPRINT(this, 4, "Read from file: type=%s (%d), size=%d, addr=%zu\n",
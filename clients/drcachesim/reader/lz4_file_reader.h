@@ -35,8 +35,11 @@
 #ifndef _LZ4_FILE_READER_H_
 #define _LZ4_FILE_READER_H_ 1
 
+#include <memory>
+
 #include "common/lz4_istream.h"
 #include "file_reader.h"
+#include "read_ahead.h"
 #include "record_file_reader.h"
 
 namespace dynamorio {
@@ -53,10 +56,17 @@ struct lz4_reader_t {
     trace_entry_t buf[4096];
     trace_entry_t *cur_buf = buf;
     trace_entry_t *max_buf = buf;
+    // Non-null once decompression has moved to a helper thread.
+    std::unique_ptr<read_ahead_t> read_ahead;
+    int num_refills = 0;
 };
 
 typedef file_reader_t<lz4_reader_t> lz4_file_reader_t;
 
+template <>
+bool
+file_reader_t<lz4_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk);
+
 } // namespace drmemtrace
 } // namespace dynamorio
 
@@ -0,0 +1,227 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "mmap_file_reader.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace dynamorio {
+namespace drmemtrace {
+
+/**************************************************
+ * mmap_file_t.
+ */
+
+std::shared_ptr<const mmap_file_t>
+mmap_file_t::open(const std::string &path, std::string &error)
+{
+    // Keyed by path: we only need to catch the common case of several readers
+    // being handed the same trace file.
+    static std::mutex mappings_lock;
+    static std::unordered_map<std::string, std::weak_ptr<const mmap_file_t>> mappings;
+    std::lock_guard<std::mutex> guard(mappings_lock);
+    auto it = mappings.find(path);
+    if (it != mappings.end()) {
+        std::shared_ptr<const mmap_file_t> existing = it->second.lock();
+        if (existing)
+            return existing;
+        mappings.erase(it);
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Failed to open " + path + ": " + strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(trace_entry_t))) {
+        error = "Failed to find records in " + path;
+        close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive.
+    close(fd);
+    if (base == MAP_FAILED) {
+        error = "Failed to map " + path + ": " + strerror(errno);
+        return nullptr;
+    }
+    // This makes the kernel read ahead aggressively for all readers.
+    madvise(base, size, MADV_SEQUENTIAL);
+    std::shared_ptr<const mmap_file_t> file(new mmap_file_t(base, size));
+    mappings[path] = file;
+    return file;
+}
+
+mmap_file_t::~mmap_file_t()
+{
+    munmap(base_, size_);
+}
+
+void
+mmap_file_t::prefetch(const trace_entry_t *start, size_t count) const
+{
+    static const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    if (start >= end())
+        return;
+    const trace_entry_t *stop =
+        static_cast<size_t>(end() - start) > count ? start + count : end();
+    uintptr_t from = reinterpret_cast<uintptr_t>(start) & ~(page_size - 1);
+    uintptr_t to = reinterpret_cast<uintptr_t>(stop);
+    // This is only a hint, so we ignore failures.
+    madvise(reinterpret_cast<void *>(from), to - from, MADV_WILLNEED);
+}
+
+/**************************************************
+ * mmap_reader_t.
+ */
+
+bool
+mmap_reader_t::open(const std::string &path, std::string &error)
+{
+    file = mmap_file_t::open(path, error);
+    if (!file)
+        return false;
+    cur = file->begin();
+    end = file->end();
+    file->prefetch(cur, PREFETCH_WINDOW);
+    // The first next() prefetches the following window.
+    next_prefetch = cur;
+    return true;
+}
+
+/**************************************************
+ * mmap_reader_t specializations for file_reader_t.
+ */
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<mmap_reader_t>::file_reader_t()
+{
+}
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<mmap_reader_t>::~file_reader_t<mmap_reader_t>()
+{
+}
+
+template <>
+bool
+file_reader_t<mmap_reader_t>::open_single_file(const std::string &path)
+{
+    std::string error;
+    if (!input_file_.open(path, error)) {
+        VPRINT(this, 1, "%s\n", error.c_str());
+        return false;
+    }
+    VPRINT(this, 1, "Mapped input file %s\n", path.c_str());
+    return true;
+}
+
+template <>
+trace_entry_t *
+file_reader_t<mmap_reader_t>::read_next_entry()
+{
+    trace_entry_t *from_queue = read_queued_entry();
+    if (from_queue != nullptr)
+        return from_queue;
+    const trace_entry_t *entry = input_file_.next();
+    if (entry == nullptr) {
+        at_eof_ = true;
+        return nullptr;
+    }
+    VPRINT(this, 4, "Read from file: type=%s (%d), size=%d, addr=%zu\n",
+           trace_type_names[entry->type], entry->type, entry->size, entry->addr);
+    // The mapping is read-only and shared with other readers, so we copy the one
+    // record type which process_input_entry() rewrites in place.
+    if (entry->type == TRACE_TYPE_INSTR_MAYBE_FETCH) {
+        entry_copy_ = *entry;
+        return &entry_copy_;
+    }
+    return const_cast<trace_entry_t *>(entry);
+}
+
+/**************************************************
+ * mmap_reader_t specializations for record_file_reader_t.
+ */
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+record_file_reader_t<mmap_reader_t>::~record_file_reader_t<mmap_reader_t>()
+{
+}
+
+template <>
+bool
+record_file_reader_t<mmap_reader_t>::open_single_file(const std::string &path)
+{
+    std::string error;
+    std::unique_ptr<mmap_reader_t> reader(new mmap_reader_t);
+    if (!reader->open(path, error)) {
+        VPRINT(this, 1, "%s\n", error.c_str());
+        return false;
+    }
+    VPRINT(this, 1, "Mapped input file %s\n", path.c_str());
+    input_file_ = std::move(reader);
+    return true;
+}
+
+template <>
+bool
+record_file_reader_t<mmap_reader_t>::read_next_entry()
+{
+    const trace_entry_t *entry = input_file_->next();
+    if (entry == nullptr) {
+        eof_ = true;
+        return false;
+    }
+    cur_entry_ = *entry;
+    VPRINT(this, 4, "Read from file: type=%s (%d), size=%d, addr=%zu\n",
+           trace_type_names[cur_entry_.type], cur_entry_.type, cur_entry_.size,
+           cur_entry_.addr);
+    return true;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,130 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* mmap_file_reader: reads uncompressed files containing memory traces directly
+ * out of a memory mapping.
+ */
+
+#ifndef _MMAP_FILE_READER_H_
+#define _MMAP_FILE_READER_H_ 1
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "file_reader.h"
+#include "record_file_reader.h"
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// A read-only mapping of a whole trace file.  Readers of the same path in one
+// process share a single mapping, so analyzer workers re-reading a trace from the
+// page cache neither copy it nor map it more than once.
+class mmap_file_t {
+public:
+    // Returns the shared mapping of "path", creating it if no reader holds it.
+    // Returns nullptr and sets "error" on failure.
+    static std::shared_ptr<const mmap_file_t>
+    open(const std::string &path, std::string &error);
+
+    ~mmap_file_t();
+
+    const trace_entry_t *
+    begin() const
+    {
+        return reinterpret_cast<const trace_entry_t *>(base_);
+    }
+    // Any trailing partial record is excluded.
+    const trace_entry_t *
+    end() const
+    {
+        return begin() + size_ / sizeof(trace_entry_t);
+    }
+    // Asks the kernel to start reading in up to "count" records from "start"
+    // ahead of our accesses.
+    void
+    prefetch(const trace_entry_t *start, size_t count) const;
+
+private:
+    mmap_file_t(void *base, size_t size)
+        : base_(base)
+        , size_(size)
+    {
+    }
+
+    void *base_;
+    size_t size_;
+};
+
+struct mmap_reader_t {
+    // Records ahead of the current position that we keep prefetched, on top of
+    // the kernel's own sequential read-ahead.
+    static constexpr size_t PREFETCH_WINDOW = (4 << 20) / sizeof(trace_entry_t);
+
+    // Maps "path" and prefetches its start.  Returns false and sets "error" on
+    // failure.
+    bool
+    open(const std::string &path, std::string &error);
+
+    // Returns the next record and advances, or nullptr at the end.
+    const trace_entry_t *
+    next()
+    {
+        if (cur >= end)
+            return nullptr;
+        if (cur >= next_prefetch) {
+            if (end - next_prefetch > static_cast<ptrdiff_t>(PREFETCH_WINDOW)) {
+                next_prefetch += PREFETCH_WINDOW;
+                file->prefetch(next_prefetch, PREFETCH_WINDOW);
+            } else
+                next_prefetch = end;
+        }
+        return cur++;
+    }
+
+    std::shared_ptr<const mmap_file_t> file;
+    const trace_entry_t *cur = nullptr;
+    const trace_entry_t *end = nullptr;
+    // When "cur" reaches this we prefetch the window that follows it.
+    const trace_entry_t *next_prefetch = nullptr;
+};
+
+typedef file_reader_t<mmap_reader_t> mmap_file_reader_t;
+typedef record_file_reader_t<mmap_reader_t> mmap_record_file_reader_t;
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _MMAP_FILE_READER_H_ */
@@ -0,0 +1,184 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* read_ahead: decompresses trace records ahead of a file reader on a helper thread. */
+
+#ifndef _READ_AHEAD_H_
+#define _READ_AHEAD_H_ 1
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+/**
+ * Runs a fill function on a helper thread to decompress the upcoming blocks of
+ * an input into a bounded ring, overlapping decompression with the analysis
+ * consuming the records.  The consumer reads each block in place: a block is
+ * only refilled after the consumer has asked for the block following it.
+ */
+class read_ahead_t {
+public:
+    // Fills "buf" with up to "max_entries" records and returns how many, 0 at the
+    // end of the input, or -1 on an error.  Once a read_ahead_t is constructed it
+    // is only called on the helper thread, so it must not touch state shared with
+    // the consumer.
+    typedef std::function<int(trace_entry_t *buf, int max_entries)> fill_func_t;
+
+    read_ahead_t(int num_blocks, int block_entries, fill_func_t fill)
+        : fill_(std::move(fill))
+        // With fewer than two blocks nothing could be decompressed ahead.
+        , blocks_(num_blocks < 2 ? 2 : num_blocks)
+    {
+        for (block_t &block : blocks_)
+            block.entries.resize(block_entries);
+        thread_ = std::thread(&read_ahead_t::fill_blocks, this);
+    }
+    ~read_ahead_t()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            exit_ = true;
+        }
+        space_cv_.notify_one();
+        thread_.join();
+    }
+
+    // Releases the block returned by the prior call and points "entries" at the
+    // next block, waiting for the helper if it is not ready yet.  Returns the
+    // number of records in the block, or the fill function's 0 or -1 result at
+    // the end of the input, which is then returned by every later call.
+    int
+    next_block(trace_entry_t **entries)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (holding_block_) {
+            holding_block_ = false;
+            ++consumed_;
+            space_cv_.notify_one();
+        }
+        data_cv_.wait(lock, [this] { return produced_ > consumed_; });
+        block_t &block = blocks_[consumed_ % blocks_.size()];
+        if (block.count <= 0)
+            return block.count;
+        holding_block_ = true;
+        *entries = block.entries.data();
+        return block.count;
+    }
+
+private:
+    struct block_t {
+        std::vector<trace_entry_t> entries;
+        int count = 0;
+    };
+
+    void
+    fill_blocks()
+    {
+        for (uint64_t next = 0;; ++next) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                space_cv_.wait(
+                    lock, [&] { return exit_ || next - consumed_ < blocks_.size(); });
+                if (exit_)
+                    return;
+            }
+            // The consumer does not look at this block until produced_ passes it.
+            block_t &block = blocks_[next % blocks_.size()];
+            block.count =
+                fill_(block.entries.data(), static_cast<int>(block.entries.size()));
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                produced_ = next + 1;
+            }
+            data_cv_.notify_one();
+            if (block.count <= 0)
+                return;
+        }
+    }
+
+    fill_func_t fill_;
+    std::vector<block_t> blocks_;
+    std::mutex mutex_;
+    // Signaled when a block has been filled.
+    std::condition_variable data_cv_;
+    // Signaled when a block has been released or on exit.
+    std::condition_variable space_cv_;
+    // The number of blocks filled and the number released by the consumer.
+    uint64_t produced_ = 0;
+    uint64_t consumed_ = 0;
+    bool holding_block_ = false;
+    bool exit_ = false;
+    std::thread thread_;
+};
+
+// Refills the cur_buf..max_buf window of "reader", which is one of the
+// per-format reader structs holding a "buf" array, a "read_ahead" pointer and a
+// "num_refills" counter.  The first refill calls "fill" inline on "buf".  When
+// "num_blocks" is positive, later refills come from a read_ahead_t running
+// "fill" on a helper thread; starting it only then keeps the header reads of
+// init() and a skip_instructions() right after it free to seek in the input.
+// Returns the number of records, 0 at the end of the input, or -1 on an error.
+template <typename T>
+int
+read_ahead_refill(T *reader, int num_blocks, const read_ahead_t::fill_func_t &fill)
+{
+    static constexpr int BUF_ENTRIES = sizeof(reader->buf) / sizeof(trace_entry_t);
+    if (!reader->read_ahead && num_blocks > 0 && reader->num_refills > 0)
+        reader->read_ahead.reset(new read_ahead_t(num_blocks, BUF_ENTRIES, fill));
+    ++reader->num_refills;
+    int count;
+    trace_entry_t *block = reader->buf;
+    if (reader->read_ahead)
+        count = reader->read_ahead->next_block(&block);
+    else
+        count = fill(reader->buf, BUF_ENTRIES);
+    if (count > 0) {
+        reader->cur_buf = block;
+        reader->max_buf = block + count;
+    }
+    return count;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _READ_AHEAD_H_ */
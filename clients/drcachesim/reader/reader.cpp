@@ -83,6 +83,12 @@ reader_t::operator++()
             }
             break;
         }
+        if (stop_instruction_ > 0 && cur_instr_count_ >= stop_instruction_ &&
+            type_is_instr(static_cast<trace_type_t>(input_entry_->type))) {
+            VPRINT(this, 2, "Reached stop instruction %" PRIu64 "\n", stop_instruction_);
+            at_eof_ = true;
+            break;
+        }
         if (input_entry_->type == TRACE_TYPE_FOOTER) {
             VPRINT(this, 2, "At thread EOF\n");
             // We've already presented the thread exit entry to the analyzer.
@@ -466,13 +472,17 @@ reader_t::skip_instructions_with_timestamp(uint64_t stop_instruction_count)
                        cur_ref_count_);
             } else if (next->size == TRACE_MARKER_TYPE_TIMESTAMP) {
                 timestamp = *next;
-                if (prev_was_record_ord)
-                    --cur_ref_count_; // Invisible to ordinals.
-                else
+                // If we walked over the prior chunk's footer, process_input_entry()
+                // already hides the duplicates from the ordinals.
+                if (prev_was_record_ord) {
+                    if (skip_chunk_header_.find(cur_tid_) == skip_chunk_header_.end())
+                        --cur_ref_count_; // Invisible to ordinals.
+                } else
                     found_real_timestamp = true;
             } else if (next->size == TRACE_MARKER_TYPE_CPU_ID) {
                 cpu = *next;
-                if (prev_was_record_ord)
+                if (prev_was_record_ord &&
+                    skip_chunk_header_.find(cur_tid_) == skip_chunk_header_.end())
                     --cur_ref_count_; // Invisible to ordinals.
             } else
                 prev_was_record_ord = false;
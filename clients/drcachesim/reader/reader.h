@@ -98,6 +98,34 @@ public:
     virtual bool
     init() = 0;
 
+    // Asks a reader of compressed files to decompress up to "num_blocks" buffers
+    // ahead on a helper thread.  Must be called prior to init().  Readers without
+    // such support ignore it.
+    void
+    set_read_ahead(int num_blocks)
+    {
+        read_ahead_blocks_ = num_blocks;
+    }
+
+    // Ends the stream early, as though at the end of the input, upon reaching the
+    // instruction after the one whose ordinal is "stop_instruction": the records
+    // following that final instruction up to the next instruction are still
+    // returned.  A value of 0, the default, means no limit.
+    void
+    set_stop_instruction(uint64_t stop_instruction)
+    {
+        stop_instruction_ = stop_instruction;
+    }
+
+    // Returns the number of separately seekable chunks the underlying storage
+    // splits this input into, or 0 if the format has no such division.  Valid
+    // after init().
+    virtual uint64_t
+    get_chunk_count()
+    {
+        return 0;
+    }
+
     virtual const memref_t &
     operator*();
 
@@ -246,6 +274,8 @@ protected:
 
     int verbosity_ = 0;
     bool online_ = true;
+    int read_ahead_blocks_ = 0;
+    uint64_t stop_instruction_ = 0;
     const char *output_prefix_ = "[reader]";
     uint64_t cur_ref_count_ = 0;
     int64_t suppress_ref_count_ = -1;
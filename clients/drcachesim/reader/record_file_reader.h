@@ -135,6 +135,17 @@ public:
         return true;
     }
 
+    /**
+     * Asks a reader of compressed files to decompress up to \p num_blocks buffers
+     * ahead on a helper thread.  Must be called prior to init().  Readers without
+     * such support ignore it.
+     */
+    void
+    set_read_ahead(int num_blocks)
+    {
+        read_ahead_blocks_ = num_blocks;
+    }
+
     const trace_entry_t &
     operator*()
     {
@@ -267,6 +278,7 @@ protected:
     // Following typical stream iterator convention, the default constructor
     // produces an EOF object.
     bool eof_ = true;
+    int read_ahead_blocks_ = 0;
 
 private:
     uint64_t cur_ref_count_ = 0;
@@ -210,7 +210,8 @@ template <>
 /* clang-format on */
 file_reader_t<snappy_reader_t>::~file_reader_t<snappy_reader_t>()
 {
-    // Empty.
+    // Stop any helper thread before the stream it reads goes away.
+    input_file_.read_ahead.reset();
 }
 
 template <>
@@ -232,6 +233,28 @@ file_reader_t<snappy_reader_t>::read_next_entry()
     trace_entry_t *from_queue = read_queued_entry();
     if (from_queue != nullptr)
         return from_queue;
+    if (read_ahead_blocks_ > 0) {
+        snappy_reader_t *snappy = &input_file_;
+        if (snappy->cur_buf >= snappy->max_buf) {
+            auto fill = [snappy](trace_entry_t *buf, int max_entries) {
+                int len = snappy->read(max_entries * sizeof(trace_entry_t), buf);
+                if (len < static_cast<int>(sizeof(trace_entry_t)))
+                    return snappy->eof() ? 0 : -1;
+                return len / static_cast<int>(sizeof(trace_entry_t));
+            };
+            int count = read_ahead_refill(snappy, read_ahead_blocks_, fill);
+            if (count <= 0) {
+                at_eof_ = (count == 0);
+                return nullptr;
+            }
+        }
+        entry_copy_ = *snappy->cur_buf;
+        ++snappy->cur_buf;
+        VPRINT(this, 4, "Read from file: type=%s (%d), size=%d, addr=%zu\n",
+               trace_type_names[entry_copy_.type], entry_copy_.type, entry_copy_.size,
+               entry_copy_.addr);
+        return &entry_copy_;
+    }
     int len = input_file_.read(sizeof(entry_copy_), &entry_copy_);
     // Returns less than asked-for if at end of file, or –1 for error.
     if (len < (int)sizeof(entry_copy_)) {
@@ -47,6 +47,7 @@
 #include <snappy-sinksource.h>
 #include "snappy_consts.h"
 #include "file_reader.h"
+#include "read_ahead.h"
 
 namespace dynamorio {
 namespace drmemtrace {
@@ -68,6 +69,14 @@ public:
         return fstream_->eof();
     }
 
+    // Only used when decompressing on a helper thread: see read_ahead_refill().
+    // Otherwise records are read one at a time through read().
+    trace_entry_t buf[4096] = {};
+    trace_entry_t *cur_buf = buf;
+    trace_entry_t *max_buf = buf;
+    std::unique_ptr<read_ahead_t> read_ahead;
+    int num_refills = 0;
+
 private:
     bool
     read_new_chunk();
@@ -53,6 +53,8 @@ template <>
 /* clang-format on */
 file_reader_t<zipfile_reader_t>::~file_reader_t<zipfile_reader_t>()
 {
+    // Stop any helper thread before closing the file it reads.
+    input_file_.read_ahead.reset();
     if (input_file_.file != nullptr) {
         unzClose(input_file_.file);
         input_file_.file = nullptr;
@@ -66,7 +68,8 @@ file_reader_t<zipfile_reader_t>::open_single_file(const std::string &path)
     unzFile file = unzOpen(path.c_str());
     if (file == nullptr)
         return false;
-    input_file_ = zipfile_reader_t(file, path);
+    input_file_.file = file;
+    input_file_.path = path;
     if (unzGoToFirstFile(file) != UNZ_OK || unzOpenCurrentFile(file) != UNZ_OK)
         return false;
     VPRINT(this, 1, "Opened input file %s\n", path.c_str());
@@ -82,52 +85,65 @@ file_reader_t<zipfile_reader_t>::read_next_entry()
         return from_queue;
     zipfile_reader_t *zipfile = &input_file_;
     if (zipfile->cur_buf >= zipfile->max_buf) {
-        int num_read =
-            unzReadCurrentFile(zipfile->file, zipfile->buf, sizeof(zipfile->buf));
-        if (num_read == 0) {
+        // This may run on a read-ahead thread, so it only touches *zipfile.
+        auto fill = [this, zipfile](trace_entry_t *buf, int max_entries) {
+            int num_read = unzReadCurrentFile(zipfile->file, buf,
+                                              max_entries * sizeof(trace_entry_t));
+            if (num_read == 0) {
 #ifdef DEBUG
-            if (verbosity_ >= 3) {
-                zipfile->name[0] = '\0'; /* Just in case. */
-                // This call is expensive if we do it every time.
-                unzGetCurrentFileInfo64(zipfile->file, nullptr, zipfile->name,
-                                        sizeof(zipfile->name), nullptr, 0, nullptr, 0);
-                VPRINT(this, 3, "Hit end of component %s; opening next component in %s\n",
-                       zipfile->name, zipfile->path.c_str());
-            }
+                if (verbosity_ >= 3) {
+                    zipfile->name[0] = '\0'; /* Just in case. */
+                    // This call is expensive if we do it every time.
+                    unzGetCurrentFileInfo64(zipfile->file, nullptr, zipfile->name,
+                                            sizeof(zipfile->name), nullptr, 0, nullptr,
+                                            0);
+                    VPRINT(this, 3,
+                           "Hit end of component %s; opening next component in %s\n",
+                           zipfile->name, zipfile->path.c_str());
+                }
 #endif
-            // read_next_entry() stored the last-read entry into entry_copy_.
-            if ((entry_copy_.type != TRACE_TYPE_MARKER ||
-                 entry_copy_.size != TRACE_MARKER_TYPE_CHUNK_FOOTER) &&
-                entry_copy_.type != TRACE_TYPE_FOOTER) {
-                zipfile->name[0] = '\0'; /* Just in case. */
-                unzGetCurrentFileInfo64(zipfile->file, nullptr, zipfile->name,
-                                        sizeof(zipfile->name), nullptr, 0, nullptr, 0);
-                VPRINT(this, 1, "Chunk is missing footer: truncation detected in %s %s\n",
-                       zipfile->path.c_str(), zipfile->name);
-                return nullptr;
-            }
-            if (unzCloseCurrentFile(zipfile->file) != UNZ_OK)
-                return nullptr;
-            int res = unzGoToNextFile(zipfile->file);
-            if (res != UNZ_OK) {
-                if (res == UNZ_END_OF_LIST_OF_FILE) {
-                    VPRINT(this, 2, "Hit EOF in %s\n", zipfile->path.c_str());
-                    at_eof_ = true;
+                const trace_entry_t &last = zipfile->last_read;
+                if ((last.type != TRACE_TYPE_MARKER ||
+                     last.size != TRACE_MARKER_TYPE_CHUNK_FOOTER) &&
+                    last.type != TRACE_TYPE_FOOTER) {
+                    zipfile->name[0] = '\0'; /* Just in case. */
+                    unzGetCurrentFileInfo64(zipfile->file, nullptr, zipfile->name,
+                                            sizeof(zipfile->name), nullptr, 0, nullptr,
+                                            0);
+                    VPRINT(this, 1,
+                           "Chunk is missing footer: truncation detected in %s %s\n",
+                           zipfile->path.c_str(), zipfile->name);
+                    return -1;
                 }
-                return nullptr;
+                if (unzCloseCurrentFile(zipfile->file) != UNZ_OK)
+                    return -1;
+                int res = unzGoToNextFile(zipfile->file);
+                if (res != UNZ_OK) {
+                    if (res == UNZ_END_OF_LIST_OF_FILE) {
+                        VPRINT(this, 2, "Hit EOF in %s\n", zipfile->path.c_str());
+                        return 0;
+                    }
+                    return -1;
+                }
+                if (unzOpenCurrentFile(zipfile->file) != UNZ_OK)
+                    return -1;
+                num_read = unzReadCurrentFile(zipfile->file, buf,
+                                              max_entries * sizeof(trace_entry_t));
             }
-            if (unzOpenCurrentFile(zipfile->file) != UNZ_OK)
-                return nullptr;
-            num_read =
-                unzReadCurrentFile(zipfile->file, zipfile->buf, sizeof(zipfile->buf));
-        }
-        if (num_read < static_cast<int>(sizeof(entry_copy_))) {
-            VPRINT(this, 1, "Failed to read: returned %d in %s\n", num_read,
-                   zipfile->path.c_str());
+            if (num_read < static_cast<int>(sizeof(trace_entry_t))) {
+                VPRINT(this, 1, "Failed to read: returned %d in %s\n", num_read,
+                       zipfile->path.c_str());
+                return -1;
+            }
+            int count = num_read / sizeof(trace_entry_t);
+            zipfile->last_read = buf[count - 1];
+            return count;
+        };
+        int count = read_ahead_refill(zipfile, read_ahead_blocks_, fill);
+        if (count <= 0) {
+            at_eof_ = (count == 0);
             return nullptr;
         }
-        zipfile->cur_buf = zipfile->buf;
-        zipfile->max_buf = zipfile->buf + (num_read / sizeof(*zipfile->max_buf));
     }
     entry_copy_ = *zipfile->cur_buf;
     ++zipfile->cur_buf;
@@ -137,12 +153,61 @@ file_reader_t<zipfile_reader_t>::read_next_entry()
     return &entry_copy_;
 }
 
+template <>
+uint64_t
+file_reader_t<zipfile_reader_t>::get_chunk_count()
+{
+    // Each chunk is its own component.  The global info is cached by minizip at
+    // open time so this does not touch the file position used by read-ahead.
+    unz_global_info64 info;
+    if (input_file_.file == nullptr ||
+        unzGetGlobalInfo64(input_file_.file, &info) != UNZ_OK)
+        return 0;
+    return static_cast<uint64_t>(info.number_entry);
+}
+
+template <>
+bool
+file_reader_t<zipfile_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk)
+{
+    zipfile_reader_t *zipfile = &input_file_;
+    // The helper thread owns the file position: stop it.  The next refill starts
+    // a new one at our new position.
+    zipfile->read_ahead.reset();
+    zipfile->cur_buf = zipfile->max_buf;
+    // We are abandoning the component, so a CRC mismatch from closing it early
+    // does not matter, and at the end of the archive none is open.
+    unzCloseCurrentFile(zipfile->file);
+    if (zipfile->components.empty()) {
+        // A walk of the central directory does not decompress anything.
+        int res = unzGoToFirstFile(zipfile->file);
+        while (res == UNZ_OK) {
+            unz64_file_pos pos;
+            if (unzGetFilePos64(zipfile->file, &pos) != UNZ_OK)
+                return false;
+            zipfile->components.push_back(pos);
+            res = unzGoToNextFile(zipfile->file);
+        }
+        if (res != UNZ_END_OF_LIST_OF_FILE)
+            return false;
+    }
+    if (chunk.offset >= zipfile->components.size() ||
+        unzGoToFilePos64(zipfile->file, &zipfile->components[chunk.offset]) != UNZ_OK ||
+        unzOpenCurrentFile(zipfile->file) != UNZ_OK)
+        return false;
+    VPRINT(this, 2, "Seeked to component %" PRIu64 " in %s\n", chunk.offset,
+           zipfile->path.c_str());
+    return true;
+}
+
 template <>
 reader_t &
 file_reader_t<zipfile_reader_t>::skip_instructions(uint64_t instruction_count)
 {
     if (instruction_count == 0)
         return *this;
+    if (!index_.get_entries().empty())
+        return skip_instructions_with_index(instruction_count);
     VPRINT(this, 2, "Skipping %" PRIi64 " instrs in %s\n", instruction_count,
            input_file_.path.c_str());
     if (!pre_skip_instructions())
@@ -153,6 +218,11 @@ file_reader_t<zipfile_reader_t>::skip_instructions(uint64_t instruction_count)
         return *this;
     }
     zipfile_reader_t *zipfile = &input_file_;
+    if (zipfile->read_ahead) {
+        // The helper thread owns the file position, so we cannot jump over chunks.
+        VPRINT(this, 2, "Skipping linearly as read-ahead is active\n");
+        return skip_instructions_with_timestamp(cur_instr_count_ + instruction_count);
+    }
     // We assume our unzGoToNextFile loop is plenty performant and we don't need to
     // know the chunk names to use with a single unzLocateFile.
     uint64_t stop_count = cur_instr_count_ + instruction_count + 1;
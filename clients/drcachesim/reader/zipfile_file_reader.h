@@ -36,8 +36,13 @@
 #define _ZIPFILE_FILE_READER_H_ 1
 
 #include <zlib.h>
+
+#include <memory>
+#include <vector>
+
 #include "minizip/unzip.h"
 #include "file_reader.h"
+#include "read_ahead.h"
 
 namespace dynamorio {
 namespace drmemtrace {
@@ -66,6 +71,14 @@ struct zipfile_reader_t {
     // Store the path and component names for debug messages.
     std::string path;
     char name[128];
+    // The last record read from the file, to check each component ends in a footer.
+    trace_entry_t last_read = {};
+    // Non-null once decompression has moved to a helper thread.
+    std::unique_ptr<read_ahead_t> read_ahead;
+    int num_refills = 0;
+    // The central directory position of each component, filled in on the first
+    // seek to an indexed chunk.
+    std::vector<unz64_file_pos> components;
 };
 
 typedef file_reader_t<zipfile_reader_t> zipfile_file_reader_t;
@@ -77,6 +90,14 @@ template <>
 reader_t &
 file_reader_t<zipfile_reader_t>::skip_instructions(uint64_t instruction_count);
 
+template <>
+uint64_t
+file_reader_t<zipfile_reader_t>::get_chunk_count();
+
+template <>
+bool
+file_reader_t<zipfile_reader_t>::seek_to_chunk(const trace_index_entry_t &chunk);
+
 } // namespace drmemtrace
 } // namespace dynamorio
 
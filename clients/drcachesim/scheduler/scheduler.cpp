@@ -58,6 +58,7 @@
 #    include "lz4_file_reader.h"
 #endif
 #ifdef HAS_ZLIB
+#    include "columnar_file_reader.h"
 #    include "compressed_file_reader.h"
 #endif
 #ifdef HAS_ZIP
@@ -68,6 +69,9 @@
 #ifdef HAS_SNAPPY
 #    include "snappy_file_reader.h"
 #endif
+#ifdef HAS_MMAP
+#    include "mmap_file_reader.h"
+#endif
 #include "directory_iterator.h"
 #include "utils.h"
 #ifdef UNIX
@@ -126,7 +130,11 @@ template <>
 std::unique_ptr<reader_t>
 scheduler_tmpl_t<memref_t, reader_t>::get_reader(const std::string &path, int verbosity)
 {
-#if defined(HAS_SNAPPY) || defined(HAS_ZIP) || defined(HAS_LZ4)
+#if defined(HAS_SNAPPY) || defined(HAS_ZIP) || defined(HAS_LZ4) || defined(HAS_ZLIB)
+#    ifdef HAS_ZLIB
+    if (ends_with(path, ".col"))
+        return std::unique_ptr<reader_t>(new columnar_file_reader_t(path, verbosity));
+#    endif
 #    ifdef HAS_LZ4
     if (ends_with(path, ".lz4")) {
         return std::unique_ptr<reader_t>(new lz4_file_reader_t(path, verbosity));
@@ -158,7 +166,8 @@ scheduler_tmpl_t<memref_t, reader_t>::get_reader(const std::string &path, int ve
             // Skip the auxiliary files.
             if (fname == DRMEMTRACE_MODULE_LIST_FILENAME ||
                 fname == DRMEMTRACE_FUNCTION_LIST_FILENAME ||
-                fname == DRMEMTRACE_ENCODING_FILENAME)
+                fname == DRMEMTRACE_ENCODING_FILENAME ||
+                ends_with(fname, DRMEMTRACE_INDEX_FILE_SUFFIX))
                 continue;
 #    ifdef HAS_SNAPPY
             if (ends_with(*iter, ".sz")) {
@@ -176,9 +185,20 @@ scheduler_tmpl_t<memref_t, reader_t>::get_reader(const std::string &path, int ve
             if (ends_with(path, ".lz4")) {
                 return std::unique_ptr<reader_t>(new lz4_file_reader_t(path, verbosity));
             }
+#    endif
+#    ifdef HAS_ZLIB
+            if (ends_with(*iter, ".col")) {
+                return std::unique_ptr<reader_t>(
+                    new columnar_file_reader_t(path, verbosity));
+            }
 #    endif
         }
     }
+#endif
+#ifdef HAS_MMAP
+    // Uncompressed traces are read in place from a mapping shared by all readers.
+    if (ends_with(path, ".trace"))
+        return std::unique_ptr<reader_t>(new mmap_file_reader_t(path, verbosity));
 #endif
     // No snappy/zlib support, or didn't find a .sz/.zip file.
     return std::unique_ptr<reader_t>(new default_file_reader_t(path, verbosity));
@@ -309,8 +329,14 @@ scheduler_tmpl_t<trace_entry_t, record_reader_t>::get_reader(const std::string &
 {
     // TODO i#5675: Add support for other file formats, particularly
     // .zip files.
-    if (ends_with(path, ".sz") || ends_with(path, ".zip"))
+    if (ends_with(path, ".sz") || ends_with(path, ".zip") || ends_with(path, ".col"))
         return nullptr;
+#ifdef HAS_MMAP
+    if (ends_with(path, ".trace")) {
+        return std::unique_ptr<dynamorio::drmemtrace::record_reader_t>(
+            new mmap_record_file_reader_t(path, verbosity));
+    }
+#endif
     return std::unique_ptr<dynamorio::drmemtrace::record_reader_t>(
         new default_record_file_reader_t(path, verbosity));
 }
@@ -631,11 +657,23 @@ scheduler_tmpl_t<RecordType, ReaderType>::init(
             static_cast<int>(sched_type_t::SCHEDULER_USE_INPUT_ORDINALS));
     }
 
-    // TODO i#5843: Once the speculator supports more options, change the
-    // default.  For now we hardcode nops as the only supported option.
+    // NOPs are always the final fallback for PCs no other strategy can supply.
     options_.flags = static_cast<scheduler_flags_t>(
         static_cast<int>(options_.flags) |
         static_cast<int>(sched_type_t::SCHEDULER_SPECULATE_NOPS));
+    int speculator_flags = spec_type_t::USE_NOPS;
+    if (TESTANY(SCHEDULER_SPECULATE_LAST_FROM_TRACE, options_.flags))
+        speculator_flags |= spec_type_t::LAST_FROM_TRACE;
+    if (TESTANY(SCHEDULER_SPECULATE_AVERAGE_FROM_TRACE, options_.flags))
+        speculator_flags |= spec_type_t::AVERAGE_FROM_TRACE;
+    if (TESTANY(SCHEDULER_SPECULATE_FROM_BINARY, options_.flags)) {
+        if (options_.speculation_binary_source == nullptr) {
+            error_string_ = "SCHEDULER_SPECULATE_FROM_BINARY requires "
+                            "speculation_binary_source";
+            return STATUS_ERROR_INVALID_PARAMETER;
+        }
+        speculator_flags |= spec_type_t::FROM_BINARY;
+    }
 
     outputs_.reserve(output_count);
     if (options_.single_lockstep_output) {
@@ -643,12 +681,11 @@ scheduler_tmpl_t<RecordType, ReaderType>::init(
             new sched_type_t::stream_t(this, 0, verbosity_, output_count));
     }
     for (int i = 0; i < output_count; ++i) {
-        outputs_.emplace_back(this, i,
-                              TESTANY(SCHEDULER_SPECULATE_NOPS, options_.flags)
-                                  ? spec_type_t::USE_NOPS
-                                  // TODO i#5843: Add more flags for other options.
-                                  : spec_type_t::LAST_FROM_TRACE,
-                              create_invalid_record(), verbosity_);
+        outputs_.emplace_back(
+            this, i,
+            static_cast<typename spec_type_t::speculator_flags_t>(speculator_flags),
+            options_.speculation_history_entries, options_.speculation_binary_source,
+            create_invalid_record(), verbosity_);
         if (options_.single_lockstep_output)
             outputs_.back().stream = global_stream_.get();
         if (options_.schedule_record_ostream != nullptr) {
@@ -662,6 +699,12 @@ scheduler_tmpl_t<RecordType, ReaderType>::init(
     }
     VPRINT(this, 1, "%zu inputs\n", inputs_.size());
     live_input_count_.store(static_cast<int>(inputs_.size()), std::memory_order_release);
+    ready_counter_.store(0, std::memory_order_release);
+    last_rebalance_time_.store(0, std::memory_order_release);
+    if (options_.sharded_runqueues && options_.mapping == MAP_TO_ANY_OUTPUT) {
+        for (int i = 0; i < output_count; ++i)
+            runqueues_.emplace_back(new ready_queue_t);
+    }
 
     sched_type_t::scheduler_status_t res = read_switch_sequences();
     if (res != sched_type_t::STATUS_SUCCESS)
@@ -776,7 +819,7 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_initial_schedule(
             // inputs in the queue in any case so it is simplest to insert all and
             // remove the first N rather than sorting the first N separately.
             for (int i = 0; i < static_cast<input_ordinal_t>(inputs_.size()); ++i) {
-                add_to_ready_queue(&inputs_[i]);
+                add_to_queue(ready_queue_, &inputs_[i]);
             }
             for (int i = 0; i < static_cast<output_ordinal_t>(outputs_.size()); ++i) {
                 if (i < static_cast<input_ordinal_t>(inputs_.size())) {
@@ -784,7 +827,7 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_initial_schedule(
 #ifndef NDEBUG
                     sched_type_t::stream_status_t status =
 #endif
-                        pop_from_ready_queue(i, queue_next);
+                        pop_from_queue(ready_queue_, i, queue_next);
                     assert(status == STATUS_OK); // No blocked inputs yet.
                     if (queue_next == nullptr)
                         set_cur_input(i, INVALID_INPUT_ORDINAL);
@@ -803,7 +846,24 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_initial_schedule(
             }
             for (int i = static_cast<output_ordinal_t>(outputs_.size());
                  i < static_cast<input_ordinal_t>(inputs_.size()); ++i) {
-                add_to_ready_queue(&inputs_[i]);
+                add_to_queue(ready_queue_, &inputs_[i]);
+            }
+        }
+        if (!runqueues_.empty()) {
+            // Deal out the rest in order so each queue starts with a similar mix.
+            output_ordinal_t next = 0;
+            while (!ready_queue_.queue.empty()) {
+                input_info_t *input = ready_queue_.queue.top();
+                ready_queue_.queue.pop();
+                output_ordinal_t output = next;
+                if (!input->binding.empty() &&
+                    input->binding.find(output) == input->binding.end())
+                    output = *input->binding.begin();
+                else
+                    next = (next + 1) % static_cast<output_ordinal_t>(outputs_.size());
+                VPRINT(this, 2, "Assigning input #%d to ready queue #%d\n",
+                       input->index, output);
+                add_to_queue(*runqueues_[output], input);
             }
         }
     }
@@ -1285,6 +1345,8 @@ scheduler_tmpl_t<RecordType, ReaderType>::open_reader(
     if (path.empty() || directory_iterator_t::is_directory(path))
         return STATUS_ERROR_INVALID_PARAMETER;
     std::unique_ptr<ReaderType> reader = get_reader(path, verbosity_);
+    if (reader)
+        reader->set_read_ahead(options_.read_ahead_blocks);
     if (!reader || !reader->init()) {
         error_string_ += "Failed to open " + path;
         return STATUS_ERROR_FILE_OPEN_FAILED;
@@ -1345,7 +1407,8 @@ scheduler_tmpl_t<RecordType, ReaderType>::open_readers(
         // Skip the auxiliary files.
         if (fname == DRMEMTRACE_MODULE_LIST_FILENAME ||
             fname == DRMEMTRACE_FUNCTION_LIST_FILENAME ||
-            fname == DRMEMTRACE_ENCODING_FILENAME)
+            fname == DRMEMTRACE_ENCODING_FILENAME ||
+            ends_with(fname, DRMEMTRACE_INDEX_FILE_SUFFIX))
             continue;
         const std::string file = path + DIRSEP + fname;
         sched_type_t::scheduler_status_t res =
@@ -1707,48 +1770,109 @@ scheduler_tmpl_t<RecordType, ReaderType>::close_schedule_segment(output_ordinal_
 
 template <typename RecordType, typename ReaderType>
 bool
-scheduler_tmpl_t<RecordType, ReaderType>::ready_queue_empty()
+scheduler_tmpl_t<RecordType, ReaderType>::ready_queue_empty(output_ordinal_t output)
 {
-    return ready_priority_.empty();
+    if (runqueues_.empty())
+        return ready_queue_.queue.empty();
+    std::lock_guard<std::mutex> guard(runqueues_[output]->lock);
+    return runqueues_[output]->queue.empty();
 }
 
 template <typename RecordType, typename ReaderType>
 void
-scheduler_tmpl_t<RecordType, ReaderType>::add_to_ready_queue(input_info_t *input)
+scheduler_tmpl_t<RecordType, ReaderType>::add_to_ready_queue(output_ordinal_t output,
+                                                             input_info_t *input)
+{
+    if (runqueues_.empty()) {
+        add_to_queue(ready_queue_, input);
+        return;
+    }
+    if (output == INVALID_OUTPUT_ORDINAL) {
+        output = input->last_output == INVALID_OUTPUT_ORDINAL
+            ? input->index % static_cast<output_ordinal_t>(outputs_.size())
+            : input->last_output;
+    }
+    if (!input->binding.empty() && input->binding.find(output) == input->binding.end())
+        output = *input->binding.begin();
+    std::lock_guard<std::mutex> guard(runqueues_[output]->lock);
+    add_to_queue(*runqueues_[output], input);
+}
+
+template <typename RecordType, typename ReaderType>
+void
+scheduler_tmpl_t<RecordType, ReaderType>::add_to_queue(ready_queue_t &queue,
+                                                       input_info_t *input)
 {
     VPRINT(
         this, 4,
         "add_to_ready_queue (pre-size %zu): input %d priority %d timestamp delta %" PRIu64
         " block time %" PRIu64 " start time %" PRIu64 "\n",
-        ready_priority_.size(), input->index, input->priority,
+        queue.queue.size(), input->index, input->priority,
         input->reader->get_last_timestamp() - input->base_timestamp, input->blocked_time,
         input->blocked_start_time);
     if (input->blocked_time > 0)
-        ++num_blocked_;
+        ++queue.num_blocked;
     input->queue_counter = ++ready_counter_;
-    ready_priority_.push(input);
+    queue.queue.push(input);
 }
 
 template <typename RecordType, typename ReaderType>
 typename scheduler_tmpl_t<RecordType, ReaderType>::stream_status_t
 scheduler_tmpl_t<RecordType, ReaderType>::pop_from_ready_queue(
     output_ordinal_t for_output, input_info_t *&new_input)
+{
+    if (runqueues_.empty())
+        return pop_from_queue(ready_queue_, for_output, new_input);
+    sched_type_t::stream_status_t status;
+    {
+        std::lock_guard<std::mutex> guard(runqueues_[for_output]->lock);
+        status = pop_from_queue(*runqueues_[for_output], for_output, new_input);
+    }
+    if (new_input != nullptr)
+        return status;
+    // Nothing runnable here: steal from the next queue with something runnable.
+    // We take one lock at a time to avoid deadlock with other stealers.
+    output_ordinal_t num_outputs = static_cast<output_ordinal_t>(outputs_.size());
+    for (output_ordinal_t i = 1; i < num_outputs; ++i) {
+        output_ordinal_t victim = (for_output + i) % num_outputs;
+        std::lock_guard<std::mutex> guard(runqueues_[victim]->lock);
+        if (runqueues_[victim]->queue.empty())
+            continue;
+        sched_type_t::stream_status_t victim_status =
+            pop_from_queue(*runqueues_[victim], for_output, new_input);
+        if (new_input != nullptr) {
+            VPRINT(this, 3, "pop queue[%d]: stole input %d from queue %d\n", for_output,
+                   new_input->index, victim);
+            ++outputs_[for_output].stats[memtrace_stream_t::SCHED_STAT_RUNQUEUE_STEALS];
+            return STATUS_OK;
+        }
+        if (victim_status == STATUS_IDLE)
+            status = STATUS_IDLE;
+    }
+    return status;
+}
+
+template <typename RecordType, typename ReaderType>
+typename scheduler_tmpl_t<RecordType, ReaderType>::stream_status_t
+scheduler_tmpl_t<RecordType, ReaderType>::pop_from_queue(ready_queue_t &queue,
+                                                         output_ordinal_t for_output,
+                                                         input_info_t *&new_input)
 {
     std::set<input_info_t *> skipped;
     std::set<input_info_t *> blocked;
     input_info_t *res = nullptr;
     sched_type_t::stream_status_t status = STATUS_OK;
-    uint64_t cur_time = (num_blocked_ > 0) ? get_output_time(for_output) : 0;
-    while (!ready_priority_.empty()) {
-        res = ready_priority_.top();
-        ready_priority_.pop();
+    uint64_t cur_time = (queue.num_blocked > 0) ? get_output_time(for_output) : 0;
+    while (!queue.queue.empty()) {
+        res = queue.queue.top();
+        queue.queue.pop();
         if (res->binding.empty() || res->binding.find(for_output) != res->binding.end()) {
             // For blocked inputs, as we don't have interrupts or other regular
             // control points we only check for being unblocked when an input
             // would be chosen to run.  We thus keep blocked inputs in the ready queue.
             if (res->blocked_time > 0) {
                 assert(cur_time > 0);
-                --num_blocked_;
+                --queue.num_blocked;
             }
             if (res->blocked_time > 0 &&
                 cur_time - res->blocked_start_time < res->blocked_time) {
@@ -1773,16 +1897,16 @@ scheduler_tmpl_t<RecordType, ReaderType>::pop_from_ready_queue(
     // Re-add the ones we skipped, but without changing their counters so we preserve
     // the prior FIFO order.
     for (input_info_t *save : skipped)
-        ready_priority_.push(save);
+        queue.queue.push(save);
     // Re-add the blocked ones to the back.
     for (input_info_t *save : blocked)
-        add_to_ready_queue(save);
+        add_to_queue(queue, save);
     VDO(this, 1, {
         static int heartbeat;
         // We are ok with races as the cadence is approximate.
         if (++heartbeat % 500 == 0) {
             VPRINT(this, 1, "heartbeat[%d] %zd in queue; %d blocked => %d %d\n",
-                   for_output, ready_priority_.size(), num_blocked_,
+                   for_output, queue.queue.size(), queue.num_blocked,
                    res == nullptr ? -1 : res->index, status);
         }
     });
@@ -1790,7 +1914,7 @@ scheduler_tmpl_t<RecordType, ReaderType>::pop_from_ready_queue(
         VPRINT(this, 4,
                "pop_from_ready_queue[%d] (post-size %zu): input %d priority %d timestamp "
                "delta %" PRIu64 "\n",
-               for_output, ready_priority_.size(), res->index, res->priority,
+               for_output, queue.queue.size(), res->index, res->priority,
                res->reader->get_last_timestamp() - res->base_timestamp);
         res->blocked_time = 0;
     }
@@ -1798,6 +1922,72 @@ scheduler_tmpl_t<RecordType, ReaderType>::pop_from_ready_queue(
     return status;
 }
 
+template <typename RecordType, typename ReaderType>
+bool
+scheduler_tmpl_t<RecordType, ReaderType>::remove_from_ready_queue(input_info_t *input)
+{
+    auto remove = [input](ready_queue_t &queue) {
+        if (!queue.queue.find(input))
+            return false;
+        queue.queue.erase(input);
+        if (input->blocked_time > 0)
+            --queue.num_blocked;
+        return true;
+    };
+    if (runqueues_.empty())
+        return remove(ready_queue_);
+    for (auto &runqueue : runqueues_) {
+        std::lock_guard<std::mutex> guard(runqueue->lock);
+        if (remove(*runqueue))
+            return true;
+    }
+    return false;
+}
+
+template <typename RecordType, typename ReaderType>
+void
+scheduler_tmpl_t<RecordType, ReaderType>::rebalance_queues(output_ordinal_t output)
+{
+    // We acquire every lock in order, which cannot deadlock with other threads as
+    // they hold at most one.
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(runqueues_.size());
+    for (auto &runqueue : runqueues_)
+        locks.emplace_back(runqueue->lock);
+    std::vector<input_info_t *> ready;
+    for (auto &runqueue : runqueues_) {
+        while (!runqueue->queue.empty()) {
+            ready.push_back(runqueue->queue.top());
+            runqueue->queue.pop();
+        }
+        runqueue->num_blocked = 0;
+    }
+    // Merge the queues into one best-first order and deal that out to the shortest
+    // allowed queue, so the best inputs spread across the outputs.  We keep each
+    // input's counter to preserve FIFO order.
+    std::stable_sort(ready.begin(), ready.end(), [](input_info_t *a, input_info_t *b) {
+        return InputTimestampComparator()(b, a);
+    });
+    std::vector<size_t> lengths(runqueues_.size());
+    for (input_info_t *input : ready) {
+        output_ordinal_t dest = INVALID_OUTPUT_ORDINAL;
+        for (output_ordinal_t i = 0; i < static_cast<output_ordinal_t>(lengths.size());
+             ++i) {
+            if ((input->binding.empty() ||
+                 input->binding.find(i) != input->binding.end()) &&
+                (dest == INVALID_OUTPUT_ORDINAL || lengths[i] < lengths[dest]))
+                dest = i;
+        }
+        assert(dest != INVALID_OUTPUT_ORDINAL);
+        ++lengths[dest];
+        runqueues_[dest]->queue.push(input);
+        if (input->blocked_time > 0)
+            ++runqueues_[dest]->num_blocked;
+    }
+    ++outputs_[output].stats[memtrace_stream_t::SCHED_STAT_RUNQUEUE_REBALANCES];
+    VPRINT(this, 2, "output %d rebalanced %zu ready inputs\n", output, ready.size());
+}
+
 template <typename RecordType, typename ReaderType>
 bool
 scheduler_tmpl_t<RecordType, ReaderType>::syscall_incurs_switch(input_info_t *input,
@@ -1842,7 +2032,7 @@ typename scheduler_tmpl_t<RecordType, ReaderType>::stream_status_t
 scheduler_tmpl_t<RecordType, ReaderType>::set_cur_input(output_ordinal_t output,
                                                         input_ordinal_t input)
 {
-    // XXX i#5843: Merge tracking of current inputs with ready_priority_ to better manage
+    // XXX i#5843: Merge tracking of current inputs with ready_queue_ to better manage
     // the possible 3 states of each input (a live cur_input for an output stream, in
     // the ready_queue_, or at EOF) (4 states once we add i/o wait times).
     assert(output >= 0 && output < static_cast<output_ordinal_t>(outputs_.size()));
@@ -1852,7 +2042,7 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_cur_input(output_ordinal_t output,
     if (prev_input >= 0) {
         if (options_.mapping == MAP_TO_ANY_OUTPUT && prev_input != input &&
             !inputs_[prev_input].at_eof)
-            add_to_ready_queue(&inputs_[prev_input]);
+            add_to_ready_queue(output, &inputs_[prev_input]);
         if (prev_input != input && options_.schedule_record_ostream != nullptr) {
             input_info_t &prev_info = inputs_[prev_input];
             std::lock_guard<std::mutex> lock(*prev_info.lock);
@@ -1884,6 +2074,11 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_cur_input(output_ordinal_t output,
 
     std::lock_guard<std::mutex> lock(*inputs_[input].lock);
 
+    if (inputs_[input].last_output != INVALID_OUTPUT_ORDINAL &&
+        inputs_[input].last_output != output)
+        ++outputs_[output].stats[memtrace_stream_t::SCHED_STAT_MIGRATIONS];
+    inputs_[input].last_output = output;
+
     if (!switch_sequence_.empty() &&
         outputs_[output].stream->get_instruction_ordinal() > 0) {
         sched_type_t::switch_type_t switch_type = SWITCH_INVALID;
@@ -2073,8 +2268,9 @@ scheduler_tmpl_t<RecordType, ReaderType>::pick_next_input(output_ordinal_t outpu
                                                           uint64_t blocked_time)
 {
     sched_type_t::stream_status_t res = sched_type_t::STATUS_OK;
-    bool need_lock =
-        options_.mapping == MAP_TO_ANY_OUTPUT || options_.mapping == MAP_AS_PREVIOUSLY;
+    // Sharded ready queues have their own locks.
+    bool need_lock = (options_.mapping == MAP_TO_ANY_OUTPUT && runqueues_.empty()) ||
+        options_.mapping == MAP_AS_PREVIOUSLY;
     auto scoped_lock = need_lock ? std::unique_lock<std::mutex>(sched_lock_)
                                  : std::unique_lock<std::mutex>();
     input_ordinal_t prev_index = outputs_[output].cur_input;
@@ -2110,6 +2306,19 @@ scheduler_tmpl_t<RecordType, ReaderType>::pick_next_input(output_ordinal_t outpu
                 if (res != sched_type_t::STATUS_OK)
                     return res;
             } else if (options_.mapping == MAP_TO_ANY_OUTPUT) {
+                if (options_.rebalance_period > 0 && !runqueues_.empty()) {
+                    // Whichever output first notices that the period has passed
+                    // does the rebalancing.
+                    uint64_t now = get_output_time(output);
+                    uint64_t last =
+                        last_rebalance_time_.load(std::memory_order_acquire);
+                    if (last == 0) {
+                        last_rebalance_time_.compare_exchange_strong(last, now);
+                    } else if (now > last && now - last >= options_.rebalance_period &&
+                               last_rebalance_time_.compare_exchange_strong(last, now)) {
+                        rebalance_queues(output);
+                    }
+                }
                 if (blocked_time > 0 && prev_index != INVALID_INPUT_ORDINAL) {
                     std::lock_guard<std::mutex> lock(*inputs_[prev_index].lock);
                     if (inputs_[prev_index].blocked_time == 0) {
@@ -2128,10 +2337,9 @@ scheduler_tmpl_t<RecordType, ReaderType>::pick_next_input(output_ordinal_t outpu
                     inputs_[prev_index].switch_to_input = INVALID_INPUT_ORDINAL;
                     // XXX i#5843: Add an invariant check that the next timestamp of the
                     // target is later than the pre-switch-syscall timestamp?
-                    if (ready_priority_.find(target)) {
+                    if (remove_from_ready_queue(target)) {
                         VPRINT(this, 2, "next_record[%d]: direct switch to input %d\n",
                                output, target->index);
-                        ready_priority_.erase(target);
                         index = target->index;
                         // Erase any remaining wait time for the target.
                         if (target->blocked_time > 0) {
@@ -2139,7 +2347,6 @@ scheduler_tmpl_t<RecordType, ReaderType>::pick_next_input(output_ordinal_t outpu
                                    "next_record[%d]: direct switch erasing blocked time "
                                    "for input %d\n",
                                    output, target->index);
-                            --num_blocked_;
                             target->blocked_time = 0;
                         }
                     } else {
@@ -2157,16 +2364,24 @@ scheduler_tmpl_t<RecordType, ReaderType>::pick_next_input(output_ordinal_t outpu
                 }
                 if (index != INVALID_INPUT_ORDINAL) {
                     // We found a direct switch target above.
-                } else if (ready_queue_empty() && blocked_time == 0) {
-                    if (prev_index == INVALID_INPUT_ORDINAL)
-                        return eof_or_idle(output);
-                    auto lock = std::unique_lock<std::mutex>(*inputs_[prev_index].lock);
-                    if (inputs_[prev_index].at_eof) {
-                        lock.unlock();
-                        return eof_or_idle(output);
-                    } else
-                        index = prev_index; // Go back to prior.
-                } else {
+                } else if (ready_queue_empty(output) && blocked_time == 0) {
+                    // With sharded queues, an empty queue of our own does not mean
+                    // there is nothing to run: we leave index invalid to go steal.
+                    if (prev_index == INVALID_INPUT_ORDINAL) {
+                        if (runqueues_.empty())
+                            return eof_or_idle(output);
+                    } else {
+                        auto lock =
+                            std::unique_lock<std::mutex>(*inputs_[prev_index].lock);
+                        if (inputs_[prev_index].at_eof) {
+                            lock.unlock();
+                            if (runqueues_.empty())
+                                return eof_or_idle(output);
+                        } else
+                            index = prev_index; // Go back to prior.
+                    }
+                }
+                if (index == INVALID_INPUT_ORDINAL) {
                     // Give up the input before we go to the queue so we can add
                     // ourselves to the queue.  If we're the highest priority we
                     // shouldn't switch.  The queue preserves FIFO for same-priority
@@ -2611,6 +2826,8 @@ scheduler_tmpl_t<RecordType, ReaderType>::next_record(output_ordinal_t output,
            cur_time);
     VDO(this, 4, print_record(record););
 
+    if (outputs_[output].speculator.uses_trace_history())
+        outputs_[output].speculator.observe(record);
     outputs_[output].last_record = record;
     record_type_has_tid(record, input->last_record_tid);
     return sched_type_t::STATUS_OK;
@@ -2656,6 +2873,8 @@ scheduler_tmpl_t<RecordType, ReaderType>::start_speculation(output_ordinal_t out
         // actual trace storing our resumption context, so we store a sentinel.
         static constexpr addr_t SPECULATION_OUTER_ADDRESS = 0;
         outinfo.speculation_stack.push(SPECULATION_OUTER_ADDRESS);
+        if (!record_type_is_invalid(outinfo.last_record))
+            outinfo.speculator.set_thread(outinfo.last_record);
     } else {
         if (queue_current_record) {
             // XXX i#5843: We'll re-call the speculator so we're assuming a repeatable
@@ -2665,6 +2884,7 @@ scheduler_tmpl_t<RecordType, ReaderType>::start_speculation(output_ordinal_t out
         } else
             outinfo.speculation_stack.push(outinfo.speculate_pc);
     }
+    outinfo.speculator.reset_path();
     // Set the prev in case another start is called before reading a record.
     outinfo.prev_speculate_pc = outinfo.speculate_pc;
     outinfo.speculate_pc = start_address;
@@ -2687,6 +2907,7 @@ scheduler_tmpl_t<RecordType, ReaderType>::stop_speculation(output_ordinal_t outp
     VPRINT(this, 2, "stop_speculation layer=%zu (resume=0x%zx)\n",
            outinfo.speculation_stack.size(), outinfo.speculate_pc);
     outinfo.speculation_stack.pop();
+    outinfo.speculator.reset_path();
     return sched_type_t::STATUS_OK;
 }
 
@@ -2733,6 +2954,16 @@ scheduler_tmpl_t<RecordType, ReaderType>::is_record_kernel(output_ordinal_t outp
     return inputs_[index].reader->is_record_kernel();
 }
 
+template <typename RecordType, typename ReaderType>
+int64_t
+scheduler_tmpl_t<RecordType, ReaderType>::get_statistic(
+    output_ordinal_t output, memtrace_stream_t::schedule_statistic_t stat) const
+{
+    if (stat < 0 || stat >= memtrace_stream_t::SCHED_STAT_TYPE_COUNT)
+        return -1;
+    return outputs_[output].stats[stat];
+}
+
 template <typename RecordType, typename ReaderType>
 typename scheduler_tmpl_t<RecordType, ReaderType>::stream_status_t
 scheduler_tmpl_t<RecordType, ReaderType>::set_output_active(output_ordinal_t output,
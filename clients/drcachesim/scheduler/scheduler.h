@@ -453,7 +453,24 @@ public:
          * of get_shard_index() as documented under that function.
          */
         SCHEDULER_USE_SINGLE_INPUT_ORDINALS = 0x8,
-        // TODO i#5843: Add more speculation flags for other strategies.
+        /**
+         * Specifies that speculation should supply the instruction and data addresses
+         * last seen in the trace at each PC, following the direction last taken out
+         * of it.  PCs not in the history fall back to the other speculation flags and
+         * finally to NOPs.  See #speculation_history_entries.
+         */
+        SCHEDULER_SPECULATE_LAST_FROM_TRACE = 0x10,
+        /**
+         * Like #SCHEDULER_SPECULATE_LAST_FROM_TRACE but supplies a weighted average
+         * of the last few data addresses seen at each PC.
+         */
+        SCHEDULER_SPECULATE_AVERAGE_FROM_TRACE = 0x20,
+        /**
+         * Specifies that speculation should decode instructions from the
+         * application binaries using #speculation_binary_source.  This may be
+         * combined with the trace history flags, which are consulted first.
+         */
+        SCHEDULER_SPECULATE_FROM_BINARY = 0x40,
     };
 
     /**
@@ -607,6 +624,46 @@ public:
          * core outputs.
          */
         bool single_lockstep_output = false;
+        /**
+         * If positive, the reader for each compressed input decompresses up to this
+         * many buffers of 4096 records ahead of the consumer on its own helper
+         * thread, overlapping decompression with the analysis.  The helper starts
+         * when an input's second buffer is needed; after that, skipping within a
+         * zipfile input walks the records instead of jumping over chunks.
+         */
+        int read_ahead_blocks = 0;
+        /**
+         * Applies to #MAP_TO_ANY_OUTPUT.  If true, each output has its own ready
+         * queue under its own lock, in place of one queue under a global lock which
+         * every output must take on every switch.  A preempted or blocked input
+         * returns to the queue of the output it ran on, and an output with nothing
+         * runnable in its own queue steals from the others.  Priorities, timestamp
+         * ordering, and bindings are honored within each queue, but the global
+         * order is only approximated: this trades fidelity for scaling to many
+         * outputs.
+         */
+        bool sharded_runqueues = false;
+        /**
+         * Applies when #sharded_runqueues is set.  If non-zero, each time this much
+         * time has passed since the last rebalancing (as measured by the output
+         * which notices, in the same units as #quantum_duration for
+         * #QUANTUM_TIME), the ready queues are rebalanced to equal lengths, with
+         * the best inputs spread across the queues first.
+         */
+        uint64_t rebalance_period = 0;
+        /**
+         * The number of PCs remembered by each output for
+         * #SCHEDULER_SPECULATE_LAST_FROM_TRACE and
+         * #SCHEDULER_SPECULATE_AVERAGE_FROM_TRACE.
+         */
+        size_t speculation_history_entries =
+            speculator_tmpl_t<RecordType>::DEFAULT_HISTORY_ENTRIES;
+        /**
+         * The source of instructions for #SCHEDULER_SPECULATE_FROM_BINARY, such as
+         * a #dynamorio::drmemtrace::module_instr_source_t.  It is shared by all
+         * outputs and must remain valid for the lifetime of the scheduler.
+         */
+        binary_instr_source_t *speculation_binary_source = nullptr;
     };
 
     /**
@@ -985,6 +1042,37 @@ public:
             return scheduler_->is_record_kernel(ordinal_);
         }
 
+        /**
+         * Returns the value of the specified statistic for this output stream.
+         */
+        int64_t
+        get_schedule_statistic(
+            memtrace_stream_t::schedule_statistic_t stat) const override
+        {
+            return scheduler_->get_statistic(ordinal_, stat);
+        }
+
+        /**
+         * Calls start_speculation() without queueing the current record, for
+         * tools that only have the #dynamorio::drmemtrace::memtrace_stream_t
+         * interface.
+         */
+        bool
+        begin_speculation(addr_t start_address) override
+        {
+            return start_speculation(start_address, false) == sched_type_t::STATUS_OK;
+        }
+
+        /**
+         * Calls stop_speculation(), for tools that only have the
+         * #dynamorio::drmemtrace::memtrace_stream_t interface.
+         */
+        bool
+        end_speculation() override
+        {
+            return stop_speculation() == sched_type_t::STATUS_OK;
+        }
+
     protected:
         scheduler_tmpl_t<RecordType, ReaderType> *scheduler_ = nullptr;
         int ordinal_ = -1;
@@ -1108,8 +1196,8 @@ protected:
         // While the scheduler only hands an input to one output at a time, during
         // scheduling decisions one thread may need to access another's fields.
         // We use a unique_ptr to make this moveable for vector storage.
-        // For inputs not actively assigned to a core but sitting in the ready_queue,
-        // sched_lock_ suffices to synchronize access.
+        // For inputs not actively assigned to a core but sitting in a ready queue,
+        // the lock protecting that queue suffices to synchronize access.
         std::unique_ptr<std::mutex> lock;
         // A tid can be duplicated across workloads so we need the pair of
         // workload index + tid to identify the original input.
@@ -1159,6 +1247,8 @@ protected:
         // Used for time-based quanta.
         uint64_t prev_time_in_quantum = 0;
         uint64_t time_spent_in_quantum = 0;
+        // The output this input last ran on, for counting migrations.
+        output_ordinal_t last_output = INVALID_OUTPUT_ORDINAL;
         // These fields model waiting at a blocking syscall.
         // The units are us for instr quanta and simuilation time for time quanta.
         uint64_t blocked_time = 0;
@@ -1234,10 +1324,13 @@ protected:
         output_info_t(scheduler_tmpl_t<RecordType, ReaderType> *scheduler,
                       output_ordinal_t ordinal,
                       typename spec_type_t::speculator_flags_t speculator_flags,
+                      size_t speculation_history_entries,
+                      binary_instr_source_t *speculation_binary_source,
                       RecordType last_record_init, int verbosity = 0)
             : self_stream(scheduler, ordinal, verbosity)
             , stream(&self_stream)
-            , speculator(speculator_flags, verbosity)
+            , speculator(speculator_flags, verbosity, speculation_history_entries,
+                         speculation_binary_source)
             , last_record(last_record_init)
         {
         }
@@ -1281,6 +1374,8 @@ protected:
         bool at_eof = false;
         // Used for replaying wait periods.
         uint64_t wait_start_time = 0;
+        // Indexed by memtrace_stream_t::schedule_statistic_t.
+        int64_t stats[memtrace_stream_t::SCHED_STAT_TYPE_COUNT] = {};
     };
 
     // Called just once at initialization time to set the initial input-to-output
@@ -1490,6 +1585,10 @@ protected:
     // to kernel execution.
     bool
     is_record_kernel(output_ordinal_t output);
+
+    int64_t
+    get_statistic(output_ordinal_t output,
+                  memtrace_stream_t::schedule_statistic_t stat) const;
     ///////////////////////////////////////////////////////////////////////////
     // Support for ready queues for who to schedule next:
 
@@ -1514,22 +1613,58 @@ protected:
         }
     };
 
-    // sched_lock_ must be held by the caller.
+    // Inputs ready to be scheduled, sorted by priority and then timestamp if timestamp
+    // dependencies are requested.  We use the timestamp delta from the first observed
+    // timestamp in each workload in order to mix inputs from different workloads in the
+    // same queue.  FIFO ordering is used for same-priority entries.
+    struct ready_queue_t {
+        flexible_queue_t<input_info_t *, InputTimestampComparator> queue;
+        // Tracks the count of blocked inputs in "queue".
+        int num_blocked = 0;
+        // Protects this queue when it is one of runqueues_.
+        std::mutex lock;
+    };
+
+    // For sharded_runqueues, "output"'s queue lock must not be held by the caller.
+    // Otherwise sched_lock_ must be held by the caller.
     bool
-    ready_queue_empty();
+    ready_queue_empty(output_ordinal_t output);
+
+    // Adds "input" to the ready queue of "output", which is where it last ran or
+    // INVALID_OUTPUT_ORDINAL.  For sharded_runqueues, no ready queue lock may be
+    // held by the caller.  Otherwise sched_lock_ must be held by the caller.
+    void
+    add_to_ready_queue(output_ordinal_t output, input_info_t *input);
 
-    // sched_lock_ must be held by the caller.
+    // The lock protecting "queue" must be held by the caller.
     void
-    add_to_ready_queue(input_info_t *input);
+    add_to_queue(ready_queue_t &queue, input_info_t *input);
+
+    // The lock protecting "queue" must be held by the caller.
+    stream_status_t
+    pop_from_queue(ready_queue_t &queue, output_ordinal_t for_output,
+                   input_info_t *&new_input);
+
+    // Removes "input" from whichever ready queue holds it.  Returns false if it
+    // is not in a ready queue.  The same locking rules as add_to_ready_queue apply.
+    bool
+    remove_from_ready_queue(input_info_t *input);
+
+    // For sharded_runqueues: evens out the lengths of all of the ready queues.
+    // No ready queue lock may be held by the caller.
+    void
+    rebalance_queues(output_ordinal_t output);
 
     // The input's lock must be held by the caller.
     // Returns a multiplier for how long the input should be considered blocked.
     bool
     syscall_incurs_switch(input_info_t *input, uint64_t &blocked_time);
 
-    // sched_lock_ must be held by the caller.
+    // The same locking rules as add_to_ready_queue apply.
     // "for_output" is which output stream is looking for a new input; only an
     // input which is able to run on that output will be selected.
+    // For sharded_runqueues, if nothing is runnable in for_output's own queue
+    // an input is stolen from another queue.
     stream_status_t
     pop_from_ready_queue(output_ordinal_t for_output, input_info_t *&new_input);
 
@@ -1548,18 +1683,20 @@ protected:
     std::vector<output_info_t> outputs_;
     // We use a central lock for global scheduling.  We assume the synchronization
     // cost is outweighed by the simulator's overhead.  This protects concurrent
-    // access to inputs_.size(), outputs_.size(), ready_priority_, and
-    // ready_counter_.
+    // access to inputs_.size(), outputs_.size(), and ready_queue_.
+    // It is not used for MAP_TO_ANY_OUTPUT with sharded_runqueues.
     std::mutex sched_lock_;
-    // Inputs ready to be scheduled, sorted by priority and then timestamp if timestamp
-    // dependencies are requested.  We use the timestamp delta from the first observed
-    // timestamp in each workload in order to mix inputs from different workloads in the
-    // same queue.  FIFO ordering is used for same-priority entries.
-    flexible_queue_t<input_info_t *, InputTimestampComparator> ready_priority_;
-    // Trackes the count of blocked inputs.  Protected by sched_lock_.
-    int num_blocked_ = 0;
+    // The single ready queue, unless sharded_runqueues is set, in which case this
+    // is only used to order the inputs at initialization time.
+    ready_queue_t ready_queue_;
+    // For sharded_runqueues, one ready queue per output, each under its own lock.
+    // A thread never holds more than one of these locks, except for
+    // rebalance_queues() which acquires them in order.
+    std::vector<std::unique_ptr<ready_queue_t>> runqueues_;
+    // Output time of the last rebalancing of runqueues_.
+    std::atomic<uint64_t> last_rebalance_time_;
     // Global ready queue counter used to provide FIFO for same-priority inputs.
-    uint64_t ready_counter_ = 0;
+    std::atomic<uint64_t> ready_counter_;
     // Count of inputs not yet at eof.
     std::atomic<int> live_input_count_;
     // In replay mode, count of outputs not yet at the end of the replay sequence.
@@ -34,6 +34,7 @@
 
 #include <string.h>
 
+#include <algorithm>
 #include <string>
 
 #include "memref.h"
@@ -56,6 +57,22 @@
 namespace dynamorio {
 namespace drmemtrace {
 
+template <typename RecordType>
+speculator_tmpl_t<RecordType>::speculator_tmpl_t(speculator_flags_t flags,
+                                                 int verbosity, size_t history_entries,
+                                                 binary_instr_source_t *binary_source)
+    : flags_(flags)
+    , verbosity_(verbosity)
+    , binary_source_(binary_source)
+{
+    if (TESTANY(LAST_FROM_TRACE | AVERAGE_FROM_TRACE, flags_)) {
+        size_t size = 1;
+        while (size < history_entries)
+            size <<= 1;
+        history_.resize(size);
+    }
+}
+
 template <typename RecordType>
 std::string
 speculator_tmpl_t<RecordType>::next_record(addr_t &pc, RecordType &record)
@@ -63,31 +80,62 @@ speculator_tmpl_t<RecordType>::next_record(addr_t &pc, RecordType &record)
     return "Not implemented";
 }
 
-template <>
-std::string
-speculator_tmpl_t<memref_t>::next_record(addr_t &pc, memref_t &memref)
+template <typename RecordType>
+void
+speculator_tmpl_t<RecordType>::observe(const RecordType &record)
 {
-    if (TESTANY(LAST_FROM_TRACE | AVERAGE_FROM_TRACE, flags_)) {
-        // TODO i#5843: Add prior-seen-in-trace support by having the scheduler
-        // pass us every record so we can track prior instructions.  Instead of
-        // using the same data address as the most recent instance of a pc,
-        // we should use some weighted average across the last N instances.
-        return "Not implemented";
-    } else if (TESTANY(FROM_BINARY, flags_)) {
-        // TODO i#5843: Add support for grabbing never-seen instructions from the
-        // binary, if available.  We'll need module map info passed to us.
-    } else if (!TESTANY(USE_NOPS, flags_)) {
-        return "Invalid flags";
+    // Only memref_t records are tracked.
+}
+
+template <typename RecordType>
+void
+speculator_tmpl_t<RecordType>::set_thread(const RecordType &record)
+{
+    // Only memref_t records carry a thread.
+}
+
+template <typename RecordType>
+addr_t
+speculator_tmpl_t<RecordType>::predict_address(const data_history_t &data) const
+{
+    int newest = (data.next + ADDRESS_HISTORY - 1) % ADDRESS_HISTORY;
+    if (TESTANY(LAST_FROM_TRACE, flags_) || data.count == 1)
+        return data.addrs[newest];
+    // Weight the most recent instances highest.  We average the distances from
+    // the newest address to avoid overflow.
+    int64_t weighted_sum = 0;
+    int64_t total_weight = 0;
+    for (int i = 0; i < data.count; ++i) {
+        int idx = (data.next + ADDRESS_HISTORY - data.count + i) % ADDRESS_HISTORY;
+        int64_t weight = i + 1;
+        weighted_sum +=
+            weight * static_cast<int64_t>(data.addrs[idx] - data.addrs[newest]);
+        total_weight += weight;
     }
+    addr_t addr = data.addrs[newest] + weighted_sum / total_weight;
+    // Keep the access naturally aligned like the observed ones presumably were.
+    if (data.size > 0 && (data.size & (data.size - 1)) == 0)
+        addr &= ~static_cast<addr_t>(data.size - 1);
+    return addr;
+}
+
+template <typename RecordType>
+std::string
+speculator_tmpl_t<RecordType>::next_nop(addr_t &pc, RecordType &record)
+{
+    return "Not implemented";
+}
 
+template <>
+std::string
+speculator_tmpl_t<memref_t>::next_nop(addr_t &pc, memref_t &memref)
+{
     // Supply nops.
     // Since this is just one encoding, we hardcoded it.
     // If we add more we'll want to pull in DR's encoder and use its IR.
-    // XXX i#5843: Once we add more complex schemes, we'll need to either save
-    // the last record for a given PC or have the scheduler do it, to ensure
-    // resuming a nested speculation layer where the user asked to see the same
-    // instruction again provides the right data.
     memref.instr.type = TRACE_TYPE_INSTR;
+    memref.instr.pid = observed_pid_;
+    memref.instr.tid = observed_tid_;
     memref.instr.addr = pc;
 
     int encoding;
@@ -126,6 +174,131 @@ speculator_tmpl_t<memref_t>::next_record(addr_t &pc, memref_t &memref)
     return "";
 }
 
+template <>
+void
+speculator_tmpl_t<memref_t>::observe(const memref_t &memref)
+{
+    if (history_.empty())
+        return;
+    if (type_is_instr(memref.instr.type)) {
+        addr_t pc = memref.instr.addr;
+        if (observed_pc_ != 0 && memref.instr.tid == observed_tid_) {
+            // Remember the direction last taken out of the prior instruction.
+            // We skip a repeat of the same PC, which is most likely the scheduler
+            // re-delivering an unread record.
+            history_entry_t &prev = history_slot(observed_pc_);
+            if (prev.pc == observed_pc_ && pc != observed_pc_)
+                prev.next_pc = pc;
+        }
+        history_entry_t &entry = history_slot(pc);
+        if (entry.pc != pc) {
+            entry = history_entry_t();
+            entry.pc = pc;
+        }
+        entry.type = memref.instr.type;
+        entry.size = memref.instr.size;
+        memcpy(entry.encoding, memref.instr.encoding,
+               std::min(memref.instr.size, sizeof(entry.encoding)));
+        observed_pc_ = pc;
+        observed_pid_ = memref.instr.pid;
+        observed_tid_ = memref.instr.tid;
+        observed_data_ = 0;
+    } else if ((memref.data.type == TRACE_TYPE_READ ||
+                memref.data.type == TRACE_TYPE_WRITE ||
+                type_is_prefetch(memref.data.type)) &&
+               memref.data.tid == observed_tid_ && memref.data.pc == observed_pc_) {
+        history_entry_t &entry = history_slot(observed_pc_);
+        if (entry.pc != observed_pc_ || observed_data_ >= MAX_DATA_PER_INSTR)
+            return;
+        data_history_t &data = entry.data[observed_data_];
+        if (observed_data_ >= entry.num_data || data.type != memref.data.type ||
+            data.size != memref.data.size) {
+            data = data_history_t();
+            data.type = memref.data.type;
+            data.size = memref.data.size;
+            entry.num_data = std::max(entry.num_data, observed_data_ + 1);
+        }
+        data.addrs[data.next] = memref.data.addr;
+        data.next = (data.next + 1) % ADDRESS_HISTORY;
+        data.count = std::min(data.count + 1, ADDRESS_HISTORY);
+        ++observed_data_;
+    }
+}
+
+template <>
+void
+speculator_tmpl_t<memref_t>::set_thread(const memref_t &memref)
+{
+    observed_pid_ = memref.data.pid;
+    observed_tid_ = memref.data.tid;
+}
+
+template <>
+std::string
+speculator_tmpl_t<memref_t>::next_record(addr_t &pc, memref_t &memref)
+{
+    if (!pending_.empty()) {
+        memref = pending_.front();
+        pending_.pop_front();
+        return "";
+    }
+    if (TESTANY(LAST_FROM_TRACE | AVERAGE_FROM_TRACE, flags_)) {
+        const history_entry_t &entry = history_slot(pc);
+        if (entry.pc == pc) {
+            memref.instr.type = entry.type;
+            memref.instr.pid = observed_pid_;
+            memref.instr.tid = observed_tid_;
+            memref.instr.addr = pc;
+            memref.instr.size = entry.size;
+            memcpy(memref.instr.encoding, entry.encoding, sizeof(entry.encoding));
+            // The trace already supplied this encoding for this PC.
+            memref.instr.encoding_is_new = false;
+            memref.instr.indirect_branch_target = entry.next_pc;
+            for (int i = 0; i < entry.num_data; ++i) {
+                memref_t data = {};
+                data.data.type = entry.data[i].type;
+                data.data.pid = observed_pid_;
+                data.data.tid = observed_tid_;
+                data.data.addr = predict_address(entry.data[i]);
+                data.data.size = entry.data[i].size;
+                data.data.pc = pc;
+                pending_.push_back(data);
+            }
+            VPRINT(this, 4, "pc 0x%zx from history with %d data refs\n", pc,
+                   entry.num_data);
+            pc = entry.next_pc != 0 ? entry.next_pc : pc + entry.size;
+            return "";
+        }
+    }
+    if (TESTANY(FROM_BINARY, flags_)) {
+        if (binary_source_ == nullptr)
+            return "FROM_BINARY requires a binary source";
+        speculated_instr_t instr;
+        std::string error = binary_source_->get_instr(pc, instr);
+        if (error.empty()) {
+            memref.instr.type = instr.type;
+            memref.instr.pid = observed_pid_;
+            memref.instr.tid = observed_tid_;
+            memref.instr.addr = pc;
+            memref.instr.size = instr.size;
+            memcpy(memref.instr.encoding, instr.encoding, sizeof(instr.encoding));
+            memref.instr.encoding_is_new = true;
+            memref.instr.indirect_branch_target = 0;
+            pc = instr.next_pc;
+            return "";
+        }
+        VPRINT(this, 3, "pc 0x%zx not available from binary: %s\n", pc,
+               error.c_str());
+        if (!TESTANY(USE_NOPS, flags_))
+            return error;
+    } else if (!TESTANY(USE_NOPS, flags_)) {
+        return TESTANY(LAST_FROM_TRACE | AVERAGE_FROM_TRACE, flags_)
+            ? "PC not found in trace history"
+            : "Invalid flags";
+    }
+    return next_nop(pc, memref);
+}
+
 template class speculator_tmpl_t<memref_t>;
 template class speculator_tmpl_t<trace_entry_t>;
 
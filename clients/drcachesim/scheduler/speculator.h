@@ -40,7 +40,11 @@
  * @brief DrMemtrace trace speculative path generation.
  */
 
+#include <stddef.h>
+
+#include <deque>
 #include <string>
+#include <vector>
 
 #include "memref.h"
 #include "trace_entry.h"
@@ -49,6 +53,40 @@
 namespace dynamorio {
 namespace drmemtrace {
 
+/**
+ * An instruction supplied by a #dynamorio::drmemtrace::binary_instr_source_t.
+ */
+struct speculated_instr_t {
+    /** The instruction type, such as #TRACE_TYPE_INSTR or a branch type. */
+    trace_type_t type = TRACE_TYPE_INSTR;
+    /** The length of the instruction. */
+    size_t size = 0;
+    /** The raw encoding.  Only the first "size" bytes are valid. */
+    unsigned char encoding[MAX_ENCODING_LENGTH];
+    /**
+     * The address of the next instruction on the path: the target for direct
+     * jumps and calls and the fall-through address otherwise.
+     */
+    addr_t next_pc = 0;
+};
+
+/**
+ * Supplies instructions from the application binaries for
+ * #dynamorio::drmemtrace::speculator_tmpl_t::FROM_BINARY.  A single source is
+ * shared by all scheduler outputs, so implementations must be thread-safe.
+ */
+class binary_instr_source_t {
+public:
+    virtual ~binary_instr_source_t() = default;
+    /**
+     * Fills in "instr" with the instruction at "pc".  Returns an empty string on
+     * success or an error description if "pc" is not in any known binary or could
+     * not be decoded.
+     */
+    virtual std::string
+    get_instr(addr_t pc, speculated_instr_t &instr) = 0;
+};
+
 /**
  * Provides instruction fetch and data access trace record generation for
  * speculative paths that were not actually traced.  Supports a variety of
@@ -73,28 +111,111 @@ public:
          */
         AVERAGE_FROM_TRACE = 0x04,
         /**
-         * Specifies that speculation should obtain the instruction from the binary.
-         * The address source is unspecified.
+         * Specifies that speculation should obtain the instruction from the binary
+         * through the #dynamorio::drmemtrace::binary_instr_source_t passed to the
+         * constructor.  Data addresses are only supplied when combined with
+         * #LAST_FROM_TRACE or #AVERAGE_FROM_TRACE and the instruction was seen in
+         * the trace.
          */
         FROM_BINARY = 0x08,
     };
 
-    /** Default constructor. */
-    speculator_tmpl_t(speculator_flags_t flags, int verbosity = 0)
-        : flags_(flags)
-        , verbosity_(verbosity)
-    {
-    }
+    /** The default number of entries in the per-PC history table. */
+    static constexpr size_t DEFAULT_HISTORY_ENTRIES = 4096;
+
+    /**
+     * Creates a speculator.  Multiple flags may be combined: the trace history is
+     * consulted first, then the binary, and NOPs are supplied last.  The history
+     * table used by #LAST_FROM_TRACE and #AVERAGE_FROM_TRACE holds
+     * "history_entries" PCs (rounded up to a power of 2); a new PC replaces the
+     * prior one in its slot.  "binary_source" is required for #FROM_BINARY and is
+     * not owned by the speculator.
+     */
+    speculator_tmpl_t(speculator_flags_t flags, int verbosity = 0,
+                      size_t history_entries = DEFAULT_HISTORY_ENTRIES,
+                      binary_instr_source_t *binary_source = nullptr);
     virtual ~speculator_tmpl_t() = default;
 
     // Returns a record for the instruction at "pc" and updates "pc" to the
-    // next fetch address.
+    // next fetch address.  For a trace-history instruction with data accesses,
+    // the following calls return those accesses and leave "pc" unchanged.
     virtual std::string
     next_record(addr_t &pc, RecordType &record);
 
+    // Records a non-speculative record from the trace in the history table.
+    virtual void
+    observe(const RecordType &record);
+
+    // Attributes the speculative records that follow to the thread of "record",
+    // the last trace record delivered before the path started.
+    virtual void
+    set_thread(const RecordType &record);
+
+    // Discards any data records still pending for the last instruction returned by
+    // next_record(), for when the speculative path is abandoned.
+    virtual void
+    reset_path()
+    {
+        pending_.clear();
+    }
+
+    // Returns whether observe() needs to be called.
+    bool
+    uses_trace_history() const
+    {
+        return TESTANY(LAST_FROM_TRACE | AVERAGE_FROM_TRACE | FROM_BINARY, flags_);
+    }
+
 protected:
-    speculator_flags_t flags_ = speculator_flags_t::SPECULATE_NOPS;
+    // The number of data accesses remembered per instruction.
+    static constexpr int MAX_DATA_PER_INSTR = 2;
+    // The number of prior addresses remembered per data access.
+    static constexpr int ADDRESS_HISTORY = 4;
+
+    struct data_history_t {
+        trace_type_t type = TRACE_TYPE_READ;
+        size_t size = 0;
+        // A ring buffer of the most recent addresses.
+        addr_t addrs[ADDRESS_HISTORY] = {};
+        int count = 0;
+        int next = 0;
+    };
+
+    struct history_entry_t {
+        addr_t pc = 0; // 0 marks an empty slot.
+        trace_type_t type = TRACE_TYPE_INSTR;
+        size_t size = 0;
+        unsigned char encoding[MAX_ENCODING_LENGTH] = {};
+        // The next instruction seen after this one in the same thread.
+        addr_t next_pc = 0;
+        int num_data = 0;
+        data_history_t data[MAX_DATA_PER_INSTR];
+    };
+
+    history_entry_t &
+    history_slot(addr_t pc)
+    {
+        return history_[(pc ^ (pc >> 16)) & (history_.size() - 1)];
+    }
+
+    addr_t
+    predict_address(const data_history_t &data) const;
+
+    std::string
+    next_nop(addr_t &pc, RecordType &record);
+
+    speculator_flags_t flags_ = speculator_flags_t::USE_NOPS;
     int verbosity_ = 0;
+    const char *output_prefix_ = "[speculator]";
+    binary_instr_source_t *binary_source_ = nullptr;
+    std::vector<history_entry_t> history_;
+    // The last instruction and thread passed to observe().
+    addr_t observed_pc_ = 0;
+    memref_pid_t observed_pid_ = 0;
+    memref_tid_t observed_tid_ = 0;
+    int observed_data_ = 0;
+    // Data records for the last instruction returned by next_record().
+    std::deque<RecordType> pending_;
 };
 
 /** See #dynamorio::drmemtrace::speculator_tmpl_t. */
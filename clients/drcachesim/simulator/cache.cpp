@@ -78,9 +78,9 @@ cache_t::init_blocks()
 }
 
 void
-cache_t::request(const memref_t &memref)
+cache_t::request(const memref_t &memref, cache_result_t *result, int level)
 {
-    caching_device_t::request(memref);
+    caching_device_t::request(memref, result, level);
 }
 
 void
@@ -94,13 +94,13 @@ cache_t::flush(const memref_t &memref)
         auto block_way = find_caching_device_block(tag);
         if (block_way.first == nullptr)
             continue;
-        invalidate_caching_device_block(block_way.first);
+        invalidate_caching_device_block(block_way.first, block_way.second);
     }
     // We flush parent_'s code cache here.
     // XXX: should L1 data cache be flushed when L1 instr cache is flushed?
     if (parent_ != NULL)
         ((cache_t *)parent_)->flush(memref);
-    if (stats_ != NULL)
+    if (stats_ != NULL && mode_ == simulation_mode_t::MEASURE)
         ((cache_stats_t *)stats_)->flush(memref);
 }
 
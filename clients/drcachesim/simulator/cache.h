@@ -69,7 +69,8 @@ public:
          snoop_filter_t *snoop_filter_ = nullptr,
          const std::vector<caching_device_t *> &children = {}) override;
     void
-    request(const memref_t &memref) override;
+    request(const memref_t &memref, cache_result_t *result = nullptr,
+            int level = 0) override;
     virtual void
     flush(const memref_t &memref);
 
@@ -0,0 +1,171 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cache_hawkeye.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cache_rrip.h"
+#include "caching_device.h"
+#include "caching_device_block.h"
+#include "prefetcher.h"
+#include "snoop_filter.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+cache_hawkeye_t::cache_hawkeye_t(const std::string &name)
+    : cache_rrip_t(name, rrip_insertion_t::STATIC, /*rrpv_bits=*/3)
+{
+}
+
+bool
+cache_hawkeye_t::init(int associativity, int block_size, int total_size,
+                      caching_device_t *parent, caching_device_stats_t *stats,
+                      prefetcher_t *prefetcher,
+                      cache_inclusion_policy_t inclusion_policy, bool coherent_cache,
+                      int id, snoop_filter_t *snoop_filter,
+                      const std::vector<caching_device_t *> &children)
+{
+    if (!cache_rrip_t::init(associativity, block_size, total_size, parent, stats,
+                            prefetcher, inclusion_policy, coherent_cache, id,
+                            snoop_filter, children))
+        return false;
+    predictor_.assign(PREDICTOR_SIZE, PREDICTOR_FRIENDLY);
+    signatures_.assign(num_blocks_, 0);
+    history_size_ = HISTORY_PER_WAY * associativity_;
+    int stride = std::max(blocks_per_way_ / NUM_SAMPLED_SETS, 1);
+    optgen_of_set_.assign(blocks_per_way_, -1);
+    optgens_.clear();
+    for (int set = 0; set < blocks_per_way_; set += stride) {
+        optgen_of_set_[set] = static_cast<int>(optgens_.size());
+        optgens_.emplace_back();
+        optgens_.back().occupancy.assign(history_size_, 0);
+    }
+    return true;
+}
+
+void
+cache_hawkeye_t::optgen_access(int optgen_idx, addr_t tag, int sig)
+{
+    optgen_t &optgen = optgens_[optgen_idx];
+    uint64_t now = optgen.time++;
+    optgen.occupancy[now % history_size_] = 0;
+    auto it = optgen.last_access.find(tag);
+    if (it != optgen.last_access.end()) {
+        uint64_t prev = it->second.time;
+        // A reuse beyond the history counts as a miss under Belady's algorithm,
+        // as does one over an interval in which the set is already full.
+        bool opt_hit = now - prev < static_cast<uint64_t>(history_size_);
+        for (uint64_t t = prev; opt_hit && t < now; ++t) {
+            if (optgen.occupancy[t % history_size_] >= associativity_)
+                opt_hit = false;
+        }
+        if (opt_hit) {
+            for (uint64_t t = prev; t < now; ++t)
+                ++optgen.occupancy[t % history_size_];
+        }
+        train(it->second.sig, opt_hit);
+        it->second = { now, sig };
+    } else
+        optgen.last_access.emplace(tag, last_access_t { now, sig });
+    // Drop lines whose last access has left the history.
+    if (optgen.last_access.size() > 4 * static_cast<size_t>(history_size_)) {
+        for (auto entry = optgen.last_access.begin();
+             entry != optgen.last_access.end();) {
+            if (now - entry->second.time >= static_cast<uint64_t>(history_size_))
+                entry = optgen.last_access.erase(entry);
+            else
+                ++entry;
+        }
+    }
+}
+
+void
+cache_hawkeye_t::access_line(int block_idx, int way)
+{
+    int sig = signature(cur_pc_);
+    signatures_[block_idx + way] = static_cast<uint16_t>(sig);
+    int optgen_idx = optgen_of_set_[block_idx / associativity_];
+    if (optgen_idx >= 0) {
+        optgen_access(optgen_idx, get_caching_device_block(block_idx, way).tag_,
+                      sig);
+    }
+    if (predictor_[sig] < PREDICTOR_FRIENDLY) {
+        rrpv_[block_idx + way] = static_cast<uint8_t>(max_rrpv_);
+        return;
+    }
+    // Age the other friendly lines, keeping them below the averse ones.
+    for (int other = 0; other < associativity_; ++other) {
+        if (other != way && rrpv_[block_idx + other] < max_rrpv_ - 1)
+            ++rrpv_[block_idx + other];
+    }
+    rrpv_[block_idx + way] = 0;
+}
+
+void
+cache_hawkeye_t::on_insert(int block_idx, int way)
+{
+    access_line(block_idx, way);
+}
+
+void
+cache_hawkeye_t::on_hit(int block_idx, int way)
+{
+    access_line(block_idx, way);
+}
+
+void
+cache_hawkeye_t::on_evict(int block_idx, int way)
+{
+    // Belady's algorithm would not have evicted a line predicted to be reused.
+    if (rrpv_[block_idx + way] < max_rrpv_)
+        train(signatures_[block_idx + way], false);
+}
+
+int
+cache_hawkeye_t::replace_which_way(int block_idx)
+{
+    // Unlike RRIP, the set is only aged by friendly accesses.
+    int victim_way = get_next_way_to_replace(block_idx);
+    if (get_caching_device_block(block_idx, victim_way).tag_ != TAG_INVALID)
+        on_evict(block_idx, victim_way);
+    return victim_way;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,144 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_hawkeye: represents a single hardware cache with Hawkeye replacement.
+ */
+
+#ifndef _CACHE_HAWKEYE_H_
+#define _CACHE_HAWKEYE_H_ 1
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cache_rrip.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+class snoop_filter_t;
+
+// Implements Hawkeye as described by Jain and Lin in "Back to the Future:
+// Leveraging Belady's Algorithm for Improved Cache Replacement" (ISCA 2016).
+// For a sample of the sets, OPTgen reconstructs whether Belady's algorithm
+// would have kept each line until its reuse, and trains a table of counters
+// indexed by a hash of the PC that last accessed the line.  Lines accessed by
+// PCs predicted cache-friendly get an RRPV of 0 and age the other friendly
+// lines of their set; lines from cache-averse PCs get the maximum RRPV and
+// are evicted first.  Evicting a friendly line detrains its PC.
+class cache_hawkeye_t : public cache_rrip_t {
+public:
+    explicit cache_hawkeye_t(const std::string &name = "cache_hawkeye");
+    bool
+    init(int associativity, int line_size, int total_size, caching_device_t *parent,
+         caching_device_stats_t *stats, prefetcher_t *prefetcher = nullptr,
+         cache_inclusion_policy_t inclusion_policy =
+             cache_inclusion_policy_t::NON_INC_NON_EXC,
+         bool coherent_cache = false, int id_ = -1,
+         snoop_filter_t *snoop_filter_ = nullptr,
+         const std::vector<caching_device_t *> &children = {}) override;
+    std::string
+    get_replace_policy() const override
+    {
+        return "HAWKEYE";
+    }
+
+protected:
+    int
+    replace_which_way(int block_idx) override;
+    void
+    on_insert(int block_idx, int way) override;
+    void
+    on_hit(int block_idx, int way) override;
+    void
+    on_evict(int block_idx, int way) override;
+
+    // Trains on an access to "way" and sets its RRPV from the prediction.
+    void
+    access_line(int block_idx, int way);
+    // Runs OPTgen for an access to "tag" in a sampled set and trains the
+    // predictor with the outcome for the PC that last accessed "tag".
+    void
+    optgen_access(int optgen_idx, addr_t tag, int sig);
+
+    static constexpr int PREDICTOR_SIZE = 8192;
+    static constexpr uint8_t PREDICTOR_MAX = 7;
+    // Counters at or above this predict cache-friendly lines.
+    static constexpr uint8_t PREDICTOR_FRIENDLY = 4;
+    static constexpr int NUM_SAMPLED_SETS = 64;
+    // OPTgen looks this many set accesses, per way, into the past.
+    static constexpr int HISTORY_PER_WAY = 8;
+
+    static int
+    signature(addr_t pc)
+    {
+        return static_cast<int>((pc ^ (pc >> 13)) & (PREDICTOR_SIZE - 1));
+    }
+    void
+    train(int sig, bool opt_hit)
+    {
+        uint8_t &counter = predictor_[sig];
+        if (opt_hit && counter < PREDICTOR_MAX)
+            ++counter;
+        else if (!opt_hit && counter > 0)
+            --counter;
+    }
+
+    struct last_access_t {
+        uint64_t time;
+        int sig;
+    };
+    // OPTgen state of a sampled set.  The occupancy of each time step of the
+    // history is the number of lines Belady's algorithm keeps across it.
+    struct optgen_t {
+        std::vector<uint16_t> occupancy;
+        uint64_t time = 0;
+        std::unordered_map<addr_t, last_access_t> last_access;
+    };
+
+    std::vector<uint8_t> predictor_;
+    // The signature of the PC that last accessed each block, indexed like
+    // blocks_.
+    std::vector<uint16_t> signatures_;
+    // The index into optgens_ of each set, or -1 for unsampled sets.
+    std::vector<int> optgen_of_set_;
+    std::vector<optgen_t> optgens_;
+    int history_size_ = 0;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHE_HAWKEYE_H_ */
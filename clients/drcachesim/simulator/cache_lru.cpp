@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "cache.h"
+#include "cache_set_kernels.h"
 #include "caching_device.h"
 #include "caching_device_block.h"
 #include "caching_device_stats.h"
@@ -44,10 +45,10 @@
 namespace dynamorio {
 namespace drmemtrace {
 
-// For LRU implementation, we use the cache line counter to represent
+// For LRU implementation, we use a per-block age kept in ages_ to represent
 // how recently a cache line is accessed.
-// The count value 0 means the most recent access, and the cache line with the
-// highest counter value will be picked for replacement in replace_which_way.
+// The age 0 means the most recent access, and the cache line with the
+// highest age will be picked for replacement in replace_which_way.
 
 bool
 cache_lru_t::init(int associativity, int block_size, int total_size,
@@ -65,10 +66,11 @@ cache_lru_t::init(int associativity, int block_size, int total_size,
     if (ret_val == false)
         return false;
 
-    // Initialize line counters with 0, 1, 2, ..., associativity - 1.
+    // Initialize line ages with 0, 1, 2, ..., associativity - 1.
+    ages_.resize(num_blocks_);
     for (int i = 0; i < blocks_per_way_; i++) {
         for (int way = 0; way < associativity_; ++way) {
-            get_caching_device_block(i * associativity_, way).counter_ = way;
+            ages_[i * associativity_ + way] = way;
         }
     }
     return true;
@@ -77,17 +79,8 @@ cache_lru_t::init(int associativity, int block_size, int total_size,
 void
 cache_lru_t::access_update(int block_idx, int way)
 {
-    int cnt = get_caching_device_block(block_idx, way).counter_;
-    // Optimization: return early if it is a repeated access.
-    if (cnt == 0)
-        return;
-    // We inc all the counters that are not larger than cnt for LRU.
-    for (int i = 0; i < associativity_; ++i) {
-        if (i != way && get_caching_device_block(block_idx, i).counter_ <= cnt)
-            get_caching_device_block(block_idx, i).counter_++;
-    }
-    // Clear the counter for LRU.
-    get_caching_device_block(block_idx, way).counter_ = 0;
+    // We inc all the ages that are not larger than this way's for LRU.
+    set_kernel_lru_touch(set_kernel_isa_, &ages_[block_idx], associativity_, way);
 }
 
 int
@@ -99,20 +92,10 @@ cache_lru_t::replace_which_way(int block_idx)
 int
 cache_lru_t::get_next_way_to_replace(int block_idx) const
 {
-    // We implement LRU by picking the slot with the largest counter value.
-    int max_counter = 0;
-    int max_way = 0;
-    for (int way = 0; way < associativity_; ++way) {
-        if (get_caching_device_block(block_idx, way).tag_ == TAG_INVALID) {
-            max_way = way;
-            break;
-        }
-        if (get_caching_device_block(block_idx, way).counter_ > max_counter) {
-            max_counter = get_caching_device_block(block_idx, way).counter_;
-            max_way = way;
-        }
-    }
-    return max_way;
+    // We implement LRU by picking the first invalid slot or else the one with the
+    // largest age.
+    return set_kernel_lru_victim(set_kernel_isa_, &tags_[block_idx], &ages_[block_idx],
+                                 associativity_);
 }
 
 } // namespace drmemtrace
@@ -36,6 +36,8 @@
 #ifndef _CACHE_LRU_H_
 #define _CACHE_LRU_H_ 1
 
+#include <stdint.h>
+
 #include <string>
 #include <vector>
 
@@ -73,6 +75,10 @@ protected:
     replace_which_way(int block_idx) override;
     int
     get_next_way_to_replace(const int block_idx) const override;
+
+    // The LRU age of each block, indexed like blocks_ so the set kernels see the
+    // ways of a set contiguously.  0 is the most recently used way.
+    std::vector<int32_t> ages_;
 };
 
 } // namespace drmemtrace
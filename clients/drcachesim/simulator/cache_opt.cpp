@@ -0,0 +1,93 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cache_opt.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "cache.h"
+#include "caching_device.h"
+#include "caching_device_block.h"
+#include "prefetcher.h"
+#include "snoop_filter.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+bool
+cache_opt_t::init(int associativity, int block_size, int total_size,
+                  caching_device_t *parent, caching_device_stats_t *stats,
+                  prefetcher_t *prefetcher, cache_inclusion_policy_t inclusion_policy,
+                  bool coherent_cache, int id, snoop_filter_t *snoop_filter,
+                  const std::vector<caching_device_t *> &children)
+{
+    if (!cache_t::init(associativity, block_size, total_size, parent, stats, prefetcher,
+                       inclusion_policy, coherent_cache, id, snoop_filter, children))
+        return false;
+    // Copied so that the constant is not bound to a reference and ODR-used.
+    const uint64_t never = cache_opt_oracle_t::NEXT_USE_NEVER;
+    next_use_.assign(num_blocks_, never);
+    return true;
+}
+
+void
+cache_opt_t::access_update(int block_idx, int way)
+{
+    assert(oracle_ != nullptr);
+    next_use_[block_idx + way] =
+        oracle_->next_use(get_caching_device_block(block_idx, way).tag_);
+}
+
+int
+cache_opt_t::replace_which_way(int block_idx)
+{
+    return get_next_way_to_replace(block_idx);
+}
+
+int
+cache_opt_t::get_next_way_to_replace(const int block_idx) const
+{
+    int max_way = 0;
+    for (int way = 0; way < associativity_; ++way) {
+        if (tags_[block_idx + way] == TAG_INVALID)
+            return way;
+        if (next_use_[block_idx + way] > next_use_[block_idx + max_way])
+            max_way = way;
+    }
+    return max_way;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,117 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_opt: represents a single hardware cache with Belady's optimal
+ * replacement.
+ */
+
+#ifndef _CACHE_OPT_H_
+#define _CACHE_OPT_H_ 1
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+class snoop_filter_t;
+
+// Supplies cache_opt_t with the future of the reference stream.  Whoever
+// drives the cache keeps the oracle positioned at the reference being
+// simulated.
+class cache_opt_oracle_t {
+public:
+    static constexpr uint64_t NEXT_USE_NEVER = UINT64_MAX;
+
+    virtual ~cache_opt_oracle_t()
+    {
+    }
+    // Returns the position in the reference stream of the first reference
+    // after the current one that touches the line with tag "tag", or
+    // NEXT_USE_NEVER.
+    virtual uint64_t
+    next_use(addr_t tag) = 0;
+};
+
+// Implements Belady's MIN: the victim is the line whose next use is furthest
+// in the future.  Every miss is inserted, so this is the optimum among
+// policies that do not bypass.  As the future is not known while a trace is
+// streamed through the simulator, an oracle must be set before any request,
+// e.g., from a next-use index built in an earlier pass over an offline trace.
+class cache_opt_t : public cache_t {
+public:
+    explicit cache_opt_t(const std::string &name = "cache_opt")
+        : cache_t(name)
+    {
+    }
+    bool
+    init(int associativity, int line_size, int total_size, caching_device_t *parent,
+         caching_device_stats_t *stats, prefetcher_t *prefetcher = nullptr,
+         cache_inclusion_policy_t inclusion_policy =
+             cache_inclusion_policy_t::NON_INC_NON_EXC,
+         bool coherent_cache = false, int id_ = -1,
+         snoop_filter_t *snoop_filter_ = nullptr,
+         const std::vector<caching_device_t *> &children = {}) override;
+    std::string
+    get_replace_policy() const override
+    {
+        return "OPT";
+    }
+    // The oracle is not owned by the cache.
+    void
+    set_oracle(cache_opt_oracle_t *oracle)
+    {
+        oracle_ = oracle;
+    }
+
+protected:
+    void
+    access_update(int block_idx, int way) override;
+    int
+    replace_which_way(int block_idx) override;
+    int
+    get_next_way_to_replace(const int block_idx) const override;
+
+    cache_opt_oracle_t *oracle_ = nullptr;
+    // The next use of each block, indexed like blocks_.
+    std::vector<uint64_t> next_use_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHE_OPT_H_ */
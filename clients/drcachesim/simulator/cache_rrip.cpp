@@ -0,0 +1,197 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cache_rrip.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "caching_device.h"
+#include "caching_device_block.h"
+#include "memref.h"
+#include "prefetcher.h"
+#include "snoop_filter.h"
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+cache_rrip_t::cache_rrip_t(const std::string &name, rrip_insertion_t insertion,
+                           int rrpv_bits)
+    : cache_t(name)
+    , max_rrpv_((1 << rrpv_bits) - 1)
+    , insertion_(insertion)
+{
+}
+
+bool
+cache_rrip_t::init(int associativity, int block_size, int total_size,
+                   caching_device_t *parent, caching_device_stats_t *stats,
+                   prefetcher_t *prefetcher, cache_inclusion_policy_t inclusion_policy,
+                   bool coherent_cache, int id, snoop_filter_t *snoop_filter,
+                   const std::vector<caching_device_t *> &children)
+{
+    if (!cache_t::init(associativity, block_size, total_size, parent, stats, prefetcher,
+                       inclusion_policy, coherent_cache, id, snoop_filter, children))
+        return false;
+    // Empty ways are found before any valid line, so their RRPV does not matter.
+    rrpv_.assign(num_blocks_, static_cast<uint8_t>(max_rrpv_));
+    // Spread the leader sets evenly.  With a single set there is nothing to
+    // duel and it uses static insertion.
+    set_roles_.assign(blocks_per_way_, SET_FOLLOWER);
+    if (insertion_ == rrip_insertion_t::DYNAMIC && blocks_per_way_ > 1) {
+        int stride = std::max(blocks_per_way_ / NUM_LEADER_SETS, 2);
+        for (int set = 0; set + 1 < blocks_per_way_; set += stride) {
+            set_roles_[set] = SET_STATIC_LEADER;
+            set_roles_[set + 1] = SET_BIMODAL_LEADER;
+        }
+    }
+    return true;
+}
+
+std::string
+cache_rrip_t::get_replace_policy() const
+{
+    switch (insertion_) {
+    case rrip_insertion_t::BIMODAL: return "BRRIP";
+    case rrip_insertion_t::DYNAMIC: return "DRRIP";
+    default: return "SRRIP";
+    }
+}
+
+void
+cache_rrip_t::request(const memref_t &memref, cache_result_t *result, int level)
+{
+    cur_pc_ = type_is_instr(memref.instr.type) ? memref.instr.addr : memref.data.pc;
+    inserted_idx_ = -1;
+    cache_t::request(memref, result, level);
+}
+
+bool
+cache_rrip_t::use_bimodal(int block_idx) const
+{
+    switch (insertion_) {
+    case rrip_insertion_t::STATIC: return false;
+    case rrip_insertion_t::BIMODAL: return true;
+    default: break;
+    }
+    switch (set_roles_[block_idx / associativity_]) {
+    case SET_STATIC_LEADER: return false;
+    case SET_BIMODAL_LEADER: return true;
+    default: return psel_ > PSEL_MAX / 2;
+    }
+}
+
+void
+cache_rrip_t::access_update(int block_idx, int way)
+{
+    if (block_idx + way == inserted_idx_) {
+        // The RRPV was set by on_insert().
+        inserted_idx_ = -1;
+        return;
+    }
+    on_hit(block_idx, way);
+}
+
+void
+cache_rrip_t::insert_tag(addr_t tag, bool is_write, int way, int block_idx)
+{
+    cache_t::insert_tag(tag, is_write, way, block_idx);
+    if (insertion_ == rrip_insertion_t::DYNAMIC) {
+        // An insertion is a miss in this set.  Misses in the leaders of one
+        // policy steer the followers towards the other.
+        set_role_t role = set_roles_[block_idx / associativity_];
+        if (role == SET_STATIC_LEADER && psel_ < PSEL_MAX)
+            ++psel_;
+        else if (role == SET_BIMODAL_LEADER && psel_ > 0)
+            --psel_;
+    }
+    on_insert(block_idx, way);
+    inserted_idx_ = block_idx + way;
+}
+
+void
+cache_rrip_t::on_insert(int block_idx, int way)
+{
+    int rrpv = max_rrpv_ - 1;
+    if (use_bimodal(block_idx) && ++bimodal_count_ % BIMODAL_PERIOD != 0)
+        rrpv = max_rrpv_;
+    rrpv_[block_idx + way] = static_cast<uint8_t>(rrpv);
+}
+
+void
+cache_rrip_t::on_hit(int block_idx, int way)
+{
+    rrpv_[block_idx + way] = 0;
+}
+
+void
+cache_rrip_t::on_evict(int block_idx, int way)
+{
+}
+
+int
+cache_rrip_t::replace_which_way(int block_idx)
+{
+    int victim_way = get_next_way_to_replace(block_idx);
+    if (get_caching_device_block(block_idx, victim_way).tag_ == TAG_INVALID)
+        return victim_way;
+    on_evict(block_idx, victim_way);
+    // Age the set until the victim is predicted to be distant, which makes the
+    // victim the first way with the largest RRPV.
+    int age = max_rrpv_ - rrpv_[block_idx + victim_way];
+    if (age > 0) {
+        for (int way = 0; way < associativity_; ++way)
+            rrpv_[block_idx + way] = static_cast<uint8_t>(rrpv_[block_idx + way] + age);
+    }
+    return victim_way;
+}
+
+int
+cache_rrip_t::get_next_way_to_replace(const int block_idx) const
+{
+    int max_way = 0;
+    for (int way = 0; way < associativity_; ++way) {
+        if (tags_[block_idx + way] == TAG_INVALID)
+            return way;
+        if (rrpv_[block_idx + way] > rrpv_[block_idx + max_way])
+            max_way = way;
+    }
+    return max_way;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,150 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_rrip: represents a single hardware cache with re-reference interval
+ * prediction (RRIP) replacement.
+ */
+
+#ifndef _CACHE_RRIP_H_
+#define _CACHE_RRIP_H_ 1
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "memref.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+class snoop_filter_t;
+
+// How a line missing from an RRIP cache is inserted.
+enum class rrip_insertion_t {
+    // SRRIP: always with a long re-reference interval.
+    STATIC,
+    // BRRIP: with a distant interval, and only occasionally a long one, so
+    // that scans and thrashing working sets do not flush the cache.
+    BIMODAL,
+    // DRRIP: leader sets use each of the above and the remaining sets follow
+    // whichever of the two misses less.
+    DYNAMIC,
+};
+
+// Implements RRIP as described by Jaleel et al. in "High Performance Cache
+// Replacement Using Re-Reference Interval Prediction" (ISCA 2010).  Each line
+// has a re-reference prediction value (RRPV) and the victim is the first line
+// predicted to be re-referenced in the distant future, i.e., with the maximum
+// RRPV, after aging the set until there is one.  Hits predict a near-immediate
+// re-reference.
+//
+// Subclasses can change the prediction through on_insert(), on_hit() and
+// on_evict().  They run from the regular access_update(), replace_which_way()
+// and insert_tag() hooks, and can consult the PC of the current request.
+class cache_rrip_t : public cache_t {
+public:
+    explicit cache_rrip_t(const std::string &name = "cache_rrip",
+                          rrip_insertion_t insertion = rrip_insertion_t::STATIC,
+                          int rrpv_bits = 2);
+    bool
+    init(int associativity, int line_size, int total_size, caching_device_t *parent,
+         caching_device_stats_t *stats, prefetcher_t *prefetcher = nullptr,
+         cache_inclusion_policy_t inclusion_policy =
+             cache_inclusion_policy_t::NON_INC_NON_EXC,
+         bool coherent_cache = false, int id_ = -1,
+         snoop_filter_t *snoop_filter_ = nullptr,
+         const std::vector<caching_device_t *> &children = {}) override;
+    void
+    request(const memref_t &memref, cache_result_t *result = nullptr,
+            int level = 0) override;
+    std::string
+    get_replace_policy() const override;
+
+protected:
+    void
+    access_update(int block_idx, int way) override;
+    int
+    replace_which_way(int block_idx) override;
+    int
+    get_next_way_to_replace(const int block_idx) const override;
+    void
+    insert_tag(addr_t tag, bool is_write, int way, int block_idx) override;
+
+    // Sets the RRPV of a line just inserted at "way".
+    virtual void
+    on_insert(int block_idx, int way);
+    // Sets the RRPV of a line at "way" that was hit.
+    virtual void
+    on_hit(int block_idx, int way);
+    // Called when the valid line at "way" is chosen as a victim.
+    virtual void
+    on_evict(int block_idx, int way);
+
+    // Whether the set holding "block_idx" uses bimodal insertion.
+    bool
+    use_bimodal(int block_idx) const;
+
+    int max_rrpv_;
+    rrip_insertion_t insertion_;
+    // The RRPV of each block, indexed like blocks_.
+    std::vector<uint8_t> rrpv_;
+    // The PC of the current request, or 0 when a line is inserted on behalf
+    // of a child's eviction.
+    addr_t cur_pc_ = 0;
+    // The block that insert_tag() just filled, so that the access_update()
+    // that follows it is not mistaken for a hit.
+    int inserted_idx_ = -1;
+
+    // Bimodal insertion uses a long interval once per this many insertions.
+    static constexpr int BIMODAL_PERIOD = 32;
+    int bimodal_count_ = 0;
+
+    // Set dueling state for DYNAMIC insertion: each leader set is tagged with
+    // the policy it uses and misses in them move the policy selector.
+    static constexpr int NUM_LEADER_SETS = 32;
+    static constexpr int PSEL_MAX = 1023;
+    enum set_role_t : uint8_t {
+        SET_FOLLOWER,
+        SET_STATIC_LEADER,
+        SET_BIMODAL_LEADER,
+    };
+    std::vector<set_role_t> set_roles_;
+    int psel_ = PSEL_MAX / 2;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHE_RRIP_H_ */
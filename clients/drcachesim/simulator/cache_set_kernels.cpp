@@ -0,0 +1,267 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_set_kernels: vector implementations selected at runtime.
+ */
+
+#include "cache_set_kernels.h"
+
+#include <stdint.h>
+
+#include "caching_device_block.h"
+#include "memref.h"
+
+// The vector kernels need 64-bit tags and a compiler that can target individual
+// functions at an ISA extension, so that the rest of the build keeps its baseline.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#    define SET_KERNEL_X86 1
+#    include <immintrin.h>
+#endif
+
+namespace dynamorio {
+namespace drmemtrace {
+
+#ifdef SET_KERNEL_X86
+
+__attribute__((target("avx2"))) static int
+find_way_avx2(const addr_t *tags, int assoc, addr_t tag)
+{
+    const __m256i needle = _mm256_set1_epi64x(static_cast<long long>(tag));
+    int way = 0;
+    for (; way + 4 <= assoc; way += 4) {
+        __m256i vals = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(tags + way));
+        int mask =
+            _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(vals, needle)));
+        if (mask != 0)
+            return way + __builtin_ctz(mask);
+    }
+    for (; way < assoc; ++way) {
+        if (tags[way] == tag)
+            return way;
+    }
+    return -1;
+}
+
+__attribute__((target("sse4.1"))) static int
+find_way_sse41(const addr_t *tags, int assoc, addr_t tag)
+{
+    const __m128i needle = _mm_set1_epi64x(static_cast<long long>(tag));
+    int way = 0;
+    for (; way + 2 <= assoc; way += 2) {
+        __m128i vals = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tags + way));
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(vals, needle)));
+        if (mask != 0)
+            return way + __builtin_ctz(mask);
+    }
+    for (; way < assoc; ++way) {
+        if (tags[way] == tag)
+            return way;
+    }
+    return -1;
+}
+
+__attribute__((target("avx2"))) static void
+lru_touch_avx2(int32_t *ages, int assoc, int way)
+{
+    int32_t age = ages[way];
+    const __m256i limit = _mm256_set1_epi32(age);
+    int i = 0;
+    for (; i + 8 <= assoc; i += 8) {
+        __m256i *ptr = reinterpret_cast<__m256i *>(ages + i);
+        __m256i vals = _mm256_loadu_si256(ptr);
+        // Subtracting the all-ones "not older" mask adds one to those lanes.
+        __m256i older = _mm256_cmpgt_epi32(vals, limit);
+        __m256i not_older = _mm256_xor_si256(older, _mm256_set1_epi32(-1));
+        _mm256_storeu_si256(ptr, _mm256_sub_epi32(vals, not_older));
+    }
+    for (; i < assoc; ++i) {
+        if (ages[i] <= age)
+            ++ages[i];
+    }
+    ages[way] = 0;
+}
+
+__attribute__((target("sse4.1"))) static void
+lru_touch_sse41(int32_t *ages, int assoc, int way)
+{
+    int32_t age = ages[way];
+    const __m128i limit = _mm_set1_epi32(age);
+    int i = 0;
+    for (; i + 4 <= assoc; i += 4) {
+        __m128i *ptr = reinterpret_cast<__m128i *>(ages + i);
+        __m128i vals = _mm_loadu_si128(ptr);
+        __m128i older = _mm_cmpgt_epi32(vals, limit);
+        __m128i not_older = _mm_xor_si128(older, _mm_set1_epi32(-1));
+        _mm_storeu_si128(ptr, _mm_sub_epi32(vals, not_older));
+    }
+    for (; i < assoc; ++i) {
+        if (ages[i] <= age)
+            ++ages[i];
+    }
+    ages[way] = 0;
+}
+
+__attribute__((target("avx2"))) static int
+lru_victim_avx2(const addr_t *tags, const int32_t *ages, int assoc)
+{
+    int way = find_way_avx2(tags, assoc, TAG_INVALID);
+    if (way >= 0)
+        return way;
+    // Reduce to the largest age, then find its first lane.  Ages are never
+    // negative so starting the maximum at 0 matches the scalar loop.
+    __m256i max8 = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= assoc; i += 8) {
+        max8 = _mm256_max_epi32(
+            max8, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ages + i)));
+    }
+    __m128i max4 = _mm_max_epi32(_mm256_castsi256_si128(max8),
+                                 _mm256_extracti128_si256(max8, 1));
+    max4 = _mm_max_epi32(max4, _mm_shuffle_epi32(max4, _MM_SHUFFLE(1, 0, 3, 2)));
+    max4 = _mm_max_epi32(max4, _mm_shuffle_epi32(max4, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t max_age = _mm_cvtsi128_si32(max4);
+    for (; i < assoc; ++i) {
+        if (ages[i] > max_age)
+            max_age = ages[i];
+    }
+    const __m256i needle = _mm256_set1_epi32(max_age);
+    for (i = 0; i + 8 <= assoc; i += 8) {
+        __m256i vals = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ages + i));
+        int mask =
+            _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(vals, needle)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    for (; i < assoc; ++i) {
+        if (ages[i] == max_age)
+            return i;
+    }
+    return 0;
+}
+
+__attribute__((target("sse4.1"))) static int
+lru_victim_sse41(const addr_t *tags, const int32_t *ages, int assoc)
+{
+    int way = find_way_sse41(tags, assoc, TAG_INVALID);
+    if (way >= 0)
+        return way;
+    __m128i max4 = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= assoc; i += 4) {
+        max4 = _mm_max_epi32(
+            max4, _mm_loadu_si128(reinterpret_cast<const __m128i *>(ages + i)));
+    }
+    max4 = _mm_max_epi32(max4, _mm_shuffle_epi32(max4, _MM_SHUFFLE(1, 0, 3, 2)));
+    max4 = _mm_max_epi32(max4, _mm_shuffle_epi32(max4, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t max_age = _mm_cvtsi128_si32(max4);
+    for (; i < assoc; ++i) {
+        if (ages[i] > max_age)
+            max_age = ages[i];
+    }
+    const __m128i needle = _mm_set1_epi32(max_age);
+    for (i = 0; i + 4 <= assoc; i += 4) {
+        __m128i vals = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ages + i));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(vals, needle)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    for (; i < assoc; ++i) {
+        if (ages[i] == max_age)
+            return i;
+    }
+    return 0;
+}
+
+#endif /* SET_KERNEL_X86 */
+
+set_kernel_isa_t
+set_kernel_best_isa()
+{
+#ifdef SET_KERNEL_X86
+    static const set_kernel_isa_t isa = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return SET_KERNEL_AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return SET_KERNEL_SSE41;
+        return SET_KERNEL_SCALAR;
+    }();
+    return isa;
+#else
+    return SET_KERNEL_SCALAR;
+#endif
+}
+
+int
+set_kernel_find_way_vector(set_kernel_isa_t isa, const addr_t *tags, int assoc,
+                           addr_t tag)
+{
+#ifdef SET_KERNEL_X86
+    if (isa == SET_KERNEL_AVX2)
+        return find_way_avx2(tags, assoc, tag);
+    if (isa == SET_KERNEL_SSE41)
+        return find_way_sse41(tags, assoc, tag);
+#endif
+    return set_kernel_find_way(SET_KERNEL_SCALAR, tags, assoc, tag);
+}
+
+void
+set_kernel_lru_touch_vector(set_kernel_isa_t isa, int32_t *ages, int assoc, int way)
+{
+#ifdef SET_KERNEL_X86
+    if (isa == SET_KERNEL_AVX2) {
+        lru_touch_avx2(ages, assoc, way);
+        return;
+    }
+    if (isa == SET_KERNEL_SSE41) {
+        lru_touch_sse41(ages, assoc, way);
+        return;
+    }
+#endif
+    set_kernel_lru_touch(SET_KERNEL_SCALAR, ages, assoc, way);
+}
+
+int
+set_kernel_lru_victim_vector(set_kernel_isa_t isa, const addr_t *tags,
+                             const int32_t *ages, int assoc)
+{
+#ifdef SET_KERNEL_X86
+    if (isa == SET_KERNEL_AVX2)
+        return lru_victim_avx2(tags, ages, assoc);
+    if (isa == SET_KERNEL_SSE41)
+        return lru_victim_sse41(tags, ages, assoc);
+#endif
+    return set_kernel_lru_victim(SET_KERNEL_SCALAR, tags, ages, assoc);
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
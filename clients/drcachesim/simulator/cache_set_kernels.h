@@ -0,0 +1,127 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_set_kernels: tag match and LRU kernels over one cache set stored as
+ * contiguous per-way arrays.
+ */
+
+#ifndef _CACHE_SET_KERNELS_H_
+#define _CACHE_SET_KERNELS_H_ 1
+
+#include <stdint.h>
+
+#include "caching_device_block.h"
+#include "memref.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+enum set_kernel_isa_t {
+    SET_KERNEL_SCALAR,
+    SET_KERNEL_SSE41,
+    SET_KERNEL_AVX2,
+};
+
+// Returns the best kernel variant supported by the processor we are running on.
+set_kernel_isa_t
+set_kernel_best_isa();
+
+// Below this many ways the vector kernels do not pay for their call.
+static constexpr int SET_KERNEL_MIN_VECTOR_WAYS = 8;
+
+// Out-of-line vector implementations of the functions below.
+int
+set_kernel_find_way_vector(set_kernel_isa_t isa, const addr_t *tags, int assoc,
+                           addr_t tag);
+void
+set_kernel_lru_touch_vector(set_kernel_isa_t isa, int32_t *ages, int assoc, int way);
+int
+set_kernel_lru_victim_vector(set_kernel_isa_t isa, const addr_t *tags,
+                             const int32_t *ages, int assoc);
+
+// Returns the first way of the set "tags" holding "tag", or -1.
+inline int
+set_kernel_find_way(set_kernel_isa_t isa, const addr_t *tags, int assoc, addr_t tag)
+{
+    if (isa != SET_KERNEL_SCALAR && assoc >= SET_KERNEL_MIN_VECTOR_WAYS)
+        return set_kernel_find_way_vector(isa, tags, assoc, tag);
+    for (int way = 0; way < assoc; ++way) {
+        if (tags[way] == tag)
+            return way;
+    }
+    return -1;
+}
+
+// Makes "way" the most recently used: every way no older than it ages by one
+// and it becomes age 0.
+inline void
+set_kernel_lru_touch(set_kernel_isa_t isa, int32_t *ages, int assoc, int way)
+{
+    int32_t age = ages[way];
+    // Optimization: return early if it is a repeated access.
+    if (age == 0)
+        return;
+    if (isa != SET_KERNEL_SCALAR && assoc >= SET_KERNEL_MIN_VECTOR_WAYS) {
+        set_kernel_lru_touch_vector(isa, ages, assoc, way);
+        return;
+    }
+    for (int i = 0; i < assoc; ++i) {
+        if (ages[i] <= age)
+            ++ages[i];
+    }
+    ages[way] = 0;
+}
+
+// Returns the first invalid way, or else the first way with the largest age.
+inline int
+set_kernel_lru_victim(set_kernel_isa_t isa, const addr_t *tags, const int32_t *ages,
+                      int assoc)
+{
+    if (isa != SET_KERNEL_SCALAR && assoc >= SET_KERNEL_MIN_VECTOR_WAYS)
+        return set_kernel_lru_victim_vector(isa, tags, ages, assoc);
+    int32_t max_age = 0;
+    int max_way = 0;
+    for (int way = 0; way < assoc; ++way) {
+        if (tags[way] == TAG_INVALID)
+            return way;
+        if (ages[way] > max_age) {
+            max_age = ages[way];
+            max_way = way;
+        }
+    }
+    return max_way;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHE_SET_KERNELS_H_ */
@@ -0,0 +1,103 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cache_ship.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "cache_rrip.h"
+#include "caching_device.h"
+#include "prefetcher.h"
+#include "snoop_filter.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+cache_ship_t::cache_ship_t(const std::string &name)
+    : cache_rrip_t(name, rrip_insertion_t::STATIC)
+{
+}
+
+bool
+cache_ship_t::init(int associativity, int block_size, int total_size,
+                   caching_device_t *parent, caching_device_stats_t *stats,
+                   prefetcher_t *prefetcher, cache_inclusion_policy_t inclusion_policy,
+                   bool coherent_cache, int id, snoop_filter_t *snoop_filter,
+                   const std::vector<caching_device_t *> &children)
+{
+    if (!cache_rrip_t::init(associativity, block_size, total_size, parent, stats,
+                            prefetcher, inclusion_policy, coherent_cache, id,
+                            snoop_filter, children))
+        return false;
+    // Start every signature weakly re-referenced so new PCs get SRRIP's
+    // insertion until proven otherwise.
+    shct_.assign(SHCT_SIZE, 1);
+    signatures_.assign(num_blocks_, 0);
+    reused_.assign(num_blocks_, false);
+    return true;
+}
+
+void
+cache_ship_t::on_insert(int block_idx, int way)
+{
+    int sig = signature(cur_pc_);
+    signatures_[block_idx + way] = static_cast<uint16_t>(sig);
+    reused_[block_idx + way] = false;
+    rrpv_[block_idx + way] =
+        static_cast<uint8_t>(shct_[sig] == 0 ? max_rrpv_ : max_rrpv_ - 1);
+}
+
+void
+cache_ship_t::on_hit(int block_idx, int way)
+{
+    cache_rrip_t::on_hit(block_idx, way);
+    reused_[block_idx + way] = true;
+    uint8_t &counter = shct_[signatures_[block_idx + way]];
+    if (counter < SHCT_MAX)
+        ++counter;
+}
+
+void
+cache_ship_t::on_evict(int block_idx, int way)
+{
+    if (reused_[block_idx + way])
+        return;
+    uint8_t &counter = shct_[signatures_[block_idx + way]];
+    if (counter > 0)
+        --counter;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
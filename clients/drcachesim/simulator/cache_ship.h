@@ -0,0 +1,105 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_ship: represents a single hardware cache with signature-based hit
+ * prediction (SHiP) replacement.
+ */
+
+#ifndef _CACHE_SHIP_H_
+#define _CACHE_SHIP_H_ 1
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "cache_rrip.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+class snoop_filter_t;
+
+// Implements SHiP-PC as described by Wu et al. in "SHiP: Signature-based Hit
+// Predictor for High Performance Caching" (MICRO 2011) on top of SRRIP.  A
+// table of saturating counters indexed by a hash of the PC that inserted a
+// line learns whether lines inserted by that PC are re-referenced: hits
+// increment its counter and evictions of lines never hit decrement it.  Lines
+// from PCs whose counter is zero are inserted with a distant re-reference
+// interval instead of a long one.
+class cache_ship_t : public cache_rrip_t {
+public:
+    explicit cache_ship_t(const std::string &name = "cache_ship");
+    bool
+    init(int associativity, int line_size, int total_size, caching_device_t *parent,
+         caching_device_stats_t *stats, prefetcher_t *prefetcher = nullptr,
+         cache_inclusion_policy_t inclusion_policy =
+             cache_inclusion_policy_t::NON_INC_NON_EXC,
+         bool coherent_cache = false, int id_ = -1,
+         snoop_filter_t *snoop_filter_ = nullptr,
+         const std::vector<caching_device_t *> &children = {}) override;
+    std::string
+    get_replace_policy() const override
+    {
+        return "SHIP";
+    }
+
+protected:
+    void
+    on_insert(int block_idx, int way) override;
+    void
+    on_hit(int block_idx, int way) override;
+    void
+    on_evict(int block_idx, int way) override;
+
+    static constexpr int SHCT_SIZE = 16384;
+    static constexpr uint8_t SHCT_MAX = 7;
+
+    static int
+    signature(addr_t pc)
+    {
+        return static_cast<int>((pc ^ (pc >> 14)) & (SHCT_SIZE - 1));
+    }
+
+    // The signature history counter table.
+    std::vector<uint8_t> shct_;
+    // The signature of the PC that inserted each block and whether the block
+    // has been hit since, indexed like blocks_.
+    std::vector<uint16_t> signatures_;
+    std::vector<bool> reused_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHE_SHIP_H_ */
@@ -35,7 +35,9 @@
 #include <stddef.h>
 #include <stdint.h> /* for supporting 64-bit integers*/
 
+#include <cmath>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <map>
 #include <string>
@@ -52,14 +54,20 @@
 #include "ipc_reader.h"
 #include "cache.h"
 #include "cache_fifo.h"
+#include "cache_hawkeye.h"
 #include "cache_lru.h"
+#include "cache_rrip.h"
+#include "cache_ship.h"
 #include "cache_simulator_create.h"
 #include "cache_stats.h"
 #include "caching_device.h"
 #include "caching_device_stats.h"
+#include "ghb_prefetcher.h"
 #include "prefetcher.h"
 #include "simulator.h"
 #include "snoop_filter.h"
+#include "stream_prefetcher.h"
+#include "stride_prefetcher.h"
 #include "utils.h"
 
 namespace dynamorio {
@@ -92,8 +100,10 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
     , knobs_(knobs)
     , l1_icaches_(NULL)
     , l1_dcaches_(NULL)
+    , snooped_caches_(NULL)
     , is_warmed_up_(false)
 {
+    knob_speculate_instrs_ = knobs_.speculate_instrs;
     // XXX i#1703: get defaults from hardware being run on.
 
     // This configuration allows for one shared LLC only.
@@ -109,12 +119,20 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
     llcaches_[cache_name] = llc;
 
     if (knobs_.data_prefetcher != PREFETCH_POLICY_NEXTLINE &&
+        knobs_.data_prefetcher != PREFETCH_POLICY_STRIDE &&
+        knobs_.data_prefetcher != PREFETCH_POLICY_STREAM &&
+        knobs_.data_prefetcher != PREFETCH_POLICY_GHB &&
         knobs_.data_prefetcher != PREFETCH_POLICY_NONE) {
         // Unknown value.
         error_string_ = " unknown data_prefetcher: '" + knobs_.data_prefetcher + "'";
         success_ = false;
         return;
     }
+    if (knobs_.prefetch_table_size == 0) {
+        error_string_ = "Usage error: prefetch_table_size must be >0";
+        success_ = false;
+        return;
+    }
 
     bool warmup_enabled_ = ((knobs_.warmup_refs > 0) || (knobs_.warmup_fraction > 0.0));
 
@@ -128,6 +146,8 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
         success_ = false;
         return;
     }
+    if (knobs_.LL_set_sample_rate > 1)
+        llc->set_sampling(knobs_.LL_set_sample_rate);
 
     l1_icaches_ = new cache_t *[knobs_.num_cores];
     l1_dcaches_ = new cache_t *[knobs_.num_cores];
@@ -165,9 +185,7 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
                 knobs_.L1D_assoc, (int)knobs_.line_size, (int)knobs_.L1D_size, llc,
                 new cache_stats_t((int)knobs_.line_size, "", warmup_enabled_,
                                   knobs_.model_coherence),
-                knobs_.data_prefetcher == PREFETCH_POLICY_NEXTLINE
-                    ? new prefetcher_t((int)knobs_.line_size)
-                    : nullptr,
+                create_prefetcher(knobs_.data_prefetcher),
                 cache_inclusion_policy_t::NON_INC_NON_EXC, knobs_.model_coherence,
                 (2 * i) + 1, snoop_filter_)) {
             error_string_ = "Usage error: failed to initialize L1 caches.  Ensure sizes "
@@ -187,6 +205,10 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
         success_ = false;
         return;
     }
+    if (!init_sampling()) {
+        success_ = false;
+        return;
+    }
 }
 
 cache_simulator_t::cache_simulator_t(std::istream *config_file)
@@ -210,6 +232,9 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
                knobs_.use_physical, knobs_.verbose);
 
     if (knobs_.data_prefetcher != PREFETCH_POLICY_NEXTLINE &&
+        knobs_.data_prefetcher != PREFETCH_POLICY_STRIDE &&
+        knobs_.data_prefetcher != PREFETCH_POLICY_STREAM &&
+        knobs_.data_prefetcher != PREFETCH_POLICY_GHB &&
         knobs_.data_prefetcher != PREFETCH_POLICY_NONE) {
         // Unknown prefetcher type.
         success_ = false;
@@ -337,9 +362,7 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
                          (int)cache_config.size, parent_,
                          new cache_stats_t((int)knobs_.line_size, cache_config.miss_file,
                                            warmup_enabled_, is_coherent_),
-                         cache_config.prefetcher == PREFETCH_POLICY_NEXTLINE
-                             ? new prefetcher_t((int)knobs_.line_size)
-                             : nullptr,
+                         create_prefetcher(cache_config.prefetcher),
                          inclusion_policy, is_coherent_, is_snooped ? snoop_id : -1,
                          is_snooped ? snoop_filter_ : nullptr, children)) {
             error_string_ = "Usage error: failed to initialize the cache " + cache_name;
@@ -372,6 +395,8 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
         if (cache_config.parent == CACHE_PARENT_MEMORY) {
             is_l1_or_llc = true;
             llcaches_[cache_name] = cache;
+            if (knobs_.LL_set_sample_rate > 1)
+                cache->set_sampling(knobs_.LL_set_sample_rate);
         }
 
         // Keep track of non-L1 and non-LLC caches.
@@ -384,6 +409,10 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
         success_ = false;
         return;
     }
+    if (!init_sampling()) {
+        success_ = false;
+        return;
+    }
     // For larger hierarchies, especially with coherence, using hashtables
     // for faster lookups provides performance wins as high as 15%.
     // However, hashtables can slow down smaller hierarchies, so we only
@@ -427,6 +456,17 @@ cache_simulator_t::remaining_sim_refs() const
 bool
 cache_simulator_t::process_memref(const memref_t &memref)
 {
+    return process_memref(memref, nullptr);
+}
+
+bool
+cache_simulator_t::process_memref(const memref_t &memref, cache_result_t *result)
+{
+    if (result != nullptr)
+        result->reset();
+    // Wrong-path references count as references for skipping and warmup too.
+    if (!speculate(memref))
+        return false;
     if (knobs_.skip_refs > 0) {
         knobs_.skip_refs--;
         return true;
@@ -458,6 +498,9 @@ cache_simulator_t::process_memref(const memref_t &memref)
         return true;
     }
 
+    if (knobs_.sample_period_refs > 0)
+        advance_sample_phase();
+
     int core_index;
     if (shard_type_ == SHARD_BY_THREAD) {
         if (memref.data.tid == last_thread_)
@@ -487,7 +530,7 @@ cache_simulator_t::process_memref(const memref_t &memref)
                       << " @" << (void *)simref->instr.addr << " instr x"
                       << simref->instr.size << "\n";
         }
-        l1_icaches_[core_index]->request(*simref);
+        l1_icaches_[core_index]->request(*simref, result);
     } else if (simref->data.type == TRACE_TYPE_READ ||
                simref->data.type == TRACE_TYPE_WRITE ||
                // We may potentially handle prefetches differently.
@@ -499,7 +542,7 @@ cache_simulator_t::process_memref(const memref_t &memref)
                       << trace_type_names[simref->data.type] << " "
                       << (void *)simref->data.addr << " x" << simref->data.size << "\n";
         }
-        l1_dcaches_[core_index]->request(*simref);
+        l1_dcaches_[core_index]->request(*simref, result);
     } else if (simref->flush.type == TRACE_TYPE_INSTR_FLUSH) {
         if (knobs_.verbose >= 3) {
             std::cerr << "::" << simref->data.pid << "." << simref->data.tid << ":: "
@@ -548,6 +591,122 @@ cache_simulator_t::process_memref(const memref_t &memref)
     return true;
 }
 
+bool
+cache_simulator_t::init_sampling()
+{
+    if (knobs_.sample_period_refs == 0)
+        return true;
+    if (knobs_.sample_unit_refs == 0 ||
+        knobs_.sample_warmup_refs + knobs_.sample_unit_refs > knobs_.sample_period_refs) {
+        error_string_ = "Usage error: the sampling period must hold a non-empty "
+                        "measurement unit and its detailed warmup";
+        return false;
+    }
+    if (knobs_.warmup_refs > 0 || knobs_.warmup_fraction > 0.0) {
+        error_string_ = "Usage error: periodic sampling is incompatible with "
+                        "warmup_refs and warmup_fraction";
+        return false;
+    }
+    // The first period starts with functional warming.
+    set_simulation_mode(simulation_mode_t::FUNCTIONAL_WARMING);
+    return true;
+}
+
+// Moves periodic sampling along by one reference, switching the caches to the
+// mode of the current phase and closing and opening measurement units.
+void
+cache_simulator_t::advance_sample_phase()
+{
+    uint64_t warmup_start = knobs_.sample_period_refs - knobs_.sample_unit_refs -
+        knobs_.sample_warmup_refs;
+    uint64_t unit_start = knobs_.sample_period_refs - knobs_.sample_unit_refs;
+    simulation_mode_t mode = simulation_mode_t::MEASURE;
+    if (sample_pos_ < warmup_start)
+        mode = simulation_mode_t::FUNCTIONAL_WARMING;
+    else if (sample_pos_ < unit_start)
+        mode = simulation_mode_t::DETAILED_WARMUP;
+    // A unit ends at the end of its period, even if the next period measures
+    // right away because it has no warming.
+    if (in_sample_unit_ && (mode != simulation_mode_t::MEASURE || sample_pos_ == 0)) {
+        for (auto &cache_it : all_caches_) {
+            caching_device_stats_t *stats = cache_it.second->get_stats();
+            const sample_unit_t &start = sample_start_[cache_it.first];
+            sample_unit_t unit = { stats->get_metric(metric_name_t::HITS) - start.hits,
+                                   stats->get_metric(metric_name_t::MISSES) -
+                                       start.misses };
+            if (unit.hits + unit.misses > 0)
+                sample_units_[cache_it.first].push_back(unit);
+        }
+        in_sample_unit_ = false;
+    }
+    if (mode == simulation_mode_t::MEASURE && !in_sample_unit_) {
+        for (auto &cache_it : all_caches_) {
+            caching_device_stats_t *stats = cache_it.second->get_stats();
+            sample_start_[cache_it.first] = { stats->get_metric(metric_name_t::HITS),
+                                              stats->get_metric(metric_name_t::MISSES) };
+        }
+        in_sample_unit_ = true;
+    }
+    if (mode != sample_mode_)
+        set_simulation_mode(mode);
+    if (++sample_pos_ == knobs_.sample_period_refs)
+        sample_pos_ = 0;
+}
+
+void
+cache_simulator_t::set_simulation_mode(simulation_mode_t mode)
+{
+    for (auto &cache_it : all_caches_)
+        cache_it.second->set_simulation_mode(mode);
+    sample_mode_ = mode;
+}
+
+int
+cache_simulator_t::get_sampled_miss_rate(const std::string &cache_name,
+                                         double &miss_rate, double &error) const
+{
+    miss_rate = 0.;
+    error = 0.;
+    auto it = sample_units_.find(cache_name);
+    if (it == sample_units_.end())
+        return 0;
+    const std::vector<sample_unit_t> &units = it->second;
+    int64_t hits = 0, misses = 0;
+    for (const sample_unit_t &unit : units) {
+        hits += unit.hits;
+        misses += unit.misses;
+    }
+    miss_rate = static_cast<double>(misses) / (hits + misses);
+    if (units.size() < 2)
+        return static_cast<int>(units.size());
+    // A ratio estimator, as units may differ in how many accesses reach the cache.
+    double n = static_cast<double>(units.size());
+    double sum_sq = 0.;
+    for (const sample_unit_t &unit : units) {
+        double residual = unit.misses - miss_rate * (unit.hits + unit.misses);
+        sum_sq += residual * residual;
+    }
+    double mean_accesses = (hits + misses) / n;
+    error = 1.96 * sqrt(sum_sq / (n - 1) / n) / mean_accesses;
+    return static_cast<int>(units.size());
+}
+
+void
+cache_simulator_t::print_sample_units(const std::string &cache_name,
+                                      const std::string &prefix) const
+{
+    double miss_rate, error;
+    int units = get_sampled_miss_rate(cache_name, miss_rate, error);
+    std::cerr << prefix << std::setw(18) << std::left << "Sample units:" << std::setw(20)
+              << std::right << units << std::endl;
+    if (units > 1) {
+        std::cerr << prefix << std::setw(18) << std::left
+                  << "Unit miss rate:" << std::setw(20) << std::fixed
+                  << std::setprecision(2) << std::right << miss_rate * 100 << "% +- "
+                  << error * 100 << "% (95% confidence)" << std::endl;
+    }
+}
+
 // Return true if the number of warmup references have been executed or if
 // specified fraction of the llcaches_ has been loaded. Also return true if the
 // cache has already been warmed up. When there are multiple last level caches
@@ -593,6 +752,12 @@ bool
 cache_simulator_t::print_results()
 {
     std::cerr << "Cache simulation results:\n";
+    if (knobs_.sample_period_refs > 0) {
+        std::cerr << "Periodic sampling: " << knobs_.sample_unit_refs
+                  << " measured refs after " << knobs_.sample_warmup_refs
+                  << " detailed warmup refs every " << knobs_.sample_period_refs
+                  << " refs\n";
+    }
     // Print core and associated L1 cache stats first.
     for (unsigned int i = 0; i < knobs_.num_cores; i++) {
         print_core(i);
@@ -601,13 +766,19 @@ cache_simulator_t::print_results()
                 std::cerr << "  " << l1_icaches_[i]->get_name() << " ("
                           << l1_icaches_[i]->get_description() << ") stats:" << std::endl;
                 l1_icaches_[i]->get_stats()->print_stats("    ");
+                if (knobs_.sample_period_refs > 0)
+                    print_sample_units(l1_icaches_[i]->get_name(), "    ");
                 std::cerr << "  " << l1_dcaches_[i]->get_name() << " ("
                           << l1_dcaches_[i]->get_description() << ") stats:" << std::endl;
                 l1_dcaches_[i]->get_stats()->print_stats("    ");
+                if (knobs_.sample_period_refs > 0)
+                    print_sample_units(l1_dcaches_[i]->get_name(), "    ");
             } else {
                 std::cerr << "  unified " << l1_icaches_[i]->get_name() << " ("
                           << l1_icaches_[i]->get_description() << ") stats:" << std::endl;
                 l1_icaches_[i]->get_stats()->print_stats("    ");
+                if (knobs_.sample_period_refs > 0)
+                    print_sample_units(l1_icaches_[i]->get_name(), "    ");
             }
         }
     }
@@ -617,6 +788,8 @@ cache_simulator_t::print_results()
         std::cerr << caches_it.first << " (" << caches_it.second->get_description()
                   << ") stats:" << std::endl;
         caches_it.second->get_stats()->print_stats("    ");
+        if (knobs_.sample_period_refs > 0)
+            print_sample_units(caches_it.second->get_name(), "    ");
     }
 
     // Print LLC stats.
@@ -624,6 +797,8 @@ cache_simulator_t::print_results()
         std::cerr << caches_it.first << " (" << caches_it.second->get_description()
                   << ") stats:" << std::endl;
         caches_it.second->get_stats()->print_stats("    ");
+        if (knobs_.sample_period_refs > 0)
+            print_sample_units(caches_it.second->get_name(), "    ");
     }
 
     if (knobs_.model_coherence) {
@@ -684,13 +859,45 @@ cache_simulator_t::create_cache(const std::string &name, const std::string &poli
         return new cache_t(name);
     if (policy == REPLACE_POLICY_FIFO) // set to FIFO
         return new cache_fifo_t(name);
+    if (policy == REPLACE_POLICY_SRRIP)
+        return new cache_rrip_t(name, rrip_insertion_t::STATIC);
+    if (policy == REPLACE_POLICY_BRRIP)
+        return new cache_rrip_t(name, rrip_insertion_t::BIMODAL);
+    if (policy == REPLACE_POLICY_DRRIP)
+        return new cache_rrip_t(name, rrip_insertion_t::DYNAMIC);
+    if (policy == REPLACE_POLICY_SHIP)
+        return new cache_ship_t(name);
+    if (policy == REPLACE_POLICY_HAWKEYE)
+        return new cache_hawkeye_t(name);
 
     // undefined replacement policy
     ERRMSG("Usage error: undefined replacement policy. "
-           "Please choose " REPLACE_POLICY_LRU " or " REPLACE_POLICY_LFU ".\n");
+           "Please choose " REPLACE_POLICY_LRU ", " REPLACE_POLICY_LFU
+           ", " REPLACE_POLICY_FIFO ", " REPLACE_POLICY_SRRIP ", " REPLACE_POLICY_BRRIP
+           ", " REPLACE_POLICY_DRRIP ", " REPLACE_POLICY_SHIP
+           " or " REPLACE_POLICY_HAWKEYE ".\n");
     return NULL;
 }
 
+prefetcher_t *
+cache_simulator_t::create_prefetcher(const std::string &policy)
+{
+    int line_size = (int)knobs_.line_size;
+    int degree = (int)knobs_.prefetch_degree;
+    int queue_size = (int)knobs_.prefetch_queue_size;
+    int table_size = (int)knobs_.prefetch_table_size;
+    if (policy == PREFETCH_POLICY_NEXTLINE)
+        return new prefetcher_t(line_size);
+    if (policy == PREFETCH_POLICY_STRIDE)
+        return new stride_prefetcher_t(line_size, degree, queue_size, table_size);
+    if (policy == PREFETCH_POLICY_STREAM)
+        return new stream_prefetcher_t(line_size, degree, queue_size, table_size);
+    if (policy == PREFETCH_POLICY_GHB)
+        return new ghb_prefetcher_t(line_size, degree, queue_size, table_size);
+    // PREFETCH_POLICY_NONE: validated by the caller.
+    return nullptr;
+}
+
 // Access snoop filter stats.
 int64_t
 cache_simulator_t::get_num_snooped_caches(void)
@@ -42,10 +42,12 @@
 #include <istream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "cache.h"
 #include "cache_simulator_create.h"
 #include "cache_stats.h"
+#include "caching_device.h"
 #include "simulator.h"
 #include "snoop_filter.h"
 
@@ -79,6 +81,12 @@ public:
     virtual ~cache_simulator_t();
     bool
     process_memref(const memref_t &memref) override;
+    // Identical to process_memref(const memref_t &) but additionally reports the
+    // outcome of the access in "result", whose entry 0 is the L1 cache the memref
+    // was sent to and entry 1 that cache's parent.  The result is reset first and
+    // left empty for memrefs that do not access the caches.
+    bool
+    process_memref(const memref_t &memref, cache_result_t *result);
     bool
     print_results() override;
 
@@ -107,10 +115,22 @@ public:
     const cache_simulator_knobs_t &
     get_knobs() const;
 
+    // Under periodic sampling, returns the number of complete measurement units
+    // of the named cache that had any accesses, and sets "miss_rate" to its
+    // local miss rate over those units and "error" to the half-width of the 95%
+    // confidence interval derived from the variance across units.
+    int
+    get_sampled_miss_rate(const std::string &cache_name, double &miss_rate,
+                          double &error) const;
+
 protected:
     // Create a cache_t object with a specific replacement policy.
     virtual cache_t *
     create_cache(const std::string &name, const std::string &policy);
+    // Create a prefetcher_t object for a data prefetcher policy, or return
+    // nullptr for PREFETCH_POLICY_NONE.
+    virtual prefetcher_t *
+    create_prefetcher(const std::string &policy);
 
     cache_simulator_knobs_t knobs_;
 
@@ -133,7 +153,30 @@ protected:
     snoop_filter_t *snoop_filter_ = nullptr;
 
 private:
+    // Hits and misses of one cache in one periodic sampling measurement unit.
+    struct sample_unit_t {
+        int64_t hits;
+        int64_t misses;
+    };
+
+    bool
+    init_sampling();
+    void
+    advance_sample_phase();
+    void
+    set_simulation_mode(simulation_mode_t mode);
+    void
+    print_sample_units(const std::string &cache_name, const std::string &prefix) const;
+
     bool is_warmed_up_;
+
+    // Periodic sampling state.
+    uint64_t sample_pos_ = 0;
+    simulation_mode_t sample_mode_ = simulation_mode_t::MEASURE;
+    bool in_sample_unit_ = false;
+    // The counts of each cache at the start of the current unit.
+    std::unordered_map<std::string, sample_unit_t> sample_start_;
+    std::unordered_map<std::string, std::vector<sample_unit_t>> sample_units_;
 };
 
 } // namespace drmemtrace
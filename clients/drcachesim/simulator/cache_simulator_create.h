@@ -62,13 +62,21 @@ struct cache_simulator_knobs_t {
         , LL_size(8 * 1024 * 1024)
         , LL_assoc(16)
         , LL_miss_file("")
+        , LL_set_sample_rate(1)
         , model_coherence(false)
         , replace_policy("LRU")
         , data_prefetcher("nextline")
+        , prefetch_degree(4)
+        , prefetch_queue_size(16)
+        , prefetch_table_size(64)
         , skip_refs(0)
         , warmup_refs(0)
         , warmup_fraction(0.0)
         , sim_refs(1ULL << 63)
+        , sample_period_refs(0)
+        , sample_warmup_refs(2000)
+        , sample_unit_refs(10000)
+        , speculate_instrs(0)
         , cpu_scheduling(false)
         , use_physical(false)
         , verbose(0)
@@ -76,6 +84,7 @@ struct cache_simulator_knobs_t {
         , max_trace_length(100000000)
         , cachesim_row_buffer_size(1000000)
         , trace_form("expanded")
+        , cachesim_row_format("columnar")
     {
     }
     unsigned int num_cores;
@@ -87,13 +96,21 @@ struct cache_simulator_knobs_t {
     uint64_t LL_size;
     unsigned int LL_assoc;
     std::string LL_miss_file;
+    unsigned int LL_set_sample_rate;
     bool model_coherence;
     std::string replace_policy;
     std::string data_prefetcher;
+    unsigned int prefetch_degree;
+    unsigned int prefetch_queue_size;
+    unsigned int prefetch_table_size;
     uint64_t skip_refs;
     uint64_t warmup_refs;
     double warmup_fraction;
     uint64_t sim_refs;
+    uint64_t sample_period_refs;
+    uint64_t sample_warmup_refs;
+    uint64_t sample_unit_refs;
+    uint64_t speculate_instrs;
     bool cpu_scheduling;
     bool use_physical;
     unsigned int verbose;
@@ -101,6 +118,29 @@ struct cache_simulator_knobs_t {
     unsigned int max_trace_length;
     unsigned int cachesim_row_buffer_size;
     std::string trace_form;
+    std::string cachesim_row_format;
+};
+
+/**
+ * The ranges of cache configurations covered by miss_ratio_curve_create().
+ * Every power-of-two total size and associativity within a range is simulated.
+ */
+struct miss_ratio_curve_knobs_t {
+    miss_ratio_curve_knobs_t()
+        : L1_min_size(1024)
+        , L1_max_size(1024 * 1024)
+        , LL_min_size(64 * 1024)
+        , LL_max_size(64 * 1024 * 1024)
+        , min_assoc(1)
+        , max_assoc(16)
+    {
+    }
+    uint64_t L1_min_size;
+    uint64_t L1_max_size;
+    uint64_t LL_min_size;
+    uint64_t LL_max_size;
+    unsigned int min_assoc;
+    unsigned int max_assoc;
 };
 
 /** Creates an instance of a cache simulator with a 2-level hierarchy. */
@@ -120,6 +160,39 @@ cache_miss_analyzer_create(const cache_simulator_knobs_t &knobs,
                            unsigned int miss_count_threshold, double miss_frac_threshold,
                            double confidence_threshold);
 
+/**
+ * Creates a tool that runs one cache simulator per configuration in "configs"
+ * over a single pass of the trace, using "num_threads" worker threads (0 means
+ * one per hardware thread).  "configs" holds ';'-separated configurations, each
+ * a ','-separated list of knob=value overrides of "knobs", e.g.,
+ * "L1D_size=32K,LL_size=1M;L1D_size=64K,LL_size=2M".  One row per configuration
+ * is appended to the sweep_experiments.csv file under knobs.cache_trace_log_path.
+ */
+analysis_tool_t *
+cache_sweep_create(const cache_simulator_knobs_t &knobs, const std::string &configs,
+                   unsigned int num_threads);
+
+/**
+ * Creates a tool that computes, in a single pass, the LRU miss counts of the L1I,
+ * L1D and LL caches of the "knobs" hierarchy for every size and associativity in
+ * the "curve_knobs" ranges.  The LL curve is for the L1 configuration in "knobs".
+ * Requires LRU replacement and no data prefetcher.
+ */
+analysis_tool_t *
+miss_ratio_curve_create(const cache_simulator_knobs_t &knobs,
+                        const miss_ratio_curve_knobs_t &curve_knobs);
+
+/**
+ * Creates a tool that reports, in total and for the "report_top" PCs with the
+ * largest difference, the LL misses of the "knobs" hierarchy with LRU replacement
+ * and with Belady's optimal replacement.  The LL access stream and its next-use
+ * index are kept in files in "index_dir", or in anonymous temporary files if it
+ * is empty.  Requires LRU replacement and no data prefetcher.
+ */
+analysis_tool_t *
+opt_miss_bound_create(const cache_simulator_knobs_t &knobs, const std::string &index_dir,
+                      unsigned int report_top);
+
 } // namespace drmemtrace
 } // namespace dynamorio
 
@@ -71,6 +71,7 @@ cache_stats_t::access(const memref_t &memref, bool hit,
                 dump_miss(memref);
 
             check_compulsory_miss(memref.data.addr);
+            check_prefetch_use(memref, hit, cache_block);
         }
     } else { // handle regular memory accesses
         caching_device_stats_t::access(memref, hit, cache_block);
@@ -93,11 +94,11 @@ cache_stats_t::print_counts(std::string prefix)
     }
     if (num_prefetch_hits_ + num_prefetch_misses_ != 0) {
         std::cerr << prefix << std::setw(18) << std::left
-                  << "Prefetch hits:" << std::setw(20) << std::right << num_prefetch_hits_
-                  << std::endl;
+                  << "Prefetch hits:" << std::setw(20) << std::right
+                  << scale(num_prefetch_hits_) << std::endl;
         std::cerr << prefix << std::setw(18) << std::left
                   << "Prefetch misses:" << std::setw(20) << std::right
-                  << num_prefetch_misses_ << std::endl;
+                  << scale(num_prefetch_misses_) << std::endl;
     }
 }
 
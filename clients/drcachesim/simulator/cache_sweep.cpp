@@ -0,0 +1,441 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cache_sweep.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analysis_tool.h"
+#include "cache_simulator.h"
+#include "cache_simulator_create.h"
+#include "memref.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+analysis_tool_t *
+cache_sweep_create(const cache_simulator_knobs_t &knobs, const std::string &configs,
+                   unsigned int num_threads)
+{
+    return new cache_sweep_t(knobs, configs, num_threads);
+}
+
+namespace {
+
+std::vector<std::string>
+split_string(const std::string &str, char sep)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(str);
+    std::string field;
+    while (std::getline(stream, field, sep)) {
+        field.erase(0, field.find_first_not_of(" \t"));
+        field.erase(field.find_last_not_of(" \t") + 1);
+        if (!field.empty())
+            fields.push_back(field);
+    }
+    return fields;
+}
+
+// Parses a byte count with an optional K, M or G suffix.  Throws
+// std::invalid_argument or std::out_of_range on malformed input.
+uint64_t
+parse_size(const std::string &value)
+{
+    size_t end;
+    uint64_t size = std::stoull(value, &end);
+    if (end + 1 == value.size()) {
+        switch (value[end]) {
+        case 'k':
+        case 'K': return size << 10;
+        case 'm':
+        case 'M': return size << 20;
+        case 'g':
+        case 'G': return size << 30;
+        }
+    }
+    if (end != value.size())
+        throw std::invalid_argument(value);
+    return size;
+}
+
+unsigned int
+parse_uint(const std::string &value)
+{
+    size_t end;
+    unsigned long result = std::stoul(value, &end);
+    if (end != value.size())
+        throw std::invalid_argument(value);
+    return static_cast<unsigned int>(result);
+}
+
+std::string
+describe_config(const cache_simulator_knobs_t &knobs)
+{
+    std::ostringstream desc;
+    desc << "L1I=" << knobs.L1I_size << "/" << knobs.L1I_assoc
+         << " L1D=" << knobs.L1D_size << "/" << knobs.L1D_assoc << " LL=" << knobs.LL_size
+         << "/" << knobs.LL_assoc << " line=" << knobs.line_size << " "
+         << knobs.replace_policy << " " << knobs.data_prefetcher;
+    return desc.str();
+}
+
+double
+miss_rate(int64_t hits, int64_t misses)
+{
+    return hits + misses == 0 ? 0.0 : static_cast<double>(misses) / (hits + misses);
+}
+
+} // namespace
+
+std::string
+cache_sweep_t::parse_configs(const cache_simulator_knobs_t &base,
+                             const std::string &configs,
+                             std::vector<cache_simulator_knobs_t> &result)
+{
+    result.clear();
+    for (const std::string &config : split_string(configs, ';')) {
+        cache_simulator_knobs_t knobs = base;
+        for (const std::string &setting : split_string(config, ',')) {
+            size_t eq = setting.find('=');
+            if (eq == std::string::npos)
+                return "Missing '=' in cache sweep setting '" + setting + "'";
+            std::string name = setting.substr(0, eq);
+            std::string value = setting.substr(eq + 1);
+            try {
+                if (name == "L1I_size")
+                    knobs.L1I_size = parse_size(value);
+                else if (name == "L1D_size")
+                    knobs.L1D_size = parse_size(value);
+                else if (name == "LL_size")
+                    knobs.LL_size = parse_size(value);
+                else if (name == "L1I_assoc")
+                    knobs.L1I_assoc = parse_uint(value);
+                else if (name == "L1D_assoc")
+                    knobs.L1D_assoc = parse_uint(value);
+                else if (name == "LL_assoc")
+                    knobs.LL_assoc = parse_uint(value);
+                else if (name == "LL_set_sample_rate")
+                    knobs.LL_set_sample_rate = parse_uint(value);
+                else if (name == "line_size")
+                    knobs.line_size = parse_uint(value);
+                else if (name == "num_cores")
+                    knobs.num_cores = parse_uint(value);
+                else if (name == "replace_policy")
+                    knobs.replace_policy = value;
+                else if (name == "data_prefetcher")
+                    knobs.data_prefetcher = value;
+                else if (name == "prefetch_degree")
+                    knobs.prefetch_degree = parse_uint(value);
+                else if (name == "prefetch_queue_size")
+                    knobs.prefetch_queue_size = parse_uint(value);
+                else if (name == "prefetch_table_size")
+                    knobs.prefetch_table_size = parse_uint(value);
+                else
+                    return "Unknown cache sweep knob '" + name + "'";
+            } catch (const std::logic_error &) {
+                return "Invalid value '" + value + "' for cache sweep knob '" + name +
+                    "'";
+            }
+        }
+        result.push_back(knobs);
+    }
+    if (result.empty())
+        return "No cache sweep configurations were specified";
+    return "";
+}
+
+cache_sweep_t::cache_sweep_t(const cache_simulator_knobs_t &knobs,
+                             const std::string &configs, unsigned int num_threads)
+{
+    cache_simulator_knobs_t base = knobs;
+    // The simulators run concurrently so they cannot share a miss file.
+    base.LL_miss_file = "";
+    error_string_ = parse_configs(base, configs, configs_);
+    if (!error_string_.empty()) {
+        success_ = false;
+        return;
+    }
+    // The missing_instructions tool writes a different schema to experiments.csv
+    // under the same path, so the sweep uses its own file.
+    experiments_path_ = knobs.cache_trace_log_path + "sweep_experiments.csv";
+    for (size_t i = 0; i < configs_.size(); ++i) {
+        std::unique_ptr<cache_simulator_t> sim(new cache_simulator_t(configs_[i]));
+        if (!*sim) {
+            error_string_ = "Cache sweep configuration #" + std::to_string(i) + " (" +
+                describe_config(configs_[i]) + "): " + sim->get_error_string();
+            success_ = false;
+            return;
+        }
+        simulators_.push_back(std::move(sim));
+    }
+    chunks_[0].reserve(CHUNK_SIZE);
+    chunks_[1].reserve(CHUNK_SIZE);
+
+    if (num_threads == 0)
+        num_threads = std::max(1U, std::thread::hardware_concurrency());
+    num_workers_ = std::min(num_threads, static_cast<unsigned int>(configs_.size()));
+    workers_.reserve(num_workers_);
+    for (unsigned int i = 0; i < num_workers_; ++i)
+        workers_.emplace_back(&cache_sweep_t::worker_loop, this, i);
+}
+
+cache_sweep_t::~cache_sweep_t()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wait_for_idle(lock);
+        exiting_ = true;
+    }
+    work_ready_.notify_all();
+    for (std::thread &worker : workers_)
+        worker.join();
+}
+
+std::string
+cache_sweep_t::initialize_shard_type(shard_type_t shard_type)
+{
+    // Core sharding needs the stream's current shard index for every memref, which
+    // is gone by the time the workers simulate it.
+    if (shard_type != SHARD_BY_THREAD)
+        return "The cache sweep tool only supports thread-sharded simulation";
+    for (auto &sim : simulators_) {
+        std::string error = sim->initialize_shard_type(shard_type);
+        if (!error.empty())
+            return error;
+    }
+    return "";
+}
+
+bool
+cache_sweep_t::process_memref(const memref_t &memref)
+{
+    std::vector<memref_t> &chunk = chunks_[fill_index_];
+    chunk.push_back(memref);
+    if (chunk.size() < CHUNK_SIZE)
+        return true;
+    dispatch_chunk();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!worker_error_.empty()) {
+        error_string_ = worker_error_;
+        return false;
+    }
+    return true;
+}
+
+void
+cache_sweep_t::wait_for_idle(std::unique_lock<std::mutex> &lock)
+{
+    work_done_.wait(lock, [this] { return workers_busy_ == 0; });
+}
+
+void
+cache_sweep_t::dispatch_chunk()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // The workers must be done with the other chunk before we refill it.
+        wait_for_idle(lock);
+        work_chunk_ = &chunks_[fill_index_];
+        ++work_generation_;
+        workers_busy_ = num_workers_;
+    }
+    work_ready_.notify_all();
+    fill_index_ ^= 1;
+    chunks_[fill_index_].clear();
+}
+
+void
+cache_sweep_t::worker_loop(unsigned int worker_index)
+{
+    uint64_t seen_generation = 0;
+    while (true) {
+        const std::vector<memref_t> *chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [this, seen_generation] {
+                return exiting_ || work_generation_ != seen_generation;
+            });
+            if (exiting_)
+                return;
+            seen_generation = work_generation_;
+            chunk = work_chunk_;
+        }
+        // Each worker owns a fixed stride of the simulators, and runs each one over
+        // the whole chunk to keep that simulator's state hot in the cache.
+        std::string error;
+        for (size_t i = worker_index; i < simulators_.size() && error.empty();
+             i += num_workers_) {
+            for (const memref_t &memref : *chunk) {
+                if (!simulators_[i]->process_memref(memref)) {
+                    error = "Cache sweep configuration #" + std::to_string(i) +
+                        " failed: " + simulators_[i]->get_error_string();
+                    break;
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error.empty() && worker_error_.empty())
+            worker_error_ = error;
+        if (--workers_busy_ == 0)
+            work_done_.notify_all();
+    }
+}
+
+bool
+cache_sweep_t::drain()
+{
+    if (!chunks_[fill_index_].empty())
+        dispatch_chunk();
+    std::unique_lock<std::mutex> lock(mutex_);
+    wait_for_idle(lock);
+    if (!worker_error_.empty()) {
+        error_string_ = worker_error_;
+        return false;
+    }
+    return true;
+}
+
+int64_t
+cache_sweep_t::get_total_metric(const cache_simulator_t &sim, metric_name_t metric,
+                                unsigned level, cache_split_t split) const
+{
+    int64_t total = 0;
+    for (unsigned int core = 0; core < sim.get_knobs().num_cores; ++core) {
+        // The LLC is shared, so only count it once.
+        if (level > 1 && core > 0)
+            break;
+        total += sim.get_cache_metric(metric, level, core, split);
+    }
+    return total;
+}
+
+bool
+cache_sweep_t::print_results()
+{
+    if (!drain())
+        return false;
+    std::cerr << "Cache sweep results for " << simulators_.size()
+              << " configurations:\n";
+    for (size_t i = 0; i < simulators_.size(); ++i) {
+        const cache_simulator_t &sim = *simulators_[i];
+        std::cerr << "Configuration #" << i << " (" << describe_config(configs_[i])
+                  << "):\n";
+        if (configs_[i].verbose >= 1) {
+            if (!simulators_[i]->print_results())
+                return false;
+            continue;
+        }
+        static const struct {
+            const char *name;
+            unsigned level;
+            cache_split_t split;
+        } kLevels[] = { { "L1I", 1, cache_split_t::INSTRUCTION },
+                        { "L1D", 1, cache_split_t::DATA },
+                        { "LL", 2, cache_split_t::DATA } };
+        for (const auto &level : kLevels) {
+            int64_t hits = get_total_metric(sim, metric_name_t::HITS, level.level,
+                                            level.split);
+            int64_t misses = get_total_metric(sim, metric_name_t::MISSES, level.level,
+                                              level.split);
+            std::cerr << "  " << level.name << " hits: " << hits
+                      << " misses: " << misses
+                      << " miss rate: " << miss_rate(hits, misses) * 100 << "%\n";
+        }
+    }
+    write_experiments();
+    return true;
+}
+
+void
+cache_sweep_t::write_experiments()
+{
+    std::string experiment_id = std::to_string(std::time(nullptr));
+    bool write_header;
+    {
+        std::ifstream check_file(experiments_path_);
+        write_header = !check_file.good() ||
+            check_file.peek() == std::ifstream::traits_type::eof();
+    }
+    std::ofstream experiments_file(experiments_path_, std::ios::app);
+    if (!experiments_file.good()) {
+        std::cerr << "Failed to open " << experiments_path_ << "\n";
+        return;
+    }
+    if (write_header) {
+        experiments_file << "Experiment ID; Config; L1D Size; L1I Size; LL Size; "
+                         << "L1D Assoc; L1I Assoc; LL Assoc; Line Size; Num Cores; "
+                         << "Replace Policy; Data Prefetcher; L1D Hits; L1D Misses; "
+                         << "L1I Hits; L1I Misses; LL Hits; LL Misses\n";
+    }
+    for (size_t i = 0; i < simulators_.size(); ++i) {
+        const cache_simulator_t &sim = *simulators_[i];
+        const cache_simulator_knobs_t &knobs = configs_[i];
+        experiments_file
+            << experiment_id << "; " << i << "; " << knobs.L1D_size << "; "
+            << knobs.L1I_size << "; " << knobs.LL_size << "; " << knobs.L1D_assoc
+            << "; " << knobs.L1I_assoc << "; " << knobs.LL_assoc << "; "
+            << knobs.line_size << "; " << knobs.num_cores << "; '"
+            << knobs.replace_policy << "'; '" << knobs.data_prefetcher << "'; "
+            << get_total_metric(sim, metric_name_t::HITS, 1, cache_split_t::DATA)
+            << "; "
+            << get_total_metric(sim, metric_name_t::MISSES, 1, cache_split_t::DATA)
+            << "; "
+            << get_total_metric(sim, metric_name_t::HITS, 1,
+                                cache_split_t::INSTRUCTION)
+            << "; "
+            << get_total_metric(sim, metric_name_t::MISSES, 1,
+                                cache_split_t::INSTRUCTION)
+            << "; "
+            << get_total_metric(sim, metric_name_t::HITS, 2, cache_split_t::DATA)
+            << "; "
+            << get_total_metric(sim, metric_name_t::MISSES, 2, cache_split_t::DATA)
+            << "\n";
+    }
+    std::cerr << "Wrote " << simulators_.size() << " experiment rows to "
+              << experiments_path_ << "\n";
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
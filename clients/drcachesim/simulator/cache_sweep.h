@@ -0,0 +1,149 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_sweep: simulates many cache configurations in a single pass over a trace.
+ */
+
+#ifndef _CACHE_SWEEP_H_
+#define _CACHE_SWEEP_H_ 1
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analysis_tool.h"
+#include "cache_simulator.h"
+#include "cache_simulator_create.h"
+#include "memref.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Feeds every memref to one independent cache_simulator_t per configuration.
+// Memrefs are buffered into chunks; each full chunk is handed to a pool of worker
+// threads, each of which runs a fixed subset of the simulators over the whole
+// chunk, while the next chunk is being filled.  Since the simulators see the
+// memrefs asynchronously only thread sharding (SHARD_BY_THREAD) is supported.
+class cache_sweep_t : public analysis_tool_t {
+public:
+    // "configs" holds one configuration per ';'-separated entry.  Each entry is a
+    // ','-separated list of knob=value overrides applied to "knobs"; see
+    // parse_configs() for the supported knob names.  A "num_threads" of 0 uses
+    // one thread per hardware thread.  The thread count is capped at the number
+    // of configurations.
+    cache_sweep_t(const cache_simulator_knobs_t &knobs, const std::string &configs,
+                  unsigned int num_threads);
+    ~cache_sweep_t() override;
+    std::string
+    initialize_shard_type(shard_type_t shard_type) override;
+    bool
+    process_memref(const memref_t &memref) override;
+    bool
+    print_results() override;
+
+    // Simulates any buffered memrefs and waits for the workers to go idle.
+    // Returns false if a simulator reported an error.
+    bool
+    drain();
+
+    size_t
+    get_num_configs() const
+    {
+        return simulators_.size();
+    }
+    // Only valid after drain() or print_results().
+    const cache_simulator_t &
+    get_simulator(size_t index) const
+    {
+        return *simulators_[index];
+    }
+    const cache_simulator_knobs_t &
+    get_config_knobs(size_t index) const
+    {
+        return configs_[index];
+    }
+
+    // Parses "configs" into one knob set per configuration, each starting from
+    // "base".  Returns an error message on failure and "" on success.
+    // Supported knobs: L1I_size, L1D_size, LL_size (with optional K, M or G
+    // suffix), L1I_assoc, L1D_assoc, LL_assoc, line_size, num_cores,
+    // replace_policy and data_prefetcher.
+    static std::string
+    parse_configs(const cache_simulator_knobs_t &base, const std::string &configs,
+                  std::vector<cache_simulator_knobs_t> &result);
+
+protected:
+    // The number of memrefs buffered before a chunk is handed to the workers.
+    static constexpr size_t CHUNK_SIZE = 1 << 15;
+
+    void
+    dispatch_chunk();
+    void
+    wait_for_idle(std::unique_lock<std::mutex> &lock);
+    void
+    worker_loop(unsigned int worker_index);
+    void
+    write_experiments();
+    int64_t
+    get_total_metric(const cache_simulator_t &sim, metric_name_t metric,
+                     unsigned level, cache_split_t split) const;
+
+    std::vector<cache_simulator_knobs_t> configs_;
+    std::vector<std::unique_ptr<cache_simulator_t>> simulators_;
+    std::string experiments_path_;
+
+    // Two chunks: the workers simulate one while process_memref() fills the other.
+    std::vector<memref_t> chunks_[2];
+    int fill_index_ = 0;
+
+    unsigned int num_workers_ = 0;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    // The following are guarded by mutex_.
+    const std::vector<memref_t> *work_chunk_ = nullptr;
+    uint64_t work_generation_ = 0;
+    unsigned int workers_busy_ = 0;
+    bool exiting_ = false;
+    std::string worker_error_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHE_SWEEP_H_ */
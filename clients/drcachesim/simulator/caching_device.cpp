@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <stddef.h>
 
+#include <algorithm>
 #include <functional>
 #include <string>
 #include <unordered_map>
@@ -56,10 +57,6 @@ caching_device_t::caching_device_t(const std::string &name)
     : blocks_(NULL)
     , stats_(NULL)
     , prefetcher_(NULL)
-    // The tag being hashed is already right-shifted to the cache line and
-    // an identity hash is plenty good enough and nice and fast.
-    // We set the size and load factor only if being used, in set_hashtable_use().
-    , tag2block(0, [](addr_t key) { return static_cast<unsigned long>(key); })
     , name_(name)
 {
 }
@@ -114,6 +111,12 @@ caching_device_t::init(int associativity, int block_size, int num_blocks,
 
     blocks_ = new caching_device_block_t *[num_blocks_];
     init_blocks();
+    tags_.assign(num_blocks_, TAG_INVALID);
+    set_kernel_isa_ = set_kernel_best_isa();
+    sampled_sets_.clear();
+    num_sampled_sets_ = blocks_per_way_;
+    if (use_tag2block_table_)
+        tag2block.init(num_blocks_);
 
     last_tag_ = TAG_INVALID; // sentinel
 
@@ -123,6 +126,31 @@ caching_device_t::init(int associativity, int block_size, int num_blocks,
     return true;
 }
 
+void
+caching_device_t::set_sampling(unsigned int rate)
+{
+    sampled_sets_.clear();
+    num_sampled_sets_ = blocks_per_way_;
+    if (rate > 1) {
+        sampled_sets_.resize(blocks_per_way_);
+        num_sampled_sets_ = 0;
+        for (int set = 0; set < blocks_per_way_; ++set) {
+            // Hash the index so that the sampled sets are not a regular stride,
+            // which strided access patterns could alias with.
+            uint64_t hash = static_cast<uint64_t>(set) * 0x9e3779b97f4a7c15ULL;
+            hash ^= hash >> 29;
+            sampled_sets_[set] = (hash % rate) == 0;
+            if (sampled_sets_[set])
+                ++num_sampled_sets_;
+        }
+        if (num_sampled_sets_ == 0) {
+            sampled_sets_[0] = true;
+            num_sampled_sets_ = 1;
+        }
+    }
+    stats_->set_sampling(blocks_per_way_, num_sampled_sets_);
+}
+
 std::string
 caching_device_t::get_description() const
 {
@@ -133,30 +161,34 @@ caching_device_t::get_description() const
         (is_coherent() ? ", coherent" : "") +
         (is_inclusive()       ? ", inclusive"
              : is_exclusive() ? ", exclusive"
-                              : "");
+                              : "") +
+        (sampled_sets_.empty() ? ""
+                               : ", sampled " + std::to_string(num_sampled_sets_) +
+                 "/" + std::to_string(blocks_per_way_) + " sets");
 }
 
 std::pair<caching_device_block_t *, int>
 caching_device_t::find_caching_device_block(addr_t tag)
 {
+    int block_idx = compute_block_idx(tag);
     if (use_tag2block_table_) {
-        auto it = tag2block.find(tag);
-        if (it == tag2block.end())
+        int position = tag2block.find(tag);
+        if (position < 0)
             return std::make_pair(nullptr, 0);
-        assert(it->second.first->tag_ == tag);
-        return it->second;
-    }
-    int block_idx = compute_block_idx(tag);
-    for (int way = 0; way < associativity_; ++way) {
-        caching_device_block_t &block = get_caching_device_block(block_idx, way);
-        if (block.tag_ == tag)
-            return std::make_pair(&block, way);
+        assert(blocks_[position]->tag_ == tag);
+        return std::make_pair(blocks_[position], position - block_idx);
     }
-    return std::make_pair(nullptr, 0);
+    int way =
+        set_kernel_find_way(set_kernel_isa_, &tags_[block_idx], associativity_, tag);
+    if (way < 0)
+        return std::make_pair(nullptr, 0);
+    caching_device_block_t &block = get_caching_device_block(block_idx, way);
+    assert(block.tag_ == tag);
+    return std::make_pair(&block, way);
 }
 
 void
-caching_device_t::request(const memref_t &memref_in)
+caching_device_t::request(const memref_t &memref_in, cache_result_t *result, int level)
 {
     // Unfortunately we need to make a copy for our loop so we can pass
     // the right data struct to the parent and stats collectors.
@@ -167,6 +199,9 @@ caching_device_t::request(const memref_t &memref_in)
     addr_t final_addr = memref_in.data.addr + memref_in.data.size - 1 /*avoid overflow*/;
     addr_t final_tag = compute_tag(final_addr);
     addr_t tag = compute_tag(memref_in.data.addr);
+    cache_level_result_t *level_result =
+        result == nullptr ? nullptr : result->get_level(level);
+    bool is_prefetch = type_is_prefetch(memref_in.data.type);
 
     // Optimization: check last tag if single-block
     if (tag == final_tag && tag == last_tag_ && memref_in.data.type != TRACE_TYPE_WRITE) {
@@ -176,6 +211,17 @@ caching_device_t::request(const memref_t &memref_in)
         assert(tag != TAG_INVALID && tag == cache_block->tag_);
         record_access_stats(memref_in, true /*hit*/, cache_block);
         access_update(last_block_idx_, last_way_);
+        if (level_result != nullptr) {
+            ++level_result->lines;
+            if (cache_block->prefetched_ && !is_prefetch)
+                level_result->prefetch_hit = true;
+        }
+        if (!is_prefetch)
+            cache_block->prefetched_ = false;
+        return;
+    }
+    if (mode_ == simulation_mode_t::FUNCTIONAL_WARMING) {
+        warm(memref_in, result, level);
         return;
     }
 
@@ -184,9 +230,21 @@ caching_device_t::request(const memref_t &memref_in)
         int way = associativity_;
         int block_idx = compute_block_idx(tag);
         bool missed = false;
+        bool prefetch_hit = false;
 
         if (tag + 1 <= final_tag)
             memref.data.size = ((tag + 1) << block_size_bits_) - memref.data.addr;
+        if (!sampled_sets_.empty() && !sampled_sets_[tag & blocks_per_way_mask_]) {
+            // Not a simulated set: this line is accounted for by the scaling.
+            if (tag + 1 <= final_tag) {
+                addr_t next_addr = (tag + 1) << block_size_bits_;
+                memref.data.addr = next_addr;
+                memref.data.size = final_addr - next_addr + 1 /*undo the -1*/;
+            }
+            continue;
+        }
+        if (level_result != nullptr)
+            ++level_result->lines;
 
         auto block_way = find_caching_device_block(tag);
         if (block_way.first != nullptr) {
@@ -194,6 +252,12 @@ caching_device_t::request(const memref_t &memref_in)
             caching_device_block_t *cache_block = block_way.first;
             way = block_way.second;
             record_access_stats(memref, true /*hit*/, cache_block);
+            if (!is_prefetch) {
+                prefetch_hit = cache_block->prefetched_;
+                if (level_result != nullptr && prefetch_hit)
+                    level_result->prefetch_hit = true;
+                cache_block->prefetched_ = false;
+            }
             if (coherent_cache_ && memref.data.type == TRACE_TYPE_WRITE) {
                 // On a hit, we must notify the snoop filter of the write or propagate
                 // the write to a snooped cache.
@@ -224,24 +288,35 @@ caching_device_t::request(const memref_t &memref_in)
 
             record_access_stats(memref, false /*miss*/, cache_block);
             missed = true;
+            // A prefetch of this line that has yet to be issued is too late.
+            if (!is_prefetch && prefetcher_ != nullptr &&
+                prefetcher_->cancel(memref.data.addr) &&
+                mode_ == simulation_mode_t::MEASURE)
+                stats_->late_prefetch();
+            if (level_result != nullptr)
+                ++level_result->misses;
             // If no parent we assume we get the data from main memory.
             if (parent_ != nullptr) {
-                parent_->request(memref);
+                parent_->request(memref, result, level + 1);
             }
             // Exclusive caches only insert lines that have been evicted
             // by a child cache.  So a regular miss does nothing more.
             if (is_exclusive()) {
                 continue;
             }
+            if (level_result != nullptr && cache_block->tag_ != TAG_INVALID)
+                level_result->evicted_tag = cache_block->tag_;
             insert_tag(tag, (memref.data.type == TRACE_TYPE_WRITE), way, block_idx);
+            cache_block->prefetched_ = is_prefetch;
         }
 
         access_update(block_idx, way);
 
-        // Issue a hardware prefetch, if any, before we remember the last tag,
-        // so we remember this line and not the prefetched line.
-        if (missed && !type_is_prefetch(memref.data.type) && prefetcher_ != nullptr)
-            prefetcher_->prefetch(this, memref);
+        // Train the hardware prefetcher and issue any prefetches before we
+        // remember the last tag, so we remember this line and not a prefetched
+        // line.
+        if (!is_prefetch && prefetcher_ != nullptr)
+            prefetcher_->access(this, memref, missed, prefetch_hit);
 
         if (tag + 1 <= final_tag) {
             addr_t next_addr = (tag + 1) << block_size_bits_;
@@ -249,7 +324,73 @@ caching_device_t::request(const memref_t &memref_in)
             memref.data.size = final_addr - next_addr + 1 /*undo the -1*/;
         }
 
-        // Optimization: remember last tag
+        // Optimization: remember last tag.  A prefetch issued above may have
+        // landed in this set and evicted this line, in which case there is
+        // nothing to remember.
+        if (get_caching_device_block(block_idx, way).tag_ == tag) {
+            last_tag_ = tag;
+            last_way_ = way;
+            last_block_idx_ = block_idx;
+        } else {
+            last_tag_ = TAG_INVALID;
+        }
+    }
+}
+
+void
+caching_device_t::warm(const memref_t &memref_in, cache_result_t *result, int level)
+{
+    // We skip stats, the per-line request results other than hits and misses, and
+    // prefetch training and cancellation.  Coherence and the inclusion policy are
+    // still maintained, since the measured periods rely on them.
+    memref_t memref = memref_in;
+    addr_t final_addr = memref_in.data.addr + memref_in.data.size - 1 /*avoid overflow*/;
+    addr_t final_tag = compute_tag(final_addr);
+    cache_level_result_t *level_result =
+        result == nullptr ? nullptr : result->get_level(level);
+    bool is_prefetch = type_is_prefetch(memref_in.data.type);
+    bool is_write = memref_in.data.type == TRACE_TYPE_WRITE;
+    for (addr_t tag = compute_tag(memref_in.data.addr); tag <= final_tag; ++tag) {
+        if (!sampled_sets_.empty() && !sampled_sets_[tag & blocks_per_way_mask_])
+            continue;
+        if (level_result != nullptr)
+            ++level_result->lines;
+        addr_t line_end = ((tag + 1) << block_size_bits_) - 1;
+        memref.data.addr = std::max(tag << block_size_bits_, memref_in.data.addr);
+        memref.data.size = std::min(line_end, final_addr) - memref.data.addr + 1;
+        int block_idx = compute_block_idx(tag);
+        int way;
+        auto block_way = find_caching_device_block(tag);
+        if (block_way.first != nullptr) {
+            way = block_way.second;
+            if (!is_prefetch)
+                block_way.first->prefetched_ = false;
+            if (coherent_cache_ && is_write) {
+                if (snoop_filter_ != NULL)
+                    snoop_filter_->snoop(tag, id_, is_write);
+                else if (parent_ != NULL)
+                    parent_->propagate_write(tag, this);
+            }
+            if (is_exclusive() && !children_.empty()) {
+                invalidate(tag, INVALIDATION_EXCLUSIVE);
+                continue;
+            }
+        } else {
+            way = replace_which_way(block_idx);
+            caching_device_block_t *cache_block =
+                &get_caching_device_block(block_idx, way);
+            if (level_result != nullptr)
+                ++level_result->misses;
+            if (parent_ != nullptr)
+                parent_->request(memref, result, level + 1);
+            if (is_exclusive())
+                continue;
+            if (level_result != nullptr && cache_block->tag_ != TAG_INVALID)
+                level_result->evicted_tag = cache_block->tag_;
+            insert_tag(tag, is_write, way, block_idx);
+            cache_block->prefetched_ = is_prefetch;
+        }
+        access_update(block_idx, way);
         last_tag_ = tag;
         last_way_ = way;
         last_block_idx_ = block_idx;
@@ -298,9 +439,10 @@ caching_device_t::invalidate(addr_t tag, invalidation_type_t invalidation_type)
 {
     auto block_way = find_caching_device_block(tag);
     if (block_way.first != nullptr) {
-        invalidate_caching_device_block(block_way.first);
+        invalidate_caching_device_block(block_way.first, block_way.second);
         loaded_blocks_--;
-        stats_->invalidate(invalidation_type);
+        if (mode_ == simulation_mode_t::MEASURE)
+            stats_->invalidate(invalidation_type);
         // Invalidate last_tag_ if it was this tag.
         if (last_tag_ == tag) {
             last_tag_ = TAG_INVALID;
@@ -433,6 +575,8 @@ void
 caching_device_t::record_access_stats(const memref_t &memref, bool hit,
                                       caching_device_block_t *cache_block)
 {
+    if (mode_ != simulation_mode_t::MEASURE)
+        return;
     stats_->access(memref, hit, cache_block);
     // We propagate hits all the way up the hierarchy.
     // But to avoid over-counting we only propagate misses one level up.
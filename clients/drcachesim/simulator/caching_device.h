@@ -36,15 +36,17 @@
 #ifndef _CACHING_DEVICE_H_
 #define _CACHING_DEVICE_H_ 1
 
-#include <functional>
+#include <stdint.h>
+
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "cache_set_kernels.h"
 #include "caching_device_block.h"
 #include "caching_device_stats.h"
 #include "memref.h"
+#include "tag_index.h"
 #include "trace_entry.h"
 
 namespace dynamorio {
@@ -64,6 +66,73 @@ class prefetcher_t;
 // NON_INC_NON_EXC = Non-Inclusive Non-Exclusive, aka NINE.
 enum class cache_inclusion_policy_t { NON_INC_NON_EXC, INCLUSIVE, EXCLUSIVE };
 
+// How much work a caching device does per request, for periodic sampling.
+enum class simulation_mode_t {
+    // Only tags and replacement state are updated: no stats and no hardware
+    // prefetches.  This is the cheapest way to keep a device warm.
+    FUNCTIONAL_WARMING,
+    // Everything but stats collection, so hardware prefetchers warm up too.
+    DETAILED_WARMUP,
+    // Full simulation.
+    MEASURE,
+};
+
+// The outcome of one request at a single caching device.  A request spanning
+// several lines counts each line separately.
+struct cache_level_result_t {
+    // Whether the request reached this device at all.
+    bool
+    accessed() const
+    {
+        return lines > 0;
+    }
+    // Whether every line of the request hit.
+    bool
+    hit() const
+    {
+        return lines > 0 && misses == 0;
+    }
+    // Whether any line of the request missed.
+    bool
+    missed() const
+    {
+        return misses > 0;
+    }
+
+    // The number of lines of the request looked up here.
+    uint16_t lines = 0;
+    // How many of those lines missed.
+    uint16_t misses = 0;
+    // Whether a demand access hit a line that was brought in by a prefetch and
+    // had not been demand-accessed since.
+    bool prefetch_hit = false;
+    // The valid tag most recently evicted to make room for a missing line, or
+    // TAG_INVALID if nothing was evicted.
+    addr_t evicted_tag = TAG_INVALID;
+};
+
+// The per-level outcome of a request, filled in by caching_device_t::request().
+// Entry 0 is the device the request was issued to, entry 1 its parent, and so on
+// towards memory.  Levels beyond MAX_LEVELS are simulated but not recorded.
+// Accesses issued by hardware prefetchers are not recorded.
+struct cache_result_t {
+    static constexpr int MAX_LEVELS = 4;
+
+    void
+    reset()
+    {
+        for (cache_level_result_t &res : level)
+            res = cache_level_result_t();
+    }
+    cache_level_result_t *
+    get_level(int index)
+    {
+        return index < MAX_LEVELS ? &level[index] : nullptr;
+    }
+
+    cache_level_result_t level[MAX_LEVELS];
+};
+
 class caching_device_t {
 public:
     explicit caching_device_t(const std::string &name = "caching_device");
@@ -76,8 +145,12 @@ public:
          snoop_filter_t *snoop_filter_ = nullptr,
          const std::vector<caching_device_t *> &children = {});
     virtual ~caching_device_t();
+    // Simulates an access.  If "result" is non-null the outcome at this device is
+    // added to result->level[level] and the outcome at each ancestor the request
+    // reaches to the subsequent entries.  The caller is responsible for resetting
+    // "result" beforehand.
     virtual void
-    request(const memref_t &memref);
+    request(const memref_t &memref, cache_result_t *result = nullptr, int level = 0);
     virtual void
     invalidate(addr_t tag, invalidation_type_t invalidation_type_);
     bool
@@ -113,22 +186,48 @@ public:
     inline double
     get_loaded_fraction() const
     {
-        return double(loaded_blocks_) / num_blocks_;
+        // Blocks of unsampled sets are never loaded.
+        return double(loaded_blocks_) / (num_sampled_sets_ * associativity_);
+    }
+    // Simulates only about one in "rate" sets, selected by a hash of the set index,
+    // and has the stats scale their counts up to the whole device.  Accesses to
+    // lines in other sets are dropped without reaching the stats or the parent,
+    // so this is meant for the last level.  Must be called after init() and
+    // prior to any call to request().  A rate of 1 simulates every set.
+    void
+    set_sampling(unsigned int rate);
+    int
+    get_num_sampled_sets() const
+    {
+        return num_sampled_sets_;
+    }
+    void
+    set_simulation_mode(simulation_mode_t mode)
+    {
+        mode_ = mode;
+    }
+    simulation_mode_t
+    get_simulation_mode() const
+    {
+        return mode_;
     }
     // Must be called prior to any call to request().
     virtual inline void
     set_hashtable_use(bool use_hashtable)
     {
-        if (!use_tag2block_table_ && use_hashtable) {
-            // Resizing from an initial small table causes noticeable overhead, so we
-            // start with a relatively large table.
-            tag2block.reserve(1 << 16);
-            // Even with the large initial size, for large caches we want to keep the
-            // load factor small.
-            tag2block.max_load_factor(0.5);
-        }
+        // The table never grows: it is sized once for every block of the cache,
+        // here or in init() if that has not been called yet.
+        if (!use_tag2block_table_ && use_hashtable && blocks_ != NULL)
+            tag2block.init(num_blocks_);
         use_tag2block_table_ = use_hashtable;
     }
+    // Overrides the per-processor choice of set kernels, e.g., to compare the
+    // variants in tests.  The kernels only differ in speed.
+    void
+    select_set_kernels(set_kernel_isa_t isa)
+    {
+        set_kernel_isa_ = isa;
+    }
     int
     get_block_index(const addr_t addr) const
     {
@@ -199,6 +298,10 @@ protected:
                         caching_device_block_t *cache_block);
     virtual void
     insert_tag(addr_t tag, bool is_write, int way, int block_idx);
+    // The part of request() past the last-tag check in FUNCTIONAL_WARMING mode:
+    // only tags, replacement state and the hierarchy invariants are updated.
+    void
+    warm(const memref_t &memref_in, cache_result_t *result, int level);
 
     inline addr_t
     compute_tag(addr_t addr) const
@@ -217,10 +320,11 @@ protected:
     }
 
     inline void
-    invalidate_caching_device_block(caching_device_block_t *block)
+    invalidate_caching_device_block(caching_device_block_t *block, int way)
     {
         if (use_tag2block_table_)
             tag2block.erase(block->tag_);
+        tags_[compute_block_idx(block->tag_) + way] = TAG_INVALID;
         block->tag_ = TAG_INVALID;
     }
 
@@ -230,9 +334,11 @@ protected:
         if (use_tag2block_table_) {
             if (block->tag_ != TAG_INVALID)
                 tag2block.erase(block->tag_);
-            tag2block[new_tag] = std::make_pair(block, way);
+            tag2block.insert(new_tag, compute_block_idx(new_tag) + way);
         }
+        tags_[compute_block_idx(new_tag) + way] = new_tag;
         block->tag_ = new_tag;
+        block->prefetched_ = false;
     }
 
     // Returns the block (and its way) whose tag equals `tag`.
@@ -267,6 +373,11 @@ protected:
     // an extended block class which has its own member variables cannot be indexed
     // correctly by base class pointers.
     caching_device_block_t **blocks_;
+    // A copy of each block's tag_, indexed like blocks_ so that the ways of a set
+    // are contiguous for the set kernels.  Tags must only be changed through
+    // update_tag() and invalidate_caching_device_block() to keep the two in sync.
+    std::vector<addr_t> tags_;
+    set_kernel_isa_t set_kernel_isa_ = SET_KERNEL_SCALAR;
     int blocks_per_way_;
     // Optimization fields for fast bit operations
     int blocks_per_way_mask_;
@@ -275,20 +386,24 @@ protected:
     caching_device_stats_t *stats_;
     prefetcher_t *prefetcher_;
 
+    // For set sampling: whether each set is simulated, or empty if all are.
+    std::vector<bool> sampled_sets_;
+    int num_sampled_sets_ = 0;
+
+    simulation_mode_t mode_ = simulation_mode_t::MEASURE;
+
     // Optimization: remember last tag and its location in the cache, to
     // fast-path request processing for repeated accesses.
     addr_t last_tag_;
     int last_way_;
     int last_block_idx_;
-    // Optimization: keep a hashtable for quick lookup of {block,way}
-    // given a tag, if using a large cache hierarchy where serial
+    // Optimization: keep a hashtable for quick lookup of a tag's position in
+    // blocks_, if using a large cache hierarchy where serial
     // walks over the associativity end up as bottlenecks.
     // We can't easily remove the blocks_ array and replace with just
     // the hashtable as replace_which_way(), etc. want quick access to
     // every way for a given line index.
-    std::unordered_map<addr_t, std::pair<caching_device_block_t *, int>,
-                       std::function<unsigned long(addr_t)>>
-        tag2block;
+    tag_index_t tag2block;
     bool use_tag2block_table_ = false;
 
     // Name for this cache.
@@ -38,6 +38,8 @@
 #    include <zlib.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <locale>
@@ -47,7 +49,9 @@
 
 #include "memref.h"
 #include "options.h"
+#include "caching_device.h"
 #include "caching_device_block.h"
+#include "prefetcher.h"
 #include "trace_entry.h"
 
 namespace dynamorio {
@@ -64,6 +68,9 @@ caching_device_stats_t::caching_device_stats_t(const std::string &miss_file,
     , num_inclusive_invalidates_(0)
     , num_coherence_invalidates_(0)
     , num_exclusive_invalidates_(0)
+    , num_prefetches_useful_(0)
+    , num_prefetches_unused_(0)
+    , num_prefetches_late_(0)
     , num_hits_at_reset_(0)
     , num_misses_at_reset_(0)
     , num_child_hits_at_reset_(0)
@@ -72,6 +79,7 @@ caching_device_stats_t::caching_device_stats_t(const std::string &miss_file,
     , access_count_(block_size)
     , file_(nullptr)
     , caching_device_(nullptr)
+    , block_size_bits_(compute_log2(block_size))
 {
     if (miss_file.empty()) {
         dump_misses_ = false;
@@ -98,6 +106,9 @@ caching_device_stats_t::caching_device_stats_t(const std::string &miss_file,
     stats_map_.emplace(metric_name_t::INCLUSIVE_INVALIDATES, num_inclusive_invalidates_);
     stats_map_.emplace(metric_name_t::COHERENCE_INVALIDATES, num_coherence_invalidates_);
     stats_map_.emplace(metric_name_t::EXCLUSIVE_INVALIDATES, num_exclusive_invalidates_);
+    stats_map_.emplace(metric_name_t::PREFETCH_USEFUL, num_prefetches_useful_);
+    stats_map_.emplace(metric_name_t::PREFETCH_UNUSED, num_prefetches_unused_);
+    stats_map_.emplace(metric_name_t::PREFETCH_LATE, num_prefetches_late_);
 }
 
 caching_device_stats_t::~caching_device_stats_t()
@@ -117,6 +128,13 @@ caching_device_stats_t::access(const memref_t &memref, bool hit,
 {
     // We assume we're single-threaded.
     // We're only computing miss rate so we just inc counters here.
+    if (!set_accesses_.empty()) {
+        int set =
+            static_cast<int>(memref.data.addr >> block_size_bits_) & (num_sets_ - 1);
+        ++set_accesses_[set];
+        if (!hit)
+            ++set_misses_[set];
+    }
     if (hit)
         num_hits_++;
     else {
@@ -126,6 +144,43 @@ caching_device_stats_t::access(const memref_t &memref, bool hit,
 
         check_compulsory_miss(memref.data.addr);
     }
+    check_prefetch_use(memref, hit, cache_block);
+}
+
+void
+caching_device_stats_t::set_sampling(int num_sets, int num_sampled_sets)
+{
+    num_sets_ = num_sets;
+    num_sampled_sets_ = num_sampled_sets;
+    if (num_sampled_sets > 0 && num_sampled_sets < num_sets) {
+        sample_scale_ = static_cast<double>(num_sets) / num_sampled_sets;
+        set_accesses_.assign(num_sets, 0);
+        set_misses_.assign(num_sets, 0);
+    } else {
+        sample_scale_ = 1.0;
+        set_accesses_.clear();
+        set_misses_.clear();
+    }
+}
+
+double
+caching_device_stats_t::get_miss_rate_error() const
+{
+    if (set_accesses_.empty() || num_sampled_sets_ < 2 || num_hits_ + num_misses_ == 0)
+        return 0.;
+    // Each sampled set is one observation of (accesses, misses); unsampled sets
+    // have no accesses and are skipped.
+    double ratio = static_cast<double>(num_misses_) / (num_hits_ + num_misses_);
+    double sum_sq = 0.;
+    for (int set = 0; set < num_sets_; ++set) {
+        double residual = set_misses_[set] - ratio * set_accesses_[set];
+        sum_sq += residual * residual;
+    }
+    double n = num_sampled_sets_;
+    double mean_accesses = (num_hits_ + num_misses_) / n;
+    double variance = (1. - n / num_sets_) * sum_sq / (n - 1) /
+        (n * mean_accesses * mean_accesses);
+    return 1.96 * sqrt(variance);
 }
 
 void
@@ -150,6 +205,25 @@ caching_device_stats_t::check_compulsory_miss(addr_t addr)
     }
 }
 
+void
+caching_device_stats_t::check_prefetch_use(const memref_t &memref, bool hit,
+                                           caching_device_block_t *cache_block)
+{
+    if (cache_block == nullptr || !cache_block->prefetched_)
+        return;
+    if (hit) {
+        if (!type_is_prefetch(memref.data.type))
+            num_prefetches_useful_++;
+    } else if (cache_block->tag_ != TAG_INVALID)
+        num_prefetches_unused_++;
+}
+
+void
+caching_device_stats_t::late_prefetch()
+{
+    num_prefetches_late_++;
+}
+
 void
 caching_device_stats_t::dump_miss(const memref_t &memref)
 {
@@ -174,32 +248,40 @@ void
 caching_device_stats_t::print_warmup(std::string prefix)
 {
     std::cerr << prefix << std::setw(18) << std::left << "Warmup hits:" << std::setw(20)
-              << std::right << num_hits_at_reset_ << std::endl;
+              << std::right << scale(num_hits_at_reset_) << std::endl;
     std::cerr << prefix << std::setw(18) << std::left << "Warmup misses:" << std::setw(20)
-              << std::right << num_misses_at_reset_ << std::endl;
+              << std::right << scale(num_misses_at_reset_) << std::endl;
 }
 
 void
 caching_device_stats_t::print_counts(std::string prefix)
 {
+    if (sample_scale_ != 1.0) {
+        std::cerr << prefix << std::setw(18) << std::left
+                  << "Sampled sets:" << std::setw(20) << std::right
+                  << std::to_string(num_sampled_sets_) + "/" + std::to_string(num_sets_)
+                  << std::endl;
+    }
     std::cerr << prefix << std::setw(18) << std::left << "Hits:" << std::setw(20)
-              << std::right << num_hits_ << std::endl;
+              << std::right << scale(num_hits_) << std::endl;
     std::cerr << prefix << std::setw(18) << std::left << "Misses:" << std::setw(20)
-              << std::right << num_misses_ << std::endl;
+              << std::right << scale(num_misses_) << std::endl;
     std::cerr << prefix << std::setw(18) << std::left
               << "Compulsory misses:" << std::setw(20) << std::right
-              << num_compulsory_misses_ << std::endl;
+              << scale(num_compulsory_misses_) << std::endl;
     if (is_coherent_) {
         std::cerr << prefix << std::setw(21) << std::left
                   << "Parent invalidations:" << std::setw(17) << std::right
-                  << num_inclusive_invalidates_ + num_exclusive_invalidates_ << std::endl;
+                  << scale(num_inclusive_invalidates_ + num_exclusive_invalidates_)
+                  << std::endl;
         std::cerr << prefix << std::setw(20) << std::left
                   << "Write invalidations:" << std::setw(18) << std::right
-                  << num_coherence_invalidates_ << std::endl;
+                  << scale(num_coherence_invalidates_) << std::endl;
     } else {
         std::cerr << prefix << std::setw(18) << std::left
                   << "Invalidations:" << std::setw(20) << std::right
-                  << num_inclusive_invalidates_ + num_exclusive_invalidates_ << std::endl;
+                  << scale(num_inclusive_invalidates_ + num_exclusive_invalidates_)
+                  << std::endl;
     }
 }
 
@@ -214,6 +296,55 @@ caching_device_stats_t::print_rates(std::string prefix)
                   << std::fixed << std::setprecision(2) << std::right
                   << ((float)num_misses_ * 100 / (num_hits_ + num_misses_)) << "%"
                   << std::endl;
+        if (sample_scale_ != 1.0) {
+            std::cerr << prefix << std::setw(18) << std::left
+                      << "Miss rate error:" << std::setw(20) << std::fixed
+                      << std::setprecision(2) << std::right
+                      << get_miss_rate_error() * 100 << "% (95% confidence)"
+                      << std::endl;
+        }
+    }
+}
+
+void
+caching_device_stats_t::print_prefetch_quality(std::string prefix)
+{
+    if (caching_device_ == nullptr || caching_device_->get_prefetcher() == nullptr ||
+        caching_device_->get_prefetcher()->get_queue_size() == 0)
+        return;
+    std::cerr << prefix << std::setw(18) << std::left
+              << "Prefetches useful:" << std::setw(20) << std::right
+              << scale(num_prefetches_useful_) << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left
+              << "Prefetches unused:" << std::setw(20) << std::right
+              << scale(num_prefetches_unused_) << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left
+              << "Prefetches late:" << std::setw(20) << std::right
+              << scale(num_prefetches_late_) << std::endl;
+    // Accuracy is over the prefetched lines whose fate is known, coverage is
+    // the fraction of would-be misses that a prefetch turned into hits, and
+    // timeliness is the fraction of needed prefetches that arrived in time.
+    int64_t done = num_prefetches_useful_ + num_prefetches_unused_;
+    int64_t needed = num_prefetches_useful_ + num_prefetches_late_;
+    int64_t would_miss = num_prefetches_useful_ + num_misses_;
+    if (done > 0) {
+        std::cerr << prefix << std::setw(18) << std::left
+                  << "Prefetch accuracy:" << std::setw(20) << std::fixed
+                  << std::setprecision(2) << std::right
+                  << ((float)num_prefetches_useful_ * 100 / done) << "%" << std::endl;
+    }
+    if (would_miss > 0) {
+        std::cerr << prefix << std::setw(18) << std::left
+                  << "Prefetch coverage:" << std::setw(20) << std::fixed
+                  << std::setprecision(2) << std::right
+                  << ((float)num_prefetches_useful_ * 100 / would_miss) << "%"
+                  << std::endl;
+    }
+    if (needed > 0) {
+        std::cerr << prefix << std::setw(18) << std::left
+                  << "Prefetch timely:" << std::setw(20) << std::fixed
+                  << std::setprecision(2) << std::right
+                  << ((float)num_prefetches_useful_ * 100 / needed) << "%" << std::endl;
     }
 }
 
@@ -227,8 +358,8 @@ caching_device_stats_t::print_child_stats(std::string prefix)
         std::cerr << prefix << std::setw(18) << std::left
                   << "Total miss rate:" << std::setw(20) << std::fixed
                   << std::setprecision(2) << std::right
-                  << ((float)num_misses_ * 100 /
-                      (num_hits_ + num_child_hits_ + num_misses_))
+                  << ((float)scale(num_misses_) * 100 /
+                      (scale(num_hits_) + num_child_hits_ + scale(num_misses_)))
                   << "%" << std::endl;
     }
 }
@@ -242,6 +373,7 @@ caching_device_stats_t::print_stats(std::string prefix)
     }
     print_counts(prefix);
     print_rates(prefix);
+    print_prefetch_quality(prefix);
     print_child_stats(prefix);
     std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
 }
@@ -259,6 +391,11 @@ caching_device_stats_t::reset()
     num_inclusive_invalidates_ = 0;
     num_coherence_invalidates_ = 0;
     num_exclusive_invalidates_ = 0;
+    num_prefetches_useful_ = 0;
+    num_prefetches_unused_ = 0;
+    num_prefetches_late_ = 0;
+    std::fill(set_accesses_.begin(), set_accesses_.end(), 0);
+    std::fill(set_misses_.begin(), set_misses_.end(), 0);
 }
 
 void
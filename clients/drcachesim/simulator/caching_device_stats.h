@@ -46,6 +46,7 @@
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "caching_device_block.h"
 #include "trace_entry.h"
@@ -74,7 +75,10 @@ enum class metric_name_t {
     EXCLUSIVE_INVALIDATES,
     PREFETCH_HITS,
     PREFETCH_MISSES,
-    FLUSHES
+    FLUSHES,
+    PREFETCH_USEFUL,
+    PREFETCH_UNUSED,
+    PREFETCH_LATE
 };
 
 struct bound {
@@ -195,10 +199,30 @@ public:
     virtual void
     invalidate(invalidation_type_t invalidation_type);
 
+    // Called when a demand access misses on a line whose hardware prefetch was
+    // still waiting in the prefetcher's queue.
+    virtual void
+    late_prefetch();
+
+    // Called by a caching device that only simulates "num_sampled_sets" of its
+    // "num_sets" sets.  Counts of accesses to its blocks are then scaled up to
+    // estimates for the whole device, both in get_metric() and when printed, and
+    // the printed miss rate includes a confidence interval.
+    void
+    set_sampling(int num_sets, int num_sampled_sets);
+
+    // The half-width of the 95% confidence interval of the local miss rate when
+    // sampling sets, or 0 otherwise.  This treats the sampled sets as a simple
+    // random sample of sets and the miss rate as a ratio estimate over them.
+    double
+    get_miss_rate_error() const;
+
     int64_t
     get_metric(metric_name_t metric) const
     {
         if (stats_map_.find(metric) != stats_map_.end()) {
+            if (sample_scale_ != 1.0 && is_sampled_metric(metric))
+                return scale(stats_map_.at(metric));
             return stats_map_.at(metric);
         } else {
             ERRMSG("Wrong metric name.\n");
@@ -233,6 +257,10 @@ protected:
     print_rates(std::string prefix); // hit/miss rates
     virtual void
     print_child_stats(std::string prefix); // child/total info
+    // Prefetch accuracy, coverage and timeliness, printed only for devices with
+    // a queueing prefetcher (see prefetcher_t).
+    virtual void
+    print_prefetch_quality(std::string prefix);
 
     virtual void
     dump_miss(const memref_t &memref);
@@ -240,6 +268,28 @@ protected:
     void
     check_compulsory_miss(addr_t addr);
 
+    // Counts a demand hit on a prefetched line as a useful prefetch and the
+    // eviction of a prefetched line that was never demand-accessed as an unused
+    // one.  For a miss "cache_block" is the victim.
+    void
+    check_prefetch_use(const memref_t &memref, bool hit,
+                       caching_device_block_t *cache_block);
+
+    // Whether "metric" only counts accesses to the device's own blocks, which
+    // set sampling reduces.  Child hits and flushes are not sampled.
+    static bool
+    is_sampled_metric(metric_name_t metric)
+    {
+        return metric != metric_name_t::CHILD_HITS &&
+            metric != metric_name_t::CHILD_HITS_AT_RESET &&
+            metric != metric_name_t::FLUSHES;
+    }
+    int64_t
+    scale(int64_t count) const
+    {
+        return static_cast<int64_t>(static_cast<double>(count) * sample_scale_ + 0.5);
+    }
+
     int64_t num_hits_;
     int64_t num_misses_;
     int64_t num_compulsory_misses_;
@@ -249,6 +299,13 @@ protected:
     int64_t num_coherence_invalidates_;
     int64_t num_exclusive_invalidates_;
 
+    // Prefetched lines that were demand-accessed, that were evicted without
+    // being demand-accessed, and demand misses on lines whose prefetch was
+    // still queued.
+    int64_t num_prefetches_useful_;
+    int64_t num_prefetches_unused_;
+    int64_t num_prefetches_late_;
+
     // Stats saved when the last reset was called. This helps us get insight
     // into what the stats were when the cache was warmed up.
     int64_t num_hits_at_reset_;
@@ -276,6 +333,15 @@ protected:
 
     // Convenience pointer to the caching_device last linked to this stats object.
     caching_device_t *caching_device_;
+
+    // For set sampling: the whole-device count per sampled count, and the demand
+    // accesses and misses of each set, which are only kept when sampling.
+    double sample_scale_ = 1.0;
+    int num_sets_ = 0;
+    int num_sampled_sets_ = 0;
+    int block_size_bits_;
+    std::vector<int64_t> set_accesses_;
+    std::vector<int64_t> set_misses_;
 };
 
 } // namespace drmemtrace
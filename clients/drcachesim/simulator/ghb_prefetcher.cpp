@@ -0,0 +1,89 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "ghb_prefetcher.h"
+
+#include <stdint.h>
+
+#include "caching_device.h"
+#include "memref.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+ghb_prefetcher_t::ghb_prefetcher_t(int block_size, int degree, int queue_size,
+                                   int table_size)
+    : prefetcher_t(block_size, degree, queue_size)
+    , history_(table_size)
+    , index_(table_size)
+{
+}
+
+void
+ghb_prefetcher_t::access(caching_device_t *cache, const memref_t &memref, bool missed,
+                         bool prefetch_hit)
+{
+    addr_t tag = memref.data.addr >> block_size_bits_;
+    if ((missed || prefetch_hit) &&
+        (history_count_ == 0 || history_at(history_count_ - 1) != tag)) {
+        uint64_t pos = history_count_++;
+        history_[pos % history_.size()] = tag;
+        if (pos >= 2) {
+            int64_t delta1 =
+                static_cast<int64_t>(history_at(pos - 1) - history_at(pos - 2));
+            int64_t delta2 = static_cast<int64_t>(tag - history_at(pos - 1));
+            uint64_t slot = static_cast<uint64_t>(delta1 * 31 + delta2) % index_.size();
+            index_entry_t &entry = index_[slot];
+            // The deltas following the previous occurrence must all still be
+            // in the history.
+            if (entry.valid && entry.delta1 == delta1 && entry.delta2 == delta2 &&
+                pos - entry.pos < history_.size()) {
+                uint64_t period = pos - entry.pos;
+                addr_t target = tag;
+                for (int i = 0; i < degree_; ++i) {
+                    uint64_t from = entry.pos + i % period;
+                    target += history_at(from + 1) - history_at(from);
+                    enqueue(cache, memref, target << block_size_bits_);
+                }
+            }
+            entry.delta1 = delta1;
+            entry.delta2 = delta2;
+            entry.pos = pos;
+            entry.valid = true;
+        }
+    }
+    issue_queued(cache, memref);
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
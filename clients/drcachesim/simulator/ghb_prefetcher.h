@@ -0,0 +1,89 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* ghb_prefetcher: a global history buffer delta-correlation prefetcher.
+ */
+
+#ifndef _GHB_PREFETCHER_H_
+#define _GHB_PREFETCHER_H_ 1
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "caching_device.h"
+#include "memref.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// A global delta-correlation (G/DC) prefetcher in the style of Nesbit and
+// Smith's global history buffer.  The lines of demand misses and of first
+// demand hits on prefetched lines are appended to a circular history of
+// "table_size" entries, and an index table of the same size maps each pair of
+// consecutive line deltas to where it last occurred in the history.  When the
+// latest delta pair has occurred before, the deltas that followed it then are
+// replayed from the current line, cycling through them if there are fewer
+// than "degree", and the resulting lines are queued for prefetching.
+class ghb_prefetcher_t : public prefetcher_t {
+public:
+    ghb_prefetcher_t(int block_size, int degree, int queue_size, int table_size);
+    void
+    access(caching_device_t *cache, const memref_t &memref, bool missed,
+           bool prefetch_hit) override;
+
+protected:
+    struct index_entry_t {
+        int64_t delta1 = 0;
+        int64_t delta2 = 0;
+        // Position in the history of the second line of the delta pair.
+        uint64_t pos = 0;
+        bool valid = false;
+    };
+
+    addr_t
+    history_at(uint64_t pos) const
+    {
+        return history_[pos % history_.size()];
+    }
+
+    std::vector<addr_t> history_;
+    // The number of lines ever added to the history.
+    uint64_t history_count_ = 0;
+    std::vector<index_entry_t> index_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _GHB_PREFETCHER_H_ */
@@ -0,0 +1,491 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* miss_ratio_curve: single-pass LRU stack-distance simulation.
+ */
+
+#include "miss_ratio_curve.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache_simulator_create.h"
+#include "caching_device_block.h"
+#include "memref.h"
+#include "options.h"
+#include "simulator.h"
+#include "trace_entry.h"
+#include "utils.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+analysis_tool_t *
+miss_ratio_curve_create(const cache_simulator_knobs_t &knobs,
+                        const miss_ratio_curve_knobs_t &curve_knobs)
+{
+    return new miss_ratio_curve_t(knobs, curve_knobs);
+}
+
+lru_stack_profile_t::lru_stack_profile_t(unsigned int line_size, uint64_t min_size,
+                                         uint64_t max_size, unsigned int min_assoc,
+                                         unsigned int max_assoc, uint64_t extra_sets,
+                                         unsigned int extra_assoc)
+    : line_bits_(compute_log2(line_size))
+{
+    std::vector<std::pair<uint64_t, unsigned int>> configs;
+    for (uint64_t size = 1; size <= max_size && size != 0; size <<= 1) {
+        if (size < min_size)
+            continue;
+        bool any = false;
+        for (unsigned int assoc = 1; assoc <= max_assoc && assoc != 0; assoc <<= 1) {
+            if (assoc < min_assoc ||
+                size < static_cast<uint64_t>(line_size) * assoc)
+                continue;
+            if (!any)
+                sizes_.push_back(size);
+            any = true;
+            if (std::find(assocs_.begin(), assocs_.end(), assoc) == assocs_.end())
+                assocs_.push_back(assoc);
+            configs.emplace_back(size / line_size / assoc, assoc);
+        }
+    }
+    if (extra_sets > 0 && extra_assoc > 0)
+        configs.emplace_back(extra_sets, extra_assoc);
+    std::sort(assocs_.begin(), assocs_.end());
+    for (const auto &config : configs) {
+        set_count_t *set_count = find_set_count(config.first);
+        if (set_count == nullptr) {
+            set_counts_.emplace_back();
+            set_count = &set_counts_.back();
+            set_count->num_sets = config.first;
+            set_count->depth = 0;
+        }
+        set_count->depth = std::max(set_count->depth, config.second);
+    }
+    std::sort(set_counts_.begin(), set_counts_.end(),
+              [](const set_count_t &a, const set_count_t &b) {
+                  return a.num_sets < b.num_sets;
+              });
+    for (auto &set_count : set_counts_) {
+        set_count.pages.resize(
+            static_cast<size_t>((set_count.num_sets + (1 << SETS_PER_PAGE_BITS) - 1) >>
+                                SETS_PER_PAGE_BITS));
+        set_count.hits_at_depth.resize(set_count.depth, 0);
+    }
+}
+
+lru_stack_profile_t::set_count_t *
+lru_stack_profile_t::find_set_count(uint64_t num_sets)
+{
+    for (auto &set_count : set_counts_) {
+        if (set_count.num_sets == num_sets)
+            return &set_count;
+    }
+    return nullptr;
+}
+
+const lru_stack_profile_t::set_count_t *
+lru_stack_profile_t::find_set_count(uint64_t num_sets) const
+{
+    for (const auto &set_count : set_counts_) {
+        if (set_count.num_sets == num_sets)
+            return &set_count;
+    }
+    return nullptr;
+}
+
+addr_t *
+lru_stack_profile_t::get_set(set_count_t &set_count, addr_t tag)
+{
+    // The set counts are powers of two, as in caching_device_t::compute_block_idx().
+    uint64_t set = tag & (set_count.num_sets - 1);
+    std::unique_ptr<addr_t[]> &page = set_count.pages[set >> SETS_PER_PAGE_BITS];
+    if (!page) {
+        size_t entries = static_cast<size_t>(set_count.depth) *
+            std::min<uint64_t>(set_count.num_sets, 1 << SETS_PER_PAGE_BITS);
+        page.reset(new addr_t[entries]);
+        std::fill(page.get(), page.get() + entries, TAG_INVALID);
+    }
+    return &page[(set & ((1 << SETS_PER_PAGE_BITS) - 1)) * set_count.depth];
+}
+
+void
+lru_stack_profile_t::access(addr_t tag, bool count)
+{
+    if (count)
+        ++accesses_;
+    for (auto &set_count : set_counts_) {
+        addr_t *stack = get_set(set_count, tag);
+        unsigned int depth = 0;
+        while (depth < set_count.depth && stack[depth] != tag &&
+               stack[depth] != TAG_INVALID)
+            ++depth;
+        if (depth < set_count.depth && stack[depth] == tag) {
+            set_count.last_depth = static_cast<int>(depth);
+            if (count)
+                ++set_count.hits_at_depth[depth];
+        } else {
+            set_count.last_depth = -1;
+            if (depth == set_count.depth)
+                --depth; // Drop the least recently used line.
+        }
+        // Move everything above the old position down by one.
+        for (; depth > 0; --depth)
+            stack[depth] = stack[depth - 1];
+        stack[0] = tag;
+    }
+}
+
+void
+lru_stack_profile_t::invalidate(addr_t tag)
+{
+    for (auto &set_count : set_counts_) {
+        addr_t *stack = get_set(set_count, tag);
+        unsigned int depth = 0;
+        while (depth < set_count.depth && stack[depth] != tag &&
+               stack[depth] != TAG_INVALID)
+            ++depth;
+        if (depth == set_count.depth || stack[depth] != tag)
+            continue;
+        for (; depth + 1 < set_count.depth; ++depth)
+            stack[depth] = stack[depth + 1];
+        stack[depth] = TAG_INVALID;
+    }
+}
+
+bool
+lru_stack_profile_t::last_hit(uint64_t sets, unsigned int assoc) const
+{
+    const set_count_t *set_count = find_set_count(sets);
+    assert(set_count != nullptr && assoc <= set_count->depth);
+    return set_count->last_depth >= 0 &&
+        static_cast<unsigned int>(set_count->last_depth) < assoc;
+}
+
+int64_t
+lru_stack_profile_t::get_misses(uint64_t size, unsigned int assoc) const
+{
+    uint64_t way_size = static_cast<uint64_t>(assoc) << line_bits_;
+    if (assoc == 0 || size == 0 || size % way_size != 0)
+        return -1;
+    const set_count_t *set_count = find_set_count(size / way_size);
+    if (set_count == nullptr || assoc > set_count->depth)
+        return -1;
+    int64_t misses = accesses_;
+    for (unsigned int depth = 0; depth < assoc; ++depth)
+        misses -= set_count->hits_at_depth[depth];
+    return misses;
+}
+
+void
+lru_stack_profile_t::reset_stats()
+{
+    accesses_ = 0;
+    for (auto &set_count : set_counts_)
+        std::fill(set_count.hits_at_depth.begin(), set_count.hits_at_depth.end(), 0);
+}
+
+miss_ratio_curve_t::miss_ratio_curve_t(const cache_simulator_knobs_t &knobs,
+                                       const miss_ratio_curve_knobs_t &curve_knobs)
+    : simulator_t(knobs.num_cores, knobs.skip_refs, knobs.warmup_refs,
+                  knobs.warmup_fraction, knobs.sim_refs, knobs.cpu_scheduling,
+                  knobs.use_physical, knobs.verbose)
+    , knobs_(knobs)
+    , curve_knobs_(curve_knobs)
+    , line_bits_(compute_log2(static_cast<int>(knobs.line_size)))
+    , l1i_sets_(0)
+    , l1d_sets_(0)
+{
+    if (!success_)
+        return;
+    // The stack property only holds for LRU, and prefetches and coherence
+    // invalidations depend on the cache size being simulated.
+    if (!knobs_.replace_policy.empty() && knobs_.replace_policy != REPLACE_POLICY_LRU) {
+        error_string_ = "Usage error: the miss ratio curve requires LRU replacement";
+        success_ = false;
+        return;
+    }
+    if (knobs_.data_prefetcher != PREFETCH_POLICY_NONE) {
+        error_string_ = "Usage error: the miss ratio curve requires -data_prefetcher " +
+            std::string(PREFETCH_POLICY_NONE);
+        success_ = false;
+        return;
+    }
+    if (knobs_.model_coherence || knobs_.warmup_fraction > 0.0 ||
+        knobs_.LL_set_sample_rate > 1 || knobs_.sample_period_refs > 0) {
+        error_string_ = "Usage error: the miss ratio curve does not support -coherence, "
+                        "-warmup_fraction, -LL_set_sample_rate or -sample_period_refs";
+        success_ = false;
+        return;
+    }
+    if (line_bits_ < 2 || curve_knobs_.min_assoc == 0 ||
+        curve_knobs_.min_assoc > curve_knobs_.max_assoc ||
+        curve_knobs_.L1_min_size > curve_knobs_.L1_max_size ||
+        curve_knobs_.LL_min_size > curve_knobs_.LL_max_size) {
+        error_string_ = "Usage error: invalid miss ratio curve range";
+        success_ = false;
+        return;
+    }
+    // The L1 configuration feeding the LL must be a valid cache, as checked by
+    // caching_device_t::init().
+    uint64_t l1i_lines = knobs_.L1I_size >> line_bits_;
+    uint64_t l1d_lines = knobs_.L1D_size >> line_bits_;
+    if (knobs_.L1I_assoc == 0 || knobs_.L1D_assoc == 0 ||
+        l1i_lines % knobs_.L1I_assoc != 0 || l1d_lines % knobs_.L1D_assoc != 0 ||
+        !IS_POWER_OF_2(l1i_lines / knobs_.L1I_assoc) ||
+        !IS_POWER_OF_2(l1d_lines / knobs_.L1D_assoc) ||
+        l1i_lines / knobs_.L1I_assoc == 0 || l1d_lines / knobs_.L1D_assoc == 0) {
+        error_string_ = "Usage error: failed to initialize L1 caches.  Ensure sizes "
+                        "divided by associativities are powers of 2 "
+                        "and that the total sizes are multiples of the line size.";
+        success_ = false;
+        return;
+    }
+    l1i_sets_ = l1i_lines / knobs_.L1I_assoc;
+    l1d_sets_ = l1d_lines / knobs_.L1D_assoc;
+    uint64_t ll_lines = knobs_.LL_size >> line_bits_;
+    uint64_t ll_sets = knobs_.LL_assoc == 0 ? 0 : ll_lines / knobs_.LL_assoc;
+    if (ll_sets == 0 || ll_sets * knobs_.LL_assoc != ll_lines || !IS_POWER_OF_2(ll_sets))
+        ll_sets = 0; // Only the LL range is tracked.
+    for (unsigned int i = 0; i < knobs_.num_cores; ++i) {
+        l1i_.emplace_back(knobs_.line_size, curve_knobs_.L1_min_size,
+                          curve_knobs_.L1_max_size, curve_knobs_.min_assoc,
+                          curve_knobs_.max_assoc, l1i_sets_, knobs_.L1I_assoc);
+        l1d_.emplace_back(knobs_.line_size, curve_knobs_.L1_min_size,
+                          curve_knobs_.L1_max_size, curve_knobs_.min_assoc,
+                          curve_knobs_.max_assoc, l1d_sets_, knobs_.L1D_assoc);
+    }
+    ll_.reset(new lru_stack_profile_t(knobs_.line_size, curve_knobs_.LL_min_size,
+                                      curve_knobs_.LL_max_size, curve_knobs_.min_assoc,
+                                      curve_knobs_.max_assoc, ll_sets,
+                                      knobs_.LL_assoc));
+}
+
+void
+miss_ratio_curve_t::access_lines(lru_stack_profile_t &l1, uint64_t l1_sets,
+                                 unsigned int l1_assoc, const memref_t &memref)
+{
+    // Split the access into lines just like caching_device_t::request().
+    addr_t tag = memref.data.addr >> line_bits_;
+    addr_t final_tag = (memref.data.addr + memref.data.size - 1 /*no overflow*/) >>
+        line_bits_;
+    // Prefetches change the cache contents but are not counted as hits or misses
+    // by cache_stats_t.
+    bool count = !type_is_prefetch(memref.data.type);
+    for (; tag <= final_tag; ++tag) {
+        l1.access(tag, count);
+        if (!l1.last_hit(l1_sets, l1_assoc))
+            ll_->access(tag, count);
+    }
+}
+
+void
+miss_ratio_curve_t::flush_lines(lru_stack_profile_t &l1, const memref_t &memref)
+{
+    // XXX: Removing a line from the stack is exact for the caches holding it, but
+    // the caches that had already evicted it now see one line more than the real
+    // cache would.
+    addr_t tag = memref.flush.addr >> line_bits_;
+    addr_t final_tag = (memref.flush.addr + memref.flush.size - 1 /*no overflow*/) >>
+        line_bits_;
+    for (; tag <= final_tag; ++tag) {
+        l1.invalidate(tag);
+        ll_->invalidate(tag);
+    }
+    ++num_flushes_;
+}
+
+bool
+miss_ratio_curve_t::process_memref(const memref_t &memref)
+{
+    // The warmup and region handling mirror cache_simulator_t::process_memref().
+    if (knobs_.skip_refs > 0) {
+        knobs_.skip_refs--;
+        return true;
+    }
+    if (knobs_.warmup_refs == 0 && knobs_.sim_refs == 0)
+        return true;
+    if (is_warmed_up_ && knobs_.sim_refs == 0)
+        return true;
+
+    if (!simulator_t::process_memref(memref))
+        return false;
+
+    if (memref.marker.type == TRACE_TYPE_MARKER)
+        return true;
+
+    int core_index;
+    if (shard_type_ == SHARD_BY_THREAD) {
+        if (memref.data.tid == last_thread_)
+            core_index = last_core_index_;
+        else {
+            core_index = core_for_thread(memref.data.tid);
+            last_thread_ = memref.data.tid;
+            last_core_index_ = core_index;
+        }
+    } else
+        core_index = core_for_thread(memref.data.tid);
+
+    const memref_t *simref = &memref;
+    memref_t phys_memref;
+    if (knobs_.use_physical) {
+        phys_memref = memref2phys(memref);
+        simref = &phys_memref;
+    }
+
+    if (type_is_instr(simref->instr.type) ||
+        simref->instr.type == TRACE_TYPE_PREFETCH_INSTR) {
+        access_lines(l1i_[core_index], l1i_sets_, knobs_.L1I_assoc, *simref);
+    } else if (simref->data.type == TRACE_TYPE_READ ||
+               simref->data.type == TRACE_TYPE_WRITE ||
+               type_is_prefetch(simref->data.type)) {
+        access_lines(l1d_[core_index], l1d_sets_, knobs_.L1D_assoc, *simref);
+    } else if (simref->flush.type == TRACE_TYPE_INSTR_FLUSH) {
+        flush_lines(l1i_[core_index], *simref);
+    } else if (simref->flush.type == TRACE_TYPE_DATA_FLUSH) {
+        flush_lines(l1d_[core_index], *simref);
+    } else if (simref->exit.type == TRACE_TYPE_THREAD_EXIT) {
+        handle_thread_exit(simref->exit.tid);
+        last_thread_ = 0;
+    } else if (simref->marker.type == TRACE_TYPE_INSTR_NO_FETCH) {
+        // Just ignore.
+    } else {
+        error_string_ = "Unhandled memref type " + std::to_string(simref->data.type);
+        return false;
+    }
+
+    if (!is_warmed_up_ && knobs_.warmup_refs > 0 && --knobs_.warmup_refs == 0) {
+        is_warmed_up_ = true;
+        for (unsigned int i = 0; i < knobs_.num_cores; ++i) {
+            l1i_[i].reset_stats();
+            l1d_[i].reset_stats();
+        }
+        ll_->reset_stats();
+        if (knobs_.verbose >= 1)
+            std::cerr << "Cache simulation warmed up\n";
+    } else {
+        knobs_.sim_refs--;
+    }
+    return true;
+}
+
+int64_t
+miss_ratio_curve_t::get_misses(level_t level, uint64_t size, unsigned int assoc) const
+{
+    if (level == LEVEL_LL)
+        return ll_->get_misses(size, assoc);
+    const std::vector<lru_stack_profile_t> &l1 = level == LEVEL_L1I ? l1i_ : l1d_;
+    int64_t misses = 0;
+    for (const auto &profile : l1) {
+        int64_t core_misses = profile.get_misses(size, assoc);
+        if (core_misses < 0)
+            return -1;
+        misses += core_misses;
+    }
+    return misses;
+}
+
+int64_t
+miss_ratio_curve_t::get_accesses(level_t level) const
+{
+    if (level == LEVEL_LL)
+        return ll_->get_accesses();
+    const std::vector<lru_stack_profile_t> &l1 = level == LEVEL_L1I ? l1i_ : l1d_;
+    int64_t accesses = 0;
+    for (const auto &profile : l1)
+        accesses += profile.get_accesses();
+    return accesses;
+}
+
+void
+miss_ratio_curve_t::print_curve(const char *name, level_t level) const
+{
+    const lru_stack_profile_t &profile = level == LEVEL_LL ? *ll_ : l1i_[0];
+    int64_t accesses = get_accesses(level);
+    std::ios_base::fmtflags saved_flags(std::cerr.flags());
+    std::streamsize saved_precision = std::cerr.precision();
+    std::cerr << name << " (" << accesses << " accesses):\n";
+    std::cerr << "  " << std::setw(12) << std::left << "Size";
+    for (unsigned int assoc : profile.get_assocs())
+        std::cerr << std::setw(24) << std::right << ("assoc=" + std::to_string(assoc));
+    std::cerr << "\n";
+    for (uint64_t size : profile.get_sizes()) {
+        std::cerr << "  " << std::setw(12) << std::left << size;
+        for (unsigned int assoc : profile.get_assocs()) {
+            int64_t misses = get_misses(level, size, assoc);
+            if (misses < 0) {
+                std::cerr << std::setw(24) << std::right << "-";
+                continue;
+            }
+            // The exact miss count, followed by the miss rate.
+            double rate =
+                accesses == 0 ? 0. : static_cast<double>(misses) * 100 / accesses;
+            std::cerr << std::setw(14) << std::right << misses << " (" << std::setw(6)
+                      << std::fixed << std::setprecision(2) << rate << "%)";
+        }
+        std::cerr << "\n";
+    }
+    std::cerr.flags(saved_flags);
+    std::cerr.precision(saved_precision);
+}
+
+bool
+miss_ratio_curve_t::print_results()
+{
+    std::cerr << "Miss ratio curve results (LRU, " << knobs_.line_size
+              << "-byte lines, misses and miss rates by total size in bytes):\n";
+    std::cerr.imbue(std::locale("")); // Add commas, at least for my locale.
+    print_curve("L1I", LEVEL_L1I);
+    print_curve("L1D", LEVEL_L1D);
+    std::cerr << "LL behind L1I size=" << knobs_.L1I_size
+              << " assoc=" << knobs_.L1I_assoc << " and L1D size=" << knobs_.L1D_size
+              << " assoc=" << knobs_.L1D_assoc << "\n";
+    print_curve("LL", LEVEL_LL);
+    std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
+    if (num_flushes_ > 0) {
+        std::cerr << "Warning: " << num_flushes_
+                  << " flushes were approximated by removing the lines from "
+                     "every LRU stack.\n";
+    }
+    return true;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
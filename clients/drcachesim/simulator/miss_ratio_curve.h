@@ -0,0 +1,189 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* miss_ratio_curve: computes exact LRU miss counts for a whole range of cache
+ * sizes and associativities in a single pass, using per-set stack distances.
+ */
+
+#ifndef _MISS_RATIO_CURVE_H_
+#define _MISS_RATIO_CURVE_H_ 1
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache_simulator.h"
+#include "cache_simulator_create.h"
+#include "memref.h"
+#include "simulator.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Per-set LRU stacks for a range of power-of-two set counts.  An access at stack
+// depth d in the set selected by a cache with S sets hits in every S-set cache of
+// associativity greater than d, since an LRU set always holds exactly the most
+// recently used distinct lines mapping to it (see cache_lru_t).  Each set count
+// only tracks as many stack entries as the largest associativity that it is
+// needed for.
+class lru_stack_profile_t {
+public:
+    // Tracks every cache of "line_size"-byte lines whose total size is a power
+    // of two in [min_size, max_size] and whose associativity is a power of two in
+    // [min_assoc, max_assoc].  In addition the S-set "extra_assoc"-way
+    // configuration "extra_sets" is always tracked, even if out of range or not a
+    // power of two, so its outcome can be queried with last_hit().
+    lru_stack_profile_t(unsigned int line_size, uint64_t min_size, uint64_t max_size,
+                        unsigned int min_assoc, unsigned int max_assoc,
+                        uint64_t extra_sets = 0, unsigned int extra_assoc = 0);
+
+    // Looks up and then makes "tag" the most recently used line in its set.
+    // Only accesses with "count" set are included in the statistics.
+    void
+    access(addr_t tag, bool count);
+    // Removes "tag" from every set.
+    void
+    invalidate(addr_t tag);
+    // Whether the previous access() hit in a cache with "sets" sets and "assoc"
+    // ways, which must be a tracked configuration.
+    bool
+    last_hit(uint64_t sets, unsigned int assoc) const;
+    // Returns the counted misses of the cache of "size" bytes and "assoc" ways, or
+    // -1 if that configuration is not tracked.
+    int64_t
+    get_misses(uint64_t size, unsigned int assoc) const;
+    int64_t
+    get_accesses() const
+    {
+        return accesses_;
+    }
+    void
+    reset_stats();
+
+    // The sizes and associativities of the configurations within the range.
+    const std::vector<uint64_t> &
+    get_sizes() const
+    {
+        return sizes_;
+    }
+    const std::vector<unsigned int> &
+    get_assocs() const
+    {
+        return assocs_;
+    }
+
+private:
+    static constexpr int SETS_PER_PAGE_BITS = 8;
+
+    struct set_count_t {
+        uint64_t num_sets;
+        unsigned int depth; // Stack entries kept per set.
+        // Sets are allocated a page at a time on first use.
+        std::vector<std::unique_ptr<addr_t[]>> pages;
+        // Counted accesses found at each stack depth.
+        std::vector<int64_t> hits_at_depth;
+        // The depth of the previous access, or -1 for a miss at every depth.
+        int last_depth = -1;
+    };
+
+    set_count_t *
+    find_set_count(uint64_t num_sets);
+    const set_count_t *
+    find_set_count(uint64_t num_sets) const;
+    addr_t *
+    get_set(set_count_t &set_count, addr_t tag);
+
+    int line_bits_;
+    std::vector<uint64_t> sizes_;
+    std::vector<unsigned int> assocs_;
+    // Sorted by num_sets.
+    std::vector<set_count_t> set_counts_;
+    int64_t accesses_ = 0;
+};
+
+// Produces the miss ratio curves of the L1I, L1D and LL caches of the knob-defined
+// two-level hierarchy with LRU replacement.  The L1 curves are computed from the
+// per-core access streams.  Since the LL sees only L1 misses, its curve is for
+// the stream missing in the L1 configuration given by the regular cache knobs.
+// The curve values are identical to what cache_simulator_t reports for the same
+// configuration with -data_prefetcher none, with the exception that code or data
+// flushes are approximated by removing the lines from each LRU stack.
+class miss_ratio_curve_t : public simulator_t {
+public:
+    enum level_t {
+        LEVEL_L1I,
+        LEVEL_L1D,
+        LEVEL_LL,
+    };
+
+    miss_ratio_curve_t(const cache_simulator_knobs_t &knobs,
+                       const miss_ratio_curve_knobs_t &curve_knobs);
+    bool
+    process_memref(const memref_t &memref) override;
+    bool
+    print_results() override;
+
+    // Returns the demand misses summed over all cores at "level" for a cache of
+    // "size" bytes and "assoc" ways, or -1 if that configuration was not tracked.
+    int64_t
+    get_misses(level_t level, uint64_t size, unsigned int assoc) const;
+    // Returns the demand accesses summed over all cores at "level".
+    int64_t
+    get_accesses(level_t level) const;
+
+protected:
+    void
+    access_lines(lru_stack_profile_t &l1, uint64_t l1_sets, unsigned int l1_assoc,
+                 const memref_t &memref);
+    void
+    flush_lines(lru_stack_profile_t &l1, const memref_t &memref);
+    void
+    print_curve(const char *name, level_t level) const;
+
+    cache_simulator_knobs_t knobs_;
+    miss_ratio_curve_knobs_t curve_knobs_;
+    int line_bits_;
+    uint64_t l1i_sets_;
+    uint64_t l1d_sets_;
+    std::vector<lru_stack_profile_t> l1i_;
+    std::vector<lru_stack_profile_t> l1d_;
+    std::unique_ptr<lru_stack_profile_t> ll_;
+    bool is_warmed_up_ = false;
+    int64_t num_flushes_ = 0;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _MISS_RATIO_CURVE_H_ */
@@ -0,0 +1,499 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* opt_miss_bound: two-pass LRU versus Belady's MIN comparison.
+ */
+
+#include "opt_miss_bound.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cache_lru.h"
+#include "cache_opt.h"
+#include "cache_simulator_create.h"
+#include "cache_stats.h"
+#include "caching_device.h"
+#include "memref.h"
+#include "miss_ratio_curve.h"
+#include "options.h"
+#include "simulator.h"
+#include "trace_entry.h"
+#include "utils.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+analysis_tool_t *
+opt_miss_bound_create(const cache_simulator_knobs_t &knobs, const std::string &index_dir,
+                      unsigned int report_top)
+{
+    return new opt_miss_bound_t(knobs, index_dir, report_top);
+}
+
+namespace {
+
+// Answers the next-use query of cache_opt_t for the access being simulated,
+// whose next use was read from the index.
+class next_use_oracle_t : public cache_opt_oracle_t {
+public:
+    uint64_t
+    next_use(addr_t tag) override
+    {
+        assert(tag == tag_);
+        return next_use_;
+    }
+    addr_t tag_ = 0;
+    uint64_t next_use_ = NEXT_USE_NEVER;
+};
+
+bool
+seek_file(FILE *file, uint64_t offset)
+{
+#ifdef WINDOWS
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+} // namespace
+
+opt_miss_bound_t::opt_miss_bound_t(const cache_simulator_knobs_t &knobs,
+                                   const std::string &index_dir,
+                                   unsigned int report_top, uint64_t chunk_refs)
+    : simulator_t(knobs.num_cores, knobs.skip_refs, knobs.warmup_refs,
+                  knobs.warmup_fraction, knobs.sim_refs, knobs.cpu_scheduling,
+                  knobs.use_physical, knobs.verbose)
+    , knobs_(knobs)
+    , index_dir_(index_dir)
+    , report_top_(report_top)
+    , chunk_refs_(std::max<uint64_t>(chunk_refs, 1))
+    , line_bits_(compute_log2(static_cast<int>(knobs.line_size)))
+{
+    if (!success_)
+        return;
+    // The L1 caches are simulated with LRU stacks, which do not model prefetches
+    // or coherence.
+    if (!knobs_.replace_policy.empty() && knobs_.replace_policy != REPLACE_POLICY_LRU) {
+        error_string_ = "Usage error: the OPT miss bound requires LRU replacement";
+        success_ = false;
+        return;
+    }
+    if (knobs_.data_prefetcher != PREFETCH_POLICY_NONE) {
+        error_string_ = "Usage error: the OPT miss bound requires -data_prefetcher " +
+            std::string(PREFETCH_POLICY_NONE);
+        success_ = false;
+        return;
+    }
+    if (knobs_.model_coherence || knobs_.warmup_fraction > 0.0 ||
+        knobs_.LL_set_sample_rate > 1 || knobs_.sample_period_refs > 0) {
+        error_string_ = "Usage error: the OPT miss bound does not support -coherence, "
+                        "-warmup_fraction, -LL_set_sample_rate or -sample_period_refs";
+        success_ = false;
+        return;
+    }
+    uint64_t l1i_lines = knobs_.L1I_size >> line_bits_;
+    uint64_t l1d_lines = knobs_.L1D_size >> line_bits_;
+    if (line_bits_ < 2 || knobs_.L1I_assoc == 0 || knobs_.L1D_assoc == 0 ||
+        l1i_lines % knobs_.L1I_assoc != 0 || l1d_lines % knobs_.L1D_assoc != 0 ||
+        !IS_POWER_OF_2(l1i_lines / knobs_.L1I_assoc) ||
+        !IS_POWER_OF_2(l1d_lines / knobs_.L1D_assoc) ||
+        l1i_lines / knobs_.L1I_assoc == 0 || l1d_lines / knobs_.L1D_assoc == 0) {
+        error_string_ = "Usage error: failed to initialize L1 caches.  Ensure sizes "
+                        "divided by associativities are powers of 2 "
+                        "and that the total sizes are multiples of the line size.";
+        success_ = false;
+        return;
+    }
+    l1i_sets_ = l1i_lines / knobs_.L1I_assoc;
+    l1d_sets_ = l1d_lines / knobs_.L1D_assoc;
+    // An empty size range leaves only the L1 configuration itself tracked.
+    for (unsigned int i = 0; i < knobs_.num_cores; ++i) {
+        l1i_.emplace_back(knobs_.line_size, /*min_size=*/1, /*max_size=*/0,
+                          /*min_assoc=*/1, /*max_assoc=*/0, l1i_sets_, knobs_.L1I_assoc);
+        l1d_.emplace_back(knobs_.line_size, /*min_size=*/1, /*max_size=*/0,
+                          /*min_assoc=*/1, /*max_assoc=*/0, l1d_sets_, knobs_.L1D_assoc);
+    }
+    if (!open_index_file("refs", refs_path_, refs_file_) ||
+        !open_index_file("next_use", next_use_path_, next_use_file_)) {
+        success_ = false;
+        return;
+    }
+    pending_refs_.reserve(static_cast<size_t>(chunk_refs_));
+}
+
+opt_miss_bound_t::~opt_miss_bound_t()
+{
+    close_index_files();
+}
+
+bool
+opt_miss_bound_t::open_index_file(const char *name, std::string &path, FILE *&file)
+{
+    if (index_dir_.empty()) {
+        file = tmpfile();
+    } else {
+        path = index_dir_ + DIRSEP + "opt_miss_bound." + name;
+        file = fopen(path.c_str(), "w+b");
+    }
+    if (file == nullptr) {
+        error_string_ = "Failed to create the " + std::string(name) +
+            " index file" + (path.empty() ? "" : " " + path);
+        return false;
+    }
+    return true;
+}
+
+void
+opt_miss_bound_t::close_index_files()
+{
+    if (refs_file_ != nullptr) {
+        fclose(refs_file_);
+        refs_file_ = nullptr;
+        if (!refs_path_.empty())
+            remove(refs_path_.c_str());
+    }
+    if (next_use_file_ != nullptr) {
+        fclose(next_use_file_);
+        next_use_file_ = nullptr;
+        if (!next_use_path_.empty())
+            remove(next_use_path_.c_str());
+    }
+}
+
+bool
+opt_miss_bound_t::write_refs()
+{
+    if (pending_refs_.empty())
+        return true;
+    if (fwrite(pending_refs_.data(), sizeof(ll_ref_t), pending_refs_.size(),
+               refs_file_) != pending_refs_.size()) {
+        error_string_ = "Failed to write the LL access index";
+        return false;
+    }
+    num_refs_ += pending_refs_.size();
+    pending_refs_.clear();
+    return true;
+}
+
+void
+opt_miss_bound_t::access_lines(lru_stack_profile_t &l1, uint64_t l1_sets,
+                               unsigned int l1_assoc, const memref_t &memref, addr_t pc)
+{
+    // Split the access into lines just like caching_device_t::request().
+    addr_t tag = memref.data.addr >> line_bits_;
+    addr_t final_tag = (memref.data.addr + memref.data.size - 1 /*no overflow*/) >>
+        line_bits_;
+    // Prefetches change the cache contents but are not counted as hits or misses
+    // by cache_stats_t, and neither are warmup accesses.
+    bool count = !type_is_prefetch(memref.data.type);
+    if (!is_warmed_up_ && knobs_.warmup_refs > 0)
+        count = false;
+    addr_t flags = count ? 0 : UNCOUNTED_BIT;
+    for (; tag <= final_tag; ++tag) {
+        l1.access(tag, count);
+        if (!l1.last_hit(l1_sets, l1_assoc))
+            pending_refs_.push_back({ tag | flags, pc });
+    }
+}
+
+bool
+opt_miss_bound_t::process_memref(const memref_t &memref)
+{
+    // The warmup and region handling mirror cache_simulator_t::process_memref().
+    if (knobs_.skip_refs > 0) {
+        knobs_.skip_refs--;
+        return true;
+    }
+    if (knobs_.warmup_refs == 0 && knobs_.sim_refs == 0)
+        return true;
+    if (is_warmed_up_ && knobs_.sim_refs == 0)
+        return true;
+
+    if (!simulator_t::process_memref(memref))
+        return false;
+
+    if (memref.marker.type == TRACE_TYPE_MARKER)
+        return true;
+
+    int core_index;
+    if (shard_type_ == SHARD_BY_THREAD) {
+        if (memref.data.tid == last_thread_)
+            core_index = last_core_index_;
+        else {
+            core_index = core_for_thread(memref.data.tid);
+            last_thread_ = memref.data.tid;
+            last_core_index_ = core_index;
+        }
+    } else
+        core_index = core_for_thread(memref.data.tid);
+
+    const memref_t *simref = &memref;
+    memref_t phys_memref;
+    if (knobs_.use_physical) {
+        phys_memref = memref2phys(memref);
+        simref = &phys_memref;
+    }
+
+    if (type_is_instr(simref->instr.type) ||
+        simref->instr.type == TRACE_TYPE_PREFETCH_INSTR) {
+        access_lines(l1i_[core_index], l1i_sets_, knobs_.L1I_assoc, *simref,
+                     simref->instr.addr);
+    } else if (simref->data.type == TRACE_TYPE_READ ||
+               simref->data.type == TRACE_TYPE_WRITE ||
+               type_is_prefetch(simref->data.type)) {
+        access_lines(l1d_[core_index], l1d_sets_, knobs_.L1D_assoc, *simref,
+                     simref->data.pc);
+    } else if (simref->flush.type == TRACE_TYPE_INSTR_FLUSH ||
+               simref->flush.type == TRACE_TYPE_DATA_FLUSH) {
+        // XXX: The LL keeps flushed lines as MIN needs a single access stream.
+        lru_stack_profile_t &l1 = simref->flush.type == TRACE_TYPE_INSTR_FLUSH
+            ? l1i_[core_index]
+            : l1d_[core_index];
+        addr_t tag = simref->flush.addr >> line_bits_;
+        addr_t final_tag =
+            (simref->flush.addr + simref->flush.size - 1 /*no overflow*/) >> line_bits_;
+        for (; tag <= final_tag; ++tag)
+            l1.invalidate(tag);
+        ++num_flushes_;
+    } else if (simref->exit.type == TRACE_TYPE_THREAD_EXIT) {
+        handle_thread_exit(simref->exit.tid);
+        last_thread_ = 0;
+    } else if (simref->marker.type == TRACE_TYPE_INSTR_NO_FETCH) {
+        // Just ignore.
+    } else {
+        error_string_ = "Unhandled memref type " + std::to_string(simref->data.type);
+        return false;
+    }
+    if (pending_refs_.size() >= chunk_refs_ && !write_refs())
+        return false;
+
+    if (!is_warmed_up_ && knobs_.warmup_refs > 0 && --knobs_.warmup_refs == 0) {
+        is_warmed_up_ = true;
+        if (knobs_.verbose >= 1)
+            std::cerr << "Cache simulation warmed up\n";
+    } else {
+        knobs_.sim_refs--;
+    }
+    return true;
+}
+
+bool
+opt_miss_bound_t::build_next_use()
+{
+    // Walk the accesses backward a chunk at a time, remembering the most recent
+    // position of each line, and write each chunk of next uses in place.
+    std::vector<ll_ref_t> refs(static_cast<size_t>(chunk_refs_));
+    std::vector<uint64_t> next_use(static_cast<size_t>(chunk_refs_));
+    std::unordered_map<addr_t, uint64_t> next_pos;
+    uint64_t end = num_refs_;
+    while (end > 0) {
+        uint64_t start = end > chunk_refs_ ? end - chunk_refs_ : 0;
+        size_t count = static_cast<size_t>(end - start);
+        if (!seek_file(refs_file_, start * sizeof(ll_ref_t)) ||
+            fread(refs.data(), sizeof(ll_ref_t), count, refs_file_) != count) {
+            error_string_ = "Failed to read the LL access index";
+            return false;
+        }
+        for (size_t i = count; i-- > 0;) {
+            auto it = next_pos.emplace(refs[i].tag & ~UNCOUNTED_BIT, 0).first;
+            next_use[i] = it->second == 0 ? cache_opt_oracle_t::NEXT_USE_NEVER
+                                          : it->second - 1;
+            // Stored off by one so that 0 means not seen.
+            it->second = start + i + 1;
+        }
+        if (!seek_file(next_use_file_, start * sizeof(uint64_t)) ||
+            fwrite(next_use.data(), sizeof(uint64_t), count, next_use_file_) != count) {
+            error_string_ = "Failed to write the next-use index";
+            return false;
+        }
+        end = start;
+    }
+    if (knobs_.verbose >= 1) {
+        std::cerr << "Built the next-use index of " << num_refs_ << " LL accesses to "
+                  << next_pos.size() << " lines\n";
+    }
+    return true;
+}
+
+bool
+opt_miss_bound_t::simulate()
+{
+    // Both caches use the LL geometry; the L1 misses were already filtered out.
+    std::unique_ptr<cache_stats_t> lru_stats(new cache_stats_t(knobs_.line_size));
+    std::unique_ptr<cache_stats_t> opt_stats(new cache_stats_t(knobs_.line_size));
+    next_use_oracle_t oracle;
+    cache_lru_t lru("LL_LRU");
+    cache_opt_t opt("LL_OPT");
+    if (!lru.init(knobs_.LL_assoc, knobs_.line_size, static_cast<int>(knobs_.LL_size),
+                  nullptr, lru_stats.get()) ||
+        !opt.init(knobs_.LL_assoc, knobs_.line_size, static_cast<int>(knobs_.LL_size),
+                  nullptr, opt_stats.get())) {
+        error_string_ = "Usage error: failed to initialize LL cache.  Ensure size "
+                        "divided by associativity is a power of 2 "
+                        "and that the total size is a multiple of the line size.";
+        return false;
+    }
+    opt.set_oracle(&oracle);
+    std::vector<ll_ref_t> refs(static_cast<size_t>(chunk_refs_));
+    std::vector<uint64_t> next_use(static_cast<size_t>(chunk_refs_));
+    if (!seek_file(refs_file_, 0) || !seek_file(next_use_file_, 0)) {
+        error_string_ = "Failed to rewind the LL access index";
+        return false;
+    }
+    memref_t ref = {};
+    ref.data.type = TRACE_TYPE_READ;
+    ref.data.size = 1;
+    cache_result_t result;
+    for (uint64_t start = 0; start < num_refs_; start += chunk_refs_) {
+        size_t count = static_cast<size_t>(std::min(chunk_refs_, num_refs_ - start));
+        if (fread(refs.data(), sizeof(ll_ref_t), count, refs_file_) != count ||
+            fread(next_use.data(), sizeof(uint64_t), count, next_use_file_) != count) {
+            error_string_ = "Failed to read the LL access index";
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            addr_t tag = refs[i].tag & ~UNCOUNTED_BIT;
+            ref.data.addr = tag << line_bits_;
+            ref.data.pc = refs[i].pc;
+            oracle.tag_ = tag;
+            oracle.next_use_ = next_use[i];
+            result.reset();
+            lru.request(ref, &result);
+            bool lru_miss = result.level[0].missed();
+            result.reset();
+            opt.request(ref, &result);
+            bool opt_miss = result.level[0].missed();
+            if ((refs[i].tag & UNCOUNTED_BIT) != 0)
+                continue;
+            pc_misses_t &pc_misses = pc_misses_[refs[i].pc];
+            ++pc_misses.accesses;
+            ++total_.accesses;
+            if (lru_miss) {
+                ++pc_misses.lru_misses;
+                ++total_.lru_misses;
+            }
+            if (opt_miss) {
+                ++pc_misses.opt_misses;
+                ++total_.opt_misses;
+            }
+        }
+    }
+    return true;
+}
+
+bool
+opt_miss_bound_t::compute_bound()
+{
+    if (computed_)
+        return true;
+    computed_ = true;
+    if (!write_refs() || !build_next_use() || !simulate()) {
+        success_ = false;
+        return false;
+    }
+    close_index_files();
+    return true;
+}
+
+bool
+opt_miss_bound_t::print_results()
+{
+    if (!compute_bound())
+        return false;
+    std::cerr << "OPT miss bound results (LL size=" << knobs_.LL_size
+              << " assoc=" << knobs_.LL_assoc << " behind L1I size=" << knobs_.L1I_size
+              << " assoc=" << knobs_.L1I_assoc << " and L1D size=" << knobs_.L1D_size
+              << " assoc=" << knobs_.L1D_assoc << ", " << knobs_.line_size
+              << "-byte lines):\n";
+    auto print_rate = [](int64_t misses, int64_t accesses) {
+        std::cerr << std::setw(18) << std::right << misses;
+        if (accesses > 0) {
+            std::cerr << " (" << std::fixed << std::setprecision(2)
+                      << (static_cast<double>(misses) * 100 / accesses) << "%)";
+        }
+        std::cerr << "\n";
+    };
+    std::cerr << "  " << std::setw(18) << std::left << "LL accesses:" << std::setw(18)
+              << std::right << total_.accesses << "\n";
+    std::cerr << "  " << std::setw(18) << std::left << "LRU misses:";
+    print_rate(total_.lru_misses, total_.accesses);
+    std::cerr << "  " << std::setw(18) << std::left << "OPT misses:";
+    print_rate(total_.opt_misses, total_.accesses);
+    std::cerr << "  " << std::setw(18) << std::left << "Avoidable misses:";
+    print_rate(total_.lru_misses - total_.opt_misses, total_.accesses);
+
+    std::vector<std::pair<addr_t, pc_misses_t>> top(pc_misses_.begin(),
+                                                   pc_misses_.end());
+    std::sort(top.begin(), top.end(),
+              [](const std::pair<addr_t, pc_misses_t> &a,
+                 const std::pair<addr_t, pc_misses_t> &b) {
+                  int64_t gap_a = a.second.lru_misses - a.second.opt_misses;
+                  int64_t gap_b = b.second.lru_misses - b.second.opt_misses;
+                  if (gap_a != gap_b)
+                      return gap_a > gap_b;
+                  return a.first < b.first;
+              });
+    if (top.size() > report_top_)
+        top.resize(report_top_);
+    std::cerr << "Top " << top.size() << " PCs by avoidable LL misses:\n";
+    std::cerr << "  " << std::setw(18) << std::left << "PC" << std::setw(14)
+              << std::right << "Accesses" << std::setw(14) << "LRU misses"
+              << std::setw(14) << "OPT misses" << std::setw(14) << "Avoidable"
+              << "\n";
+    for (const auto &entry : top) {
+        std::cerr << "  0x" << std::setw(16) << std::left << std::hex << entry.first
+                  << std::dec << std::setw(14) << std::right << entry.second.accesses
+                  << std::setw(14) << entry.second.lru_misses << std::setw(14)
+                  << entry.second.opt_misses << std::setw(14)
+                  << entry.second.lru_misses - entry.second.opt_misses << "\n";
+    }
+    if (num_flushes_ > 0) {
+        std::cerr << "Warning: " << num_flushes_
+                  << " flushes were applied to the L1 caches only.\n";
+    }
+    return true;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
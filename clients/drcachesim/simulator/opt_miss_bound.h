@@ -0,0 +1,168 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* opt_miss_bound: compares the LL misses of LRU replacement with the minimum that
+ * any replacement policy could achieve, per PC, using Belady's MIN on the LL
+ * access stream recorded to disk.
+ */
+
+#ifndef _OPT_MISS_BOUND_H_
+#define _OPT_MISS_BOUND_H_ 1
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cache_simulator_create.h"
+#include "memref.h"
+#include "miss_ratio_curve.h"
+#include "simulator.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Computes the LL misses of the knob-defined two-level hierarchy both with LRU
+// replacement, as reported by cache_simulator_t with -data_prefetcher none, and
+// with Belady's MIN (cache_opt_t), and attributes them to the PC of each access.
+//
+// While the trace is processed, the LL access stream, i.e., the lines missing in
+// the LRU L1 caches, is appended to a file.  At the end a backward pass over that
+// file writes the position of the next access to each line into a second file,
+// and a forward pass over both simulates the LL with each policy.  Only the
+// distinct lines are held in memory, so traces whose LL stream does not fit in
+// memory can be analyzed as long as it fits on disk.
+class opt_miss_bound_t : public simulator_t {
+public:
+    // The index files are created in "index_dir", or as anonymous temporary
+    // files if it is empty, and are removed when done.  They are read and
+    // written "chunk_refs" accesses at a time.  The "report_top" PCs with the
+    // largest gap between the two policies are printed.
+    opt_miss_bound_t(const cache_simulator_knobs_t &knobs, const std::string &index_dir,
+                     unsigned int report_top, uint64_t chunk_refs = 1 << 16);
+    ~opt_miss_bound_t() override;
+    bool
+    process_memref(const memref_t &memref) override;
+    bool
+    print_results() override;
+
+    // Runs the next-use and replacement passes over the LL accesses recorded so
+    // far, unless already done.  Called by print_results().  Returns false and
+    // sets the error string on failure.
+    bool
+    compute_bound();
+
+    struct pc_misses_t {
+        int64_t accesses = 0;
+        int64_t lru_misses = 0;
+        int64_t opt_misses = 0;
+    };
+    // These are only valid after compute_bound().
+    int64_t
+    get_accesses() const
+    {
+        return total_.accesses;
+    }
+    int64_t
+    get_lru_misses() const
+    {
+        return total_.lru_misses;
+    }
+    int64_t
+    get_opt_misses() const
+    {
+        return total_.opt_misses;
+    }
+    const std::unordered_map<addr_t, pc_misses_t> &
+    get_pc_misses() const
+    {
+        return pc_misses_;
+    }
+
+protected:
+    // One LL access as recorded on disk.
+    struct ll_ref_t {
+        // The line tag, with UNCOUNTED_BIT set for warmup and prefetch accesses,
+        // which change the cache contents but are not counted.  A tag has at
+        // least two bits less than an address so the top bit is free.
+        addr_t tag;
+        addr_t pc;
+    };
+    static constexpr addr_t UNCOUNTED_BIT = static_cast<addr_t>(1)
+        << (sizeof(addr_t) * 8 - 1);
+
+    void
+    access_lines(lru_stack_profile_t &l1, uint64_t l1_sets, unsigned int l1_assoc,
+                 const memref_t &memref, addr_t pc);
+    bool
+    open_index_file(const char *name, std::string &path, FILE *&file);
+    bool
+    write_refs();
+    bool
+    build_next_use();
+    bool
+    simulate();
+    void
+    close_index_files();
+
+    cache_simulator_knobs_t knobs_;
+    std::string index_dir_;
+    unsigned int report_top_;
+    uint64_t chunk_refs_;
+    int line_bits_;
+    uint64_t l1i_sets_ = 0;
+    uint64_t l1d_sets_ = 0;
+    std::vector<lru_stack_profile_t> l1i_;
+    std::vector<lru_stack_profile_t> l1d_;
+    bool is_warmed_up_ = false;
+    int64_t num_flushes_ = 0;
+
+    // The accesses not yet written to refs_file_.
+    std::vector<ll_ref_t> pending_refs_;
+    uint64_t num_refs_ = 0;
+    std::string refs_path_;
+    std::string next_use_path_;
+    FILE *refs_file_ = nullptr;
+    FILE *next_use_file_ = nullptr;
+
+    bool computed_ = false;
+    pc_misses_t total_;
+    std::unordered_map<addr_t, pc_misses_t> pc_misses_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _OPT_MISS_BOUND_H_ */
@@ -35,19 +35,33 @@
 
 #include "prefetcher.h"
 
+#include <algorithm>
+
 #include "memref.h"
 #include "caching_device.h"
 #include "trace_entry.h"
+#include "utils.h"
 
 namespace dynamorio {
 namespace drmemtrace {
 
-prefetcher_t::prefetcher_t(int block_size)
+prefetcher_t::prefetcher_t(int block_size, int degree, int queue_size)
     : block_size_(block_size)
+    , block_size_bits_(compute_log2(block_size))
+    , degree_(degree)
+    , queue_size_(queue_size)
 {
     // Nothing else to do.
 }
 
+void
+prefetcher_t::access(caching_device_t *cache, const memref_t &memref, bool missed,
+                     bool prefetch_hit)
+{
+    if (missed)
+        prefetch(cache, memref);
+}
+
 void
 prefetcher_t::prefetch(caching_device_t *cache, const memref_t &memref_in)
 {
@@ -58,5 +72,53 @@ prefetcher_t::prefetch(caching_device_t *cache, const memref_t &memref_in)
     cache->request(memref);
 }
 
+bool
+prefetcher_t::cancel(addr_t addr)
+{
+    auto it = std::find(queue_.begin(), queue_.end(), addr >> block_size_bits_);
+    if (it == queue_.end())
+        return false;
+    queue_.erase(it);
+    return true;
+}
+
+void
+prefetcher_t::enqueue(caching_device_t *cache, const memref_t &memref, addr_t addr)
+{
+    addr_t tag = addr >> block_size_bits_;
+    if (cache->contains_tag(tag))
+        return;
+    if (queue_size_ == 0) {
+        issue(cache, memref, tag << block_size_bits_);
+        return;
+    }
+    if (std::find(queue_.begin(), queue_.end(), tag) != queue_.end())
+        return;
+    if (static_cast<int>(queue_.size()) >= queue_size_)
+        queue_.pop_front();
+    queue_.push_back(tag);
+}
+
+void
+prefetcher_t::issue_queued(caching_device_t *cache, const memref_t &memref)
+{
+    if (queue_.empty())
+        return;
+    addr_t tag = queue_.front();
+    queue_.pop_front();
+    issue(cache, memref, tag << block_size_bits_);
+}
+
+void
+prefetcher_t::issue(caching_device_t *cache, const memref_t &memref_in,
+                    addr_t line_addr)
+{
+    memref_t memref = memref_in;
+    memref.data.type = TRACE_TYPE_HARDWARE_PREFETCH;
+    memref.data.addr = line_addr;
+    memref.data.size = block_size_;
+    cache->request(memref);
+}
+
 } // namespace drmemtrace
 } // namespace dynamorio
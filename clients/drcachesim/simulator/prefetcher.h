@@ -36,6 +36,8 @@
 #ifndef _PREFETCHER_H_
 #define _PREFETCHER_H_ 1
 
+#include <deque>
+
 #include "caching_device.h"
 #include "memref.h"
 
@@ -44,17 +46,64 @@ namespace drmemtrace {
 
 class caching_device_t;
 
+// The base class issues a next-line prefetch on each demand miss, straight
+// into the cache.  Subclasses model real prefetchers: they train on the demand
+// stream in access(), add the lines they predict to a bounded prefetch queue
+// with enqueue(), and let issue_queued() drain that queue one line per demand
+// access.  A demand miss on a line still waiting in the queue is counted as a
+// late prefetch by the cache.
 class prefetcher_t {
 public:
-    prefetcher_t(int block_size);
+    // A "queue_size" of 0 issues each prefetch as soon as it is enqueued.
+    prefetcher_t(int block_size, int degree = 1, int queue_size = 0);
     virtual ~prefetcher_t()
     {
     }
+    // Called by the cache on each demand access after its lookup and any fill,
+    // except for repeated accesses to the most recently accessed line.
+    // "missed" is set for a demand miss and "prefetch_hit" for the first demand
+    // hit on a prefetched line, which would have been a miss without
+    // prefetching.  The default calls prefetch() on a miss.
+    virtual void
+    access(caching_device_t *cache, const memref_t &memref, bool missed,
+           bool prefetch_hit);
+    // Issues a next-line prefetch.
     virtual void
     prefetch(caching_device_t *cache, const memref_t &memref);
+    // Removes the line containing "addr" from the prefetch queue, returning
+    // whether it was there.
+    bool
+    cancel(addr_t addr);
+    int
+    get_degree() const
+    {
+        return degree_;
+    }
+    int
+    get_queue_size() const
+    {
+        return queue_size_;
+    }
+
+protected:
+    // Queues a prefetch of the line containing "addr", triggered by "memref",
+    // unless it is already queued or present in "cache".  When the queue is
+    // full the oldest entry is dropped.
+    void
+    enqueue(caching_device_t *cache, const memref_t &memref, addr_t addr);
+    // Issues the oldest queued prefetch, if any, on behalf of "memref".
+    void
+    issue_queued(caching_device_t *cache, const memref_t &memref);
+    // Sends a hardware prefetch of the line at "line_addr" to "cache".
+    void
+    issue(caching_device_t *cache, const memref_t &memref, addr_t line_addr);
 
-private:
     int block_size_;
+    int block_size_bits_;
+    int degree_;
+    int queue_size_;
+    // Line addresses, oldest first.
+    std::deque<addr_t> queue_;
 };
 
 } // namespace drmemtrace
@@ -105,6 +105,35 @@ simulator_t::initialize_shard_type(shard_type_t shard_type)
     return "";
 }
 
+bool
+simulator_t::speculate(const memref_t &memref)
+{
+    if (knob_speculate_instrs_ == 0 || !type_is_instr(memref.instr.type))
+        return true;
+    if (serial_stream_ == nullptr) {
+        error_string_ = "Speculation requires a serial stream";
+        return false;
+    }
+    uint64_t &left = speculation_left_[serial_stream_->get_shard_index()];
+    if (left > 0) {
+        // This instruction is on the wrong path.  Ending here makes the next
+        // record the one after the mispredicted branch.
+        if (--left == 0 && !serial_stream_->end_speculation()) {
+            error_string_ = "Failed to end speculation";
+            return false;
+        }
+        return true;
+    }
+    if (memref.instr.type == TRACE_TYPE_INSTR_TAKEN_JUMP) {
+        if (!serial_stream_->begin_speculation(memref.instr.addr + memref.instr.size)) {
+            error_string_ = "Failed to start speculation";
+            return false;
+        }
+        left = knob_speculate_instrs_;
+    }
+    return true;
+}
+
 bool
 simulator_t::process_memref(const memref_t &memref)
 {
@@ -102,6 +102,13 @@ protected:
     addr_t
     synthetic_virt2phys(addr_t virt) const;
 
+    // Models a static not-taken branch predictor when knob_speculate_instrs_ is
+    // non-zero: each taken conditional branch starts a wrong-path fetch of that many
+    // instructions down its fall-through path.  Must be called on every record,
+    // including dropped ones, so that every path is ended.
+    bool
+    speculate(const memref_t &memref);
+
     // We use -1 instead of INVALID_THREAD_ID==0 because we have many tests
     // which set tid to 0 to mean "don't care".
     static constexpr memref_tid_t INVALID_LAST_THREAD = -1;
@@ -115,6 +122,7 @@ protected:
     bool knob_cpu_scheduling_;
     bool knob_use_physical_;
     unsigned int knob_verbose_;
+    uint64_t knob_speculate_instrs_ = 0;
 
     shard_type_t shard_type_ = SHARD_BY_THREAD;
     memtrace_stream_t *serial_stream_ = nullptr;
@@ -133,6 +141,9 @@ protected:
     size_t page_size_ = 0;
     std::unordered_map<addr_t, addr_t> virt2phys_;
     addr_t prior_phys_addr_ = 0;
+
+    // Wrong-path instructions still to be fetched, per shard.
+    std::unordered_map<int, uint64_t> speculation_left_;
 };
 
 } // namespace drmemtrace
@@ -0,0 +1,95 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "stream_prefetcher.h"
+
+#include <stdint.h>
+
+#include "caching_device.h"
+#include "memref.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+stream_prefetcher_t::stream_prefetcher_t(int block_size, int degree, int queue_size,
+                                         int num_streams)
+    : prefetcher_t(block_size, degree, queue_size)
+    , streams_(num_streams)
+{
+}
+
+void
+stream_prefetcher_t::access(caching_device_t *cache, const memref_t &memref,
+                            bool missed, bool prefetch_hit)
+{
+    if (missed || prefetch_hit) {
+        addr_t tag = memref.data.addr >> block_size_bits_;
+        stream_t *match = nullptr;
+        stream_t *victim = &streams_[0];
+        for (stream_t &stream : streams_) {
+            if (stream.valid && tag + STREAM_WINDOW >= stream.last_tag &&
+                tag <= stream.last_tag + STREAM_WINDOW) {
+                match = &stream;
+                break;
+            }
+            if (!stream.valid ||
+                (victim->valid && stream.last_use < victim->last_use))
+                victim = &stream;
+        }
+        if (match == nullptr) {
+            victim->valid = true;
+            victim->last_tag = tag;
+            victim->direction = 0;
+            victim->confirmed = false;
+            victim->last_use = ++use_counter_;
+        } else {
+            match->last_use = ++use_counter_;
+            if (tag != match->last_tag) {
+                int direction = tag > match->last_tag ? 1 : -1;
+                match->confirmed = direction == match->direction;
+                match->direction = direction;
+                match->last_tag = tag;
+                if (match->confirmed) {
+                    for (int i = 1; i <= degree_; ++i) {
+                        enqueue(cache, memref,
+                                (tag + direction * i) << block_size_bits_);
+                    }
+                }
+            }
+        }
+    }
+    issue_queued(cache, memref);
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
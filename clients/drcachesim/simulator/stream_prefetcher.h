@@ -0,0 +1,81 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* stream_prefetcher: a multi-stream sequential prefetcher.
+ */
+
+#ifndef _STREAM_PREFETCHER_H_
+#define _STREAM_PREFETCHER_H_ 1
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "caching_device.h"
+#include "memref.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Tracks up to "num_streams" independent streams of lines moving up or down
+// through memory.  Streams are trained by demand misses and by the first
+// demand hits on prefetched lines; a line within STREAM_WINDOW lines of a
+// stream's last line advances that stream, and any other line replaces the
+// least recently used stream.  Once a stream has moved twice in the same
+// direction the next "degree" lines ahead of it are queued for prefetching.
+class stream_prefetcher_t : public prefetcher_t {
+public:
+    stream_prefetcher_t(int block_size, int degree, int queue_size, int num_streams);
+    void
+    access(caching_device_t *cache, const memref_t &memref, bool missed,
+           bool prefetch_hit) override;
+
+protected:
+    struct stream_t {
+        addr_t last_tag = 0;
+        int direction = 0;
+        // Whether the last two moves were in "direction".
+        bool confirmed = false;
+        uint64_t last_use = 0;
+        bool valid = false;
+    };
+    static constexpr int STREAM_WINDOW = 16;
+
+    std::vector<stream_t> streams_;
+    uint64_t use_counter_ = 0;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _STREAM_PREFETCHER_H_ */
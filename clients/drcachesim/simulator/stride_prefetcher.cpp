@@ -0,0 +1,86 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "stride_prefetcher.h"
+
+#include <stdint.h>
+
+#include "caching_device.h"
+#include "memref.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+stride_prefetcher_t::stride_prefetcher_t(int block_size, int degree, int queue_size,
+                                         int table_size)
+    : prefetcher_t(block_size, degree, queue_size)
+    , table_(table_size)
+{
+}
+
+void
+stride_prefetcher_t::access(caching_device_t *cache, const memref_t &memref,
+                            bool missed, bool prefetch_hit)
+{
+    addr_t pc = memref.data.pc;
+    addr_t addr = memref.data.addr;
+    entry_t &entry = table_[pc % table_.size()];
+    if (entry.pc != pc) {
+        // A new PC takes over the entry.
+        entry.pc = pc;
+        entry.last_addr = addr;
+        entry.stride = 0;
+        entry.confidence = 0;
+    } else if (addr != entry.last_addr) {
+        int64_t stride = static_cast<int64_t>(addr - entry.last_addr);
+        if (stride == entry.stride) {
+            if (entry.confidence < MAX_CONFIDENCE)
+                ++entry.confidence;
+        } else if (entry.confidence > 0)
+            --entry.confidence;
+        else
+            entry.stride = stride;
+        entry.last_addr = addr;
+        if (entry.confidence >= PREFETCH_CONFIDENCE) {
+            int64_t step = entry.stride;
+            if (step > -block_size_ && step < block_size_)
+                step = step < 0 ? -block_size_ : block_size_;
+            for (int i = 1; i <= degree_; ++i)
+                enqueue(cache, memref, addr + step * i);
+        }
+    }
+    issue_queued(cache, memref);
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
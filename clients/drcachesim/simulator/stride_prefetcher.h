@@ -0,0 +1,78 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* stride_prefetcher: a per-PC stride prefetcher.
+ */
+
+#ifndef _STRIDE_PREFETCHER_H_
+#define _STRIDE_PREFETCHER_H_ 1
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "caching_device.h"
+#include "memref.h"
+#include "prefetcher.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// A reference prediction table indexed by the PC of each demand access.  Each
+// entry remembers the last address and stride of its PC along with a
+// saturating confidence counter.  Once a stride repeats often enough, the next
+// "degree" addresses along it are queued for prefetching.  Strides within a
+// line are rounded up to a line so that each prediction names a new line.
+class stride_prefetcher_t : public prefetcher_t {
+public:
+    stride_prefetcher_t(int block_size, int degree, int queue_size, int table_size);
+    void
+    access(caching_device_t *cache, const memref_t &memref, bool missed,
+           bool prefetch_hit) override;
+
+protected:
+    struct entry_t {
+        addr_t pc = 0;
+        addr_t last_addr = 0;
+        int64_t stride = 0;
+        int confidence = 0;
+    };
+    static constexpr int MAX_CONFIDENCE = 3;
+    static constexpr int PREFETCH_CONFIDENCE = 2;
+
+    std::vector<entry_t> table_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _STRIDE_PREFETCHER_H_ */
@@ -0,0 +1,151 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* tag_index: a flat open-addressing map from block tags to block positions.
+ */
+
+#ifndef _TAG_INDEX_H_
+#define _TAG_INDEX_H_ 1
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "caching_device_block.h"
+#include "memref.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Maps the tags held by a caching device to their positions in its block array.
+// This uses linear probing over one flat array with backward-shift deletion, so
+// there are no per-entry allocations or tombstones and a probe sequence reads
+// consecutive memory.  The table is sized for at most max_entries tags with a
+// load factor of at most 1/2, which a cache never exceeds since it cannot hold
+// more tags than it has blocks.
+class tag_index_t {
+public:
+    void
+    init(int max_entries)
+    {
+        size_t capacity = 16;
+        int bits = 4;
+        while (capacity < 2 * static_cast<size_t>(max_entries)) {
+            capacity <<= 1;
+            ++bits;
+        }
+        entries_.assign(capacity, { TAG_INVALID, 0 });
+        mask_ = capacity - 1;
+        shift_ = 64 - bits;
+        size_ = 0;
+    }
+    // Returns the position recorded for "tag", or -1 if it is not present.
+    inline int
+    find(addr_t tag) const
+    {
+        for (size_t slot = home_slot(tag);; slot = (slot + 1) & mask_) {
+            const entry_t &entry = entries_[slot];
+            if (entry.tag == tag)
+                return entry.position;
+            if (entry.tag == TAG_INVALID)
+                return -1;
+        }
+    }
+    // Records "position" for "tag", replacing any existing position.
+    inline void
+    insert(addr_t tag, int position)
+    {
+        assert(tag != TAG_INVALID);
+        size_t slot = home_slot(tag);
+        while (entries_[slot].tag != TAG_INVALID && entries_[slot].tag != tag)
+            slot = (slot + 1) & mask_;
+        if (entries_[slot].tag == TAG_INVALID) {
+            ++size_;
+            assert(size_ <= entries_.size() / 2);
+        }
+        entries_[slot].tag = tag;
+        entries_[slot].position = position;
+    }
+    inline void
+    erase(addr_t tag)
+    {
+        size_t hole = home_slot(tag);
+        while (entries_[hole].tag != tag) {
+            if (entries_[hole].tag == TAG_INVALID)
+                return;
+            hole = (hole + 1) & mask_;
+        }
+        --size_;
+        // Shift back any later entry of the run that may live in the hole, so that
+        // lookups never need to skip over deleted slots.
+        for (size_t slot = (hole + 1) & mask_; entries_[slot].tag != TAG_INVALID;
+             slot = (slot + 1) & mask_) {
+            size_t home = home_slot(entries_[slot].tag);
+            if (((slot - home) & mask_) >= ((slot - hole) & mask_)) {
+                entries_[hole] = entries_[slot];
+                hole = slot;
+            }
+        }
+        entries_[hole].tag = TAG_INVALID;
+    }
+    size_t
+    size() const
+    {
+        return size_;
+    }
+
+private:
+    struct entry_t {
+        addr_t tag;
+        int32_t position;
+    };
+
+    inline size_t
+    home_slot(addr_t tag) const
+    {
+        // Fibonacci hashing spreads the strided tags of large caches over the table.
+        return static_cast<size_t>(
+            (static_cast<uint64_t>(tag) * 0x9e3779b97f4a7c15ULL) >> shift_);
+    }
+
+    std::vector<entry_t> entries_;
+    size_t mask_ = 0;
+    int shift_ = 64;
+    size_t size_ = 0;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _TAG_INDEX_H_ */
@@ -53,7 +53,7 @@ tlb_t::init_blocks()
 }
 
 void
-tlb_t::request(const memref_t &memref_in)
+tlb_t::request(const memref_t &memref_in, cache_result_t *result, int level)
 {
     // XXX: any better way to derive caching_device_t::request?
     // Since pid is needed in a lot of places from the beginning to the end,
@@ -73,6 +73,8 @@ tlb_t::request(const memref_t &memref_in)
     addr_t final_tag = compute_tag(final_addr);
     addr_t tag = compute_tag(memref_in.data.addr);
     memref_pid_t pid = memref_in.data.pid;
+    cache_level_result_t *level_result =
+        result == nullptr ? nullptr : result->get_level(level);
 
     // Optimization: check last tag and pid if single-block
     if (tag == final_tag && tag == last_tag_ && pid == last_pid_) {
@@ -83,6 +85,8 @@ tlb_t::request(const memref_t &memref_in)
                pid == ((tlb_entry_t *)tlb_entry)->pid_);
         record_access_stats(memref_in, true /*hit*/, tlb_entry);
         access_update(last_block_idx_, last_way_);
+        if (level_result != nullptr)
+            ++level_result->lines;
         return;
     }
 
@@ -93,6 +97,8 @@ tlb_t::request(const memref_t &memref_in)
 
         if (tag + 1 <= final_tag)
             memref.data.size = ((tag + 1) << block_size_bits_) - memref.data.addr;
+        if (level_result != nullptr)
+            ++level_result->lines;
 
         for (way = 0; way < associativity_; ++way) {
             caching_device_block_t *tlb_entry = &get_caching_device_block(block_idx, way);
@@ -107,13 +113,18 @@ tlb_t::request(const memref_t &memref_in)
             caching_device_block_t *tlb_entry = &get_caching_device_block(block_idx, way);
 
             record_access_stats(memref, false /*miss*/, tlb_entry);
+            if (level_result != nullptr) {
+                ++level_result->misses;
+                if (tlb_entry->tag_ != TAG_INVALID)
+                    level_result->evicted_tag = tlb_entry->tag_;
+            }
             // If no parent we assume we get the data from main memory
             if (parent_ != NULL)
-                parent_->request(memref);
+                parent_->request(memref, result, level + 1);
 
             // XXX: do we need to handle TLB coherency?
 
-            tlb_entry->tag_ = tag;
+            update_tag(tlb_entry, way, tag);
             ((tlb_entry_t *)tlb_entry)->pid_ = pid;
         }
 
@@ -47,7 +47,8 @@ namespace drmemtrace {
 class tlb_t : public caching_device_t {
 public:
     void
-    request(const memref_t &memref) override;
+    request(const memref_t &memref, cache_result_t *result = nullptr,
+            int level = 0) override;
 
     // TODO i#4816: The addition of the pid as a lookup parameter beyond just the tag
     // needs to be imposed on the parent methods invalidate(), contains_tag(), and
@@ -64,6 +64,7 @@ tlb_simulator_t::tlb_simulator_t(const tlb_simulator_knobs_t &knobs)
                   knobs.use_physical, knobs.verbose)
     , knobs_(knobs)
 {
+    knob_speculate_instrs_ = knobs_.speculate_instrs;
     itlbs_ = new tlb_t *[knobs_.num_cores];
     dtlbs_ = new tlb_t *[knobs_.num_cores];
     lltlbs_ = new tlb_t *[knobs_.num_cores];
@@ -135,6 +136,9 @@ tlb_simulator_t::~tlb_simulator_t()
 bool
 tlb_simulator_t::process_memref(const memref_t &memref)
 {
+    // Wrong-path references count as references for skipping and warmup too.
+    if (!speculate(memref))
+        return false;
     if (knobs_.skip_refs > 0) {
         knobs_.skip_refs--;
         return true;
@@ -66,6 +66,7 @@ struct tlb_simulator_knobs_t {
         , warmup_refs(0)
         , warmup_fraction(0.0)
         , sim_refs(1ULL << 63)
+        , speculate_instrs(0)
         , cpu_scheduling(false)
         , use_physical(false)
         , verbose(0)
@@ -84,6 +85,7 @@ struct tlb_simulator_knobs_t {
     uint64_t warmup_refs;
     double warmup_fraction;
     uint64_t sim_refs;
+    uint64_t speculate_instrs;
     bool cpu_scheduling;
     bool use_physical;
     unsigned int verbose;
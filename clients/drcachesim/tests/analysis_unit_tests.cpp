@@ -36,12 +36,17 @@
 
 #include <atomic>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "analyzer.h"
 #include "mock_reader.h"
 #include "scheduler.h"
+#include "simulator/cache_simulator.h"
+#include "simulator/cache_simulator_create.h"
 #ifdef HAS_ZIP
 #    include "zipfile_istream.h"
 #    include "zipfile_ostream.h"
@@ -87,6 +92,50 @@ public:
     }
 };
 
+// An analyzer that splits a single mock input into groups of chunks the way
+// split_trace() splits a zipfile.
+class mock_split_analyzer_t : public analyzer_t {
+public:
+    mock_split_analyzer_t(const std::vector<trace_entry_t> &trace, uint64_t chunk_count,
+                          uint64_t chunk_instr_count, int split_chunks,
+                          analysis_tool_t **tools, int num_tools, int worker_count)
+        : analyzer_t()
+        , trace_(trace)
+    {
+        num_tools_ = num_tools;
+        tools_ = tools;
+        verbosity_ = 1;
+        worker_count_ = worker_count;
+        split_chunks_ = split_chunks;
+        std::vector<scheduler_t::input_workload_t> sched_inputs;
+        if (!add_split_workloads("", chunk_count, chunk_instr_count, sched_inputs) ||
+            scheduler_.init(sched_inputs, worker_count_,
+                            scheduler_t::make_scheduler_parallel_options(verbosity_)) !=
+                sched_type_t::STATUS_SUCCESS) {
+            assert(false);
+            success_ = false;
+        }
+        for (int i = 0; i < worker_count_; ++i) {
+            worker_data_.push_back(analyzer_worker_data_t(i, scheduler_.get_stream(i)));
+        }
+    }
+
+protected:
+    bool
+    create_split_reader(const std::string &path, uint64_t stop_instruction,
+                        std::unique_ptr<reader_t> &reader,
+                        std::unique_ptr<reader_t> &reader_end) override
+    {
+        reader = std::unique_ptr<reader_t>(new mock_reader_t(trace_));
+        reader_end = std::unique_ptr<reader_t>(new mock_reader_t());
+        reader->set_stop_instruction(stop_instruction);
+        return true;
+    }
+
+private:
+    std::vector<trace_entry_t> trace_;
+};
+
 bool
 test_queries()
 {
@@ -366,10 +415,230 @@ test_wait_records()
     return true;
 }
 
+bool
+test_split_chunks()
+{
+    std::cerr << "\n----------------\nTesting split chunks\n";
+    static constexpr memref_tid_t TID = 42;
+    static constexpr int NUM_CHUNKS = 5;
+    static constexpr int CHUNK_INSTRS = 3;
+    std::vector<trace_entry_t> trace = {
+        make_thread(TID),
+        make_pid(1),
+        make_version(TRACE_ENTRY_VERSION),
+        make_marker(TRACE_MARKER_TYPE_FILETYPE, 0),
+        make_marker(TRACE_MARKER_TYPE_CHUNK_INSTR_COUNT, CHUNK_INSTRS),
+        make_marker(TRACE_MARKER_TYPE_PAGE_SIZE, 4096),
+    };
+    for (int chunk = 0; chunk < NUM_CHUNKS; ++chunk) {
+        // Like raw2trace, start each chunk with a timestamp and cpu.
+        trace.push_back(make_timestamp(100 + chunk));
+        trace.push_back(make_marker(TRACE_MARKER_TYPE_CPU_ID, chunk % 2));
+        for (int i = 0; i < CHUNK_INSTRS; ++i) {
+            addr_t pc = 1000 + 4 * (chunk * CHUNK_INSTRS + i);
+            trace.push_back(make_instr(pc));
+            trace.push_back(make_memref(pc * 16));
+        }
+        // Put a marker between the last instruction of a chunk and the next chunk.
+        trace.push_back(make_marker(TRACE_MARKER_TYPE_FUNC_ID, chunk));
+    }
+    trace.push_back(make_exit(TID));
+
+    // Records a description of every entry and concatenates the pieces on merging.
+    class test_tool_t : public analysis_tool_t {
+    public:
+        bool
+        process_memref(const memref_t &memref) override
+        {
+            assert(false); // Only expect parallel mode.
+            return false;
+        }
+        bool
+        print_results() override
+        {
+            return true;
+        }
+        bool
+        parallel_shard_supported() override
+        {
+            return true;
+        }
+        bool
+        parallel_chunk_supported() override
+        {
+            return true;
+        }
+        void *
+        parallel_shard_init_stream(int shard_index, void *worker_data,
+                                   memtrace_stream_t *stream) override
+        {
+            return reinterpret_cast<void *>(new per_shard_t);
+        }
+        void *
+        parallel_chunk_init_stream(int shard_index, int chunk_index, void *worker_data,
+                                   memtrace_stream_t *stream) override
+        {
+            assert(shard_index == 0);
+            auto per_shard = new per_shard_t;
+            per_shard->chunk_index = chunk_index;
+            return reinterpret_cast<void *>(per_shard);
+        }
+        bool
+        parallel_shard_memref(void *shard_data, const memref_t &memref) override
+        {
+            per_shard_t *shard = reinterpret_cast<per_shard_t *>(shard_data);
+            if (type_is_instr(memref.instr.type))
+                shard->entries << "i" << memref.instr.addr << ",";
+            else if (memref.data.type == TRACE_TYPE_READ)
+                shard->entries << "r" << memref.data.addr << ",";
+            else if (memref.marker.type == TRACE_TYPE_MARKER) {
+                shard->entries << "m" << memref.marker.marker_type << ":"
+                               << memref.marker.marker_value << ",";
+            } else if (memref.exit.type == TRACE_TYPE_THREAD_EXIT)
+                shard->entries << "x" << memref.exit.tid << ",";
+            return true;
+        }
+        bool
+        parallel_chunk_merge(void *shard_data, void *chunk_data) override
+        {
+            per_shard_t *shard = reinterpret_cast<per_shard_t *>(shard_data);
+            per_shard_t *chunk = reinterpret_cast<per_shard_t *>(chunk_data);
+            // Pieces must be merged in order.
+            assert(chunk->chunk_index == shard->merged + 1);
+            ++shard->merged;
+            shard->entries << chunk->entries.str();
+            delete chunk;
+            return true;
+        }
+        bool
+        parallel_shard_exit(void *shard_data) override
+        {
+            per_shard_t *shard = reinterpret_cast<per_shard_t *>(shard_data);
+            ++exits;
+            merged = shard->merged;
+            entries = shard->entries.str();
+            delete shard;
+            return true;
+        }
+
+        int exits = 0;
+        int merged = 0;
+        std::string entries;
+
+    private:
+        struct per_shard_t {
+            int chunk_index = 0;
+            int merged = 0;
+            std::ostringstream entries;
+        };
+    };
+
+    // Get the unsplit entries.
+    std::string expected;
+    {
+        std::vector<scheduler_t::input_workload_t> sched_inputs;
+        std::vector<scheduler_t::input_reader_t> readers;
+        readers.emplace_back(std::unique_ptr<mock_reader_t>(new mock_reader_t(trace)),
+                             std::unique_ptr<mock_reader_t>(new mock_reader_t()), TID);
+        sched_inputs.emplace_back(std::move(readers));
+        test_tool_t tool;
+        std::vector<analysis_tool_t *> tools = { &tool };
+        mock_analyzer_t analyzer(sched_inputs, &tools[0], (int)tools.size(),
+                                 /*parallel=*/true, /*worker_count=*/1, nullptr);
+        assert(!!analyzer);
+        bool res = analyzer.run();
+        assert(res);
+        assert(tool.exits == 1 && tool.merged == 0);
+        expected = tool.entries;
+    }
+    std::cerr << "Unsplit: " << expected << "\n";
+    for (int split = 2; split <= NUM_CHUNKS + 1; ++split) {
+        for (int workers = 1; workers <= 3; ++workers) {
+            test_tool_t tool;
+            std::vector<analysis_tool_t *> tools = { &tool };
+            mock_split_analyzer_t analyzer(trace, NUM_CHUNKS, CHUNK_INSTRS, split,
+                                           &tools[0], (int)tools.size(), workers);
+            assert(!!analyzer);
+            bool res = analyzer.run();
+            assert(res);
+            // The split is capped at the chunk count.
+            assert(tool.exits == 1 && tool.merged == std::min(split, NUM_CHUNKS) - 1);
+            if (tool.entries != expected) {
+                std::cerr << "Split " << split << " x " << workers
+                          << " mismatch: " << tool.entries << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Runs the cache simulator over a trace with a taken branch whose fall-through
+// line is only fetched by the trace later on, and returns the L1I hits and misses.
+static void
+run_speculating_cache(uint64_t speculate_instrs, int64_t &hits, int64_t &misses)
+{
+    static constexpr memref_tid_t TID = 42;
+    std::vector<trace_entry_t> trace = {
+        make_thread(TID),
+        make_pid(1),
+        make_marker(TRACE_MARKER_TYPE_PAGE_SIZE, 4096),
+        make_instr(0x1000),
+        // A taken branch ending its line, mispredicted as not taken.
+        make_instr(0x103e, TRACE_TYPE_INSTR_TAKEN_JUMP, 2),
+        make_instr(0x8000),
+        // The fall-through line, which the wrong path has already fetched.
+        make_instr(0x1040),
+        make_exit(TID),
+    };
+    std::vector<scheduler_t::input_reader_t> readers;
+    readers.emplace_back(std::unique_ptr<mock_reader_t>(new mock_reader_t(trace)),
+                         std::unique_ptr<mock_reader_t>(new mock_reader_t()), TID);
+    std::vector<scheduler_t::input_workload_t> sched_inputs;
+    sched_inputs.emplace_back(std::move(readers));
+    scheduler_t::scheduler_options_t sched_ops(
+        scheduler_t::MAP_TO_ANY_OUTPUT, scheduler_t::DEPENDENCY_IGNORE,
+        scheduler_t::SCHEDULER_SPECULATE_NOPS, /*verbosity=*/1);
+    cache_simulator_knobs_t knobs;
+    knobs.num_cores = 1;
+    knobs.data_prefetcher = "none";
+    knobs.speculate_instrs = speculate_instrs;
+    std::unique_ptr<analysis_tool_t> sim(cache_simulator_create(knobs));
+    std::vector<analysis_tool_t *> tools = { sim.get() };
+    mock_analyzer_t analyzer(sched_inputs, &tools[0], (int)tools.size(),
+                             /*parallel=*/false, /*worker_count=*/1, &sched_ops);
+    assert(!!analyzer);
+    bool res = analyzer.run();
+    assert(res);
+    auto *cache_sim = dynamic_cast<cache_simulator_t *>(sim.get());
+    hits = cache_sim->get_cache_metric(metric_name_t::HITS, 1, 0,
+                                       cache_split_t::INSTRUCTION);
+    misses = cache_sim->get_cache_metric(metric_name_t::MISSES, 1, 0,
+                                         cache_split_t::INSTRUCTION);
+}
+
+bool
+test_speculation()
+{
+    std::cerr << "\n----------------\nTesting speculation\n";
+    static constexpr int SPECULATE_INSTRS = 4;
+    int64_t hits, misses;
+    run_speculating_cache(0, hits, misses);
+    // Only the branch shares a line with an earlier fetch.
+    assert(hits == 1 && misses == 3);
+    run_speculating_cache(SPECULATE_INSTRS, hits, misses);
+    // The 1-byte nops on the wrong path miss on the 0x1040 line once, so the
+    // trace's own fetch of that line hits.  The misses stay at 3 as the wrong
+    // path took the place of the trace's later miss.
+    assert(hits == 1 + (SPECULATE_INSTRS - 1) + 1 && misses == 3);
+    return true;
+}
+
 int
 test_main(int argc, const char *argv[])
 {
-    if (!test_queries() || !test_wait_records())
+    if (!test_queries() || !test_wait_records() || !test_split_chunks() ||
+        !test_speculation())
         return 1;
     std::cerr << "All done!\n";
     return 0;
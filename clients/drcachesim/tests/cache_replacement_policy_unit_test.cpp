@@ -36,7 +36,11 @@
 #include <assert.h>
 #include "cache_replacement_policy_unit_test.h"
 #include "simulator/cache_fifo.h"
+#include "simulator/cache_hawkeye.h"
 #include "simulator/cache_lru.h"
+#include "simulator/cache_opt.h"
+#include "simulator/cache_rrip.h"
+#include "simulator/cache_ship.h"
 
 namespace dynamorio {
 namespace drmemtrace {
@@ -69,7 +73,11 @@ template <class T> class cache_policy_test_t : public T {
     int total_size_;
 
 public:
-    cache_policy_test_t(int associativity, int line_size, int total_size)
+    // Any extra arguments are passed to the constructor of the policy.
+    template <typename... Args>
+    cache_policy_test_t(int associativity, int line_size, int total_size,
+                        Args... policy_args)
+        : T(policy_args...)
     {
         associativity_ = associativity;
         line_size_ = line_size;
@@ -88,15 +96,29 @@ public:
     }
 
     void
-    access_and_check(const addr_t addr, const int expected_replacement_way_after_access)
+    access_and_check(const addr_t addr, const int expected_replacement_way_after_access,
+                     const addr_t pc = 0)
     {
-        memref_t ref;
+        access(addr, pc);
+        assert(this->get_next_way_to_replace(this->get_block_index(addr)) ==
+               expected_replacement_way_after_access);
+    }
+
+    void
+    access(const addr_t addr, const addr_t pc = 0)
+    {
+        memref_t ref = {};
         ref.data.type = TRACE_TYPE_READ;
         ref.data.size = 1;
         ref.data.addr = addr;
+        ref.data.pc = pc;
         this->request(ref);
-        assert(this->get_next_way_to_replace(this->get_block_index(addr)) ==
-               expected_replacement_way_after_access);
+    }
+
+    int64_t
+    get_hits()
+    {
+        return this->get_stats()->get_metric(metric_name_t::HITS);
     }
 
     void
@@ -392,6 +414,209 @@ unit_test_cache_lfu_eight_way()
     cache_lfu_test.access_and_check(addr_vec[ADDR_I], 4); //     A  L  i  D  E  F  K  H
 }
 
+void
+unit_test_cache_srrip_four_way()
+{
+    cache_policy_test_t<cache_rrip_t> cache_srrip_test(/*associativity=*/4,
+                                                       /*line_size=*/32,
+                                                       /*total_size=*/256);
+    cache_srrip_test.initialize_cache();
+
+    assert(cache_srrip_test.get_replace_policy() == "SRRIP");
+    assert(cache_srrip_test.block_indices_are_identical(addr_vec));
+    assert(cache_srrip_test.tags_are_different(addr_vec));
+
+    // The digit after each way is its RRPV; misses insert with 2 and hits
+    // reset it to 0.  The set ages until some way reaches 3 before a victim
+    // is picked.  Lower-case letter shows the next victim.
+    cache_srrip_test.access_and_check(addr_vec[ADDR_A], 1); //     A2 x3 X3 X3
+    cache_srrip_test.access_and_check(addr_vec[ADDR_B], 2); //     A2 B2 x3 X3
+    cache_srrip_test.access_and_check(addr_vec[ADDR_C], 3); //     A2 B2 C2 x3
+    cache_srrip_test.access_and_check(addr_vec[ADDR_D], 0); //     a2 B2 C2 D2
+    cache_srrip_test.access_and_check(addr_vec[ADDR_A], 1); //     A0 b2 C2 D2
+    cache_srrip_test.access_and_check(addr_vec[ADDR_E], 2); //     A1 E2 c3 D3
+    cache_srrip_test.access_and_check(addr_vec[ADDR_C], 3); //     A1 E2 C0 d3
+    cache_srrip_test.access_and_check(addr_vec[ADDR_F], 1); //     A1 e2 C0 F2
+    cache_srrip_test.access_and_check(addr_vec[ADDR_G], 3); //     A2 G2 C1 f3
+
+    cache_srrip_test.invalidate_and_check(addr_vec[ADDR_F], 3); // A2 G2 C1 x3
+
+    cache_srrip_test.access_and_check(addr_vec[ADDR_A], 3); //     A0 G2 C1 x3
+    cache_srrip_test.access_and_check(addr_vec[ADDR_H], 1); //     A0 g2 C1 H2
+}
+
+void
+unit_test_cache_brrip_four_way()
+{
+    cache_policy_test_t<cache_rrip_t> cache_brrip_test(
+        /*associativity=*/4,
+        /*line_size=*/32,
+        /*total_size=*/256, "cache_brrip", rrip_insertion_t::BIMODAL);
+    cache_brrip_test.initialize_cache();
+
+    assert(cache_brrip_test.get_replace_policy() == "BRRIP");
+
+    // Misses insert with the distant RRPV 3, so a line that is not reused is
+    // the next victim and a new working set cannot flush the old one.
+    cache_brrip_test.access_and_check(addr_vec[ADDR_A], 1); //     A3 x3 X3 X3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_B], 2); //     A3 B3 x3 X3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_C], 3); //     A3 B3 C3 x3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_D], 0); //     a3 B3 C3 D3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_A], 1); //     A0 b3 C3 D3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_E], 1); //     A0 e3 C3 D3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_F], 1); //     A0 f3 C3 D3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_C], 1); //     A0 f3 C0 D3
+    cache_brrip_test.access_and_check(addr_vec[ADDR_G], 1); //     A0 g3 C0 D3
+}
+
+// Returns the hits of a cache with 128 sets of 4 ways on a cyclic access
+// pattern over 6 lines per set, which thrashes LRU-like policies.
+template <class T, typename... Args>
+static int64_t
+hits_on_thrashing_loop(Args... policy_args)
+{
+    constexpr int LINE_SIZE = 32;
+    constexpr int NUM_SETS = 128;
+    cache_policy_test_t<T> cache_test(/*associativity=*/4, LINE_SIZE,
+                                      /*total_size=*/4 * LINE_SIZE * NUM_SETS,
+                                      policy_args...);
+    cache_test.initialize_cache();
+    for (int iter = 0; iter < 64; ++iter) {
+        for (addr_t line = 0; line < 6 * NUM_SETS; ++line)
+            cache_test.access(line * LINE_SIZE);
+    }
+    return cache_test.get_hits();
+}
+
+void
+unit_test_cache_drrip()
+{
+    int64_t srrip_hits = hits_on_thrashing_loop<cache_rrip_t>();
+    int64_t brrip_hits =
+        hits_on_thrashing_loop<cache_rrip_t>("cache_brrip", rrip_insertion_t::BIMODAL);
+    int64_t drrip_hits =
+        hits_on_thrashing_loop<cache_rrip_t>("cache_drrip", rrip_insertion_t::DYNAMIC);
+    std::cerr << "Thrashing loop hits: SRRIP " << srrip_hits << ", BRRIP " << brrip_hits
+              << ", DRRIP " << drrip_hits << "\n";
+    assert(brrip_hits > srrip_hits);
+    // The follower sets should have picked bimodal insertion.
+    assert(drrip_hits > srrip_hits);
+    assert(drrip_hits > brrip_hits / 2);
+}
+
+// Returns the hits of a single-set cache of 4 ways where a loop touching 3
+// lines twice from one PC is interleaved with scans of 4 lines that are
+// never reused, from another PC.
+template <class T> static int64_t
+hits_on_scanned_loop(int iters)
+{
+    constexpr int LINE_SIZE = 32;
+    constexpr addr_t LOOP_PC = 0x1000;
+    constexpr addr_t SCAN_PC = 0x2008;
+    cache_policy_test_t<T> cache_test(/*associativity=*/4, LINE_SIZE,
+                                      /*total_size=*/4 * LINE_SIZE);
+    cache_test.initialize_cache();
+    addr_t scan_line = 16;
+    for (int iter = 0; iter < iters; ++iter) {
+        for (addr_t line = 0; line < 6; ++line)
+            cache_test.access(line % 3 * LINE_SIZE, LOOP_PC);
+        for (int i = 0; i < 4; ++i)
+            cache_test.access(scan_line++ * LINE_SIZE, SCAN_PC);
+    }
+    return cache_test.get_hits();
+}
+
+void
+unit_test_cache_ship()
+{
+    constexpr int ITERS = 100;
+    int64_t srrip_hits = hits_on_scanned_loop<cache_rrip_t>(ITERS);
+    int64_t ship_hits = hits_on_scanned_loop<cache_ship_t>(ITERS);
+    std::cerr << "Scanned loop hits: SRRIP " << srrip_hits << ", SHiP " << ship_hits
+              << "\n";
+    // Once the scanning PC is found not to reuse its lines they are inserted
+    // as the next victims, and the loop stays resident.
+    assert(ship_hits > srrip_hits);
+    assert(ship_hits >= 6 * (ITERS - 2));
+}
+
+void
+unit_test_cache_hawkeye()
+{
+    constexpr int ITERS = 100;
+    int64_t srrip_hits = hits_on_scanned_loop<cache_rrip_t>(ITERS);
+    int64_t hawkeye_hits = hits_on_scanned_loop<cache_hawkeye_t>(ITERS);
+    std::cerr << "Scanned loop hits: SRRIP " << srrip_hits << ", Hawkeye "
+              << hawkeye_hits << "\n";
+    // OPTgen finds that the loop fits while the scans never hit, and the
+    // predictor learns to insert the scanned lines as cache-averse.
+    assert(hawkeye_hits > srrip_hits);
+    assert(hawkeye_hits >= 6 * (ITERS - 4));
+}
+
+// Answers next-use queries from a recorded address sequence.
+class vector_oracle_t : public cache_opt_oracle_t {
+public:
+    vector_oracle_t(const std::vector<addr_t> &addrs, int line_size)
+        : addrs_(addrs)
+        , line_size_(line_size)
+    {
+    }
+    uint64_t
+    next_use(addr_t tag) override
+    {
+        for (size_t i = pos_ + 1; i < addrs_.size(); ++i) {
+            if (addrs_[i] / line_size_ == tag)
+                return i;
+        }
+        return NEXT_USE_NEVER;
+    }
+    size_t pos_ = 0;
+
+private:
+    std::vector<addr_t> addrs_;
+    int line_size_;
+};
+
+void
+unit_test_cache_opt_four_way()
+{
+    cache_policy_test_t<cache_opt_t> cache_opt_test(/*associativity=*/4,
+                                                    /*line_size=*/32,
+                                                    /*total_size=*/256);
+    cache_opt_test.initialize_cache();
+
+    assert(cache_opt_test.get_replace_policy() == "OPT");
+
+    const std::vector<addr_t> sequence = {
+        addr_vec[ADDR_A], addr_vec[ADDR_B], addr_vec[ADDR_C], addr_vec[ADDR_D],
+        addr_vec[ADDR_E], addr_vec[ADDR_A], addr_vec[ADDR_B], addr_vec[ADDR_C],
+        addr_vec[ADDR_D], addr_vec[ADDR_E],
+    };
+    // The next victim is the line whose next use, shown as the position in
+    // the sequence after each way ('-' for never), is furthest away.
+    const std::vector<int> expected_next_victim = {
+        1, //     A5 x  X  X
+        2, //     A5 B6 x  X
+        3, //     A5 B6 C7 x
+        3, //     A5 B6 C7 d8
+        3, //     A5 B6 C7 e9
+        0, //     a- B6 C7 E9
+        0, //     a- B- C7 E9
+        0, //     a- B- C- E9
+        0, //     d- B- C- E9
+        0, //     d- B- C- E-
+    };
+    vector_oracle_t oracle(sequence, /*line_size=*/32);
+    cache_opt_test.set_oracle(&oracle);
+    for (size_t i = 0; i < sequence.size(); ++i) {
+        oracle.pos_ = i;
+        cache_opt_test.access_and_check(sequence[i], expected_next_victim[i]);
+    }
+    // LRU would have missed on all 10 references.
+    assert(cache_opt_test.get_hits() == 4);
+}
+
 void
 unit_test_cache_replacement_policy()
 {
@@ -401,6 +626,12 @@ unit_test_cache_replacement_policy()
     unit_test_cache_fifo_eight_way();
     unit_test_cache_lfu_four_way();
     unit_test_cache_lfu_eight_way();
+    unit_test_cache_srrip_four_way();
+    unit_test_cache_brrip_four_way();
+    unit_test_cache_drrip();
+    unit_test_cache_ship();
+    unit_test_cache_hawkeye();
+    unit_test_cache_opt_four_way();
     // XXX i#4842: Add more test sequences.
 }
 
@@ -0,0 +1,193 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, LLC  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL GOOGLE, LLC OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/*
+ * Microbenchmark comparing the per-row cost of buffering missing_instructions rows
+ * as heap-allocated row objects (the layout used before #cachesim_row_ring_t) with
+ * filling the preallocated struct-of-arrays ring, plus the throughput of the
+ * columnar sink.  Takes an optional row count as its only argument.
+ */
+
+#include <stdint.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../tools/cachesim_row_sink.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+namespace {
+
+constexpr size_t BUFFER_ROWS = 100000;
+constexpr size_t DEFAULT_ROWS = 20000000;
+constexpr int UNIQUE_DISASM = 4096;
+
+// A copy of the fields and allocation pattern of the removed per-row class.
+class legacy_row_t {
+public:
+    virtual ~legacy_row_t() = default;
+    uint64_t access_address = 0;
+    uint64_t pc_address = 0;
+    int access_address_delta = 0;
+    int pc_address_delta = 0;
+    bool l1d_miss = false;
+    bool l1i_miss = false;
+    bool ll_miss = false;
+    uint8_t instr_type = 0;
+    uint8_t byte_count = 0;
+    std::string disassembly_string;
+    int current_instruction_id = 0;
+    uint8_t core = 0;
+    bool thread_switch = false;
+    bool core_switch = false;
+};
+
+std::vector<std::string>
+make_disassembly()
+{
+    std::vector<std::string> disasm;
+    disasm.reserve(UNIQUE_DISASM);
+    for (int i = 0; i < UNIQUE_DISASM; ++i) {
+        disasm.push_back("48 8b 85 " + std::to_string(i) +
+                         "                        mov    0x" + std::to_string(i * 8) +
+                         "(%rbp)[8byte] -> %rax");
+    }
+    return disasm;
+}
+
+double
+seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+void
+report(const char *name, size_t rows, double secs)
+{
+    std::cerr << name << ": " << rows << " rows in " << secs << "s = "
+              << static_cast<double>(rows) / secs / 1e6 << "M rows/s\n";
+}
+
+// Returns a checksum so the work cannot be optimized away.
+size_t
+bench_legacy(size_t num_rows, const std::vector<std::string> &disasm)
+{
+    std::vector<std::unique_ptr<legacy_row_t>> buffer;
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_rows; ++i) {
+        std::unique_ptr<legacy_row_t> row(new legacy_row_t);
+        row->current_instruction_id = static_cast<int>(i);
+        row->core = static_cast<uint8_t>(i % 8);
+        row->l1d_miss = i % 3 == 0;
+        row->pc_address = 0x400000 + i * 4;
+        row->pc_address_delta = 4;
+        row->access_address_delta = static_cast<int>(i % 64) - 32;
+        row->instr_type = 1;
+        row->byte_count = 8;
+        row->disassembly_string = disasm[i % UNIQUE_DISASM];
+        buffer.push_back(std::move(row));
+        if (buffer.size() >= BUFFER_ROWS) {
+            checksum += buffer.back()->disassembly_string.size();
+            buffer.clear();
+        }
+    }
+    report("legacy row objects", num_rows, seconds_since(start));
+    return checksum + buffer.size();
+}
+
+size_t
+bench_ring(size_t num_rows, const std::vector<std::string> &disasm,
+           cachesim_row_sink_t *sink)
+{
+    cachesim_row_ring_t ring(BUFFER_ROWS, /*expanded=*/false);
+    cachesim_string_table_t strings;
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_rows; ++i) {
+        size_t slot = ring.size();
+        ring.instr_id[slot] = static_cast<int32_t>(i);
+        ring.core[slot] = static_cast<uint8_t>(i % 8);
+        ring.bits[slot] = i % 3 == 0 ? CACHESIM_BIT_L1D_MISS : 0;
+        ring.pc_delta[slot] = 4;
+        ring.access_delta[slot] = static_cast<int32_t>(i % 64) - 32;
+        ring.instr_type[slot] = 1;
+        ring.byte_count[slot] = 8;
+        ring.disasm_id[slot] = strings.intern(disasm[i % UNIQUE_DISASM]);
+        ring.commit();
+        if (ring.full()) {
+            checksum += ring.disasm_id[slot];
+            if (sink != nullptr)
+                sink->write_rows(ring, strings);
+            ring.clear();
+        }
+    }
+    if (sink != nullptr) {
+        sink->write_rows(ring, strings);
+        sink->close();
+    }
+    report(sink == nullptr ? "struct-of-arrays ring" : "ring + columnar sink", num_rows,
+           seconds_since(start));
+    return checksum + ring.size();
+}
+
+} // namespace
+
+int
+test_main(int argc, const char *argv[])
+{
+    size_t num_rows = DEFAULT_ROWS;
+    if (argc > 1)
+        num_rows = strtoull(argv[1], nullptr, 10);
+    std::vector<std::string> disasm = make_disassembly();
+    size_t checksum = bench_legacy(num_rows, disasm);
+    checksum += bench_ring(num_rows, disasm, nullptr);
+    const std::string fname = "tmp_cachesim_row_bench.rows";
+    {
+        cachesim_columnar_sink_t sink(fname, /*expanded=*/false);
+        checksum += bench_ring(num_rows, disasm, &sink);
+    }
+    std::remove(fname.c_str());
+    std::cerr << "checksum " << checksum << "\n";
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,201 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, LLC  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL GOOGLE, LLC OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Round-trip tests for the missing_instructions row output backends. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "../tools/cachesim_row_sink.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+#define CHECK(cond, msg)                  \
+    do {                                  \
+        if (!(cond)) {                    \
+            fprintf(stderr, "%s\n", msg); \
+            return false;                 \
+        }                                 \
+    } while (0)
+
+static void
+fill_rows(cachesim_row_ring_t &rows, cachesim_string_table_t &strings, int first_id,
+          int count)
+{
+    rows.clear();
+    for (int i = 0; i < count; ++i) {
+        int id = first_id + i;
+        size_t slot = rows.size();
+        rows.instr_id[slot] = id;
+        rows.core[slot] = static_cast<uint8_t>(id % 4);
+        rows.bits[slot] = static_cast<uint8_t>(
+            (i % 3 == 0 ? CACHESIM_BIT_L1D_MISS : 0) |
+            (i % 5 == 0 ? CACHESIM_BIT_L1I_MISS : 0) |
+            (i % 7 == 0 ? CACHESIM_BIT_LL_MISS : 0) |
+            (id % 10 == 0 ? CACHESIM_BIT_THREAD_SWITCH : 0) |
+            (id % 20 == 0 ? CACHESIM_BIT_CORE_SWITCH : 0));
+        rows.pc_delta[slot] = i % 2 == 0 ? 4 : -12;
+        rows.access_delta[slot] = i * 8 - 100;
+        rows.instr_type[slot] = i % 2 == 0 ? CACHESIM_INSTR_TYPE_INSTR : 2;
+        rows.byte_count[slot] = static_cast<uint8_t>(i % 8 + 1);
+        rows.disasm_id[slot] = 0;
+        if (i % 2 == 0) {
+            rows.disasm_id[slot] = strings.intern(
+                i % 4 == 0 ? "48 89 e5  mov %rsp -> %rbp" : "c3  ret \"quoted\", %rsp");
+        }
+        if (rows.is_expanded()) {
+            rows.l1d_hits[slot] = id;
+            rows.l1d_misses[slot] = id % 7;
+            rows.l1i_hits[slot] = 2 * id;
+            rows.l1i_misses[slot] = id % 3;
+            rows.ll_hits[slot] = id % 5;
+            rows.ll_misses[slot] = id % 11;
+        }
+        // Leave every tenth slot uncommitted to test that it is overwritten.
+        if (i % 10 != 9)
+            rows.commit();
+    }
+}
+
+static bool
+rows_equal(const cachesim_row_ring_t &a, const cachesim_string_table_t &a_strings,
+           size_t a_idx, const cachesim_row_ring_t &b,
+           const cachesim_string_table_t &b_strings, size_t b_idx)
+{
+    if (a.instr_id[a_idx] != b.instr_id[b_idx] || a.core[a_idx] != b.core[b_idx] ||
+        a.bits[a_idx] != b.bits[b_idx] || a.pc_delta[a_idx] != b.pc_delta[b_idx] ||
+        a.access_delta[a_idx] != b.access_delta[b_idx] ||
+        a.instr_type[a_idx] != b.instr_type[b_idx] ||
+        a.byte_count[a_idx] != b.byte_count[b_idx] ||
+        a_strings.get(a.disasm_id[a_idx]) != b_strings.get(b.disasm_id[b_idx]))
+        return false;
+    if (!a.is_expanded())
+        return true;
+    return a.l1d_hits[a_idx] == b.l1d_hits[b_idx] &&
+        a.l1d_misses[a_idx] == b.l1d_misses[b_idx] &&
+        a.l1i_hits[a_idx] == b.l1i_hits[b_idx] &&
+        a.l1i_misses[a_idx] == b.l1i_misses[b_idx] &&
+        a.ll_hits[a_idx] == b.ll_hits[b_idx] && a.ll_misses[a_idx] == b.ll_misses[b_idx];
+}
+
+static bool
+test_round_trip(bool expanded)
+{
+    std::cerr << "Testing columnar round trip, expanded=" << expanded << "\n";
+    const std::string rows_fname = "tmp_cachesim_rows.rows";
+    const std::string db_fname = "tmp_cachesim_rows.db";
+    const std::string csv_fname = "tmp_cachesim_rows.csv";
+    cachesim_string_table_t strings;
+    std::vector<std::unique_ptr<cachesim_row_ring_t>> blocks;
+    blocks.emplace_back(new cachesim_row_ring_t(1000, expanded));
+    fill_rows(*blocks.back(), strings, 1, 1000);
+    blocks.emplace_back(new cachesim_row_ring_t(1000, expanded));
+    fill_rows(*blocks.back(), strings, 1001, 17);
+    size_t total_rows = 0;
+    int64_t expect_misses = 0, expect_disasm = 0;
+    {
+        cachesim_columnar_sink_t sink(rows_fname, expanded);
+        for (const auto &block : blocks) {
+            sink.write_rows(*block, strings);
+            total_rows += block->size();
+            for (size_t i = 0; i < block->size(); ++i) {
+                expect_misses += (block->bits[i] & CACHESIM_BIT_L1D_MISS) != 0;
+                expect_disasm += strings.get(block->disasm_id[i]).size();
+            }
+        }
+        sink.close();
+    }
+    CHECK(total_rows == 900 + 16, "Uncommitted slots were counted");
+
+    cachesim_columnar_reader_t reader(rows_fname);
+    CHECK(reader.is_expanded() == expanded, "Expanded flag mismatch");
+    for (const auto &block : blocks) {
+        const cachesim_row_ring_t *rows = reader.read_block();
+        CHECK(rows != nullptr, "Missing block");
+        CHECK(rows->size() == block->size(), "Block size mismatch");
+        for (size_t i = 0; i < rows->size(); ++i) {
+            CHECK(rows_equal(*rows, reader.get_strings(), i, *block, strings, i),
+                  "Row mismatch");
+        }
+    }
+    CHECK(reader.read_block() == nullptr, "Unexpected extra block");
+
+    std::remove(db_fname.c_str());
+    cachesim_columnar_to_sqlite(rows_fname, db_fname);
+    sqlite3 *db;
+    CHECK(sqlite3_open(db_fname.c_str(), &db) == SQLITE_OK, "Failed to open db");
+    sqlite3_stmt *stmt;
+    CHECK(sqlite3_prepare_v2(db,
+                             "SELECT COUNT(*), SUM(l1d_miss), "
+                             "SUM(LENGTH(disassembly_string)) FROM cache_stats;",
+                             -1, &stmt, nullptr) == SQLITE_OK,
+          "Failed to prepare query");
+    CHECK(sqlite3_step(stmt) == SQLITE_ROW, "Failed to query db");
+    bool db_ok = sqlite3_column_int64(stmt, 0) == static_cast<int64_t>(total_rows) &&
+        sqlite3_column_int64(stmt, 1) == expect_misses &&
+        sqlite3_column_int64(stmt, 2) == expect_disasm;
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    CHECK(db_ok, "SQLite conversion mismatch");
+
+    cachesim_columnar_to_csv(rows_fname, csv_fname);
+    std::ifstream csv(csv_fname);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(csv, line))
+        ++lines;
+    // One header line plus one line per row.
+    CHECK(lines == total_rows + 1, "CSV line count mismatch");
+    return true;
+}
+
+int
+test_main(int argc, const char *argv[])
+{
+    if (test_round_trip(/*expanded=*/false) && test_round_trip(/*expanded=*/true)) {
+        std::cerr << "cachesim_row_sink_test passed\n";
+        return 0;
+    }
+    std::cerr << "cachesim_row_sink_test FAILED\n";
+    exit(1);
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,307 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Unit tests for the trace chunk index. */
+
+#include "archive_ostream.h"
+#include "columnar_file_reader.h"
+#include "columnar_ostream.h"
+#include "compressed_file_reader.h"
+#include "gzip_ostream.h"
+#include "mock_reader.h"
+#include "trace_index.h"
+#ifdef HAS_ZIP
+#    include "zipfile_file_reader.h"
+#    include "zipfile_ostream.h"
+#endif
+#ifdef HAS_LZ4
+#    include "lz4_file_reader.h"
+#    include "lz4_ostream.h"
+#endif
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace dynamorio {
+namespace drmemtrace {
+namespace {
+
+#define CHECK(cond, msg, ...)             \
+    do {                                  \
+        if (!(cond)) {                    \
+            fprintf(stderr, "%s\n", msg); \
+            return false;                 \
+        }                                 \
+    } while (0)
+
+constexpr memref_tid_t TID = 7;
+constexpr memref_pid_t PID = 3;
+constexpr int NUM_CHUNKS = 8;
+constexpr int CHUNK_INSTRS = 500;
+// Timestamps deliberately do not line up with chunk boundaries.
+constexpr int TIMESTAMP_INTERVAL = 300;
+
+// Writes a single-thread trace of "num_chunks" chunks split the way raw2trace splits
+// them, adding each chunk to the index.
+bool
+write_trace(archive_ostream_t &out, int num_chunks = NUM_CHUNKS)
+{
+    auto write = [&out](const trace_entry_t &entry) {
+        out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    };
+    CHECK(out.open_new_component("chunk.0000").empty(), "failed to open chunk");
+    CHECK(out.index_component(0, 0).empty(), "failed to index chunk");
+    write(make_header(TRACE_ENTRY_VERSION));
+    write(make_thread(TID));
+    write(make_pid(PID));
+    write(make_version(TRACE_ENTRY_VERSION));
+    write(make_marker(TRACE_MARKER_TYPE_FILETYPE, OFFLINE_FILE_TYPE_DEFAULT));
+    write(make_marker(TRACE_MARKER_TYPE_CHUNK_INSTR_COUNT, CHUNK_INSTRS));
+    write(make_marker(TRACE_MARKER_TYPE_PAGE_SIZE, 4096));
+    // Each header marker above is a record.
+    uint64_t records = 4;
+    uint64_t timestamp = 0;
+    uint64_t cpu = 0;
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+        if (chunk > 0) {
+            write(make_marker(TRACE_MARKER_TYPE_CHUNK_FOOTER, chunk - 1));
+            ++records;
+            std::string name = "chunk.000" + std::to_string(chunk);
+            CHECK(out.open_new_component(name).empty(), "failed to open chunk");
+            CHECK(out.index_component(chunk * CHUNK_INSTRS, timestamp).empty(),
+                  "failed to index chunk");
+            write(make_marker(TRACE_MARKER_TYPE_RECORD_ORDINAL, records));
+            write(make_timestamp(timestamp));
+            write(make_marker(TRACE_MARKER_TYPE_CPU_ID, cpu));
+        }
+        for (int i = 0; i < CHUNK_INSTRS; ++i) {
+            int instr = chunk * CHUNK_INSTRS + i;
+            if (instr % TIMESTAMP_INTERVAL == 0) {
+                timestamp = 1000 + instr;
+                cpu = instr / TIMESTAMP_INTERVAL;
+                write(make_timestamp(timestamp));
+                write(make_marker(TRACE_MARKER_TYPE_CPU_ID, cpu));
+                records += 2;
+            }
+            write(make_instr(0x1000 + instr * 4));
+            write(make_memref(0x100000 + instr * 8));
+            records += 2;
+        }
+    }
+    write(make_exit(TID));
+    write(make_footer());
+    CHECK(!out.fail(), "failed to write trace");
+    CHECK(out.close().empty(), "failed to close trace");
+    return true;
+}
+
+// Reads the rest of "iter" into "records" as (type, address, instruction ordinal,
+// record ordinal).
+template <typename reader_type>
+void
+read_records(reader_t &iter,
+             std::vector<std::tuple<int, addr_t, uint64_t, uint64_t>> &records)
+{
+    reader_type iter_end;
+    for (; iter != iter_end; ++iter) {
+        const memref_t &memref = *iter;
+        records.emplace_back(memref.data.type, memref.data.addr,
+                             iter.get_instruction_ordinal(), iter.get_record_ordinal());
+    }
+}
+
+template <typename reader_type>
+std::unique_ptr<reader_t>
+open_trace(const std::string &path, int read_ahead_blocks)
+{
+    std::unique_ptr<reader_t> iter(new reader_type(path));
+    iter->set_read_ahead(read_ahead_blocks);
+    if (!iter->init())
+        return nullptr;
+    return iter;
+}
+
+// Checks that an index left behind by a different trace at the same path is
+// ignored, by writing a shorter trace without an index over "path".
+template <typename ostream_type, typename reader_type>
+bool
+test_stale_index(const std::string &path)
+{
+    {
+        ostream_type out(path);
+        if (!write_trace(out, NUM_CHUNKS / 2))
+            return false;
+    }
+    CHECK(!trace_index_t().read(path).empty(), "read a stale index");
+    std::unique_ptr<reader_t> iter = open_trace<reader_type>(path, 0);
+    CHECK(iter != nullptr, "failed to open trace");
+    CHECK(iter->get_chunk_count() == 0, "stale index was loaded");
+    const uint64_t skip = NUM_CHUNKS / 2 * CHUNK_INSTRS - 1;
+    iter->skip_instructions(skip);
+    reader_type iter_end;
+    while (*iter != iter_end && !type_is_instr((**iter).data.type))
+        ++*iter;
+    CHECK(*iter != iter_end && iter->get_instruction_ordinal() == skip + 1 &&
+              (**iter).instr.addr == static_cast<addr_t>(0x1000 + skip * 4),
+          "skip with a stale index landed on the wrong instruction");
+    return true;
+}
+
+// Compares skipping with the index against skipping without it, both from the
+// start and from the middle of the trace, with and without read-ahead.
+template <typename ostream_type, typename reader_type>
+bool
+test_format(const std::string &suffix)
+{
+    std::cerr << "Testing " << suffix << "\n";
+    const std::string indexed = "tmp_chunk_index" + suffix;
+    const std::string plain = "tmp_chunk_index_plain" + suffix;
+    for (const std::string &path : { indexed, plain }) {
+        ostream_type out(path, /*write_index=*/path == indexed);
+        if (!write_trace(out))
+            return false;
+    }
+    trace_index_t index;
+    CHECK(!index.read(plain).empty(), "index written without being requested");
+    CHECK(index.read(indexed).empty(), "failed to read index");
+    CHECK(index.get_entries().size() == NUM_CHUNKS, "wrong index size");
+    for (int read_ahead : { 0, 2 }) {
+        for (uint64_t skip : { 1, 499, 500, 501, 1234, 3500, 3999, 4100 }) {
+            for (uint64_t start : { 0, 700 }) {
+                std::vector<std::tuple<int, addr_t, uint64_t, uint64_t>> expect, actual;
+                std::unique_ptr<reader_t> iters[2] = {
+                    open_trace<reader_type>(plain, read_ahead),
+                    open_trace<reader_type>(indexed, read_ahead)
+                };
+                for (auto &iter : iters) {
+                    CHECK(iter != nullptr, "failed to open trace");
+                    reader_type iter_end;
+                    while (*iter != iter_end && iter->get_instruction_ordinal() < start)
+                        ++*iter;
+                }
+                CHECK(iters[0]->get_chunk_count() == 0, "unexpected index");
+                CHECK(iters[1]->get_chunk_count() == NUM_CHUNKS, "index not loaded");
+                iters[0]->skip_instructions(skip);
+                iters[1]->skip_instructions(skip);
+                read_records<reader_type>(*iters[0], expect);
+                read_records<reader_type>(*iters[1], actual);
+                if (start == 0 && skip < NUM_CHUNKS * CHUNK_INSTRS) {
+                    // The timestamp and cpu inserted ahead of the target come first.
+                    CHECK(!expect.empty() && std::get<2>(expect[0]) == skip,
+                          "skip landed on the wrong instruction");
+                }
+                // The timestamp and cpu inserted ahead of the target count as
+                // synthetic only if no real timestamp was walked over, which
+                // depends on where the walk started.
+                for (auto *records : { &expect, &actual }) {
+                    for (size_t i = 0; i < 2 && i < records->size(); ++i)
+                        std::get<3>((*records)[i]) = 0;
+                }
+                CHECK(expect == actual, "indexed skip differs from linear skip");
+            }
+        }
+    }
+    if (!test_stale_index<ostream_type, reader_type>(indexed))
+        return false;
+    remove(indexed.c_str());
+    remove(trace_index_t::get_path(indexed).c_str());
+    remove(plain.c_str());
+    return true;
+}
+
+bool
+test_index_lookup()
+{
+    trace_index_t index;
+    CHECK(index.find_instruction(0) == nullptr, "empty index found an entry");
+    CHECK(index.add_entry({ 0, 0, 0 }).empty(), "failed to add entry");
+    CHECK(index.add_entry({ 100, 50, 10 }).empty(), "failed to add entry");
+    CHECK(index.add_entry({ 200, 60, 20 }).empty(), "failed to add entry");
+    CHECK(!index.add_entry({ 150, 70, 30 }).empty(), "accepted out-of-order entry");
+    CHECK(index.find_instruction(99)->offset == 0, "wrong chunk for 99");
+    CHECK(index.find_instruction(100)->offset == 10, "wrong chunk for 100");
+    CHECK(index.find_instruction(1000)->offset == 20, "wrong chunk for 1000");
+    CHECK(index.find_timestamp(55)->offset == 10, "wrong chunk for timestamp 55");
+    const std::string path = "tmp_chunk_index_lookup";
+    CHECK(!index.write(path).empty(), "indexed a missing trace file");
+    {
+        std::ofstream trace(path, std::ofstream::binary);
+        trace << "trace";
+    }
+    CHECK(index.write(path).empty(), "failed to write index");
+    trace_index_t copy;
+    CHECK(copy.read(path).empty(), "failed to read index");
+    CHECK(copy.get_entries().size() == 3 && copy.find_instruction(150)->offset == 10,
+          "index did not round-trip");
+    {
+        std::ofstream trace(path, std::ofstream::binary | std::ofstream::app);
+        trace << "more";
+    }
+    CHECK(!copy.read(path).empty(), "read a stale index");
+    CHECK(copy.get_entries().empty(), "kept stale index entries");
+    remove(trace_index_t::get_path(path).c_str());
+    CHECK(!copy.read(path).empty(), "read a missing index");
+    remove(path.c_str());
+    return true;
+}
+
+} // namespace
+
+int
+test_main(int argc, const char *argv[])
+{
+    if (!test_index_lookup())
+        return 1;
+    if (!test_format<gzip_ostream_t, compressed_file_reader_t>(".trace.gz"))
+        return 1;
+    if (!test_format<columnar_ostream_t, columnar_file_reader_t>(".trace.col"))
+        return 1;
+#ifdef HAS_ZIP
+    if (!test_format<zipfile_ostream_t, zipfile_file_reader_t>(".trace.zip"))
+        return 1;
+#endif
+#ifdef HAS_LZ4
+    if (!test_format<lz4_ostream_t, lz4_file_reader_t>(".trace.lz4"))
+        return 1;
+#endif
+    std::cerr << "All done!\n";
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,238 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Unit tests for the columnar trace format. */
+
+#include "columnar_codec.h"
+#include "columnar_istream.h"
+#include "columnar_ostream.h"
+#include "gzip_ostream.h"
+#include "mock_reader.h"
+#include "trace_entry.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace dynamorio {
+namespace drmemtrace {
+namespace {
+
+#define CHECK(cond, msg, ...)             \
+    do {                                  \
+        if (!(cond)) {                    \
+            fprintf(stderr, "%s\n", msg); \
+            return false;                 \
+        }                                 \
+    } while (0)
+
+// A loop nest over three arrays, like a matrix multiply, with a few irregular
+// records mixed in.
+std::vector<trace_entry_t>
+make_trace(int num_iters, bool irregular)
+{
+    std::vector<trace_entry_t> trace;
+    trace.push_back(make_header(TRACE_ENTRY_VERSION));
+    trace.push_back(make_thread(7));
+    trace.push_back(make_pid(3));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_FILETYPE, OFFLINE_FILE_TYPE_DEFAULT));
+    uint64_t rand = 12345;
+    for (int i = 0; i < num_iters; ++i) {
+        const addr_t loop = 0x401000;
+        trace.push_back(make_instr(loop, TRACE_TYPE_INSTR, 4));
+        trace.push_back(make_memref(0x10000000 + i * 8, TRACE_TYPE_READ, 8));
+        trace.push_back(make_memref(0x20000000 + (i % 64) * 512, TRACE_TYPE_READ, 8));
+        trace.push_back(make_instr(loop + 4, TRACE_TYPE_INSTR, 3));
+        trace.push_back(make_memref(0x30000000 + i * 8, TRACE_TYPE_WRITE, 8));
+        trace.push_back(make_instr(loop + 7, TRACE_TYPE_INSTR_CONDITIONAL_JUMP, 2));
+        if (irregular && i % 97 == 0) {
+            rand = rand * 6364136223846793005ULL + 1442695040888963407ULL;
+            trace.push_back(make_marker(TRACE_MARKER_TYPE_TIMESTAMP, rand));
+            trace_entry_t encoding = {};
+            encoding.type = TRACE_TYPE_ENCODING;
+            encoding.size = sizeof(encoding.encoding);
+            memcpy(encoding.encoding, &rand, sizeof(encoding.encoding));
+            trace.push_back(encoding);
+            trace.push_back(make_instr(static_cast<addr_t>(rand), TRACE_TYPE_INSTR, 15));
+            trace.push_back(make_memref(static_cast<addr_t>(~rand), TRACE_TYPE_READ, 1));
+            trace.push_back(make_memref(~static_cast<addr_t>(0), TRACE_TYPE_WRITE, 2));
+            trace.push_back(make_instr(0, TRACE_TYPE_INSTR_NO_FETCH, 0));
+        }
+    }
+    trace.push_back(make_exit(7));
+    trace.push_back(make_footer());
+    return trace;
+}
+
+bool
+write_columnar(const std::string &path, const std::vector<trace_entry_t> &trace,
+               size_t split)
+{
+    columnar_ostream_t out(path, /*write_index=*/true);
+    CHECK(out, "failed to open columnar file");
+    CHECK(out.open_new_component("").empty(), "failed to open component");
+    out.write(reinterpret_cast<const char *>(trace.data()), split * sizeof(trace[0]));
+    // Index the second component so we can find its offset.
+    CHECK(out.open_new_component("").empty(), "failed to open component");
+    CHECK(out.index_component(1, 1).empty(), "failed to index component");
+    out.write(reinterpret_cast<const char *>(trace.data() + split),
+              (trace.size() - split) * sizeof(trace[0]));
+    CHECK(!out.fail(), "failed to write trace");
+    CHECK(out.close().empty(), "failed to close columnar file");
+    return true;
+}
+
+// Reads the rest of "in" into "trace".
+void
+read_columnar(columnar_istream_t &in, std::vector<trace_entry_t> &trace)
+{
+    trace_entry_t entry;
+    while (in.read(reinterpret_cast<char *>(&entry), sizeof(entry)))
+        trace.push_back(entry);
+}
+
+bool
+test_round_trip()
+{
+    std::cerr << "Testing round trip\n";
+    const std::string path = "tmp_columnar_round_trip.trace.col";
+    // Enough records to span multiple blocks.
+    std::vector<trace_entry_t> trace = make_trace(COLUMNAR_BLOCK_ENTRIES / 4, true);
+    const size_t split = trace.size() / 3;
+    if (!write_columnar(path, trace, split))
+        return false;
+    trace_index_t index;
+    CHECK(index.read(path).empty(), "failed to read index");
+    CHECK(index.get_entries().size() == 1, "wrong index size");
+
+    std::vector<trace_entry_t> actual;
+    {
+        columnar_istream_t in(path);
+        CHECK(in, "failed to open columnar file");
+        read_columnar(in, actual);
+    }
+    CHECK(actual.size() == trace.size(), "wrong record count");
+    CHECK(memcmp(actual.data(), trace.data(), trace.size() * sizeof(trace[0])) == 0,
+          "records did not round-trip");
+
+    // Decoding can start at the second component.
+    actual.clear();
+    {
+        columnar_istream_t in(path);
+        CHECK(in.seek_to_block(index.get_entries()[0].offset), "failed to seek");
+        read_columnar(in, actual);
+    }
+    CHECK(actual.size() == trace.size() - split, "wrong record count after seek");
+    CHECK(memcmp(actual.data(), trace.data() + split, actual.size() * sizeof(trace[0])) ==
+              0,
+          "records after seek did not round-trip");
+    remove(path.c_str());
+    remove(trace_index_t::get_path(path).c_str());
+    return true;
+}
+
+bool
+test_corruption()
+{
+    std::cerr << "Testing corruption\n";
+    std::vector<trace_entry_t> trace = make_trace(1000, true);
+    std::vector<char> block;
+    CHECK(columnar_encode_block(trace.data(), trace.size(), block).empty(),
+          "failed to encode");
+    columnar_block_header_t header;
+    memcpy(&header, block.data(), sizeof(header));
+    CHECK(columnar_block_payload_size(header) == block.size() - sizeof(header),
+          "wrong payload size");
+    std::vector<trace_entry_t> decoded;
+    CHECK(columnar_decode_block(header, block.data() + sizeof(header), decoded).empty(),
+          "failed to decode");
+    CHECK(decoded.size() == trace.size(), "wrong record count");
+    // A header claiming more records than were encoded must be rejected.
+    columnar_block_header_t bad = header;
+    ++bad.num_entries;
+    CHECK(!columnar_decode_block(bad, block.data() + sizeof(header), decoded).empty(),
+          "accepted a wrong record count");
+    bad = header;
+    bad.magic = 0;
+    CHECK(columnar_block_payload_size(bad) == 0, "accepted a bad magic");
+    return true;
+}
+
+uint64_t
+file_size(const std::string &path)
+{
+    std::ifstream file(path, std::ifstream::binary | std::ifstream::ate);
+    return static_cast<uint64_t>(file.tellg());
+}
+
+bool
+test_size()
+{
+    std::cerr << "Testing size\n";
+    const std::string col_path = "tmp_columnar_size.trace.col";
+    const std::string gz_path = "tmp_columnar_size.trace.gz";
+    std::vector<trace_entry_t> trace = make_trace(COLUMNAR_BLOCK_ENTRIES / 4, false);
+    {
+        columnar_ostream_t col(col_path);
+        gzip_ostream_t gz(gz_path);
+        col.write(reinterpret_cast<const char *>(trace.data()),
+                  trace.size() * sizeof(trace[0]));
+        gz.write(reinterpret_cast<const char *>(trace.data()),
+                 trace.size() * sizeof(trace[0]));
+    }
+    uint64_t col_size = file_size(col_path);
+    uint64_t gz_size = file_size(gz_path);
+    std::cerr << "columnar " << col_size << " vs gzip " << gz_size << " bytes\n";
+    // The strides should make this far more compressible than gzip finds it.
+    CHECK(col_size > 0 && col_size * 3 < gz_size, "columnar is not smaller than gzip");
+    remove(col_path.c_str());
+    remove(gz_path.c_str());
+    return true;
+}
+
+} // namespace
+
+int
+test_main(int argc, const char *argv[])
+{
+    if (!test_round_trip() || !test_corruption() || !test_size())
+        return 1;
+    std::cerr << "All done!\n";
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -32,9 +32,18 @@
 
 // Unit tests for drcachesim
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <memory>
 #include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #undef NDEBUG
 #include <assert.h>
@@ -42,7 +51,13 @@
 #include "cache_replacement_policy_unit_test.h"
 #include "simulator/cache.h"
 #include "simulator/cache_lru.h"
+#include "simulator/cache_set_kernels.h"
 #include "simulator/cache_simulator.h"
+#include "simulator/cache_stats.h"
+#include "simulator/cache_sweep.h"
+#include "simulator/miss_ratio_curve.h"
+#include "simulator/opt_miss_bound.h"
+#include "simulator/tag_index.h"
 #include "../common/memref.h"
 #include "../common/utils.h"
 
@@ -816,6 +831,845 @@ Core #1 \(traced CPU\(s\): #567800\)
     }
 }
 
+// Tests the per-access outcome reported by cache_simulator_t::process_memref().
+void
+unit_test_access_result()
+{
+    static constexpr int LINE_SIZE = 64;
+    static constexpr int L1_LINES = 32;
+    {
+        cache_simulator_knobs_t knobs = make_test_knobs();
+        // Make the LLC larger than the L1 so L1 evictions still hit in the LLC.
+        knobs.LL_size = 4 * L1_LINES * LINE_SIZE;
+        cache_simulator_t sim(knobs);
+        cache_result_t result;
+        assert(sim.process_memref(make_memref(0), &result));
+        assert(result.level[0].accessed() && result.level[0].missed());
+        assert(result.level[1].accessed() && result.level[1].missed());
+        TEST_EQ(result.level[0].evicted_tag, TAG_INVALID);
+        assert(!result.level[2].accessed());
+        // A repeated access hits in the L1 and never reaches the LLC.
+        assert(sim.process_memref(make_memref(8), &result));
+        assert(result.level[0].hit());
+        assert(!result.level[1].accessed());
+        // An instruction fetch of the same line misses in the L1I but hits in the
+        // shared LLC.
+        assert(sim.process_memref(make_memref(0, TRACE_TYPE_INSTR), &result));
+        assert(result.level[0].missed());
+        assert(result.level[1].hit());
+        // A line-crossing access touches two lines, one of which misses.
+        assert(sim.process_memref(make_memref(LINE_SIZE - 4, TRACE_TYPE_READ, 8),
+                                  &result));
+        TEST_EQ(result.level[0].lines, 2);
+        TEST_EQ(result.level[0].misses, 1);
+        TEST_EQ(result.level[1].lines, 1);
+        // Fill the fully-associative L1D so the next miss evicts the LRU line 0.
+        for (int i = 2; i < L1_LINES; ++i)
+            assert(sim.process_memref(make_memref(i * LINE_SIZE), &result));
+        assert(result.level[0].missed());
+        TEST_EQ(result.level[0].evicted_tag, TAG_INVALID);
+        assert(sim.process_memref(make_memref(L1_LINES * LINE_SIZE), &result));
+        assert(result.level[0].missed());
+        TEST_EQ(result.level[0].evicted_tag, 0);
+        // Markers do not access the caches and leave the result empty.
+        memref_t marker = make_memref(0, TRACE_TYPE_MARKER);
+        marker.marker.marker_type = TRACE_MARKER_TYPE_TIMESTAMP;
+        assert(sim.process_memref(marker, &result));
+        assert(!result.level[0].accessed() && !result.level[1].accessed());
+    }
+    {
+        cache_simulator_knobs_t knobs = make_test_knobs();
+        knobs.data_prefetcher = "nextline";
+        cache_simulator_t sim(knobs);
+        cache_result_t result;
+        assert(sim.process_memref(make_memref(0), &result));
+        assert(result.level[0].missed() && !result.level[0].prefetch_hit);
+        // The miss prefetched the next line, so this is a prefetch hit.
+        assert(sim.process_memref(make_memref(LINE_SIZE), &result));
+        assert(result.level[0].hit() && result.level[0].prefetch_hit);
+        // The line has now been demand-accessed.
+        assert(sim.process_memref(make_memref(LINE_SIZE + 8), &result));
+        assert(result.level[0].hit() && !result.level[0].prefetch_hit);
+    }
+}
+
+// Runs "num_refs" data reads through a simulator of "knobs", taking the address
+// and PC of reference i from "gen", and returns the L1D demand misses.
+template <typename GenT>
+int64_t
+run_prefetch_pattern(const cache_simulator_knobs_t &knobs, int num_refs, GenT gen,
+                     int64_t *useful = nullptr, int64_t *unused = nullptr,
+                     int64_t *late = nullptr)
+{
+    cache_simulator_t sim(knobs);
+    assert(!!sim);
+    for (int i = 0; i < num_refs; ++i) {
+        addr_t pc;
+        memref_t ref = make_memref(gen(i, pc));
+        ref.data.pc = pc;
+        if (!sim.process_memref(ref)) {
+            std::cerr << "prefetch pattern failed on memref " << i << "\n";
+            exit(1);
+        }
+    }
+    if (useful != nullptr)
+        *useful = sim.get_cache_metric(metric_name_t::PREFETCH_USEFUL, 1);
+    if (unused != nullptr)
+        *unused = sim.get_cache_metric(metric_name_t::PREFETCH_UNUSED, 1);
+    if (late != nullptr)
+        *late = sim.get_cache_metric(metric_name_t::PREFETCH_LATE, 1);
+    return sim.get_cache_metric(metric_name_t::MISSES, 1);
+}
+
+// Tests that each data prefetcher removes most of the misses of the pattern it
+// targets and that its accuracy and timeliness are counted.
+void
+unit_test_prefetchers()
+{
+    static constexpr int LINE_SIZE = 64;
+    static constexpr int NUM_REFS = 20000;
+    cache_simulator_knobs_t knobs = make_test_knobs();
+    knobs.L1D_size = 32 * 1024;
+    knobs.L1D_assoc = 8;
+    knobs.LL_size = 256 * 1024;
+    knobs.LL_assoc = 16;
+    {
+        // Two PCs walking arrays with strides of 3 lines and -2 lines, which a
+        // single stream cannot follow.
+        auto strided = [](int i, addr_t &pc) -> addr_t {
+            pc = i % 2 == 0 ? 0x1000 : 0x1004;
+            if (i % 2 == 0)
+                return 0x10000000 + (i / 2) * 3 * LINE_SIZE;
+            return 0x20000000 - (i / 2) * 2 * LINE_SIZE;
+        };
+        int64_t baseline = run_prefetch_pattern(knobs, NUM_REFS, strided);
+        TEST_EQ(baseline, NUM_REFS);
+        cache_simulator_knobs_t stride_knobs = knobs;
+        stride_knobs.data_prefetcher = "stride";
+        int64_t useful, unused, late;
+        int64_t misses = run_prefetch_pattern(stride_knobs, NUM_REFS, strided, &useful,
+                                              &unused, &late);
+        assert(misses < baseline / 10);
+        assert(useful > NUM_REFS * 9 / 10);
+        assert(unused < useful / 10);
+        // The first predictions of the second PC wait behind those of the first.
+        assert(late > 0 && late < 10);
+        // With a one-entry table the PCs keep evicting each other.
+        stride_knobs.prefetch_table_size = 1;
+        TEST_EQ(run_prefetch_pattern(stride_knobs, NUM_REFS, strided), baseline);
+    }
+    {
+        // A walk whose stride maps every line to the same set of a direct-mapped
+        // cache, reading each line twice.  Once the stride is learned, the
+        // prefetch issued on the first read evicts the line, so the second read
+        // must miss too rather than hit on the remembered last line.
+        cache_simulator_knobs_t dm_knobs = knobs;
+        dm_knobs.L1D_assoc = 1;
+        dm_knobs.data_prefetcher = "stride";
+        static constexpr addr_t SET_STRIDE = 32 * 1024;
+        auto same_set = [](int i, addr_t &pc) -> addr_t {
+            pc = 0x1000;
+            return 0x10000000 + (i / 2) * SET_STRIDE;
+        };
+        static constexpr int SAME_SET_REFS = 2000;
+        assert(run_prefetch_pattern(dm_knobs, SAME_SET_REFS, same_set) >
+               SAME_SET_REFS - 10);
+    }
+    {
+        // Interleaved ascending and descending sequential streams of 8-byte
+        // elements from a single PC.
+        auto streams = [](int i, addr_t &pc) -> addr_t {
+            pc = 0x1000;
+            if (i % 2 == 0)
+                return 0x10000000 + (i / 2) * 8;
+            return 0x20000000 - (i / 2) * 8;
+        };
+        int64_t baseline = run_prefetch_pattern(knobs, NUM_REFS, streams);
+        cache_simulator_knobs_t stream_knobs = knobs;
+        stream_knobs.data_prefetcher = "stream";
+        int64_t useful;
+        int64_t misses =
+            run_prefetch_pattern(stream_knobs, NUM_REFS, streams, &useful);
+        assert(misses < baseline / 10);
+        assert(useful > baseline * 9 / 10);
+    }
+    {
+        // A repeating pattern of irregular line deltas.
+        static const int deltas[] = { 3, 7, -2, 9, 1 };
+        auto irregular = [](int i, addr_t &pc) -> addr_t {
+            pc = 0x1000 + (i % 5) * 4;
+            addr_t line = 0x100000;
+            for (int j = 0; j < i; ++j)
+                line += deltas[j % 5];
+            return line * LINE_SIZE;
+        };
+        static constexpr int IRREGULAR_REFS = 2000;
+        int64_t baseline = run_prefetch_pattern(knobs, IRREGULAR_REFS, irregular);
+        TEST_EQ(baseline, IRREGULAR_REFS);
+        cache_simulator_knobs_t ghb_knobs = knobs;
+        ghb_knobs.data_prefetcher = "ghb";
+        int64_t useful, unused;
+        int64_t misses = run_prefetch_pattern(ghb_knobs, IRREGULAR_REFS, irregular,
+                                              &useful, &unused);
+        assert(misses < baseline / 10);
+        assert(unused < useful / 10);
+        // The stride prefetcher sees a different PC for each delta and a
+        // stride of 18 lines, so it covers the pattern too.
+        cache_simulator_knobs_t stride_knobs = knobs;
+        stride_knobs.data_prefetcher = "stride";
+        assert(run_prefetch_pattern(stride_knobs, IRREGULAR_REFS, irregular) <
+               baseline / 10);
+    }
+    {
+        // Unknown policies and empty tables are rejected.
+        cache_simulator_knobs_t bad_knobs = knobs;
+        bad_knobs.data_prefetcher = "markov";
+        cache_simulator_t bad_policy(bad_knobs);
+        assert(!bad_policy);
+        bad_knobs.data_prefetcher = "ghb";
+        bad_knobs.prefetch_table_size = 0;
+        cache_simulator_t bad_table(bad_knobs);
+        assert(!bad_table);
+    }
+}
+
+// Tests that each cache_sweep configuration matches a standalone simulation.
+void
+unit_test_cache_sweep()
+{
+    {
+        // Test config parsing errors.
+        std::vector<cache_simulator_knobs_t> configs;
+        cache_simulator_knobs_t base = make_test_knobs();
+        assert(!cache_sweep_t::parse_configs(base, "", configs).empty());
+        assert(!cache_sweep_t::parse_configs(base, "L1D_size", configs).empty());
+        assert(!cache_sweep_t::parse_configs(base, "L1D_size=1Q", configs).empty());
+        assert(!cache_sweep_t::parse_configs(base, "bogus=1", configs).empty());
+        assert(cache_sweep_t::parse_configs(base, " L1D_size=2K, LL_assoc=4 ;LL_size=1M",
+                                            configs)
+                   .empty());
+        TEST_EQ(configs.size(), 2U);
+        TEST_EQ(configs[0].L1D_size, 2048U);
+        TEST_EQ(configs[0].LL_assoc, 4U);
+        TEST_EQ(configs[1].L1D_size, base.L1D_size);
+        TEST_EQ(configs[1].LL_size, 1U << 20);
+    }
+    cache_simulator_knobs_t knobs = make_test_knobs();
+    knobs.num_cores = 2;
+    knobs.L1I_assoc = 4;
+    knobs.L1D_assoc = 4;
+    knobs.LL_assoc = 8;
+    // An invalid configuration is reported at construction.
+    cache_sweep_t bad_sweep(knobs, "L1D_size=3K", 1);
+    assert(!bad_sweep);
+    cache_sweep_t sweep(knobs,
+                        "L1D_size=1K,LL_size=4K;L1D_size=2K,LL_size=8K,LL_assoc=4;"
+                        "L1D_size=4K,LL_size=16K,replace_policy=FIFO",
+                        2);
+    assert(!!sweep);
+    assert(sweep.initialize_shard_type(SHARD_BY_THREAD).empty());
+    TEST_EQ(sweep.get_num_configs(), 3U);
+    std::vector<std::unique_ptr<cache_simulator_t>> expected;
+    for (size_t i = 0; i < sweep.get_num_configs(); ++i) {
+        expected.emplace_back(new cache_simulator_t(sweep.get_config_knobs(i)));
+        assert(!!*expected.back());
+    }
+    // Use enough memrefs to span several chunks, from two threads.
+    uint64_t seed = 42;
+    for (int i = 0; i < 200000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        addr_t addr = (seed >> 33) % (64 * 1024);
+        memref_t ref = make_memref(addr, i % 4 == 0 ? TRACE_TYPE_INSTR : TRACE_TYPE_READ);
+        ref.data.tid = 1 + (i / 1000) % 2;
+        assert(sweep.process_memref(ref));
+        for (auto &sim : expected)
+            assert(sim->process_memref(ref));
+    }
+    assert(sweep.drain());
+    for (size_t i = 0; i < sweep.get_num_configs(); ++i) {
+        for (unsigned core = 0; core < knobs.num_cores; ++core) {
+            for (unsigned level = 1; level <= 2; ++level) {
+                TEST_EQ(sweep.get_simulator(i).get_cache_metric(metric_name_t::HITS,
+                                                                level, core),
+                        expected[i]->get_cache_metric(metric_name_t::HITS, level, core));
+                TEST_EQ(
+                    sweep.get_simulator(i).get_cache_metric(metric_name_t::MISSES, level,
+                                                            core),
+                    expected[i]->get_cache_metric(metric_name_t::MISSES, level, core));
+            }
+            TEST_EQ(sweep.get_simulator(i).get_cache_metric(
+                        metric_name_t::MISSES, 1, core, cache_split_t::INSTRUCTION),
+                    expected[i]->get_cache_metric(metric_name_t::MISSES, 1, core,
+                                                  cache_split_t::INSTRUCTION));
+        }
+    }
+    // Configurations should actually differ.
+    assert(sweep.get_simulator(0).get_cache_metric(metric_name_t::MISSES, 1) !=
+           sweep.get_simulator(2).get_cache_metric(metric_name_t::MISSES, 1));
+
+    // The results go to their own file, leaving the experiments.csv written by
+    // the missing_instructions tool under the same path alone.
+    {
+        std::string prefix = "unit_test_cache_sweep_";
+        std::string other_path = prefix + "experiments.csv";
+        std::string sweep_path = prefix + "sweep_experiments.csv";
+        std::remove(sweep_path.c_str());
+        const std::string other_contents = "Experiment ID; L1I Size; L1D Size\n";
+        {
+            std::ofstream other_file(other_path);
+            other_file << other_contents;
+        }
+        knobs.cache_trace_log_path = prefix;
+        cache_sweep_t logged_sweep(knobs, "L1D_size=1K;L1D_size=2K", 1);
+        assert(!!logged_sweep);
+        for (int i = 0; i < 1000; ++i)
+            assert(logged_sweep.process_memref(make_memref(i * 64)));
+        std::stringstream output;
+        std::streambuf *prev_buf = std::cerr.rdbuf(output.rdbuf());
+        assert(logged_sweep.print_results());
+        std::cerr.rdbuf(prev_buf);
+        std::ifstream other_file(other_path);
+        std::stringstream other;
+        other << other_file.rdbuf();
+        TEST_EQ(other.str(), other_contents);
+        std::ifstream sweep_file(sweep_path);
+        std::string line;
+        assert(std::getline(sweep_file, line));
+        assert(line.find("Experiment ID; Config; L1D Size;") == 0);
+        int rows = 0;
+        while (std::getline(sweep_file, line))
+            ++rows;
+        TEST_EQ(rows, 2);
+        std::remove(other_path.c_str());
+        std::remove(sweep_path.c_str());
+    }
+}
+
+// Tests that the single-pass curve matches a regular simulation of each point.
+void
+unit_test_miss_ratio_curve()
+{
+    cache_simulator_knobs_t knobs = make_test_knobs();
+    knobs.num_cores = 2;
+    knobs.L1I_size = 1024;
+    knobs.L1D_size = 1024;
+    knobs.L1I_assoc = 4;
+    knobs.L1D_assoc = 4;
+    knobs.LL_size = 8 * 1024;
+    knobs.LL_assoc = 8;
+    knobs.warmup_refs = 1000;
+    miss_ratio_curve_knobs_t curve_knobs;
+    curve_knobs.L1_min_size = 512;
+    curve_knobs.L1_max_size = 8 * 1024;
+    curve_knobs.LL_min_size = 4 * 1024;
+    curve_knobs.LL_max_size = 64 * 1024;
+    curve_knobs.min_assoc = 1;
+    curve_knobs.max_assoc = 16;
+    {
+        // Unsupported configurations are rejected.
+        cache_simulator_knobs_t bad_knobs = knobs;
+        bad_knobs.data_prefetcher = "nextline";
+        miss_ratio_curve_t bad_prefetch(bad_knobs, curve_knobs);
+        assert(!bad_prefetch);
+        bad_knobs = knobs;
+        bad_knobs.replace_policy = "FIFO";
+        miss_ratio_curve_t bad_policy(bad_knobs, curve_knobs);
+        assert(!bad_policy);
+    }
+    miss_ratio_curve_t curve(knobs, curve_knobs);
+    assert(!!curve);
+    // Each expected L1 point uses the baseline LL, and each LL point the baseline
+    // L1, whose miss stream is what the LL curve is computed from.
+    const uint64_t l1_sizes[] = { 512, 1024, 2048, 8192 };
+    const unsigned int l1_assocs[] = { 1, 2, 8 };
+    const uint64_t ll_sizes[] = { 4096, 16384, 65536 };
+    const unsigned int ll_assocs[] = { 1, 4, 16 };
+    std::vector<std::unique_ptr<cache_simulator_t>> l1_expected;
+    std::vector<std::unique_ptr<cache_simulator_t>> ll_expected;
+    for (uint64_t size : l1_sizes) {
+        for (unsigned int assoc : l1_assocs) {
+            cache_simulator_knobs_t point = knobs;
+            point.L1I_size = size;
+            point.L1D_size = size;
+            point.L1I_assoc = assoc;
+            point.L1D_assoc = assoc;
+            l1_expected.emplace_back(new cache_simulator_t(point));
+            assert(!!*l1_expected.back());
+        }
+    }
+    for (uint64_t size : ll_sizes) {
+        for (unsigned int assoc : ll_assocs) {
+            cache_simulator_knobs_t point = knobs;
+            point.LL_size = size;
+            point.LL_assoc = assoc;
+            ll_expected.emplace_back(new cache_simulator_t(point));
+            assert(!!*ll_expected.back());
+        }
+    }
+    uint64_t seed = 7;
+    for (int i = 0; i < 30000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        addr_t addr = (seed >> 33) % (48 * 1024);
+        trace_type_t type;
+        int size = 4;
+        switch ((seed >> 20) % 8) {
+        case 0:
+        case 1:
+        case 2: type = TRACE_TYPE_INSTR; break;
+        case 3: type = TRACE_TYPE_WRITE; break;
+        case 4:
+            // Spans two or three lines.
+            type = TRACE_TYPE_READ;
+            size = 100;
+            break;
+        case 5: type = TRACE_TYPE_PREFETCHT0; break;
+        case 6: type = TRACE_TYPE_PREFETCH_INSTR; break;
+        default: type = TRACE_TYPE_READ;
+        }
+        memref_t ref = make_memref(addr, type, size);
+        ref.data.tid = 1 + (i / 500) % 3;
+        assert(curve.process_memref(ref));
+        for (auto &sim : l1_expected)
+            assert(sim->process_memref(ref));
+        for (auto &sim : ll_expected)
+            assert(sim->process_memref(ref));
+    }
+    int index = 0;
+    for (uint64_t size : l1_sizes) {
+        for (unsigned int assoc : l1_assocs) {
+            int64_t imisses = 0, dmisses = 0;
+            for (unsigned int core = 0; core < knobs.num_cores; ++core) {
+                imisses += l1_expected[index]->get_cache_metric(
+                    metric_name_t::MISSES, 1, core, cache_split_t::INSTRUCTION);
+                dmisses += l1_expected[index]->get_cache_metric(
+                    metric_name_t::MISSES, 1, core, cache_split_t::DATA);
+            }
+            TEST_EQ(curve.get_misses(miss_ratio_curve_t::LEVEL_L1I, size, assoc),
+                    imisses);
+            TEST_EQ(curve.get_misses(miss_ratio_curve_t::LEVEL_L1D, size, assoc),
+                    dmisses);
+            ++index;
+        }
+    }
+    index = 0;
+    for (uint64_t size : ll_sizes) {
+        for (unsigned int assoc : ll_assocs) {
+            TEST_EQ(curve.get_misses(miss_ratio_curve_t::LEVEL_LL, size, assoc),
+                    ll_expected[index]->get_cache_metric(metric_name_t::MISSES, 2));
+            ++index;
+        }
+    }
+    TEST_EQ(curve.get_accesses(miss_ratio_curve_t::LEVEL_LL),
+            ll_expected[0]->get_cache_metric(metric_name_t::HITS, 2) +
+                ll_expected[0]->get_cache_metric(metric_name_t::MISSES, 2));
+    // The baseline is tracked even when outside the range; other points are not.
+    assert(curve.get_misses(miss_ratio_curve_t::LEVEL_LL, 8 * 1024, 8) >= 0);
+    TEST_EQ(curve.get_misses(miss_ratio_curve_t::LEVEL_L1D, 3 * 1024, 1), -1);
+    TEST_EQ(curve.get_misses(miss_ratio_curve_t::LEVEL_L1D, 16 * 1024, 1), -1);
+
+    // The printed curve has the exact miss counts and leaves the stream formatting
+    // as it was.
+    std::stringstream output;
+    std::streambuf *prev_buf = std::cerr.rdbuf(output.rdbuf());
+    std::ios_base::fmtflags prev_flags = std::cerr.flags();
+    std::streamsize prev_precision = std::cerr.precision();
+    assert(curve.print_results());
+    assert(std::cerr.flags() == prev_flags);
+    assert(std::cerr.precision() == prev_precision);
+    std::cerr.rdbuf(prev_buf);
+    // The locale may add digit separators.
+    std::string printed = output.str();
+    printed.erase(std::remove(printed.begin(), printed.end(), ','), printed.end());
+    for (uint64_t size : ll_sizes) {
+        for (unsigned int assoc : ll_assocs) {
+            int64_t misses = curve.get_misses(miss_ratio_curve_t::LEVEL_LL, size, assoc);
+            std::string cell = " " + std::to_string(misses) + " (";
+            assert(printed.find(cell) != std::string::npos);
+        }
+    }
+}
+
+// Tests that the LRU side of the OPT miss bound matches a regular simulation and
+// that the OPT side is Belady's MIN.
+void
+unit_test_opt_miss_bound()
+{
+    {
+        // Every line of a loop over 5 lines misses in the L1 and LRU misses all
+        // of them in a 4-line LL, while MIN keeps 3 of them.
+        cache_simulator_knobs_t knobs = make_test_knobs();
+        knobs.L1D_size = 64;
+        knobs.L1D_assoc = 1;
+        knobs.LL_size = 4 * 64;
+        knobs.LL_assoc = 4;
+        opt_miss_bound_t bound(knobs, "", /*report_top=*/10);
+        assert(!!bound);
+        for (int i = 0; i < 50; ++i) {
+            memref_t ref = make_memref((i % 5) * 64);
+            ref.data.pc = 0x100 + (i % 5 == 0 ? 4 : 0);
+            assert(bound.process_memref(ref));
+        }
+        assert(bound.compute_bound());
+        TEST_EQ(bound.get_accesses(), 50);
+        TEST_EQ(bound.get_lru_misses(), 50);
+        TEST_EQ(bound.get_opt_misses(), 16);
+        TEST_EQ(bound.get_pc_misses().at(0x104).lru_misses, 10);
+        TEST_EQ(bound.get_pc_misses().at(0x100).accesses, 40);
+    }
+    cache_simulator_knobs_t knobs = make_test_knobs();
+    knobs.num_cores = 2;
+    knobs.L1I_size = 1024;
+    knobs.L1D_size = 1024;
+    knobs.L1I_assoc = 4;
+    knobs.L1D_assoc = 4;
+    knobs.LL_size = 8 * 1024;
+    knobs.LL_assoc = 8;
+    knobs.warmup_refs = 1000;
+    {
+        // Unsupported configurations are rejected.
+        cache_simulator_knobs_t bad_knobs = knobs;
+        bad_knobs.data_prefetcher = "nextline";
+        opt_miss_bound_t bad_prefetch(bad_knobs, "", 10);
+        assert(!bad_prefetch);
+        bad_knobs = knobs;
+        bad_knobs.replace_policy = "FIFO";
+        opt_miss_bound_t bad_policy(bad_knobs, "", 10);
+        assert(!bad_policy);
+    }
+    // A small chunk size exercises the index passes across chunk boundaries.
+    opt_miss_bound_t bound(knobs, "", 10);
+    opt_miss_bound_t chunked_bound(knobs, "", 10, /*chunk_refs=*/999);
+    cache_simulator_t expected(knobs);
+    assert(!!bound && !!chunked_bound && !!expected);
+    uint64_t seed = 11;
+    for (int i = 0; i < 30000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        addr_t addr = (seed >> 33) % (48 * 1024);
+        trace_type_t type;
+        int size = 4;
+        switch ((seed >> 20) % 8) {
+        case 0:
+        case 1:
+        case 2: type = TRACE_TYPE_INSTR; break;
+        case 3: type = TRACE_TYPE_WRITE; break;
+        case 4:
+            // Spans two or three lines.
+            type = TRACE_TYPE_READ;
+            size = 100;
+            break;
+        case 5: type = TRACE_TYPE_PREFETCHT0; break;
+        case 6: type = TRACE_TYPE_PREFETCH_INSTR; break;
+        default: type = TRACE_TYPE_READ;
+        }
+        memref_t ref = make_memref(addr, type, size);
+        if (!type_is_instr(type) && type != TRACE_TYPE_PREFETCH_INSTR)
+            ref.data.pc = 0x1000 + ((seed >> 40) % 16) * 4;
+        ref.data.tid = 1 + (i / 500) % 3;
+        assert(bound.process_memref(ref));
+        assert(chunked_bound.process_memref(ref));
+        assert(expected.process_memref(ref));
+    }
+    assert(bound.compute_bound());
+    assert(chunked_bound.compute_bound());
+    TEST_EQ(bound.get_accesses(),
+            expected.get_cache_metric(metric_name_t::HITS, 2) +
+                expected.get_cache_metric(metric_name_t::MISSES, 2));
+    TEST_EQ(bound.get_lru_misses(), expected.get_cache_metric(metric_name_t::MISSES, 2));
+    assert(bound.get_opt_misses() < bound.get_lru_misses());
+    TEST_EQ(chunked_bound.get_lru_misses(), bound.get_lru_misses());
+    TEST_EQ(chunked_bound.get_opt_misses(), bound.get_opt_misses());
+    int64_t accesses = 0, lru_misses = 0, opt_misses = 0;
+    for (const auto &entry : bound.get_pc_misses()) {
+        assert(entry.second.opt_misses <= entry.second.accesses);
+        accesses += entry.second.accesses;
+        lru_misses += entry.second.lru_misses;
+        opt_misses += entry.second.opt_misses;
+    }
+    TEST_EQ(accesses, bound.get_accesses());
+    TEST_EQ(lru_misses, bound.get_lru_misses());
+    TEST_EQ(opt_misses, bound.get_opt_misses());
+}
+
+// Tests that every set kernel variant agrees with the scalar one, both on
+// individual sets and on whole high-associativity LRU caches.
+void
+unit_test_set_kernels()
+{
+    std::vector<set_kernel_isa_t> isas = { SET_KERNEL_SCALAR };
+    if (set_kernel_best_isa() >= SET_KERNEL_SSE41)
+        isas.push_back(SET_KERNEL_SSE41);
+    if (set_kernel_best_isa() >= SET_KERNEL_AVX2)
+        isas.push_back(SET_KERNEL_AVX2);
+    uint64_t seed = 11;
+    auto next_random = [&seed]() {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    for (int assoc : { 1, 3, 4, 7, 8, 13, 16, 24, 32 }) {
+        for (int iter = 0; iter < 200; ++iter) {
+            std::vector<addr_t> tags(assoc);
+            std::vector<int32_t> ages(assoc);
+            for (int way = 0; way < assoc; ++way) {
+                tags[way] = next_random() % 4 == 0 ? TAG_INVALID : next_random() % 64;
+                ages[way] = way;
+            }
+            // Ages are a permutation of the ways.
+            for (int way = assoc - 1; way > 0; --way)
+                std::swap(ages[way], ages[next_random() % (way + 1)]);
+            addr_t tag = next_random() % 64;
+            int touch_way = static_cast<int>(next_random() % assoc);
+            int expect_way =
+                set_kernel_find_way(SET_KERNEL_SCALAR, tags.data(), assoc, tag);
+            int expect_victim =
+                set_kernel_lru_victim(SET_KERNEL_SCALAR, tags.data(), ages.data(), assoc);
+            std::vector<int32_t> expect_ages = ages;
+            set_kernel_lru_touch(SET_KERNEL_SCALAR, expect_ages.data(), assoc, touch_way);
+            for (set_kernel_isa_t isa : isas) {
+                TEST_EQ(set_kernel_find_way(isa, tags.data(), assoc, tag), expect_way);
+                TEST_EQ(set_kernel_lru_victim(isa, tags.data(), ages.data(), assoc),
+                        expect_victim);
+                std::vector<int32_t> new_ages = ages;
+                set_kernel_lru_touch(isa, new_ages.data(), assoc, touch_way);
+                assert(new_ages == expect_ages);
+            }
+        }
+    }
+    static constexpr int LINE_SIZE = 64;
+    for (int assoc : { 16, 32 }) {
+        int total_size = LINE_SIZE * assoc * 32;
+        std::vector<std::unique_ptr<cache_lru_t>> caches;
+        std::vector<std::unique_ptr<caching_device_stats_t>> stats;
+        for (set_kernel_isa_t isa : isas) {
+            caches.emplace_back(new cache_lru_t);
+            stats.emplace_back(new caching_device_stats_t(/*miss_file=*/"", LINE_SIZE));
+            assert(caches.back()->init(assoc, LINE_SIZE, total_size, /*parent=*/nullptr,
+                                       stats.back().get()));
+            caches.back()->select_set_kernels(isa);
+        }
+        for (int i = 0; i < 100000; ++i) {
+            memref_t ref = make_memref(next_random() % (4 * total_size));
+            for (auto &cache : caches)
+                cache->request(ref);
+            if (i % 1000 == 0) {
+                for (auto &cache : caches)
+                    cache->invalidate(ref.data.addr / LINE_SIZE, INVALIDATION_COHERENCE);
+            }
+        }
+        for (auto &stat : stats) {
+            TEST_EQ(get_cache_stats(*stat).hits, get_cache_stats(*stats[0]).hits);
+            TEST_EQ(get_cache_stats(*stat).misses, get_cache_stats(*stats[0]).misses);
+        }
+        assert(get_cache_stats(*stats[0]).hits > 0);
+    }
+}
+
+// Tests the flat tag index against a std::unordered_map, and that caches give the
+// same results with and without it.
+void
+unit_test_tag_index()
+{
+    static constexpr int MAX_ENTRIES = 1000;
+    tag_index_t index;
+    index.init(MAX_ENTRIES);
+    std::unordered_map<addr_t, int> expected;
+    uint64_t seed = 3;
+    for (int i = 0; i < 200000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Few distinct tags, so that runs form and erases shift entries back.
+        addr_t tag = (seed >> 33) % (3 * MAX_ENTRIES);
+        auto it = expected.find(tag);
+        TEST_EQ(index.find(tag), it == expected.end() ? -1 : it->second);
+        if (it != expected.end() && (seed >> 20) % 2 == 0) {
+            index.erase(tag);
+            expected.erase(it);
+        } else if (it == expected.end() && expected.size() < MAX_ENTRIES) {
+            index.insert(tag, i);
+            expected[tag] = i;
+        }
+        TEST_EQ(index.size(), expected.size());
+    }
+    for (const auto &entry : expected)
+        TEST_EQ(index.find(entry.first), entry.second);
+
+    static constexpr int LINE_SIZE = 64;
+    static constexpr int TOTAL_SIZE = LINE_SIZE * 16 * 256;
+    cache_lru_t walk_cache, index_cache;
+    caching_device_stats_t walk_stats(/*miss_file=*/"", LINE_SIZE);
+    caching_device_stats_t index_stats(/*miss_file=*/"", LINE_SIZE);
+    assert(walk_cache.init(16, LINE_SIZE, TOTAL_SIZE, /*parent=*/nullptr, &walk_stats));
+    assert(
+        index_cache.init(16, LINE_SIZE, TOTAL_SIZE, /*parent=*/nullptr, &index_stats));
+    index_cache.set_hashtable_use(true);
+    for (int i = 0; i < 200000; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        memref_t ref = make_memref((seed >> 33) % (2 * TOTAL_SIZE));
+        walk_cache.request(ref);
+        index_cache.request(ref);
+        if (i % 100 == 0) {
+            walk_cache.invalidate(ref.data.addr / LINE_SIZE, INVALIDATION_COHERENCE);
+            index_cache.invalidate(ref.data.addr / LINE_SIZE, INVALIDATION_COHERENCE);
+        }
+    }
+    TEST_EQ(get_cache_stats(index_stats).hits, get_cache_stats(walk_stats).hits);
+    TEST_EQ(get_cache_stats(index_stats).misses, get_cache_stats(walk_stats).misses);
+}
+
+// Tests that a set-sampled cache estimates the full cache's counts within its
+// reported error.
+void
+unit_test_set_sampling()
+{
+    static constexpr int LINE_SIZE = 64;
+    static constexpr int TOTAL_SIZE = 4 * 1024 * 1024;
+    static constexpr int ASSOC = 16;
+    static constexpr int NUM_SETS = TOTAL_SIZE / LINE_SIZE / ASSOC;
+    cache_lru_t full_cache, sampled_cache;
+    cache_stats_t full_stats(LINE_SIZE, /*miss_file=*/"", /*warmup_enabled=*/false);
+    cache_stats_t sampled_stats(LINE_SIZE, /*miss_file=*/"", /*warmup_enabled=*/false);
+    assert(full_cache.init(ASSOC, LINE_SIZE, TOTAL_SIZE, /*parent=*/nullptr,
+                           &full_stats));
+    assert(sampled_cache.init(ASSOC, LINE_SIZE, TOTAL_SIZE, /*parent=*/nullptr,
+                              &sampled_stats));
+    sampled_cache.set_sampling(16);
+    int sampled_sets = sampled_cache.get_num_sampled_sets();
+    // The hash should pick close to 1/16 of the sets.
+    assert(sampled_sets > NUM_SETS / 32 && sampled_sets < NUM_SETS / 8);
+    assert(sampled_cache.get_description().find("sampled") != std::string::npos);
+    uint64_t seed = 5;
+    static constexpr int NUM_ACCESSES = 1000000;
+    for (int i = 0; i < NUM_ACCESSES; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        // A hot region that fits plus a uniform region twice the cache size.
+        addr_t addr = (seed >> 40) % 4 == 0 ? (seed >> 33) % (TOTAL_SIZE / 4)
+                                            : (seed >> 30) % (2 * TOTAL_SIZE);
+        // Keep accesses within one line.
+        memref_t ref = make_memref(addr & ~3);
+        full_cache.request(ref);
+        sampled_cache.request(ref);
+    }
+    int64_t full_hits = full_stats.get_metric(metric_name_t::HITS);
+    int64_t full_misses = full_stats.get_metric(metric_name_t::MISSES);
+    int64_t est_hits = sampled_stats.get_metric(metric_name_t::HITS);
+    int64_t est_misses = sampled_stats.get_metric(metric_name_t::MISSES);
+    TEST_EQ(full_hits + full_misses, NUM_ACCESSES);
+    // The scaled access count is itself an estimate.
+    assert(std::abs(est_hits + est_misses - NUM_ACCESSES) < NUM_ACCESSES / 10);
+    double full_rate = static_cast<double>(full_misses) / NUM_ACCESSES;
+    double est_rate = static_cast<double>(est_misses) / (est_hits + est_misses);
+    double error = sampled_stats.get_miss_rate_error();
+    assert(error > 0. && error < 0.05);
+    assert(std::abs(est_rate - full_rate) <= error);
+    TEST_EQ(full_stats.get_miss_rate_error(), 0.);
+    // A rate of 1 goes back to simulating every set.
+    sampled_cache.set_sampling(1);
+    TEST_EQ(sampled_cache.get_num_sampled_sets(), NUM_SETS);
+}
+
+// Tests that periodic sampling only measures its units and that its per-unit
+// estimate of the miss rate agrees with full simulation.
+void
+unit_test_periodic_sampling()
+{
+    cache_simulator_knobs_t knobs = make_test_knobs();
+    knobs.L1D_size = 32 * 1024;
+    knobs.L1D_assoc = 8;
+    knobs.LL_size = 256 * 1024;
+    knobs.LL_assoc = 16;
+    cache_simulator_t full_sim(knobs);
+    knobs.sample_period_refs = 10000;
+    knobs.sample_warmup_refs = 1000;
+    knobs.sample_unit_refs = 1000;
+    cache_simulator_t sampled_sim(knobs);
+    assert(!!full_sim && !!sampled_sim);
+    static constexpr int NUM_PERIODS = 100;
+    uint64_t seed = 11;
+    for (uint64_t i = 0; i < NUM_PERIODS * knobs.sample_period_refs; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Alternate phases with working sets larger and smaller than the L1D.
+        addr_t range = (i / 50000) % 2 == 0 ? 16 * 1024 : 512 * 1024;
+        memref_t ref = make_memref(((seed >> 33) % range) & ~3);
+        if (!full_sim.process_memref(ref) || !sampled_sim.process_memref(ref)) {
+            std::cerr << "periodic sampling failed on memref " << i << "\n";
+            exit(1);
+        }
+    }
+    // Only the measured references reach the stats.
+    int64_t measured = sampled_sim.get_cache_metric(metric_name_t::HITS, 1) +
+        sampled_sim.get_cache_metric(metric_name_t::MISSES, 1);
+    TEST_EQ(measured, NUM_PERIODS * knobs.sample_unit_refs);
+    double miss_rate, error;
+    // The last unit is still open.
+    TEST_EQ(sampled_sim.get_sampled_miss_rate("L1D0", miss_rate, error),
+            NUM_PERIODS - 1);
+    double full_rate =
+        static_cast<double>(full_sim.get_cache_metric(metric_name_t::MISSES, 1)) /
+        (NUM_PERIODS * knobs.sample_period_refs);
+    assert(error > 0. && error < 0.1);
+    assert(std::abs(miss_rate - full_rate) <= 2 * error);
+    assert(sampled_sim.get_sampled_miss_rate("LL", miss_rate, error) > 0);
+    TEST_EQ(full_sim.get_sampled_miss_rate("L1D0", miss_rate, error), 0);
+
+    // The period must hold the warmup and the unit.
+    knobs.sample_warmup_refs = knobs.sample_period_refs;
+    cache_simulator_t bad_sim(knobs);
+    assert(!bad_sim);
+}
+
+// Tests that functional warming leaves an inclusive hierarchy in the same state
+// as full simulation, by measuring both afterward.
+void
+unit_test_functional_warming()
+{
+    static constexpr int LINE_SIZE = 64;
+    struct hierarchy_t {
+        hierarchy_t()
+            : l1_stats(LINE_SIZE, /*miss_file=*/"", /*warmup_enabled=*/false)
+            , ll_stats(LINE_SIZE, /*miss_file=*/"", /*warmup_enabled=*/false)
+        {
+            assert(ll.init(16, LINE_SIZE, 128 * 1024, /*parent=*/nullptr, &ll_stats,
+                           /*prefetcher=*/nullptr, cache_inclusion_policy_t::INCLUSIVE,
+                           /*coherent_cache=*/false, /*id_=*/-1,
+                           /*snoop_filter_=*/nullptr, { &l1 }));
+            assert(l1.init(4, LINE_SIZE, 8 * 1024, &ll, &l1_stats));
+        }
+        void
+        set_simulation_mode(simulation_mode_t mode)
+        {
+            l1.set_simulation_mode(mode);
+            ll.set_simulation_mode(mode);
+        }
+        cache_t l1;
+        cache_lru_t ll;
+        cache_stats_t l1_stats;
+        cache_stats_t ll_stats;
+    };
+    hierarchy_t full, warmed;
+    full.set_simulation_mode(simulation_mode_t::DETAILED_WARMUP);
+    warmed.set_simulation_mode(simulation_mode_t::FUNCTIONAL_WARMING);
+    uint64_t seed = 5;
+    for (int i = 0; i < 300000; ++i) {
+        if (i == 200000) {
+            full.set_simulation_mode(simulation_mode_t::MEASURE);
+            warmed.set_simulation_mode(simulation_mode_t::MEASURE);
+        }
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Some accesses span two lines and some are writes.
+        memref_t ref = make_memref((seed >> 33) % (256 * 1024),
+                                   (seed >> 20) % 4 == 0 ? TRACE_TYPE_WRITE
+                                                         : TRACE_TYPE_READ,
+                                   (seed >> 24) % 8 == 0 ? LINE_SIZE : 4);
+        full.l1.request(ref);
+        warmed.l1.request(ref);
+    }
+    TEST_EQ(get_cache_stats(warmed.l1_stats).hits, get_cache_stats(full.l1_stats).hits);
+    TEST_EQ(get_cache_stats(warmed.l1_stats).misses,
+            get_cache_stats(full.l1_stats).misses);
+    TEST_EQ(get_cache_stats(warmed.ll_stats).hits, get_cache_stats(full.ll_stats).hits);
+    TEST_EQ(get_cache_stats(warmed.ll_stats).misses,
+            get_cache_stats(full.ll_stats).misses);
+    assert(get_cache_stats(full.ll_stats).misses > 0);
+}
+
 int
 test_main(int argc, const char *argv[])
 {
@@ -837,6 +1691,16 @@ test_main(int argc, const char *argv[])
     unit_test_child_hits();
     unit_test_cache_replacement_policy();
     unit_test_core_sharded();
+    unit_test_access_result();
+    unit_test_prefetchers();
+    unit_test_cache_sweep();
+    unit_test_miss_ratio_curve();
+    unit_test_opt_miss_bound();
+    unit_test_set_kernels();
+    unit_test_tag_index();
+    unit_test_set_sampling();
+    unit_test_periodic_sampling();
+    unit_test_functional_warming();
     return 0;
 }
 
@@ -0,0 +1,200 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Unit tests for the memory-mapped trace reader. */
+
+#include "file_reader.h"
+#include "mmap_file_reader.h"
+#include "mock_reader.h"
+#include "record_file_reader.h"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace dynamorio {
+namespace drmemtrace {
+namespace {
+
+#define CHECK(cond, msg, ...)             \
+    do {                                  \
+        if (!(cond)) {                    \
+            fprintf(stderr, "%s\n", msg); \
+            return false;                 \
+        }                                 \
+    } while (0)
+
+constexpr memref_tid_t TID = 7;
+constexpr memref_pid_t PID = 3;
+// Enough records to cross several prefetch windows.
+constexpr int NUM_INSTRS = 1 << 18;
+
+bool
+write_trace(const std::string &path)
+{
+    std::ofstream out(path, std::ofstream::binary);
+    auto write = [&out](const trace_entry_t &entry) {
+        out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    };
+    write(make_header(TRACE_ENTRY_VERSION));
+    write(make_thread(TID));
+    write(make_pid(PID));
+    write(make_version(TRACE_ENTRY_VERSION));
+    write(make_marker(TRACE_MARKER_TYPE_FILETYPE, OFFLINE_FILE_TYPE_DEFAULT));
+    write(make_marker(TRACE_MARKER_TYPE_CACHE_LINE_SIZE, 64));
+    write(make_marker(TRACE_MARKER_TYPE_PAGE_SIZE, 4096));
+    for (int i = 0; i < NUM_INSTRS; ++i) {
+        if (i % 1000 == 0) {
+            write(make_timestamp(1000 + i));
+            write(make_marker(TRACE_MARKER_TYPE_CPU_ID, i / 1000));
+        }
+        // Include the one type the reader rewrites in place.
+        write(make_instr(0x1000 + (i % 4096) * 4,
+                         i % 7 == 0 ? TRACE_TYPE_INSTR_MAYBE_FETCH : TRACE_TYPE_INSTR));
+        write(make_memref(0x100000 + i * 8));
+    }
+    write(make_exit(TID));
+    write(make_footer());
+    CHECK(!out.fail(), "failed to write trace");
+    return true;
+}
+
+// Reads all of "path" as (type, address, instruction ordinal, record ordinal),
+// skipping "skip" instructions first.
+template <typename reader_type>
+bool
+read_records(const std::string &path, uint64_t skip,
+             std::vector<std::tuple<int, addr_t, uint64_t, uint64_t>> &records)
+{
+    reader_type reader(path);
+    reader_t &iter = reader;
+    CHECK(iter.init(), "failed to open trace");
+    if (skip > 0)
+        iter.skip_instructions(skip);
+    reader_type iter_end;
+    for (; iter != iter_end; ++iter) {
+        const memref_t &memref = *iter;
+        records.emplace_back(memref.data.type, memref.data.addr,
+                             iter.get_instruction_ordinal(), iter.get_record_ordinal());
+    }
+    return true;
+}
+
+bool
+test_reader(const std::string &path)
+{
+    for (uint64_t skip : { 0, 1, 12345, NUM_INSTRS - 1 }) {
+        std::vector<std::tuple<int, addr_t, uint64_t, uint64_t>> expect, actual;
+        if (!read_records<file_reader_t<std::ifstream *>>(path, skip, expect) ||
+            !read_records<mmap_file_reader_t>(path, skip, actual))
+            return false;
+        CHECK(!expect.empty() && expect == actual, "mapped records differ");
+    }
+    return true;
+}
+
+bool
+test_record_reader(const std::string &path)
+{
+    record_file_reader_t<std::ifstream> plain(path);
+    mmap_record_file_reader_t mapped(path);
+    CHECK(plain.init() && mapped.init(), "failed to open trace");
+    record_file_reader_t<std::ifstream> plain_end;
+    mmap_record_file_reader_t mapped_end;
+    uint64_t count = 0;
+    for (; plain != plain_end; ++plain, ++mapped, ++count) {
+        CHECK(mapped != mapped_end, "mapped records end early");
+        CHECK(memcmp(&*plain, &*mapped, sizeof(trace_entry_t)) == 0,
+              "mapped record differs");
+    }
+    CHECK(mapped == mapped_end, "mapped records end late");
+    CHECK(count > NUM_INSTRS &&
+              mapped.get_instruction_ordinal() == plain.get_instruction_ordinal(),
+          "wrong record count");
+    return true;
+}
+
+bool
+test_shared_mapping(const std::string &path)
+{
+    std::string error;
+    std::shared_ptr<const mmap_file_t> first = mmap_file_t::open(path, error);
+    std::shared_ptr<const mmap_file_t> second = mmap_file_t::open(path, error);
+    CHECK(first != nullptr && first == second, "mapping not shared");
+    // Concurrent readers of one mapping must not disturb each other, including
+    // on the records the reader rewrites.
+    std::vector<std::tuple<int, addr_t, uint64_t, uint64_t>> expect;
+    if (!read_records<mmap_file_reader_t>(path, 0, expect))
+        return false;
+    constexpr int NUM_READERS = 4;
+    std::vector<std::vector<std::tuple<int, addr_t, uint64_t, uint64_t>>> results(
+        NUM_READERS);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < NUM_READERS; ++i) {
+        threads.emplace_back([&path, &results, i]() {
+            read_records<mmap_file_reader_t>(path, 0, results[i]);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    for (const auto &result : results)
+        CHECK(result == expect, "concurrent reader differs");
+    first.reset();
+    second.reset();
+    CHECK(mmap_file_t::open("tmp_mmap_missing.trace", error) == nullptr &&
+              !error.empty(),
+          "mapped a missing file");
+    return true;
+}
+
+} // namespace
+
+int
+test_main(int argc, const char *argv[])
+{
+    const std::string path = "tmp_mmap_file_reader.trace";
+    if (!write_trace(path) || !test_reader(path) || !test_record_reader(path) ||
+        !test_shared_mapping(path))
+        return 1;
+    remove(path.c_str());
+    std::cerr << "All done!\n";
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -34,10 +34,19 @@
 
 #include "dr_api.h"
 #include "memref_gen.h"
+#include "tracer/instru.h"
+#include "tracer/module_instr_source.h"
 #include "tracer/raw2trace.h"
 #include "tracer/raw2trace_directory.h"
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#ifdef LINUX
+#    include <link.h>
+#    include <stdlib.h>
+#    include <string.h>
+#endif
 
 namespace dynamorio {
 namespace drmemtrace {
@@ -114,12 +123,19 @@ public:
     }
     raw2trace_test_t(const std::vector<std::istream *> &input,
                      const std::vector<archive_ostream_t *> &output, instrlist_t &instrs,
-                     void *drcontext, uint64_t chunk_instr_count = 10 * 1000 * 1000)
+                     void *drcontext, uint64_t chunk_instr_count = 10 * 1000 * 1000,
+                     uint64_t segment_bytes = 0)
         : raw2trace_t(nullptr, input, {}, output, INVALID_FILE, nullptr, nullptr,
                       drcontext,
                       // The sequences are small so we print everything for easier
                       // debugging and viewing of what's going on.
-                      4, /*worker_count=*/-1, /*alt_module_dir=*/"", chunk_instr_count)
+                      4,
+                      // Use several workers for segments even on a single core.
+                      /*worker_count=*/segment_bytes > 0 ? 4 : -1,
+                      /*alt_module_dir=*/"", chunk_instr_count,
+                      /*kthread_files_map=*/{}, /*kcore_path=*/"",
+                      /*kallsyms_path=*/"", /*syscall_template_file=*/nullptr,
+                      segment_bytes)
     {
         module_mapper_ = std::unique_ptr<module_mapper_t>(
             new test_module_mapper_t(&instrs, drcontext));
@@ -166,6 +182,13 @@ public:
                    rdbuf())
             ->str();
     }
+
+protected:
+    std::string
+    close_archive() override
+    {
+        return "";
+    }
 };
 
 offline_entry_t
@@ -317,7 +340,8 @@ bool
 run_raw2trace(void *drcontext, const std::vector<offline_entry_t> raw, instrlist_t *ilist,
               std::vector<trace_entry_t> &entries, std::vector<uint64_t> *stats = nullptr,
               int chunk_instr_count = 0,
-              const std::vector<test_multi_module_mapper_t::bounds_t> &modules = {})
+              const std::vector<test_multi_module_mapper_t::bounds_t> &modules = {},
+              uint64_t segment_bytes = 0)
 {
     // We need an istream so we use istringstream.
     std::ostringstream raw_out;
@@ -340,7 +364,8 @@ run_raw2trace(void *drcontext, const std::vector<offline_entry_t> raw, instrlist
 
         // Run raw2trace with our subclass supplying our decodings.
         // Pass in our chunk instr count.
-        raw2trace_test_t raw2trace(input, output, *ilist, drcontext, chunk_instr_count);
+        raw2trace_test_t raw2trace(input, output, *ilist, drcontext, chunk_instr_count,
+                                   segment_bytes);
         std::string error = raw2trace.do_conversion();
         CHECK(error.empty(), error);
         result = result_stream.str();
@@ -2881,6 +2906,224 @@ test_ifiltered(void *drcontext)
 #endif
 }
 
+instrlist_t *
+make_segment_ilist(void *drcontext)
+{
+    instrlist_t *ilist = instrlist_create(drcontext);
+    // raw2trace doesn't like offsets of 0 so we shift with a nop.
+    instrlist_append(ilist, XINST_CREATE_nop(drcontext));
+    instr_t *move1 =
+        XINST_CREATE_move(drcontext, opnd_create_reg(REG1), opnd_create_reg(REG2));
+    instrlist_append(ilist, move1);
+    instrlist_append(ilist,
+                     XINST_CREATE_store(drcontext, OPND_CREATE_MEMPTR(REG2, 0),
+                                        opnd_create_reg(REG1)));
+    instrlist_append(ilist,
+                     XINST_CREATE_move(drcontext, opnd_create_reg(REG2),
+                                       opnd_create_reg(REG1)));
+    instrlist_append(ilist, XINST_CREATE_jump(drcontext, opnd_create_instr(move1)));
+    instrlist_append(ilist,
+                     XINST_CREATE_move(drcontext, opnd_create_reg(REG1),
+                                       opnd_create_reg(REG2)));
+    return ilist;
+}
+
+/* Tests that splitting a thread into segments produces the same output. */
+bool
+test_segments(void *drcontext)
+{
+    std::cerr << "\n===============\nTesting segments\n";
+    instrlist_t *ilist = make_segment_ilist(drcontext);
+    instr_t *nop = instrlist_first(ilist);
+    instr_t *move1 = instr_get_next(nop);
+    instr_t *store = instr_get_next(move1);
+    instr_t *move2 = instr_get_next(store);
+    instr_t *jmp = instr_get_next(move2);
+    size_t offs_move1 = instr_length(drcontext, nop);
+    size_t offs_store = offs_move1 + instr_length(drcontext, move1);
+    size_t offs_move2 = offs_store + instr_length(drcontext, store);
+    size_t offs_jmp = offs_move2 + instr_length(drcontext, move2);
+    size_t offs_move3 = offs_jmp + instr_length(drcontext, jmp);
+    instrlist_clear_and_destroy(drcontext, ilist);
+
+    std::vector<offline_entry_t> raw;
+    raw.push_back(make_header());
+    raw.push_back(make_tid());
+    raw.push_back(make_pid());
+    raw.push_back(make_line_size());
+    raw.push_back(make_timestamp());
+    raw.push_back(make_core());
+    raw.push_back(make_block(offs_move1, 2));
+    raw.push_back(make_memref(42));
+    // The jmp is delayed past the next unit's header, so the state at that
+    // boundary does not match a fresh segment and the prior one is continued.
+    raw.push_back(make_block(offs_move2, 2));
+    raw.push_back(make_timestamp());
+    raw.push_back(make_core());
+    raw.push_back(make_block(offs_move1, 2));
+    raw.push_back(make_memref(42));
+    raw.push_back(make_block(offs_move2, 1));
+    raw.push_back(make_timestamp());
+    raw.push_back(make_core());
+    raw.push_back(make_block(offs_move2, 2));
+    raw.push_back(make_timestamp());
+    raw.push_back(make_core());
+    raw.push_back(make_block(offs_move1, 2));
+    raw.push_back(make_memref(42));
+    raw.push_back(make_block(offs_move3, 1));
+    // An empty unit.
+    raw.push_back(make_timestamp());
+    raw.push_back(make_core());
+    raw.push_back(make_timestamp());
+    raw.push_back(make_core());
+    raw.push_back(make_block(offs_move2, 2));
+    raw.push_back(make_timestamp());
+    raw.push_back(make_core());
+    raw.push_back(make_block(offs_move1, 2));
+    raw.push_back(make_memref(42));
+    raw.push_back(make_exit());
+
+    // Compare to the single-pass output, with small chunks to check that encodings
+    // and chunk boundaries are recomputed for the whole thread.
+    std::vector<uint64_t> stats;
+    std::vector<trace_entry_t> entries;
+    if (!run_raw2trace(drcontext, raw, make_segment_ilist(drcontext), entries, &stats,
+                       /*chunk_instr_count=*/3))
+        return false;
+    // Split at every unit, and at every few units.
+    std::vector<uint64_t> segment_sizes = { 1, 10 * sizeof(offline_entry_t) };
+    for (uint64_t segment_bytes : segment_sizes) {
+        std::vector<uint64_t> split_stats;
+        std::vector<trace_entry_t> split_entries;
+        if (!run_raw2trace(drcontext, raw, make_segment_ilist(drcontext), split_entries,
+                           &split_stats, /*chunk_instr_count=*/3, /*modules=*/{},
+                           segment_bytes))
+            return false;
+        CHECK(split_stats == stats, "segment statistics differ");
+        CHECK(split_entries.size() == entries.size(), "segment output size differs");
+        for (size_t i = 0; i < entries.size(); ++i) {
+            CHECK(split_entries[i].type == entries[i].type &&
+                      split_entries[i].size == entries[i].size &&
+                      split_entries[i].addr == entries[i].addr,
+                  "segment output differs");
+        }
+    }
+    return true;
+}
+
+#ifdef LINUX
+struct loaded_module_t {
+    app_pc pc = nullptr;
+    app_pc start = nullptr;
+    app_pc end = nullptr;
+    app_pc preferred_base = nullptr;
+};
+
+// A dl_iterate_phdr() callback that fills in the bounds of the module containing
+// the loaded_module_t's pc.
+static int
+find_loaded_module(struct dl_phdr_info *info, size_t size, void *data)
+{
+    loaded_module_t *module = reinterpret_cast<loaded_module_t *>(data);
+    ptr_uint_t min_vaddr = PTR_UINT_MINUS_1;
+    ptr_uint_t max_vaddr = 0;
+    bool contains_pc = false;
+    for (int i = 0; i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr) &phdr = info->dlpi_phdr[i];
+        if (phdr.p_type != PT_LOAD)
+            continue;
+        min_vaddr = std::min(min_vaddr, static_cast<ptr_uint_t>(phdr.p_vaddr));
+        max_vaddr =
+            std::max(max_vaddr, static_cast<ptr_uint_t>(phdr.p_vaddr + phdr.p_memsz));
+        app_pc seg_start = reinterpret_cast<app_pc>(info->dlpi_addr + phdr.p_vaddr);
+        if (module->pc >= seg_start && module->pc < seg_start + phdr.p_memsz)
+            contains_pc = true;
+    }
+    if (!contains_pc)
+        return 0;
+    ptr_uint_t page_size = dr_page_size();
+    min_vaddr &= ~(page_size - 1);
+    max_vaddr = (max_vaddr + page_size - 1) & ~(page_size - 1);
+    module->start = reinterpret_cast<app_pc>(info->dlpi_addr + min_vaddr);
+    module->end = reinterpret_cast<app_pc>(info->dlpi_addr + max_vaddr);
+    module->preferred_base = reinterpret_cast<app_pc>(min_vaddr);
+    return 1;
+}
+
+/* Tests that module_instr_source_t decodes the same instructions from a fresh
+ * mapping of this test binary as are loaded in this process.
+ */
+bool
+test_module_instr_source(void *drcontext)
+{
+    std::cerr << "\n===============\nTesting module_instr_source_t\n";
+    loaded_module_t module;
+    module.pc = reinterpret_cast<app_pc>(&test_module_instr_source);
+    if (dl_iterate_phdr(find_loaded_module, &module) == 0) {
+        std::cerr << "Failed to find the test binary\n";
+        return false;
+    }
+    char exe_path[MAXIMUM_PATH];
+    if (realpath("/proc/self/exe", exe_path) == nullptr) {
+        std::cerr << "Failed to find the test binary path\n";
+        return false;
+    }
+    // Write a module file listing just this binary where it is loaded now.
+    const std::string module_file_path = "tmp_module_instr_source_modules.log";
+    {
+        char line[MAXIMUM_PATH * 2];
+        dr_snprintf(line, sizeof(line),
+                    "  0,   0, " PFX ", " PFX ", " PFX ", %016x, " PFX ", v#%d,0, %s\n",
+                    module.start, module.end, module.start, 0, module.preferred_base,
+                    CUSTOM_MODULE_VERSION, exe_path);
+        line[sizeof(line) - 1] = '\0';
+        std::ofstream module_file(module_file_path);
+        module_file << "Module Table: version 5, count 1\n"
+                    << "Columns: id, containing_id, start, end, entry, offset, "
+                    << "preferred_base, (custom fields), path\n"
+                    << line;
+    }
+    module_instr_source_t source(module_file_path);
+    std::string error = source.initialize();
+    if (!error.empty()) {
+        std::cerr << "Failed to load the test binary: " << error << "\n";
+        return false;
+    }
+    // Follow the path from the start of this function for a few instructions.
+    addr_t pc = reinterpret_cast<addr_t>(module.pc);
+    for (int i = 0; i < 8; ++i) {
+        speculated_instr_t instr;
+        error = source.get_instr(pc, instr);
+        if (!error.empty()) {
+            std::cerr << "Failed to decode " << to_hex_string(pc) << ": " << error
+                      << "\n";
+            return false;
+        }
+        app_pc live_pc = reinterpret_cast<app_pc>(pc);
+        instr_t live;
+        instr_init(drcontext, &live);
+        app_pc next_pc = decode(drcontext, live_pc, &live);
+        bool match = next_pc != nullptr &&
+            instr.size == static_cast<size_t>(next_pc - live_pc) &&
+            memcmp(instr.encoding, live_pc, instr.size) == 0 &&
+            instr.type == instru_t::instr_to_instr_type(&live);
+        instr_free(drcontext, &live);
+        if (!match) {
+            std::cerr << "Mismatch at " << to_hex_string(pc) << "\n";
+            return false;
+        }
+        pc = instr.next_pc;
+    }
+    // Addresses outside of any module are not available.
+    speculated_instr_t instr;
+    if (source.get_instr(reinterpret_cast<addr_t>(module.end) + 1, instr).empty()) {
+        std::cerr << "Expected an error for an address outside the module\n";
+        return false;
+    }
+    return true;
+}
+#endif
+
 int
 test_main(int argc, const char *argv[])
 {
@@ -2899,8 +3142,13 @@ test_main(int argc, const char *argv[])
         !test_midrseq_end(drcontext) || !test_xfer_modoffs(drcontext) ||
         !test_xfer_absolute(drcontext) || !test_branch_decoration(drcontext) ||
         !test_stats_timestamp_instr_count(drcontext) ||
-        !test_is_maybe_blocking_syscall(drcontext) || !test_ifiltered(drcontext))
+        !test_is_maybe_blocking_syscall(drcontext) || !test_ifiltered(drcontext) ||
+        !test_segments(drcontext))
         return 1;
+#ifdef LINUX
+    if (!test_module_instr_source(drcontext))
+        return 1;
+#endif
     return 0;
 }
 
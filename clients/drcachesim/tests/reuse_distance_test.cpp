@@ -30,7 +30,12 @@
  * DAMAGE.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #undef NDEBUG
 #include <assert.h>
 
@@ -507,6 +512,185 @@ data_histogram_test()
     }
 }
 
+// Test the distances and per-line counts against a brute-force LRU stack, over
+// enough lines and references to exercise the tree compaction, with and without
+// a distance limit.
+void
+brute_force_distance_test()
+{
+    std::cerr << "brute_force_distance_test()\n";
+
+    constexpr uint32_t LINE_SIZE = 64;
+    constexpr uint32_t DISTANCE_THRESHOLD = 40;
+    constexpr int NUM_REFS = 40000;
+
+    for (unsigned int distance_limit : { 0, 700 }) {
+        reuse_distance_knobs_t knobs;
+        knobs.line_size = LINE_SIZE;
+        knobs.distance_threshold = DISTANCE_THRESHOLD;
+        knobs.distance_limit = distance_limit;
+        knobs.verify_skip = true;
+        reuse_distance_test_t reuse_distance(knobs);
+
+        // The most recently referenced line is at the front.
+        std::vector<addr_t> stack;
+        struct counts_t {
+            uint64_t total_refs = 0;
+            uint64_t distant_refs = 0;
+        };
+        std::unordered_map<addr_t, counts_t> expected_counts;
+        reuse_distance_t::distance_histogram_t expected_hist;
+        uint64_t expected_unique_accesses = 0;
+        int64_t expected_pruned = 0;
+        uint64_t seed = 42;
+        for (int i = 0; i < NUM_REFS; ++i) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            // Mix a hot set with a growing cold set so distances span a wide range.
+            addr_t line = (seed >> 40) % 4 == 0 ? (seed >> 20) % (1 + i / 8)
+                                                : (seed >> 20) % 64;
+            assert(reuse_distance.process_memref(generate_memref(line * LINE_SIZE)));
+            auto it = std::find(stack.begin(), stack.end(), line);
+            if (it == stack.end()) {
+                stack.insert(stack.begin(), line);
+                expected_counts[line] = counts_t();
+                expected_counts[line].total_refs = 1;
+                ++expected_unique_accesses;
+                if (distance_limit > 0 && stack.size() > distance_limit) {
+                    expected_counts.erase(stack.back());
+                    stack.pop_back();
+                    ++expected_pruned;
+                }
+                continue;
+            }
+            int64_t dist = it - stack.begin();
+            ++expected_counts[line].total_refs;
+            ++expected_hist[dist];
+            // A reference to the most recent line is not a unique access.
+            if (dist == 0)
+                continue;
+            if (dist > DISTANCE_THRESHOLD)
+                ++expected_counts[line].distant_refs;
+            ++expected_unique_accesses;
+            stack.erase(it);
+            stack.insert(stack.begin(), line);
+        }
+        auto *shard = reuse_distance.get_aggregated_results();
+        assert(shard->dist_map == expected_hist);
+        assert(shard->ref_tree->cur_time_ == expected_unique_accesses);
+        assert(static_cast<int64_t>(shard->pruned_address_count) == expected_pruned);
+        assert(shard->cache_map.size() == expected_counts.size());
+        for (const auto &entry : shard->cache_map) {
+            const counts_t &expected = expected_counts.at(entry.first);
+            assert(entry.second->total_refs == expected.total_refs);
+            assert(entry.second->distant_refs == expected.distant_refs);
+        }
+    }
+}
+
+// Returns the mean and the total count of a scaled histogram.
+static std::pair<double, int64_t>
+histogram_mean(const reuse_distance_t::distance_histogram_t &hist)
+{
+    double sum = 0.;
+    int64_t count = 0;
+    for (const auto &entry : hist) {
+        sum += static_cast<double>(entry.first) * entry.second;
+        count += entry.second;
+    }
+    return std::make_pair(sum / count, count);
+}
+
+void
+sampled_distance_test()
+{
+    std::cerr << "sampled_distance_test()\n";
+
+    // Scan a set of lines repeatedly, so every reuse is at distance NUM_LINES - 1.
+    constexpr uint32_t LINE_SIZE = 64;
+    constexpr int NUM_LINES = 4096;
+    constexpr int NUM_ROUNDS = 20;
+    constexpr int64_t EXPECTED_REUSES = NUM_LINES * (NUM_ROUNDS - 1);
+    constexpr double EXPECTED_DIST = NUM_LINES - 1;
+
+    // Sample about 1 in 8 lines.
+    {
+        reuse_distance_knobs_t knobs;
+        knobs.line_size = LINE_SIZE;
+        knobs.sample_rate = 0.125;
+        reuse_distance_test_t reuse_distance(knobs);
+        for (int round = 0; round < NUM_ROUNDS; ++round) {
+            for (int line = 0; line < NUM_LINES; ++line) {
+                assert(reuse_distance.process_memref(
+                    generate_memref(static_cast<addr_t>(line) * LINE_SIZE)));
+            }
+        }
+        auto *shard = reuse_distance.get_aggregated_results();
+        assert(shard->sampler.active());
+        assert(shard->sampler.weight() == 8);
+        // Distances and counts are scaled by the weight.
+        for (const auto &entry : shard->dist_map)
+            assert(entry.first % 8 == 0 && entry.second % 8 == 0);
+        std::pair<double, int64_t> mean_count = histogram_mean(shard->dist_map);
+        assert(std::abs(mean_count.first - EXPECTED_DIST) < EXPECTED_DIST * 0.1);
+        assert(std::abs(mean_count.second - EXPECTED_REUSES) < EXPECTED_REUSES * 0.1);
+        assert(shard->cache_map.size() > NUM_LINES / 8 * 3 / 4 &&
+               shard->cache_map.size() < NUM_LINES / 8 * 5 / 4);
+    }
+
+    // Distant references compare scaled distances with the threshold, including
+    // thresholds below the weight.  Each line is referenced twice in a row, and
+    // only the first of the two is a reuse across the scan.
+    for (unsigned int threshold : { 10, 5000 }) {
+        reuse_distance_knobs_t knobs;
+        knobs.line_size = LINE_SIZE;
+        knobs.sample_rate = 1. / 16;
+        knobs.distance_threshold = threshold;
+        reuse_distance_test_t reuse_distance(knobs);
+        for (int round = 0; round < NUM_ROUNDS; ++round) {
+            for (int line = 0; line < NUM_LINES; ++line) {
+                for (int repeat = 0; repeat < 2; ++repeat) {
+                    assert(reuse_distance.process_memref(
+                        generate_memref(static_cast<addr_t>(line) * LINE_SIZE)));
+                }
+            }
+        }
+        auto *shard = reuse_distance.get_aggregated_results();
+        assert(shard->sampler.weight() == 16);
+        assert(shard->cache_map.size() > 0);
+        for (const auto &entry : shard->cache_map) {
+            assert(entry.second->total_refs == 2 * NUM_ROUNDS);
+            assert(entry.second->distant_refs ==
+                   (threshold < EXPECTED_DIST ? NUM_ROUNDS - 1 : 0));
+        }
+        // The repeats are known to be at distance 0.
+        assert(shard->dist_map.at(0) ==
+               static_cast<int64_t>(16 * shard->cache_map.size() * NUM_ROUNDS));
+    }
+
+    // Start with no sampling but a budget of tracked lines.
+    {
+        constexpr unsigned int MAX_LINES = 300;
+        reuse_distance_knobs_t knobs;
+        knobs.line_size = LINE_SIZE;
+        knobs.sample_max_lines = MAX_LINES;
+        reuse_distance_test_t reuse_distance(knobs);
+        for (int round = 0; round < NUM_ROUNDS; ++round) {
+            for (int line = 0; line < NUM_LINES; ++line) {
+                assert(reuse_distance.process_memref(
+                    generate_memref(static_cast<addr_t>(line) * LINE_SIZE)));
+                for (const auto &entry : reuse_distance.get_shard_map())
+                    assert(entry.second->cache_map.size() <= MAX_LINES);
+            }
+        }
+        auto *shard = reuse_distance.get_aggregated_results();
+        // The rate must have gone down to about MAX_LINES / NUM_LINES.
+        assert(shard->sampler.weight() >= 8 && shard->sampler.weight() <= 32);
+        std::pair<double, int64_t> mean_count = histogram_mean(shard->dist_map);
+        assert(std::abs(mean_count.first - EXPECTED_DIST) < EXPECTED_DIST * 0.15);
+        assert(std::abs(mean_count.second - EXPECTED_REUSES) < EXPECTED_REUSES * 0.15);
+    }
+}
+
 int
 test_main(int argc, const char *argv[])
 {
@@ -516,6 +700,8 @@ test_main(int argc, const char *argv[])
     simple_reuse_distance_test();
     reuse_distance_limit_test();
     data_histogram_test();
+    brute_force_distance_test();
+    sampled_distance_test();
     return 0;
 }
 
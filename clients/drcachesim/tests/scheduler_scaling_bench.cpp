@@ -0,0 +1,171 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/*
+ * Scaling benchmark for the scheduler's MAP_TO_ANY_OUTPUT ready queues.  Runs one
+ * thread per output, from 1 up to 128 outputs, over synthetic inputs with both
+ * the single global ready queue and the sharded per-output queues, and reports
+ * the record throughput of each.  Takes an optional per-input instruction count
+ * as its only argument.
+ */
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "memref.h"
+#include "mock_reader.h"
+#include "scheduler.h"
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+namespace {
+
+constexpr int DEFAULT_INSTRS = 20000;
+constexpr int INPUTS_PER_OUTPUT = 4;
+constexpr int MAX_OUTPUTS = 128;
+constexpr uint64_t QUANTUM = 500;
+
+trace_entry_t
+make_entry(unsigned short type, unsigned short size, addr_t addr)
+{
+    trace_entry_t entry;
+    entry.type = type;
+    entry.size = size;
+    entry.addr = addr;
+    return entry;
+}
+
+// Returns the number of records delivered, or -1 on error.
+int64_t
+bench_scheduler(int num_outputs, bool sharded, int num_instrs)
+{
+    std::vector<scheduler_t::input_reader_t> readers;
+    for (int i = 0; i < num_outputs * INPUTS_PER_OUTPUT; ++i) {
+        memref_tid_t tid = i + 1;
+        std::vector<trace_entry_t> entries;
+        entries.push_back(make_entry(TRACE_TYPE_THREAD, sizeof(int), tid));
+        entries.push_back(make_entry(TRACE_TYPE_PID, sizeof(int), 1));
+        for (int j = 0; j < num_instrs; ++j)
+            entries.push_back(make_entry(TRACE_TYPE_INSTR, 4, 42 + j * 4));
+        entries.push_back(make_entry(TRACE_TYPE_THREAD_EXIT, sizeof(int), tid));
+        readers.emplace_back(std::unique_ptr<mock_reader_t>(new mock_reader_t(entries)),
+                             std::unique_ptr<mock_reader_t>(new mock_reader_t()), tid);
+    }
+    std::vector<scheduler_t::input_workload_t> sched_inputs;
+    sched_inputs.emplace_back(std::move(readers));
+    scheduler_t::scheduler_options_t sched_ops(scheduler_t::MAP_TO_ANY_OUTPUT,
+                                               scheduler_t::DEPENDENCY_IGNORE,
+                                               scheduler_t::SCHEDULER_DEFAULTS);
+    sched_ops.quantum_duration = QUANTUM;
+    sched_ops.sharded_runqueues = sharded;
+    scheduler_t scheduler;
+    if (scheduler.init(sched_inputs, num_outputs, std::move(sched_ops)) !=
+        scheduler_t::STATUS_SUCCESS) {
+        std::cerr << "Failed to initialize the scheduler: "
+                  << scheduler.get_error_string() << "\n";
+        return -1;
+    }
+    std::atomic<int64_t> records(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+    threads.reserve(num_outputs);
+    for (int i = 0; i < num_outputs; ++i) {
+        threads.emplace_back([&, i]() {
+            scheduler_t::stream_t *stream = scheduler.get_stream(i);
+            int64_t count = 0;
+            memref_t record;
+            for (scheduler_t::stream_status_t status = stream->next_record(record);
+                 status != scheduler_t::STATUS_EOF;
+                 status = stream->next_record(record)) {
+                if (status == scheduler_t::STATUS_WAIT ||
+                    status == scheduler_t::STATUS_IDLE) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (status != scheduler_t::STATUS_OK) {
+                    failed = true;
+                    break;
+                }
+                ++count;
+            }
+            records += count;
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    if (failed)
+        return -1;
+    return records;
+}
+
+} // namespace
+
+int
+test_main(int argc, const char *argv[])
+{
+    int num_instrs = DEFAULT_INSTRS;
+    if (argc > 1)
+        num_instrs = atoi(argv[1]);
+    for (int num_outputs = 1; num_outputs <= MAX_OUTPUTS; num_outputs *= 2) {
+        for (bool sharded : { false, true }) {
+            auto start = std::chrono::steady_clock::now();
+            int64_t records = bench_scheduler(num_outputs, sharded, num_instrs);
+            double secs =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                    .count();
+            int64_t expected = static_cast<int64_t>(num_outputs) * INPUTS_PER_OUTPUT *
+                (num_instrs + 1 /*exit*/);
+            if (records != expected) {
+                std::cerr << "Expected " << expected << " records but got " << records
+                          << "\n";
+                return 1;
+            }
+            std::cerr << num_outputs << " outputs, "
+                      << (sharded ? "sharded queues" : "global queue") << ": " << records
+                      << " records in " << secs << "s = "
+                      << static_cast<double>(records) / secs / 1e6 << "M records/s\n";
+        }
+    }
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
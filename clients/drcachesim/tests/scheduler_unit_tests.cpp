@@ -2224,6 +2224,159 @@ test_speculation()
     assert(ordinal == 17);
 }
 
+// Supplies a single direct jump for test_speculation_from_trace().
+class test_binary_source_t : public binary_instr_source_t {
+public:
+    static constexpr addr_t JUMP_PC = 0x80;
+    static constexpr addr_t JUMP_TARGET = 0x10;
+    std::string
+    get_instr(addr_t pc, speculated_instr_t &instr) override
+    {
+        if (pc != JUMP_PC)
+            return "Not in a binary";
+        instr.type = TRACE_TYPE_INSTR_DIRECT_JUMP;
+        instr.size = 2;
+        instr.next_pc = JUMP_TARGET;
+        return "";
+    }
+};
+
+// Runs a small loop trace, speculates from "start_pc" for "count" records once
+// the trace reaches pc 0x17, and returns the speculated records.
+static std::vector<memref_t>
+run_speculation_from_trace(scheduler_t::scheduler_flags_t flags, addr_t start_pc,
+                           int count, binary_instr_source_t *binary_source = nullptr)
+{
+    static constexpr memref_tid_t TID_A = 42;
+    std::vector<trace_entry_t> memrefs = {
+        /* clang-format off */
+        make_thread(TID_A),
+        make_pid(1),
+        make_marker(TRACE_MARKER_TYPE_PAGE_SIZE, 4096),
+        make_timestamp(10),
+        make_instr(0x10, TRACE_TYPE_INSTR, 4),
+        make_memref(0x1000, TRACE_TYPE_READ, 8),
+        make_instr(0x14, TRACE_TYPE_INSTR_CONDITIONAL_JUMP, 2),
+        // Taken the first time.
+        make_instr(0x40, TRACE_TYPE_INSTR, 3),
+        make_memref(0x2000, TRACE_TYPE_WRITE, 4),
+        make_instr(0x10, TRACE_TYPE_INSTR, 4),
+        make_memref(0x1010, TRACE_TYPE_READ, 8),
+        make_instr(0x14, TRACE_TYPE_INSTR_CONDITIONAL_JUMP, 2),
+        // Not taken the second time.
+        make_instr(0x16, TRACE_TYPE_INSTR, 1),
+        make_instr(0x17, TRACE_TYPE_INSTR, 1),
+        make_exit(TID_A),
+        /* clang-format on */
+    };
+    std::vector<scheduler_t::input_reader_t> readers;
+    readers.emplace_back(std::unique_ptr<mock_reader_t>(new mock_reader_t(memrefs)),
+                         std::unique_ptr<mock_reader_t>(new mock_reader_t()), TID_A);
+    scheduler_t scheduler;
+    std::vector<scheduler_t::input_workload_t> sched_inputs;
+    sched_inputs.emplace_back(std::move(readers));
+    scheduler_t::scheduler_options_t sched_ops =
+        scheduler_t::make_scheduler_serial_options(/*verbosity=*/4);
+    sched_ops.flags = static_cast<scheduler_t::scheduler_flags_t>(
+        static_cast<int>(sched_ops.flags) | static_cast<int>(flags));
+    sched_ops.speculation_binary_source = binary_source;
+    if (scheduler.init(sched_inputs, 1, std::move(sched_ops)) !=
+        scheduler_t::STATUS_SUCCESS)
+        assert(false);
+    std::vector<memref_t> speculated;
+    bool speculating = false;
+    auto *stream = scheduler.get_stream(0);
+    memref_t memref;
+    for (scheduler_t::stream_status_t status = stream->next_record(memref);
+         status != scheduler_t::STATUS_EOF; status = stream->next_record(memref)) {
+        assert(status == scheduler_t::STATUS_OK);
+        if (speculating) {
+            speculated.push_back(memref);
+            if (static_cast<int>(speculated.size()) == count) {
+                stream->stop_speculation();
+                speculating = false;
+            }
+        } else if (speculated.empty() && type_is_instr(memref.instr.type) &&
+                   memref.instr.addr == 0x17) {
+            stream->start_speculation(start_pc, false);
+            speculating = true;
+        }
+    }
+    return speculated;
+}
+
+static void
+test_speculation_from_trace()
+{
+    std::cerr << "\n----------------\nTesting speculation from trace\n";
+    {
+        // The last-seen instructions, addresses, and directions are replayed until
+        // we reach a PC not in the history.
+        std::vector<memref_t> spec =
+            run_speculation_from_trace(scheduler_t::SCHEDULER_SPECULATE_LAST_FROM_TRACE,
+                                       0x10, 6);
+        assert(spec.size() == 6);
+        assert(spec[0].instr.type == TRACE_TYPE_INSTR && spec[0].instr.addr == 0x10 &&
+               spec[0].instr.size == 4);
+        assert(spec[1].data.type == TRACE_TYPE_READ && spec[1].data.addr == 0x1010 &&
+               spec[1].data.size == 8 && spec[1].data.pc == 0x10);
+        assert(spec[2].instr.type == TRACE_TYPE_INSTR_CONDITIONAL_JUMP &&
+               spec[2].instr.addr == 0x14);
+        // The branch was last not taken.
+        assert(spec[3].instr.addr == 0x16 && spec[3].instr.size == 1);
+        assert(spec[4].instr.addr == 0x17);
+        assert(spec[5].instr.addr == 0x18 && memref_is_nop_instr(spec[5]));
+    }
+    {
+        // The taken path has a store and goes back to the loop head.
+        std::vector<memref_t> spec =
+            run_speculation_from_trace(scheduler_t::SCHEDULER_SPECULATE_LAST_FROM_TRACE,
+                                       0x40, 3);
+        assert(spec.size() == 3);
+        assert(spec[0].instr.addr == 0x40 && spec[0].instr.size == 3);
+        assert(spec[1].data.type == TRACE_TYPE_WRITE && spec[1].data.addr == 0x2000);
+        assert(spec[2].instr.addr == 0x10);
+    }
+    {
+        // Averaging weights the newer 0x1010 above the older 0x1000 and keeps the
+        // 8-byte alignment.
+        std::vector<memref_t> spec = run_speculation_from_trace(
+            scheduler_t::SCHEDULER_SPECULATE_AVERAGE_FROM_TRACE, 0x10, 2);
+        assert(spec.size() == 2);
+        assert(spec[1].data.type == TRACE_TYPE_READ && spec[1].data.addr == 0x1008);
+    }
+    {
+        // The binary supplies what the history lacks.
+        test_binary_source_t binary;
+        std::vector<memref_t> spec = run_speculation_from_trace(
+            static_cast<scheduler_t::scheduler_flags_t>(
+                scheduler_t::SCHEDULER_SPECULATE_LAST_FROM_TRACE |
+                scheduler_t::SCHEDULER_SPECULATE_FROM_BINARY),
+            test_binary_source_t::JUMP_PC, 3, &binary);
+        assert(spec.size() == 3);
+        assert(spec[0].instr.type == TRACE_TYPE_INSTR_DIRECT_JUMP &&
+               spec[0].instr.addr == test_binary_source_t::JUMP_PC);
+        assert(spec[1].instr.addr == test_binary_source_t::JUMP_TARGET);
+        assert(spec[2].data.type == TRACE_TYPE_READ);
+    }
+    {
+        // FROM_BINARY requires a source.
+        std::vector<scheduler_t::input_reader_t> readers;
+        readers.emplace_back(
+            std::unique_ptr<mock_reader_t>(new mock_reader_t({ make_thread(1) })),
+            std::unique_ptr<mock_reader_t>(new mock_reader_t()), 1);
+        std::vector<scheduler_t::input_workload_t> sched_inputs;
+        sched_inputs.emplace_back(std::move(readers));
+        scheduler_t::scheduler_options_t sched_ops =
+            scheduler_t::make_scheduler_serial_options();
+        sched_ops.flags = scheduler_t::SCHEDULER_SPECULATE_FROM_BINARY;
+        scheduler_t scheduler;
+        if (scheduler.init(sched_inputs, 1, std::move(sched_ops)) !=
+            scheduler_t::STATUS_ERROR_INVALID_PARAMETER)
+            assert(false);
+    }
+}
+
 static void
 test_replay()
 {
@@ -3796,6 +3949,191 @@ test_kernel_switch_sequences()
     }
 }
 
+static std::vector<scheduler_t::input_reader_t>
+make_sharded_test_readers(memref_tid_t tid_base, const std::vector<int> &instr_counts)
+{
+    std::vector<scheduler_t::input_reader_t> readers;
+    for (size_t i = 0; i < instr_counts.size(); ++i) {
+        memref_tid_t tid = tid_base + i;
+        std::vector<trace_entry_t> inputs;
+        inputs.push_back(make_thread(tid));
+        inputs.push_back(make_pid(1));
+        for (int instr_idx = 0; instr_idx < instr_counts[i]; ++instr_idx)
+            inputs.push_back(make_instr(42 + instr_idx * 4));
+        inputs.push_back(make_exit(tid));
+        readers.emplace_back(std::unique_ptr<mock_reader_t>(new mock_reader_t(inputs)),
+                             std::unique_ptr<mock_reader_t>(new mock_reader_t()), tid);
+    }
+    return readers;
+}
+
+static void
+test_sharded_runqueues()
+{
+    std::cerr << "\n----------------\nTesting sharded runqueues\n";
+    static constexpr memref_tid_t TID_BASE = 100;
+    {
+        // With one output the sharded queue must behave exactly like the global one.
+        static constexpr int NUM_OUTPUTS = 1;
+        std::vector<std::string> schedules;
+        for (bool sharded : { false, true }) {
+            std::vector<scheduler_t::input_workload_t> sched_inputs;
+            sched_inputs.emplace_back(
+                make_sharded_test_readers(TID_BASE, { 7, 3, 9, 5 }));
+            sched_inputs.back().thread_modifiers.emplace_back(TID_BASE + 2,
+                                                              /*priority=*/1);
+            scheduler_t::scheduler_options_t sched_ops(
+                scheduler_t::MAP_TO_ANY_OUTPUT, scheduler_t::DEPENDENCY_IGNORE,
+                scheduler_t::SCHEDULER_DEFAULTS, /*verbosity=*/3);
+            sched_ops.quantum_duration = 2;
+            sched_ops.sharded_runqueues = sharded;
+            scheduler_t scheduler;
+            if (scheduler.init(sched_inputs, NUM_OUTPUTS, std::move(sched_ops)) !=
+                scheduler_t::STATUS_SUCCESS)
+                assert(false);
+            std::vector<std::string> sched_as_string =
+                run_lockstep_simulation(scheduler, NUM_OUTPUTS, TID_BASE);
+            std::cerr << "sharded=" << sharded << " schedule: " << sched_as_string[0]
+                      << "\n";
+            schedules.push_back(sched_as_string[0]);
+        }
+        assert(schedules[0] == schedules[1]);
+        // The high-priority C runs to completion once it is picked.
+        assert(schedules[0].find("CCCCCCCCC") != std::string::npos);
+    }
+    {
+        // Outputs whose own queue runs dry steal from the others.  Inputs are
+        // dealt round-robin, so all the long inputs start on output 0.
+        static constexpr int NUM_OUTPUTS = 2;
+        static const std::vector<int> COUNTS = { 30, 1, 30, 1, 30, 1 };
+        std::vector<scheduler_t::input_workload_t> sched_inputs;
+        sched_inputs.emplace_back(make_sharded_test_readers(TID_BASE, COUNTS));
+        scheduler_t::scheduler_options_t sched_ops(scheduler_t::MAP_TO_ANY_OUTPUT,
+                                                   scheduler_t::DEPENDENCY_IGNORE,
+                                                   scheduler_t::SCHEDULER_DEFAULTS,
+                                                   /*verbosity=*/3);
+        sched_ops.quantum_duration = 3;
+        sched_ops.sharded_runqueues = true;
+        scheduler_t scheduler;
+        if (scheduler.init(sched_inputs, NUM_OUTPUTS, std::move(sched_ops)) !=
+            scheduler_t::STATUS_SUCCESS)
+            assert(false);
+        std::vector<std::string> sched_as_string =
+            run_lockstep_simulation(scheduler, NUM_OUTPUTS, TID_BASE);
+        std::vector<int> seen(COUNTS.size());
+        for (int i = 0; i < NUM_OUTPUTS; i++) {
+            std::cerr << "cpu #" << i << " schedule: " << sched_as_string[i] << "\n";
+            for (char c : sched_as_string[i]) {
+                if (c >= 'A' && c < 'A' + static_cast<char>(COUNTS.size()))
+                    ++seen[c - 'A'];
+            }
+        }
+        assert(seen == COUNTS);
+        int64_t steals = 0, migrations = 0;
+        for (int i = 0; i < NUM_OUTPUTS; i++) {
+            memtrace_stream_t *stream = scheduler.get_stream(i);
+            steals += stream->get_schedule_statistic(
+                memtrace_stream_t::SCHED_STAT_RUNQUEUE_STEALS);
+            migrations +=
+                stream->get_schedule_statistic(memtrace_stream_t::SCHED_STAT_MIGRATIONS);
+        }
+        assert(steals > 0);
+        assert(migrations > 0);
+    }
+    {
+        // Bindings are honored across stealing and rebalancing.
+        static constexpr int NUM_OUTPUTS = 4;
+        static constexpr int NUM_INPUTS = 12;
+        std::vector<scheduler_t::input_workload_t> sched_inputs;
+        sched_inputs.emplace_back(
+            make_sharded_test_readers(TID_BASE, std::vector<int>(NUM_INPUTS, 20)));
+        // Without timestamps the first NUM_OUTPUTS inputs are placed without regard
+        // to bindings, so we bind some of the others.
+        for (int i = NUM_OUTPUTS; i < NUM_INPUTS; i += 3) {
+            std::set<scheduler_t::output_ordinal_t> cores = { i % NUM_OUTPUTS };
+            sched_inputs.back().thread_modifiers.emplace_back(cores);
+            sched_inputs.back().thread_modifiers.back().tids.push_back(TID_BASE + i);
+        }
+        scheduler_t::scheduler_options_t sched_ops(scheduler_t::MAP_TO_ANY_OUTPUT,
+                                                   scheduler_t::DEPENDENCY_IGNORE,
+                                                   scheduler_t::SCHEDULER_DEFAULTS,
+                                                   /*verbosity=*/3);
+        sched_ops.quantum_duration = 4;
+        sched_ops.sharded_runqueues = true;
+        sched_ops.rebalance_period = 10;
+        scheduler_t scheduler;
+        if (scheduler.init(sched_inputs, NUM_OUTPUTS, std::move(sched_ops)) !=
+            scheduler_t::STATUS_SUCCESS)
+            assert(false);
+        std::vector<std::string> sched_as_string =
+            run_lockstep_simulation(scheduler, NUM_OUTPUTS, TID_BASE, /*send_time=*/true);
+        int total = 0;
+        int64_t rebalances = 0;
+        for (int i = 0; i < NUM_OUTPUTS; i++) {
+            std::cerr << "cpu #" << i << " schedule: " << sched_as_string[i] << "\n";
+            for (char c : sched_as_string[i]) {
+                if (c < 'A' || c >= 'A' + NUM_INPUTS)
+                    continue;
+                ++total;
+                int input = c - 'A';
+                if (input >= NUM_OUTPUTS && (input - NUM_OUTPUTS) % 3 == 0)
+                    assert(input % NUM_OUTPUTS == i);
+            }
+            rebalances += scheduler.get_stream(i)->get_schedule_statistic(
+                memtrace_stream_t::SCHED_STAT_RUNQUEUE_REBALANCES);
+        }
+        assert(total == NUM_INPUTS * 20);
+        assert(rebalances > 0);
+    }
+    {
+        // Stress the per-queue locks with real threads.
+        static constexpr int NUM_OUTPUTS = 8;
+        static constexpr int NUM_INPUTS = 64;
+        static constexpr int NUM_INSTRS = 200;
+        std::vector<scheduler_t::input_workload_t> sched_inputs;
+        sched_inputs.emplace_back(make_sharded_test_readers(
+            TID_BASE, std::vector<int>(NUM_INPUTS, NUM_INSTRS)));
+        scheduler_t::scheduler_options_t sched_ops(scheduler_t::MAP_TO_ANY_OUTPUT,
+                                                   scheduler_t::DEPENDENCY_IGNORE,
+                                                   scheduler_t::SCHEDULER_DEFAULTS,
+                                                   /*verbosity=*/1);
+        sched_ops.quantum_duration = 7;
+        sched_ops.sharded_runqueues = true;
+        sched_ops.rebalance_period = 100;
+        scheduler_t scheduler;
+        if (scheduler.init(sched_inputs, NUM_OUTPUTS, std::move(sched_ops)) !=
+            scheduler_t::STATUS_SUCCESS)
+            assert(false);
+        std::vector<int64_t> instrs(NUM_OUTPUTS);
+        std::vector<std::thread> threads;
+        threads.reserve(NUM_OUTPUTS);
+        for (int i = 0; i < NUM_OUTPUTS; ++i) {
+            threads.emplace_back([&scheduler, &instrs, i]() {
+                scheduler_t::stream_t *stream = scheduler.get_stream(i);
+                memref_t record;
+                for (scheduler_t::stream_status_t status = stream->next_record(record);
+                     status != scheduler_t::STATUS_EOF;
+                     status = stream->next_record(record)) {
+                    if (status == scheduler_t::STATUS_WAIT ||
+                        status == scheduler_t::STATUS_IDLE) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    assert(status == scheduler_t::STATUS_OK);
+                    if (type_is_instr(record.instr.type))
+                        ++instrs[i];
+                }
+            });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        int64_t total = 0;
+        for (int64_t count : instrs)
+            total += count;
+        assert(total == NUM_INPUTS * NUM_INSTRS);
+    }
+}
+
 int
 test_main(int argc, const char *argv[])
 {
@@ -3819,6 +4157,7 @@ test_main(int argc, const char *argv[])
     test_synthetic_with_syscalls();
     test_synthetic_multi_threaded(argv[1]);
     test_speculation();
+    test_speculation_from_trace();
     test_replay();
     test_replay_multi_threaded(argv[1]);
     test_replay_timestamps();
@@ -3831,6 +4170,7 @@ test_main(int argc, const char *argv[])
     test_inactive();
     test_direct_switch();
     test_kernel_switch_sequences();
+    test_sharded_runqueues();
 
     dr_standalone_exit();
     return 0;
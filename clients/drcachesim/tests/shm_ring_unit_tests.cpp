@@ -0,0 +1,141 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Unit tests for the shared-memory ring used by -ipc_ring_size. */
+
+#include "shm_ring.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+
+namespace dynamorio {
+namespace drmemtrace {
+namespace {
+
+#define CHECK(cond, msg, ...)             \
+    do {                                  \
+        if (!(cond)) {                    \
+            fprintf(stderr, "%s\n", msg); \
+            return false;                 \
+        }                                 \
+    } while (0)
+
+constexpr size_t CAPACITY = 4096;
+constexpr size_t VALUES_PER_WRITE = 64;
+// Enough to wrap around the ring several times.
+constexpr uint64_t NUM_VALUES = 4096;
+
+// Runs in a child process: writes 0..NUM_VALUES-1 and then either detaches or
+// dies without detaching.
+void
+run_writer(const std::string &name, bool die)
+{
+    shm_ring_t ring(name.c_str());
+    int fd = open(ring.get_path().c_str(), O_RDWR);
+    if (fd < 0)
+        _exit(1);
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        _exit(1);
+    void *map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED || !ring.attach(map, st.st_size) || !ring.add_writer())
+        _exit(1);
+    uint64_t buf[VALUES_PER_WRITE];
+    for (uint64_t i = 0; i < NUM_VALUES; i += VALUES_PER_WRITE) {
+        for (size_t j = 0; j < VALUES_PER_WRITE; ++j)
+            buf[j] = i + j;
+        if (ring.write(buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf)))
+            _exit(1);
+    }
+    if (die)
+        raise(SIGKILL);
+    ring.detach();
+    _exit(0);
+}
+
+bool
+test_writer(bool die)
+{
+    std::string name = "drmemtrace_shm_ring_test." + std::to_string(getpid());
+    shm_ring_t ring(name.c_str());
+    CHECK(ring.create(CAPACITY, sizeof(uint64_t)), "failed to create ring");
+    pid_t child = fork();
+    if (child == 0)
+        run_writer(name, die);
+    CHECK(child > 0, "fork failed");
+    CHECK(ring.wait_for_writer(), "no writer");
+    uint64_t expect = 0;
+    while (true) {
+        void *data;
+        size_t sz = ring.acquire_read(&data, CAPACITY);
+        if (sz == 0)
+            break;
+        const uint64_t *values = reinterpret_cast<const uint64_t *>(data);
+        for (size_t i = 0; i < sz / sizeof(uint64_t); ++i, ++expect)
+            CHECK(values[i] == expect, "unexpected value");
+        ring.release_read(sz);
+    }
+    CHECK(expect == NUM_VALUES, "missing values");
+    // Like the launcher, we only reap the writer once the stream ends, so a dead
+    // writer is a zombie above.
+    int status;
+    CHECK(waitpid(child, &status, 0) == child, "waitpid failed");
+    CHECK(die ? (WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL)
+              : (WIFEXITED(status) && WEXITSTATUS(status) == 0),
+          "writer failed");
+    CHECK(ring.destroy(), "failed to destroy ring");
+    return true;
+}
+
+} // namespace
+
+int
+test_main(int argc, const char *argv[])
+{
+    if (!test_writer(false) || !test_writer(true))
+        return 1;
+    std::cerr << "All done!\n";
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -38,6 +38,8 @@
 
 #include <iostream>
 #include <memory>
+#include <tuple>
+#include <vector>
 
 namespace dynamorio {
 namespace drmemtrace {
@@ -160,6 +162,59 @@ test_skip_initial()
     return true;
 }
 
+// Reads the rest of "iter" into "records" as (type, address, instruction ordinal).
+void
+read_records(reader_t &iter, std::vector<std::tuple<int, addr_t, uint64_t>> &records)
+{
+    zipfile_file_reader_t iter_end;
+    for (; iter != iter_end; ++iter) {
+        const memref_t &memref = *iter;
+        records.emplace_back(memref.data.type, memref.data.addr,
+                             iter.get_instruction_ordinal());
+    }
+}
+
+// Opens the test trace, decompressing ahead if "read_ahead_blocks" is positive.
+std::unique_ptr<reader_t>
+open_trace(int read_ahead_blocks)
+{
+    std::unique_ptr<reader_t> iter(new zipfile_file_reader_t(op_trace_file.get_value()));
+    iter->set_read_ahead(read_ahead_blocks);
+    if (!iter->init())
+        FATAL_ERROR("failed to initialize reader");
+    return iter;
+}
+
+bool
+test_read_ahead()
+{
+    // Each of the trace's many small chunks takes a separate refill, so the
+    // read-ahead thread starts right after the header.
+    for (uint64_t skip_instrs : { 0, 25 }) {
+        std::unique_ptr<reader_t> plain = open_trace(0);
+        std::unique_ptr<reader_t> ahead = open_trace(3);
+        // A skip right after init() still jumps over chunks.
+        plain->skip_instructions(skip_instrs);
+        ahead->skip_instructions(skip_instrs);
+        std::vector<std::tuple<int, addr_t, uint64_t>> expect, actual;
+        read_records(*plain, expect);
+        read_records(*ahead, actual);
+        CHECK(!expect.empty() && expect == actual, "read-ahead records differ");
+    }
+    // Once the helper thread is running, skipping walks the records.
+    std::unique_ptr<reader_t> ahead = open_trace(2);
+    zipfile_file_reader_t iter_end;
+    while (*ahead != iter_end && ahead->get_instruction_ordinal() < 30)
+        ++*ahead;
+    uint64_t start = ahead->get_instruction_ordinal();
+    ahead->skip_instructions(40);
+    while (*ahead != iter_end && !type_is_instr((**ahead).instr.type))
+        ++*ahead;
+    CHECK(*ahead != iter_end && ahead->get_instruction_ordinal() == start + 41,
+          "skip with read-ahead landed on the wrong instruction");
+    return true;
+}
+
 int
 test_main(int argc, const char *argv[])
 {
@@ -172,6 +227,8 @@ test_main(int argc, const char *argv[])
     }
     if (!test_skip_initial())
         return 1;
+    if (!test_read_ahead())
+        return 1;
     // TODO i#5538: Add tests that skip from the middle once we have full support
     // for duplicating the timestamp,cpu in that scenario.
     fprintf(stderr, "Success\n");
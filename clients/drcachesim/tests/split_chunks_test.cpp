@@ -0,0 +1,140 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL GOOGLE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* End-to-end test of -split_chunks on a checked-in zipfile trace. */
+
+#include <assert.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "dr_api.h"
+#include "droption.h"
+#include "analyzer_multi.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+using ::dynamorio::droption::droption_parser_t;
+using ::dynamorio::droption::DROPTION_SCOPE_FRONTEND;
+
+#ifndef HAS_ZIP
+#    error zipfile reading is required for this test
+#endif
+
+// Exposes how many groups of chunks the trace was split into.
+class split_analyzer_t : public analyzer_multi_t {
+public:
+    int
+    get_split_count() const
+    {
+        return split_count_;
+    }
+};
+
+// Runs the analyzer with the given options and returns the tools' output, setting
+// "split_count" to the number of groups of chunks the trace was split into.
+static std::string
+run_analyzer(int argc, const char *args[], int &split_count)
+{
+    // Avoid accumulation of option values across runs.
+    droption_parser_t::clear_values();
+
+    // Capture output.
+    std::stringstream output;
+    std::streambuf *prev_buf = std::cerr.rdbuf(output.rdbuf());
+
+    std::string parse_err;
+    if (!droption_parser_t::parse_argv(DROPTION_SCOPE_FRONTEND, argc, args, &parse_err,
+                                       nullptr)) {
+        std::cerr << "Failed to parse: " << parse_err << "\n";
+    }
+    split_analyzer_t analyzer;
+    assert(!!analyzer);
+    bool res = analyzer.run();
+    assert(res);
+    res = analyzer.print_stats();
+    assert(res);
+    split_count = analyzer.get_split_count();
+
+    std::cerr.rdbuf(prev_buf);
+    return output.str();
+}
+
+static void
+test_split_matches_unsplit(const char *testdir)
+{
+    std::cerr << "\n----------------\nTesting split chunks\n";
+    // This single-thread trace has a chunk size of 20 instructions and so holds
+    // many chunks.
+    std::string trace = std::string(testdir) + "/drmemtrace.allasm_x86_64.trace.zip";
+    const char *tools = "basic_counts:opcode_mix:histogram";
+    int split_count;
+    const char *unsplit_args[] = { "<exe>", "-simulator_type", tools, "-infile",
+                                   trace.c_str() };
+    std::string unsplit =
+        run_analyzer(sizeof(unsplit_args) / sizeof(unsplit_args[0]), unsplit_args,
+                     split_count);
+    assert(split_count == 0);
+    assert(unsplit.find("Basic counts tool results:") != std::string::npos);
+    assert(unsplit.find("Opcode mix tool results:") != std::string::npos);
+    assert(unsplit.find("Cache line histogram tool results:") != std::string::npos);
+
+    const char *split_args[] = { "<exe>",   "-simulator_type", tools,
+                                 "-infile", trace.c_str(),     "-split_chunks",
+                                 "4",       "-jobs",           "4" };
+    std::string split = run_analyzer(sizeof(split_args) / sizeof(split_args[0]),
+                                     split_args, split_count);
+    assert(split_count == 4);
+    if (split != unsplit) {
+        std::cerr << "Split output:\n"
+                  << split << "\ndiffers from unsplit output:\n"
+                  << unsplit << "\n";
+        assert(false);
+    }
+}
+
+int
+test_main(int argc, const char *argv[])
+{
+    // Takes in a path to the tests/ src dir.
+    assert(argc == 2);
+    dr_standalone_init();
+
+    test_split_matches_unsplit(argv[1]);
+
+    dr_standalone_exit();
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,208 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/*
+ * Microbenchmark for large last-level caches.  Compares the std::unordered_map
+ * tag index caching_device_t used before #tag_index_t with #tag_index_t on the
+ * same insert/erase/find sequence, and measures the request throughput of a
+ * 64MB LRU cache with and without its tag index.  Takes an optional access count
+ * as its only argument.
+ */
+
+#include <stdint.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../simulator/cache_lru.h"
+#include "../simulator/caching_device_block.h"
+#include "../simulator/caching_device_stats.h"
+#include "../simulator/tag_index.h"
+#include "memref.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+namespace {
+
+constexpr size_t DEFAULT_ACCESSES = 20000000;
+constexpr int LINE_SIZE = 64;
+constexpr int LL_SIZE = 64 * 1024 * 1024;
+constexpr int LL_ASSOC = 16;
+constexpr int LL_BLOCKS = LL_SIZE / LINE_SIZE;
+
+// The map type and configuration caching_device_t used before #tag_index_t.
+class legacy_index_t {
+public:
+    legacy_index_t()
+        : map_(0, [](addr_t key) { return static_cast<unsigned long>(key); })
+    {
+        map_.reserve(1 << 16);
+        map_.max_load_factor(0.5);
+    }
+    int
+    find(addr_t tag) const
+    {
+        auto it = map_.find(tag);
+        return it == map_.end() ? -1 : it->second.second;
+    }
+    void
+    insert(addr_t tag, int position)
+    {
+        map_[tag] = std::make_pair(nullptr, position);
+    }
+    void
+    erase(addr_t tag)
+    {
+        map_.erase(tag);
+    }
+
+private:
+    std::unordered_map<addr_t, std::pair<caching_device_block_t *, int>,
+                       std::function<unsigned long(addr_t)>>
+        map_;
+};
+
+double
+seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+void
+report(const char *name, size_t accesses, double secs)
+{
+    std::cerr << name << ": " << accesses << " accesses in " << secs << "s = "
+              << static_cast<double>(accesses) / secs / 1e6 << "M accesses/s\n";
+}
+
+// Random line addresses over twice the cache size, so that roughly half of the
+// accesses miss and replace a block.
+class address_stream_t {
+public:
+    addr_t
+    next_line()
+    {
+        seed_ = seed_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (seed_ >> 20) % (2 * LL_BLOCKS);
+    }
+
+private:
+    uint64_t seed_ = 1;
+};
+
+// Replays the index operations of a direct-mapped cache with LL_BLOCKS blocks
+// so that both indices see identical inserts, erases and lookups.
+template <typename index_t>
+size_t
+bench_index(const char *name, index_t &index, size_t num_accesses)
+{
+    std::vector<addr_t> resident(LL_BLOCKS, TAG_INVALID);
+    address_stream_t stream;
+    size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_accesses; ++i) {
+        addr_t tag = stream.next_line();
+        if (index.find(tag) >= 0) {
+            ++hits;
+            continue;
+        }
+        int position = static_cast<int>(tag % LL_BLOCKS);
+        if (resident[position] != TAG_INVALID)
+            index.erase(resident[position]);
+        index.insert(tag, position);
+        resident[position] = tag;
+    }
+    report(name, num_accesses, seconds_since(start));
+    return hits;
+}
+
+int64_t
+bench_cache(bool use_index, size_t num_accesses)
+{
+    cache_lru_t cache;
+    caching_device_stats_t stats(/*miss_file=*/"", LINE_SIZE);
+    if (!cache.init(LL_ASSOC, LINE_SIZE, LL_SIZE, /*parent=*/nullptr, &stats)) {
+        std::cerr << "Failed to initialize the cache\n";
+        exit(1);
+    }
+    cache.set_hashtable_use(use_index);
+    memref_t ref = {};
+    ref.data.type = TRACE_TYPE_READ;
+    ref.data.size = 8;
+    address_stream_t stream;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_accesses; ++i) {
+        ref.data.addr = stream.next_line() * LINE_SIZE;
+        cache.request(ref);
+    }
+    report(use_index ? "64MB LRU cache, tag index" : "64MB LRU cache, set walk",
+           num_accesses, seconds_since(start));
+    return stats.get_metric(metric_name_t::HITS);
+}
+
+} // namespace
+
+int
+test_main(int argc, const char *argv[])
+{
+    size_t num_accesses = DEFAULT_ACCESSES;
+    if (argc > 1)
+        num_accesses = strtoull(argv[1], nullptr, 10);
+    size_t legacy_hits, flat_hits;
+    {
+        legacy_index_t legacy;
+        legacy_hits = bench_index("unordered_map index", legacy, num_accesses);
+    }
+    {
+        tag_index_t flat;
+        flat.init(LL_BLOCKS);
+        flat_hits = bench_index("flat tag_index_t", flat, num_accesses);
+    }
+    int64_t index_hits = bench_cache(true, num_accesses);
+    int64_t walk_hits = bench_cache(false, num_accesses);
+    if (legacy_hits != flat_hits || index_hits != walk_hits) {
+        std::cerr << "Mismatched hit counts\n";
+        return 1;
+    }
+    std::cerr << "hits " << flat_hits << " " << index_hits << "\n";
+    return 0;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
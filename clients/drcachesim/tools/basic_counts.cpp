@@ -118,6 +118,44 @@ basic_counts_t::parallel_shard_exit(void *shard_data)
     return true;
 }
 
+bool
+basic_counts_t::parallel_chunk_supported()
+{
+    return true;
+}
+
+void *
+basic_counts_t::parallel_chunk_init_stream(int shard_index, int chunk_index,
+                                           void *worker_data, memtrace_stream_t *stream)
+{
+    // This is not added to shard_map_ as it is merged into the shard's first piece.
+    auto per_shard = new per_shard_t;
+    per_shard->stream = stream;
+    per_shard->core = stream->get_output_cpuid();
+    per_shard->tid = stream->get_tid();
+    // Only the first piece sees the headers and any kernel region start markers
+    // preceding this piece.
+    per_shard->filetype_ = static_cast<intptr_t>(stream->get_filetype());
+    per_shard->is_kernel = stream->is_record_kernel();
+    return reinterpret_cast<void *>(per_shard);
+}
+
+bool
+basic_counts_t::parallel_chunk_merge(void *shard_data, void *chunk_data)
+{
+    per_shard_t *per_shard = reinterpret_cast<per_shard_t *>(shard_data);
+    per_shard_t *chunk = reinterpret_cast<per_shard_t *>(chunk_data);
+    bool res = true;
+    if (chunk->last_window != -1) {
+        // We do not know which window a piece's initial entries belong to.
+        per_shard->error = "Merging pieces of a multi-window trace is not supported";
+        res = false;
+    } else
+        per_shard->counters.back() += chunk->counters[0];
+    delete chunk;
+    return res;
+}
+
 std::string
 basic_counts_t::parallel_shard_error(void *shard_data)
 {
@@ -0,0 +1,111 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Standalone converter from the missing_instructions columnar row format to the
+ * SQLite database and CSV outputs.
+ */
+
+#include "droption.h"
+#include "dr_frontend.h"
+#include "tools/cachesim_row_sink.h"
+#include "tests/test_helpers.h"
+
+#include <stdexcept>
+
+using ::dynamorio::drmemtrace::disable_popups;
+using ::dynamorio::droption::droption_parser_t;
+using ::dynamorio::droption::DROPTION_SCOPE_ALL;
+using ::dynamorio::droption::DROPTION_SCOPE_FRONTEND;
+using ::dynamorio::droption::droption_t;
+
+namespace {
+
+#define FATAL_ERROR(msg, ...)                               \
+    do {                                                    \
+        fprintf(stderr, "ERROR: " msg "\n", ##__VA_ARGS__); \
+        fflush(stderr);                                     \
+        exit(1);                                            \
+    } while (0)
+
+static droption_t<std::string>
+    op_infile(DROPTION_SCOPE_FRONTEND, "infile", "", "[Required] Columnar row file",
+              "Specifies the .rows file written by the missing_instructions tool with "
+              "-cachesim_row_format columnar.");
+
+static droption_t<std::string>
+    op_sqlite_out(DROPTION_SCOPE_FRONTEND, "sqlite_out", "",
+                  "Path of the SQLite database to write",
+                  "If specified, the rows are inserted into a cache_stats table of this "
+                  "SQLite database, identical to -cachesim_row_format sqlite output.");
+
+static droption_t<std::string>
+    op_csv_out(DROPTION_SCOPE_FRONTEND, "csv_out", "", "Path of the CSV file to write",
+               "If specified, the rows are written to this comma-separated file with "
+               "the same columns as the cache_stats table.");
+
+} // namespace
+
+int
+_tmain(int argc, const TCHAR *targv[])
+{
+    disable_popups();
+
+    char **argv;
+    drfront_status_t sc = drfront_convert_args(targv, &argv, argc);
+    if (sc != DRFRONT_SUCCESS)
+        FATAL_ERROR("Failed to process args: %d", sc);
+
+    std::string parse_err;
+    if (!droption_parser_t::parse_argv(DROPTION_SCOPE_FRONTEND, argc, (const char **)argv,
+                                       &parse_err, NULL) ||
+        op_infile.get_value().empty() ||
+        (op_sqlite_out.get_value().empty() && op_csv_out.get_value().empty())) {
+        FATAL_ERROR("Usage error: %s\nUsage:\n%s", parse_err.c_str(),
+                    droption_parser_t::usage_short(DROPTION_SCOPE_ALL).c_str());
+    }
+
+    try {
+        if (!op_sqlite_out.get_value().empty()) {
+            dynamorio::drmemtrace::cachesim_columnar_to_sqlite(
+                op_infile.get_value(), op_sqlite_out.get_value());
+        }
+        if (!op_csv_out.get_value().empty()) {
+            dynamorio::drmemtrace::cachesim_columnar_to_csv(op_infile.get_value(),
+                                                            op_csv_out.get_value());
+        }
+    } catch (const std::exception &ex) {
+        FATAL_ERROR("Failed to convert %s: %s", op_infile.get_value().c_str(), ex.what());
+    }
+
+    fprintf(stderr, "Done!\n");
+    return 0;
+}
@@ -0,0 +1,206 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Preallocated struct-of-arrays storage for the missing_instructions rows. */
+
+#ifndef _CACHESIM_ROW_RING_H_
+#define _CACHESIM_ROW_RING_H_ 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Instruction type recorded for instruction fetches; data types use the small
+// integers assigned in missing_instructions_t::get_opcode().
+static constexpr uint8_t CACHESIM_INSTR_TYPE_INSTR = 30;
+
+enum cachesim_row_bits_t {
+    CACHESIM_BIT_L1D_MISS = 0x01,
+    CACHESIM_BIT_L1I_MISS = 0x02,
+    CACHESIM_BIT_LL_MISS = 0x04,
+    CACHESIM_BIT_THREAD_SWITCH = 0x08,
+    CACHESIM_BIT_CORE_SWITCH = 0x10,
+};
+
+/*
+ * Interns disassembly strings so each row stores only a 32-bit id.  Id 0 is the
+ * empty string and ids are assigned sequentially, which lets a writer emit just
+ * the entries added since its previous block.
+ */
+class cachesim_string_table_t {
+public:
+    cachesim_string_table_t()
+    {
+        strings_.emplace_back();
+    }
+    uint32_t
+    intern(const std::string &str)
+    {
+        if (str.empty())
+            return 0;
+        auto it = ids_.find(str);
+        if (it != ids_.end())
+            return it->second;
+        uint32_t id = static_cast<uint32_t>(strings_.size());
+        strings_.push_back(str);
+        ids_.emplace(str, id);
+        return id;
+    }
+    // Appends a string whose id is the current size(), as read back from a file.
+    void
+    append(const std::string &str)
+    {
+        ids_.emplace(str, static_cast<uint32_t>(strings_.size()));
+        strings_.push_back(str);
+    }
+    const std::string &
+    get(uint32_t id) const
+    {
+        return strings_[id];
+    }
+    uint32_t
+    size() const
+    {
+        return static_cast<uint32_t>(strings_.size());
+    }
+
+private:
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> ids_;
+};
+
+/*
+ * Fixed-capacity struct-of-arrays row storage.  All columns are allocated up front
+ * so filling a row never touches the heap.  A producer fills the columns at index
+ * size() and then calls commit() to keep the row; an uncommitted slot is simply
+ * overwritten by the next row.  Once full() the owner hands the ring to a
+ * #cachesim_row_sink_t and calls clear() to wrap around to the start.
+ * The hit and miss counter columns are only allocated for the expanded format.
+ */
+class cachesim_row_ring_t {
+public:
+    cachesim_row_ring_t(size_t capacity, bool expanded)
+        : capacity_(capacity)
+        , expanded_(expanded)
+    {
+        instr_id.resize(capacity);
+        pc_delta.resize(capacity);
+        access_delta.resize(capacity);
+        bits.resize(capacity);
+        instr_type.resize(capacity);
+        byte_count.resize(capacity);
+        core.resize(capacity);
+        disasm_id.resize(capacity);
+        if (expanded) {
+            l1d_hits.resize(capacity);
+            l1d_misses.resize(capacity);
+            l1i_hits.resize(capacity);
+            l1i_misses.resize(capacity);
+            ll_hits.resize(capacity);
+            ll_misses.resize(capacity);
+        }
+    }
+    size_t
+    size() const
+    {
+        return size_;
+    }
+    size_t
+    capacity() const
+    {
+        return capacity_;
+    }
+    bool
+    empty() const
+    {
+        return size_ == 0;
+    }
+    bool
+    full() const
+    {
+        return size_ >= capacity_;
+    }
+    bool
+    is_expanded() const
+    {
+        return expanded_;
+    }
+    void
+    commit()
+    {
+        ++size_;
+    }
+    void
+    clear()
+    {
+        size_ = 0;
+    }
+    // Marks the first "count" slots as filled, for readers that fill the columns
+    // directly.
+    void
+    set_size(size_t count)
+    {
+        size_ = count;
+    }
+
+    std::vector<int32_t> instr_id;
+    std::vector<int32_t> pc_delta;
+    std::vector<int32_t> access_delta;
+    std::vector<uint8_t> bits; // Of #cachesim_row_bits_t.
+    std::vector<uint8_t> instr_type;
+    std::vector<uint8_t> byte_count;
+    std::vector<uint8_t> core;
+    std::vector<uint32_t> disasm_id; // Into a #cachesim_string_table_t.
+    // Expanded format only.
+    std::vector<int32_t> l1d_hits;
+    std::vector<int32_t> l1d_misses;
+    std::vector<int32_t> l1i_hits;
+    std::vector<int32_t> l1i_misses;
+    std::vector<int32_t> ll_hits;
+    std::vector<int32_t> ll_misses;
+
+private:
+    size_t capacity_;
+    bool expanded_;
+    size_t size_ = 0;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHESIM_ROW_RING_H_ */
@@ -0,0 +1,484 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cachesim_row_sink.h"
+
+#include <string.h>
+
+#include <stdexcept>
+
+#ifdef HAS_ZLIB
+#    include <zlib.h>
+#endif
+
+#include "utils.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+namespace {
+
+float
+miss_ratio(int misses, int hits)
+{
+    // Matches the computation in missing_instructions_t::update_expanded_stats.
+    return static_cast<float>(misses) / static_cast<float>(misses + hits);
+}
+
+template <typename T>
+void
+read_column(std::vector<char> &raw, std::vector<T> &column, uint32_t num_rows)
+{
+    if (raw.size() != num_rows * sizeof(T))
+        throw std::runtime_error("Column size does not match the row count");
+    memcpy(column.data(), raw.data(), raw.size());
+}
+
+} // namespace
+
+/***************************************************************************
+ * sqlite_row_sink_t
+ */
+
+// The instruction id is stored twice to keep the original table layout.
+#define CACHESIM_SQL_COLUMNS                                                     \
+    "instruction_number INTEGER, access_address_delta INTEGER, "                 \
+    "pc_address_delta INTEGER, l1d_miss INTEGER, l1i_miss INTEGER, "             \
+    "ll_miss INTEGER, instr_type INTEGER, byte_count INTEGER, "                  \
+    "disassembly_string TEXT, current_instruction_id INTEGER, core INTEGER, "    \
+    "thread_switch INTEGER, core_switch INTEGER"
+#define CACHESIM_SQL_EXPANDED_COLUMNS                                            \
+    ", l1_data_hits INTEGER, l1_data_misses INTEGER, l1_data_ratio REAL, "       \
+    "l1_inst_hits INTEGER, l1_inst_misses INTEGER, l1_inst_ratio REAL, "         \
+    "ll_hits INTEGER, ll_misses INTEGER, ll_ratio REAL"
+#define CACHESIM_SQL_NAMES                                                       \
+    "instruction_number, access_address_delta, pc_address_delta, l1d_miss, "     \
+    "l1i_miss, ll_miss, instr_type, byte_count, disassembly_string, "            \
+    "current_instruction_id, core, thread_switch, core_switch"
+#define CACHESIM_SQL_EXPANDED_NAMES                                              \
+    ", l1_data_hits, l1_data_misses, l1_data_ratio, l1_inst_hits, "              \
+    "l1_inst_misses, l1_inst_ratio, ll_hits, ll_misses, ll_ratio"
+
+const char *const sqlite_row_sink_t::CREATE_TABLE =
+    "CREATE TABLE IF NOT EXISTS cache_stats (" CACHESIM_SQL_COLUMNS ");";
+const char *const sqlite_row_sink_t::CREATE_TABLE_EXPANDED =
+    "CREATE TABLE IF NOT EXISTS cache_stats (" CACHESIM_SQL_COLUMNS
+    CACHESIM_SQL_EXPANDED_COLUMNS ");";
+const char *const sqlite_row_sink_t::INSERT_ROW =
+    "INSERT INTO cache_stats (" CACHESIM_SQL_NAMES
+    ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+const char *const sqlite_row_sink_t::INSERT_ROW_EXPANDED =
+    "INSERT INTO cache_stats (" CACHESIM_SQL_NAMES CACHESIM_SQL_EXPANDED_NAMES
+    ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+sqlite_row_sink_t::sqlite_row_sink_t(const std::string &db_filename, bool expanded)
+    : expanded_(expanded)
+{
+    int rc = sqlite3_open(db_filename.c_str(), &db_);
+    if (rc != SQLITE_OK) {
+        std::string error_msg =
+            "Cannot open database: " + std::string(sqlite3_errmsg(db_));
+        sqlite3_close(db_);
+        db_ = nullptr;
+        throw std::runtime_error(error_msg);
+    }
+    exec(expanded_ ? CREATE_TABLE_EXPANDED : CREATE_TABLE, "create table");
+    // Preparing the SQL statement once, instead of re-preparing it for every batch.
+    rc = sqlite3_prepare_v2(db_, expanded_ ? INSERT_ROW_EXPANDED : INSERT_ROW, -1,
+                            &insert_stmt_, nullptr);
+    if (rc != SQLITE_OK) {
+        throw std::runtime_error("Cannot prepare insert statement: " +
+                                 std::string(sqlite3_errmsg(db_)));
+    }
+}
+
+sqlite_row_sink_t::~sqlite_row_sink_t()
+{
+    close();
+}
+
+void
+sqlite_row_sink_t::exec(const char *sql, const char *what)
+{
+    char *errmsg = nullptr;
+    int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &errmsg);
+    if (rc != SQLITE_OK) {
+        std::string error_msg = "SQL error during " + std::string(what) + ": " +
+            (errmsg == nullptr ? "" : errmsg);
+        sqlite3_free(errmsg);
+        throw std::runtime_error(error_msg);
+    }
+    sqlite3_free(errmsg);
+}
+
+void
+sqlite_row_sink_t::write_rows(const cachesim_row_ring_t &rows,
+                              const cachesim_string_table_t &strings)
+{
+    exec("BEGIN TRANSACTION;", "begin transaction");
+    for (size_t i = 0; i < rows.size(); ++i) {
+        uint8_t bits = rows.bits[i];
+        sqlite3_bind_int(insert_stmt_, 1, rows.instr_id[i]);
+        sqlite3_bind_int(insert_stmt_, 2, rows.access_delta[i]);
+        sqlite3_bind_int(insert_stmt_, 3, rows.pc_delta[i]);
+        sqlite3_bind_int(insert_stmt_, 4, TESTANY(CACHESIM_BIT_L1D_MISS, bits));
+        sqlite3_bind_int(insert_stmt_, 5, TESTANY(CACHESIM_BIT_L1I_MISS, bits));
+        sqlite3_bind_int(insert_stmt_, 6, TESTANY(CACHESIM_BIT_LL_MISS, bits));
+        sqlite3_bind_int(insert_stmt_, 7, rows.instr_type[i]);
+        sqlite3_bind_int(insert_stmt_, 8, rows.byte_count[i]);
+        // The string table outlives the statement step so no copy is needed.
+        const std::string &disasm = strings.get(rows.disasm_id[i]);
+        sqlite3_bind_text(insert_stmt_, 9, disasm.c_str(),
+                          static_cast<int>(disasm.size()), SQLITE_STATIC);
+        sqlite3_bind_int(insert_stmt_, 10, rows.instr_id[i]);
+        sqlite3_bind_int(insert_stmt_, 11, rows.core[i]);
+        sqlite3_bind_int(insert_stmt_, 12, TESTANY(CACHESIM_BIT_THREAD_SWITCH, bits));
+        sqlite3_bind_int(insert_stmt_, 13, TESTANY(CACHESIM_BIT_CORE_SWITCH, bits));
+        if (expanded_) {
+            sqlite3_bind_int(insert_stmt_, 14, rows.l1d_hits[i]);
+            sqlite3_bind_int(insert_stmt_, 15, rows.l1d_misses[i]);
+            sqlite3_bind_double(insert_stmt_, 16,
+                                miss_ratio(rows.l1d_misses[i], rows.l1d_hits[i]));
+            sqlite3_bind_int(insert_stmt_, 17, rows.l1i_hits[i]);
+            sqlite3_bind_int(insert_stmt_, 18, rows.l1i_misses[i]);
+            sqlite3_bind_double(insert_stmt_, 19,
+                                miss_ratio(rows.l1i_misses[i], rows.l1i_hits[i]));
+            sqlite3_bind_int(insert_stmt_, 20, rows.ll_hits[i]);
+            sqlite3_bind_int(insert_stmt_, 21, rows.ll_misses[i]);
+            sqlite3_bind_double(insert_stmt_, 22,
+                                miss_ratio(rows.ll_misses[i], rows.ll_hits[i]));
+        }
+        int rc = sqlite3_step(insert_stmt_);
+        if (rc != SQLITE_DONE) {
+            throw std::runtime_error("Insertion failed: " +
+                                     std::string(sqlite3_errmsg(db_)));
+        }
+        // Reset the statement to reuse it for the next insert.
+        sqlite3_reset(insert_stmt_);
+    }
+    exec("END TRANSACTION;", "end transaction");
+}
+
+void
+sqlite_row_sink_t::close()
+{
+    if (insert_stmt_ != nullptr) {
+        sqlite3_finalize(insert_stmt_);
+        insert_stmt_ = nullptr;
+    }
+    if (db_ != nullptr) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+}
+
+/***************************************************************************
+ * cachesim_columnar_sink_t
+ */
+
+cachesim_columnar_sink_t::cachesim_columnar_sink_t(const std::string &filename,
+                                                   bool expanded)
+    : out_(filename, std::ios::binary | std::ios::trunc)
+    , expanded_(expanded)
+{
+    if (!out_.good())
+        throw std::runtime_error("Failed to open row file " + filename);
+    cachesim_columnar_header_t header = {};
+    header.magic = CACHESIM_COLUMNAR_MAGIC;
+    header.version = CACHESIM_COLUMNAR_VERSION;
+    header.flags = expanded_ ? CACHESIM_COLUMNAR_FLAG_EXPANDED : 0;
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+cachesim_columnar_sink_t::~cachesim_columnar_sink_t()
+{
+    close();
+}
+
+void
+cachesim_columnar_sink_t::write_column(cachesim_column_t column, const void *raw,
+                                       size_t raw_size)
+{
+    cachesim_column_header_t header = {};
+    header.column = static_cast<uint8_t>(column);
+    header.codec = CACHESIM_CODEC_RAW;
+    header.raw_size = static_cast<uint32_t>(raw_size);
+    header.stored_size = header.raw_size;
+    const char *data = static_cast<const char *>(raw);
+#ifdef HAS_ZLIB
+    uLongf stored_size = compressBound(static_cast<uLong>(raw_size));
+    if (compress_buf_.size() < stored_size)
+        compress_buf_.resize(stored_size);
+    // The fast level gets most of the benefit on these narrow, repetitive columns.
+    if (raw_size > 0 &&
+        compress2(reinterpret_cast<Bytef *>(compress_buf_.data()), &stored_size,
+                  static_cast<const Bytef *>(raw), static_cast<uLong>(raw_size),
+                  Z_BEST_SPEED) == Z_OK &&
+        stored_size < raw_size) {
+        header.codec = CACHESIM_CODEC_ZLIB;
+        header.stored_size = static_cast<uint32_t>(stored_size);
+        data = compress_buf_.data();
+    }
+#endif
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out_.write(data, header.stored_size);
+}
+
+void
+cachesim_columnar_sink_t::write_rows(const cachesim_row_ring_t &rows,
+                                     const cachesim_string_table_t &strings)
+{
+    if (rows.empty())
+        return;
+    uint32_t num_rows = static_cast<uint32_t>(rows.size());
+    id_deltas_.resize(num_rows);
+    int32_t prev_id = 0;
+    for (uint32_t i = 0; i < num_rows; ++i) {
+        id_deltas_[i] = rows.instr_id[i] - prev_id;
+        prev_id = rows.instr_id[i];
+    }
+    dict_buf_.clear();
+    for (; strings_written_ < strings.size(); ++strings_written_) {
+        const std::string &str = strings.get(strings_written_);
+        uint32_t len = static_cast<uint32_t>(str.size());
+        dict_buf_.insert(dict_buf_.end(), reinterpret_cast<const char *>(&len),
+                         reinterpret_cast<const char *>(&len) + sizeof(len));
+        dict_buf_.insert(dict_buf_.end(), str.begin(), str.end());
+    }
+    uint32_t num_cols = expanded_ ? CACHESIM_COL_COUNT : CACHESIM_COL_L1D_HITS;
+    out_.write(reinterpret_cast<const char *>(&num_rows), sizeof(num_rows));
+    out_.write(reinterpret_cast<const char *>(&num_cols), sizeof(num_cols));
+    write_column(CACHESIM_COL_INSTR_ID, id_deltas_.data(), num_rows * sizeof(int32_t));
+    write_column(CACHESIM_COL_PC_DELTA, rows.pc_delta.data(), num_rows * sizeof(int32_t));
+    write_column(CACHESIM_COL_ACCESS_DELTA, rows.access_delta.data(),
+                 num_rows * sizeof(int32_t));
+    write_column(CACHESIM_COL_MISS_BITS, rows.bits.data(), num_rows);
+    write_column(CACHESIM_COL_INSTR_TYPE, rows.instr_type.data(), num_rows);
+    write_column(CACHESIM_COL_BYTE_COUNT, rows.byte_count.data(), num_rows);
+    write_column(CACHESIM_COL_CORE, rows.core.data(), num_rows);
+    write_column(CACHESIM_COL_DISASM_ID, rows.disasm_id.data(),
+                 num_rows * sizeof(uint32_t));
+    write_column(CACHESIM_COL_DISASM_DICT, dict_buf_.data(), dict_buf_.size());
+    if (expanded_) {
+        write_column(CACHESIM_COL_L1D_HITS, rows.l1d_hits.data(),
+                     num_rows * sizeof(int32_t));
+        write_column(CACHESIM_COL_L1D_MISSES, rows.l1d_misses.data(),
+                     num_rows * sizeof(int32_t));
+        write_column(CACHESIM_COL_L1I_HITS, rows.l1i_hits.data(),
+                     num_rows * sizeof(int32_t));
+        write_column(CACHESIM_COL_L1I_MISSES, rows.l1i_misses.data(),
+                     num_rows * sizeof(int32_t));
+        write_column(CACHESIM_COL_LL_HITS, rows.ll_hits.data(),
+                     num_rows * sizeof(int32_t));
+        write_column(CACHESIM_COL_LL_MISSES, rows.ll_misses.data(),
+                     num_rows * sizeof(int32_t));
+    }
+    if (!out_.good())
+        throw std::runtime_error("Failed to write row block");
+}
+
+void
+cachesim_columnar_sink_t::close()
+{
+    if (out_.is_open())
+        out_.close();
+}
+
+/***************************************************************************
+ * cachesim_columnar_reader_t
+ */
+
+cachesim_columnar_reader_t::cachesim_columnar_reader_t(const std::string &filename)
+    : in_(filename, std::ios::binary)
+{
+    cachesim_columnar_header_t header;
+    if (!in_.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        header.magic != CACHESIM_COLUMNAR_MAGIC)
+        throw std::runtime_error("Not a columnar row file: " + filename);
+    if (header.version != CACHESIM_COLUMNAR_VERSION) {
+        throw std::runtime_error("Unsupported columnar row file version " +
+                                 std::to_string(header.version));
+    }
+    expanded_ = TESTANY(CACHESIM_COLUMNAR_FLAG_EXPANDED, header.flags);
+}
+
+const cachesim_row_ring_t *
+cachesim_columnar_reader_t::read_block()
+{
+    uint32_t num_rows, num_cols;
+    if (!in_.read(reinterpret_cast<char *>(&num_rows), sizeof(num_rows)))
+        return nullptr;
+    uint32_t expect_cols = expanded_ ? CACHESIM_COL_COUNT : CACHESIM_COL_L1D_HITS;
+    if (!in_.read(reinterpret_cast<char *>(&num_cols), sizeof(num_cols)) ||
+        num_cols != expect_cols)
+        throw std::runtime_error("Corrupted row block header");
+    std::vector<std::vector<char>> cols(CACHESIM_COL_COUNT);
+    std::vector<char> stored;
+    for (uint32_t i = 0; i < num_cols; ++i) {
+        cachesim_column_header_t header;
+        if (!in_.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            header.column >= CACHESIM_COL_COUNT)
+            throw std::runtime_error("Corrupted column header");
+        std::vector<char> &raw = cols[header.column];
+        raw.resize(header.raw_size);
+        if (header.codec == CACHESIM_CODEC_RAW) {
+            if (header.stored_size != header.raw_size ||
+                !in_.read(raw.data(), header.raw_size))
+                throw std::runtime_error("Truncated column data");
+            continue;
+        }
+#ifdef HAS_ZLIB
+        if (header.codec == CACHESIM_CODEC_ZLIB) {
+            stored.resize(header.stored_size);
+            if (!in_.read(stored.data(), header.stored_size))
+                throw std::runtime_error("Truncated column data");
+            uLongf raw_size = header.raw_size;
+            if (uncompress(reinterpret_cast<Bytef *>(raw.data()), &raw_size,
+                           reinterpret_cast<const Bytef *>(stored.data()),
+                           header.stored_size) != Z_OK ||
+                raw_size != header.raw_size)
+                throw std::runtime_error("Failed to decompress column");
+            continue;
+        }
+#endif
+        throw std::runtime_error("Unsupported column codec " +
+                                 std::to_string(header.codec));
+    }
+    const std::vector<char> &dict = cols[CACHESIM_COL_DISASM_DICT];
+    for (size_t pos = 0; pos < dict.size();) {
+        uint32_t len;
+        if (pos + sizeof(len) > dict.size())
+            throw std::runtime_error("Corrupted disassembly dictionary");
+        memcpy(&len, &dict[pos], sizeof(len));
+        pos += sizeof(len);
+        if (pos + len > dict.size())
+            throw std::runtime_error("Corrupted disassembly dictionary");
+        strings_.append(std::string(&dict[pos], len));
+        pos += len;
+    }
+    if (!rows_ || rows_->capacity() < num_rows)
+        rows_.reset(new cachesim_row_ring_t(num_rows, expanded_));
+    cachesim_row_ring_t &rows = *rows_;
+    read_column(cols[CACHESIM_COL_INSTR_ID], rows.instr_id, num_rows);
+    int32_t id = 0;
+    for (uint32_t i = 0; i < num_rows; ++i) {
+        id += rows.instr_id[i];
+        rows.instr_id[i] = id;
+    }
+    read_column(cols[CACHESIM_COL_PC_DELTA], rows.pc_delta, num_rows);
+    read_column(cols[CACHESIM_COL_ACCESS_DELTA], rows.access_delta, num_rows);
+    read_column(cols[CACHESIM_COL_MISS_BITS], rows.bits, num_rows);
+    read_column(cols[CACHESIM_COL_INSTR_TYPE], rows.instr_type, num_rows);
+    read_column(cols[CACHESIM_COL_BYTE_COUNT], rows.byte_count, num_rows);
+    read_column(cols[CACHESIM_COL_CORE], rows.core, num_rows);
+    read_column(cols[CACHESIM_COL_DISASM_ID], rows.disasm_id, num_rows);
+    for (uint32_t i = 0; i < num_rows; ++i) {
+        if (rows.disasm_id[i] >= strings_.size())
+            throw std::runtime_error("Invalid disassembly id");
+    }
+    if (expanded_) {
+        read_column(cols[CACHESIM_COL_L1D_HITS], rows.l1d_hits, num_rows);
+        read_column(cols[CACHESIM_COL_L1D_MISSES], rows.l1d_misses, num_rows);
+        read_column(cols[CACHESIM_COL_L1I_HITS], rows.l1i_hits, num_rows);
+        read_column(cols[CACHESIM_COL_L1I_MISSES], rows.l1i_misses, num_rows);
+        read_column(cols[CACHESIM_COL_LL_HITS], rows.ll_hits, num_rows);
+        read_column(cols[CACHESIM_COL_LL_MISSES], rows.ll_misses, num_rows);
+    }
+    rows.set_size(num_rows);
+    return rows_.get();
+}
+
+/***************************************************************************
+ * Offline conversion
+ */
+
+void
+cachesim_columnar_to_sqlite(const std::string &columnar_file,
+                            const std::string &db_filename)
+{
+    cachesim_columnar_reader_t reader(columnar_file);
+    sqlite_row_sink_t sink(db_filename, reader.is_expanded());
+    const cachesim_row_ring_t *rows;
+    while ((rows = reader.read_block()) != nullptr)
+        sink.write_rows(*rows, reader.get_strings());
+    sink.close();
+}
+
+void
+cachesim_columnar_to_csv(const std::string &columnar_file, const std::string &csv_file)
+{
+    cachesim_columnar_reader_t reader(columnar_file);
+    std::ofstream out(csv_file, std::ios::trunc);
+    if (!out.good())
+        throw std::runtime_error("Failed to open " + csv_file);
+    // Same columns, in the same order, as the cache_stats table.
+    out << CACHESIM_SQL_NAMES;
+    if (reader.is_expanded())
+        out << CACHESIM_SQL_EXPANDED_NAMES;
+    out << "\n";
+    const cachesim_row_ring_t *block;
+    while ((block = reader.read_block()) != nullptr) {
+        const cachesim_row_ring_t &rows = *block;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            std::string quoted;
+            for (char c : reader.get_strings().get(rows.disasm_id[i])) {
+                if (c == '"')
+                    quoted += '"';
+                quoted += c;
+            }
+            uint8_t bits = rows.bits[i];
+            out << rows.instr_id[i] << "," << rows.access_delta[i] << ","
+                << rows.pc_delta[i] << "," << TESTANY(CACHESIM_BIT_L1D_MISS, bits)
+                << "," << TESTANY(CACHESIM_BIT_L1I_MISS, bits) << ","
+                << TESTANY(CACHESIM_BIT_LL_MISS, bits) << ","
+                << static_cast<int>(rows.instr_type[i]) << ","
+                << static_cast<int>(rows.byte_count[i]) << ",\"" << quoted << "\","
+                << rows.instr_id[i] << "," << static_cast<int>(rows.core[i]) << ","
+                << TESTANY(CACHESIM_BIT_THREAD_SWITCH, bits) << ","
+                << TESTANY(CACHESIM_BIT_CORE_SWITCH, bits);
+            if (reader.is_expanded()) {
+                out << "," << rows.l1d_hits[i] << "," << rows.l1d_misses[i] << ","
+                    << miss_ratio(rows.l1d_misses[i], rows.l1d_hits[i]) << ","
+                    << rows.l1i_hits[i] << "," << rows.l1i_misses[i] << ","
+                    << miss_ratio(rows.l1i_misses[i], rows.l1i_hits[i]) << ","
+                    << rows.ll_hits[i] << "," << rows.ll_misses[i] << ","
+                    << miss_ratio(rows.ll_misses[i], rows.ll_hits[i]);
+            }
+            out << "\n";
+        }
+    }
+    if (!out.good())
+        throw std::runtime_error("Failed to write " + csv_file);
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,228 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Output backends for the rows produced by the missing_instructions tool. */
+
+#ifndef _CACHESIM_ROW_SINK_H_
+#define _CACHESIM_ROW_SINK_H_ 1
+
+#include <stdint.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "cachesim_row_ring.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+#define CACHESIM_ROW_FORMAT_SQLITE "sqlite"
+#define CACHESIM_ROW_FORMAT_COLUMNAR "columnar"
+
+/**
+ * Destination for batches of missing_instructions rows.  Errors are reported by
+ * throwing std::runtime_error, matching the rest of the missing_instructions tool.
+ */
+class cachesim_row_sink_t {
+public:
+    virtual ~cachesim_row_sink_t() = default;
+    // Writes out the committed rows of "rows", whose disassembly ids refer to
+    // "strings".  The ring must match the expanded setting the sink was created with.
+    virtual void
+    write_rows(const cachesim_row_ring_t &rows,
+               const cachesim_string_table_t &strings) = 0;
+    // Flushes and releases the underlying output.  Further writes are invalid.
+    virtual void
+    close() = 0;
+    // Returns the file name extension used by this sink, including the dot.
+    virtual std::string
+    get_file_extension() const = 0;
+};
+
+/* Inserts every row into a "cache_stats" table of a SQLite database. */
+class sqlite_row_sink_t : public cachesim_row_sink_t {
+public:
+    sqlite_row_sink_t(const std::string &db_filename, bool expanded);
+    ~sqlite_row_sink_t() override;
+    void
+    write_rows(const cachesim_row_ring_t &rows,
+               const cachesim_string_table_t &strings) override;
+    void
+    close() override;
+    std::string
+    get_file_extension() const override
+    {
+        return ".db";
+    }
+
+    static const char *const CREATE_TABLE;
+    static const char *const CREATE_TABLE_EXPANDED;
+    static const char *const INSERT_ROW;
+    static const char *const INSERT_ROW_EXPANDED;
+
+private:
+    void
+    exec(const char *sql, const char *what);
+
+    sqlite3 *db_ = nullptr;
+    sqlite3_stmt *insert_stmt_ = nullptr;
+    bool expanded_;
+};
+
+/*
+ * Columnar, block-compressed binary row format.
+ *
+ * The file starts with a #cachesim_columnar_header_t.  The rest is a sequence of
+ * blocks, one per call to write_rows(), each holding a uint32_t row count and a
+ * uint32_t column count followed by that many column chunks.  A column chunk is a
+ * #cachesim_column_header_t followed by its stored bytes; the raw bytes are an
+ * array of fixed-width little-endian values, one per row, except for
+ * CACHESIM_COL_DISASM_DICT which holds the disassembly strings interned since the
+ * previous block as (uint32_t length, bytes) pairs.  Dictionary ids are assigned
+ * sequentially from 1 across the whole file; id 0 is the empty string.
+ * The instruction id column is delta-encoded against the previous row, with the
+ * first row of each block holding the absolute value.  The expanded hit and miss
+ * counters are stored but their ratios are recomputed by the reader.
+ */
+enum cachesim_column_t {
+    CACHESIM_COL_INSTR_ID,     /**< int32_t, delta-encoded. */
+    CACHESIM_COL_PC_DELTA,     /**< int32_t. */
+    CACHESIM_COL_ACCESS_DELTA, /**< int32_t. */
+    CACHESIM_COL_MISS_BITS,    /**< uint8_t of #cachesim_row_bits_t. */
+    CACHESIM_COL_INSTR_TYPE,   /**< uint8_t. */
+    CACHESIM_COL_BYTE_COUNT,   /**< uint8_t. */
+    CACHESIM_COL_CORE,         /**< uint8_t. */
+    CACHESIM_COL_DISASM_ID,    /**< uint32_t dictionary id. */
+    CACHESIM_COL_DISASM_DICT,  /**< New dictionary entries. */
+    CACHESIM_COL_L1D_HITS,     /**< int32_t, expanded format only. */
+    CACHESIM_COL_L1D_MISSES,   /**< int32_t, expanded format only. */
+    CACHESIM_COL_L1I_HITS,     /**< int32_t, expanded format only. */
+    CACHESIM_COL_L1I_MISSES,   /**< int32_t, expanded format only. */
+    CACHESIM_COL_LL_HITS,      /**< int32_t, expanded format only. */
+    CACHESIM_COL_LL_MISSES,    /**< int32_t, expanded format only. */
+    CACHESIM_COL_COUNT,
+};
+
+enum cachesim_column_codec_t {
+    CACHESIM_CODEC_RAW,
+    CACHESIM_CODEC_ZLIB,
+};
+
+static constexpr uint64_t CACHESIM_COLUMNAR_MAGIC = 0x31574f5253434344ULL; // DCCSROW1
+static constexpr uint32_t CACHESIM_COLUMNAR_VERSION = 1;
+static constexpr uint32_t CACHESIM_COLUMNAR_FLAG_EXPANDED = 0x1;
+
+struct cachesim_columnar_header_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t flags;
+};
+
+struct cachesim_column_header_t {
+    uint8_t column;
+    uint8_t codec;
+    uint16_t reserved;
+    uint32_t raw_size;
+    uint32_t stored_size;
+};
+
+class cachesim_columnar_sink_t : public cachesim_row_sink_t {
+public:
+    cachesim_columnar_sink_t(const std::string &filename, bool expanded);
+    ~cachesim_columnar_sink_t() override;
+    void
+    write_rows(const cachesim_row_ring_t &rows,
+               const cachesim_string_table_t &strings) override;
+    void
+    close() override;
+    std::string
+    get_file_extension() const override
+    {
+        return ".rows";
+    }
+
+private:
+    void
+    write_column(cachesim_column_t column, const void *raw, size_t raw_size);
+
+    std::ofstream out_;
+    bool expanded_;
+    // The first string table id not yet written to a dictionary column.
+    uint32_t strings_written_ = 1;
+    std::vector<int32_t> id_deltas_;
+    std::vector<char> dict_buf_;
+    std::vector<char> compress_buf_;
+};
+
+/* Reads back a file written by #cachesim_columnar_sink_t one block at a time. */
+class cachesim_columnar_reader_t {
+public:
+    explicit cachesim_columnar_reader_t(const std::string &filename);
+    bool
+    is_expanded() const
+    {
+        return expanded_;
+    }
+    // Returns the next block, or nullptr at the end of the file.  The returned
+    // rows are valid until the next call.
+    const cachesim_row_ring_t *
+    read_block();
+    // The disassembly strings referenced by all blocks read so far.
+    const cachesim_string_table_t &
+    get_strings() const
+    {
+        return strings_;
+    }
+
+private:
+    std::ifstream in_;
+    bool expanded_ = false;
+    std::unique_ptr<cachesim_row_ring_t> rows_;
+    cachesim_string_table_t strings_;
+};
+
+// Offline conversions from the columnar format to the SQLite database produced by
+// #sqlite_row_sink_t and to a comma-separated file with the same columns.
+void
+cachesim_columnar_to_sqlite(const std::string &columnar_file,
+                            const std::string &db_filename);
+void
+cachesim_columnar_to_csv(const std::string &columnar_file, const std::string &csv_file);
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _CACHESIM_ROW_SINK_H_ */
@@ -82,11 +82,12 @@ is_any_instr_type(trace_type_t type)
 record_filter_t::record_filter_t(
     const std::string &output_dir,
     std::vector<std::unique_ptr<record_filter_func_t>> filters, uint64_t stop_timestamp,
-    unsigned int verbose)
+    unsigned int verbose, bool chunk_index)
     : output_dir_(output_dir)
     , filters_(std::move(filters))
     , stop_timestamp_(stop_timestamp)
     , verbosity_(verbose)
+    , chunk_index_(chunk_index)
 {
     UNUSED(verbosity_);
     UNUSED(output_prefix_);
@@ -112,7 +113,11 @@ record_filter_t::get_writer(per_shard_t *per_shard, memtrace_stream_t *shard_str
 #ifdef HAS_ZLIB
     if (ends_with(per_shard->output_path, ".gz")) {
         VPRINT(this, 3, "Using the gzip writer for %s\n", per_shard->output_path.c_str());
-        return std::unique_ptr<std::ostream>(new gzip_ostream_t(per_shard->output_path));
+        auto writer = std::unique_ptr<gzip_ostream_t>(
+            new gzip_ostream_t(per_shard->output_path, chunk_index_));
+        if (chunk_index_)
+            per_shard->archive = writer.get();
+        return writer;
     }
 #endif
     VPRINT(this, 3, "Using the default writer for %s\n", per_shard->output_path.c_str());
@@ -133,7 +138,8 @@ record_filter_t::parallel_shard_init_stream(int shard_index, void *worker_data,
     if (!per_shard->writer) {
         per_shard->error = "Could not open a writer for " + per_shard->output_path;
         success_ = false;
-    }
+    } else if (per_shard->archive != nullptr && !open_new_chunk(per_shard))
+        success_ = false;
     for (auto &f : filters_) {
         per_shard->filter_shard_data.push_back(
             f->parallel_shard_init(shard_stream, stop_timestamp_ != 0));
@@ -157,6 +163,14 @@ record_filter_t::parallel_shard_exit(void *shard_data)
         if (!filters_[i]->parallel_shard_exit(per_shard->filter_shard_data[i]))
             res = false;
     }
+    if (per_shard->archive != nullptr) {
+        std::string error = per_shard->archive->close();
+        per_shard->archive = nullptr;
+        if (!error.empty()) {
+            per_shard->error = error + " for " + per_shard->output_path;
+            res = false;
+        }
+    }
     // Destroy the writer since we do not need it anymore. This also makes sure
     // that data is written out to the file; curiously, a simple flush doesn't
     // do it.
@@ -171,6 +185,22 @@ record_filter_t::parallel_shard_error(void *shard_data)
     return per_shard->error;
 }
 
+bool
+record_filter_t::open_new_chunk(per_shard_t *shard)
+{
+    shard->error = shard->archive->open_new_component("");
+    if (shard->error.empty()) {
+        shard->error = shard->archive->index_component(shard->output_instr_count,
+                                                       shard->last_timestamp);
+    }
+    if (!shard->error.empty()) {
+        shard->error += " for " + shard->output_path;
+        success_ = false;
+        return false;
+    }
+    return true;
+}
+
 bool
 record_filter_t::write_trace_entry(per_shard_t *shard, const trace_entry_t &entry)
 {
@@ -180,6 +210,20 @@ record_filter_t::write_trace_entry(per_shard_t *shard, const trace_entry_t &entr
         return false;
     }
     ++shard->output_entry_count;
+    if (type_is_instr(static_cast<trace_type_t>(entry.type)))
+        ++shard->output_instr_count;
+    else if (entry.type == TRACE_TYPE_INSTR_BUNDLE)
+        shard->output_instr_count += entry.size;
+    else if (entry.type == TRACE_TYPE_MARKER) {
+        if (entry.size == TRACE_MARKER_TYPE_TIMESTAMP)
+            shard->last_timestamp = entry.addr;
+        else if (entry.size == TRACE_MARKER_TYPE_CHUNK_FOOTER &&
+                 shard->archive != nullptr) {
+            // The input's next chunk is self-contained (it repeats the timestamp,
+            // cpu, and encodings) so we start a new chunk here too.
+            return open_new_chunk(shard);
+        }
+    }
     return true;
 }
 
@@ -43,6 +43,7 @@
 #include <vector>
 
 #include "analysis_tool.h"
+#include "archive_ostream.h"
 #include "memref.h"
 #include "memtrace_stream.h"
 #include "trace_entry.h"
@@ -114,9 +115,12 @@ public:
         std::string error_string_;
     };
 
+    // If chunk_index is set, gzip output files are split into self-contained chunks
+    // at the input's chunk boundaries and each is given a trace_index_t.
     record_filter_t(const std::string &output_dir,
                     std::vector<std::unique_ptr<record_filter_func_t>> filters,
-                    uint64_t stop_timestamp, unsigned int verbose);
+                    uint64_t stop_timestamp, unsigned int verbose,
+                    bool chunk_index = false);
     ~record_filter_t() override;
     bool
     process_memref(const trace_entry_t &entry) override;
@@ -138,6 +142,11 @@ protected:
     struct per_shard_t {
         std::string output_path;
         std::unique_ptr<std::ostream> writer;
+        // Set when "writer" is an archive, which is split into indexed chunks at
+        // the input's chunk boundaries.
+        archive_ostream_t *archive = nullptr;
+        uint64_t output_instr_count = 0;
+        uint64_t last_timestamp = 0;
         std::string error;
         std::vector<void *> filter_shard_data;
         std::unordered_map<uint64_t, std::vector<trace_entry_t>> delayed_encodings;
@@ -162,10 +171,14 @@ private:
     bool
     write_trace_entries(per_shard_t *shard, const std::vector<trace_entry_t> &entries);
 
+    bool
+    open_new_chunk(per_shard_t *shard);
+
     std::string output_dir_;
     std::vector<std::unique_ptr<record_filter_func_t>> filters_;
     uint64_t stop_timestamp_;
     unsigned int verbosity_;
+    bool chunk_index_;
     const char *output_prefix_ = "[record_filter]";
 };
 
@@ -110,6 +110,33 @@ histogram_t::parallel_shard_exit(void *shard_data)
     return true;
 }
 
+bool
+histogram_t::parallel_chunk_supported()
+{
+    return true;
+}
+
+void *
+histogram_t::parallel_chunk_init_stream(int shard_index, int chunk_index,
+                                        void *worker_data, memtrace_stream_t *stream)
+{
+    // This is not added to shard_map_ as it is merged into the shard's first piece.
+    return reinterpret_cast<void *>(new shard_data_t);
+}
+
+bool
+histogram_t::parallel_chunk_merge(void *shard_data, void *chunk_data)
+{
+    shard_data_t *shard = reinterpret_cast<shard_data_t *>(shard_data);
+    shard_data_t *chunk = reinterpret_cast<shard_data_t *>(chunk_data);
+    for (const auto &keyvals : chunk->icache_map)
+        shard->icache_map[keyvals.first] += keyvals.second;
+    for (const auto &keyvals : chunk->dcache_map)
+        shard->dcache_map[keyvals.first] += keyvals.second;
+    delete chunk;
+    return true;
+}
+
 static inline addr_t
 back_align(addr_t addr, addr_t align)
 {
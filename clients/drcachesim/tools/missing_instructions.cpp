@@ -52,7 +52,6 @@
 #include <ctime>
 #include <zlib.h>
 #include <sys/stat.h>
-#include <sqlite3.h>
 
 namespace dynamorio {
 namespace drmemtrace {
@@ -60,7 +59,7 @@ namespace drmemtrace {
 const std::string missing_instructions_t::TOOL_NAME = "Missing_Instructions tool";
 
 void
-missing_instructions_t::get_opcode(const memref_t &memref, cachesim_row &row)
+missing_instructions_t::get_opcode(const memref_t &memref, size_t slot)
 {
 
     static constexpr int name_width = 12;
@@ -102,22 +101,31 @@ missing_instructions_t::get_opcode(const memref_t &memref, cachesim_row &row)
         case TRACE_TYPE_HARDWARE_PREFETCH: name = 29; break;
         }
 
-        row.set_byte_count(static_cast<uint8_t>(memref.data.size));
-        row.set_instr_type(name);
+        row_ring->byte_count[slot] = static_cast<uint8_t>(memref.data.size);
+        row_ring->instr_type[slot] = name;
+        row_ring->disasm_id[slot] = 0;
         return;
     }
 
-    app_pc decode_pc;
+    // Loops revisit the same few pcs many times, so skip the decoding and the
+    // string formatting below when this exact encoding was seen at this pc before.
+    uint64_t encoding_hash = hash_encoding(memref);
+    size_t index = (memref.instr.addr ^ (memref.instr.addr >> 14)) &
+        (DISASM_CACHE_ENTRIES - 1);
+    disasm_cache_entry_t &entry = disasm_cache[index];
+    row_ring->instr_type[slot] = CACHESIM_INSTR_TYPE_INSTR;
+    row_ring->byte_count[slot] = static_cast<uint8_t>(memref.data.size);
+    if (entry.valid && entry.pc == memref.instr.addr &&
+        entry.encoding_hash == encoding_hash && !memref.instr.encoding_is_new) {
+        ++disasm_cache_hits;
+        row_ring->disasm_id[slot] = entry.disasm_id;
+        return;
+    }
+    ++disasm_cache_misses;
+
     auto orig_pc = (app_pc)memref.instr.addr;
-    // if (TESTANY(OFFLINE_FILE_TYPE_ENCODINGS, filetype_)) {
     // The trace has instruction encodings inside it.
-    decode_pc = const_cast<app_pc>(memref.instr.encoding);
-
-    std::string disasm;
-    // auto cached_disasm = disasm_cache_.find(orig_pc);
-    //   if (cached_disasm != disasm_cache_.end()) {
-    //       disasm = cached_disasm->second;
-    //   } else {
+    app_pc decode_pc = const_cast<app_pc>(memref.instr.encoding);
     // MAX_INSTR_DIS_SZ is set to 196 in core/ir/disassemble.h but is not
     // exported so we just use the same value here.
     char buf[196]; // NOSONAR
@@ -129,21 +137,37 @@ missing_instructions_t::get_opcode(const memref_t &memref, cachesim_row &row)
         error_string_ = "Failed to disassemble " + to_hex_string(memref.instr.addr);
         throw std::invalid_argument(error_string_);
     }
-    disasm = buf;
+    // The scratch string keeps its capacity so none of these edits allocate.
+    disasm_scratch.assign(buf);
 
-    auto newline = disasm.find('\n');
-    if (newline != std::string::npos && newline < disasm.size() - 1) {
-        std::stringstream prefix;
-
-        std::string skip_name(name_width, ' ');
-        disasm.insert(newline + 1,
-                      prefix.str() + skip_name + "                               ");
+    auto newline = disasm_scratch.find('\n');
+    if (newline != std::string::npos && newline < disasm_scratch.size() - 1) {
+        // Indent the continuation line past the name column and the encoding bytes.
+        disasm_scratch.insert(newline + 1, name_width + 31, ' ');
     }
-    disasm.erase(std::remove(disasm.begin(), disasm.end(), '\n'), disasm.end());
+    disasm_scratch.erase(
+        std::remove(disasm_scratch.begin(), disasm_scratch.end(), '\n'),
+        disasm_scratch.end());
+
+    entry.valid = true;
+    entry.pc = memref.instr.addr;
+    entry.encoding_hash = encoding_hash;
+    entry.disasm_id = disasm_strings.intern(disasm_scratch);
+    row_ring->disasm_id[slot] = entry.disasm_id;
+}
 
-    row.set_instr_type(30);
-    row.set_disassembly_string(disasm);
-    row.set_byte_count(static_cast<uint8_t>(memref.data.size));
+uint64_t
+missing_instructions_t::hash_encoding(const memref_t &memref)
+{
+    // 64-bit FNV-1a over the encoding bytes.
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t size = std::min(static_cast<size_t>(memref.instr.size),
+                           sizeof(memref.instr.encoding));
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= memref.instr.encoding[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
 }
 
 analysis_tool_t *
@@ -162,6 +186,12 @@ missing_instructions_t::missing_instructions_t(const cache_simulator_knobs_t &kn
     std::string format = knobs_.trace_form;
     std::transform(format.begin(), format.end(), format.begin(), ::tolower);
     use_expanded_trace_format = (format == "expanded");
+    if (max_buffer_size == 0)
+        max_buffer_size = 1;
+    row_ring.reset(new cachesim_row_ring_t(max_buffer_size, use_expanded_trace_format));
+    // MAX_INSTR_DIS_SZ plus the continuation indentation added in get_opcode().
+    disasm_scratch.reserve(256);
+    disasm_cache.resize(DISASM_CACHE_ENTRIES);
 
     std::cout << "Path for logging: " << csv_log_path << "\n";
     create_experiment_insert_statement(knobs_);
@@ -204,19 +234,28 @@ missing_instructions_t::create_experiment_insert_statement(
                      << (knobs.cpu_scheduling ? 1 : 0) << "; "
                      << (knobs.use_physical ? 1 : 0) << "\n";
     experiments_file.close();
-    // Open the corresponding cache statistics CSV file
-    cache_database_filename = csv_log_path + "cache_stats_" + experiment_id + ".db";
+    // Open the corresponding cache statistics output.  SQLite is kept as an
+    // option; the columnar file can be converted to SQLite or CSV offline.
+    std::string base_name = csv_log_path + "cache_stats_" + experiment_id;
+    if (knobs.cachesim_row_format == CACHESIM_ROW_FORMAT_SQLITE) {
+        row_sink.reset(
+            new sqlite_row_sink_t(base_name + ".db", use_expanded_trace_format));
+    } else if (knobs.cachesim_row_format == CACHESIM_ROW_FORMAT_COLUMNAR) {
+        row_sink.reset(new cachesim_columnar_sink_t(base_name + ".rows",
+                                                    use_expanded_trace_format));
+    } else {
+        throw std::invalid_argument("Unknown cachesim_row_format " +
+                                    knobs.cachesim_row_format);
+    }
+    cache_database_filename = base_name + row_sink->get_file_extension();
     std::cerr << "Printing cache stats database to " << cache_database_filename << "\n";
-
-    open_database(cache_database_filename);
-    create_table();
 }
 
 bool
 missing_instructions_t::process_memref(const memref_t &memref)
 {
     if (static_cast<unsigned int>(current_instruction_id) >= max_trace_length) {
-        close_database();
+        close_row_sink();
         return false;
     }
     current_instruction_id++;
@@ -241,18 +280,21 @@ missing_instructions_t::process_memref(const memref_t &memref)
         if (current_instruction_id % 100000 == 0)
             std::cerr << "Doing " << current_instruction_id << std::endl;
 
-        // Knockoff factory methods
-        std::unique_ptr<cachesim_row> row;
+        size_t slot = row_ring->size();
+        row_ring->instr_id[slot] = current_instruction_id;
+        row_ring->core[slot] = static_cast<uint8_t>(core);
+        row_ring->bits[slot] = (thread_switch ? CACHESIM_BIT_THREAD_SWITCH : 0) |
+            (core_switch ? CACHESIM_BIT_CORE_SWITCH : 0);
+        // The expanded counters are the totals before this memref is simulated.
         if (use_expanded_trace_format)
-            row = form_expanded_cachesim_row(core, thread_switch, core_switch);
-        else
-            row = form_cachesim_row(core, thread_switch, core_switch);
-
-        update_miss_stats(core, memref, *row);
-        embed_address_deltas_into_row(*row);
-        if (!(row->get_instr_type() == 30 && row->get_access_address_delta() == 0 &&
-              row->get_pc_address_delta() == 0)) {
-            buffer_row(row);
+            update_expanded_stats(core, slot);
+
+        addr_t pc, addr;
+        update_miss_stats(core, memref, slot, pc, addr);
+        embed_address_deltas_into_row(slot, thread_switch, pc, addr);
+        if (!(row_ring->instr_type[slot] == CACHESIM_INSTR_TYPE_INSTR &&
+              row_ring->access_delta[slot] == 0 && row_ring->pc_delta[slot] == 0)) {
+            buffer_row();
         }
         return true;
     } catch (const std::exception &ex) {
@@ -262,142 +304,74 @@ missing_instructions_t::process_memref(const memref_t &memref)
     }
 }
 
-std::unique_ptr<expanded_cachesim_row>
-missing_instructions_t::form_expanded_cachesim_row(int core, bool thread_switch,
-                                                   bool core_switch)
-{
-    long int l1_data_hits = cache_simulator_t::get_cache_metric(
-        metric_name_t::HITS, 0, core, cache_split_t::DATA);
-    long int l1_inst_hits = cache_simulator_t::get_cache_metric(
-        metric_name_t::HITS, 0, core, cache_split_t::INSTRUCTION);
-    long int l1_data_misses = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 0, core, cache_split_t::DATA);
-    long int l1_inst_misses = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 0, core, cache_split_t::INSTRUCTION);
-    long int ll_hits = cache_simulator_t::get_cache_metric(metric_name_t::HITS, 2, core,
-                                                           cache_split_t::DATA);
-    long int ll_misses = cache_simulator_t::get_cache_metric(metric_name_t::MISSES, 2,
-                                                             core, cache_split_t::DATA);
-
-    float l1_data_ratio = static_cast<float>(l1_data_misses) /
-        static_cast<float>(l1_data_misses + l1_data_hits);
-    float l1_inst_ratio = static_cast<float>(l1_inst_misses) /
-        static_cast<float>(l1_inst_misses + l1_inst_hits);
-    float ll_ratio =
-        static_cast<float>(ll_misses) / static_cast<float>(ll_misses + ll_hits);
-
-    return std::unique_ptr<expanded_cachesim_row>(new expanded_cachesim_row(
-        l1_data_misses, l1_data_hits, l1_inst_hits, l1_inst_misses, ll_hits, ll_misses,
-        l1_data_ratio, l1_inst_ratio, ll_ratio, current_instruction_id, core,
-        thread_switch, core_switch));
-}
-
-std::unique_ptr<cachesim_row>
-missing_instructions_t::form_cachesim_row(int core, bool thread_switch, bool core_switch)
+void
+missing_instructions_t::update_expanded_stats(int core, size_t slot)
 {
-    return std::unique_ptr<cachesim_row>(
-        new cachesim_row(current_instruction_id, core, thread_switch, core_switch));
+    row_ring->l1d_hits[slot] = static_cast<int32_t>(cache_simulator_t::get_cache_metric(
+        metric_name_t::HITS, 0, core, cache_split_t::DATA));
+    row_ring->l1i_hits[slot] = static_cast<int32_t>(cache_simulator_t::get_cache_metric(
+        metric_name_t::HITS, 0, core, cache_split_t::INSTRUCTION));
+    row_ring->l1d_misses[slot] = static_cast<int32_t>(cache_simulator_t::get_cache_metric(
+        metric_name_t::MISSES, 0, core, cache_split_t::DATA));
+    row_ring->l1i_misses[slot] = static_cast<int32_t>(cache_simulator_t::get_cache_metric(
+        metric_name_t::MISSES, 0, core, cache_split_t::INSTRUCTION));
+    row_ring->ll_hits[slot] = static_cast<int32_t>(cache_simulator_t::get_cache_metric(
+        metric_name_t::HITS, 2, core, cache_split_t::DATA));
+    row_ring->ll_misses[slot] = static_cast<int32_t>(cache_simulator_t::get_cache_metric(
+        metric_name_t::MISSES, 2, core, cache_split_t::DATA));
 }
 
 void
-missing_instructions_t::embed_address_deltas_into_row(cachesim_row &row)
+missing_instructions_t::embed_address_deltas_into_row(size_t slot, bool thread_switch,
+                                                      addr_t current_pc,
+                                                      addr_t current_access)
 {
-    try {
+    // Reset last addresses on thread switch
+    if (thread_switch) {
+        last_pc_address = 0;
+        last_access_address = 0;
+    }
 
-        // Reset last addresses on thread switch
-        if (row.get_thread_switch()) {
-            last_pc_address = 0;
-            last_access_address = 0;
-        }
-        // Convert addresses from string to numerical value for delta calculation
-        addr_t current_pc = row.get_pc_address();
-        addr_t current_access = row.get_access_address();
-
-        // Calculate deltas with underflow check
-        int64_t delta_pc =
-            static_cast<int64_t>(current_pc) - static_cast<int64_t>(last_pc_address);
-        int64_t delta_access = static_cast<int64_t>(current_access) -
-            static_cast<int64_t>(last_access_address);
-
-        // Handle potential underflow leading to large positive deltas
-        if (delta_pc < -std::numeric_limits<int32_t>::max() ||
-            delta_pc > std::numeric_limits<int32_t>::max()) {
-            delta_pc = 0; // Reset delta if underflow is detected or the delta is
+    // Calculate deltas with underflow check
+    int64_t delta_pc =
+        static_cast<int64_t>(current_pc) - static_cast<int64_t>(last_pc_address);
+    int64_t delta_access =
+        static_cast<int64_t>(current_access) - static_cast<int64_t>(last_access_address);
+
+    // Handle potential underflow leading to large positive deltas
+    if (delta_pc < -std::numeric_limits<int32_t>::max() ||
+        delta_pc > std::numeric_limits<int32_t>::max()) {
+        delta_pc = 0; // Reset delta if underflow is detected or the delta is
+                      // unreasonably large
+    }
+    if (delta_access < -std::numeric_limits<int32_t>::max() ||
+        delta_access > std::numeric_limits<int32_t>::max()) {
+        delta_access = 0; // Reset delta if underflow is detected or the delta is
                           // unreasonably large
-        }
-        if (delta_access < -std::numeric_limits<int32_t>::max() ||
-            delta_access > std::numeric_limits<int32_t>::max()) {
-            delta_access = 0; // Reset delta if underflow is detected or the delta is
-                              // unreasonably large
-        }
-
-        // Update last addresses
-        last_pc_address = current_pc;
-        last_access_address = current_access;
+    }
 
-        // Construct the output row with deltas
+    // Update last addresses
+    last_pc_address = current_pc;
+    last_access_address = current_access;
 
-        row.set_access_address_delta(static_cast<int>(delta_access));
-        row.set_pc_address_delta(static_cast<int>(delta_pc));
-    } catch (const std::exception &e) {
-        std::cerr << "Exception: " << e.what() << std::endl;
-        throw;
-    }
+    row_ring->access_delta[slot] = static_cast<int32_t>(delta_access);
+    row_ring->pc_delta[slot] = static_cast<int32_t>(delta_pc);
 }
+
 void
 missing_instructions_t::update_miss_stats(int core, const memref_t &memref,
-                                          cachesim_row &row)
+                                          size_t slot, addr_t &pc, addr_t &addr)
 {
+    cache_result_t result;
+    cache_simulator_t::process_memref(memref, &result);
+    bool is_instr = type_is_instr(memref.instr.type) ||
+        memref.instr.type == TRACE_TYPE_PREFETCH_INSTR;
+    bool l1_miss = result.level[0].missed();
+    bool data_miss_l1 = l1_miss && !is_instr;
+    bool inst_miss_l1 = l1_miss && is_instr;
+    // The parent of the L1 caches is the LLC in the knob-configured hierarchy.
+    bool unified_miss_ll = result.level[1].missed();
 
-    long int data_misses_l1_pre = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 0, core, cache_split_t::DATA);
-    long int inst_misses_l1_pre = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 0, core, cache_split_t::INSTRUCTION);
-    long int unified_misses_ll_pre = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 2, core, cache_split_t::DATA);
-
-    cache_simulator_t::process_memref(memref);
-    long int data_misses_l1_post = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 0, core, cache_split_t::DATA);
-    long int inst_misses_l1_post = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 0, core, cache_split_t::INSTRUCTION);
-    long int unified_misses_ll_post = cache_simulator_t::get_cache_metric(
-        metric_name_t::MISSES, 2, core, cache_split_t::DATA);
-
-    auto data_misses_l1 = static_cast<int>(data_misses_l1_post - data_misses_l1_pre);
-    auto inst_misses_l1 = static_cast<int>(inst_misses_l1_post - inst_misses_l1_pre);
-    auto unified_misses_ll =
-        static_cast<int>(unified_misses_ll_post - unified_misses_ll_pre);
-
-    bool data_miss_l1 = false;
-    bool inst_miss_l1 = false;
-    bool unified_miss_ll = false;
-
-    if (data_misses_l1 == 1)
-        data_miss_l1 = true;
-    else if (data_misses_l1 != 0)
-        throw std::runtime_error("Data shouldn't happen...");
-
-    if (1 <= inst_misses_l1 && inst_misses_l1 <= 2)
-        inst_miss_l1 = true;
-    else if (inst_misses_l1 != 0) {
-        std::cout << "Inst misses:" << inst_misses_l1 << std::endl;
-        throw std::runtime_error("Inst shouldn't happen...");
-    }
-
-    if (1 <= unified_misses_ll && unified_misses_ll <= 2)
-        unified_miss_ll = true;
-    else if (unified_misses_ll != 0) {
-        std::string regular_message_pre = "LL miss over 2 shouldn't happen. LL pre: ";
-        std::string regular_message_post = " LL post: ";
-        std::string error_message = regular_message_pre +
-            std::to_string(unified_misses_ll_pre) + regular_message_post +
-            std::to_string(unified_misses_ll_post);
-        throw std::runtime_error(error_message);
-    }
-
-    addr_t pc;
-    addr_t addr;
     if (type_is_instr(memref.data.type)) {
         pc = memref.instr.addr;
         addr = pc;
@@ -409,144 +383,63 @@ missing_instructions_t::update_miss_stats(int core, const memref_t &memref,
         addr = memref.data.addr;
     }
 
-    row.set_pc_address(pc);
-    row.set_access_address(addr);
-    row.set_l1d_miss(data_miss_l1);
-    row.set_l1i_miss(inst_miss_l1);
-    row.set_ll_miss(unified_miss_ll);
-    row.set_core(core);
-    get_opcode(memref, row);
+    row_ring->bits[slot] |= (data_miss_l1 ? CACHESIM_BIT_L1D_MISS : 0) |
+        (inst_miss_l1 ? CACHESIM_BIT_L1I_MISS : 0) |
+        (unified_miss_ll ? CACHESIM_BIT_LL_MISS : 0);
+    get_opcode(memref, slot);
 }
 bool
 missing_instructions_t::print_results()
 {
     std::cerr << TOOL_NAME << " finished.\n";
-    return true;
-}
-
-void
-missing_instructions_t::begin_transaction()
-{
-    char *errmsg;
-    int rc = sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error beginning transaction: " << errmsg;
-        // Handle error appropriately...
-    }
-    sqlite3_free(errmsg);
-}
-
-void
-missing_instructions_t::open_database(const std::string &db_filename)
-{
-    int rc = sqlite3_open(db_filename.c_str(), &db);
-
-    if (rc != SQLITE_OK) {
-        std::cerr << "Cannot open database: " << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        throw std::runtime_error("Failed to open database");
-    }
-}
-
-void
-missing_instructions_t::create_table()
-{
-    const char *sql_create_table = use_expanded_trace_format
-        ? expanded_cachesim_row::create_table_string
-        : cachesim_row::create_table_string;
-
-    char *errmsg;
-    int rc = sqlite3_exec(db, sql_create_table, nullptr, nullptr, &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error: " << errmsg;
-        sqlite3_free(errmsg);
-        throw std::runtime_error("Failed to create table");
-    } else {
-        sqlite3_free(errmsg);
+    uint64_t lookups = disasm_cache_hits + disasm_cache_misses;
+    std::cerr << "Disassembly cache: " << disasm_cache_hits << " hits / " << lookups
+              << " lookups";
+    if (lookups > 0) {
+        std::cerr << " (" << 100.0 * disasm_cache_hits / lookups << "% hit rate)";
     }
+    std::cerr << "\n";
+    return true;
 }
 
 void
-missing_instructions_t::buffer_row(std::unique_ptr<cachesim_row> &row)
+missing_instructions_t::buffer_row()
 {
-    row_buffer.push_back(std::move(row));
+    row_ring->commit();
 
-    if (row_buffer.size() % 100000 == 0) {
-        std::cout << "buffer at " << row_buffer.size() << std::endl;
+    if (row_ring->size() % 100000 == 0) {
+        std::cout << "buffer at " << row_ring->size() << std::endl;
     }
-    if (row_buffer.size() >= max_buffer_size) { // Check if we've reached the buffer limit
-        flush_buffer_to_database();
+    if (row_ring->full()) { // Check if we've reached the buffer limit
+        flush_buffer_to_sink();
     }
 }
 
 void
-missing_instructions_t::flush_buffer_to_database()
+missing_instructions_t::flush_buffer_to_sink()
 {
     std::cout << "Flushing buffer!" << std::endl;
-
     try {
-        begin_transaction(); // Start the transaction
-
-        // Preparing the SQL statement once, instead of re-preparing it for every row
-        const char *sql_insert = use_expanded_trace_format
-            ? expanded_cachesim_row::insert_row_string
-            : cachesim_row::insert_row_string;
-
-        sqlite3_stmt *stmt;
-        int rc = sqlite3_prepare_v2(db, sql_insert, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
-            std::stringstream ss;
-            ss << "Cannot prepare insert statement: " << sqlite3_errmsg(db);
-            std::string error_msg = ss.str();
-            std::cerr << error_msg << std::endl;
-            throw std::runtime_error(error_msg);
-        }
-
-        for (auto const &row : row_buffer) {
-            row->insert_into_database(stmt);
-            rc = sqlite3_step(stmt);
-            if (rc != SQLITE_DONE) {
-                std::stringstream ss;
-                ss << "Insertion failed: " << sqlite3_errmsg(db);
-                std::string error_msg = ss.str();
-                std::cerr << error_msg << std::endl;
-                throw std::runtime_error(error_msg);
-            }
-            // Reset the statement to reuse it for the next insert
-            sqlite3_reset(stmt);
-        }
-        end_transaction(); // Commit the transaction
+        row_sink->write_rows(*row_ring, disasm_strings);
         std::cout << "Clearing buffer..." << std::endl;
     } catch (const std::exception &e) {
         std::cerr << "Exception occurred during flushing: " << e.what() << std::endl;
         throw;
     }
-    row_buffer.clear(); // Clear the buffer for the next batch
-    row_buffer.shrink_to_fit();
-    std::vector<std::unique_ptr<cachesim_row>>().swap(row_buffer);
+    row_ring->clear(); // Wrap around for the next batch
 }
 
 void
-missing_instructions_t::end_transaction()
-{
-    char *errmsg;
-    int rc = sqlite3_exec(db, "END TRANSACTION;", nullptr, nullptr, &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error ending transaction: " << errmsg;
-        // Handle error appropriately...
-    }
-    sqlite3_free(errmsg);
-}
-
-void
-missing_instructions_t::close_database()
+missing_instructions_t::close_row_sink()
 {
+    if (row_sink == nullptr)
+        return;
     // After all rows have been buffered and you're done processing
-    if (!row_buffer.empty()) {
-        flush_buffer_to_database();
+    if (!row_ring->empty()) {
+        flush_buffer_to_sink();
     }
-    end_transaction(); // Clean up the prepared statement
-    sqlite3_close(db);
+    row_sink->close();
+    row_sink.reset();
 }
 
 } // namespace drmemtrace
@@ -38,14 +38,14 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "dr_api.h" // Must be before trace_entry.h from analysis_tool.h.
 #include "analysis_tool.h"
 #include "../simulator/cache_simulator.h"
-#include "expanded_cachesim_row.h"
-#include "cachesim_row.h"
+#include "cachesim_row_ring.h"
+#include "cachesim_row_sink.h"
 #include "memref.h"
-#include <sqlite3.h>
 namespace dynamorio {
 namespace drmemtrace {
 class missing_instructions_t : public cache_simulator_t {
@@ -55,12 +55,14 @@ public:
     // XXX: Once we update our toolchains to guarantee C++17 support we could use
     // std::optional here.
 
+    // Fills the instruction type, byte count and disassembly columns of the given
+    // row ring slot.
     void
-    get_opcode(const memref_t &memref, cachesim_row &row);
-    // Destructor to ensure the database is closed
+    get_opcode(const memref_t &memref, size_t slot);
+    // Destructor to ensure the row output is flushed and closed
     ~missing_instructions_t() final
     {
-        close_database();
+        close_row_sink();
     }
     explicit missing_instructions_t(const cache_simulator_knobs_t &knobs);
 
@@ -125,34 +127,46 @@ private:
     void
     create_experiment_insert_statement(const cache_simulator_knobs_t &knobs);
     void
-    update_miss_stats(int core, const memref_t &memref, cachesim_row &row);
+    update_miss_stats(int core, const memref_t &memref, size_t slot, addr_t &pc,
+                      addr_t &addr);
     void
-    embed_address_deltas_into_row(cachesim_row &row);
+    embed_address_deltas_into_row(size_t slot, bool thread_switch, addr_t pc,
+                                  addr_t addr);
     void
-    open_database(const std::string &db_filename);
+    buffer_row();
     void
-    create_table();
+    update_expanded_stats(int core, size_t slot);
     void
-    begin_transaction();
+    flush_buffer_to_sink();
     void
-    buffer_row(std::unique_ptr<cachesim_row> &row);
-    std::unique_ptr<expanded_cachesim_row>
-    form_expanded_cachesim_row(int core, bool thread_switch, bool core_switch);
-    std::unique_ptr<cachesim_row>
-    form_cachesim_row(int core, bool thread_switch, bool core_switch);
-    void
-    flush_buffer_to_database();
-    void
-    end_transaction();
-    void
-    close_database();
+    close_row_sink();
+    static uint64_t
+    hash_encoding(const memref_t &memref);
     std::string cache_database_filename;
     std::string experiments_filename = "experiments.csv";
     std::string csv_log_path = "";
     addr_t last_pc_address = 0;
     addr_t last_access_address = 0;
-    sqlite3 *db = nullptr;
-    std::vector<std::unique_ptr<cachesim_row>> row_buffer;
+    std::unique_ptr<cachesim_row_sink_t> row_sink;
+    // Preallocated to cachesim_row_buffer_size rows so that no per-row heap
+    // allocation happens on the memref path.
+    std::unique_ptr<cachesim_row_ring_t> row_ring;
+    cachesim_string_table_t disasm_strings;
+    // Reused across get_opcode() calls to avoid a string allocation per instruction.
+    std::string disasm_scratch;
+    // A bounded direct-mapped cache from an instruction to its interned disassembly.
+    // Entries are keyed on the pc and a hash of the encoding bytes so that code
+    // modified at the same pc (e.g., by a JIT) is disassembled again.
+    struct disasm_cache_entry_t {
+        addr_t pc = 0;
+        uint64_t encoding_hash = 0;
+        uint32_t disasm_id = 0;
+        bool valid = false;
+    };
+    static constexpr size_t DISASM_CACHE_ENTRIES = 1 << 14;
+    std::vector<disasm_cache_entry_t> disasm_cache;
+    uint64_t disasm_cache_hits = 0;
+    uint64_t disasm_cache_misses = 0;
     unsigned int max_buffer_size;
     unsigned int max_trace_length;
     bool use_expanded_trace_format;
@@ -149,6 +149,36 @@ opcode_mix_t::parallel_shard_exit(void *shard_data)
     return true;
 }
 
+bool
+opcode_mix_t::parallel_chunk_supported()
+{
+    return true;
+}
+
+void *
+opcode_mix_t::parallel_chunk_init_stream(int shard_index, int chunk_index,
+                                         void *worker_data, memtrace_stream_t *stream)
+{
+    // This is not added to shard_map_ as it is merged into the shard's first piece.
+    worker_data_t *worker = reinterpret_cast<worker_data_t *>(worker_data);
+    auto shard = new shard_data_t(worker);
+    // Only the first piece sees the filetype marker.
+    shard->filetype = static_cast<offline_file_type_t>(stream->get_filetype());
+    return reinterpret_cast<void *>(shard);
+}
+
+bool
+opcode_mix_t::parallel_chunk_merge(void *shard_data, void *chunk_data)
+{
+    shard_data_t *shard = reinterpret_cast<shard_data_t *>(shard_data);
+    shard_data_t *chunk = reinterpret_cast<shard_data_t *>(chunk_data);
+    shard->instr_count += chunk->instr_count;
+    for (const auto &keyvals : chunk->opcode_counts)
+        shard->opcode_counts[keyvals.first] += keyvals.second;
+    delete chunk;
+    return true;
+}
+
 bool
 opcode_mix_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
 {
@@ -252,6 +282,10 @@ opcode_mix_t::process_memref(const memref_t &memref)
 static bool
 cmp_val(const std::pair<int, int64_t> &l, const std::pair<int, int64_t> &r)
 {
+    // Break ties by opcode so the order does not depend on the hash table's, which
+    // differs when the counts were gathered by merging split pieces.
+    if (l.second == r.second)
+        return l.first < r.first;
     return (l.second > r.second);
 }
 
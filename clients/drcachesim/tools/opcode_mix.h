@@ -80,6 +80,13 @@ public:
     parallel_shard_memref(void *shard_data, const memref_t &memref) override;
     std::string
     parallel_shard_error(void *shard_data) override;
+    bool
+    parallel_chunk_supported() override;
+    void *
+    parallel_chunk_init_stream(int shard_index, int chunk_index, void *worker_data,
+                               memtrace_stream_t *stream) override;
+    bool
+    parallel_chunk_merge(void *shard_data, void *chunk_data) override;
 
 protected:
     struct worker_data_t {
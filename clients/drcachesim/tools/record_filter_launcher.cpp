@@ -102,6 +102,13 @@ static droption_t<std::string> op_remove_marker_types(
     "Comma-separated integers for marker types to remove. "
     "See trace_marker_type_t for the list of marker types.");
 
+static droption_t<bool> op_chunk_index(
+    DROPTION_SCOPE_FRONTEND, "chunk_index", false,
+    "Split gzip output at the input's chunks and index them",
+    "Splits each gzip output file into self-contained chunks where the input's chunks "
+    "end and writes a table of them to the output file's path plus \".idx\", for "
+    "readers to seek directly to a chunk.");
+
 template <typename T>
 std::vector<T>
 parse_string(const std::string &s, char sep = ',')
@@ -166,7 +173,8 @@ _tmain(int argc, const TCHAR *targv[])
     auto record_filter = std::unique_ptr<record_analysis_tool_t>(
         new dynamorio::drmemtrace::record_filter_t(
             op_output_dir.get_value(), std::move(filter_funcs),
-            op_stop_timestamp.get_value(), op_verbose.get_value()));
+            op_stop_timestamp.get_value(), op_verbose.get_value(),
+            op_chunk_index.get_value()));
     std::vector<record_analysis_tool_t *> tools;
     tools.push_back(record_filter.get());
 
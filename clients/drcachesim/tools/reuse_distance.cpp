@@ -99,12 +99,15 @@ reuse_distance_t::initialize_shard_type(shard_type_t shard_type)
     return "";
 }
 
-reuse_distance_t::shard_data_t::shard_data_t(uint64_t reuse_threshold, uint64_t skip_dist,
-                                             uint32_t distance_limit, bool verify)
+reuse_distance_t::shard_data_t::shard_data_t(uint64_t reuse_threshold,
+                                             uint32_t distance_limit, bool verify,
+                                             double sample_rate,
+                                             unsigned int sample_max_lines)
     : distance_limit(distance_limit)
+    , sampler(sample_rate, sample_max_lines)
 {
-    ref_list = std::unique_ptr<line_ref_list_t>(
-        new line_ref_list_t(reuse_threshold, skip_dist, verify));
+    ref_tree = std::unique_ptr<line_ref_tree_t>(
+        new line_ref_tree_t(cache_map, reuse_threshold, verify));
 }
 
 bool
@@ -117,8 +120,9 @@ void *
 reuse_distance_t::parallel_shard_init_stream(int shard_index, void *worker_data,
                                              memtrace_stream_t *stream)
 {
-    auto shard = new shard_data_t(knobs_.distance_threshold, knobs_.skip_list_distance,
-                                  knobs_.distance_limit, knobs_.verify_skip);
+    auto shard = new shard_data_t(knobs_.distance_threshold, knobs_.distance_limit,
+                                  knobs_.verify_skip, knobs_.sample_rate,
+                                  knobs_.sample_max_lines);
     std::lock_guard<std::mutex> guard(shard_map_mutex_);
     shard->core = stream->get_output_cpuid();
     shard->tid = stream->get_tid();
@@ -166,48 +170,94 @@ reuse_distance_t::parallel_shard_memref(void *shard_data, const memref_t &memref
             ++shard->data_refs;
         }
         addr_t tag = memref.data.addr >> line_size_bits_;
-        std::unordered_map<addr_t, line_ref_t *>::iterator it =
-            shard->cache_map.find(tag);
-        if (it == shard->cache_map.end()) {
-            line_ref_t *ref = new line_ref_t(tag);
-            // insert into the map
-            shard->cache_map.insert(std::pair<addr_t, line_ref_t *>(tag, ref));
-            // insert into the list
-            shard->ref_list->add_to_front(ref);
+        // Each reference to a sampled line stands for "weight" references.
+        uint64_t weight = 1;
+        bool repeats_last = false;
+        if (shard->sampler.active()) {
+            repeats_last = tag == shard->last_tag;
+            shard->last_tag = tag;
+            if (!shard->sampler.is_sampled(tag))
+                return true;
+            weight = shard->sampler.weight();
+        }
+        line_ref_t *ref = shard->cache_map.find(tag);
+        if (ref == nullptr) {
+            // insert into the map and the tree
+            ref = shard->cache_map.insert(tag);
+            shard->ref_tree->add_to_front(tag, ref);
             // See if the line we're adding was previously removed.
             if (shard->pruned_addresses.find(tag) != shard->pruned_addresses.end()) {
                 ++shard->pruned_address_hits;
                 shard->pruned_addresses.erase(tag); // It has been unpruned.
             }
+            // When sampling, each tracked line stands for "weight" lines.
             if (shard->distance_limit > 0 &&
-                shard->distance_limit < shard->cache_map.size()) {
+                shard->cache_map.size() >
+                    std::max<uint64_t>(1, shard->distance_limit / weight)) {
                 // Distance list is too long, so prune most-distant entry.
-                ref = shard->ref_list->tail_; // Get a pointer to the line.
-                assert(ref != NULL);
-                addr_t tag_to_remove = ref->tag;
+                addr_t tag_to_remove = shard->ref_tree->prune_tail();
                 // Move this line from the cache_map to the pruned set.
                 shard->cache_map.erase(tag_to_remove);
                 shard->pruned_addresses.insert(tag_to_remove);
                 ++shard->pruned_address_count;
-                // Remove this oldest entry from the reference list.
-                shard->ref_list->prune_tail();
-                // Delete the no-longer-needed line object
-                delete ref;
+            }
+            if (shard->sampler.active()) {
+                shard->sampler.record_ref();
+                shard->estimated_unique_refs += weight;
+                if (shard->sampler.over_budget(shard->cache_map.size()))
+                    lower_sampling_rate(shard);
             }
         } else {
-            int64_t dist = shard->ref_list->move_to_front(it->second);
+            int64_t dist = shard->ref_tree->move_to_front(tag, ref, weight);
+            if (shard->sampler.active()) {
+                shard->sampler.record_ref();
+                // Unsampled lines may have been referenced in between even if no
+                // sampled one was.
+                if (!repeats_last) {
+                    shard->estimated_unique_refs += weight;
+                    dist = std::max<int64_t>(1, dist * weight);
+                }
+            }
             auto &dist_map = is_instr_type ? shard->dist_map : shard->dist_map_data;
             distance_histogram_t::iterator dist_it = dist_map.find(dist);
             if (dist_it == dist_map.end())
-                dist_map.insert(distance_map_pair_t(dist, 1));
+                dist_map.insert(distance_map_pair_t(dist, weight));
             else
-                ++dist_it->second;
+                dist_it->second += weight;
             IF_DEBUG_VERBOSE(3, std::cerr << "Distance is " << std::dec << dist << "\n");
         }
     }
     return true;
 }
 
+void
+reuse_distance_t::lower_sampling_rate(shard_data_t *shard)
+{
+    while (shard->sampler.over_budget(shard->cache_map.size()) &&
+           shard->sampler.lower_rate()) {
+        std::vector<addr_t> dropped;
+        for (const auto &entry : shard->cache_map) {
+            if (!shard->sampler.is_sampled(entry.first))
+                dropped.push_back(entry.first);
+        }
+        for (addr_t tag : dropped) {
+            shard->ref_tree->remove(shard->cache_map.find(tag));
+            shard->cache_map.erase(tag);
+        }
+        for (auto it = shard->pruned_addresses.begin();
+             it != shard->pruned_addresses.end();) {
+            if (shard->sampler.is_sampled(*it))
+                ++it;
+            else
+                it = shard->pruned_addresses.erase(it);
+        }
+        IF_DEBUG_VERBOSE(1,
+                         std::cerr << "Sampling rate lowered to 1/" << std::dec
+                                   << shard->sampler.weight() << ", dropping "
+                                   << dropped.size() << " lines\n");
+    }
+}
+
 bool
 reuse_distance_t::process_memref(const memref_t &memref)
 {
@@ -215,8 +265,9 @@ reuse_distance_t::process_memref(const memref_t &memref)
     int shard_index = serial_stream_->get_shard_index();
     const auto &lookup = shard_map_.find(shard_index);
     if (lookup == shard_map_.end()) {
-        shard = new shard_data_t(knobs_.distance_threshold, knobs_.skip_list_distance,
-                                 knobs_.distance_limit, knobs_.verify_skip);
+        shard = new shard_data_t(knobs_.distance_threshold, knobs_.distance_limit,
+                                 knobs_.verify_skip, knobs_.sample_rate,
+                                 knobs_.sample_max_lines);
         shard->core = serial_stream_->get_output_cpuid();
         shard->tid = serial_stream_->get_tid();
         shard_map_[shard_index] = shard;
@@ -237,8 +288,8 @@ cmp_dist_key(const reuse_distance_t::distance_map_pair_t &l,
 }
 
 static bool
-cmp_total_refs(const std::pair<addr_t, line_ref_t *> &l,
-               const std::pair<addr_t, line_ref_t *> &r)
+cmp_total_refs(const std::pair<addr_t, const line_ref_t *> &l,
+               const std::pair<addr_t, const line_ref_t *> &r)
 {
     if (l.second->total_refs > r.second->total_refs)
         return true;
@@ -252,8 +303,8 @@ cmp_total_refs(const std::pair<addr_t, line_ref_t *> &l,
 }
 
 static bool
-cmp_distant_refs(const std::pair<addr_t, line_ref_t *> &l,
-                 const std::pair<addr_t, line_ref_t *> &r)
+cmp_distant_refs(const std::pair<addr_t, const line_ref_t *> &l,
+                 const std::pair<addr_t, const line_ref_t *> &r)
 {
     if (l.second->distant_refs > r.second->distant_refs)
         return true;
@@ -276,9 +327,28 @@ reuse_distance_t::print_shard_results(const shard_data_t *shard)
         return;
     std::cerr << "Instruction accesses: " << shard->total_refs - shard->data_refs << "\n";
     std::cerr << "Data accesses: " << shard->data_refs << "\n";
-    std::cerr << "Unique accesses: " << shard->ref_list->cur_time_ << "\n";
-    std::cerr << "Unique cache lines accessed: "
-              << shard->cache_map.size() + shard->pruned_addresses.size() << "\n";
+    if (shard->sampler.active()) {
+        shard->sampler.print(std::cerr, shard->total_refs);
+        // Whole-trace results combine shards whose rates may differ, so only count
+        // the lines sampled at the lowest rate.
+        uint64_t sampled_lines = 0;
+        for (const auto &entry : shard->cache_map) {
+            if (shard->sampler.is_sampled(entry.first))
+                ++sampled_lines;
+        }
+        for (addr_t tag : shard->pruned_addresses) {
+            if (shard->sampler.is_sampled(tag))
+                ++sampled_lines;
+        }
+        std::cerr << "Unique accesses (estimated): " << shard->estimated_unique_refs
+                  << "\n";
+        std::cerr << "Unique cache lines accessed (estimated): "
+                  << sampled_lines * shard->sampler.weight() << "\n";
+    } else {
+        std::cerr << "Unique accesses: " << shard->ref_tree->cur_time_ << "\n";
+        std::cerr << "Unique cache lines accessed: "
+                  << shard->cache_map.size() + shard->pruned_addresses.size() << "\n";
+    }
     std::cerr << "Distance limit: " << shard->distance_limit << "\n";
     std::cerr << "Pruned addresses: " << shard->pruned_address_count << "\n";
     std::cerr << "Pruned address hits: " << shard->pruned_address_hits << "\n";
@@ -324,7 +394,9 @@ reuse_distance_t::print_shard_results(const shard_data_t *shard)
     std::cerr << "\n";
     std::cerr << "Reuse distance threshold = " << knobs_.distance_threshold
               << " cache lines\n";
-    std::vector<std::pair<addr_t, line_ref_t *>> top(knobs_.report_top);
+    if (shard->sampler.active())
+        std::cerr << "(Per-line counts cover only the sampled lines.)\n";
+    std::vector<std::pair<addr_t, const line_ref_t *>> top(knobs_.report_top);
     std::partial_sort_copy(shard->cache_map.begin(), shard->cache_map.end(), top.begin(),
                            top.end(), cmp_total_refs);
     std::cerr << "Top " << top.size() << " frequently referenced cache lines\n";
@@ -332,8 +404,7 @@ reuse_distance_t::print_shard_results(const shard_data_t *shard)
               << ": " << std::setw(17) << "#references  " << std::setw(14)
               << "#distant refs"
               << "\n";
-    for (std::vector<std::pair<addr_t, line_ref_t *>>::iterator it = top.begin();
-         it != top.end(); ++it) {
+    for (auto it = top.begin(); it != top.end(); ++it) {
         if (it->second == NULL) // Very small app.
             break;
         std::cerr << std::setw(18) << std::hex << std::showbase
@@ -350,8 +421,7 @@ reuse_distance_t::print_shard_results(const shard_data_t *shard)
               << ": " << std::setw(17) << "#references  " << std::setw(14)
               << "#distant refs"
               << "\n";
-    for (std::vector<std::pair<addr_t, line_ref_t *>>::iterator it = top.begin();
-         it != top.end(); ++it) {
+    for (auto it = top.begin(); it != top.end(); ++it) {
         if (it->second == NULL) // Very small app.
             break;
         std::cerr << std::setw(18) << std::hex << std::showbase
@@ -452,8 +522,13 @@ reuse_distance_t::get_aggregated_results()
 
     // Otherwise, aggregate the per-shard data to get whole-trace data.
     aggregated_results_ = std::unique_ptr<shard_data_t>(
-        new shard_data_t(knobs_.distance_threshold, knobs_.skip_list_distance,
-                         knobs_.distance_limit, knobs_.verify_skip));
+        new shard_data_t(knobs_.distance_threshold, knobs_.distance_limit,
+                         knobs_.verify_skip, knobs_.sample_rate,
+                         knobs_.sample_max_lines));
+    size_t max_lines = 0;
+    for (const auto &shard : shard_map_)
+        max_lines += shard.second->cache_map.size();
+    aggregated_results_->cache_map.reserve(max_lines);
     for (auto &shard : shard_map_) {
         aggregated_results_->total_refs += shard.second->total_refs;
         aggregated_results_->data_refs += shard.second->data_refs;
@@ -462,7 +537,9 @@ reuse_distance_t::get_aggregated_results()
         // We simply sum the unique accesses.
         // If the user wants the unique accesses over the merged trace they
         // can create a single shard and invoke the parallel operations.
-        aggregated_results_->ref_list->cur_time_ += shard.second->ref_list->cur_time_;
+        aggregated_results_->ref_tree->cur_time_ += shard.second->ref_tree->cur_time_;
+        aggregated_results_->estimated_unique_refs += shard.second->estimated_unique_refs;
+        aggregated_results_->sampler.merge(shard.second->sampler);
         // We merge the pruned_addresses, histogram, and cache_map.
         for (const auto &entry : shard.second->pruned_addresses) {
             aggregated_results_->pruned_addresses.insert(entry);
@@ -483,16 +560,7 @@ reuse_distance_t::get_aggregated_results()
             aggregated_results_->dist_map[entry.first] += entry.second;
         }
         for (const auto &entry : shard.second->cache_map) {
-            const auto &existing = aggregated_results_->cache_map.find(entry.first);
-            line_ref_t *ref;
-            if (existing == aggregated_results_->cache_map.end()) {
-                ref = new line_ref_t(entry.first);
-                aggregated_results_->cache_map.insert(
-                    std::pair<addr_t, line_ref_t *>(entry.first, ref));
-                ref->total_refs = 0;
-            } else {
-                ref = existing->second;
-            }
+            line_ref_t *ref = aggregated_results_->cache_map.insert(entry.first);
             ref->total_refs += entry.second->total_refs;
             ref->distant_refs += entry.second->distant_refs;
         }
@@ -507,11 +575,6 @@ reuse_distance_t::print_results()
     std::cerr << TOOL_NAME << " aggregated results:\n";
     print_shard_results(get_aggregated_results());
 
-    // For regular shards the line_ref_t's are deleted in ~line_ref_list_t.
-    for (auto &iter : get_aggregated_results()->cache_map) {
-        delete iter.second;
-    }
-
     if (shard_map_.size() > 1) {
         using keyval_t = std::pair<int, shard_data_t *>;
         std::vector<keyval_t> sorted(shard_map_.begin(), shard_map_.end());
@@ -40,7 +40,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -52,6 +54,7 @@
 #include "analysis_tool.h"
 #include "memref.h"
 #include "reuse_distance_create.h"
+#include "spatial_sampler.h"
 #include "trace_entry.h"
 
 namespace dynamorio {
@@ -72,8 +75,200 @@ namespace drmemtrace {
 #    define IF_DEBUG_VERBOSE(level, action)
 #endif
 
-struct line_ref_list_t;
-struct line_ref_t;
+// The reference info of a cache line.
+struct line_ref_t {
+    uint64_t time_stamp;   // the slot of the most recent reference to this line
+    uint64_t total_refs;   // the total number of references on this line
+    uint64_t distant_refs; // the total number of distant references on this line
+};
+
+// A hash map from cache line tags to their line_ref_t.  This uses linear probing
+// over one flat array with backward-shift deletion, so there are no per-line
+// allocations and the footprint stays close to the size of the entries, which
+// matters for working sets of hundreds of millions of lines.  Pointers to values
+// are invalidated by insert().
+class line_ref_map_t {
+private:
+    struct entry_t {
+        addr_t tag;
+        line_ref_t ref;
+    };
+    // Tags are addresses shifted right by the line size bits so this is never
+    // a valid tag.
+    static constexpr addr_t TAG_EMPTY = ~static_cast<addr_t>(0);
+
+public:
+    // Iterates over (tag, pointer to line_ref_t) pairs in no particular order.
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<addr_t, const line_ref_t *>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = value_type;
+
+        const_iterator(const entry_t *pos, const entry_t *end)
+            : pos_(pos)
+            , end_(end)
+        {
+            skip_empty();
+        }
+        value_type
+        operator*() const
+        {
+            return value_type(pos_->tag, &pos_->ref);
+        }
+        const_iterator &
+        operator++()
+        {
+            ++pos_;
+            skip_empty();
+            return *this;
+        }
+        bool
+        operator==(const const_iterator &other) const
+        {
+            return pos_ == other.pos_;
+        }
+        bool
+        operator!=(const const_iterator &other) const
+        {
+            return pos_ != other.pos_;
+        }
+
+    private:
+        void
+        skip_empty()
+        {
+            while (pos_ != end_ && pos_->tag == TAG_EMPTY)
+                ++pos_;
+        }
+        const entry_t *pos_;
+        const entry_t *end_;
+    };
+
+    const_iterator
+    begin() const
+    {
+        return const_iterator(entries_.data(), entries_.data() + entries_.size());
+    }
+    const_iterator
+    end() const
+    {
+        return const_iterator(entries_.data() + entries_.size(),
+                              entries_.data() + entries_.size());
+    }
+    size_t
+    size() const
+    {
+        return size_;
+    }
+
+    // Returns the entry for "tag", or nullptr if it is not present.
+    inline line_ref_t *
+    find(addr_t tag)
+    {
+        if (size_ == 0)
+            return nullptr;
+        for (size_t slot = home_slot(tag);; slot = (slot + 1) & mask_) {
+            entry_t &entry = entries_[slot];
+            if (entry.tag == tag)
+                return &entry.ref;
+            if (entry.tag == TAG_EMPTY)
+                return nullptr;
+        }
+    }
+    // Returns the entry for "tag", adding a zeroed one if it is not present.
+    inline line_ref_t *
+    insert(addr_t tag)
+    {
+        assert(tag != TAG_EMPTY);
+        // Keep the load factor at most 3/4.
+        if ((size_ + 1) * 4 > entries_.size() * 3)
+            grow(entries_.empty() ? 16 : entries_.size() * 2);
+        size_t slot = home_slot(tag);
+        while (entries_[slot].tag != TAG_EMPTY && entries_[slot].tag != tag)
+            slot = (slot + 1) & mask_;
+        if (entries_[slot].tag == TAG_EMPTY) {
+            entries_[slot].tag = tag;
+            entries_[slot].ref = line_ref_t();
+            ++size_;
+        }
+        return &entries_[slot].ref;
+    }
+    // Makes room for "count" entries without growing.  Inserting the entries of
+    // another map, which come in hash order, into a smaller table would pile them
+    // up into long probe runs, so merges should reserve first.
+    void
+    reserve(size_t count)
+    {
+        size_t capacity = entries_.empty() ? 16 : entries_.size();
+        while (count * 4 > capacity * 3)
+            capacity *= 2;
+        if (capacity > entries_.size())
+            grow(capacity);
+    }
+    inline void
+    erase(addr_t tag)
+    {
+        if (size_ == 0)
+            return;
+        size_t hole = home_slot(tag);
+        while (entries_[hole].tag != tag) {
+            if (entries_[hole].tag == TAG_EMPTY)
+                return;
+            hole = (hole + 1) & mask_;
+        }
+        --size_;
+        // Shift back any later entry of the run that may live in the hole, so that
+        // lookups never need to skip over deleted slots.
+        for (size_t slot = (hole + 1) & mask_; entries_[slot].tag != TAG_EMPTY;
+             slot = (slot + 1) & mask_) {
+            size_t home = home_slot(entries_[slot].tag);
+            if (((slot - home) & mask_) >= ((slot - hole) & mask_)) {
+                entries_[hole] = entries_[slot];
+                hole = slot;
+            }
+        }
+        entries_[hole].tag = TAG_EMPTY;
+    }
+
+private:
+    inline size_t
+    home_slot(addr_t tag) const
+    {
+        // Fibonacci hashing spreads strided tags over the table.
+        return static_cast<size_t>(
+            (static_cast<uint64_t>(tag) * 0x9e3779b97f4a7c15ULL) >> shift_);
+    }
+    // Rehashes into "capacity" entries, which must be a power of two.
+    void
+    grow(size_t capacity)
+    {
+        std::vector<entry_t> old;
+        old.swap(entries_);
+        entries_.assign(capacity, { TAG_EMPTY, line_ref_t() });
+        mask_ = capacity - 1;
+        shift_ = 64;
+        for (size_t i = capacity; i > 1; i >>= 1)
+            --shift_;
+        for (const entry_t &entry : old) {
+            if (entry.tag == TAG_EMPTY)
+                continue;
+            size_t slot = home_slot(entry.tag);
+            while (entries_[slot].tag != TAG_EMPTY)
+                slot = (slot + 1) & mask_;
+            entries_[slot] = entry;
+        }
+    }
+
+    std::vector<entry_t> entries_;
+    size_t mask_ = 0;
+    int shift_ = 64;
+    size_t size_ = 0;
+};
+
+struct line_ref_tree_t;
 
 class reuse_distance_t : public analysis_tool_t {
 public:
@@ -114,9 +309,9 @@ protected:
     // the shards we're given.  This is for simplicity and to give the user a method
     // for computing over different units if for some reason that was desired.
     struct shard_data_t {
-        shard_data_t(uint64_t reuse_threshold, uint64_t skip_dist,
-                     unsigned int distance_limit, bool verify);
-        std::unordered_map<addr_t, line_ref_t *> cache_map;
+        shard_data_t(uint64_t reuse_threshold, unsigned int distance_limit,
+                     bool verify, double sample_rate, unsigned int sample_max_lines);
+        line_ref_map_t cache_map;
         std::unordered_set<addr_t> pruned_addresses;
         // These are our reuse distance histograms: one for all accesses and one
         // only for data references.  An instruction histogram can be computed by
@@ -131,7 +326,7 @@ protected:
         distance_histogram_t dist_map;
         distance_histogram_t dist_map_data;
         bool dist_map_is_instr_only = true;
-        std::unique_ptr<line_ref_list_t> ref_list;
+        std::unique_ptr<line_ref_tree_t> ref_tree;
         int64_t total_refs = 0;
         int64_t data_refs = 0; // Non-instruction reference count.
         memref_tid_t tid = 0;  // For SHARD_BY_THREAD.
@@ -143,8 +338,21 @@ protected:
         // (pruned_address_hits) from the pruned_addresses set.
         uint64_t pruned_address_count = 0;
         uint64_t pruned_address_hits = 0;
+        // When sampling, only the sampled lines are tracked, the histograms hold
+        // scaled distances and counts, and the unique accesses are estimated here
+        // rather than taken from ref_tree.
+        spatial_sampler_t sampler;
+        uint64_t estimated_unique_refs = 0;
+        // The line of the previous reference, sampled or not: only a reference
+        // repeating it has a true distance of 0.
+        addr_t last_tag = ~static_cast<addr_t>(0);
     };
 
+    // Halves the sampling rate of "shard" until its tracked lines fit the budget,
+    // dropping the lines that are no longer sampled.
+    void
+    lower_sampling_rate(shard_data_t *shard);
+
     void
     print_histogram(std::ostream &out, int64_t total_count,
                     const std::vector<distance_map_pair_t> &sorted,
@@ -169,287 +377,196 @@ protected:
     memtrace_stream_t *serial_stream_ = nullptr;
 };
 
-/* A doubly linked list node for the cache line reference info */
-struct line_ref_t {
-    struct line_ref_t *prev; // the prev line_ref in the list
-    struct line_ref_t *next; // the next line_ref in the list
-    uint64_t time_stamp;     // the most recent reference time stamp on this line
-    uint64_t total_refs;     // the total number of references on this line
-    uint64_t distant_refs;   // the total number of distant references on this line
-    addr_t tag;
-
-    // We have a one-layer skip list for more efficient depth computation.
-    // We inline the fields in every node for simplicity and to reduce allocs.
-    struct line_ref_t *prev_skip; // the prev line_ref in the skip list
-    struct line_ref_t *next_skip; // the next line_ref in the skip list
-    int64_t depth;                // only valid for skip list nodes; -1 for others
-
-    line_ref_t(addr_t val)
-        : prev(NULL)
-        , next(NULL)
-        , total_refs(1)
-        , distant_refs(0)
-        , tag(val)
-        , prev_skip(NULL)
-        , next_skip(NULL)
-        , depth(-1)
-    {
-    }
-};
-
-// We use a doubly linked list to keep track of the cache line reuse distance.
-// The head of the list is the most recently accessed cache line.
-// The earlier a cache line was accessed last time, the deeper that cache line
-// is in the list.
-// If a cache line is accessed, its time stamp is set as current, and it is
-// added/moved to the front of the list.  The cache line reference
-// reuse distance is the cache line position in the list before moving.
-// We also keep a pointer (gate) pointing to the earliest cache
-// line referenced within the threshold.  Thus, we can quickly check
-// whether a cache line is recently accessed by comparing the time
-// stamp of the referenced cache line and the gate cache line.
+// Computes exact reuse distances in O(log n) time for n tracked lines.
 //
-// We have a second doubly-linked list, a one-layer skip list, for
-// more efficient computation of the depth.  Each node in the skip
-// list stores its depth from the front.
-struct line_ref_list_t {
-    line_ref_t *head_;       // the most recently accessed cache line
-    line_ref_t *gate_;       // the earliest cache line refs within the threshold
-    line_ref_t *tail_;       // the least recently accessed cache line
-    uint64_t cur_time_;      // current time stamp
-    uint64_t unique_lines_;  // the total number of unique cache lines accessed
-    uint64_t threshold_;     // the reuse distance threshold
-    uint64_t skip_distance_; // distance between skip list nodes
-    bool verify_skip_;       // check results using brute-force walks
-
-    line_ref_list_t(uint64_t reuse_threshold_, uint64_t skip_dist, bool verify)
-        : head_(NULL)
-        , gate_(NULL)
-        , tail_(NULL)
-        , cur_time_(0)
+// Each tracked line occupies the time slot of its most recent reference, and
+// slots are handed out in increasing order, so the reuse distance of a line (the
+// number of distinct lines referenced since its previous reference) is the
+// number of occupied slots after its own.  A Fenwick tree (binary indexed tree)
+// over the slots counts them.  When the slots run out, the occupied ones are
+// compacted to the front in the same order and the tree is rebuilt; as at least
+// half as many free slots as lines are left each time, this costs O(1) amortized
+// per reference.
+//
+// A reference is distant if its reuse distance is greater than the threshold.
+struct line_ref_tree_t {
+    uint64_t cur_time_;     // the number of references not to the most recent line
+    uint64_t unique_lines_; // the total number of unique cache lines accessed
+    uint64_t threshold_;    // the reuse distance threshold
+    bool verify_;           // check results using brute-force counts
+
+    line_ref_tree_t(line_ref_map_t &lines, uint64_t reuse_threshold, bool verify)
+        : cur_time_(0)
         , unique_lines_(0)
-        , threshold_(reuse_threshold_)
-        , skip_distance_(skip_dist)
-        , verify_skip_(verify)
+        , threshold_(reuse_threshold)
+        , verify_(verify)
+        , lines_(lines)
     {
     }
 
-    virtual ~line_ref_list_t()
-    {
-        line_ref_t *ref;
-        line_ref_t *next;
-        if (head_ == NULL)
-            return;
-        for (ref = head_; ref != NULL; ref = next) {
-            next = ref->next;
-            delete ref;
-        }
-    }
-
-    bool
-    ref_is_distant(line_ref_t *ref)
-    {
-        if (gate_ == NULL || ref->time_stamp >= gate_->time_stamp)
-            return false;
-        return true;
-    }
-
-    void
-    print_list()
-    {
-        std::cerr << "Reuse tag list:\n";
-        for (line_ref_t *node = head_; node != NULL; node = node->next) {
-            std::cerr << "\tTag 0x" << std::hex << node->tag;
-            if (node->depth != -1) {
-                std::cerr << " depth=" << std::dec << node->depth << " prev=" << std::hex
-                          << (node->prev_skip == NULL ? 0 : node->prev_skip->tag)
-                          << " next=" << std::hex
-                          << (node->next_skip == NULL ? 0 : node->next_skip->tag);
-                assert(node->next_skip == NULL || node->next_skip->prev_skip == node);
-            } else
-                assert(node->next_skip == NULL && node->prev_skip == NULL);
-            std::cerr << "\n";
-        }
-    }
-
+    // Makes the new line "tag", whose entry in the map is "ref", the most
+    // recently referenced line.
     void
-    move_skip_fields(line_ref_t *src, line_ref_t *dst)
+    add_to_front(addr_t tag, line_ref_t *ref)
     {
-        dst->prev_skip = src->prev_skip;
-        dst->next_skip = src->next_skip;
-        dst->depth = src->depth;
-        if (src->prev_skip != NULL)
-            src->prev_skip->next_skip = dst;
-        if (src->next_skip != NULL)
-            src->next_skip->prev_skip = dst;
-        src->prev_skip = NULL;
-        src->next_skip = NULL;
-        src->depth = -1;
-    }
-
-    // Add a new cache line to the front of the list.
-    // We may need to move gate_ forward if there are more cache lines
-    // than the threshold so that the gate points to the earliest
-    // referenced cache line within the threshold.
-    void
-    add_to_front(line_ref_t *ref)
-    {
-        IF_DEBUG_VERBOSE(3, std::cerr << "Add tag 0x" << std::hex << ref->tag << "\n");
-        // update head_
-        ref->next = head_;
-        if (head_ != NULL)
-            head_->prev = ref;
-        head_ = ref;
-        if (gate_ == NULL)
-            gate_ = head_;
-        // move gate_ forward if necessary
-        if (unique_lines_ > threshold_)
-            gate_ = gate_->prev;
-        if (tail_ == NULL)
-            tail_ = ref;
-        unique_lines_++;
-        head_->time_stamp = cur_time_++;
-
-        // Add a new skip node if necessary.
-        // We don't bother keeping one right at the front: too much overhead_.
-        uint64_t count = 0;
-        line_ref_t *node, *skip = NULL;
-        for (node = head_; node != NULL && node->depth == -1; node = node->next) {
-            ++count;
-            if (count == skip_distance_)
-                skip = node;
-        }
-        if (count >= 2 * skip_distance_ - 1) {
-            assert(skip != NULL);
-            IF_DEBUG_VERBOSE(3,
-                             std::cerr << "New skip node for tag 0x" << std::hex
-                                       << skip->tag << "\n");
-            skip->depth = skip_distance_ - 1;
-            if (node != NULL) {
-                assert(node->prev_skip == NULL);
-                node->prev_skip = skip;
-            }
-            skip->next_skip = node;
-            assert(skip->prev_skip == NULL);
-        }
-        // Update skip list depths.
-        for (; node != NULL; node = node->next_skip)
-            ++node->depth;
-        IF_DEBUG_VERBOSE(3, print_list());
+        IF_DEBUG_VERBOSE(3, std::cerr << "Add tag 0x" << std::hex << tag << "\n");
+        ref->total_refs = 1;
+        ref->distant_refs = 0;
+        occupy_next_slot(tag, ref);
+        ++unique_lines_;
+        ++cur_time_;
     }
 
-    // Remove the last entry from the distance list.
-    void
+    // Removes the least recently referenced line and returns its tag.
+    addr_t
     prune_tail()
     {
-        // Make sure the tail pointers are legal.
-        assert(tail_ != NULL);
-        assert(tail_ != head_);
-        assert(tail_->next == NULL);
-        assert(tail_->prev != NULL);
-
-        IF_DEBUG_VERBOSE(3,
-                         std::cerr << "Prune tag 0x" << std::hex << tail_->tag << "\n");
-
-        line_ref_t *new_tail = tail_->prev;
-        new_tail->next = NULL;
-
-        // If there's a prior skip, remove its ptr to tail.
-        if (tail_->depth != -1 && tail_->prev_skip != NULL) {
-            tail_->prev_skip->next_skip = NULL;
-        }
-
-        if (tail_ == gate_) {
-            // move gate_ if tail_ was the gate_.
-            gate_ = gate_->prev;
+        assert(num_occupied_ > 1);
+        // Descend the tree to the first slot with a prefix count of 1.
+        uint64_t pos = 0;
+        for (uint64_t step = top_step_; step > 0; step >>= 1) {
+            if (pos + step <= tree_.size() && tree_[pos + step - 1] == 0)
+                pos += step;
         }
-
-        // And finally, update tail_.
-        tail_ = new_tail;
+        addr_t tag = slot_tags_[pos];
+        assert(tag != TAG_FREE);
+        IF_DEBUG_VERBOSE(3, std::cerr << "Prune tag 0x" << std::hex << tag << "\n");
+        vacate_slot(pos);
+        return tag;
     }
 
-    // Move a referenced cache line to the front of the list.
-    // We need to move the gate_ pointer forward if the referenced cache
-    // line is the gate_ cache line or any cache line after.
-    // Returns the reuse distance of ref.
+    // Makes the line "tag", whose entry in the map is "ref", the most recently
+    // referenced line.  Returns the reuse distance of the reference.  When only
+    // sampled lines are tracked, "weight" is the number of lines each stands for:
+    // the returned distance is unscaled but is scaled before the threshold check.
     int64_t
-    move_to_front(line_ref_t *ref)
+    move_to_front(addr_t tag, line_ref_t *ref, uint64_t weight = 1)
     {
-        IF_DEBUG_VERBOSE(
-            3, std::cerr << "Move tag 0x" << std::hex << ref->tag << " to front\n");
-        line_ref_t *prev;
-        line_ref_t *next;
-
+        IF_DEBUG_VERBOSE(3,
+                         std::cerr << "Move tag 0x" << std::hex << tag << " to front\n");
         ref->total_refs++;
-        if (ref == head_)
-            return 0;
-        if (ref_is_distant(ref)) {
-            ref->distant_refs++;
-            gate_ = gate_->prev;
-        } else if (ref == gate_) {
-            // move gate_ if ref is the gate_.
-            gate_ = gate_->prev;
-        }
-        if (ref == tail_) {
-            tail_ = tail_->prev;
-        }
-
-        // Compute reuse distance.
-        int64_t dist = 0;
-        line_ref_t *skip;
-        for (skip = ref; skip != NULL && skip->depth == -1; skip = skip->prev)
-            ++dist;
-        if (skip != NULL)
-            dist += skip->depth;
-        else
-            --dist; // Don't count self.
-
+        int64_t dist =
+            static_cast<int64_t>(num_occupied_ - prefix_count(ref->time_stamp));
         IF_DEBUG_VERBOSE(
-            0, if (verify_skip_) {
-                // Compute reuse distance with a full list walk as a sanity check.
+            0, if (verify_) {
+                // Count the more recent lines one slot at a time as a sanity check.
                 // This is a debug-only option, so we guard with IF_DEBUG_VERBOSE(0).
                 // Yes, the option check branch shows noticeable overhead without it.
                 int64_t brute_dist = 0;
-                for (prev = head_; prev != ref; prev = prev->next)
-                    ++brute_dist;
+                for (uint64_t slot = ref->time_stamp + 1; slot < next_slot_; ++slot) {
+                    if (slot_tags_[slot] != TAG_FREE)
+                        ++brute_dist;
+                }
                 if (brute_dist != dist) {
                     std::cerr << "Mismatch!  Brute=" << std::dec << brute_dist
-                              << " vs skip=" << dist << "\n";
-                    print_list();
+                              << " vs tree=" << dist << "\n";
                     assert(false);
                 }
             });
-
-        // Shift skip nodes between where ref was and head one earlier to
-        // maintain spacing.  This means their depths remain the same.
-        if (skip != NULL) {
-            for (; skip != NULL; skip = next) {
-                next = skip->prev_skip;
-                assert(skip->prev != NULL);
-                move_skip_fields(skip, skip->prev);
-            }
-        } else
-            assert(ref->depth == -1);
-
-        // remove ref from the list
-        prev = ref->prev;
-        next = ref->next;
-        prev->next = next;
-        // ref could be the last
-        if (next != NULL)
-            next->prev = prev;
-        // move ref to the front
-        ref->prev = NULL;
-        ref->next = head_;
-        head_->prev = ref;
-        head_ = ref;
-        head_->time_stamp = cur_time_++;
-
-        IF_DEBUG_VERBOSE(3, print_list());
-        // XXX: we should keep a running mean of the distance, and adjust
-        // knob_reuse_skip_dist to stay close to the mean, for best performance.
+        if (dist == 0)
+            return 0;
+        if (static_cast<uint64_t>(dist) * weight > threshold_)
+            ref->distant_refs++;
+        vacate_slot(ref->time_stamp);
+        occupy_next_slot(tag, ref);
+        ++cur_time_;
         return dist;
     }
+
+    // Stops tracking the line whose entry in the map is "ref".  The caller
+    // removes the entry from the map.
+    void
+    remove(line_ref_t *ref)
+    {
+        IF_DEBUG_VERBOSE(3,
+                         std::cerr << "Remove tag 0x" << std::hex
+                                   << slot_tags_[ref->time_stamp] << "\n");
+        vacate_slot(ref->time_stamp);
+    }
+
+private:
+    static constexpr addr_t TAG_FREE = ~static_cast<addr_t>(0);
+    static constexpr uint64_t MIN_SLOTS = 1024;
+
+    // Returns the number of occupied slots up to and including "slot".
+    inline uint64_t
+    prefix_count(uint64_t slot) const
+    {
+        uint64_t count = 0;
+        for (uint64_t i = slot + 1; i > 0; i &= i - 1)
+            count += tree_[i - 1];
+        return count;
+    }
+    inline void
+    update(uint64_t slot, int delta)
+    {
+        for (uint64_t i = slot + 1; i <= tree_.size(); i += i & (~i + 1))
+            tree_[i - 1] += delta;
+    }
+    inline void
+    vacate_slot(uint64_t slot)
+    {
+        update(slot, -1);
+        slot_tags_[slot] = TAG_FREE;
+        --num_occupied_;
+    }
+    inline void
+    occupy_next_slot(addr_t tag, line_ref_t *ref)
+    {
+        if (next_slot_ == slot_tags_.size())
+            compact();
+        ref->time_stamp = next_slot_;
+        slot_tags_[next_slot_] = tag;
+        update(next_slot_, 1);
+        ++next_slot_;
+        ++num_occupied_;
+    }
+    // Moves the occupied slots to the front, keeping their order, into a table
+    // with room for at least half as many more.
+    void
+    compact()
+    {
+        uint64_t live = 0;
+        for (uint64_t slot = 0; slot < next_slot_; ++slot) {
+            addr_t tag = slot_tags_[slot];
+            if (tag == TAG_FREE)
+                continue;
+            line_ref_t *ref = lines_.find(tag);
+            assert(ref != nullptr && ref->time_stamp == slot);
+            ref->time_stamp = live;
+            slot_tags_[live++] = tag;
+        }
+        assert(live == num_occupied_);
+        uint64_t capacity = std::max(MIN_SLOTS, live + live / 2 + 1);
+        IF_DEBUG_VERBOSE(2,
+                         std::cerr << "Compacting " << std::dec << live
+                                   << " lines into " << capacity << " slots\n");
+        slot_tags_.resize(capacity);
+        std::fill(slot_tags_.begin() + live, slot_tags_.end(), TAG_FREE);
+        slot_tags_.shrink_to_fit();
+        // Node i covers the slots (i - lowbit(i), i] in 1-based terms, of which
+        // exactly those below "live" are occupied.
+        tree_.assign(capacity, 0);
+        for (uint64_t i = 1; i <= capacity; ++i) {
+            uint64_t low = i - (i & (~i + 1));
+            tree_[i - 1] = static_cast<uint32_t>(std::min(i, live) - std::min(low, live));
+        }
+        tree_.shrink_to_fit();
+        top_step_ = 1;
+        while (top_step_ * 2 <= capacity)
+            top_step_ *= 2;
+        next_slot_ = live;
+    }
+
+    line_ref_map_t &lines_;
+    // The tag occupying each slot, or TAG_FREE.
+    std::vector<addr_t> slot_tags_;
+    // The Fenwick tree over the slots: 32 bits per node bound the tracked lines
+    // to 4G, well beyond what fits in memory.
+    std::vector<uint32_t> tree_;
+    uint64_t top_step_ = 0;
+    uint64_t next_slot_ = 0;
+    uint64_t num_occupied_ = 0;
 };
 
 } // namespace drmemtrace
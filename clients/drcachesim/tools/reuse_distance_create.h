@@ -61,17 +61,21 @@ struct reuse_distance_knobs_t {
         , verify_skip(false)
         , verbose(0)
         , histogram_bin_multiplier(1.00)
+        , sample_rate(1.0)
+        , sample_max_lines(0)
     {
     }
     unsigned int line_size;
     bool report_histogram;
     unsigned int distance_threshold;
     unsigned int report_top;
-    unsigned int skip_list_distance;
+    unsigned int skip_list_distance; // Obsolete: ignored.
     unsigned int distance_limit;
     bool verify_skip;
     unsigned int verbose;
     double histogram_bin_multiplier;
+    double sample_rate;
+    unsigned int sample_max_lines;
 };
 
 /** Creates an analysis tool which computes reuse distance. */
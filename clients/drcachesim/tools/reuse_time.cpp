@@ -61,15 +61,19 @@ namespace drmemtrace {
 const std::string reuse_time_t::TOOL_NAME = "Reuse time tool";
 
 analysis_tool_t *
-reuse_time_tool_create(unsigned int line_size, unsigned int verbose)
+reuse_time_tool_create(unsigned int line_size, unsigned int verbose, double sample_rate,
+                       unsigned int sample_max_lines)
 {
-    return new reuse_time_t(line_size, verbose);
+    return new reuse_time_t(line_size, verbose, sample_rate, sample_max_lines);
 }
 
-reuse_time_t::reuse_time_t(unsigned int line_size, unsigned int verbose)
+reuse_time_t::reuse_time_t(unsigned int line_size, unsigned int verbose,
+                           double sample_rate, unsigned int sample_max_lines)
     : knob_verbose_(verbose)
     , knob_line_size_(line_size)
     , line_size_bits_(compute_log2((int)knob_line_size_))
+    , knob_sample_rate_(sample_rate)
+    , knob_sample_max_lines_(sample_max_lines)
 {
 }
 
@@ -104,7 +108,7 @@ void *
 reuse_time_t::parallel_shard_init_stream(int shard_index, void *worker_data,
                                          memtrace_stream_t *stream)
 {
-    auto shard = new shard_data_t();
+    auto shard = new shard_data_t(knob_sample_rate_, knob_sample_max_lines_);
     std::lock_guard<std::mutex> guard(shard_map_mutex_);
     shard->core = stream->get_output_cpuid();
     shard->tid = stream->get_tid();
@@ -157,17 +161,48 @@ reuse_time_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
 
     shard->time_stamp++;
     addr_t line = memref.data.addr >> line_size_bits_;
-    if (shard->time_map.count(line) > 0) {
+    // Each reference to a sampled line stands for "weight" references.
+    int64_t weight = 1;
+    if (shard->sampler.active()) {
+        if (!shard->sampler.is_sampled(line))
+            return true;
+        weight = static_cast<int64_t>(shard->sampler.weight());
+    }
+    bool is_reuse = shard->time_map.count(line) > 0;
+    if (is_reuse) {
         int64_t reuse_time = shard->time_stamp - shard->time_map[line];
         if (DEBUG_VERBOSE(3)) {
             std::cerr << "Reuse " << reuse_time << std::endl;
         }
-        shard->reuse_time_histogram[reuse_time]++;
+        shard->reuse_time_histogram[reuse_time] += weight;
     }
     shard->time_map[line] = shard->time_stamp;
+    if (shard->sampler.active()) {
+        shard->sampler.record_ref();
+        if (!is_reuse && shard->sampler.over_budget(shard->time_map.size()))
+            lower_sampling_rate(shard);
+    }
     return true;
 }
 
+void
+reuse_time_t::lower_sampling_rate(shard_data_t *shard)
+{
+    while (shard->sampler.over_budget(shard->time_map.size()) &&
+           shard->sampler.lower_rate()) {
+        for (auto it = shard->time_map.begin(); it != shard->time_map.end();) {
+            if (shard->sampler.is_sampled(it->first))
+                ++it;
+            else
+                it = shard->time_map.erase(it);
+        }
+        if (DEBUG_VERBOSE(1)) {
+            std::cerr << "Sampling rate lowered to 1/" << shard->sampler.weight()
+                      << std::endl;
+        }
+    }
+}
+
 bool
 reuse_time_t::process_memref(const memref_t &memref)
 {
@@ -175,7 +210,7 @@ reuse_time_t::process_memref(const memref_t &memref)
     int shard_index = serial_stream_->get_shard_index();
     const auto &lookup = shard_map_.find(shard_index);
     if (lookup == shard_map_.end()) {
-        shard = new shard_data_t();
+        shard = new shard_data_t(knob_sample_rate_, knob_sample_max_lines_);
         shard->core = serial_stream_->get_output_cpuid();
         shard->tid = serial_stream_->get_tid();
         shard_map_[shard_index] = shard;
@@ -199,6 +234,8 @@ reuse_time_t::print_shard_results(const shard_data_t *shard)
 {
     std::cerr << "Total accesses: " << shard->time_stamp << "\n";
     std::cerr << "Total instructions: " << shard->total_instructions << "\n";
+    if (shard->sampler.active())
+        shard->sampler.print(std::cerr, shard->time_stamp);
     std::cerr.precision(2);
     std::cerr.setf(std::ios::fixed);
 
@@ -241,11 +278,13 @@ bool
 reuse_time_t::print_results()
 {
     // First, aggregate the per-shard data into whole-trace data.
-    auto aggregate = std::unique_ptr<shard_data_t>(new shard_data_t());
+    auto aggregate = std::unique_ptr<shard_data_t>(
+        new shard_data_t(knob_sample_rate_, knob_sample_max_lines_));
     for (const auto &shard : shard_map_) {
         aggregate->total_instructions += shard.second->total_instructions;
         // We simply sum the accesses.
         aggregate->time_stamp += shard.second->time_stamp;
+        aggregate->sampler.merge(shard.second->sampler);
         // Merge the histograms.
         for (const auto &entry : shard.second->reuse_time_histogram) {
             aggregate->reuse_time_histogram[entry.first] += entry.second;
@@ -41,6 +41,7 @@
 
 #include "analysis_tool.h"
 #include "memref.h"
+#include "spatial_sampler.h"
 #include "trace_entry.h"
 
 namespace dynamorio {
@@ -48,7 +49,8 @@ namespace drmemtrace {
 
 class reuse_time_t : public analysis_tool_t {
 public:
-    reuse_time_t(unsigned int line_size, unsigned int verbose);
+    reuse_time_t(unsigned int line_size, unsigned int verbose, double sample_rate = 1.0,
+                 unsigned int sample_max_lines = 0);
     ~reuse_time_t() override;
     std::string
     initialize_stream(memtrace_stream_t *serial_stream) override;
@@ -74,6 +76,10 @@ protected:
     // Just like for reuse_distance_t, we assume that the shard unit is the unit over
     // which we should measure time.  By default this is a traced thread.
     struct shard_data_t {
+        shard_data_t(double sample_rate, unsigned int sample_max_lines)
+            : sampler(sample_rate, sample_max_lines)
+        {
+        }
         std::unordered_map<addr_t, int64_t> time_map;
         int64_t time_stamp = 0;
         int64_t total_instructions = 0;
@@ -81,14 +87,24 @@ protected:
         memref_tid_t tid = 0; // For SHARD_BY_THREAD.
         int64_t core = 0;     // For SHARD_BY_CORE.
         std::string error;
+        // When sampling, only the sampled lines are in time_map and the histogram
+        // counts are scaled; the reuse times themselves are exact.
+        spatial_sampler_t sampler;
     };
 
     void
     print_shard_results(const shard_data_t *shard);
 
+    // Halves the sampling rate of "shard" until its tracked lines fit the budget,
+    // dropping the lines that are no longer sampled.
+    void
+    lower_sampling_rate(shard_data_t *shard);
+
     const unsigned int knob_verbose_;
     const unsigned int knob_line_size_;
     const unsigned int line_size_bits_;
+    const double knob_sample_rate_;
+    const unsigned int knob_sample_max_lines_;
 
     static const std::string TOOL_NAME;
 
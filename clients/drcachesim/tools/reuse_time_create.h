@@ -49,11 +49,13 @@ namespace drmemtrace {
 /**
  * Creates an analysis tool which computes reuse time (i.e., reuse
  * distance without regard to uniqueness).  The options are currently
- * documented in \ref sec_drcachesim_ops.
+ * documented in \ref sec_drcachesim_ops.  A \p sample_rate below 1 or a
+ * nonzero \p sample_max_lines enables spatial sampling of cache lines.
  */
 // These options are currently documented in ../common/options.cpp.
 analysis_tool_t *
-reuse_time_tool_create(unsigned int line_size = 64, unsigned int verbose = 0);
+reuse_time_tool_create(unsigned int line_size = 64, unsigned int verbose = 0,
+                       double sample_rate = 1.0, unsigned int sample_max_lines = 0);
 
 } // namespace drmemtrace
 } // namespace dynamorio
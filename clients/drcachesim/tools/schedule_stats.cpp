@@ -149,6 +149,18 @@ schedule_stats_t::parallel_shard_exit(void *shard_data)
         shard->counters.cpu_microseconds +=
             get_current_microseconds() - shard->segment_start_microseconds;
     }
+    // Streams not driven by a dynamic scheduler return -1.
+    shard->counters.migrations = std::max<int64_t>(
+        0,
+        shard->stream->get_schedule_statistic(memtrace_stream_t::SCHED_STAT_MIGRATIONS));
+    shard->counters.runqueue_steals = std::max<int64_t>(
+        0,
+        shard->stream->get_schedule_statistic(
+            memtrace_stream_t::SCHED_STAT_RUNQUEUE_STEALS));
+    shard->counters.runqueue_rebalances = std::max<int64_t>(
+        0,
+        shard->stream->get_schedule_statistic(
+            memtrace_stream_t::SCHED_STAT_RUNQUEUE_REBALANCES));
     return true;
 }
 
@@ -362,6 +374,10 @@ schedule_stats_t::print_counters(const counters_t &counters)
               << " maybe-blocking system calls\n";
     std::cerr << std::setw(12) << counters.direct_switch_requests
               << " direct switch requests\n";
+    std::cerr << std::setw(12) << counters.migrations << " migrations\n";
+    std::cerr << std::setw(12) << counters.runqueue_steals << " runqueue steals\n";
+    std::cerr << std::setw(12) << counters.runqueue_rebalances
+              << " runqueue rebalances\n";
     std::cerr << std::setw(12) << counters.waits << " waits\n";
     std::cerr << std::setw(12) << counters.idles << " idles\n";
     print_percentage(static_cast<double>(counters.instrs),
@@ -92,6 +92,9 @@ public:
             idle_microseconds += rhs.idle_microseconds;
             idle_micros_at_last_instr += rhs.idle_micros_at_last_instr;
             cpu_microseconds += rhs.cpu_microseconds;
+            migrations += rhs.migrations;
+            runqueue_steals += rhs.runqueue_steals;
+            runqueue_rebalances += rhs.runqueue_rebalances;
             for (const memref_tid_t tid : rhs.threads) {
                 threads.insert(tid);
             }
@@ -109,6 +112,10 @@ public:
         uint64_t idle_microseconds = 0;
         uint64_t idle_micros_at_last_instr = 0;
         uint64_t cpu_microseconds = 0;
+        // These come from the scheduler and are only available for core-sharded runs.
+        int64_t migrations = 0;
+        int64_t runqueue_steals = 0;
+        int64_t runqueue_rebalances = 0;
         std::unordered_set<memref_tid_t> threads;
     };
     counters_t
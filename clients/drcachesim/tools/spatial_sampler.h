@@ -0,0 +1,178 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* spatial_sampler: hash-based sampling of cache lines for the reuse tools.
+ */
+
+#ifndef _SPATIAL_SAMPLER_H_
+#define _SPATIAL_SAMPLER_H_ 1
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "memref.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+// Spatial sampling of cache lines in the manner of SHARDS (Waldspurger et al.,
+// "Efficient MRC Construction with SHARDS", FAST 2015).  A line is tracked only if
+// a hash of its tag selects it, and every reference to a tracked line is seen, so
+// reuse statistics over the tracked lines estimate those over all lines once
+// distances and counts are scaled by the inverse of the sampling rate.
+//
+// Rates here are of the form 1/modulus: a line is sampled if its hash is a
+// multiple of the modulus.  When a budget of tracked lines is given and exceeded,
+// the modulus is doubled, which keeps half of the sampled lines (in expectation),
+// and the caller drops the rest.  Each sample is weighted by the modulus in effect
+// when it was taken, which is always an integer, so scaled counts stay exact
+// integers.
+class spatial_sampler_t {
+public:
+    // A "rate" of 1 with a "max_lines" of 0 disables sampling.
+    spatial_sampler_t(double rate, uint64_t max_lines)
+        : max_lines_(max_lines)
+    {
+        assert(rate > 0.);
+        if (rate < 1.)
+            modulus_ = std::max<uint64_t>(1, std::llround(1. / rate));
+        initial_modulus_ = modulus_;
+        active_ = modulus_ > 1 || max_lines_ > 0;
+    }
+
+    // Returns whether sampling is in effect.
+    bool
+    active() const
+    {
+        return active_;
+    }
+    inline bool
+    is_sampled(addr_t tag) const
+    {
+        return modulus_ == 1 || hash(tag) % modulus_ == 0;
+    }
+    // The weight of a sample taken now: the inverse of the current rate.
+    inline uint64_t
+    weight() const
+    {
+        return modulus_;
+    }
+    // Records a reference to a sampled line.
+    inline void
+    record_ref()
+    {
+        ++sampled_refs_;
+        weighted_refs_ += modulus_;
+    }
+    inline bool
+    over_budget(uint64_t tracked_lines) const
+    {
+        return max_lines_ > 0 && tracked_lines > max_lines_;
+    }
+    // Halves the sampling rate.  The caller must then drop the tracked lines
+    // that is_sampled() no longer selects.  Returns false if the rate cannot go
+    // any lower.
+    bool
+    lower_rate()
+    {
+        if (modulus_ > (UINT64_MAX >> 1))
+            return false;
+        modulus_ *= 2;
+        return true;
+    }
+    // Combines the samples of "other" into this one, for whole-trace results.
+    // The combined rate is the lowest of the two; as all shards start at the same
+    // rate and only halve it, the lines it selects were sampled by both.
+    void
+    merge(const spatial_sampler_t &other)
+    {
+        active_ = active_ || other.active_;
+        modulus_ = std::max(modulus_, other.modulus_);
+        sampled_refs_ += other.sampled_refs_;
+        weighted_refs_ += other.weighted_refs_;
+    }
+    // Prints the rate and an error estimate: the sampled references scaled by the
+    // rate estimate "total_refs", which is known exactly.  As all references to a
+    // line are sampled together, this error reflects how unevenly references are
+    // spread over lines, which dominates the error of the other estimates.  No
+    // error bounds are computed for the histograms themselves.
+    void
+    print(std::ostream &out, uint64_t total_refs) const
+    {
+        std::ios_base::fmtflags saved_flags(out.flags());
+        out << std::dec << "Sampling rate: 1/" << modulus_;
+        if (max_lines_ > 0) {
+            out << " (from 1/" << initial_modulus_ << ", tracking at most " << max_lines_
+                << " lines)";
+        }
+        out << "\n";
+        out << "Sampled accesses: " << sampled_refs_ << ", estimating " << weighted_refs_
+            << " total accesses";
+        if (total_refs > 0) {
+            double error = std::abs(static_cast<double>(weighted_refs_) -
+                                    static_cast<double>(total_refs)) /
+                total_refs;
+            out << " (error " << std::fixed << std::setprecision(2) << error * 100.
+                << "%)";
+        }
+        out << "\n";
+        out.flags(saved_flags);
+    }
+
+private:
+    static inline uint64_t
+    hash(addr_t tag)
+    {
+        // The splitmix64 finalizer: nearby tags get unrelated low bits.
+        uint64_t x = static_cast<uint64_t>(tag) + 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t max_lines_;
+    uint64_t modulus_ = 1;
+    uint64_t initial_modulus_ = 1;
+    bool active_ = false;
+    uint64_t sampled_refs_ = 0;
+    uint64_t weighted_refs_ = 0;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _SPATIAL_SAMPLER_H_ */
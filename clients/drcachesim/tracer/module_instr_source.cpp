@@ -0,0 +1,112 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "module_instr_source.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+#include "dr_api.h"
+#include "instru.h"
+#include "raw2trace.h"
+#include "raw2trace_directory.h"
+#include "speculator.h"
+#include "trace_entry.h"
+#include "utils.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+module_instr_source_t::module_instr_source_t(const std::string &module_file_path,
+                                             const std::string &alt_module_dir,
+                                             unsigned int verbosity)
+    : module_file_path_(module_file_path)
+    , alt_module_dir_(alt_module_dir)
+    , verbosity_(verbosity)
+    , directory_(verbosity)
+{
+}
+
+std::string
+module_instr_source_t::initialize()
+{
+    dcontext_.dcontext = dr_standalone_init();
+    std::string error = directory_.initialize_module_file(module_file_path_);
+    if (!error.empty())
+        return "Failed to initialize directory: " + error;
+    module_mapper_ =
+        module_mapper_t::create(directory_.modfile_bytes_, nullptr, nullptr, nullptr,
+                                nullptr, verbosity_, alt_module_dir_);
+    module_mapper_->get_loaded_modules();
+    error = module_mapper_->get_last_error();
+    if (!error.empty())
+        return "Failed to load binaries: " + error;
+    return "";
+}
+
+std::string
+module_instr_source_t::get_instr(addr_t pc, speculated_instr_t &instr)
+{
+    if (!module_mapper_)
+        return "Modules not loaded";
+    app_pc decode_pc;
+    {
+        std::lock_guard<std::mutex> guard(mapper_mutex_);
+        decode_pc =
+            module_mapper_->find_mapped_trace_address(reinterpret_cast<app_pc>(pc));
+        if (!module_mapper_->get_last_error().empty())
+            return "Failed to find mapped address: " + module_mapper_->get_last_error();
+    }
+    instr_t decoded;
+    instr_init(dcontext_.dcontext, &decoded);
+    app_pc next_pc = decode_from_copy(dcontext_.dcontext, decode_pc,
+                                      reinterpret_cast<app_pc>(pc), &decoded);
+    if (next_pc == nullptr || !instr_valid(&decoded)) {
+        instr_free(dcontext_.dcontext, &decoded);
+        return "Failed to decode instruction " + to_hex_string(pc);
+    }
+    instr.size = next_pc - decode_pc;
+    memcpy(instr.encoding, decode_pc, std::min(instr.size, sizeof(instr.encoding)));
+    instr.type = static_cast<trace_type_t>(instru_t::instr_to_instr_type(&decoded));
+    if (instr_is_ubr(&decoded) || instr_is_call_direct(&decoded)) {
+        instr.next_pc = reinterpret_cast<addr_t>(instr_get_branch_target_pc(&decoded));
+    } else
+        instr.next_pc = pc + instr.size;
+    instr_free(dcontext_.dcontext, &decoded);
+    return "";
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
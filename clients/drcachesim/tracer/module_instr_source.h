@@ -0,0 +1,95 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* module_instr_source: supplies speculative instructions from the traced binaries. */
+
+#ifndef _MODULE_INSTR_SOURCE_H_
+#define _MODULE_INSTR_SOURCE_H_ 1
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "dr_api.h" // Must be before trace_entry.h.
+#include "raw2trace.h"
+#include "raw2trace_directory.h"
+#include "speculator.h"
+#include "trace_entry.h"
+
+namespace dynamorio {
+namespace drmemtrace {
+
+/**
+ * A #dynamorio::drmemtrace::binary_instr_source_t which maps the binaries listed
+ * in a trace's module file with #dynamorio::drmemtrace::module_mapper_t and decodes
+ * instructions from them.  Only code in modules is available.
+ */
+class module_instr_source_t : public binary_instr_source_t {
+public:
+    module_instr_source_t(const std::string &module_file_path,
+                          const std::string &alt_module_dir = "",
+                          unsigned int verbosity = 0);
+    /** Loads the modules.  Returns an empty string on success. */
+    std::string
+    initialize();
+    std::string
+    get_instr(addr_t pc, speculated_instr_t &instr) override;
+
+private:
+    struct dcontext_cleanup_last_t {
+    public:
+        ~dcontext_cleanup_last_t()
+        {
+            if (dcontext != nullptr)
+                dr_standalone_exit();
+        }
+        void *dcontext = nullptr;
+    };
+
+    /* We make this the first field so that dr_standalone_exit() is called after
+     * destroying the other fields which may use DR heap.
+     */
+    dcontext_cleanup_last_t dcontext_;
+    std::string module_file_path_;
+    std::string alt_module_dir_;
+    unsigned int verbosity_ = 0;
+    // module_mapper_t caches the last module looked up, so we serialize callers.
+    std::mutex mapper_mutex_;
+    std::unique_ptr<module_mapper_t> module_mapper_;
+    // The mapper references directory_.modfile_bytes_ throughout.
+    raw2trace_directory_t directory_;
+};
+
+} // namespace drmemtrace
+} // namespace dynamorio
+
+#endif /* _MODULE_INSTR_SOURCE_H_ */
@@ -40,6 +40,7 @@
 #include <sys/types.h>
 
 #include <atomic>
+#include <climits>
 #include <cstdint>
 #include <cstring>
 #include <string>
@@ -334,10 +335,331 @@ open_new_window_dir(ptr_int_t window_num)
     NOTIFY(2, "Created new window dir %s\n", windir);
 }
 
+// Compresses, if requested, and writes trace data to the thread's file.  For
+// -raw_compress_threads this is called on a compression thread.
+static void
+write_thread_file(per_thread_t *data, thread_id_t tid, byte *towrite_start, ssize_t size)
+{
+    ssize_t wrote;
+#ifdef HAS_SNAPPY
+    if (op_offline.get_value() && snappy_enabled())
+        wrote = data->snappy_writer->compress_and_write(towrite_start, size);
+    else
+#endif
+#ifdef HAS_ZLIB
+        if (op_offline.get_value() &&
+            (op_raw_compress.get_value() == "zlib" ||
+             op_raw_compress.get_value() == "gzip")) {
+        data->zstream.next_in = (Bytef *)towrite_start;
+        data->zstream.avail_in = static_cast<uInt>(size);
+        int res;
+        do {
+            data->zstream.next_out = (Bytef *)data->buf_compressed;
+            data->zstream.avail_out = static_cast<uInt>(max_buf_size);
+            res = deflate(&data->zstream, Z_NO_FLUSH);
+            NOTIFY(3, "deflate => %d in=%d out=%d => in=%d, out=%d, write=%d\n", res,
+                   size, size, data->zstream.avail_in, data->zstream.avail_out,
+                   max_buf_size - data->zstream.avail_out);
+            DR_ASSERT(res != Z_STREAM_ERROR);
+            wrote = file_ops_func.write_file(data->file, data->buf_compressed,
+                                             max_buf_size - data->zstream.avail_out);
+        } while (data->zstream.avail_out == 0);
+        DR_ASSERT(data->zstream.avail_in == 0);
+        wrote = size;
+    } else
+#endif
+#ifdef HAS_LZ4
+        if (op_offline.get_value() && op_raw_compress.get_value() == "lz4") {
+        size_t res = LZ4F_compressUpdate(data->lzcxt, data->buf_lz4, data->buf_lz4_size,
+                                         towrite_start, size, nullptr);
+        DR_ASSERT(!LZ4F_isError(res));
+        wrote = file_ops_func.write_file(data->file, data->buf_lz4, res);
+        DR_ASSERT(static_cast<size_t>(wrote) == res);
+        wrote = size;
+    } else
+#endif
+        wrote = file_ops_func.write_file(data->file, towrite_start, size);
+    if (wrote < size) {
+        FATAL("Fatal error: failed to write trace for T%d window %zd: wrote %zd "
+              "of %zd\n",
+              tid, get_local_window(data), wrote, size);
+    }
+}
+
+/***************************************************************************
+ * Asynchronous compression for -raw_compress_threads.
+ *
+ * Full trace buffers are copied into one of two staging buffers per thread and
+ * handed to a compression client thread, so the application thread only pays
+ * for the copy.  It waits only when both of its staging buffers are in flight.
+ * Each application thread is bound to a single compression thread, which keeps
+ * its file data in order and never uses its compression state concurrently.
+ * The compression threads are created at init (DR holds them until the
+ * application starts running).  They are stopped in the exit event, or before DR
+ * starts a detach, after which any remaining output is written synchronously.
+ * A stopped thread idles until DR terminates it.
+ */
+
+struct compress_worker_t;
+
+struct compress_job_t {
+    async_output_t *output;
+    int index;
+    compress_job_t *next;
+};
+
+struct async_output_t {
+    per_thread_t *data;
+    thread_id_t tid;
+    compress_worker_t *worker;
+    byte *buf[2];
+    size_t used[2];
+    // The staging buffer being filled by the application thread.
+    int cur;
+    // Guarded by worker->lock.
+    bool in_flight[2];
+    compress_job_t job[2];
+    // Signaled by the worker each time it finishes one of our buffers.
+    void *done;
+};
+
+struct compress_worker_t {
+    void *lock;
+    void *work_ready;
+    // A FIFO of buffers to compress, guarded by lock.
+    compress_job_t *head;
+    compress_job_t *tail;
+    // Set under lock by stop_compress_threads() to stop the thread once its
+    // FIFO is empty.
+    bool exiting;
+    // Signaled by the thread once it no longer touches this struct.
+    void *exited;
+};
+
+static compress_worker_t *compress_workers;
+static uint num_compress_workers;
+static std::atomic<uint> next_compress_worker;
+
+static void
+compress_thread_main(void *arg)
+{
+    compress_worker_t *worker = reinterpret_cast<compress_worker_t *>(arg);
+    // Application threads can be waiting on us from clean calls, where they cannot
+    // reach a synch point, so we must not be suspended for one.  We hold no DR
+    // locks while compressing.
+    dr_client_thread_set_suspendable(false);
+    dr_mutex_lock(worker->lock);
+    while (true) {
+        compress_job_t *job = worker->head;
+        if (job == nullptr) {
+            if (worker->exiting)
+                break;
+            dr_mutex_unlock(worker->lock);
+            dr_event_wait(worker->work_ready);
+            dr_mutex_lock(worker->lock);
+            continue;
+        }
+        worker->head = job->next;
+        if (worker->head == nullptr)
+            worker->tail = nullptr;
+        dr_mutex_unlock(worker->lock);
+        async_output_t *output = job->output;
+        write_thread_file(output->data, output->tid, output->buf[job->index],
+                          output->used[job->index]);
+        dr_mutex_lock(worker->lock);
+        output->in_flight[job->index] = false;
+        dr_event_signal(output->done);
+    }
+    dr_mutex_unlock(worker->lock);
+    dr_event_signal(worker->exited);
+    // We must not return: a client thread exiting while DR synchs with all threads
+    // for process exit or detach can be left on its thread list.  DR terminates us
+    // after the exit event instead (i#297).
+    while (true)
+        dr_sleep(INT_MAX);
+}
+
+static void
+init_compress_workers()
+{
+    if (!op_offline.get_value() || op_raw_compress_threads.get_value() == 0 ||
+        op_raw_compress.get_value() == "none" || compress_workers != nullptr)
+        return;
+    num_compress_workers = op_raw_compress_threads.get_value();
+    compress_workers = static_cast<compress_worker_t *>(
+        dr_global_alloc(num_compress_workers * sizeof(*compress_workers)));
+    for (uint i = 0; i < num_compress_workers; ++i) {
+        compress_worker_t *worker = &compress_workers[i];
+        *worker = {};
+        worker->lock = dr_mutex_create();
+        worker->work_ready = dr_event_create();
+        worker->exited = dr_event_create();
+        if (!dr_create_client_thread(compress_thread_main, worker))
+            FATAL("Fatal error: failed to create compression thread\n");
+    }
+}
+
+static void
+free_compress_workers()
+{
+    for (uint i = 0; i < num_compress_workers; ++i) {
+        dr_event_destroy(compress_workers[i].exited);
+        dr_event_destroy(compress_workers[i].work_ready);
+        dr_mutex_destroy(compress_workers[i].lock);
+    }
+    dr_global_free(compress_workers, num_compress_workers * sizeof(*compress_workers));
+    compress_workers = nullptr;
+    num_compress_workers = 0;
+}
+
+void
+stop_compress_threads()
+{
+    // We are called once per attach, but exit_compress_workers() calls us too.
+    if (compress_workers == nullptr || compress_workers[0].exiting)
+        return;
+    // Each thread finishes its FIFO before it stops, and anything submitted after
+    // that is written by the submitting thread.
+    for (uint i = 0; i < num_compress_workers; ++i) {
+        compress_worker_t *worker = &compress_workers[i];
+        dr_mutex_lock(worker->lock);
+        worker->exiting = true;
+        dr_mutex_unlock(worker->lock);
+        dr_event_signal(worker->work_ready);
+    }
+    for (uint i = 0; i < num_compress_workers; ++i)
+        dr_event_wait(compress_workers[i].exited);
+}
+
+static void
+exit_compress_workers()
+{
+    if (compress_workers == nullptr)
+        return;
+    // All application threads have drained their output by now.
+    stop_compress_threads();
+    free_compress_workers();
+}
+
+static void
+create_async_output(void *drcontext)
+{
+    per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    async_output_t *output =
+        static_cast<async_output_t *>(dr_global_alloc(sizeof(*output)));
+    *output = {};
+    output->data = data;
+    output->tid = dr_get_thread_id(drcontext);
+    uint worker = next_compress_worker.fetch_add(1, std::memory_order_relaxed);
+    output->worker = &compress_workers[worker % num_compress_workers];
+    for (int i = 0; i < 2; ++i) {
+        output->buf[i] = static_cast<byte *>(
+            dr_raw_mem_alloc(max_buf_size, DR_MEMPROT_READ | DR_MEMPROT_WRITE, nullptr));
+        if (output->buf[i] == nullptr)
+            FATAL("Fatal error: out of memory for compression staging buffers.\n");
+        output->job[i].output = output;
+        output->job[i].index = i;
+    }
+    output->done = dr_event_create();
+    data->async_output = output;
+}
+
+static void
+wait_for_staging_buffer(async_output_t *output, int index)
+{
+    compress_worker_t *worker = output->worker;
+    dr_mutex_lock(worker->lock);
+    while (output->in_flight[index]) {
+        dr_mutex_unlock(worker->lock);
+        dr_event_wait(output->done);
+        dr_mutex_lock(worker->lock);
+    }
+    dr_mutex_unlock(worker->lock);
+}
+
+// Hands the current staging buffer to the worker and switches to the other one,
+// waiting for it if the worker has fallen behind.
+static void
+submit_staging_buffer(async_output_t *output)
+{
+    int index = output->cur;
+    if (output->used[index] == 0)
+        return;
+    compress_worker_t *worker = output->worker;
+    compress_job_t *job = &output->job[index];
+    job->next = nullptr;
+    dr_mutex_lock(worker->lock);
+    if (worker->exiting) {
+        // The worker is stopping for a detach, but it first writes what it was
+        // handed, including our other buffer, which must precede this one.
+        dr_mutex_unlock(worker->lock);
+        wait_for_staging_buffer(output, 1 - index);
+        write_thread_file(output->data, output->tid, output->buf[index],
+                          output->used[index]);
+        output->used[index] = 0;
+        return;
+    }
+    output->in_flight[index] = true;
+    if (worker->tail == nullptr)
+        worker->head = job;
+    else
+        worker->tail->next = job;
+    worker->tail = job;
+    dr_mutex_unlock(worker->lock);
+    dr_event_signal(worker->work_ready);
+    output->cur = 1 - index;
+    wait_for_staging_buffer(output, output->cur);
+    output->used[output->cur] = 0;
+}
+
+static void
+stage_trace_data(async_output_t *output, byte *towrite_start, size_t size)
+{
+    if (output->used[output->cur] + size > max_buf_size)
+        submit_staging_buffer(output);
+    while (size > 0) {
+        size_t room = max_buf_size - output->used[output->cur];
+        size_t tocopy = size < room ? size : room;
+        memcpy(output->buf[output->cur] + output->used[output->cur], towrite_start,
+               tocopy);
+        output->used[output->cur] += tocopy;
+        towrite_start += tocopy;
+        size -= tocopy;
+        // Small writes such as v2p buffers are batched, but a full trace buffer
+        // is sent right away so it is compressed while the next one fills.
+        if (output->used[output->cur] >= trace_buf_size / 2)
+            submit_staging_buffer(output);
+    }
+}
+
+// Waits until all of this thread's data has been written, after which its
+// compression state may be used by the application thread again.
+static void
+drain_async_output(async_output_t *output)
+{
+    submit_staging_buffer(output);
+    wait_for_staging_buffer(output, 0);
+    wait_for_staging_buffer(output, 1);
+}
+
+static void
+free_async_output(per_thread_t *data)
+{
+    async_output_t *output = data->async_output;
+    drain_async_output(output);
+    for (int i = 0; i < 2; ++i)
+        dr_raw_mem_free(output->buf[i], max_buf_size);
+    dr_event_destroy(output->done);
+    dr_global_free(output, sizeof(*output));
+    data->async_output = nullptr;
+}
+
 static void
 close_thread_file(void *drcontext)
 {
     per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    if (data->async_output != nullptr)
+        drain_async_output(data->async_output);
 #ifdef HAS_SNAPPY
     if (op_offline.get_value() && snappy_enabled()) {
         data->snappy_writer->~snappy_file_writer_t();
@@ -517,12 +839,35 @@ prepend_offline_thread_header(void *drcontext)
     return size;
 }
 
+/* The largest write to the pipe or ring that is guaranteed not to be
+ * interleaved with other threads' data.
+ */
+static inline ssize_t
+get_ipc_atomic_write_size()
+{
+#ifdef HAS_SHM_RING
+    if (op_ipc_ring_size.get_value() > 0)
+        return ipc_ring.get_atomic_write_size();
+#endif
+    return ipc_pipe.get_atomic_write_size();
+}
+
+static inline ssize_t
+ipc_write(byte *start, ssize_t size)
+{
+#ifdef HAS_SHM_RING
+    if (op_ipc_ring_size.get_value() > 0)
+        return ipc_ring.write(start, size);
+#endif
+    return ipc_pipe.write(start, size);
+}
+
 static inline byte *
 atomic_pipe_write(void *drcontext, byte *pipe_start, byte *pipe_end, ptr_int_t window)
 {
     ssize_t towrite = pipe_end - pipe_start;
-    DR_ASSERT(towrite <= ipc_pipe.get_atomic_write_size() && towrite > 0);
-    if (ipc_pipe.write((void *)pipe_start, towrite) < (ssize_t)towrite) {
+    DR_ASSERT(towrite <= get_ipc_atomic_write_size() && towrite > 0);
+    if (ipc_write(pipe_start, towrite) < towrite) {
         FATAL("Fatal error: failed to write to pipe\n");
     }
     // Re-emit buffer unit header to handle split pipe writes.
@@ -550,54 +895,10 @@ write_trace_data(void *drcontext, byte *towrite_start, byte *towrite_end,
                                            max_buf_size)) {
                 FATAL("Fatal error: failed to hand off trace\n");
             }
+        } else if (data->async_output != nullptr) {
+            stage_trace_data(data->async_output, towrite_start, size);
         } else {
-            ssize_t wrote;
-#ifdef HAS_SNAPPY
-            if (op_offline.get_value() && snappy_enabled())
-                wrote = data->snappy_writer->compress_and_write(towrite_start, size);
-            else
-#endif
-#ifdef HAS_ZLIB
-                if (op_offline.get_value() &&
-                    (op_raw_compress.get_value() == "zlib" ||
-                     op_raw_compress.get_value() == "gzip")) {
-                data->zstream.next_in = (Bytef *)towrite_start;
-                data->zstream.avail_in = static_cast<uInt>(size);
-                int res;
-                do {
-                    data->zstream.next_out = (Bytef *)data->buf_compressed;
-                    data->zstream.avail_out = static_cast<uInt>(max_buf_size);
-                    res = deflate(&data->zstream, Z_NO_FLUSH);
-                    NOTIFY(3, "deflate => %d in=%d out=%d => in=%d, out=%d, write=%d\n",
-                           res, size, size, data->zstream.avail_in,
-                           data->zstream.avail_out,
-                           max_buf_size - data->zstream.avail_out);
-                    DR_ASSERT(res != Z_STREAM_ERROR);
-                    wrote =
-                        file_ops_func.write_file(data->file, data->buf_compressed,
-                                                 max_buf_size - data->zstream.avail_out);
-                } while (data->zstream.avail_out == 0);
-                DR_ASSERT(data->zstream.avail_in == 0);
-                wrote = size;
-            } else
-#endif
-#ifdef HAS_LZ4
-                if (op_offline.get_value() && op_raw_compress.get_value() == "lz4") {
-                size_t res =
-                    LZ4F_compressUpdate(data->lzcxt, data->buf_lz4, data->buf_lz4_size,
-                                        towrite_start, size, nullptr);
-                DR_ASSERT(!LZ4F_isError(res));
-                wrote = file_ops_func.write_file(data->file, data->buf_lz4, res);
-                DR_ASSERT(static_cast<size_t>(wrote) == res);
-                wrote = size;
-            } else
-#endif
-                wrote = file_ops_func.write_file(data->file, towrite_start, size);
-            if (wrote < size) {
-                FATAL("Fatal error: failed to write trace for T%d window %zd: wrote %zd "
-                      "of %zd\n",
-                      dr_get_thread_id(drcontext), get_local_window(data), wrote, size);
-            }
+            write_thread_file(data, dr_get_thread_id(drcontext), towrite_start, size);
         }
         return towrite_start;
     } else {
@@ -767,13 +1068,13 @@ output_buffer(void *drcontext, per_thread_t *data, byte *buf_base, byte *buf_ptr
                 // avoid splitting an instr from its subsequent bundle entry.
                 // An alternative is to have the reader use per-thread state.
                 if ((mem_ref + (1 + MAX_NUM_DELAY_ENTRIES) * instru->sizeof_entry() -
-                     pipe_start) > ipc_pipe.get_atomic_write_size()) {
+                     pipe_start) > get_ipc_atomic_write_size()) {
                     DR_ASSERT(is_ok_to_split_before(
                         instru->get_entry_type(pipe_start + header_size),
                         instru->get_entry_size(pipe_start + header_size)));
                     // Check if we went over the edge waiting for enough entries to
                     // write. If we did, we simply write till the last ok-to-split ref.
-                    if (mem_ref - pipe_start > ipc_pipe.get_atomic_write_size()) {
+                    if (mem_ref - pipe_start > get_ipc_atomic_write_size()) {
                         DR_ASSERT_MSG(
                             last_ok_to_split_ref != nullptr,
                             "Found too many entries without an ok-to-split point");
@@ -797,7 +1098,7 @@ output_buffer(void *drcontext, per_thread_t *data, byte *buf_base, byte *buf_ptr
         // XXX i#2638: if we want to support branch target analysis in online
         // traces we'll need to not split after a branch by carrying a write-final
         // branch forward to the next buffer.
-        if ((buf_ptr - pipe_start) > ipc_pipe.get_atomic_write_size()) {
+        if ((buf_ptr - pipe_start) > get_ipc_atomic_write_size()) {
             DR_ASSERT(
                 is_ok_to_split_before(instru->get_entry_type(pipe_start + header_size),
                                       instru->get_entry_size(pipe_start + header_size)));
@@ -1322,6 +1623,10 @@ init_thread_io(void *drcontext)
         }
     }
 
+    if (op_offline.get_value() && compress_workers != nullptr &&
+        file_ops_func.handoff_buf == NULL)
+        create_async_output(drcontext);
+
     set_local_window(drcontext, -1);
     if (has_tracing_windows())
         set_local_window(drcontext, tracing_window.load(std::memory_order_acquire));
@@ -1419,6 +1724,8 @@ exit_thread_io(void *drcontext)
     }
     if (op_offline.get_value() && data->file != INVALID_FILE)
         close_thread_file(drcontext);
+    if (data->async_output != nullptr)
+        free_async_output(data);
 
 #ifdef HAS_ZLIB
     if (op_offline.get_value() &&
@@ -1479,13 +1786,56 @@ init_io()
 #endif
 
     DR_ASSERT(cur_window_instr_count.is_lock_free());
+
+    init_compress_workers();
 }
 
 void
 exit_io()
 {
     notify_beyond_global_max_once = 0;
+    exit_compress_workers();
 }
 
+#ifdef UNIX
+void
+fork_init_io(void *drcontext)
+{
+    // Only the forking thread exists in the child.  The parent's compression
+    // threads write out whatever the parent staged, so we discard our copies of
+    // its staging buffers and queues and start new threads for the child.
+    // init_thread_in_process() then gives this thread a new staging area.
+    per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    async_output_t *output = data->async_output;
+    if (output != nullptr) {
+        for (int i = 0; i < 2; ++i)
+            dr_raw_mem_free(output->buf[i], max_buf_size);
+        dr_event_destroy(output->done);
+        dr_global_free(output, sizeof(*output));
+        data->async_output = nullptr;
+    }
+#ifdef HAS_ZLIB
+    // We also have a copy of the parent's stream for this thread, while the new
+    // file we are about to open gets a new stream.
+    if (op_raw_compress.get_value() == "zlib" || op_raw_compress.get_value() == "gzip")
+        deflateEnd(&data->zstream);
+#endif
+    if (compress_workers != nullptr) {
+        for (uint i = 0; i < num_compress_workers; ++i) {
+            // A parent thread may have held the lock at the fork, with no one in
+            // the child left to release it, in which case we can only leak it.
+            void *lock = compress_workers[i].lock;
+            if (!dr_mutex_trylock(lock)) {
+                compress_workers[i].lock = dr_mutex_create();
+                continue;
+            }
+            dr_mutex_unlock(lock);
+        }
+        free_compress_workers();
+    }
+    init_compress_workers();
+}
+#endif
+
 } // namespace drmemtrace
 } // namespace dynamorio
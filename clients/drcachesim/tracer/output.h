@@ -49,6 +49,11 @@ append_unit_header(void *drcontext, byte *buf_ptr, thread_id_t tid, ptr_int_t wi
 void
 process_and_output_buffer(void *drcontext, bool skip_size_cap);
 
+// Stops the -raw_compress_threads client threads ahead of a detach.  Output is
+// written synchronously from then on.
+void
+stop_compress_threads();
+
 void
 init_thread_io(void *drcontext);
 
@@ -64,6 +69,11 @@ init_io();
 void
 exit_io();
 
+#ifdef UNIX
+void
+fork_init_io(void *drcontext);
+#endif
+
 // Returns true for an empty new (non-initial) buffer for a tracing window
 // with no instructions traced yet in the window.
 inline bool
@@ -65,6 +65,7 @@
 #include <iomanip>
 #include <memory>
 #include <sstream>
+#include <streambuf>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -98,6 +99,26 @@ namespace drmemtrace {
 
 static online_instru_t instru(NULL, NULL, NULL);
 
+namespace {
+
+// Reads a thread file held in memory, for converting parts of it concurrently.
+class segment_streambuf_t : public std::streambuf {
+public:
+    segment_streambuf_t(const offline_entry_t *start, const offline_entry_t *end)
+    {
+        char *base = reinterpret_cast<char *>(const_cast<offline_entry_t *>(start));
+        setg(base, base, reinterpret_cast<char *>(const_cast<offline_entry_t *>(end)));
+    }
+    // Returns the count of entries read so far.
+    uint64
+    entries_read() const
+    {
+        return (gptr() - eback()) / sizeof(offline_entry_t);
+    }
+};
+
+} // namespace
+
 int
 trace_metadata_writer_t::write_thread_exit(byte *buffer, thread_id_t tid)
 {
@@ -1261,6 +1282,15 @@ raw2trace_t::process_next_thread_buffer(raw2trace_thread_data_t *tdata,
         // when it calls get_next_entry() on its own.
         offline_entry_t entry = *in_entry;
         if (entry.timestamp.type == OFFLINE_TYPE_TIMESTAMP) {
+            if (tdata->segment != nullptr) {
+                bool stop = false;
+                check_segment_cut(tdata, entry, &stop);
+                if (stop) {
+                    // Leave the entry for a serial continuation.
+                    unread_last_entry(tdata);
+                    return true;
+                }
+            }
             VPRINT(2, "Thread %u timestamp 0x" ZHEX64_FORMAT_STRING "\n",
                    (uint)tdata->tid, (uint64)entry.timestamp.usec);
             accumulate_to_statistic(tdata, RAW2TRACE_STAT_EARLIEST_TRACE_TIMESTAMP,
@@ -1336,11 +1366,12 @@ bool
 raw2trace_t::process_thread_file(raw2trace_thread_data_t *tdata)
 {
     bool end_of_file = false;
-    while (!end_of_file) {
+    while (!end_of_file && (tdata->segment == nullptr || !tdata->segment->stopped)) {
         VPRINT(4, "About to read thread #%d==%d at pos %d\n", tdata->index,
                (uint)tdata->tid, (int)tdata->thread_file->tellg());
         if (!process_next_thread_buffer(tdata, &end_of_file) ||
-            (!end_of_file && thread_file_at_eof(tdata))) {
+            (!end_of_file && thread_file_at_eof(tdata) &&
+             (tdata->segment == nullptr || !tdata->segment->stopped))) {
             if (thread_file_at_eof(tdata)) {
                 // Rather than a fatal error we try to continue to provide partial
                 // results in case the disk was full or there was some other issue.
@@ -1438,6 +1469,373 @@ raw2trace_t::process_tasks(std::vector<raw2trace_thread_data_t *> *tasks)
     }
 }
 
+bool
+raw2trace_t::segment_state_t::operator==(const segment_state_t &rhs) const
+{
+    if (!comparable || !rhs.comparable || read_index != rhs.read_index ||
+        pre_read != rhs.pre_read || delayed_branch.size() != rhs.delayed_branch.size() ||
+        delayed_branch_decode_pcs != rhs.delayed_branch_decode_pcs ||
+        delayed_branch_target_pcs != rhs.delayed_branch_target_pcs ||
+        file_type != rhs.file_type ||
+        prev_instr_was_rep_string != rhs.prev_instr_was_rep_string ||
+        last_window != rhs.last_window || last_pc_if_syscall != rhs.last_pc_if_syscall ||
+        last_cpu != rhs.last_cpu || rseq_want_rollback != rhs.rseq_want_rollback ||
+        rseq_ever_saw_entry != rhs.rseq_ever_saw_entry)
+        return false;
+    for (size_t i = 0; i < delayed_branch.size(); ++i) {
+        if (delayed_branch[i].type != rhs.delayed_branch[i].type ||
+            delayed_branch[i].size != rhs.delayed_branch[i].size ||
+            delayed_branch[i].addr != rhs.delayed_branch[i].addr)
+            return false;
+    }
+    return true;
+}
+
+void
+raw2trace_t::get_segment_state(raw2trace_thread_data_t *tdata,
+                               DR_PARAM_OUT segment_state_t *state)
+{
+    thread_segment_t *segment = tdata->segment;
+    state->comparable = !tdata->rseq_buffering_enabled_ && !tdata->last_entry_is_split;
+    state->read_index = segment->warmup_index +
+        static_cast<segment_streambuf_t *>(segment->in_buf.get())->entries_read();
+    state->pre_read.clear();
+    for (const offline_entry_t &entry : tdata->pre_read)
+        state->pre_read.push_back(entry.combined_value);
+    state->delayed_branch.clear();
+    for (const trace_entry_t &entry : tdata->delayed_branch) {
+        if (entry.type != TRACE_TYPE_ENCODING)
+            state->delayed_branch.push_back(entry);
+    }
+    state->delayed_branch_decode_pcs = tdata->delayed_branch_decode_pcs;
+    state->delayed_branch_target_pcs = tdata->delayed_branch_target_pcs;
+    state->file_type = tdata->file_type;
+    state->prev_instr_was_rep_string = tdata->prev_instr_was_rep_string;
+    state->last_window = tdata->last_window;
+    state->last_pc_if_syscall = tdata->last_pc_if_syscall_;
+    state->last_cpu = tdata->last_cpu_;
+    state->rseq_want_rollback = tdata->rseq_want_rollback_;
+    state->rseq_ever_saw_entry = tdata->rseq_ever_saw_entry_;
+}
+
+void
+raw2trace_t::check_segment_cut(raw2trace_thread_data_t *tdata,
+                               const offline_entry_t &entry, DR_PARAM_OUT bool *stop)
+{
+    thread_segment_t *segment = tdata->segment;
+    uint64 read_index = segment->warmup_index +
+        static_cast<segment_streambuf_t *>(segment->in_buf.get())->entries_read();
+    // The cut timestamps are unique, but a look-ahead may have read entries past
+    // the cut, so we also require having read the cut entry itself.
+    if (!segment->recording) {
+        if (read_index <= segment->start_index ||
+            entry.timestamp.usec < segment->start_timestamp)
+            return;
+        if (entry.timestamp.usec > segment->start_timestamp) {
+            // The start unit's timestamp was removed, e.g. with a duplicate syscall.
+            VPRINT(1, "Segment %zu of thread %d missed its start\n", segment->ordinal,
+                   tdata->index);
+            segment->failed = true;
+            segment->stopped = true;
+            *stop = true;
+            return;
+        }
+        VPRINT(2, "Segment %zu of thread %d starts recording\n", segment->ordinal,
+               tdata->index);
+        get_segment_state(tdata, &segment->start_state);
+        segment->recording = true;
+        // Only count statistics for the recorded part.
+        tdata->count_elided = 0;
+        tdata->count_duplicate_syscall = 0;
+        tdata->count_false_syscall = 0;
+        tdata->count_rseq_abort = 0;
+        tdata->count_rseq_side_exit = 0;
+        tdata->earliest_trace_timestamp = (std::numeric_limits<uint64>::max)();
+        tdata->latest_trace_timestamp = 0;
+        tdata->kernel_instr_count = 0;
+        tdata->syscall_traces_decoded = 0;
+        tdata->syscall_traces_injected = 0;
+        return;
+    }
+    while (segment->end < segment->segments->size()) {
+        const thread_segment_t *next = (*segment->segments)[segment->end].get();
+        if (read_index <= next->start_index ||
+            entry.timestamp.usec < next->start_timestamp)
+            return;
+        if (entry.timestamp.usec == next->start_timestamp) {
+            VPRINT(2, "Segment %zu of thread %d stops before segment %zu\n",
+                   segment->ordinal, tdata->index, segment->end);
+            get_segment_state(tdata, &segment->end_state);
+            segment->stopped = true;
+            *stop = true;
+            return;
+        }
+        // We missed the cut; we will need to cover the next segment too.
+        ++segment->end;
+    }
+}
+
+bool
+raw2trace_t::record_segment_write(raw2trace_thread_data_t *tdata,
+                                  const trace_entry_t *start, const trace_entry_t *end,
+                                  app_pc *decode_pcs, size_t decode_pcs_size)
+{
+    thread_segment_t *segment = tdata->segment;
+    if (!segment->recording)
+        return true;
+    size_t instr_ordinal = 0;
+    for (const trace_entry_t *it = start; it < end; ++it) {
+        if (!type_is_instr(static_cast<trace_type_t>(it->type)))
+            continue;
+        if (instr_ordinal < decode_pcs_size)
+            segment->decode_pcs.push_back(decode_pcs[instr_ordinal]);
+        else if (it->size > 0 && TESTANY(OFFLINE_FILE_TYPE_ENCODINGS, tdata->file_type)) {
+            tdata->error = "decode_pcs is missing entries for written instructions";
+            return false;
+        } else
+            segment->decode_pcs.push_back(nullptr);
+        ++instr_ordinal;
+    }
+    segment->entries.insert(segment->entries.end(), start, end);
+    segment->write_ends.push_back(segment->entries.size());
+    return true;
+}
+
+bool
+raw2trace_t::replay_segment(raw2trace_thread_data_t *tdata, thread_segment_t *segment)
+{
+    // A segment's encodings reflect its own history rather than the chunk they
+    // land in.  We drop those already emitted in the current chunk and let write()
+    // insert missing ones.  To decide with the right chunk's history we split each
+    // write() call before every encoding run: this cannot move a chunk boundary as
+    // write() would split there anyway.
+    std::vector<trace_entry_t> buf;
+    std::vector<app_pc> buf_pcs;
+    auto flush = [&]() {
+        if (buf.empty())
+            return true;
+        bool res = write(tdata, buf.data(), buf.data() + buf.size(), buf_pcs.data(),
+                         buf_pcs.size());
+        buf.clear();
+        buf_pcs.clear();
+        return res;
+    };
+    const std::vector<trace_entry_t> &entries = segment->entries;
+    size_t start = 0;
+    size_t pc_idx = 0;
+    bool keep_encoding = true;
+    for (size_t end : segment->write_ends) {
+        for (size_t i = start; i < end; ++i) {
+            const trace_entry_t &entry = entries[i];
+            if (entry.type == TRACE_TYPE_ENCODING) {
+                if (i == start || entries[i - 1].type != TRACE_TYPE_ENCODING) {
+                    if (!flush())
+                        return false;
+                    size_t next_instr = i;
+                    while (next_instr < end &&
+                           !type_is_instr(
+                               static_cast<trace_type_t>(entries[next_instr].type)))
+                        ++next_instr;
+                    // Like the conversion, we record the emission up front.
+                    keep_encoding = next_instr == end ||
+                        record_encoding_emitted(tdata, segment->decode_pcs[pc_idx]);
+                }
+                if (keep_encoding)
+                    buf.push_back(entry);
+                continue;
+            }
+            buf.push_back(entry);
+            if (type_is_instr(static_cast<trace_type_t>(entry.type)))
+                buf_pcs.push_back(segment->decode_pcs[pc_idx++]);
+        }
+        if (!flush())
+            return false;
+        start = end;
+    }
+    std::vector<trace_entry_t>().swap(segment->entries);
+    std::vector<size_t>().swap(segment->write_ends);
+    std::vector<app_pc>().swap(segment->decode_pcs);
+    return true;
+}
+
+void
+raw2trace_t::process_segment_tasks(
+    std::vector<std::unique_ptr<thread_segment_t>> *segments, std::atomic<size_t> *next,
+    int worker, std::mutex *lock, std::condition_variable *done_cond)
+{
+    for (size_t i = next->fetch_add(1); i < segments->size(); i = next->fetch_add(1)) {
+        thread_segment_t *segment = (*segments)[i].get();
+        raw2trace_thread_data_t *tdata = segment->tdata.get();
+        tdata->worker = worker;
+        VPRINT(1, "Worker %d starting on segment %zu of trace thread %d\n", worker, i,
+               tdata->index);
+        if (!process_thread_file(tdata)) {
+            VPRINT(1, "Worker %d hit error %s on segment %zu of trace thread %d\n",
+                   worker, tdata->error.c_str(), i, tdata->index);
+        }
+        {
+            std::lock_guard<std::mutex> guard(*lock);
+            segment->done = true;
+        }
+        done_cond->notify_all();
+    }
+}
+
+bool
+raw2trace_t::process_thread_segments(raw2trace_thread_data_t *tdata)
+{
+    // XXX: We could read ahead only as far as the segments being converted, but
+    // for simplicity we hold the whole file in memory.
+    std::vector<offline_entry_t> raw;
+    std::array<offline_entry_t, 4096> read_buf;
+    while (tdata->thread_file->read(reinterpret_cast<char *>(read_buf.data()),
+                                    sizeof(read_buf)) ||
+           tdata->thread_file->gcount() > 0) {
+        raw.insert(raw.end(), read_buf.begin(),
+                   read_buf.begin() +
+                       tdata->thread_file->gcount() / sizeof(offline_entry_t));
+    }
+    std::vector<std::unique_ptr<thread_segment_t>> segments;
+    segments.emplace_back(new thread_segment_t);
+    std::string error;
+    int version = 0;
+    size_t header_end = 0;
+    if (!raw.empty() &&
+        trace_metadata_reader_t::is_thread_start(&raw[0], &error, &version, nullptr) &&
+        version >= OFFLINE_FILE_VERSION_HEADER_FIELDS_SWAP) {
+        while (header_end < raw.size() &&
+               raw[header_end].timestamp.type != OFFLINE_TYPE_TIMESTAMP)
+            ++header_end;
+        // Segments start at units whose timestamps are larger than all prior ones,
+        // with the prior unit converted too to rebuild state.
+        uint64 max_timestamp = 0;
+        size_t prev_unit = header_end;
+        for (size_t i = header_end; i < raw.size(); ++i) {
+            if (raw[i].timestamp.type != OFFLINE_TYPE_TIMESTAMP)
+                continue;
+            uint64 timestamp = raw[i].timestamp.usec;
+            if (i > header_end && timestamp > max_timestamp &&
+                (i - segments.back()->start_index) * sizeof(offline_entry_t) >=
+                    segment_bytes_) {
+                segments.emplace_back(new thread_segment_t);
+                segments.back()->warmup_index = prev_unit;
+                segments.back()->start_index = i;
+                segments.back()->start_timestamp = timestamp;
+            }
+            max_timestamp = std::max(max_timestamp, timestamp);
+            prev_unit = i;
+        }
+    }
+    if (segments.size() == 1) {
+        segment_streambuf_t in_buf(raw.data(), raw.data() + raw.size());
+        std::istream in_file(&in_buf);
+        std::istream *orig_file = tdata->thread_file;
+        tdata->thread_file = &in_file;
+        tdata->worker = worker_count_;
+        bool res = process_thread_file(tdata);
+        tdata->thread_file = orig_file;
+        return res;
+    }
+    VPRINT(1, "Splitting trace thread %d into %zu segments\n", tdata->index,
+           segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        thread_segment_t *segment = segments[i].get();
+        segment->segments = &segments;
+        segment->ordinal = i;
+        segment->end = i + 1;
+        segment->recording = i == 0;
+        segment->in_buf.reset(new segment_streambuf_t(raw.data() + segment->warmup_index,
+                                                      raw.data() + raw.size()));
+        segment->in_file.reset(new std::istream(segment->in_buf.get()));
+        segment->tdata.reset(new raw2trace_thread_data_t);
+        segment->tdata->index = tdata->index;
+        segment->tdata->thread_file = segment->in_file.get();
+        segment->tdata->segment = segment;
+        if (i > 0) {
+            segment->tdata->pre_read.insert(segment->tdata->pre_read.end(), raw.begin(),
+                                            raw.begin() + header_end);
+        }
+    }
+    std::mutex lock;
+    std::condition_variable done_cond;
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    int thread_count = static_cast<int>(
+        std::min(static_cast<size_t>(worker_count_), segments.size()));
+    threads.reserve(thread_count);
+    for (int i = 0; i < thread_count; ++i) {
+        threads.push_back(std::thread(&raw2trace_t::process_segment_tasks, this,
+                                      &segments, &next, i, &lock, &done_cond));
+    }
+    auto wait_for = [&](thread_segment_t *segment) {
+        std::unique_lock<std::mutex> guard(lock);
+        done_cond.wait(guard, [segment]() { return segment->done; });
+    };
+    auto add_statistics = [tdata](raw2trace_thread_data_t *from) {
+        tdata->count_elided += from->count_elided;
+        tdata->count_duplicate_syscall += from->count_duplicate_syscall;
+        tdata->count_false_syscall += from->count_false_syscall;
+        tdata->count_rseq_abort += from->count_rseq_abort;
+        tdata->count_rseq_side_exit += from->count_rseq_side_exit;
+        tdata->earliest_trace_timestamp =
+            std::min(tdata->earliest_trace_timestamp, from->earliest_trace_timestamp);
+        tdata->latest_trace_timestamp =
+            std::max(tdata->latest_trace_timestamp, from->latest_trace_timestamp);
+        tdata->kernel_instr_count += from->kernel_instr_count;
+        tdata->syscall_traces_decoded += from->syscall_traces_decoded;
+        tdata->syscall_traces_injected += from->syscall_traces_injected;
+    };
+    // We replay each segment once it is converted, while later ones are still being
+    // converted.  "cur" is the segment whose output we are appending.
+    thread_segment_t *cur = segments[0].get();
+    wait_for(cur);
+    bool res = cur->tdata->error.empty();
+    if (!res)
+        tdata->error = cur->tdata->error;
+    else {
+        tdata->version = cur->tdata->version;
+        tdata->file_type = cur->tdata->file_type;
+        tdata->tid = cur->tdata->tid;
+        tdata->cache_line_size = cur->tdata->cache_line_size;
+        tdata->saw_header = true;
+        res = replay_segment(tdata, cur);
+    }
+    while (res && cur->stopped) {
+        thread_segment_t *next_segment = segments[cur->end].get();
+        wait_for(next_segment);
+        if (next_segment->tdata->error.empty() && next_segment->recording &&
+            !next_segment->failed && cur->end_state == next_segment->start_state) {
+            add_statistics(cur->tdata.get());
+            cur = next_segment;
+        } else {
+            // The next segment's warm-up did not reproduce the state at its start,
+            // so we continue converting the current segment instead.
+            VPRINT(1, "Segment %zu of trace thread %d is replaced by continuing %zu\n",
+                   cur->end, tdata->index, cur->ordinal);
+            std::vector<trace_entry_t>().swap(next_segment->entries);
+            std::vector<size_t>().swap(next_segment->write_ends);
+            std::vector<app_pc>().swap(next_segment->decode_pcs);
+            ++cur->end;
+            cur->stopped = false;
+            // Another worker may be using the decode cache of the last one.
+            cur->tdata->worker = worker_count_;
+            cur->tdata->last_decode_block_start = nullptr;
+            cur->tdata->last_block_summary = nullptr;
+            if (!process_thread_file(cur->tdata.get())) {
+                tdata->error = cur->tdata->error;
+                res = false;
+                break;
+            }
+        }
+        res = replay_segment(tdata, cur);
+    }
+    if (res)
+        add_statistics(cur->tdata.get());
+    for (std::thread &thread : threads)
+        thread.join();
+    return res;
+}
+
 // XXX i#6495: This assumes that all contents of the file can easily fit into memory.
 // With zipfile support we can potentially stream only the required component (the one
 // with the trace template we want) when needed in write_syscall_template().
@@ -1524,16 +1922,24 @@ raw2trace_t::do_conversion()
             syscall_traces_injected_ += thread_data_[i]->syscall_traces_injected;
         }
     } else {
-        // The files can be converted concurrently.
-        std::vector<std::thread> threads;
-        VPRINT(1, "Creating %d worker threads\n", worker_count_);
-        threads.reserve(worker_count_);
-        for (int i = 0; i < worker_count_; ++i) {
-            threads.push_back(
-                std::thread(&raw2trace_t::process_tasks, this, &worker_tasks_[i]));
-        }
-        for (std::thread &thread : threads)
-            thread.join();
+        if (segment_bytes_ > 0 && kthread_files_map_.empty()) {
+            // Each file is split up so all the workers convert it concurrently.
+            for (auto &tdata : thread_data_) {
+                if (!process_thread_segments(tdata.get()))
+                    break;
+            }
+        } else {
+            // The files can be converted concurrently.
+            std::vector<std::thread> threads;
+            VPRINT(1, "Creating %d worker threads\n", worker_count_);
+            threads.reserve(worker_count_);
+            for (int i = 0; i < worker_count_; ++i) {
+                threads.push_back(
+                    std::thread(&raw2trace_t::process_tasks, this, &worker_tasks_[i]));
+            }
+            for (std::thread &thread : threads)
+                thread.join();
+        }
         for (auto &tdata : thread_data_) {
             if (!tdata->error.empty())
                 return tdata->error;
@@ -1552,6 +1958,16 @@ raw2trace_t::do_conversion()
             syscall_traces_injected_ += tdata->syscall_traces_injected;
         }
     }
+    // The chunk index of each archive can only be written once it is complete.
+    for (auto &tdata : thread_data_) {
+        if (tdata->out_archive == nullptr)
+            continue;
+        error = tdata->out_archive->close();
+        if (!error.empty()) {
+            return "Failed to close output file for thread " +
+                std::to_string(tdata->tid) + ": " + error;
+        }
+    }
     error = aggregate_and_write_schedule_files();
     if (!error.empty())
         return error;
@@ -3267,6 +3683,12 @@ raw2trace_t::open_new_chunk(raw2trace_thread_data_t *tdata)
     stream << TRACE_CHUNK_PREFIX << std::setfill('0') << std::setw(4)
            << tdata->chunk_count_;
     tdata->error = tdata->out_archive->open_new_component(stream.str());
+    if (!tdata->error.empty())
+        return false;
+    // The chunk starts with the last timestamp, which emit_new_chunk_header()
+    // duplicates below.
+    tdata->error = tdata->out_archive->index_component(
+        tdata->chunk_count_ * chunk_instr_count_, tdata->last_timestamp_);
     if (!tdata->error.empty())
         return false;
     tdata->cur_chunk_instr_count = 0;
@@ -3371,6 +3793,8 @@ raw2trace_t::write(raw2trace_thread_data_t *tdata, const trace_entry_t *start,
                                        decode_pcs + decode_pcs_size);
         return true;
     }
+    if (tdata->segment != nullptr)
+        return record_segment_write(tdata, start, end, decode_pcs, decode_pcs_size);
     if (tdata->out_archive != nullptr) {
         bool prev_was_encoding = false;
         int instr_ordinal = -1;
@@ -3667,7 +4091,8 @@ raw2trace_t::raw2trace_t(
     const std::string &alt_module_dir, uint64_t chunk_instr_count,
     const std::unordered_map<thread_id_t, std::istream *> &kthread_files_map,
     const std::string &kcore_path, const std::string &kallsyms_path,
-    std::unique_ptr<dynamorio::drmemtrace::record_reader_t> syscall_template_file_reader)
+    std::unique_ptr<dynamorio::drmemtrace::record_reader_t> syscall_template_file_reader,
+    uint64_t segment_bytes)
     : dcontext_(dcontext == nullptr ? dr_standalone_init() : dcontext)
     , passed_dcontext_(dcontext != nullptr)
     , worker_count_(worker_count)
@@ -3684,6 +4109,7 @@ raw2trace_t::raw2trace_t(
     , kcore_path_(kcore_path)
     , kallsyms_path_(kallsyms_path)
     , syscall_template_file_reader_(std::move(syscall_template_file_reader))
+    , segment_bytes_(segment_bytes)
 {
     // Exactly one of out_files and out_archives should be non-empty.
     // If thread_files is not empty it must match the input size.
@@ -3733,6 +4159,9 @@ raw2trace_t::raw2trace_t(
             thread_data_[i]->worker = worker;
             worker = (worker + 1) % worker_count_;
         }
+        // The converting thread needs its own cache to continue segments serially.
+        if (segment_bytes_ > 0)
+            ++cache_count;
     } else
         cache_count = 1;
     decode_cache_.reserve(cache_count);
@@ -48,12 +48,14 @@
 #include <array>
 #include <atomic>
 #include <bitset>
+#include <condition_variable>
 #include <deque>
 #include <fstream>
 #include <limits>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <set>
 #include <string>
@@ -96,6 +98,7 @@ namespace drmemtrace {
 
 #ifdef HAS_ZLIB
 #    define TRACE_SUFFIX_GZ "trace.gz"
+#    define TRACE_SUFFIX_COLUMNAR "trace.col"
 #endif
 
 #define TRACE_SUFFIX "trace"
@@ -859,6 +862,10 @@ public:
     // and out_files are all owned and opened/closed by the caller.  module_map is not a
     // string and can contain binary data.
     // If a nullptr dcontext is passed, creates a new DR context va dr_standalone_init().
+    // If segment_bytes is non-zero, threads are converted one at a time, each read
+    // into memory and split at buffer unit headers into segments of roughly that many
+    // raw bytes which all worker_count workers convert concurrently.  This is meant
+    // for traces with fewer threads than workers.
     raw2trace_t(
         const char *module_map, const std::vector<std::istream *> &thread_files,
         const std::vector<std::ostream *> &out_files,
@@ -871,7 +878,8 @@ public:
         const std::unordered_map<thread_id_t, std::istream *> &kthread_files_map = {},
         const std::string &kcore_path = "", const std::string &kallsyms_path = "",
         std::unique_ptr<dynamorio::drmemtrace::record_reader_t> syscall_template_file =
-            nullptr);
+            nullptr,
+        uint64_t segment_bytes = 0);
     // If a nullptr dcontext_in was passed to the constructor, calls dr_standalone_exit().
     virtual ~raw2trace_t();
 
@@ -1024,6 +1032,8 @@ protected:
         int buf_idx; // Index into rseq_buffer_.
     };
 
+    struct thread_segment_t;
+
     // Per-traced-thread data is stored here and accessed without locks by having each
     // traced thread processed by only one processing thread.
     struct raw2trace_thread_data_t {
@@ -1134,6 +1144,11 @@ protected:
         std::vector<branch_info_t> rseq_branch_targets_;
         std::vector<app_pc> rseq_decode_pcs_;
 
+        // Set when this converts one segment of a thread file split by
+        // process_thread_segments().  The output then goes to the segment rather
+        // than to out_file, which is unset.
+        thread_segment_t *segment = nullptr;
+
 #ifdef BUILD_PT_POST_PROCESSOR
         std::unique_ptr<drir_t> pt_decode_state_ = nullptr;
         std::istream *kthread_file;
@@ -1142,6 +1157,65 @@ protected:
 #endif
     };
 
+    // The conversion state carried from one buffer unit into the next.  A segment's
+    // state at its first recorded unit must match the prior segment's state there.
+    struct segment_state_t {
+        bool
+        operator==(const segment_state_t &rhs) const;
+
+        // False if the state cannot be compared, such as inside an rseq region.
+        bool comparable = false;
+        // The index into the thread file of the next entry to read from the file.
+        uint64 read_index = 0;
+        std::vector<uint64> pre_read;
+        // Delayed branches without their encodings, which depend on each segment's
+        // own encoding history and are recomputed by replay_segment().
+        std::vector<trace_entry_t> delayed_branch;
+        std::vector<app_pc> delayed_branch_decode_pcs;
+        std::vector<app_pc> delayed_branch_target_pcs;
+        offline_file_type_t file_type = OFFLINE_FILE_TYPE_DEFAULT;
+        bool prev_instr_was_rep_string = false;
+        uint64 last_window = 0;
+        app_pc last_pc_if_syscall = 0;
+        uint last_cpu = 0;
+        bool rseq_want_rollback = false;
+        bool rseq_ever_saw_entry = false;
+    };
+
+    // A run of whole buffer units of one thread file.  A worker converts it starting
+    // one unit early to rebuild the state carried across units, such as delayed
+    // branches, and records the output from the segment's own first unit up to the
+    // first unit of the next segment.  Those first units have timestamps larger than
+    // any earlier one, which is how the conversion recognizes them.
+    struct thread_segment_t {
+        // Indices into the thread file of the first entry converted and of the
+        // timestamp entry starting the first recorded unit.
+        uint64 warmup_index = 0;
+        uint64 start_index = 0;
+        uint64 start_timestamp = 0;
+        // All segments of the file; "end" indexes the one whose start stops us.
+        const std::vector<std::unique_ptr<thread_segment_t>> *segments = nullptr;
+        size_t ordinal = 0;
+        size_t end = 0;
+        std::unique_ptr<std::streambuf> in_buf;
+        std::unique_ptr<std::istream> in_file;
+        std::unique_ptr<raw2trace_thread_data_t> tdata;
+        bool recording = false;
+        // Set when the conversion stops at the end, or when it failed to find its
+        // start and set "failed".
+        bool stopped = false;
+        bool failed = false;
+        // Guarded by the lock passed to process_segment_tasks().
+        bool done = false;
+        segment_state_t start_state;
+        segment_state_t end_state;
+        // The recorded output: the end of each write() call within "entries", and
+        // one decode pc per instruction.
+        std::vector<trace_entry_t> entries;
+        std::vector<size_t> write_ends;
+        std::vector<app_pc> decode_pcs;
+    };
+
 #ifdef BUILD_PT_POST_PROCESSOR
     /**
      * Returns the next #pt_data_buf_t entry from the thread's kernel raw file. If the
@@ -1520,6 +1594,41 @@ private:
     void
     process_tasks(std::vector<raw2trace_thread_data_t *> *tasks);
 
+    // Converts the thread file of "tdata" in segments using all of the workers.
+    // Returns false on error, which is stored in tdata->error.
+    bool
+    process_thread_segments(raw2trace_thread_data_t *tdata);
+
+    // Converts the segments claimed from "next" until there are none left, using
+    // the decode cache of "worker".
+    void
+    process_segment_tasks(std::vector<std::unique_ptr<thread_segment_t>> *segments,
+                          std::atomic<size_t> *next, int worker, std::mutex *lock,
+                          std::condition_variable *done_cond);
+
+    void
+    get_segment_state(raw2trace_thread_data_t *tdata,
+                      DR_PARAM_OUT segment_state_t *state);
+
+    // Called for each timestamp entry read by a segment's tdata.  Starts recording
+    // output at the segment's first unit and sets "stop" at the first unit of the
+    // following segment.
+    void
+    check_segment_cut(raw2trace_thread_data_t *tdata, const offline_entry_t &entry,
+                      DR_PARAM_OUT bool *stop);
+
+    // Stores the entries a segment's tdata passes to write().
+    bool
+    record_segment_write(raw2trace_thread_data_t *tdata, const trace_entry_t *start,
+                         const trace_entry_t *end, app_pc *decode_pcs,
+                         size_t decode_pcs_size);
+
+    // Writes the recorded output of "segment" to "tdata" through write(), so that
+    // chunks, encodings, and schedule entries come out as a single-pass conversion
+    // would produce them.
+    bool
+    replay_segment(raw2trace_thread_data_t *tdata, thread_segment_t *segment);
+
     bool
     emit_new_chunk_header(raw2trace_thread_data_t *tdata);
 
@@ -1704,6 +1813,9 @@ private:
     std::unordered_map<int, std::vector<trace_entry_t>> syscall_trace_templates_;
     memref_counter_t syscall_trace_template_encodings_;
     offline_file_type_t syscall_template_file_type_ = OFFLINE_FILE_TYPE_DEFAULT;
+
+    // Splitting of single thread files across workers.
+    uint64_t segment_bytes_ = 0;
 };
 
 } // namespace drmemtrace
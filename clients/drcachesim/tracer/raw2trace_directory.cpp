@@ -62,6 +62,7 @@
 #include "utils.h"
 #ifdef HAS_ZLIB
 #    include "common/gzip_istream.h"
+#    include "common/columnar_ostream.h"
 #    include "common/gzip_ostream.h"
 #    include "common/zlib_istream.h"
 #    include "compressed_file_reader.h"
@@ -143,6 +144,10 @@ raw2trace_directory_t::trace_suffix()
     } else if (compress_type_ == "lz4") {
 #ifdef HAS_LZ4
         return TRACE_SUFFIX_LZ4;
+#endif
+    } else if (compress_type_ == "columnar") {
+#ifdef HAS_ZLIB
+        return TRACE_SUFFIX_COLUMNAR;
 #endif
     }
     return TRACE_SUFFIX;
@@ -263,29 +268,44 @@ raw2trace_directory_t::open_thread_log_file(const char *basename)
         return "Failed to compute full path of output file for " + std::string(basename);
     }
 
+    // Archives are split by raw2trace into chunks.  gzip and lz4 files are only
+    // split when they are indexed, as readers can only find their chunks through
+    // the index.
+    archive_ostream_t *archive = nullptr;
     std::ostream *ofile = nullptr;
     if (compress_type_ == "zip") {
 #ifdef HAS_ZIP
-        ofile = new zipfile_ostream_t(path);
-        out_archives_.push_back(reinterpret_cast<archive_ostream_t *>(ofile));
-        if (!(*out_archives_.back()))
-            return "Failed to open output file " + std::string(path);
-
-        VPRINT(1, "Opened output file %s\n", path);
-        return "";
+        archive = new zipfile_ostream_t(path, chunk_index_);
 #endif
     } else if (compress_type_ == "gzip") {
 #ifdef HAS_ZLIB
-        ofile = new gzip_ostream_t(path);
+        if (chunk_index_)
+            archive = new gzip_ostream_t(path, /*write_index=*/true);
+        else
+            ofile = new gzip_ostream_t(path);
 #endif
     } else if (compress_type_ == "lz4") {
 #ifdef HAS_LZ4
-        ofile = new lz4_ostream_t(path);
+        if (chunk_index_)
+            archive = new lz4_ostream_t(path, /*write_index=*/true);
+        else
+            ofile = new lz4_ostream_t(path);
+#endif
+    } else if (compress_type_ == "columnar") {
+#ifdef HAS_ZLIB
+        archive = new columnar_ostream_t(path, chunk_index_);
 #endif
     }
-    if (!ofile) {
-        ofile = new std::ofstream(path, std::ofstream::binary);
+    if (archive != nullptr) {
+        out_archives_.push_back(archive);
+        if (!(*out_archives_.back()))
+            return "Failed to open output file " + std::string(path);
+
+        VPRINT(1, "Opened output file %s\n", path);
+        return "";
     }
+    if (ofile == nullptr)
+        ofile = new std::ofstream(path, std::ofstream::binary);
     out_files_.push_back(ofile);
     if (!(*out_files_.back()))
         return "Failed to open output file " + std::string(path);
@@ -508,11 +528,13 @@ raw2trace_directory_t::tracedir_from_rawdir(const std::string &rawdir_in)
 std::string
 raw2trace_directory_t::initialize(const std::string &indir, const std::string &outdir,
                                   const std::string &compress,
-                                  const std::string &syscall_template_file)
+                                  const std::string &syscall_template_file,
+                                  bool chunk_index)
 {
     indir_ = indir;
     outdir_ = outdir;
     compress_type_ = compress;
+    chunk_index_ = chunk_index;
 #ifdef WINDOWS
     // Canonicalize.
     std::replace(indir_.begin(), indir_.end(), ALT_DIRSEP[0], DIRSEP[0]);
@@ -73,11 +73,14 @@ public:
     ~raw2trace_directory_t();
 
     // If outdir.empty() then a peer of indir's OUTFILE_SUBDIR named TRACE_SUBDIR
-    // is used by default.  Returns "" on success or an error message on failure.
+    // is used by default.  If chunk_index is set, compressed output files are split
+    // into self-contained chunks and each is given a trace_index_t (see
+    // archive_ostream_t::close()).  Returns "" on success or an error message on
+    // failure.
     std::string
     initialize(const std::string &indir, const std::string &outdir,
                const std::string &compress = DEFAULT_TRACE_COMPRESSION_TYPE,
-               const std::string &syscall_template_file = "");
+               const std::string &syscall_template_file = "", bool chunk_index = false);
     // Use this instead of initialize() to only fill in modfile_bytes, for
     // constructing a module_mapper_t.  Returns "" on success or an error message on
     // failure.
@@ -136,6 +139,7 @@ private:
     std::string outdir_;
     unsigned int verbosity_;
     std::string compress_type_;
+    bool chunk_index_ = false;
 };
 
 } // namespace drmemtrace
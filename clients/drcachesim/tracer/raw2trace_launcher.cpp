@@ -76,8 +76,24 @@ static droption_t<bytesize_t> op_chunk_instr_count(
     DROPTION_SCOPE_FRONTEND, "chunk_instr_count", 10 * 1000 * 1000U,
     "Chunk instruction count",
     "Specifies the size in instructions of the chunks into which a trace output file "
-    "is split inside a zipfile.  This is the granularity of a fast seek. "
-    "For 32-bit this cannot exceed 4G.");
+    "is split inside a zipfile, or inside a gzip or lz4 file with -chunk_index.  This "
+    "is the granularity of a fast seek.  For 32-bit this cannot exceed 4G.");
+
+static droption_t<bool> op_chunk_index(
+    DROPTION_SCOPE_FRONTEND, "chunk_index", false,
+    "Write a chunk index next to each compressed trace file",
+    "Writes a table of each compressed trace file's chunks next to it, to the trace "
+    "file's path plus \".idx\", for readers to seek directly to a chunk.  This also "
+    "splits .gz and .lz4 files into self-contained chunks.  See the drcachesim "
+    "option of the same name for details.");
+
+static droption_t<bytesize_t> op_segment_size(
+    DROPTION_SCOPE_FRONTEND, "segment_size", 0, "Per-thread segment size for -jobs",
+    "By default, each thread's file is converted by a single job.  If this is non-zero, "
+    "the files are instead converted one at a time, each split into segments of "
+    "roughly this many raw bytes which all of the -jobs convert concurrently.  Each "
+    "file is read into memory.  This is meant for traces with fewer threads than "
+    "jobs.");
 
 static droption_t<unsigned int> op_verbose(DROPTION_SCOPE_FRONTEND, "verbose", 0,
                                            "Verbosity level for diagnostic output",
@@ -92,9 +108,11 @@ static droption_t<int>
 
 static droption_t<std::string> op_trace_compress(
     DROPTION_SCOPE_FRONTEND, "compress", DEFAULT_TRACE_COMPRESSION_TYPE,
-    "Trace compression: \"zip\",\"gzip\",\"zlib\",\"lz4\",\"none\"",
+    "Trace compression: \"zip\",\"gzip\",\"zlib\",\"lz4\",\"columnar\",\"none\"",
     "Specifies the compression type to use for trace files: \"zip\", "
-    "\"gzip\", \"zlib\", \"lz4\", or \"none\". "
+    "\"gzip\", \"zlib\", \"lz4\", \"columnar\", or \"none\". "
+    "The columnar format stores record types, instruction address deltas, and "
+    "per-instruction data address strides as separately compressed streams. "
     "In most cases where fast skipping by instruction count is not needed "
     "lz4 compression generally improves performance and is recommended. "
     "When it comes to storage types, the impact on overhead varies: "
@@ -136,7 +154,9 @@ _tmain(int argc, const TCHAR *targv[])
 
     raw2trace_directory_t dir(op_verbose.get_value());
     std::string dir_err = dir.initialize(op_indir.get_value(), op_outdir.get_value(),
-                                         op_trace_compress.get_value());
+                                         op_trace_compress.get_value(),
+                                         /*syscall_template_file=*/"",
+                                         op_chunk_index.get_value());
     if (!dir_err.empty())
         FATAL_ERROR("Directory parsing failed: %s", dir_err.c_str());
     raw2trace_t raw2trace(dir.modfile_bytes_, dir.in_files_, dir.out_files_,
@@ -144,7 +164,9 @@ _tmain(int argc, const TCHAR *targv[])
                           dir.serial_schedule_file_, dir.cpu_schedule_file_, nullptr,
                           op_verbose.get_value(), op_jobs.get_value(),
                           op_alt_module_dir.get_value(), op_chunk_instr_count.get_value(),
-                          dir.in_kfiles_map_, dir.kcoredir_, dir.kallsymsdir_);
+                          dir.in_kfiles_map_, dir.kcoredir_, dir.kallsymsdir_,
+                          /*syscall_template_file=*/nullptr,
+                          op_segment_size.get_value());
     std::string error = raw2trace.do_conversion();
     if (!error.empty())
         FATAL_ERROR("Conversion failed: %s", error.c_str());
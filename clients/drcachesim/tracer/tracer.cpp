@@ -148,6 +148,25 @@ typedef struct {
 
 /* For online simulation, we write to a single global pipe */
 named_pipe_t ipc_pipe;
+#ifdef HAS_SHM_RING
+/* Or, for -ipc_ring_size, to a single global shared-memory ring. */
+shm_ring_t ipc_ring;
+#endif
+
+void
+close_ipc()
+{
+#ifdef HAS_SHM_RING
+    void *ring_base = ipc_ring.get_mapping_base();
+    if (ring_base != nullptr) {
+        size_t ring_size = ipc_ring.get_mapping_size();
+        ipc_ring.detach();
+        dr_unmap_file(ring_base, ring_size);
+        return;
+    }
+#endif
+    ipc_pipe.close();
+}
 
 #define MAX_INSTRU_SIZE 256 /* The max instance size of instru_t or its children. */
 instru_t *instru;
@@ -514,6 +533,8 @@ event_pre_detach()
         instru->set_frozen_timestamp(instru_t::get_timestamp());
         tracing_mode.store(BBDUP_MODE_NOP, std::memory_order_release);
     }
+    // Our compression threads must be idle before DR starts detaching.
+    stop_compress_threads();
 }
 
 /***************************************************************************
@@ -1918,7 +1939,7 @@ event_exit(void)
         if (encoding_file != INVALID_FILE)
             file_ops_func.close_file(encoding_file);
     } else
-        ipc_pipe.close();
+        close_ipc();
 
     if (file_ops_func.exit_cb != NULL)
         (*file_ops_func.exit_cb)(file_ops_func.exit_arg);
@@ -2049,6 +2070,76 @@ init_offline_dir(void)
             encoding_file != INVALID_FILE);
 }
 
+static void
+init_ipc_pipe()
+{
+    if (!ipc_pipe.set_name(op_ipc_name.get_value().c_str()))
+        DR_ASSERT(false);
+#ifdef UNIX
+    /* we want an isolated fd so we don't use ipc_pipe.open_for_write() */
+    const char *pipe_path = ipc_pipe.get_pipe_path().c_str();
+    if (!dr_file_exists(pipe_path)) {
+        NOTIFY(0,
+               "drmemtrace WARNING: attempting to open write end of pipe at %s "
+               "for online analysis but pipe does not exist. Use \"-offline\" "
+               "mode if you are using drmemtrace without a reader.\n",
+               pipe_path);
+    }
+
+    int fd = dr_open_file(pipe_path, DR_FILE_WRITE_ONLY);
+    DR_ASSERT(fd != INVALID_FILE);
+    if (!ipc_pipe.set_fd(fd))
+        DR_ASSERT(false);
+#else
+    if (!ipc_pipe.open_for_write()) {
+        if (GetLastError() == ERROR_PIPE_BUSY) {
+            // FIXME i#1727: add multi-process support to Windows named_pipe_t.
+            FATAL("Fatal error: multi-process applications not yet supported "
+                  "for drcachesim on Windows\n");
+        } else {
+            FATAL("Fatal error: Failed to open pipe %s.\n",
+                  op_ipc_name.get_value().c_str());
+        }
+    }
+#endif
+    if (!ipc_pipe.maximize_buffer())
+        NOTIFY(1, "Failed to maximize pipe buffer: performance may suffer.\n");
+}
+
+static void
+init_ipc_ring()
+{
+#ifdef HAS_SHM_RING
+    if (!ipc_ring.set_name(op_ipc_name.get_value().c_str()))
+        DR_ASSERT(false);
+    /* Like for the pipe, we open the file ourselves with DR's API.  We share
+     * one ring among all threads and processes so the reader sees a single
+     * interleaved stream just as with the pipe.
+     */
+    const char *ring_path = ipc_ring.get_path().c_str();
+    file_t f = dr_open_file(ring_path, DR_FILE_READ | DR_FILE_WRITE_APPEND);
+    if (f == INVALID_FILE) {
+        FATAL("Fatal error: failed to open shared-memory ring %s: is the simulator "
+              "running with the same -ipc_name and -ipc_ring_size?\n",
+              ring_path);
+    }
+    uint64 file_size;
+    void *map = NULL;
+    size_t map_size = 0;
+    if (dr_file_size(f, &file_size)) {
+        map_size = static_cast<size_t>(file_size);
+        map = dr_map_file(f, &map_size, 0, NULL, DR_MEMPROT_READ | DR_MEMPROT_WRITE, 0);
+    }
+    dr_close_file(f);
+    if (map == NULL || !ipc_ring.attach(map, map_size))
+        FATAL("Fatal error: failed to map shared-memory ring %s\n", ring_path);
+    if (!ipc_ring.add_writer())
+        DR_ASSERT(false);
+#else
+    FATAL("Fatal error: -ipc_ring_size is only supported on Linux\n");
+#endif
+}
+
 #ifdef UNIX
 static void
 fork_init(void *drcontext)
@@ -2074,10 +2165,20 @@ fork_init(void *drcontext)
     data->num_refs = 0;
     if (op_offline.get_value()) {
         data->file = INVALID_FILE;
+        fork_init_io(drcontext);
         if (!init_offline_dir()) {
             FATAL("Failed to create a subdir in %s\n", op_outdir.get_value().c_str());
         }
     }
+#    ifdef HAS_SHM_RING
+    if (!op_offline.get_value() && op_ipc_ring_size.get_value() > 0) {
+        /* The ring mapping is inherited but the reader must not see the stream
+         * end until this process detaches too.
+         */
+        if (!ipc_ring.add_writer())
+            DR_ASSERT(false);
+    }
+#    endif
     init_thread_in_process(drcontext);
 }
 #endif
@@ -2332,37 +2433,10 @@ drmemtrace_client_main(client_id_t id, int argc, const char *argv[])
         placement = dr_global_alloc(MAX_INSTRU_SIZE);
         instru = new (placement) online_instru_t(
             insert_load_buf_ptr, insert_update_buf_ptr, &scratch_reserve_vec);
-        if (!ipc_pipe.set_name(op_ipc_name.get_value().c_str()))
-            DR_ASSERT(false);
-#ifdef UNIX
-        /* we want an isolated fd so we don't use ipc_pipe.open_for_write() */
-        const char *pipe_path = ipc_pipe.get_pipe_path().c_str();
-        if (!dr_file_exists(pipe_path)) {
-            NOTIFY(0,
-                   "drmemtrace WARNING: attempting to open write end of pipe at %s "
-                   "for online analysis but pipe does not exist. Use \"-offline\" "
-                   "mode if you are using drmemtrace without a reader.\n",
-                   pipe_path);
-        }
-
-        int fd = dr_open_file(pipe_path, DR_FILE_WRITE_ONLY);
-        DR_ASSERT(fd != INVALID_FILE);
-        if (!ipc_pipe.set_fd(fd))
-            DR_ASSERT(false);
-#else
-        if (!ipc_pipe.open_for_write()) {
-            if (GetLastError() == ERROR_PIPE_BUSY) {
-                // FIXME i#1727: add multi-process support to Windows named_pipe_t.
-                FATAL("Fatal error: multi-process applications not yet supported "
-                      "for drcachesim on Windows\n");
-            } else {
-                FATAL("Fatal error: Failed to open pipe %s.\n",
-                      op_ipc_name.get_value().c_str());
-            }
-        }
-#endif
-        if (!ipc_pipe.maximize_buffer())
-            NOTIFY(1, "Failed to maximize pipe buffer: performance may suffer.\n");
+        if (op_ipc_ring_size.get_value() > 0)
+            init_ipc_ring();
+        else
+            init_ipc_pipe();
     }
 
     if (op_offline.get_value() &&
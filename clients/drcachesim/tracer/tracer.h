@@ -45,6 +45,9 @@
 #include "named_pipe.h"
 #include "options.h"
 #include "physaddr.h"
+#ifdef HAS_SHM_RING
+#    include "shm_ring.h"
+#endif
 #ifdef HAS_SNAPPY
 #    include <snappy.h>
 
@@ -64,16 +67,24 @@ namespace dynamorio {
 namespace drmemtrace {
 
 extern named_pipe_t ipc_pipe;
+#ifdef HAS_SHM_RING
+extern shm_ring_t ipc_ring;
+#endif
+// Closes the pipe or detaches from the ring for online tracing.
+void
+close_ipc();
 // A clean exit via dr_exit_process() is not supported from init code, but
 // we do want to at least close the pipe file.
 #define FATAL(...)                       \
     do {                                 \
         dr_fprintf(STDERR, __VA_ARGS__); \
         if (!op_offline.get_value())     \
-            ipc_pipe.close();            \
+            close_ipc();                 \
         dr_abort();                      \
     } while (0)
 
+struct async_output_t;
+
 /* Thread private data.  This is all set to 0 at thread init. */
 typedef struct {
     byte *seg_base;
@@ -108,6 +119,8 @@ typedef struct {
     size_t buf_lz4_size;
     byte *buf_lz4;
 #endif
+    /* For -raw_compress_threads. */
+    async_output_t *async_output;
     bool has_thread_header;
     // The physaddr_t class is designed to be per-thread.
     physaddr_t physaddr;
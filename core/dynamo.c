@@ -2912,12 +2912,15 @@ dynamorio_take_over_threads(dcontext_t *dcontext)
      * as handling signals.
      */
     dynamo_thread_under_dynamo(dcontext);
-    signal_event(dr_app_started);
     SELF_UNPROTECT_DATASEC(DATASEC_RARELY_PROT);
     dynamo_started = true;
     /* Similarly, with our signal handler back in place, we remove the TLS limit. */
     detacher_tid = INVALID_THREAD_ID;
     SELF_PROTECT_DATASEC(DATASEC_RARELY_PROT);
+    /* Client threads created during init wait on this before their thread init,
+     * which needs the TLS limit above to be gone.
+     */
+    signal_event(dr_app_started);
     /* XXX i#1305: we should suspend all the other threads for DR init to
      * satisfy the parts of the init process that assume there are no races.
      */
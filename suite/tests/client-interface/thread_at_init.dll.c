@@ -0,0 +1,82 @@
+/* **********************************************************
+ * Copyright (c) 2026 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of VMware, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* Tests client threads created during init: DR holds them until the app starts,
+ * and they must then be able to initialize themselves.
+ */
+
+#include "dr_api.h"
+#include "client_tools.h"
+
+#define NUM_THREADS 4
+
+static void *thread_ran[NUM_THREADS];
+static bool thread_had_drcontext[NUM_THREADS];
+
+static void
+thread_func(void *arg)
+{
+    int i = (int)(ptr_int_t)arg;
+    thread_had_drcontext[i] = (dr_get_current_drcontext() != NULL);
+    dr_event_signal(thread_ran[i]);
+    /* We do not return, to stay out of DR's exit synch: DR terminates us after
+     * the exit event.
+     */
+    while (true)
+        dr_sleep(1000);
+}
+
+static void
+event_exit(void)
+{
+    int i;
+    for (i = 0; i < NUM_THREADS; i++) {
+        dr_event_wait(thread_ran[i]);
+        CHECK(thread_had_drcontext[i], "client thread has no drcontext");
+    }
+    for (i = 0; i < NUM_THREADS; i++)
+        dr_event_destroy(thread_ran[i]);
+    dr_fprintf(STDERR, "%d client threads ran\n", NUM_THREADS);
+}
+
+DR_EXPORT void
+dr_client_main(client_id_t id, int argc, const char *argv[])
+{
+    int i;
+    dr_register_exit_event(event_exit);
+    for (i = 0; i < NUM_THREADS; i++) {
+        thread_ran[i] = dr_event_create();
+        CHECK(dr_create_client_thread(thread_func, (void *)(ptr_int_t)i),
+              "failed to create client thread");
+    }
+}